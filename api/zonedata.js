@@ -28,8 +28,19 @@ const JOURNEY_CONFIG = {
   platformChange: parseInt(process.env.PLATFORM_CHANGE) || 3
 };
 
-function getMelbourneTime() {
-  return new Date(new Date().toLocaleString('en-US', { timeZone: 'Australia/Melbourne' }));
+function getMelbourneTime(base = new Date()) {
+  return new Date(base.toLocaleString('en-US', { timeZone: 'Australia/Melbourne' }));
+}
+
+/**
+ * Apply-at time requested by a prefetching device (?at=<epoch seconds>).
+ * Only the near future is honoured; anything else renders as of now.
+ */
+function parseApplyAt(query) {
+  const at = parseInt(query.at, 10);
+  if (!at) return null;
+  const delta = at * 1000 - Date.now();
+  return delta > -60000 && delta < 300000 ? new Date(at * 1000) : null;
 }
 
 function formatTime(date) {
@@ -92,13 +103,15 @@ export default async function handler(req, res) {
   }
   
   try {
-    const now = getMelbourneTime();
+    const applyAt = parseApplyAt(req.query);
+    const asOf = applyAt || new Date();
+    const now = getMelbourneTime(asOf);
     const currentTime = formatTime(now);
     const { day, date } = formatDateParts(now);
     
     const [trains, trams, weather] = await Promise.all([
-      getDepartures(TRAIN_STOP_ID, 0),
-      getDepartures(TRAM_STOP_ID, 1),
+      getDepartures(TRAIN_STOP_ID, 0, asOf),
+      getDepartures(TRAM_STOP_ID, 1, asOf),
       getWeather()
     ]);
     
@@ -130,6 +143,7 @@ export default async function handler(req, res) {
     
     res.setHeader('Content-Type', 'application/json');
     res.setHeader('Cache-Control', 'no-cache');
+    if (applyAt) res.setHeader('X-Apply-At', String(applyAt.getTime() / 1000));
     
     return res.json({
       timestamp: result.timestamp,
@@ -10,6 +10,9 @@
  * 3. Build journey legs from transit + coffee data
  * 4. Render V11 zones (BMP format for e-ink)
  * 5. Return changed zone IDs (or full zone data with batch param)
+ *
+ * plain=1 (the firmware's changed-zone list) is answered by the server's
+ * own route with V12 ids, the zones /api/zone/:id renders.
  * 
  * Copyright (c) 2026 Angus Bergman
  * Licensed under CC BY-NC 4.0
@@ -42,8 +45,19 @@ const JOURNEY_CONFIG = {
 // HELPER FUNCTIONS
 // ============================================================================
 
-function getMelbourneTime() {
-  return new Date(new Date().toLocaleString('en-US', { timeZone: 'Australia/Melbourne' }));
+function getMelbourneTime(base = new Date()) {
+  return new Date(base.toLocaleString('en-US', { timeZone: 'Australia/Melbourne' }));
+}
+
+/**
+ * Apply-at time requested by a prefetching device (?at=<epoch seconds>).
+ * Only the near future is honoured; anything else renders as of now.
+ */
+function parseApplyAt(query) {
+  const at = parseInt(query.at, 10);
+  if (!at) return null;
+  const delta = at * 1000 - Date.now();
+  return delta > -60000 && delta < 300000 ? new Date(at * 1000) : null;
 }
 
 function formatTime(date) {
@@ -190,6 +204,10 @@ function calculateLeaveInMinutes(now, totalMinutes) {
 // ============================================================================
 
 export default async function handler(req, res) {
+  if (req.query.plain === '1') {
+    const { default: app } = await import('../src/server.js');
+    return app(req, res);
+  }
   try {
     // Version check
     if (req.query.ver) {
@@ -206,13 +224,15 @@ export default async function handler(req, res) {
     // 1. FETCH REAL-TIME DATA
     // ========================================================================
     
-    const now = getMelbourneTime();
+    const applyAt = parseApplyAt(req.query);
+    const asOf = applyAt || new Date();
+    const now = getMelbourneTime(asOf);
     const currentTime = formatTime(now);
     const { day, date } = formatDateParts(now);
     
     const [trains, trams, weather] = await Promise.all([
-      getDepartures(TRAIN_STOP_ID, 0),
-      getDepartures(TRAM_STOP_ID, 1),
+      getDepartures(TRAIN_STOP_ID, 0, asOf),
+      getDepartures(TRAM_STOP_ID, 1, asOf),
       getWeather()
     ]);
     
@@ -267,13 +287,6 @@ export default async function handler(req, res) {
     const result = renderZones(dashboardData, forceAll);
     const changedIds = result.zones.map(z => z.id);
     
-    // Plain text format for ESP32
-    if (req.query.plain === '1') {
-      res.setHeader('Content-Type', 'text/plain');
-      res.setHeader('Cache-Control', 'no-cache');
-      return res.status(200).send(changedIds.join(','));
-    }
-    
     // Batch support for ESP32 memory constraints
     const batchParam = req.query.batch;
     if (batchParam !== undefined) {
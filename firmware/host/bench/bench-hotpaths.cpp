@@ -0,0 +1,490 @@
+/**
+ * Micro-benchmarks for the code every update cycle runs
+ *
+ *   decode_base64          zone BMPs from /api/zones (include/base64.hpp)
+ *   parseZoneList          the changed-zone CSV (fetchChangedZoneList, push frames)
+ *   zoneExtract            per-zone JSON extraction and BMP decode (ZoneJsonDecoder::fetch)
+ *   dashboardRegions       the region id strcmp chain (drawDashboardTemplate)
+ *   bmpBlit                zone BMP into the 800x480 framebuffer; /layout is
+ *                          layoutBlitBmp() on spans the layout compiler worked out,
+ *                          /panel the word blit for the panel type (panel_hal.hpp)
+ *   fillRect, invertRect   a zone's flash: per pixel as bbep.fillRect() does
+ *                          it, and panelFill()/panelInvert(), the panel's word kernels
+ *   pageSwitch             a button press: the dashboard packed into its page
+ *                          slot, a held page unpacked (include/page_cache.hpp)
+ *
+ * Inputs are the payloads in bench/payloads (make-payloads.py captures them
+ * from a server, or BENCH_PAYLOADS=dir points elsewhere). Besides time per
+ * op, each benchmark reports heap allocations and bytes per op. The JSON
+ * ones need ArduinoJson on the include path (a PlatformIO build fetches it
+ * into .pio/libdeps); without it they're left out.
+ *
+ * Usage: ./bench-hotpaths [--benchmark_filter=RE] [--benchmark_out=run.json]
+ *        bench/compare-bench.py bench/baseline.json run.json
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "base64.hpp"
+#include "bmp_blit.hpp"
+#include "layout_compile.hpp"
+#include "page_cache.hpp"
+#include "panel_hal.hpp"
+#include "zone_layout.hpp"
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if BENCH_ARDUINOJSON
+#include <ArduinoJson.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Allocation counting: every operator new (and ArduinoJson's allocator below)
+
+static size_t allocCount = 0, allocBytes = 0;
+
+void* operator new(size_t n) {
+    allocCount++;
+    allocBytes += n;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Per-op heap use over the timing loop. Throughput is reported from here too
+// because setting it allocates, so it must come after the reading.
+class AllocScope {
+public:
+    AllocScope(benchmark::State& state, int64_t bytesPerOp = 0, int64_t itemsPerOp = 0)
+        : _state(state), _count(allocCount), _bytes(allocBytes), _bytesPerOp(bytesPerOp), _itemsPerOp(itemsPerOp) {}
+    ~AllocScope() {
+        double count = (double)(allocCount - _count), bytes = (double)(allocBytes - _bytes);
+        _state.counters["allocs"] = benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+        _state.counters["alloc_bytes"] = benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+        if (_bytesPerOp) _state.SetBytesProcessed((int64_t)_state.iterations() * _bytesPerOp);
+        if (_itemsPerOp) _state.SetItemsProcessed((int64_t)_state.iterations() * _itemsPerOp);
+    }
+private:
+    benchmark::State& _state;
+    size_t _count, _bytes;
+    int64_t _bytesPerOp, _itemsPerOp;
+};
+
+// ---------------------------------------------------------------------------
+// Payloads, loaded once before any timing
+
+struct ZonePayload { std::string id; int x, y, w, h; std::string data; std::vector<uint8_t> bmp; };
+struct RegionPayload { std::string id, text; };
+
+static std::string zonesJson, zonesCsv, regionsJson;
+static std::vector<ZonePayload> zonePayloads;
+static std::vector<RegionPayload> regionPayloads;
+
+static std::string readFile(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { fprintf(stderr, "bench-hotpaths: can't read %s\n", path.c_str()); exit(1); }
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+// Just enough JSON scanning for the fixtures, so the non-JSON benchmarks don't need ArduinoJson
+static bool scanString(const std::string& s, size_t from, const char* key, size_t end, std::string& out) {
+    std::string k = std::string("\"") + key + "\"";
+    size_t p = s.find(k, from);
+    if (p == std::string::npos || p >= end) return false;
+    p = s.find('"', s.find(':', p + k.size()) + 1);
+    size_t q = s.find('"', p + 1);
+    out = s.substr(p + 1, q - p - 1);
+    return true;
+}
+
+static int scanInt(const std::string& s, size_t from, const char* key, size_t end) {
+    std::string k = std::string("\"") + key + "\"";
+    size_t p = s.find(k, from);
+    return p == std::string::npos || p >= end ? 0 : atoi(s.c_str() + s.find(':', p) + 1);
+}
+
+static void loadPayloads() {
+    const char* env = getenv("BENCH_PAYLOADS");
+    std::string dir = env ? env : BENCH_PAYLOAD_DIR;
+    zonesJson = readFile(dir + "/zones.json");
+    zonesCsv = readFile(dir + "/zones.csv");
+    regionsJson = readFile(dir + "/regions.json");
+
+    for (size_t p = zonesJson.find("\"id\""); p != std::string::npos;) {
+        size_t next = zonesJson.find("\"id\"", p + 4);
+        size_t end = next == std::string::npos ? zonesJson.size() : next;
+        ZonePayload z;
+        scanString(zonesJson, p, "id", end, z.id);
+        z.x = scanInt(zonesJson, p, "x", end); z.y = scanInt(zonesJson, p, "y", end);
+        z.w = scanInt(zonesJson, p, "w", end); z.h = scanInt(zonesJson, p, "h", end);
+        if (scanString(zonesJson, p, "data", end, z.data)) {
+            z.bmp.resize(decode_base64_length((const unsigned char*)z.data.data(), z.data.size()));
+            z.bmp.resize(decode_base64((const unsigned char*)z.data.data(), z.data.size(), z.bmp.data()));
+            zonePayloads.push_back(z);
+        }
+        p = next;
+    }
+    for (size_t p = regionsJson.find("\"id\""); p != std::string::npos;) {
+        size_t next = regionsJson.find("\"id\"", p + 4);
+        RegionPayload r;
+        scanString(regionsJson, p, "id", next == std::string::npos ? regionsJson.size() : next, r.id);
+        scanString(regionsJson, p, "text", next == std::string::npos ? regionsJson.size() : next, r.text);
+        regionPayloads.push_back(r);
+        p = next;
+    }
+    if (zonePayloads.empty() || regionPayloads.empty()) { fprintf(stderr, "bench-hotpaths: no zones/regions in %s\n", dir.c_str()); exit(1); }
+}
+
+// ---------------------------------------------------------------------------
+// decode_base64 over each zone in the /api/zones response
+
+static void BM_DecodeBase64(benchmark::State& state) {
+    const ZonePayload& z = zonePayloads[state.range(0)];
+    std::vector<uint8_t> out(z.bmp.size() + 4);
+    state.SetLabel(z.id);
+    AllocScope allocs(state, (int64_t)z.data.size());
+    for (auto _ : state) {
+        size_t n = decode_base64((const unsigned char*)z.data.data(), z.data.size(), out.data());
+        benchmark::DoNotOptimize(n);
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_DecodeBase64Length(benchmark::State& state) {
+    const ZonePayload& z = zonePayloads[state.range(0)];
+    state.SetLabel(z.id);
+    for (auto _ : state) benchmark::DoNotOptimize(decode_base64_length((const unsigned char*)z.data.data(), z.data.size()));
+}
+
+// ---------------------------------------------------------------------------
+// parseZoneList: the captured list, and the worst case of every zone named
+
+static void BM_ParseZoneList(benchmark::State& state) {
+    std::string csv = zonesCsv;
+    if (state.range(0)) {
+        csv.clear();
+        for (int i = ZONE_COUNT - 1; i >= 0; i--) csv += std::string(ZONES[i].id) + (i ? ", " : "");
+    }
+    state.SetLabel(state.range(0) ? "all zones" : "captured");
+    AllocScope allocs(state, (int64_t)csv.size());
+    for (auto _ : state) {
+        bool flags[ZONE_COUNT] = {};
+        benchmark::DoNotOptimize(parseZoneList(csv.data(), csv.size(), ZONES, ZONE_COUNT, flags));
+        benchmark::DoNotOptimize(flags);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// drawDashboardTemplate's region dispatch, in its order (src/dashboard_template.cpp)
+
+struct DashboardText {
+    const char *stationName, *timeText;
+    const char *tramRoute, *tramDest, *tram1Time, *tram1Dest, *tram1Status, *tram2Time, *tram2Dest, *tram2Status;
+    const char *trainLine, *train1Time, *train1Dest, *train1Status, *train2Time, *train2Dest, *train2Status;
+    const char *alert, *weather, *temperature;
+};
+
+static inline void dashboardRegion(DashboardText& t, const char* id, const char* text) {
+    if (strcmp(id, "station_name") == 0) t.stationName = text;
+    else if (strcmp(id, "time") == 0) t.timeText = text;
+
+    else if (strcmp(id, "tram_route") == 0) t.tramRoute = text;
+    else if (strcmp(id, "tram_dest") == 0) t.tramDest = text;
+    else if (strcmp(id, "tram1_time") == 0) t.tram1Time = text;
+    else if (strcmp(id, "tram1_dest") == 0) t.tram1Dest = text;
+    else if (strcmp(id, "tram1_status") == 0) t.tram1Status = text;
+    else if (strcmp(id, "tram2_time") == 0) t.tram2Time = text;
+    else if (strcmp(id, "tram2_dest") == 0) t.tram2Dest = text;
+    else if (strcmp(id, "tram2_status") == 0) t.tram2Status = text;
+
+    else if (strcmp(id, "train_line") == 0) t.trainLine = text;
+    else if (strcmp(id, "train1_time") == 0) t.train1Time = text;
+    else if (strcmp(id, "train1_dest") == 0) t.train1Dest = text;
+    else if (strcmp(id, "train1_status") == 0) t.train1Status = text;
+    else if (strcmp(id, "train2_time") == 0) t.train2Time = text;
+    else if (strcmp(id, "train2_dest") == 0) t.train2Dest = text;
+    else if (strcmp(id, "train2_status") == 0) t.train2Status = text;
+
+    else if (strcmp(id, "alert") == 0) t.alert = text;
+    else if (strcmp(id, "weather") == 0) t.weather = text;
+    else if (strcmp(id, "temperature") == 0) t.temperature = text;
+}
+
+static void BM_DashboardRegions(benchmark::State& state) {
+    AllocScope allocs(state, 0, (int64_t)regionPayloads.size());
+    for (auto _ : state) {
+        DashboardText t = {};
+        for (const RegionPayload& r : regionPayloads) dashboardRegion(t, r.id.c_str(), r.text.c_str());
+        benchmark::DoNotOptimize(t);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BMP blit: server zones at their own position, and at an unaligned x (zones-v12 "time" sits at x=20)
+
+alignas(4) static uint8_t framebuffer[ZONE_CANVAS_W / 8 * ZONE_CANVAS_H];
+static const TileSurface screen = { framebuffer, ZONE_CANVAS_W / 8, ZONE_CANVAS_W, ZONE_CANVAS_H };
+
+// What layout-compile would emit for each payload zone, at its own place
+static std::vector<LayoutZone> zoneLayouts;
+
+static void makeZoneLayouts() {
+    for (const ZonePayload& z : zonePayloads)
+        zoneLayouts.push_back({layoutSpan(screen.pitch, z.x, z.y, z.w), (int16_t)z.w, (int16_t)z.h, (uint16_t)((z.w + 31) / 32 * 4), 0, 0});
+}
+
+static void BM_BmpBlitLayout(benchmark::State& state) {
+    const ZonePayload& z = zonePayloads[state.range(0)];
+    const LayoutZone& l = zoneLayouts[state.range(0)];
+    state.SetLabel(z.id);
+    AllocScope allocs(state, 0, (int64_t)z.w * z.h);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(layoutBlitBmp(framebuffer, screen.pitch, l, z.bmp.data(), z.bmp.size()));
+        benchmark::ClobberMemory();
+    }
+}
+
+template <bool (*Blit)(const TileSurface&, const uint8_t*, size_t, int, int)>
+static void BM_BmpBlit(benchmark::State& state) {
+    const ZonePayload& z = zonePayloads[state.range(0)];
+    int x = state.range(1) ? 20 : z.x;
+    state.SetLabel(z.id + (state.range(1) ? " x=20" : ""));
+    AllocScope allocs(state, 0, (int64_t)z.w * z.h);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Blit(screen, z.bmp.data(), z.bmp.size(), x, z.y));
+        benchmark::ClobberMemory();
+    }
+}
+
+static bool panelBlitTrmnl(const TileSurface& fb, const uint8_t* bmp, size_t len, int x, int y) {
+    return panelBlitBmp<PanelTrmnl75>(fb.fb, x, y, bmp, len);
+}
+
+// ---------------------------------------------------------------------------
+// Zone flash: a black fill (FlashRefresh) and the invert (zones-v12) over each payload zone
+
+// bbep.fillRect() on a 1-bit panel: clip and rotate, then one pixel at a time
+static void fillRectPixels(const TileSurface& fb, int x, int y, int w, int h, bool white) {
+    for (int yy = y < 0 ? 0 : y; yy < y + h && yy < fb.height; yy++)
+        for (int xx = x < 0 ? 0 : x; xx < x + w && xx < fb.width; xx++) {
+            uint8_t bit = 0x80 >> (xx & 7);
+            uint8_t& b = fb.fb[yy * fb.pitch + xx / 8];
+            b = white ? b | bit : b & ~bit;
+        }
+}
+
+// The flash's invert the same way: one pixel at a time
+static void invertRectPixels(const TileSurface& fb, int x, int y, int w, int h) {
+    for (int yy = y < 0 ? 0 : y; yy < y + h && yy < fb.height; yy++)
+        for (int xx = x < 0 ? 0 : x; xx < x + w && xx < fb.width; xx++) fb.fb[yy * fb.pitch + xx / 8] ^= 0x80 >> (xx & 7);
+}
+
+static void BM_Flash(benchmark::State& state) {
+    const ZonePayload& z = zonePayloads[state.range(0)];
+    int kind = (int)state.range(1);
+    static const char* const kinds[] = {"pixels", "panel", "pixels", "panel"};
+    state.SetLabel(z.id + " " + kinds[kind]);
+    AllocScope allocs(state, 0, (int64_t)z.w * z.h);
+    bool white = false;
+    for (auto _ : state) {
+        switch (kind) {
+            case 0: fillRectPixels(screen, z.x, z.y, z.w, z.h, white); break;
+            case 1: panelFill<PanelTrmnl75>(framebuffer, z.x, z.y, z.w, z.h, white); break;
+            case 2: invertRectPixels(screen, z.x, z.y, z.w, z.h); break;
+            default: panelInvert<PanelTrmnl75>(framebuffer, z.x, z.y, z.w, z.h); break;
+        }
+        white = !white;
+        benchmark::ClobberMemory();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Page switch: every payload zone drawn, then packed (leaving the dashboard) and unpacked (showing a page)
+
+static PageCache pageCache;
+
+static void BM_PageSwitch(benchmark::State& state) {
+    std::vector<uint8_t> fb(framebuffer, framebuffer + sizeof(framebuffer));
+    AllocScope allocs(state, sizeof(framebuffer));
+    for (auto _ : state) {
+        if (state.range(0)) benchmark::DoNotOptimize(pageCache.show(0, fb.data()));
+        else benchmark::DoNotOptimize(pageCache.store(0, framebuffer));
+        benchmark::ClobberMemory();
+    }
+    state.SetLabel(std::to_string(pageCache.bytes(0)) + " bytes packed");
+}
+
+// ---------------------------------------------------------------------------
+// The JSON paths, through ArduinoJson's allocator so its pool shows up too
+
+#if BENCH_ARDUINOJSON
+
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t n) override { allocCount++; allocBytes += n; return malloc(n); }
+    void deallocate(void* p) override { free(p); }
+    void* reallocate(void* p, size_t n) override { allocCount++; allocBytes += n; return realloc(p, n); }
+};
+static CountingAllocator jsonAllocator;
+
+// ZoneJsonDecoder::fetch() (firmware_core.hpp), from deserializeJson to the last zone BMP decoded, and the
+// release() after the draw
+#define MAX_ZONES 6
+#define ZONE_ID_MAX_LEN 32
+#define ZONE_BMP_MAX_LEN 20000
+
+struct Zone { char id[ZONE_ID_MAX_LEN]; int x, y, w, h; bool changed; uint8_t* bmp; size_t len; };
+
+static void BM_ZoneExtract(benchmark::State& state) {
+    static Zone zones[MAX_ZONES];
+    AllocScope allocs(state, (int64_t)zonesJson.size());
+    for (auto _ : state) {
+        JsonDocument doc(&jsonAllocator);
+        if (deserializeJson(doc, zonesJson.data(), zonesJson.size())) { state.SkipWithError("zones.json doesn't parse"); break; }
+        int zoneCount = 0;
+        for (JsonObject z : doc["zones"].as<JsonArray>()) {
+            if (zoneCount >= MAX_ZONES) break;
+            Zone& zone = zones[zoneCount];
+            const char* id = z["id"] | "unknown";
+            strncpy(zone.id, id, ZONE_ID_MAX_LEN - 1);
+            zone.id[ZONE_ID_MAX_LEN - 1] = '\0';
+            zone.x = z["x"] | 0;
+            zone.y = z["y"] | 0;
+            zone.w = z["w"] | 0;
+            zone.h = z["h"] | 0;
+            zone.changed = z["changed"] | false;
+            zone.bmp = nullptr;
+            zone.len = 0;
+            const char* data = z["data"] | (const char*)nullptr;
+            if (data) {
+                size_t dataLen = strlen(data);
+                size_t size = decode_base64_length((const unsigned char*)data, dataLen);
+                if (size <= ZONE_BMP_MAX_LEN && (zone.bmp = (uint8_t*)malloc(size)))
+                    zone.len = decode_base64((const unsigned char*)data, dataLen, zone.bmp);
+            }
+            zoneCount++;
+        }
+        benchmark::DoNotOptimize(zoneCount);
+        benchmark::ClobberMemory();
+        for (int i = 0; i < zoneCount; i++) free(zones[i].bmp);
+    }
+}
+
+// drawDashboardTemplate() including walking the parsed document, and with the parse
+static void BM_DashboardRegionsJson(benchmark::State& state) {
+    JsonDocument parsed(&jsonAllocator);
+    deserializeJson(parsed, regionsJson.data(), regionsJson.size());
+    state.SetLabel(state.range(0) ? "parse+dispatch" : "dispatch");
+    AllocScope allocs(state, 0, (int64_t)regionPayloads.size());
+    for (auto _ : state) {
+        JsonDocument fresh(&jsonAllocator);
+        if (state.range(0)) deserializeJson(fresh, regionsJson.data(), regionsJson.size());
+        JsonDocument& doc = state.range(0) ? fresh : parsed;
+        DashboardText t = {};
+        for (JsonObject region : doc["regions"].as<JsonArray>()) dashboardRegion(t, region["id"] | "", region["text"] | "");
+        benchmark::DoNotOptimize(t);
+    }
+}
+
+#endif // BENCH_ARDUINOJSON
+
+static void zoneArgs(benchmark::internal::Benchmark* b) {
+    for (size_t i = 0; i < zonePayloads.size(); i++) b->Arg((int64_t)i);
+}
+
+static void blitArgs(benchmark::internal::Benchmark* b) {
+    for (size_t i = 0; i < zonePayloads.size(); i++) b->Args({(int64_t)i, 0})->Args({(int64_t)i, 1});
+}
+
+template <int FIRST>
+static void flashArgs(benchmark::internal::Benchmark* b) {
+    for (size_t i = 0; i < zonePayloads.size(); i++) b->Args({(int64_t)i, FIRST})->Args({(int64_t)i, FIRST + 1});
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    loadPayloads();
+    makeZoneLayouts();
+
+    // The two blits must agree before their times mean anything
+    std::vector<uint8_t> reference(sizeof(framebuffer), 0x5A);
+    const TileSurface ref = { reference.data(), screen.pitch, screen.width, screen.height };
+    memset(framebuffer, 0x5A, sizeof(framebuffer));
+    for (const ZonePayload& z : zonePayloads) {
+        for (int x : {z.x, 20, 3}) {
+            if (!bmpBlitPixels(ref, z.bmp.data(), z.bmp.size(), x, z.y) || !bmpBlitRows(screen, z.bmp.data(), z.bmp.size(), x, z.y)
+                || memcmp(reference.data(), framebuffer, sizeof(framebuffer)) != 0) {
+                fprintf(stderr, "bench-hotpaths: bmpBlitRows differs from bmpBlitPixels for %s at x=%d\n", z.id.c_str(), x);
+                return 1;
+            }
+            invertRectPixels(screen, x, z.y, z.w, z.h);    // so the panel blit has every pixel to put back
+            if (!panelBlitTrmnl(screen, z.bmp.data(), z.bmp.size(), x, z.y) || memcmp(reference.data(), framebuffer, sizeof(framebuffer)) != 0) {
+                fprintf(stderr, "bench-hotpaths: panelBlitBmp differs from bmpBlitPixels for %s at x=%d\n", z.id.c_str(), x);
+                return 1;
+            }
+            fillRectPixels(ref, x, z.y, z.w, z.h, false);
+            panelFill<PanelTrmnl75>(framebuffer, x, z.y, z.w, z.h, false);
+            invertRectPixels(ref, x + 1, z.y + 1, z.w - 2, z.h - 2);
+            panelInvert<PanelTrmnl75>(framebuffer, x + 1, z.y + 1, z.w - 2, z.h - 2);
+            if (memcmp(reference.data(), framebuffer, sizeof(framebuffer)) != 0) {
+                fprintf(stderr, "bench-hotpaths: panelFill/panelInvert differ from the per-pixel flash for %s at x=%d\n", z.id.c_str(), x);
+                return 1;
+            }
+        }
+    }
+    for (size_t i = 0; i < zonePayloads.size(); i++) {
+        const ZonePayload& z = zonePayloads[i];
+        if (!bmpBlitPixels(ref, z.bmp.data(), z.bmp.size(), z.x, z.y) || !layoutBlitBmp(framebuffer, screen.pitch, zoneLayouts[i], z.bmp.data(), z.bmp.size())
+            || memcmp(reference.data(), framebuffer, sizeof(framebuffer)) != 0) {
+            fprintf(stderr, "bench-hotpaths: layoutBlitBmp differs from bmpBlitPixels for %s\n", z.id.c_str());
+            return 1;
+        }
+    }
+    memset(framebuffer, 0xFF, sizeof(framebuffer));
+    for (size_t i = 0; i < zonePayloads.size(); i++) {
+        const ZonePayload& z = zonePayloads[i];
+        layoutBlitBmp(framebuffer, screen.pitch, zoneLayouts[i], z.bmp.data(), z.bmp.size());
+    }
+    std::vector<uint8_t> shown(sizeof(framebuffer));
+    // A slot for the worst case, so a dense capture is timed rather than refused
+    if (!pageCache.begin(ZONE_CANVAS_W, ZONE_CANVAS_H, PAGE_HEADER_SIZE + sizeof(framebuffer) + sizeof(framebuffer) / 128 + 1) || !pageCache.store(0, framebuffer) || !pageCache.show(0, shown.data())
+        || memcmp(shown.data(), framebuffer, sizeof(framebuffer)) != 0) {
+        fprintf(stderr, "bench-hotpaths: the dashboard doesn't round trip through a page slot\n");
+        return 1;
+    }
+
+    // Registered after loading so the per-zone arguments match the payloads
+    benchmark::RegisterBenchmark("decode_base64", BM_DecodeBase64)->Apply(zoneArgs);
+    benchmark::RegisterBenchmark("decode_base64_length", BM_DecodeBase64Length)->Apply(zoneArgs);
+    benchmark::RegisterBenchmark("parseZoneList", BM_ParseZoneList)->Arg(0)->Arg(1);
+    benchmark::RegisterBenchmark("dashboardRegions", BM_DashboardRegions);
+    benchmark::RegisterBenchmark("bmpBlit/pixels", BM_BmpBlit<bmpBlitPixels>)->Apply(blitArgs);
+    benchmark::RegisterBenchmark("bmpBlit/rows", BM_BmpBlit<bmpBlitRows>)->Apply(blitArgs);
+    benchmark::RegisterBenchmark("bmpBlit/layout", BM_BmpBlitLayout)->Apply(zoneArgs);
+    benchmark::RegisterBenchmark("bmpBlit/panel", BM_BmpBlit<panelBlitTrmnl>)->Apply(blitArgs);
+    benchmark::RegisterBenchmark("fillRect", BM_Flash)->Apply(flashArgs<0>);
+    benchmark::RegisterBenchmark("invertRect", BM_Flash)->Apply(flashArgs<2>);
+    benchmark::RegisterBenchmark("pageSwitch/pack", BM_PageSwitch)->Arg(0);
+    benchmark::RegisterBenchmark("pageSwitch/unpack", BM_PageSwitch)->Arg(1);
+#if BENCH_ARDUINOJSON
+    benchmark::RegisterBenchmark("zoneExtract", BM_ZoneExtract);
+    benchmark::RegisterBenchmark("dashboardRegions/json", BM_DashboardRegionsJson)->Arg(0)->Arg(1);
+#endif
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
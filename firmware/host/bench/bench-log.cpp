@@ -0,0 +1,81 @@
+/**
+ * Cycle time per log configuration
+ *
+ * Runs the same update cycle (log-cycle.cpp) built at each log level, both
+ * as immediate printf logging and as deferred binary records, and reports
+ * CPU time per cycle, the bytes each cycle puts on the UART, and what those
+ * bytes cost at 115200 baud (86.8us each; the ESP32 core blocks in
+ * Serial.printf once the 128-byte TX FIFO is full). Deferred variants pay
+ * for the UART in logDrain(), while the loop would otherwise be asleep,
+ * so that cost is listed separately.
+ *
+ * Usage: ./bench-log [cycles]
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "log_sink.hpp"
+#define LOG_OUTPUT logSink()
+#include "trmnl_log.hpp"
+#include "zone_tiles.hpp"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+typedef uint32_t (*CycleFn)(const TileSurface&, const char*, size_t, uint32_t);
+
+#define DECLARE_CYCLE(name) uint32_t name(const TileSurface&, const char*, size_t, uint32_t);
+DECLARE_CYCLE(cycleNone)
+DECLARE_CYCLE(cycleErrorDeferred)
+DECLARE_CYCLE(cycleInfoImmediate)
+DECLARE_CYCLE(cycleInfoDeferred)
+DECLARE_CYCLE(cycleVerboseImmediate)
+DECLARE_CYCLE(cycleVerboseDeferred)
+
+struct Variant { const char* name; CycleFn fn; bool deferred; };
+
+static const double UART_US_PER_BYTE = 10.0 / 115200 * 1e6;
+static const size_t UART_FIFO = 128;
+
+int main(int argc, char** argv) {
+    int cycles = argc > 1 ? atoi(argv[1]) : 20000;
+    std::vector<uint8_t> fb(100 * 480);
+    for (size_t i = 0; i < fb.size(); i++) fb[i] = (uint8_t)(i * 2654435761u >> 24);
+    TileSurface screen = {fb.data(), 100, 800, 480};
+    static const char payload[] = "time,trains,trams,coffee";
+
+    const Variant variants[] = {
+        {"none", cycleNone, true},
+        {"error/deferred", cycleErrorDeferred, true},
+        {"info/immediate", cycleInfoImmediate, false},
+        {"info/deferred", cycleInfoDeferred, true},
+        {"verbose/immediate", cycleVerboseImmediate, false},
+        {"verbose/deferred", cycleVerboseDeferred, true},
+    };
+
+    printf("%-18s %10s %10s %14s %12s %12s\n", "config", "cpu ns", "uart B", "uart block us", "drain ns", "drain B");
+    uint32_t sink = 0;
+    for (const Variant& v : variants) {
+        logRing().clear();
+        logSink().bytes = 0;
+        size_t drained = 0;
+        double hotNs = 0, drainNs = 0;
+        for (int c = 0; c < cycles; c++) {
+            auto t0 = std::chrono::steady_clock::now();
+            sink += v.fn(screen, payload, sizeof(payload) - 1, c);
+            auto t1 = std::chrono::steady_clock::now();
+            drained += logDrain(logSink(), 64);
+            auto t2 = std::chrono::steady_clock::now();
+            hotNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+            drainNs += std::chrono::duration<double, std::nano>(t2 - t1).count();
+        }
+        double uartBytes = v.deferred ? 0 : (double)logSink().bytes / cycles;
+        double blockUs = uartBytes > UART_FIFO ? (uartBytes - UART_FIFO) * UART_US_PER_BYTE : 0;
+        printf("%-18s %10.0f %10.0f %14.0f %12.0f %12.0f\n", v.name, hotNs / cycles, uartBytes, blockUs,
+               drainNs / cycles, (double)drained / cycles);
+    }
+    return sink == 42 ? 1 : 0;   // keep the cycles from being optimised away
+}
@@ -0,0 +1,91 @@
+/**
+ * 1-bit BMP to framebuffer blit, as the firmware draws a zone
+ *
+ * bb_epaper isn't available on the host, so this models what
+ * bbep.loadBMP() does for the server's zone BMPs (canvasToBMP(): 1bpp,
+ * top-down, rows padded to 4 bytes, palette index 0 black): validate the
+ * header, then test each source bit and set or clear the matching
+ * framebuffer pixel. bmpBlitRows() is the byte-shifting alternative, for
+ * comparison; both produce the same framebuffer.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef BMP_BLIT_HPP
+#define BMP_BLIT_HPP
+
+#include "zone_tiles.hpp"
+
+#include <stdint.h>
+#include <string.h>
+
+struct BmpInfo {
+    const uint8_t* bits;
+    int w, h, stride;
+    bool topDown;
+};
+
+static inline uint32_t bmpU32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+static inline bool bmpParse(const uint8_t* bmp, size_t len, BmpInfo& info) {
+    if (len < 62 || bmp[0] != 'B' || bmp[1] != 'M') return false;
+    uint32_t off = bmpU32(bmp + 10);
+    int32_t w = (int32_t)bmpU32(bmp + 18), h = (int32_t)bmpU32(bmp + 22);
+    if ((bmp[28] | bmp[29] << 8) != 1 || w <= 0 || h == 0) return false;
+    info.topDown = h < 0;
+    info.w = w;
+    info.h = h < 0 ? -h : h;
+    info.stride = (w + 31) / 32 * 4;
+    if (off > len || (size_t)info.stride * info.h > len - off) return false;
+    info.bits = bmp + off;
+    return true;
+}
+
+static inline const uint8_t* bmpRow(const BmpInfo& info, int y) {
+    return info.bits + (size_t)(info.topDown ? y : info.h - 1 - y) * info.stride;
+}
+
+/** Per pixel, the way the display driver does it. Returns false on a bad header. */
+static inline bool bmpBlitPixels(const TileSurface& fb, const uint8_t* bmp, size_t len, int x0, int y0) {
+    BmpInfo info;
+    if (!bmpParse(bmp, len, info)) return false;
+    for (int y = 0; y < info.h && y0 + y < fb.height; y++) {
+        const uint8_t* src = bmpRow(info, y);
+        uint8_t* dst = fb.fb + (y0 + y) * fb.pitch;
+        for (int x = 0; x < info.w && x0 + x < fb.width; x++) {
+            int px = x0 + x;
+            if (src[x >> 3] & (0x80 >> (x & 7))) dst[px >> 3] |= 0x80 >> (px & 7);
+            else dst[px >> 3] &= ~(0x80 >> (px & 7));
+        }
+    }
+    return true;
+}
+
+/** A byte at a time, shifting when x0 isn't byte aligned. */
+static inline bool bmpBlitRows(const TileSurface& fb, const uint8_t* bmp, size_t len, int x0, int y0) {
+    BmpInfo info;
+    if (!bmpParse(bmp, len, info)) return false;
+    int w = info.w < fb.width - x0 ? info.w : fb.width - x0;
+    int shift = x0 & 7, bytes = (w + 7) / 8;
+    uint8_t lastMask = (uint8_t)(0xFF << (bytes * 8 - w));
+    for (int y = 0; y < info.h && y0 + y < fb.height; y++) {
+        const uint8_t* src = bmpRow(info, y);
+        uint8_t* dst = fb.fb + (y0 + y) * fb.pitch + x0 / 8;
+        if (shift == 0) {
+            memcpy(dst, src, bytes - 1);
+            dst[bytes - 1] = (dst[bytes - 1] & ~lastMask) | (src[bytes - 1] & lastMask);
+            continue;
+        }
+        // Spread each source byte over two destination bytes
+        for (int i = 0; i < bytes; i++) {
+            uint8_t m = i == bytes - 1 ? lastMask : 0xFF;
+            uint8_t s = src[i] & m, spill = (uint8_t)(m << (8 - shift));
+            dst[i] = (dst[i] & ~(m >> shift)) | (s >> shift);
+            if (spill) dst[i + 1] = (dst[i + 1] & ~spill) | (uint8_t)(s << (8 - shift));
+        }
+    }
+    return true;
+}
+
+#endif // BMP_BLIT_HPP
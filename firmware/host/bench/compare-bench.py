@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Compare two bench-hotpaths runs (Google Benchmark --benchmark_out JSON)
+
+Prints ns/op and heap bytes/op for every benchmark in both runs, with the
+change. A benchmark regresses when it's more than --threshold percent
+slower, or when it allocates more per op than before; either makes the
+exit status 1, so it can gate a change. With --benchmark_repetitions the
+median is compared.
+
+Usage: ./compare-bench.py baseline.json run.json [--threshold 10]
+       ./compare-bench.py --update baseline.json run.json   (accept run.json as the new baseline)
+
+Copyright (c) 2026 Angus Bergman
+Licensed under CC BY-NC 4.0
+"""
+
+import argparse
+import json
+import shutil
+import sys
+
+UNIT_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as f:
+        doc = json.load(f)
+    runs = {}
+    medians = {}
+    for b in doc.get("benchmarks", []):
+        if b.get("error_occurred"):
+            continue
+        entry = {
+            "ns": b["real_time"] * UNIT_NS[b.get("time_unit", "ns")],
+            "bytes": b.get("alloc_bytes"),
+            "allocs": b.get("allocs"),
+            "label": b.get("label", ""),
+        }
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") == "median":
+                medians[b["run_name"]] = entry
+        else:
+            runs.setdefault(b.get("run_name", b["name"]), entry)
+    runs.update(medians)
+    return doc.get("context", {}), runs
+
+
+def fmt_ns(ns):
+    if ns >= 1e6:
+        return f"{ns / 1e6:.2f}ms"
+    if ns >= 1e3:
+        return f"{ns / 1e3:.2f}us"
+    return f"{ns:.1f}ns"
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Compare two bench-hotpaths JSON results")
+    ap.add_argument("baseline")
+    ap.add_argument("run")
+    ap.add_argument("--threshold", type=float, default=10.0, help="percent slower that counts as a regression")
+    ap.add_argument("--update", action="store_true", help="copy run over baseline after printing the comparison")
+    args = ap.parse_args()
+
+    base_ctx, base = load(args.baseline)
+    run_ctx, run = load(args.run)
+    if base_ctx.get("host_name") != run_ctx.get("host_name") or base_ctx.get("num_cpus") != run_ctx.get("num_cpus"):
+        print(f"note: baseline is from {base_ctx.get('host_name', '?')}, run from {run_ctx.get('host_name', '?')}; "
+              "times only compare on the same machine, allocations anywhere\n")
+
+    regressions = 0
+    print(f"{'benchmark':<34} {'label':<16} {'base':>10} {'run':>10} {'change':>8} {'B/op':>14} {'allocs/op':>12}")
+    for name in sorted(set(base) | set(run), key=lambda n: (n not in base, n)):
+        b, r = base.get(name), run.get(name)
+        if not b or not r:
+            print(f"{name:<34} {(b or r)['label']:<16} {'only in ' + ('baseline' if b else 'run'):>30}")
+            continue
+        change = (r["ns"] - b["ns"]) / b["ns"] * 100 if b["ns"] else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  SLOWER"
+        bytes_col = allocs_col = "-"
+        if b["bytes"] is not None and r["bytes"] is not None:
+            bytes_col = f"{b['bytes']:.0f}->{r['bytes']:.0f}"
+            allocs_col = f"{b['allocs']:.1f}->{r['allocs']:.1f}"
+            # Fractions come from one-off allocations spread over iterations
+            if r["bytes"] > b["bytes"] + 0.5 or r["allocs"] > b["allocs"] + 0.5:
+                flag += "  ALLOCATES"
+        regressions += bool(flag)
+        print(f"{name:<34} {r['label']:<16} {fmt_ns(b['ns']):>10} {fmt_ns(r['ns']):>10} {change:>+7.1f}% "
+              f"{bytes_col:>14} {allocs_col:>12}{flag}")
+
+    print(f"\n{regressions} regression(s) at {args.threshold:g}%")
+    if args.update:
+        shutil.copyfile(args.run, args.baseline)
+        print(f"{args.baseline} updated")
+        return 0
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
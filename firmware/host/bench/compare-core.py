@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+Compare two builds of the policy core from their serial captures
+
+Every poll of src/main.cpp (include/firmware_core.hpp) prints one "Cycle"
+line with the same key=value fields whatever its transport, decoder and
+refresh policy. This reads those lines from two captures - say
+core-zones and core-zones-keepalive, flashed on two devices and left
+running over the same hours - and prints, per build, the share of polls
+that failed and mean, p50 and p95 of the fetch, draw and refresh times,
+bytes and requests per poll, with the change in mean. Heap is the lowest
+free heap, low-water mark and largest block seen.
+
+A build regresses when a time's mean is more than --threshold percent
+slower, or its lowest free heap or largest block is that much smaller;
+any regression makes the exit status 1. Only polls that succeeded count
+towards the times.
+
+Usage: ./compare-core.py before.log after.log [--threshold 10]
+
+Copyright (c) 2026 Angus Bergman
+Licensed under CC BY-NC 4.0
+"""
+
+import argparse
+import sys
+
+TIMES = ("fetch", "draw", "refresh")
+SIZES = ("bytes", "req")
+HEAP = ("heap", "min", "block")
+
+
+def load(path):
+    polls = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            at = line.find("Cycle ")
+            if at < 0:
+                continue
+            fields = dict(kv.split("=", 1) for kv in line[at:].split()[2:] if "=" in kv)
+            try:
+                polls.append({k: (v if k == "core" else int(v.rstrip("ms"))) for k, v in fields.items()})
+            except ValueError:
+                continue
+    if not polls:
+        sys.exit(f"{path}: no Cycle lines (is it a capture of src/main.cpp?)")
+    return polls
+
+
+def quantile(xs, q):
+    xs = sorted(xs)
+    return xs[min(len(xs) - 1, int(q * len(xs)))] if xs else 0
+
+
+def stats(polls):
+    ok = [p for p in polls if p.get("ok")]
+    out = {"polls": len(polls), "failed": len(polls) - len(ok), "core": polls[-1].get("core", "?")}
+    for key in TIMES + SIZES:
+        xs = [p[key] for p in ok if key in p]
+        out[key] = {"mean": sum(xs) / len(xs) if xs else 0.0, "p50": quantile(xs, 0.5), "p95": quantile(xs, 0.95)}
+    for key in HEAP:
+        out[key] = min(p[key] for p in polls if key in p) if any(key in p for p in polls) else 0
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Compare the Cycle lines of two policy core captures")
+    ap.add_argument("before")
+    ap.add_argument("after")
+    ap.add_argument("--threshold", type=float, default=10.0, help="percent slower (mean) or less heap that counts as a regression")
+    args = ap.parse_args()
+
+    a, b = stats(load(args.before)), stats(load(args.after))
+    print(f"before: {a['core']}, {a['polls']} polls ({a['failed']} failed)")
+    print(f"after:  {b['core']}, {b['polls']} polls ({b['failed']} failed)\n")
+
+    regressions = 0
+    print(f"{'per poll':<10} {'mean':>22} {'change':>8} {'p50':>16} {'p95':>16}")
+    for key in TIMES + SIZES:
+        x, y = a[key], b[key]
+        change = (y["mean"] - x["mean"]) / x["mean"] * 100 if x["mean"] else 0.0
+        flag = "  SLOWER" if key in TIMES and change > args.threshold else ""
+        regressions += bool(flag)
+        unit = " ms" if key in TIMES else ""
+        print(f"{key + unit:<10} {x['mean']:>10.0f}->{y['mean']:<10.0f} {change:>+7.1f}% "
+              f"{x['p50']:>7}->{y['p50']:<7} {x['p95']:>7}->{y['p95']:<7}{flag}")
+
+    print(f"\n{'lowest':<10} {'bytes':>22} {'change':>8}")
+    for key in HEAP:
+        x, y = a[key], b[key]
+        change = (y - x) / x * 100 if x else 0.0
+        flag = "  LESS" if change < -args.threshold else ""
+        regressions += bool(flag)
+        print(f"{key:<10} {x:>10}->{y:<10} {change:>+7.1f}%{flag}")
+
+    print(f"\n{regressions} regression(s) at {args.threshold:g}%")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
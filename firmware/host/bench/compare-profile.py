@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+Compare stage profiles from two serial captures (include/profile.hpp)
+
+Takes the last "#P" line of each capture, so a build flashed with
+PROFILE_ENABLED=1 (pio run -e trmnl-profile) and left running for a few
+dumps gives its totals since boot. Prints samples, mean and the p50/p99
+bucket bounds in microseconds for every stage, with the change in mean.
+A stage regresses when its mean is more than --threshold percent slower;
+any regression makes the exit status 1. The p50/p99 bounds are the top
+of a log2 bucket, so they move in factors of two.
+
+Usage: ./compare-profile.py before.log after.log [--threshold 10]
+
+Copyright (c) 2026 Angus Bergman
+Licensed under CC BY-NC 4.0
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    last = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            at = line.find("#P ")
+            if at >= 0:
+                last = line[at + 3:].strip()
+    if last is None:
+        sys.exit(f"{path}: no #P line (was it built with PROFILE_ENABLED=1?)")
+    return json.loads(last)
+
+
+def below(log2, count, mx, q):
+    rank = max(1, int(q * count + 0.999999))
+    seen = 0
+    for b, n in enumerate(log2):
+        seen += n
+        if seen >= rank:
+            return min((2 << b) - 1, mx) if b < len(log2) - 1 else mx
+    return mx
+
+
+def stats(doc):
+    us = 1e6 / doc["hz"]
+    out = {}
+    for name, s in doc["stages"].items():
+        n = s["n"]
+        out[name] = {
+            "n": n,
+            "mean": s["sum"] / n * us if n else 0.0,
+            "p50": below(s["log2"], n, s["max"], 0.5) * us,
+            "p99": below(s["log2"], n, s["max"], 0.99) * us,
+            "max": s["max"] * us,
+        }
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Compare the last #P profile line of two serial captures")
+    ap.add_argument("before")
+    ap.add_argument("after")
+    ap.add_argument("--threshold", type=float, default=10.0, help="percent slower (mean) that counts as a regression")
+    args = ap.parse_args()
+
+    a_doc, b_doc = load(args.before), load(args.after)
+    a, b = stats(a_doc), stats(b_doc)
+    print(f"before: {a_doc.get('build') or '?'} at {a_doc['hz'] / 1e6:.0f} MHz, after: {b_doc.get('build') or '?'} at {b_doc['hz'] / 1e6:.0f} MHz\n")
+
+    regressions = 0
+    print(f"{'stage':<12} {'n':>13} {'mean us':>20} {'change':>8} {'p50 < us':>18} {'p99 < us':>18}")
+    for name in sorted(set(a) | set(b), key=lambda n: (n not in a, n)):
+        x, y = a.get(name), b.get(name)
+        if not x or not y:
+            print(f"{name:<12} {'only ' + ('before' if x else 'after'):>13}")
+            continue
+        change = (y["mean"] - x["mean"]) / x["mean"] * 100 if x["mean"] else 0.0
+        flag = "  SLOWER" if change > args.threshold else ""
+        regressions += bool(flag)
+        print(f"{name:<12} {x['n']:>6}->{y['n']:<6} {x['mean']:>9.0f}->{y['mean']:<9.0f} {change:>+7.1f}% "
+              f"{x['p50']:>8.0f}->{y['p50']:<8.0f} {x['p99']:>8.0f}->{y['p99']:<8.0f}{flag}")
+
+    print(f"\n{regressions} regression(s) at {args.threshold:g}%")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,49 @@
+/**
+ * One zones-v12 update cycle with its log calls, built once per log config
+ *
+ * bench-log compiles this file several times with different LOG_LEVEL /
+ * LOG_DEFERRED and a distinct LOG_CYCLE_FN name, so the only difference
+ * between the variants is what the preprocessor left of the log calls.
+ * The work itself (zone list parsing, tile hashing) stands in for the
+ * per-cycle CPU the firmware does regardless of logging.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "log_sink.hpp"
+#define LOG_OUTPUT logSink()
+#include "trmnl_log.hpp"
+#include "zone_protocol.hpp"
+#include "zone_tiles.hpp"
+
+static const ZoneDef ZONES[] = {
+    {"time", 20, 45, 180, 70, 1},
+    {"weather", 620, 10, 160, 95, 2},
+    {"trains", 20, 155, 370, 150, 1},
+    {"trams", 410, 155, 370, 150, 1},
+    {"coffee", 20, 315, 760, 65, 2},
+    {"footer", 0, 445, 800, 35, 3},
+};
+static const int ZONE_COUNT = sizeof(ZONES) / sizeof(ZONES[0]);
+
+uint32_t LOG_CYCLE_FN(const TileSurface& screen, const char* payload, size_t payloadLen, uint32_t cycle) {
+    bool changed[ZONE_COUNT] = {};
+    uint32_t hashes[128];
+    uint32_t acc = 0;
+
+    LOG_DEBUG("Zones: %s", payload);
+    parseZoneList(payload, payloadLen, ZONES, ZONE_COUNT, changed);
+    LOG_VERBOSE("Zones parsed");
+    for (int i = 0; i < ZONE_COUNT; i++) {
+        if (!changed[i]) continue;
+        const ZoneDef& z = ZONES[i];
+        int n = tileCount(z.w, z.h);
+        tileHashRegion(screen, z.x, z.y, z.w, z.h, hashes, 128);
+        for (int t = 0; t < n; t++) acc += hashes[t];
+        LOG_VERBOSE("Zone %s: %d,%d %dx%d", z.id, z.x, z.y, z.w, z.h);
+        LOG_DEBUG("Zone %s: %d/%d tiles, %lu bytes", z.id, n, n, (unsigned long)(n * 136));
+    }
+    LOG_INFO("Commit @%lu: %d zones, +%ldms", (unsigned long)(1760000000u + cycle * 60), ZONE_COUNT, (long)(cycle % 7));
+    return acc;
+}
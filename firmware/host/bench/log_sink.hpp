@@ -0,0 +1,33 @@
+/**
+ * Stand-in for Serial in the log benchmark: formats like the real printf
+ * and counts what would have gone down the UART
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef LOG_SINK_HPP
+#define LOG_SINK_HPP
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+struct LogSink {
+    size_t bytes = 0;
+    char last[512];
+
+    int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(last, sizeof(last), fmt, ap);
+        va_end(ap);
+        if (n > 0) bytes += n;
+        return n;
+    }
+    void print(const char* s) { bytes += strlen(s); }
+};
+
+inline LogSink& logSink() { static LogSink sink; return sink; }
+
+#endif // LOG_SINK_HPP
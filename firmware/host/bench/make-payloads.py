@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+Payload fixtures for bench-hotpaths
+
+With --server, captures what the firmware actually downloads each cycle:
+    /api/zones?force=true          zones.json   (base64 BMP per zone)
+    /api/zones?plain=1&force=true  zones.csv    (changed-zone list)
+    /api/region-updates            regions.json (dashboard template regions)
+
+Without it, writes stand-ins with the same shapes and sizes: the server's
+header/status/legs/footer zones as 1-bit top-down BMPs laid out exactly as
+canvasToBMP() in src/services/zone-renderer.js writes them, filled with
+glyph-sized blocks so the bit patterns aren't uniform.
+
+Usage: ./make-payloads.py [--server https://host] [--out payloads]
+
+Copyright (c) 2026 Angus Bergman
+Licensed under CC BY-NC 4.0
+"""
+
+import argparse
+import base64
+import json
+import os
+import struct
+import sys
+import urllib.request
+
+# src/services/zone-renderer.js ZONES
+SERVER_ZONES = [
+    ("header", 0, 0, 800, 100),
+    ("status", 0, 100, 800, 28),
+    ("legs", 0, 136, 800, 316),
+    ("footer", 0, 452, 800, 28),
+]
+
+# Region ids drawDashboardTemplate() knows, plus the ones the server sends that it doesn't
+REGIONS = [
+    ("station", "SOUTH YARRA"), ("time", "08:41"), ("leaveTime", "08:47"), ("coffee", "YES"),
+    ("station_name", "SOUTH YARRA"),
+    ("tram_route", "58"), ("tram_dest", "WEST COBURG"),
+    ("tram1_time", "3"), ("tram1_dest", "West Coburg"), ("tram1_status", ""),
+    ("tram2_time", "11"), ("tram2_dest", "West Coburg"), ("tram2_status", "DELAYED"),
+    ("train_line", "CITY LOOP"),
+    ("train1_time", "5"), ("train1_dest", "Flinders Street"), ("train1_status", ""),
+    ("train2_time", "12"), ("train2_dest", "Parliament"), ("train2_status", ""),
+    ("alert", ""), ("weather", "Partly cloudy"), ("temperature", "17"),
+]
+
+
+def bmp1(w, h, seed):
+    """1-bit BMP, negative height, palette 0=black 1=white (canvasToBMP)."""
+    row = (w + 31) // 32 * 4
+    px = bytearray(b"\xff" * (row * h))
+    for y in range(h):
+        px[y * row + (w + 7) // 8:(y + 1) * row] = bytes(row - (w + 7) // 8)
+    state = seed
+    # Text-like runs: 8-16px blocks on 20px lines
+    for line in range(4, h - 12, 20):
+        x = 16
+        while x < w - 24:
+            state = (state * 1103515245 + 12345) & 0x7FFFFFFF
+            gw = 6 + (state >> 16) % 10
+            if (state >> 8) % 5:
+                for y in range(line, min(line + 12, h)):
+                    for bx in range(x, x + gw):
+                        px[y * row + bx // 8] &= ~(0x80 >> (bx % 8)) & 0xFF
+            x += gw + 2
+    head = b"BM" + struct.pack("<IHHI", 62 + len(px), 0, 0, 62)
+    info = struct.pack("<IiiHHIIiiII", 40, w, -h, 1, 1, 0, len(px), 2835, 2835, 2, 0)
+    return head + info + struct.pack("<II", 0x00000000, 0x00FFFFFF) + bytes(px)
+
+
+def synthesize(out):
+    zones = [{"id": zid, "x": x, "y": y, "w": w, "h": h, "changed": True,
+              "data": base64.b64encode(bmp1(w, h, i + 1)).decode()}
+             for i, (zid, x, y, w, h) in enumerate(SERVER_ZONES)]
+    write(out, "zones.json", json.dumps({"timestamp": "2026-03-02T08:41:00.000Z", "zones": zones}))
+    write(out, "zones.csv", "time,trains,trams,footer")
+    write(out, "regions.json", json.dumps({"timestamp": "2026-03-02T08:41:00.000Z",
+                                           "regions": [{"id": i, "text": t} for i, t in REGIONS]}))
+
+
+def capture(server, out):
+    base = server.rstrip("/")
+    for name, path in (("zones.json", "/api/zones?force=true"),
+                       ("zones.csv", "/api/zones?plain=1&force=true"),
+                       ("regions.json", "/api/region-updates")):
+        req = urllib.request.Request(base + path, headers={"User-Agent": "PTV-TRMNL/bench"})
+        with urllib.request.urlopen(req, timeout=30) as r:
+            write(out, name, r.read().decode())
+
+
+def write(out, name, body):
+    with open(os.path.join(out, name), "w") as f:
+        f.write(body)
+    print(f"{name}: {len(body)} bytes")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("--server", help="capture from a running server instead of synthesizing")
+    ap.add_argument("--out", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "payloads"))
+    args = ap.parse_args()
+    os.makedirs(args.out, exist_ok=True)
+    if args.server:
+        capture(args.server, args.out)
+    else:
+        synthesize(args.out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,79 @@
+/**
+ * Native (Linux) stand-in for the Arduino core
+ *
+ * Just enough of the Arduino API for the portable firmware headers in
+ * ../include to build and run on the host.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+#define LOW 0
+#define HIGH 1
+
+#if NATIVE_VIRTUAL_TIME
+// The replay harness (host/replay) owns the clock: time only moves when
+// firmware waits, so hours of traffic run in seconds. yield() costs 1ms
+// so a read loop with nothing to read still reaches its timeout.
+extern uint64_t nativeVirtualUs;
+inline unsigned long millis() { return (unsigned long)(nativeVirtualUs / 1000); }
+inline unsigned long micros() { return (unsigned long)nativeVirtualUs; }
+inline void delay(unsigned long ms) { nativeVirtualUs += (uint64_t)ms * 1000; }
+inline void yield() { nativeVirtualUs += 1000; }
+#else
+inline unsigned long millis() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() { std::this_thread::yield(); }
+#endif
+
+// Serial goes to stderr; set NATIVE_QUIET=1 in the environment to silence it
+class NativeSerial {
+public:
+    void begin(unsigned long) {}
+    int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (quiet()) return 0;
+        va_list ap; va_start(ap, fmt);
+        int n = vfprintf(stderr, fmt, ap);
+        va_end(ap);
+        return n;
+    }
+    void print(const char* s) { if (!quiet()) fputs(s, stderr); }
+    void println(const char* s = "") { if (!quiet()) { fputs(s, stderr); fputc('\n', stderr); } }
+    size_t write(const uint8_t* buf, size_t n) { return quiet() ? n : fwrite(buf, 1, n, stderr); }
+private:
+    static bool quiet() { static const bool q = getenv("NATIVE_QUIET") != nullptr; return q; }
+};
+
+inline NativeSerial Serial;
+
+#include "Client.h"
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,25 @@
+/**
+ * Arduino Client interface (native build)
+ *
+ * Same shape as the core's Client.h so firmware code templated on
+ * Client runs unchanged against POSIX sockets.
+ */
+
+#ifndef NATIVE_CLIENT_H
+#define NATIVE_CLIENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Client {
+public:
+    virtual ~Client() {}
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+};
+
+#endif // NATIVE_CLIENT_H
@@ -0,0 +1,96 @@
+/**
+ * Client implementation over POSIX TCP sockets (native build)
+ *
+ * Reads never block: available() reports what the kernel has buffered,
+ * matching WiFiClient semantics closely enough for the firmware loops.
+ */
+
+#ifndef NATIVE_POSIX_CLIENT_HPP
+#define NATIVE_POSIX_CLIENT_HPP
+
+#include "Arduino.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+class PosixClient : public Client {
+public:
+    ~PosixClient() override { stop(); }
+
+    int connect(const char* host, uint16_t port) override {
+        stop();
+        char portStr[8];
+        snprintf(portStr, sizeof(portStr), "%u", port);
+        struct addrinfo hints = {}, *res = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, portStr, &hints, &res) != 0) return 0;
+        for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+            int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                _fd = fd;
+                break;
+            }
+            ::close(fd);
+        }
+        freeaddrinfo(res);
+        return _fd >= 0 ? 1 : 0;
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (_fd < 0) return 0;
+        size_t sent = 0;
+        while (sent < size) {
+            ssize_t n = ::send(_fd, buf + sent, size - sent, MSG_NOSIGNAL);
+            if (n <= 0) { if (n < 0 && errno == EINTR) continue; break; }
+            sent += (size_t)n;
+        }
+        return sent;
+    }
+
+    int available() override {
+        if (_fd < 0) return 0;
+        int n = 0;
+        if (ioctl(_fd, FIONREAD, &n) < 0) return 0;
+        return n;
+    }
+
+    int read(uint8_t* buf, size_t size) override {
+        if (_fd < 0) return -1;
+        ssize_t n = ::recv(_fd, buf, size, MSG_DONTWAIT);
+        if (n == 0) { _eof = true; return -1; }
+        return n < 0 ? -1 : (int)n;
+    }
+
+    void stop() override {
+        if (_fd >= 0) ::close(_fd);
+        _fd = -1;
+        _eof = false;
+    }
+
+    uint8_t connected() override {
+        if (_fd < 0 || _eof) return 0;
+        uint8_t b;
+        ssize_t n = ::recv(_fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n == 0) return 0;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+        return 1;
+    }
+
+    int fd() const { return _fd; }
+
+private:
+    int _fd = -1;
+    bool _eof = false;
+};
+
+#endif // NATIVE_POSIX_CLIENT_HPP
@@ -0,0 +1,78 @@
+/**
+ * Minimal loopback TCP server for native tests and tools
+ *
+ * Listens on 127.0.0.1 with an ephemeral port. Scripts drive it one
+ * connection at a time: accept, read the request head, write a reply.
+ */
+
+#ifndef NATIVE_STANDIN_SERVER_HPP
+#define NATIVE_STANDIN_SERVER_HPP
+
+#include <string>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+class StandinServer {
+public:
+    bool listen(uint16_t port = 0) {
+        _fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (_fd < 0) return false;
+        int one = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (::bind(_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(_fd, 16) < 0) { close(); return false; }
+        socklen_t len = sizeof(addr);
+        getsockname(_fd, (struct sockaddr*)&addr, &len);
+        _port = ntohs(addr.sin_port);
+        return true;
+    }
+
+    uint16_t port() const { return _port; }
+    int fd() const { return _fd; }
+
+    /** Accept one connection, or -1 after timeoutMs. */
+    int accept(int timeoutMs) {
+        struct pollfd p = { _fd, POLLIN, 0 };
+        if (::poll(&p, 1, timeoutMs) <= 0) return -1;
+        return ::accept(_fd, nullptr, nullptr);
+    }
+
+    /** Read up to the blank line ending the request head. */
+    static std::string readHead(int fd, int timeoutMs = 2000) {
+        std::string head;
+        char c;
+        while (head.find("\r\n\r\n") == std::string::npos) {
+            struct pollfd p = { fd, POLLIN, 0 };
+            if (::poll(&p, 1, timeoutMs) <= 0) break;
+            if (::recv(fd, &c, 1, 0) != 1) break;
+            head += c;
+        }
+        return head;
+    }
+
+    static bool send(int fd, const std::string& s) {
+        size_t off = 0;
+        while (off < s.size()) {
+            ssize_t n = ::send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+            if (n <= 0) { if (n < 0 && errno == EINTR) continue; return false; }
+            off += (size_t)n;
+        }
+        return true;
+    }
+
+    void close() { if (_fd >= 0) ::close(_fd); _fd = -1; }
+    ~StandinServer() { close(); }
+
+private:
+    int _fd = -1;
+    uint16_t _port = 0;
+};
+
+#endif // NATIVE_STANDIN_SERVER_HPP
@@ -0,0 +1,292 @@
+/**
+ * HTTP traces: every exchange a device made with the server, with timing
+ *
+ * trace-proxy writes them while standing between a device and the server;
+ * trace-proxy --serve and replay-cycles play them back. Text, one record
+ * per line, bodies base64:
+ *
+ *   PTVTRACE 1 <epoch ms at t=0>
+ *   > <t ms> <METHOD> <path>       request sent at t
+ *   H <Name>: <value>              request header (repeated)
+ *   B <base64>                     request body
+ *   < <status> <ms>                response, ms to its last byte
+ *   h <Name>: <value>              response header (repeated)
+ *   b <base64>                     response body, de-chunked
+ *   .
+ *   S <t ms> <status> <path>       push stream opened
+ *   D <t ms> <base64>              push stream bytes received at t
+ *   C <t ms>                       push stream closed
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef HTTP_TRACE_HPP
+#define HTTP_TRACE_HPP
+
+#include "base64.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TRACE_MAGIC "PTVTRACE"
+#define TRACE_VERSION 1
+
+struct TraceHeader { std::string name, value; };
+
+struct TraceExchange {
+    uint64_t t = 0;                 // ms after the trace started
+    std::string method, path;
+    std::vector<TraceHeader> reqHeaders;
+    std::string reqBody;
+    int status = 0;
+    uint32_t ms = 0;                // request sent to last response byte
+    std::vector<TraceHeader> respHeaders;
+    std::string body;
+
+    const char* header(const char* name) const {
+        for (const TraceHeader& h : respHeaders) if (strcasecmp(h.name.c_str(), name) == 0) return h.value.c_str();
+        return nullptr;
+    }
+};
+
+enum TraceStreamKind : uint8_t { STREAM_OPEN, STREAM_DATA, STREAM_CLOSE };
+
+struct TraceStreamEvent {
+    uint64_t t = 0;
+    TraceStreamKind kind = STREAM_DATA;
+    int status = 0;                 // STREAM_OPEN
+    std::string data;               // path for STREAM_OPEN, bytes for STREAM_DATA
+};
+
+static inline std::string traceBase64(const std::string& in) {
+    static const char* tbl = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < in.size(); i += 3) {
+        uint32_t v = (uint8_t)in[i] << 16 | (uint8_t)in[i + 1] << 8 | (uint8_t)in[i + 2];
+        out += tbl[v >> 18]; out += tbl[(v >> 12) & 63]; out += tbl[(v >> 6) & 63]; out += tbl[v & 63];
+    }
+    if (i < in.size()) {
+        uint32_t v = (uint8_t)in[i] << 16 | (i + 1 < in.size() ? (uint8_t)in[i + 1] << 8 : 0);
+        out += tbl[v >> 18]; out += tbl[(v >> 12) & 63];
+        out += i + 1 < in.size() ? tbl[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+static inline std::string traceUnbase64(const std::string& in) {
+    std::string out(decode_base64_length((const unsigned char*)in.data(), in.size()) + 3, '\0');
+    out.resize(decode_base64((const unsigned char*)in.data(), in.size(), (unsigned char*)&out[0]));
+    return out;
+}
+
+/**
+ * What a request is matched on during replay: method and path, minus the
+ * query parameters that change every cycle (at=<apply-at epoch>).
+ */
+static inline std::string traceKey(const std::string& method, const std::string& path) {
+    size_t q = path.find('?');
+    if (q == std::string::npos) return method + " " + path;
+    std::string key = method + " " + path.substr(0, q), sep = "?";
+    size_t p = q + 1;
+    while (p <= path.size()) {
+        size_t amp = path.find('&', p);
+        if (amp == std::string::npos) amp = path.size();
+        std::string param = path.substr(p, amp - p);
+        if (!param.empty() && param.compare(0, 3, "at=") != 0) { key += sep + param; sep = "&"; }
+        p = amp + 1;
+    }
+    return key;
+}
+
+class HttpTrace {
+public:
+    uint64_t startEpochMs = 0;
+    std::vector<TraceExchange> exchanges;
+    std::vector<TraceStreamEvent> stream;
+
+    uint64_t durationMs() const {
+        uint64_t end = 0;
+        for (const TraceExchange& ex : exchanges) end = std::max(end, ex.t + ex.ms);
+        if (!stream.empty()) end = std::max(end, stream.back().t);
+        return end;
+    }
+
+    bool load(const char* path, std::string& error) {
+        std::ifstream f(path, std::ios::binary);
+        if (!f) { error = std::string("can't open ") + path; return false; }
+        std::string line;
+        int version = 0;
+        unsigned long long start = 0;
+        if (!std::getline(f, line) || sscanf(line.c_str(), TRACE_MAGIC " %d %llu", &version, &start) != 2 || version != TRACE_VERSION) {
+            error = std::string(path) + ": not a version " + std::to_string(TRACE_VERSION) + " trace";
+            return false;
+        }
+        startEpochMs = start;
+        exchanges.clear();
+        stream.clear();
+        TraceExchange* ex = nullptr;
+        int lineNo = 1;
+        while (std::getline(f, line)) {
+            lineNo++;
+            if (line.empty()) continue;
+            char tag = line[0];
+            std::string rest = line.size() > 2 ? line.substr(2) : "";
+            unsigned long long t = 0;
+            bool ok = true;
+            if (tag == '>') {
+                exchanges.emplace_back();
+                ex = &exchanges.back();
+                char method[16], target[2048];
+                ok = sscanf(rest.c_str(), "%llu %15s %2047s", &t, method, target) == 3;
+                if (ok) { ex->t = t; ex->method = method; ex->path = target; }
+            } else if (tag == 'S' || tag == 'D' || tag == 'C') {
+                TraceStreamEvent ev;
+                char buf[2048] = "";
+                int n = sscanf(rest.c_str(), "%llu", &t);
+                size_t sp = rest.find(' ');
+                ev.t = t;
+                if (tag == 'S') { ev.kind = STREAM_OPEN; ok = n == 1 && sscanf(rest.c_str(), "%*u %d %2047s", &ev.status, buf) == 2; ev.data = buf; }
+                else if (tag == 'D') { ev.kind = STREAM_DATA; ok = n == 1 && sp != std::string::npos; if (ok) ev.data = traceUnbase64(rest.substr(sp + 1)); }
+                else { ev.kind = STREAM_CLOSE; ok = n == 1; }
+                if (ok) stream.push_back(ev);
+            } else if (ex && (tag == 'H' || tag == 'h')) {
+                size_t colon = rest.find(':');
+                ok = colon != std::string::npos;
+                if (ok) {
+                    TraceHeader h = { rest.substr(0, colon), rest.substr(std::min(colon + 2, rest.size())) };
+                    (tag == 'H' ? ex->reqHeaders : ex->respHeaders).push_back(h);
+                }
+            } else if (ex && tag == 'B') {
+                ex->reqBody += traceUnbase64(rest);
+            } else if (ex && tag == 'b') {
+                ex->body += traceUnbase64(rest);
+            } else if (ex && tag == '<') {
+                ok = sscanf(rest.c_str(), "%d %u", &ex->status, &ex->ms) == 2;
+            } else if (tag == '.') {
+                ex = nullptr;
+            } else {
+                ok = false;
+            }
+            if (!ok) { error = std::string(path) + ":" + std::to_string(lineNo) + ": bad record"; return false; }
+        }
+        // The proxy writes exchanges as they complete; replay wants them by start time
+        std::stable_sort(exchanges.begin(), exchanges.end(), [](const TraceExchange& a, const TraceExchange& b) { return a.t < b.t; });
+        std::stable_sort(stream.begin(), stream.end(), [](const TraceStreamEvent& a, const TraceStreamEvent& b) { return a.t < b.t; });
+        return true;
+    }
+};
+
+/** Appends records as they happen; safe to share between proxy threads. */
+class TraceWriter {
+public:
+    ~TraceWriter() { close(); }
+
+    bool open(const char* path, uint64_t startEpochMs) {
+        _f = fopen(path, "wb");
+        if (!_f) return false;
+        fprintf(_f, TRACE_MAGIC " %d %llu\n", TRACE_VERSION, (unsigned long long)startEpochMs);
+        fflush(_f);
+        return true;
+    }
+
+    void exchange(const TraceExchange& ex) {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (!_f) return;
+        fprintf(_f, "> %llu %s %s\n", (unsigned long long)ex.t, ex.method.c_str(), ex.path.c_str());
+        for (const TraceHeader& h : ex.reqHeaders) fprintf(_f, "H %s: %s\n", h.name.c_str(), h.value.c_str());
+        if (!ex.reqBody.empty()) fprintf(_f, "B %s\n", traceBase64(ex.reqBody).c_str());
+        fprintf(_f, "< %d %u\n", ex.status, ex.ms);
+        for (const TraceHeader& h : ex.respHeaders) fprintf(_f, "h %s: %s\n", h.name.c_str(), h.value.c_str());
+        if (!ex.body.empty()) fprintf(_f, "b %s\n", traceBase64(ex.body).c_str());
+        fputs(".\n", _f);
+        fflush(_f);
+    }
+
+    void streamOpen(uint64_t t, int status, const std::string& path) { line("S %llu %d %s\n", t, status, path.c_str()); }
+    void streamData(uint64_t t, const std::string& bytes) { line("D %llu %s\n", t, traceBase64(bytes).c_str()); }
+    void streamClose(uint64_t t) { line("C %llu%s\n", t, ""); }
+
+    void close() { if (_f) fclose(_f); _f = nullptr; }
+
+private:
+    void line(const char* fmt, uint64_t t, const char* a) {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_f) { fprintf(_f, fmt, (unsigned long long)t, a); fflush(_f); }
+    }
+    void line(const char* fmt, uint64_t t, int status, const char* path) {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_f) { fprintf(_f, fmt, (unsigned long long)t, status, path); fflush(_f); }
+    }
+
+    FILE* _f = nullptr;
+    std::mutex _lock;
+};
+
+/**
+ * Answers requests from a trace. A request gets the response recorded for
+ * the same key (traceKey) that was current at its time: the latest one
+ * sent at or before it, else the first. So an extra or missing request
+ * doesn't shift every later answer.
+ */
+class ReplayIndex {
+public:
+    explicit ReplayIndex(const HttpTrace& trace) : _trace(trace) {
+        for (size_t i = 0; i < trace.exchanges.size(); i++)
+            _byKey[traceKey(trace.exchanges[i].method, trace.exchanges[i].path)].push_back(i);
+    }
+
+    /** nullptr when the trace never saw this request. */
+    const TraceExchange* match(const std::string& method, const std::string& path, uint64_t t) const {
+        auto it = _byKey.find(traceKey(method, path));
+        if (it == _byKey.end()) return nullptr;
+        const std::vector<size_t>& v = it->second;
+        size_t pick = 0;
+        for (size_t lo = 0, hi = v.size(); lo < hi;) {
+            size_t mid = (lo + hi) / 2;
+            if (_trace.exchanges[v[mid]].t <= t) { pick = mid; lo = mid + 1; } else hi = mid;
+        }
+        return &_trace.exchanges[v[pick]];
+    }
+
+    bool hasStream() const {
+        for (const TraceStreamEvent& ev : _trace.stream) if (ev.kind == STREAM_OPEN) return true;
+        return false;
+    }
+
+    /** Index of the first stream event at or after t. */
+    size_t streamFrom(uint64_t t) const {
+        const std::vector<TraceStreamEvent>& s = _trace.stream;
+        return std::lower_bound(s.begin(), s.end(), t, [](const TraceStreamEvent& ev, uint64_t v) { return ev.t < v; }) - s.begin();
+    }
+
+    /** Status the stream answered with when last opened at or before t (200 if never). */
+    int streamStatus(uint64_t t) const {
+        int status = 200;
+        for (const TraceStreamEvent& ev : _trace.stream) {
+            if (ev.t > t) break;
+            if (ev.kind == STREAM_OPEN) status = ev.status;
+        }
+        return status;
+    }
+
+    const HttpTrace& trace() const { return _trace; }
+
+private:
+    const HttpTrace& _trace;
+    std::map<std::string, std::vector<size_t>> _byKey;
+};
+
+#endif // HTTP_TRACE_HPP
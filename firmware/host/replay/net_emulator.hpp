@@ -0,0 +1,272 @@
+/**
+ * Scripted network faults on a virtual clock
+ *
+ * A NetEmulator stands between the firmware's requests and whatever
+ * answers them (the replayed trace, or the model server of outage-sim)
+ * and decides, for each one, what the network did to it: how long the
+ * round trips took, whether the lookup, the connection or the TLS
+ * handshake failed, whether the request was lost and timed out, and
+ * whether the server was up to answer. Nothing sleeps: every outcome
+ * comes with the milliseconds it cost, which the caller spends on its
+ * own clock. The same script and seed give the same outcomes.
+ *
+ * A script is one window per line, times from the start of the run
+ * (ms, or with an s, m or h suffix; * for the end of time), then the
+ * conditions that hold inside it:
+ *
+ *   # from  to    conditions
+ *   0       *     rtt=40 jitter=15 kbps=2000
+ *   10m     15m   loss=1             # the uplink is gone
+ *   15m     16m   status=503         # back, but the server is shedding
+ *   20m     21m   dns=fail
+ *   30m     31m   tls=fail loss=0.3 refuse
+ *
+ *   rtt=MS jitter=MS   each round trip, give or take the jitter
+ *   loss=P             chance the connect, and then the request, is never answered (it times out)
+ *   kbps=N             response bandwidth (0: unlimited)
+ *   dns=fail|ok        lookups get no answer
+ *   tls=fail|ok        the handshake is refused
+ *   refuse             the server's port is closed
+ *   status=N           the server answers every request with N
+ *
+ * Windows may overlap: each sets only the conditions it names, over
+ * whatever the windows before it (in script order) set.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef NET_EMULATOR_HPP
+#define NET_EMULATOR_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// A lookup nobody answers, as lwIP's resolver gives up on it
+#ifndef NET_EMU_DNS_TIMEOUT_MS
+#define NET_EMU_DNS_TIMEOUT_MS 5000
+#endif
+
+// How long a lost request is waited for when the caller set no timeout (HTTPClient's default)
+#ifndef NET_EMU_TIMEOUT_MS
+#define NET_EMU_TIMEOUT_MS 5000
+#endif
+
+enum NetFault : uint8_t { NET_FAULT_NONE, NET_FAULT_DNS, NET_FAULT_REFUSED, NET_FAULT_TLS, NET_FAULT_LOST, NET_FAULT_COUNT };
+static const char* const NET_FAULT_NAMES[] = {"ok", "dns", "refused", "tls", "lost"};
+
+/** xorshift64*: the same faults for the same seed. */
+class NetRandom {
+public:
+    explicit NetRandom(uint64_t seed = 1) : _s(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+    uint64_t next() {
+        _s ^= _s >> 12; _s ^= _s << 25; _s ^= _s >> 27;
+        return _s * 0x2545F4914F6CDD1Dull;
+    }
+    /** Uniform in [0, n). */
+    uint32_t below(uint32_t n) { return n ? (uint32_t)(next() >> 32) % n : 0; }
+    /** Uniform in [0, 1). */
+    double unit() { return (double)(next() >> 11) / 9007199254740992.0; }
+
+private:
+    uint64_t _s;
+};
+
+// Which conditions a window sets
+enum NetSets : uint16_t {
+    NET_SETS_RTT = 1, NET_SETS_JITTER = 2, NET_SETS_LOSS = 4, NET_SETS_KBPS = 8,
+    NET_SETS_DNS = 16, NET_SETS_TLS = 32, NET_SETS_REFUSE = 64, NET_SETS_STATUS = 128,
+};
+
+struct NetConditions {
+    uint32_t rttMs = 0, jitterMs = 0;
+    double loss = 0;
+    uint32_t kbps = 0;
+    bool dnsFails = false, tlsFails = false, refused = false;
+    int status = 0;                 // 0: the server answers for itself
+
+    /** Anything here that keeps a request from getting its answer. */
+    bool faulty() const { return loss > 0 || dnsFails || tlsFails || refused || status >= 400; }
+};
+
+struct NetWindow {
+    uint64_t fromMs = 0, toMs = UINT64_MAX;     // [from, to)
+    uint16_t sets = 0;
+    NetConditions c;
+};
+
+/** What the network did to one request, and what it cost. */
+struct NetAttempt {
+    NetFault fault = NET_FAULT_NONE;
+    uint32_t ms = 0;                // time spent before the answer (or the failure)
+    int status = 0;                 // the server's forced answer, 0 if it answers for itself
+};
+
+/** "90", "250ms", "90s", "5m", "1h", "*". False if it isn't one. */
+static inline bool netParseTime(const std::string& s, uint64_t& ms) {
+    if (s == "*") { ms = UINT64_MAX; return true; }
+    char* end = nullptr;
+    double v = strtod(s.c_str(), &end);
+    if (end == s.c_str() || v < 0) return false;
+    std::string unit(end);
+    double scale = unit.empty() || unit == "ms" ? 1 : unit == "s" ? 1000 : unit == "m" ? 60000 : unit == "h" ? 3600000 : -1;
+    if (scale < 0) return false;
+    ms = (uint64_t)(v * scale + 0.5);
+    return true;
+}
+
+class NetEmulator {
+public:
+    explicit NetEmulator(uint64_t seed = 1) : _rng(seed) {}
+
+    void add(const NetWindow& w) { _windows.push_back(w); }
+    const std::vector<NetWindow>& windows() const { return _windows; }
+
+    /** Windows from script text (see above). On a bad line, error says which. */
+    bool parse(const std::string& script, std::string& error) {
+        std::istringstream in(script);
+        std::string line;
+        for (int n = 1; std::getline(in, line); n++) {
+            size_t hash = line.find('#');
+            if (hash != std::string::npos) line.resize(hash);
+            std::istringstream words(line);
+            std::string from, to, word;
+            if (!(words >> from)) continue;
+            NetWindow w;
+            bool ok = (words >> to) && netParseTime(from, w.fromMs) && netParseTime(to, w.toMs) && w.toMs > w.fromMs;
+            while (ok && words >> word) ok = condition(word, w);
+            if (!ok) { error = "line " + std::to_string(n) + ": " + line; return false; }
+            _windows.push_back(w);
+        }
+        return true;
+    }
+
+    bool load(const char* path, std::string& error) {
+        std::ifstream f(path);
+        if (!f) { error = std::string("can't read ") + path; return false; }
+        std::stringstream ss;
+        ss << f.rdbuf();
+        return parse(ss.str(), error);
+    }
+
+    /** The conditions at nowMs: a clean network, then every window covering it in script order. */
+    NetConditions at(uint64_t nowMs) const {
+        NetConditions c;
+        for (const NetWindow& w : _windows) {
+            if (nowMs < w.fromMs || nowMs >= w.toMs) continue;
+            if (w.sets & NET_SETS_RTT) c.rttMs = w.c.rttMs;
+            if (w.sets & NET_SETS_JITTER) c.jitterMs = w.c.jitterMs;
+            if (w.sets & NET_SETS_LOSS) c.loss = w.c.loss;
+            if (w.sets & NET_SETS_KBPS) c.kbps = w.c.kbps;
+            if (w.sets & NET_SETS_DNS) c.dnsFails = w.c.dnsFails;
+            if (w.sets & NET_SETS_TLS) c.tlsFails = w.c.tlsFails;
+            if (w.sets & NET_SETS_REFUSE) c.refused = w.c.refused;
+            if (w.sets & NET_SETS_STATUS) c.status = w.c.status;
+        }
+        return c;
+    }
+
+    /** An open connection is cut: the link is gone or the server stopped listening. */
+    bool down(uint64_t nowMs) const {
+        NetConditions c = at(nowMs);
+        return c.loss >= 1 || c.refused;
+    }
+
+    /**
+     * First and last moment any window makes the network faulty; false if
+     * none does. Where an outage begins and ends, for recovery times.
+     */
+    bool faultSpan(uint64_t& fromMs, uint64_t& toMs) const {
+        bool any = false;
+        for (const NetWindow& w : _windows) {
+            if (!at(w.fromMs).faulty()) continue;
+            if (!any || w.fromMs < fromMs) fromMs = w.fromMs;
+            if (!any || w.toMs > toMs) toMs = w.toMs;
+            any = true;
+        }
+        return any;
+    }
+
+    /** Lookup, TCP and (tls) the handshake. timeoutMs is what a lost connect waits. */
+    NetAttempt connect(uint64_t nowMs, bool tls, uint32_t timeoutMs = NET_EMU_TIMEOUT_MS) {
+        NetConditions c = at(nowMs);
+        NetAttempt a;
+        _attempts++;
+        if (c.dnsFails) return fail(a, NET_FAULT_DNS, NET_EMU_DNS_TIMEOUT_MS);
+        if (lost(c)) return fail(a, NET_FAULT_LOST, timeoutMs);
+        a.ms = rtt(c);                                        // SYN, SYN-ACK
+        if (c.refused) return fail(a, NET_FAULT_REFUSED, a.ms);
+        if (tls) {
+            a.ms += rtt(c);                                   // ClientHello .. ServerHelloDone
+            if (c.tlsFails) return fail(a, NET_FAULT_TLS, a.ms);
+            a.ms += rtt(c);                                   // key exchange, Finished
+        }
+        return a;
+    }
+
+    /** connect(), then the request and its first answer byte. status is set if the server is forced to answer. */
+    NetAttempt request(uint64_t nowMs, bool tls, uint32_t timeoutMs = NET_EMU_TIMEOUT_MS) {
+        NetAttempt a = connect(nowMs, tls, timeoutMs);
+        if (a.fault) return a;
+        NetConditions c = at(nowMs);
+        if (lost(c)) return fail(a, NET_FAULT_LOST, a.ms + timeoutMs);
+        a.ms += rtt(c);
+        a.status = c.status;
+        return a;
+    }
+
+    /** Time bytes of response take to arrive at nowMs's bandwidth. */
+    uint32_t transfer(uint64_t nowMs, size_t bytes) const {
+        uint32_t kbps = at(nowMs).kbps;
+        return kbps ? (uint32_t)((uint64_t)bytes * 8 / kbps) : 0;
+    }
+
+    uint64_t attempts() const { return _attempts; }
+    uint64_t faults(NetFault f) const { return _faults[f]; }
+
+private:
+    bool condition(const std::string& word, NetWindow& w) {
+        size_t eq = word.find('=');
+        std::string key = word.substr(0, eq), value = eq == std::string::npos ? "" : word.substr(eq + 1);
+        uint64_t ms = 0;
+        if (key == "refuse" && eq == std::string::npos) { w.sets |= NET_SETS_REFUSE; w.c.refused = true; return true; }
+        if (eq == std::string::npos || value.empty()) return false;
+        if (key == "rtt" && netParseTime(value, ms)) { w.sets |= NET_SETS_RTT; w.c.rttMs = (uint32_t)ms; return true; }
+        if (key == "jitter" && netParseTime(value, ms)) { w.sets |= NET_SETS_JITTER; w.c.jitterMs = (uint32_t)ms; return true; }
+        if (key == "loss") { w.sets |= NET_SETS_LOSS; w.c.loss = atof(value.c_str()); return w.c.loss >= 0 && w.c.loss <= 1; }
+        if (key == "kbps") { w.sets |= NET_SETS_KBPS; w.c.kbps = (uint32_t)atoi(value.c_str()); return true; }
+        if (key == "status") { w.sets |= NET_SETS_STATUS; w.c.status = atoi(value.c_str()); return w.c.status >= 100 && w.c.status < 600; }
+        bool fails = value == "fail";
+        if (!fails && value != "ok") return false;
+        if (key == "dns") { w.sets |= NET_SETS_DNS; w.c.dnsFails = fails; return true; }
+        if (key == "tls") { w.sets |= NET_SETS_TLS; w.c.tlsFails = fails; return true; }
+        return false;
+    }
+
+    uint32_t rtt(const NetConditions& c) {
+        if (!c.jitterMs) return c.rttMs;
+        int64_t ms = (int64_t)c.rttMs + (int64_t)_rng.below(2 * c.jitterMs + 1) - (int64_t)c.jitterMs;
+        return ms > 0 ? (uint32_t)ms : 0;
+    }
+
+    bool lost(const NetConditions& c) { return c.loss >= 1 || (c.loss > 0 && _rng.unit() < c.loss); }
+
+    NetAttempt& fail(NetAttempt& a, NetFault f, uint32_t ms) {
+        a.fault = f;
+        a.ms = ms;
+        _faults[f]++;
+        return a;
+    }
+
+    std::vector<NetWindow> _windows;
+    NetRandom _rng;
+    uint64_t _attempts = 0, _faults[NET_FAULT_COUNT] = {};
+};
+
+#endif // NET_EMULATOR_HPP
@@ -0,0 +1,194 @@
+/**
+ * Replay a recorded trace through the real firmware, cycle by cycle
+ *
+ *   replay-cycles [--cycles] [--timetable image.bin] [--battery-mv mv] [--faults script] [--seed n] [--summary-out f] [--expect f] trace.txt
+ *
+ * src/zones-v12.cpp is compiled unchanged against the shims in
+ * replay/shim and linked in: setup() once, then loop() until virtual time
+ * passes the end of the trace. Every request the firmware makes is
+ * answered from the trace. Per cycle (one loop() call) it counts requests,
+ * bytes, panel refreshes, host CPU time and peak heap; --cycles prints
+ * each cycle that did anything, and the totals always follow as key=value
+ * lines.
+ *
+ * --battery-mv runs on a cell at that voltage instead of USB power, so the
+ * battery-aware cadence (include/energy_model.hpp) can be replayed.
+ *
+ * --faults puts a scripted network between the firmware and the trace
+ * (replay/net_emulator.hpp: latency, loss, refused connects, outages), so
+ * a recorded morning can be replayed through a bad one; --seed picks its
+ * dice and esp_random()'s. The totals then include net_faults.
+ *
+ * --expect compares the totals with a summary saved earlier (--summary-out)
+ * and exits 1 if any count went up: more requests, unmatched requests or
+ * refreshes than before, or more than 5% extra bytes or peak heap. CPU time
+ * is reported but never gated, it depends on the machine.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include <time.h>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+// Bytes and heap may drift this far (percent) above the expectation
+#define EXPECT_SLACK_PCT 5
+
+typedef std::map<std::string, double> Summary;
+
+static double cpuUsNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool loadSummary(const char* path, Summary& out) {
+    std::ifstream f(path);
+    if (!f) return false;
+    std::string line;
+    while (std::getline(f, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) out[line.substr(0, eq)] = atof(line.c_str() + eq + 1);
+    }
+    return true;
+}
+
+static bool loadFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static void printCycle(int n, const ReplayCycle& c) {
+    printf("cycle %4d t=%8.1fs wake=%03lx req=%d%s in=%zu out=%zu push=%zu refresh=%dp%s cpu=%.0fus heap=%zu\n",
+           n, c.startMs / 1000.0, (unsigned long)c.wake, c.requests,
+           c.unmatched ? (" (" + std::to_string(c.unmatched) + " unmatched)").c_str() : "",
+           c.bytesIn, c.bytesOut, c.streamBytes, c.partial, c.full ? "+full" : "", c.cpuUs, c.peakHeap);
+}
+
+int main(int argc, char** argv) {
+    bool perCycle = false;
+    const char *tracePath = nullptr, *summaryOut = nullptr, *expectPath = nullptr, *ttPath = nullptr, *faultsPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--cycles") perCycle = true;
+        else if (a == "--summary-out" && i + 1 < argc) summaryOut = argv[++i];
+        else if (a == "--expect" && i + 1 < argc) expectPath = argv[++i];
+        else if (a == "--timetable" && i + 1 < argc) ttPath = argv[++i];
+        else if (a == "--battery-mv" && i + 1 < argc) replayEnv.batteryMv = (uint32_t)atoi(argv[++i]);
+        else if (a == "--faults" && i + 1 < argc) faultsPath = argv[++i];
+        else if (a == "--seed" && i + 1 < argc) replayEnv.seed = strtoull(argv[++i], nullptr, 10);
+        else if (a[0] != '-' && !tracePath) tracePath = argv[i];
+        else { fprintf(stderr, "Usage: %s [--cycles] [--timetable image.bin] [--battery-mv mv] [--faults script] [--seed n] [--summary-out f] [--expect f] trace.txt\n", argv[0]); return 2; }
+    }
+    if (!tracePath) { fprintf(stderr, "Usage: %s [--cycles] [--timetable image.bin] [--battery-mv mv] [--faults script] [--seed n] [--summary-out f] [--expect f] trace.txt\n", argv[0]); return 2; }
+
+    HttpTrace trace;
+    std::string error;
+    if (!trace.load(tracePath, error)) { fprintf(stderr, "%s\n", error.c_str()); return 2; }
+    ReplayIndex index(trace);
+    replayEnv.server = &index;
+    replayEnv.endMs = trace.durationMs();
+    NetEmulator net(replayEnv.seed);
+    if (faultsPath) {
+        if (!net.load(faultsPath, error)) { fprintf(stderr, "%s\n", error.c_str()); return 2; }
+        replayEnv.net = &net;
+    }
+    if (ttPath) {
+        std::vector<uint8_t> image;
+        if (!loadFile(ttPath, image)) { fprintf(stderr, "can't read %s\n", ttPath); return 2; }
+        replayEnv.partition.assign(0x1C000, 0xFF);
+        if (image.size() > replayEnv.partition.size()) replayEnv.partition.resize((image.size() + 4095) & ~(size_t)4095, 0xFF);
+        std::copy(image.begin(), image.end(), replayEnv.partition.begin());
+    }
+    Preferences prefs;
+    prefs.begin("ptv-trmnl");
+    prefs.putString("serverUrl", "http://replay.local");
+    prefs.end();
+
+    // stdio buffers its first write lazily; get that out of the baseline
+    fflush(stdout);
+    size_t baseline = replayHeapLive();
+    replayEnv.heapBase = baseline;
+
+    Summary total;
+    int cycles = 0;
+    auto account = [&](const ReplayCycle& c) {
+        total["requests"] += c.requests;
+        total["unmatched"] += c.unmatched;
+        total["bytes_in"] += c.bytesIn;
+        total["bytes_out"] += c.bytesOut;
+        total["push_bytes"] += c.streamBytes;
+        total["partial"] += c.partial;
+        total["full"] += c.full;
+        total["cpu_us"] += c.cpuUs;
+        if (replayEnv.net) total["net_faults"] += c.netFaults;
+        total["peak_heap"] = std::max(total["peak_heap"], (double)c.peakHeap);
+    };
+
+    replayHeapResetPeak();
+    double cpu0 = cpuUsNow();
+    setup();
+    replayEnv.cycle.cpuUs = cpuUsNow() - cpu0;
+    replayEnv.cycle.peakHeap = replayHeapPeak() > baseline ? replayHeapPeak() - baseline : 0;
+    if (perCycle) printCycle(0, replayEnv.cycle);
+    account(replayEnv.cycle);
+
+    while (replayEnv.nowMs() <= replayEnv.endMs) {
+        replayEnv.cycle = ReplayCycle();
+        replayEnv.cycle.startMs = replayEnv.nowMs();
+        replayHeapResetPeak();
+        cpu0 = cpuUsNow();
+        loop();
+        replayEnv.cycle.cpuUs = cpuUsNow() - cpu0;
+        replayEnv.cycle.peakHeap = replayHeapPeak() > baseline ? replayHeapPeak() - baseline : 0;
+        cycles++;
+        const ReplayCycle& c = replayEnv.cycle;
+        if (perCycle && (c.requests || c.partial || c.full || c.streamBytes)) printCycle(cycles, c);
+        account(c);
+    }
+    total["cycles"] = cycles;
+
+    if (!replayEnv.unmatchedLast.empty()) fprintf(stderr, "last unmatched request: %s\n", replayEnv.unmatchedLast.c_str());
+    std::string summary;
+    for (const auto& kv : total) {
+        char line[96];
+        snprintf(line, sizeof(line), "%s=%.0f\n", kv.first.c_str(), kv.second);
+        summary += line;
+    }
+    fputs(summary.c_str(), stdout);
+    if (summaryOut) {
+        FILE* f = fopen(summaryOut, "w");
+        if (!f) { fprintf(stderr, "can't write %s\n", summaryOut); return 2; }
+        fputs(summary.c_str(), f);
+        fclose(f);
+    }
+
+    if (!expectPath) return 0;
+    Summary expect;
+    if (!loadSummary(expectPath, expect)) { fprintf(stderr, "can't read %s\n", expectPath); return 2; }
+    int regressions = 0;
+    for (const auto& kv : expect) {
+        if (kv.first == "cpu_us" || kv.first == "cycles") continue;
+        bool slack = kv.first == "bytes_in" || kv.first == "bytes_out" || kv.first == "push_bytes" || kv.first == "peak_heap";
+        double limit = slack ? kv.second * (100 + EXPECT_SLACK_PCT) / 100 : kv.second;
+        if (total[kv.first] > limit) {
+            fprintf(stderr, "REGRESSION %s: %.0f, expected at most %.0f\n", kv.first.c_str(), total[kv.first], limit);
+            regressions++;
+        }
+    }
+    return regressions ? 1 : 0;
+}
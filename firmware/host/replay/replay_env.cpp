@@ -0,0 +1,124 @@
+/**
+ * ReplayEnv state and heap accounting for the replayed firmware
+ *
+ * malloc and friends are interposed over glibc's so every allocation the
+ * firmware makes - new, calloc, Arduino String - is counted with its
+ * usable size. Single-threaded by design, like the loop it measures.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "replay_env.hpp"
+
+#include <Arduino.h>
+#include <malloc.h>
+
+uint64_t nativeVirtualUs = 0;
+ReplayEnv replayEnv;
+
+uint64_t ReplayEnv::nowMs() const { return nativeVirtualUs / 1000; }
+
+void ReplayEnv::advanceTo(uint64_t ms) {
+    if (ms * 1000 > nativeVirtualUs) nativeVirtualUs = ms * 1000;
+}
+
+const TraceExchange* ReplayEnv::request(const std::string& method, const std::string& path, size_t bytesOut, bool tls,
+                                        uint32_t timeoutMs, NetFault* fault) {
+    cycle.requests++;
+    cycle.bytesOut += bytesOut;
+    if (fault) *fault = NET_FAULT_NONE;
+    NetAttempt a;
+    if (net) {
+        a = net->request(nowMs(), tls, timeoutMs);
+        delay(a.ms);
+        if (a.fault) {
+            cycle.netFaults++;
+            if (fault) *fault = a.fault;
+            return nullptr;
+        }
+    }
+    const TraceExchange* ex = a.status ? &_forced : server ? server->match(method, path, nowMs()) : nullptr;
+    if (a.status) {
+        // The server is down or shedding: it answers with the script's status, whatever was asked
+        _forced = TraceExchange();
+        _forced.method = method; _forced.path = path;
+        _forced.status = a.status;
+        _forced.body = "emulated " + std::to_string(a.status);
+        _forced.respHeaders.push_back({"Content-Length", std::to_string(_forced.body.size())});
+    }
+    if (!ex) {
+        cycle.unmatched++;
+        unmatchedLast = method + " " + path;
+        delay(REPLAY_MISS_MS);
+        return nullptr;
+    }
+    size_t head = 17;                       // "HTTP/1.1 200 OK\r\n"
+    for (const TraceHeader& h : ex->respHeaders) head += h.name.size() + h.value.size() + 4;
+    cycle.bytesIn += head + 2 + ex->body.size();
+    delay(ex->ms + (net ? net->transfer(nowMs(), head + 2 + ex->body.size()) : 0));
+    return ex;
+}
+
+bool ReplayEnv::connect(bool tls, uint32_t timeoutMs) {
+    if (!net) return true;
+    NetAttempt a = net->connect(nowMs(), tls, timeoutMs);
+    delay(a.ms);
+    if (a.fault) cycle.netFaults++;
+    return !a.fault;
+}
+
+// xorshift64*, so a replay draws the same "random" numbers every run
+uint32_t ReplayEnv::random() {
+    if (!seed) seed = 0x9E3779B97F4A7C15ull;
+    seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+    return (uint32_t)((seed * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// ---------------------------------------------------------------------------
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+}
+
+static size_t heapLive = 0, heapPeak = 0;
+
+static inline void* counted(void* p) {
+    if (p) {
+        heapLive += malloc_usable_size(p);
+        if (heapLive > heapPeak) heapPeak = heapLive;
+    }
+    return p;
+}
+
+extern "C" {
+void* malloc(size_t n) { return counted(__libc_malloc(n)); }
+void* calloc(size_t n, size_t size) { return counted(__libc_calloc(n, size)); }
+void free(void* p) {
+    if (p) heapLive -= malloc_usable_size(p);
+    __libc_free(p);
+}
+void* realloc(void* p, size_t n) {
+    size_t old = p ? malloc_usable_size(p) : 0;
+    void* q = __libc_realloc(p, n);
+    if (!q && n) return nullptr;           // p is untouched
+    heapLive -= old;
+    return counted(q);
+}
+void* memalign(size_t align, size_t n) { return counted(__libc_memalign(align, n)); }
+void* aligned_alloc(size_t align, size_t n) { return counted(__libc_memalign(align, n)); }
+int posix_memalign(void** out, size_t align, size_t n) {
+    void* p = counted(__libc_memalign(align, n));
+    if (!p) return 12;                      // ENOMEM
+    *out = p;
+    return 0;
+}
+}
+
+size_t replayHeapLive() { return heapLive; }
+size_t replayHeapPeak() { return heapPeak; }
+void replayHeapResetPeak() { heapPeak = heapLive; }
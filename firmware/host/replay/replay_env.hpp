@@ -0,0 +1,103 @@
+/**
+ * The world the firmware sees when replayed natively
+ *
+ * One ReplayEnv holds everything the shims in replay/shim answer from:
+ * the virtual clock (millis(), SNTP time), the recorded server, the panel,
+ * the timetable partition, the OTA app slots, the network between them
+ * (an optional NetEmulator: scripted latency, loss and outages) and the
+ * per-cycle counters the harness reports.
+ * Firmware code is compiled unchanged against those shims; the harness
+ * sets the env up, calls setup() and then loop() until the trace runs out.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_ENV_HPP
+#define REPLAY_ENV_HPP
+
+#include "http_trace.hpp"
+#include "net_emulator.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Modelled waveform times; they only decide how long the loop waits for BUSY
+#ifndef REPLAY_PARTIAL_REFRESH_MS
+#define REPLAY_PARTIAL_REFRESH_MS 500
+#endif
+#ifndef REPLAY_FULL_REFRESH_MS
+#define REPLAY_FULL_REFRESH_MS 3500
+#endif
+
+// Heap the firmware starts with, as ESP.getFreeHeap() reports it (an ESP32-C3 with WiFi up)
+#ifndef REPLAY_HEAP_BYTES
+#define REPLAY_HEAP_BYTES 262144
+#endif
+
+// A request the trace has no answer for
+#ifndef REPLAY_MISS_MS
+#define REPLAY_MISS_MS 50
+#endif
+
+struct ReplayCycle {
+    uint64_t startMs = 0;           // virtual time loop() was entered
+    uint32_t wake = 0;              // WAKE_BIT()s the cycle's wait() returned with
+    int requests = 0;
+    int unmatched = 0;              // requests the trace had no answer for
+    int netFaults = 0;              // requests and connects the emulated network failed
+    size_t bytesOut = 0, bytesIn = 0;
+    size_t streamBytes = 0;         // push stream bytes delivered
+    int partial = 0, full = 0;      // panel refreshes started
+    double cpuUs = 0;               // host CPU inside loop(): decode and draw, the shims do no I/O
+    size_t peakHeap = 0;            // most heap held by the firmware during the cycle
+};
+
+struct ReplayEnv {
+    const ReplayIndex* server = nullptr;
+    NetEmulator* net = nullptr;     // between the firmware and the server; null for a perfect network
+    uint64_t seed = 1;              // esp_random()'s sequence
+    uint64_t endMs = 0;             // stop once virtual time passes this
+    bool clockSynced = false;       // configTime() called
+    std::string unmatchedLast;      // most recent request nobody answered, for the report
+    std::vector<uint8_t> partition; // the "timetable" data partition
+    std::vector<uint8_t> app[2];    // the OTA app slots' images; none running = a build without OTA partitions
+    int appRunning = 0, appBoot = 0;// the slot this boot runs and the one otadata boots next
+    std::vector<uint8_t> appWriting;// between esp_ota_begin() and esp_ota_end()
+    std::string relayUpstream;      // TXT "upstream" of an edge relay on the LAN, answered from the same trace; empty = none
+    uint32_t batteryMv = 0;         // cell voltage behind PIN_BATTERY; 0 = no cell, on USB
+    size_t heapBase = 0;            // heap the harness itself held when it called setup()
+    ReplayCycle cycle;
+
+    uint64_t nowMs() const;
+    void advanceTo(uint64_t ms);
+
+    /**
+     * Look a request up in the trace, count it and spend its recorded time,
+     * plus what the network adds. Null if the network failed it (fault says
+     * how) or the trace has no answer; a status the network script forces
+     * comes back as an exchange of its own.
+     */
+    const TraceExchange* request(const std::string& method, const std::string& path, size_t bytesOut, bool tls = false,
+                                 uint32_t timeoutMs = NET_EMU_TIMEOUT_MS, NetFault* fault = nullptr);
+    /** A connection the firmware opens itself (the push stream): false if the network failed it. */
+    bool connect(bool tls, uint32_t timeoutMs = NET_EMU_TIMEOUT_MS);
+    uint32_t random();
+    void refreshed(bool full) { full ? cycle.full++ : cycle.partial++; }
+
+private:
+    TraceExchange _forced;          // the answer a status=N window makes the server give
+};
+
+extern ReplayEnv replayEnv;
+
+/** esp_restart() throws it: a harness that reboots catches it, boots ReplayEnv::appBoot and calls setup() again. */
+struct ReplayRestart {};
+
+// Heap held by the process right now and the high-water mark since the last reset
+size_t replayHeapLive();
+size_t replayHeapPeak();
+void replayHeapResetPeak();
+
+#endif // REPLAY_ENV_HPP
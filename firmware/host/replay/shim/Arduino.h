@@ -0,0 +1,66 @@
+/**
+ * ESP32 Arduino core extras on top of the native stand-in, for replay
+ *
+ * The native Arduino.h (host/native) with NATIVE_VIRTUAL_TIME, plus the
+ * pieces of the ESP32 core the firmware sources call directly: String,
+ * GPIO setup, the battery ADC, the ESP heap figures, esp_random(),
+ * configTime() and gettimeofday() on the virtual clock.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_ARDUINO_H
+#define REPLAY_ARDUINO_H
+
+#include_next <Arduino.h>
+#include "WString.h"
+#include "replay_env.hpp"
+
+#include <sys/time.h>
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline void digitalWrite(uint8_t, uint8_t) {}
+// The board's 1:2 divider halves the cell voltage at the pin
+inline uint32_t analogReadMilliVolts(uint8_t) { return replayEnv.batteryMv / 2; }
+
+// A device-sized heap less what the firmware holds: everything live beyond replayEnv.heapBase
+inline uint32_t replayHeapFree(size_t held) {
+    size_t used = held > replayEnv.heapBase ? held - replayEnv.heapBase : 0;
+    return used < REPLAY_HEAP_BYTES ? (uint32_t)(REPLAY_HEAP_BYTES - used) : 0;
+}
+
+/** ESP.getFreeHeap() and friends. The low-water mark is since the harness last reset the heap peak. */
+struct ReplayEsp {
+    uint32_t getFreeHeap() const { return replayHeapFree(replayHeapLive()); }
+    uint32_t getMinFreeHeap() const { return replayHeapFree(replayHeapPeak()); }
+    uint32_t getMaxAllocHeap() const { return getFreeHeap(); }
+};
+inline ReplayEsp ESP;
+
+// The hardware RNG, as a fixed sequence from replayEnv.seed so a replay repeats
+inline uint32_t esp_random() { return replayEnv.random(); }
+
+/** SNTP: the clock reads the trace's wall time from here on. */
+inline void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* = nullptr, const char* = nullptr) {
+    replayEnv.clockSynced = true;
+}
+
+// Before configTime() the clock reads 1970, as on a cold boot
+inline int replayGettimeofday(struct timeval* tv, void*) {
+    uint64_t ms = replayEnv.nowMs();
+    if (replayEnv.clockSynced && replayEnv.server) ms += replayEnv.server->trace().startEpochMs;
+    tv->tv_sec = (time_t)(ms / 1000);
+    tv->tv_usec = (suseconds_t)(ms % 1000) * 1000;
+    return 0;
+}
+#define gettimeofday(tv, tz) replayGettimeofday(tv, tz)
+
+#endif // REPLAY_ARDUINO_H
@@ -0,0 +1,8 @@
+/**
+ * The replayed firmware (zones-v12.cpp) includes ArduinoJson but parses
+ * nothing with it; this keeps the build free of the library.
+ */
+
+#ifndef REPLAY_ARDUINOJSON_H
+#define REPLAY_ARDUINOJSON_H
+#endif // REPLAY_ARDUINOJSON_H
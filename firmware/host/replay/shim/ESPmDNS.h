@@ -0,0 +1,30 @@
+/**
+ * mDNS for the replayed firmware: a recording is of the device talking to
+ * one server, so a query finds no relay and the firmware stays direct,
+ * unless the harness announces one (ReplayEnv::relayUpstream). Requests
+ * through that relay are plain HTTP, answered from the same trace.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_ESPMDNS_H
+#define REPLAY_ESPMDNS_H
+
+#include "WiFi.h"
+
+class MDNSResponder {
+public:
+    bool begin(const char* hostname) { return true; }
+    int queryService(const char* service, const char* proto) { queries++; return replayEnv.relayUpstream.empty() ? 0 : 1; }
+    bool hasTxt(int idx, const char* key) { return strcmp(key, "upstream") == 0; }
+    String txt(int idx, const char* key) { return hasTxt(idx, key) ? String(replayEnv.relayUpstream.c_str()) : String(); }
+    ReplayIPAddress IP(int idx) { return ReplayIPAddress{"192.168.4.10"}; }
+    uint16_t port(int idx) { return 8080; }
+
+    int queries = 0;
+};
+
+inline MDNSResponder MDNS;
+
+#endif // REPLAY_ESPMDNS_H
@@ -0,0 +1,84 @@
+/**
+ * HTTPClient for the replayed firmware
+ *
+ * GET/POST look the request up in the trace (ReplayEnv::request), spend
+ * the recorded response time and hand the recorded body to the caller's
+ * WiFiClient, so getString() and getStreamPtr() reads both work. With a
+ * NetEmulator in replayEnv a request can fail as the real one does: a
+ * lookup, connect or handshake that fails is CONNECTION_REFUSED, one the
+ * network lost waits out the connect timeout and is READ_TIMEOUT.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_HTTPCLIENT_H
+#define REPLAY_HTTPCLIENT_H
+
+#include "WiFi.h"
+
+#include <string>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient {
+public:
+    bool begin(WiFiClient& client, const String& url) {
+        _client = &client;
+        _ex = nullptr;
+        _headers.clear();
+        // Path and query after scheme://host[:port]
+        const std::string& u = url.str();
+        size_t scheme = u.find("://");
+        size_t slash = u.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+        _path = slash == std::string::npos ? "/" : u.substr(slash);
+        return scheme != std::string::npos;
+    }
+
+    void setTimeout(uint16_t) {}
+    void setConnectTimeout(int32_t ms) { _connectMs = ms > 0 ? (uint32_t)ms : NET_EMU_TIMEOUT_MS; }
+    void setReuse(bool) {}
+    void collectHeaders(const char* keys[], size_t count) {}
+    void addHeader(const String& name, const String& value) { _headers += name.str() + ": " + value.str() + "\r\n"; }
+
+    int GET() { return send("GET", nullptr, 0); }
+    int POST(uint8_t* body, size_t len) { return send("POST", body, len); }
+
+    int getSize() const {
+        if (!_ex) return -1;
+        const char* len = _ex->header("Content-Length");
+        return len ? atoi(len) : -1;
+    }
+    String getString() {
+        std::string body;
+        uint8_t buf[512];
+        int r;
+        while (_client && (r = _client->read(buf, sizeof(buf))) > 0) body.append((const char*)buf, r);
+        return String(body);
+    }
+    WiFiClient* getStreamPtr() { return _client; }
+    WiFiClient& getStream() { return *_client; }
+    bool hasHeader(const char* name) const { return _ex && _ex->header(name); }
+    String header(const char* name) const { return _ex && _ex->header(name) ? String(_ex->header(name)) : String(); }
+    void end() { if (_client) _client->stop(); }
+
+private:
+    int send(const char* method, const uint8_t* body, size_t len) {
+        if (!_client) return HTTPC_ERROR_CONNECTION_REFUSED;
+        size_t out = strlen(method) + _path.size() + 11 + _headers.size() + 2 + len;
+        NetFault fault;
+        _ex = replayEnv.request(method, _path, out, _client->secure(), _connectMs, &fault);
+        if (!_ex) return fault == NET_FAULT_LOST ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_REFUSED;
+        _client->serve(_ex->body);
+        return _ex->status;
+    }
+
+    WiFiClient* _client = nullptr;
+    const TraceExchange* _ex = nullptr;
+    std::string _path, _headers;
+    uint32_t _connectMs = NET_EMU_TIMEOUT_MS;
+};
+
+#endif // REPLAY_HTTPCLIENT_H
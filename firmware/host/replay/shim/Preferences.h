@@ -0,0 +1,34 @@
+/**
+ * NVS preferences for the replayed firmware, in memory. The harness
+ * seeds "serverUrl" before setup() reads it.
+ */
+
+#ifndef REPLAY_PREFERENCES_H
+#define REPLAY_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+class Preferences {
+public:
+    bool begin(const char* ns, bool readOnly = false) { _ns = ns; return true; }
+    void end() {}
+    String getString(const char* key, const String& def = String()) {
+        auto it = store().find(_ns + "/" + key);
+        return it == store().end() ? def : String(it->second);
+    }
+    size_t putString(const char* key, const String& value) { store()[_ns + "/" + key] = value.str(); return value.length(); }
+    uint8_t getUChar(const char* key, uint8_t def = 0) {
+        auto it = store().find(_ns + "/" + key);
+        return it == store().end() ? def : (uint8_t)atoi(it->second.c_str());
+    }
+    size_t putUChar(const char* key, uint8_t value) { store()[_ns + "/" + key] = std::to_string(value); return 1; }
+
+    static std::map<std::string, std::string>& store() { static std::map<std::string, std::string> s; return s; }
+
+private:
+    std::string _ns;
+};
+
+#endif // REPLAY_PREFERENCES_H
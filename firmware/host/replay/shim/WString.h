@@ -0,0 +1,68 @@
+/**
+ * Arduino String for the replayed firmware
+ *
+ * Backed by std::string; only the members the firmware calls.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_WSTRING_H
+#define REPLAY_WSTRING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    long toInt() const { return atol(_s.c_str()); }
+    bool endsWith(const char* suffix) const {
+        size_t n = strlen(suffix);
+        return _s.size() >= n && _s.compare(_s.size() - n, n, suffix) == 0;
+    }
+    bool equalsIgnoreCase(const String& o) const { return strcasecmp(_s.c_str(), o.c_str()) == 0; }
+    bool startsWith(const char* prefix) const { return _s.compare(0, strlen(prefix), prefix) == 0; }
+    int indexOf(const char* s, unsigned int from = 0) const { size_t p = _s.find(s, from); return p == std::string::npos ? -1 : (int)p; }
+    String substring(unsigned int from, unsigned int to = ~0u) const { return from >= _s.size() ? String() : String(_s.substr(from, to - from)); }
+    void toCharArray(char* buf, unsigned int size) const {
+        if (!size) return;
+        size_t n = _s.size() < size - 1 ? _s.size() : size - 1;
+        memcpy(buf, _s.data(), n);
+        buf[n] = '\0';
+    }
+    void replace(const char* from, const char* to) {
+        size_t n = strlen(from), m = strlen(to);
+        if (!n) return;
+        for (size_t p = _s.find(from); p != std::string::npos; p = _s.find(from, p + m)) _s.replace(p, n, to);
+    }
+
+    String& operator+=(const String& o) { _s += o._s; return *this; }
+    String& operator+=(const char* o) { _s += o; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    String& operator+=(int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(long v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned long v) { _s += std::to_string(v); return *this; }
+
+    friend String operator+(String a, const String& b) { a += b; return a; }
+    friend String operator+(String a, const char* b) { a += b; return a; }
+    bool operator==(const char* o) const { return _s == o; }
+    bool operator==(const String& o) const { return _s == o._s; }
+
+    const std::string& str() const { return _s; }
+
+private:
+    std::string _s;
+};
+
+#endif // REPLAY_WSTRING_H
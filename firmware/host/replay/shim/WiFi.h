@@ -0,0 +1,134 @@
+/**
+ * WiFi and WiFiClient for the replayed firmware
+ *
+ * WiFi is always up. A WiFiClient either carries one HTTP response body
+ * handed to it by the HTTPClient shim, or - when the firmware connect()s
+ * it itself, as the push channel does - plays the trace's push stream:
+ * the bytes recorded at or after the moment it connected, each becoming
+ * readable once virtual time reaches it, closed where the recording was.
+ * With a NetEmulator in replayEnv the connect can fail, and a window that
+ * takes the link down or closes the server's port cuts the stream.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_WIFI_H
+#define REPLAY_WIFI_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <string>
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+// Stands in for a socket descriptor so the wake loop has something to watch
+#define REPLAY_STREAM_FD 1000
+
+class WiFiClient : public Client {
+public:
+    ~WiFiClient() override { stop(); }
+
+    int connect(const char* host, uint16_t port) override {
+        stop();
+        if (!replayEnv.connect(secure())) return 0;
+        _stream = true;
+        _open = true;
+        _in.clear(); _pos = 0; _request.clear(); _answered = false;
+        streamClient() = this;
+        return 1;
+    }
+
+    size_t write(const uint8_t* buf, size_t n) override {
+        if (!_open) return 0;
+        replayEnv.cycle.bytesOut += n;
+        _request.append((const char*)buf, n);
+        return n;
+    }
+
+    int available() override {
+        pump();
+        return (int)(_in.size() - _pos);
+    }
+
+    int read(uint8_t* buf, size_t n) override {
+        int avail = available();
+        if (avail <= 0) return _open ? 0 : -1;
+        size_t r = n < (size_t)avail ? n : (size_t)avail;
+        memcpy(buf, _in.data() + _pos, r);
+        _pos += r;
+        return (int)r;
+    }
+
+    int read() { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+    size_t readBytes(uint8_t* buf, size_t n) { int r = read(buf, n); return r > 0 ? (size_t)r : 0; }
+
+    void stop() override {
+        _open = false;
+        if (streamClient() == this) streamClient() = nullptr;
+    }
+
+    uint8_t connected() override { pump(); return _open || _pos < _in.size(); }
+    int fd() const { return _stream && _open ? REPLAY_STREAM_FD : -1; }
+    virtual bool secure() const { return false; }
+
+    /** HTTPClient shim: this client now holds a response body. */
+    void serve(const std::string& body) {
+        stop();
+        _stream = false;
+        _in = body; _pos = 0;
+    }
+
+    /** Virtual time the push stream next has something for its reader; UINT64_MAX if never. */
+    uint64_t nextStreamMs() const {
+        if (!_stream || !_open || !_answered || !replayEnv.server) return UINT64_MAX;
+        const HttpTrace& trace = replayEnv.server->trace();
+        return _next < trace.stream.size() ? trace.stream[_next].t : UINT64_MAX;
+    }
+
+    /** The client playing the push stream, if one is connected. */
+    static WiFiClient*& streamClient() { static WiFiClient* c = nullptr; return c; }
+
+private:
+    void pump() {
+        if (!_stream || !_open || !replayEnv.server) return;
+        uint64_t now = replayEnv.nowMs();
+        if (replayEnv.net && replayEnv.net->down(now)) { _open = false; return; }
+        if (!_answered) {
+            if (_request.find("\r\n\r\n") == std::string::npos) return;
+            _answered = true;
+            replayEnv.cycle.requests++;
+            int forced = replayEnv.net ? replayEnv.net->at(now).status : 0;
+            int status = forced ? forced : replayEnv.server->hasStream() ? replayEnv.server->streamStatus(now) : 404;
+            _in += "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK\r\nContent-Type: text/event-stream\r\n\r\n" : " Error\r\n\r\n");
+            if (status != 200) { _open = false; return; }
+            _next = replayEnv.server->streamFrom(now);
+        }
+        const std::vector<TraceStreamEvent>& events = replayEnv.server->trace().stream;
+        while (_open && _next < events.size() && events[_next].t <= now) {
+            const TraceStreamEvent& ev = events[_next++];
+            if (ev.kind == STREAM_DATA) { _in += ev.data; replayEnv.cycle.streamBytes += ev.data.size(); }
+            else if (ev.kind == STREAM_CLOSE) _open = false;
+        }
+    }
+
+    bool _stream = false, _open = false, _answered = false;
+    std::string _in, _request;
+    size_t _pos = 0, _next = 0;
+};
+
+struct ReplayIPAddress {
+    const char* addr = "192.168.4.2";
+    String toString() const { return String(addr); }
+};
+
+class ReplayWiFi {
+public:
+    int status() const { return WL_CONNECTED; }
+    ReplayIPAddress localIP() const { return ReplayIPAddress(); }
+};
+
+inline ReplayWiFi WiFi;
+
+#endif // REPLAY_WIFI_H
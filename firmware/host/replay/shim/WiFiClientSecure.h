@@ -0,0 +1,18 @@
+/**
+ * TLS client for the replayed firmware: the trace is already plaintext,
+ * so this is a WiFiClient that accepts the TLS setup calls.
+ */
+
+#ifndef REPLAY_WIFICLIENTSECURE_H
+#define REPLAY_WIFICLIENTSECURE_H
+
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    bool secure() const override { return true; }
+    void setInsecure() {}
+    void setCACert(const char*) {}
+};
+
+#endif // REPLAY_WIFICLIENTSECURE_H
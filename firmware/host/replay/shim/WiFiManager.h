@@ -0,0 +1,27 @@
+/**
+ * WiFiManager for the replayed firmware: already configured, connects at once.
+ */
+
+#ifndef REPLAY_WIFIMANAGER_H
+#define REPLAY_WIFIMANAGER_H
+
+#include "WiFi.h"
+
+class WiFiManagerParameter {
+public:
+    WiFiManagerParameter(const char* id, const char* label, const char* value, int length) : _value(value) {}
+    const char* getValue() const { return _value.c_str(); }
+    void setValue(const char* value, int length) { _value = value; }
+private:
+    std::string _value;
+};
+
+class WiFiManager {
+public:
+    void setConfigPortalTimeout(unsigned long) {}
+    void addParameter(WiFiManagerParameter*) {}
+    void setSaveParamsCallback(void (*)()) {}
+    bool autoConnect(const char*, const char* = nullptr) { return true; }
+};
+
+#endif // REPLAY_WIFIMANAGER_H
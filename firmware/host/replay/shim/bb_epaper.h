@@ -0,0 +1,71 @@
+/**
+ * bb_epaper for the replayed firmware
+ *
+ * A 1bpp framebuffer the firmware draws into exactly as on the device
+ * (tile streams write it directly, BMPs go through the same blit the
+ * benchmarks model); refresh() only counts. Text drawing is a no-op.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_BB_EPAPER_H
+#define REPLAY_BB_EPAPER_H
+
+#include <Arduino.h>
+#include "bmp_blit.hpp"
+
+#define EP75_800x480 1
+#define BBEP_BLACK 0
+#define BBEP_WHITE 1
+#define BBEP_SUCCESS 0
+#define BBEP_ERROR_BAD_DATA 2
+#define REFRESH_FULL 0
+#define REFRESH_FAST 1
+#define REFRESH_PARTIAL 2
+#define FONT_8x8 0
+
+class BBEPAPER {
+public:
+    static const int WIDTH = 800, HEIGHT = 480;
+
+    explicit BBEPAPER(int panel) {}
+
+    void initIO(int dc, int rst, int busy, int cs, int mosi, int sck, uint32_t hz) {}
+    void setPanelType(int panel) {}
+    void setRotation(int angle) {}
+    int allocBuffer(bool dual) { memset(_fb, 0xFF, sizeof(_fb)); return BBEP_SUCCESS; }
+    uint8_t* getBuffer() { return _fb; }
+
+    int loadBMP(uint8_t* bmp, int x, int y, int fg, int bg) {
+        size_t len = bmp[0] == 'B' && bmp[1] == 'M' ? bmpU32(bmp + 2) : 0;
+        TileSurface fb = { _fb, WIDTH / 8, WIDTH, HEIGHT };
+        return bmpBlitPixels(fb, bmp, len, x, y) ? BBEP_SUCCESS : BBEP_ERROR_BAD_DATA;
+    }
+
+    void fillScreen(int color) { memset(_fb, color == BBEP_WHITE ? 0xFF : 0x00, sizeof(_fb)); }
+    void fillRect(int x, int y, int w, int h, int color) {
+        for (int yy = max(y, 0); yy < min(y + h, HEIGHT); yy++)
+            for (int xx = max(x, 0); xx < min(x + w, WIDTH); xx++) {
+                uint8_t bit = 0x80 >> (xx & 7);
+                uint8_t& b = _fb[yy * (WIDTH / 8) + xx / 8];
+                b = color == BBEP_WHITE ? b | bit : b & ~bit;
+            }
+    }
+    void drawRect(int x, int y, int w, int h, int color) {}
+    void setFont(int font) {}
+    void setTextColor(int fg, int bg) {}
+    void setCursor(int x, int y) {}
+    void print(const char* s) {}
+    int printf(const char* fmt, ...) { return 0; }
+
+    int refresh(int mode, bool wait) {
+        replayEnv.refreshed(mode == REFRESH_FULL);
+        return BBEP_SUCCESS;
+    }
+
+private:
+    alignas(4) uint8_t _fb[WIDTH / 8 * HEIGHT];     // malloc'd on the device, so word aligned
+};
+
+#endif // REPLAY_BB_EPAPER_H
@@ -0,0 +1,72 @@
+/**
+ * OTA API for the replayed firmware, on ReplayEnv::app. Without a running
+ * image there are no app partitions, so the update check finds nothing to
+ * patch and the boot check nothing to confirm. With one, the other slot
+ * takes a sequential write, otadata is appBoot, and a restart (or the
+ * bootloader's rollback) throws ReplayRestart for the harness to reboot.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_ESP_OTA_OPS_H
+#define REPLAY_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+typedef uint32_t esp_ota_handle_t;
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe
+
+inline const esp_partition_t* esp_ota_get_running_partition() {
+    return replayEnv.app[replayEnv.appRunning].empty() ? nullptr : &replayAppPartitions()[replayEnv.appRunning];
+}
+
+inline const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) {
+    return esp_ota_get_running_partition() ? &replayAppPartitions()[1 - replayEnv.appRunning] : nullptr;
+}
+
+// The handle is the slot + 1
+inline esp_err_t esp_ota_begin(const esp_partition_t* part, size_t, esp_ota_handle_t* handle) {
+    int slot = replayAppSlot(part);
+    if (slot < 0 || slot == replayEnv.appRunning || !esp_ota_get_running_partition()) return ESP_FAIL;
+    replayEnv.appWriting.clear();
+    *handle = (esp_ota_handle_t)slot + 1;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+    if (!handle || replayEnv.appWriting.size() + size > replayAppPartitions()[handle - 1].size) return ESP_FAIL;
+    replayEnv.appWriting.insert(replayEnv.appWriting.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    if (!handle || replayEnv.appWriting.empty()) return ESP_FAIL;
+    replayEnv.app[handle - 1].swap(replayEnv.appWriting);
+    replayEnv.appWriting.clear();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_abort(esp_ota_handle_t) { replayEnv.appWriting.clear(); return ESP_OK; }
+
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t* part) {
+    int slot = replayAppSlot(part);
+    if (slot < 0 || replayEnv.app[slot].empty()) return ESP_FAIL;
+    replayEnv.appBoot = slot;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
+
+inline void esp_restart() { throw ReplayRestart(); }
+
+// The bootloader was built with rollback: otadata goes back to the other slot
+inline esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot() {
+    int prev = 1 - replayEnv.appRunning;
+    if (!esp_ota_get_running_partition() || replayEnv.app[prev].empty()) return ESP_FAIL;
+    replayEnv.appBoot = prev;
+    esp_restart();
+    return ESP_OK;
+}
+
+#endif // REPLAY_ESP_OTA_OPS_H
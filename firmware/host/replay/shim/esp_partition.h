@@ -0,0 +1,95 @@
+/**
+ * Flash partition API for the replayed firmware: the "timetable" data
+ * partition is ReplayEnv::partition, mapped in place, and the two app
+ * partitions are ReplayEnv::app (read only here; esp_ota_ops.h writes them).
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef REPLAY_ESP_PARTITION_H
+#define REPLAY_ESP_PARTITION_H
+
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL (-1)
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0, ESP_PARTITION_TYPE_DATA = 1 } esp_partition_type_t;
+typedef int esp_partition_subtype_t;
+typedef enum { SPI_FLASH_MMAP_DATA, SPI_FLASH_MMAP_INST } spi_flash_mmap_memory_t;
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+inline esp_partition_t& replayTimetablePartition() {
+    static esp_partition_t part = { ESP_PARTITION_TYPE_DATA, 0x40, 0x3E0000, 0, "timetable" };
+    part.size = (uint32_t)replayEnv.partition.size();
+    return part;
+}
+
+// app0/app1, whether or not the harness gave them images
+inline esp_partition_t* replayAppPartitions() {
+    static esp_partition_t parts[2] = {
+        { ESP_PARTITION_TYPE_APP, 0x10, 0x010000, 0x1E0000, "app0" },
+        { ESP_PARTITION_TYPE_APP, 0x11, 0x1F0000, 0x1E0000, "app1" },
+    };
+    return parts;
+}
+
+inline int replayAppSlot(const esp_partition_t* part) {
+    return part && part->type == ESP_PARTITION_TYPE_APP ? (int)(part - replayAppPartitions()) : -1;
+}
+
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    if (replayEnv.partition.empty() || type != ESP_PARTITION_TYPE_DATA || (label && strcmp(label, "timetable") != 0)) return nullptr;
+    return &replayTimetablePartition();
+}
+
+inline esp_err_t esp_partition_mmap(const esp_partition_t* part, size_t offset, size_t size, spi_flash_mmap_memory_t memory,
+                                    const void** out, spi_flash_mmap_handle_t* handle) {
+    if (offset + size > replayEnv.partition.size()) return ESP_ERR_INVALID_SIZE;
+    *out = replayEnv.partition.data() + offset;
+    *handle = 1;
+    return ESP_OK;
+}
+
+inline void spi_flash_munmap(spi_flash_mmap_handle_t handle) {}
+
+inline esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+    int slot = replayAppSlot(part);
+    if (slot >= 0) {
+        const std::vector<uint8_t>& img = replayEnv.app[slot];
+        if (offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+        // Past the image: erased flash
+        for (size_t i = 0; i < size; i++) ((uint8_t*)dst)[i] = offset + i < img.size() ? img[offset + i] : 0xFF;
+        return ESP_OK;
+    }
+    if (offset + size > replayEnv.partition.size()) return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, replayEnv.partition.data() + offset, size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+    if (offset + size > replayEnv.partition.size()) return ESP_ERR_INVALID_SIZE;
+    memset(replayEnv.partition.data() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+    if (offset + size > replayEnv.partition.size()) return ESP_ERR_INVALID_SIZE;
+    // NOR flash: programming only clears bits
+    uint8_t* dst = replayEnv.partition.data() + offset;
+    for (size_t i = 0; i < size; i++) dst[i] &= ((const uint8_t*)src)[i];
+    return ESP_OK;
+}
+
+#endif // REPLAY_ESP_PARTITION_H
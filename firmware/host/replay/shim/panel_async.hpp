@@ -0,0 +1,73 @@
+/**
+ * PanelAsync for the replayed firmware
+ *
+ * Same interface as include/panel_async.hpp. There is no BUSY pin: a
+ * refresh is busy for REPLAY_PARTIAL_REFRESH_MS / REPLAY_FULL_REFRESH_MS
+ * of virtual time, and waiting for it moves the clock to its end, so the
+ * overlap of fetch and waveform shows up in the cycle times as it would
+ * on the device.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef PANEL_ASYNC_HPP
+#define PANEL_ASYNC_HPP
+
+#include <Arduino.h>
+#include <bb_epaper.h>
+
+typedef void (*PanelDoneCallback)(int mode, uint32_t elapsedMs, void* ctx);
+
+class PanelAsync {
+public:
+    explicit PanelAsync(BBEPAPER& panel) : _panel(panel) {}
+
+    void begin() {}
+
+    bool busy() const { return _pending && replayEnv.nowMs() < _endsMs; }
+
+    bool refresh(int mode, PanelDoneCallback cb = nullptr, void* ctx = nullptr) {
+        waitIdle();
+        _mode = mode; _cb = cb; _ctx = ctx;
+        _pending = true;
+        _started = replayEnv.nowMs();
+        _endsMs = _started + (mode == REFRESH_FULL ? REPLAY_FULL_REFRESH_MS : REPLAY_PARTIAL_REFRESH_MS);
+        _panel.refresh(mode, false);
+        _count[mode == REFRESH_FULL]++;
+        return true;
+    }
+
+    bool waitIdle(uint32_t timeoutMs = 0) {
+        if (!_pending) return true;
+        replayEnv.advanceTo(_endsMs);
+        finish();
+        return true;
+    }
+
+    void poll() { if (_pending && !busy()) finish(); }
+
+    uint32_t lastRefreshMs() const { return _lastElapsed; }
+    uint32_t refreshCount(bool full) const { return _count[full]; }
+    uint32_t timeouts() const { return 0; }
+
+private:
+    void finish() {
+        _pending = false;
+        _lastElapsed = (uint32_t)(replayEnv.nowMs() - _started);
+        PanelDoneCallback cb = _cb;
+        _cb = nullptr;
+        if (cb) cb(_mode, _lastElapsed, _ctx);
+    }
+
+    BBEPAPER& _panel;
+    bool _pending = false;
+    int _mode = 0;
+    uint64_t _started = 0, _endsMs = 0;
+    uint32_t _lastElapsed = 0;
+    uint32_t _count[2] = {0, 0};
+    PanelDoneCallback _cb = nullptr;
+    void* _ctx = nullptr;
+};
+
+#endif // PANEL_ASYNC_HPP
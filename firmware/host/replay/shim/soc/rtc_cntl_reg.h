@@ -0,0 +1,8 @@
+/** RTC control registers the firmware touches (brown-out detector). */
+
+#ifndef REPLAY_RTC_CNTL_REG_H
+#define REPLAY_RTC_CNTL_REG_H
+
+#define RTC_CNTL_BROWN_OUT_REG 0
+
+#endif // REPLAY_RTC_CNTL_REG_H
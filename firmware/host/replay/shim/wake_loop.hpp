@@ -0,0 +1,92 @@
+/**
+ * WakeLoop for the replayed firmware
+ *
+ * Same interface as include/wake_loop.hpp. Deadlines are virtual times;
+ * wait() jumps the clock straight to the earliest of them or to the next
+ * push stream event, so idle minutes cost nothing to replay. Past the end
+ * of the trace wait() returns 0 and the harness stops.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef WAKE_LOOP_HPP
+#define WAKE_LOOP_HPP
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define WAKE_NEVER 0xFFFFFFFFu
+
+enum WakeSource : uint8_t {
+    WAKE_POLL, WAKE_FULL, WAKE_PREFETCH, WAKE_COMMIT, WAKE_PUSH_TIMER, WAKE_PAGE, WAKE_RELEASE,
+    WAKE_BUTTON, WAKE_PUSH, WAKE_NET, WAKE_SCRAPE, WAKE_SOURCE_COUNT
+};
+#define WAKE_TIMER_COUNT (WAKE_RELEASE + 1)
+#define WAKE_BIT(source) (1u << (source))
+#define WAKE_BITS_ALL (WAKE_BIT(WAKE_SOURCE_COUNT) - 1)
+
+class WakeLoop {
+public:
+    bool begin(int buttonPin) {
+        for (uint64_t& d : _due) d = UINT64_MAX;
+        return true;
+    }
+
+    void wifiConnected() {}
+
+    void arm(WakeSource timer, uint32_t ms) {
+        if (timer >= WAKE_TIMER_COUNT) return;
+        _due[timer] = ms == WAKE_NEVER ? UINT64_MAX : replayEnv.nowMs() + ms;
+    }
+
+    void watch(int fd) { _watchFd = fd; }
+    void listen(int) {}          // no scrapes in a replay
+
+    // A button press arrives this way, at the current virtual time
+    void notify(uint32_t bits) {
+        if (bits & WAKE_BIT(WAKE_BUTTON)) _pressedMs = millis();
+        _pending |= bits;
+    }
+
+    uint32_t wait() {
+        uint32_t bits = _pending;
+        _pending = 0;
+        uint64_t t0 = replayEnv.nowMs();
+        _awakeUs += (t0 - _mark) * 1000;
+        _mark = t0;
+        if (bits) { replayEnv.cycle.wake = bits; return bits; }
+        uint64_t next = UINT64_MAX;
+        for (uint64_t d : _due) next = min(next, d);
+        WiFiClient* stream = WiFiClient::streamClient();
+        uint64_t pushAt = _watchFd >= 0 && stream ? stream->nextStreamMs() : UINT64_MAX;
+        next = min(next, pushAt);
+        if (next == UINT64_MAX || next > replayEnv.endMs) {
+            replayEnv.advanceTo(replayEnv.endMs + 1);
+            return 0;
+        }
+        replayEnv.advanceTo(next);
+        uint64_t now = replayEnv.nowMs();
+        _waitUs += (now - t0) * 1000;
+        _mark = now;
+        for (int i = 0; i < WAKE_TIMER_COUNT; i++)
+            if (_due[i] <= now) { bits |= WAKE_BIT(i); _due[i] = UINT64_MAX; }
+        if (pushAt <= now) bits |= WAKE_BIT(WAKE_PUSH);
+        replayEnv.cycle.wake = bits;
+        return bits;
+    }
+
+    uint64_t awakeUs() const { return _awakeUs; }
+    uint64_t waitUs() const { return _waitUs; }
+    uint32_t pressedMs() const { return _pressedMs; }
+    float idleMa() const { return 18.0f; }   // modem sleep + DFS, as on the device
+
+private:
+    uint64_t _due[WAKE_TIMER_COUNT];
+    uint64_t _awakeUs = 0, _waitUs = 0, _mark = 0;
+    int _watchFd = -1;
+    uint32_t _pending = 0;
+    uint32_t _pressedMs = 0;
+};
+
+#endif // WAKE_LOOP_HPP
@@ -0,0 +1,366 @@
+/**
+ * Record a device's traffic with the server, or play a recording back
+ *
+ *   trace-proxy --record trace.txt --upstream https://server [--listen 0.0.0.0:8080] [--insecure]
+ *   trace-proxy --serve trace.txt [--listen 127.0.0.1:8080]
+ *
+ * --record: point the device's Server URL at http://<this host>:8080. Each
+ * request is forwarded upstream (TLS if the upstream is https and the
+ * build has OpenSSL), answered back to the device and appended to the
+ * trace with its timing. Responses go to the device with a Content-Length,
+ * as HTTPClient::getSize() wants; the push stream is relayed as it arrives
+ * and recorded event by event. The device itself is untouched: capturing
+ * on the ESP32 would need flash it doesn't have.
+ *
+ * --serve: answer a device (or trmnl-kindle) from a trace in real time,
+ * t = 0 being when the proxy started. replay-cycles does the same in
+ * virtual time without a device.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "http_trace.hpp"
+#include "posix_client.hpp"
+#include "standin_server.hpp"
+#include "http_fetch.hpp"
+#ifdef KINDLE_TLS
+#include "tls_client.hpp"
+#endif
+
+#include <arpa/inet.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <memory>
+#include <thread>
+
+#define PROXY_HEAD_TIMEOUT_MS 10000
+#define PROXY_UPSTREAM_TIMEOUT_MS 30000
+
+struct Options {
+    const char* record = nullptr;
+    const char* serve = nullptr;
+    const char* upstream = nullptr;
+    const char* listen = nullptr;
+    bool insecure = false;
+};
+
+static Options opt;
+static ServerEndpoint upstream;
+static TraceWriter writer;
+static HttpTrace served;
+static std::unique_ptr<ReplayIndex> replay;
+static const auto started = std::chrono::steady_clock::now();
+
+static uint64_t traceNow() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+static const char* reason(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 502: return "Bad Gateway";
+    default: return "Status";
+    }
+}
+
+struct Request {
+    std::string method, target;
+    std::vector<TraceHeader> headers;
+    std::string body;
+
+    const char* header(const char* name) const {
+        for (const TraceHeader& h : headers) if (strcasecmp(h.name.c_str(), name) == 0) return h.value.c_str();
+        return nullptr;
+    }
+};
+
+// Header lines after the first, "Name: value"
+static void parseHeaders(const std::string& head, std::vector<TraceHeader>& out) {
+    size_t p = head.find("\r\n");
+    while (p != std::string::npos) {
+        size_t e = head.find("\r\n", p + 2);
+        if (e == std::string::npos || e == p + 2) break;
+        std::string line = head.substr(p + 2, e - p - 2);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            size_t v = line.find_first_not_of(' ', colon + 1);
+            out.push_back({line.substr(0, colon), v == std::string::npos ? "" : line.substr(v)});
+        }
+        p = e;
+    }
+}
+
+static bool readRequest(int fd, Request& req) {
+    std::string head = StandinServer::readHead(fd, PROXY_HEAD_TIMEOUT_MS);
+    char method[16], target[2048];
+    if (head.empty() || sscanf(head.c_str(), "%15s %2047s HTTP/", method, target) != 2) return false;
+    req.method = method;
+    req.target = target;
+    parseHeaders(head, req.headers);
+    long len = req.header("Content-Length") ? atol(req.header("Content-Length")) : 0;
+    char buf[4096];
+    while ((long)req.body.size() < len) {
+        struct pollfd p = { fd, POLLIN, 0 };
+        if (::poll(&p, 1, PROXY_HEAD_TIMEOUT_MS) <= 0) return false;
+        ssize_t n = ::recv(fd, buf, std::min((long)sizeof(buf), len - (long)req.body.size()), 0);
+        if (n <= 0) return false;
+        req.body.append(buf, n);
+    }
+    return true;
+}
+
+static std::string responseHead(int status, const std::vector<TraceHeader>& headers) {
+    std::string s = "HTTP/1.1 " + std::to_string(status) + " " + reason(status) + "\r\n";
+    for (const TraceHeader& h : headers) s += h.name + ": " + h.value + "\r\n";
+    return s + "Connection: close\r\n\r\n";
+}
+
+static bool peerClosed(int fd) {
+    struct pollfd p = { fd, POLLIN, 0 };
+    if (::poll(&p, 1, 0) <= 0) return false;
+    char c;
+    return ::recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0;
+}
+
+// ---------------------------------------------------------------------------
+// --record
+
+struct RelaySink {
+    int fd;                 // device, for the push stream; -1 to collect
+    std::string body;
+    bool stream;
+};
+
+static bool relayBody(const uint8_t* data, size_t len, void* ctx) {
+    RelaySink* s = (RelaySink*)ctx;
+    if (!s->stream) { s->body.append((const char*)data, len); return true; }
+    writer.streamData(traceNow(), std::string((const char*)data, len));
+    return StandinServer::send(s->fd, std::string((const char*)data, len));
+}
+
+static void recordOne(int fd) {
+    Request req;
+    if (!readRequest(fd, req)) { ::close(fd); return; }
+    TraceExchange ex;
+    ex.t = traceNow();
+    ex.method = req.method;
+    ex.path = req.target;
+    ex.reqBody = req.body;
+
+    std::unique_ptr<Client> client;
+#ifdef KINDLE_TLS
+    if (upstream.tls) {
+        TlsClient* tls = new TlsClient();
+        if (opt.insecure) tls->setInsecure();
+        client.reset(tls);
+    }
+#endif
+    if (!client) client.reset(new PosixClient());
+    std::string out = req.method + " " + upstream.prefix + req.target + " HTTP/1.1\r\nHost: " + upstream.host + "\r\n";
+    for (const TraceHeader& h : req.headers) {
+        if (strcasecmp(h.name.c_str(), "Host") == 0 || strcasecmp(h.name.c_str(), "Connection") == 0) continue;
+        ex.reqHeaders.push_back(h);
+        out += h.name + ": " + h.value + "\r\n";
+    }
+    out += "Connection: close\r\n\r\n" + req.body;
+    if (!client->connect(upstream.host, upstream.port) || client->write((const uint8_t*)out.data(), out.size()) != out.size()) {
+        fprintf(stderr, "%s %s: upstream unreachable\n", req.method.c_str(), req.target.c_str());
+        StandinServer::send(fd, responseHead(502, {}));
+        ::close(fd);
+        return;
+    }
+
+    // Response head
+    std::string head;
+    uint8_t buf[2048];
+    unsigned long last = millis();
+    size_t end;
+    while ((end = head.find("\r\n\r\n")) == std::string::npos) {
+        int avail = client->available();
+        if (avail <= 0) {
+            if (!client->connected() || millis() - last > PROXY_UPSTREAM_TIMEOUT_MS) break;
+            delay(1);
+            continue;
+        }
+        int r = client->read(buf, std::min(avail, (int)sizeof(buf)));
+        if (r <= 0) break;
+        head.append((const char*)buf, r);
+        last = millis();
+    }
+    if (end == std::string::npos || sscanf(head.c_str(), "HTTP/%*d.%*d %d", &ex.status) != 1) {
+        StandinServer::send(fd, responseHead(502, {}));
+        ::close(fd);
+        client->stop();
+        return;
+    }
+    std::string rest = head.substr(end + 4);
+    head.resize(end + 2);
+    std::vector<TraceHeader> headers;
+    parseHeaders(head, headers);
+    long contentLength = -1;
+    bool chunked = false, eventStream = false;
+    for (const TraceHeader& h : headers) {
+        if (strcasecmp(h.name.c_str(), "Content-Length") == 0) contentLength = atol(h.value.c_str());
+        else if (strcasecmp(h.name.c_str(), "Transfer-Encoding") == 0) chunked = strstr(h.value.c_str(), "chunked") != nullptr;
+        else if (strcasecmp(h.name.c_str(), "Connection") != 0) {
+            if (strcasecmp(h.name.c_str(), "Content-Type") == 0) eventStream = strstr(h.value.c_str(), "text/event-stream") != nullptr;
+            ex.respHeaders.push_back(h);
+        }
+    }
+    if (req.method == "HEAD" || ex.status == 304 || ex.status == 204) contentLength = 0;
+
+    RelaySink sink = { fd, std::string(), eventStream };
+    if (eventStream) {
+        writer.streamOpen(ex.t, ex.status, req.target);
+        StandinServer::send(fd, responseHead(ex.status, ex.respHeaders));
+    }
+    HttpBodyReader reader;
+    reader.begin(contentLength, chunked);
+    size_t delivered = 0;
+    bool ok = reader.feed((const uint8_t*)rest.data(), rest.size(), relayBody, &sink, delivered);
+    last = millis();
+    while (ok && !reader.done()) {
+        int avail = client->available();
+        if (avail <= 0) {
+            if (!client->connected()) break;
+            // The push stream idles between heartbeats; only the device leaving ends it
+            if (eventStream ? peerClosed(fd) : millis() - last > PROXY_UPSTREAM_TIMEOUT_MS) break;
+            delay(1);
+            continue;
+        }
+        int r = client->read(buf, std::min(avail, (int)sizeof(buf)));
+        if (r <= 0) break;
+        last = millis();
+        ok = reader.feed(buf, r, relayBody, &sink, delivered);
+    }
+    client->stop();
+
+    if (eventStream) {
+        writer.streamClose(traceNow());
+    } else {
+        ex.ms = (uint32_t)(traceNow() - ex.t);
+        ex.body = sink.body;
+        if (contentLength != 0 || !sink.body.empty()) ex.respHeaders.push_back({"Content-Length", std::to_string(sink.body.size())});
+        writer.exchange(ex);
+        StandinServer::send(fd, responseHead(ex.status, ex.respHeaders) + ex.body);
+    }
+    fprintf(stderr, "%6.1fs %s %s -> %d, %zu bytes%s\n", ex.t / 1000.0, req.method.c_str(), req.target.c_str(), ex.status,
+            delivered, eventStream ? " (stream)" : "");
+    ::close(fd);
+}
+
+// ---------------------------------------------------------------------------
+// --serve
+
+static void sleepUntil(uint64_t t) {
+    uint64_t now = traceNow();
+    if (t > now) std::this_thread::sleep_for(std::chrono::milliseconds(t - now));
+}
+
+static void serveOne(int fd) {
+    Request req;
+    if (!readRequest(fd, req)) { ::close(fd); return; }
+    uint64_t t = traceNow();
+    const char* accept = req.header("Accept");
+    if (accept && strstr(accept, "text/event-stream")) {
+        int status = replay->hasStream() ? replay->streamStatus(t) : 404;
+        std::vector<TraceHeader> headers;
+        if (status == 200) headers.push_back({"Content-Type", "text/event-stream"});
+        StandinServer::send(fd, responseHead(status, headers));
+        const std::vector<TraceStreamEvent>& events = served.stream;
+        for (size_t i = status == 200 ? replay->streamFrom(t) : events.size(); i < events.size(); i++) {
+            while (traceNow() < events[i].t) {
+                if (peerClosed(fd)) { ::close(fd); return; }
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min<uint64_t>(100, events[i].t - traceNow())));
+            }
+            if (events[i].kind == STREAM_CLOSE) break;
+            if (events[i].kind == STREAM_DATA && !StandinServer::send(fd, events[i].data)) break;
+        }
+        fprintf(stderr, "%6.1fs stream %d closed at %.1fs\n", t / 1000.0, status, traceNow() / 1000.0);
+        ::close(fd);
+        return;
+    }
+    const TraceExchange* ex = replay->match(req.method, req.target, t);
+    if (!ex) {
+        fprintf(stderr, "%6.1fs %s %s -> not in trace\n", t / 1000.0, req.method.c_str(), req.target.c_str());
+        StandinServer::send(fd, responseHead(404, {{"Content-Length", "0"}}));
+    } else {
+        sleepUntil(t + ex->ms);
+        StandinServer::send(fd, responseHead(ex->status, ex->respHeaders) + ex->body);
+        fprintf(stderr, "%6.1fs %s %s -> %d (recorded at %.1fs)\n", t / 1000.0, req.method.c_str(), req.target.c_str(),
+                ex->status, ex->t / 1000.0);
+    }
+    ::close(fd);
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s --record trace.txt --upstream URL [--listen ADDR:PORT] [--insecure]\n"
+            "       %s --serve trace.txt [--listen ADDR:PORT]\n"
+            "  --listen   default 0.0.0.0:8080 when recording, 127.0.0.1:8080 when serving\n"
+            "  --insecure don't verify the upstream certificate\n",
+            argv0, argv0);
+}
+
+static int listenOn(const char* spec) {
+    char addr[64] = "";
+    unsigned port = 0;
+    if (sscanf(spec, "%63[^:]:%u", addr, &port) != 2 || port == 0 || port > 65535) return -1;
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1) return -1;
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (fd < 0 || ::bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 || ::listen(fd, 16) < 0) { if (fd >= 0) ::close(fd); return -1; }
+    return fd;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "--insecure") { opt.insecure = true; continue; }
+        if (!v) { usage(argv[0]); return 2; }
+        if (a == "--record") opt.record = v;
+        else if (a == "--serve") opt.serve = v;
+        else if (a == "--upstream") opt.upstream = v;
+        else if (a == "--listen") opt.listen = v;
+        else { usage(argv[0]); return 2; }
+        i++;
+    }
+    if (!opt.record == !opt.serve || (opt.record && !opt.upstream)) { usage(argv[0]); return 2; }
+
+    signal(SIGPIPE, SIG_IGN);
+    if (opt.record) {
+        if (!parseServerUrl(opt.upstream, upstream)) { fprintf(stderr, "bad upstream URL %s\n", opt.upstream); return 2; }
+#ifndef KINDLE_TLS
+        if (upstream.tls) { fprintf(stderr, "built without TLS; use an http:// upstream\n"); return 2; }
+#endif
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        if (!writer.open(opt.record, (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000)) { fprintf(stderr, "can't write %s\n", opt.record); return 2; }
+    } else {
+        std::string error;
+        if (!served.load(opt.serve, error)) { fprintf(stderr, "%s\n", error.c_str()); return 2; }
+        replay.reset(new ReplayIndex(served));
+    }
+
+    const char* spec = opt.listen ? opt.listen : opt.record ? "0.0.0.0:8080" : "127.0.0.1:8080";
+    int lfd = listenOn(spec);
+    if (lfd < 0) { fprintf(stderr, "can't listen on %s\n", spec); return 2; }
+    fprintf(stderr, "%s on %s\n", opt.record ? "recording" : "serving", spec);
+    for (;;) {
+        int fd = ::accept(lfd, nullptr, nullptr);
+        if (fd < 0) { if (errno == EINTR) continue; perror("accept"); return 1; }
+        std::thread(opt.record ? recordOne : serveOne, fd).detach();
+    }
+}
@@ -0,0 +1,30 @@
+/**
+ * The checks every host test is written with
+ *
+ * CHECK(cond) reports a failed condition with its file and line and
+ * carries on, so one run shows every check that fails; checkReport() ends
+ * main() with the count and the exit status ctest reads.
+ *
+ *   CHECK(decode(buf) == 42);
+ *   return checkReport("zone tiles");
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef HOST_TESTS_CHECK_HPP
+#define HOST_TESTS_CHECK_HPP
+
+#include <stdio.h>
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+/** main()'s return: 1 if any check failed. */
+static inline int checkReport(const char* name) {
+    if (failures) { fprintf(stderr, "%d check(s) failed\n", failures); return 1; }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+#endif // HOST_TESTS_CHECK_HPP
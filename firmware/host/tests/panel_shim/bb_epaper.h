@@ -0,0 +1,30 @@
+/**
+ * bb_epaper for test-panel-async: a refresh holds BUSY for its waveform
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef PANEL_SHIM_BB_EPAPER_H
+#define PANEL_SHIM_BB_EPAPER_H
+
+#include "esp_sleep.h"
+
+#define REFRESH_FULL 0
+#define REFRESH_FAST 1
+#define REFRESH_PARTIAL 2
+
+class BBEPAPER {
+public:
+    uint32_t waveformMs = 500;      // UINT32_MAX: BUSY never clears
+    int refreshes = 0, lastMode = -1;
+
+    int refresh(int mode, bool wait) {
+        refreshes++;
+        lastMode = mode;
+        panelBusyUntilMs = waveformMs == UINT32_MAX ? UINT64_MAX : millis() + waveformMs;
+        return 0;
+    }
+};
+
+#endif // PANEL_SHIM_BB_EPAPER_H
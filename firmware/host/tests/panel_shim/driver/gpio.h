@@ -0,0 +1,2 @@
+// GPIO wakeup calls live with the rest of the ESP32 stand-ins
+#include "../esp_sleep.h"
@@ -0,0 +1,52 @@
+/**
+ * ESP32 GPIO, interrupt, sleep and task-notify calls for test-panel-async
+ *
+ * Just enough for include/panel_async.hpp to run on the virtual clock
+ * against a BUSY pin the test drives: the pin reads active until
+ * panelBusyUntilMs, and a task waiting on a notification sleeps until
+ * then (running the edge ISR, as the hardware would) or for its timeout.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef PANEL_SHIM_ESP_SLEEP_H
+#define PANEL_SHIM_ESP_SLEEP_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#define INPUT 0x01
+#define RISING 0x01
+#define FALLING 0x02
+
+// BUSY is active until this much virtual time; UINT64_MAX is a stuck line
+extern uint64_t panelBusyUntilMs;
+extern void (*panelBusyIsr)();
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*isr)(), int) { panelBusyIsr = isr; }
+inline int digitalRead(uint8_t) { return millis() < panelBusyUntilMs ? LOW : HIGH; }
+
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) (ms)
+#define portYIELD_FROM_ISR() do {} while (0)
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return (TaskHandle_t)1; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) { *woken = pdTRUE; }
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, uint32_t ticks) {
+    uint64_t now = millis(), until = now + ticks;
+    if (panelBusyUntilMs > now && panelBusyUntilMs <= until) {
+        nativeVirtualUs = panelBusyUntilMs * 1000;
+        if (panelBusyIsr) panelBusyIsr();
+        return 1;
+    }
+    nativeVirtualUs = until * 1000;
+    return 0;
+}
+
+#endif // PANEL_SHIM_ESP_SLEEP_H
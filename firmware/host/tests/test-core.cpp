@@ -0,0 +1,202 @@
+/**
+ * Firmware core: src/main.cpp and a second strategy mix on one trace
+ *
+ * The sketch is built here as the image firmware (ImageDecoder with
+ * FullRefresh; there is no ArduinoJson on the host for the zone JSON).
+ * Against a recorded /api/image that changes once and fails once it must
+ * poll on the interval, draw the frame it got, skip a frame identical to
+ * the one on the panel and carry on after the failure. The same trace then
+ * goes through a core assembled in this file with the keep-alive transport
+ * and PartialRefresh, which must end up with the same picture from one
+ * full and one partial refresh. The heap figures the Cycle line reports
+ * have to count the decoder's buffer. A body with no length, chunked or
+ * running to the close, has to come through the transport's deadline
+ * reader whole, and one cut short has to fail. A body fetched into a
+ * buffer of its own gets one its size, and leaves none behind on failure.
+ *
+ * Usage: ./test-core
+ */
+
+#include "firmware_core.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern BBEPAPER bbep;
+extern PanelAsync panel;
+
+// A whole-screen 1 bpp BMP, white with the top `band` rows black
+static std::string screenBmp(int band) {
+    const int pitch = CorePanel::W / 8;
+    std::string bmp(62 + (size_t)pitch * CorePanel::H, '\0');
+    auto le32 = [&](size_t at, uint32_t v) { for (int i = 0; i < 4; i++) bmp[at + i] = (char)(v >> (8 * i)); };
+    bmp[0] = 'B'; bmp[1] = 'M';
+    le32(2, (uint32_t)bmp.size()); le32(10, 62); le32(14, 40);
+    le32(18, CorePanel::W); le32(22, CorePanel::H);
+    bmp[26] = 1; bmp[28] = 1;
+    for (int i = 0; i < 3; i++) bmp[58 + i] = (char)0xFF;
+    for (int y = 0; y < CorePanel::H; y++)      // bottom-up
+        memset(&bmp[62 + (size_t)(CorePanel::H - 1 - y) * pitch], y < band ? 0x00 : 0xFF, pitch);
+    return bmp;
+}
+
+static TraceExchange image(uint64_t t, int status, const std::string& body) {
+    TraceExchange ex;
+    ex.t = t; ex.method = "GET"; ex.path = "/api/image";
+    ex.status = status; ex.ms = 150;
+    ex.respHeaders.push_back({"Content-Type", status == 200 ? "image/bmp" : "text/plain"});
+    ex.respHeaders.push_back({"Content-Length", std::to_string(body.size())});
+    ex.body = body;
+    return ex;
+}
+
+static bool showsBand(const uint8_t* fb, int band) {
+    const int pitch = CorePanel::W / 8;
+    return fb[0] == 0x00 && fb[(size_t)band * pitch - 1] == 0x00 && fb[(size_t)band * pitch] == 0xFF &&
+           fb[(size_t)CorePanel::H * pitch - 1] == 0xFF;
+}
+
+struct Run { int requests = 0, unmatched = 0, cycles = 0; };
+
+// loop() until the trace is over, from a clock at zero
+template <class Fn>
+static Run run(const ReplayIndex& index, Fn step) {
+    Run r;
+    replayEnv.server = &index;
+    replayEnv.endMs = 90000;
+    while (replayEnv.nowMs() <= replayEnv.endMs && r.cycles < 1000) {
+        replayEnv.cycle = ReplayCycle();
+        step();
+        r.cycles++;
+        r.requests += replayEnv.cycle.requests;
+        r.unmatched += replayEnv.cycle.unmatched;
+    }
+    return r;
+}
+
+// Bodies without a Content-Length: the transport reads them itself, through the cycle's NetReader
+static void testNoLength(const std::string& bmp) {
+    auto noLength = [](const char* path, const std::string& body, bool chunked) {
+        TraceExchange ex;
+        ex.method = "GET"; ex.path = path; ex.status = 200; ex.ms = 100;
+        if (chunked) ex.respHeaders.push_back({"Transfer-Encoding", "chunked"});
+        ex.body = body;
+        return ex;
+    };
+    auto chunk = [](const std::string& data) {
+        char size[16];
+        snprintf(size, sizeof(size), "%zx;ext=1\r\n", data.size());
+        return size + data + "\r\n";
+    };
+    std::string chunked = chunk(bmp.substr(0, 1000)) + chunk(bmp.substr(1000, 30000)) + chunk(bmp.substr(31000)) + "0\r\nX-Trailer: 1\r\n\r\n";
+    HttpTrace trace;
+    trace.exchanges.push_back(noLength("/chunked", chunked, true));
+    trace.exchanges.push_back(noLength("/cut", chunked.substr(0, 20000), true));
+    trace.exchanges.push_back(noLength("/close", bmp, false));
+    trace.exchanges.push_back(noLength("/big", bmp + bmp, false));
+    ReplayIndex index(trace);
+    replayEnv.server = &index;
+
+    std::vector<uint8_t> buf(CORE_IMAGE_MAX);
+    HttpsKeepAliveTransport net;
+    NetDeadline cycle(CORE_CYCLE_MS);
+    CHECK(net.get("http://replay.local/chunked", "*/*", buf.data(), buf.size(), cycle) == (long)bmp.size());
+    CHECK(memcmp(buf.data(), bmp.data(), bmp.size()) == 0);
+    CHECK(net.get("http://replay.local/cut", "*/*", buf.data(), buf.size(), cycle) == -1);
+    memset(buf.data(), 0, buf.size());
+    CHECK(net.get("http://replay.local/close", "*/*", buf.data(), buf.size(), cycle) == (long)bmp.size());
+    CHECK(memcmp(buf.data(), bmp.data(), bmp.size()) == 0);
+    CHECK(net.get("http://replay.local/big", "*/*", buf.data(), buf.size(), cycle) == -1);
+    CHECK(net.requests() == 4);
+}
+
+// getSized(): a buffer the size of the body, on the heap only until the caller frees it
+static void testSized(const std::string& bmp) {
+    HttpTrace trace;
+    TraceExchange ex = image(0, 200, bmp);
+    trace.exchanges.push_back(ex);
+    ex.path = "/chunked";
+    ex.respHeaders = {{"Transfer-Encoding", "chunked"}};
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", bmp.size());
+    ex.body = size + bmp + "\r\n0\r\n\r\n";
+    trace.exchanges.push_back(ex);
+    ReplayIndex index(trace);
+    replayEnv.server = &index;
+
+    HttpsKeepAliveTransport net;
+    NetDeadline cycle(CORE_CYCLE_MS);
+    // What the caller frees is all the body took: a buffer its size, not the cap
+    auto held = [](uint8_t* buf) {
+        size_t live = replayHeapLive();
+        free(buf);
+        return live - replayHeapLive();
+    };
+    uint8_t* buf = nullptr;
+    CHECK(net.getSized("http://replay.local/api/image", "*/*", buf, CORE_IMAGE_MAX, cycle) == (long)bmp.size());
+    CHECK(buf && memcmp(buf, bmp.data(), bmp.size()) == 0);
+    size_t n = held(buf);
+    CHECK(n >= bmp.size() && n < bmp.size() + 64);
+    // No length: read into the cap, then trimmed to the body
+    CHECK(net.getSized("http://replay.local/chunked", "*/*", buf, CORE_IMAGE_MAX, cycle) == (long)bmp.size());
+    CHECK(buf && memcmp(buf, bmp.data(), bmp.size()) == 0);
+    n = held(buf);
+    CHECK(n >= bmp.size() && n < bmp.size() + 64);
+    // Longer than the cap, either way: nothing handed back, nothing left behind
+    CHECK(net.getSized("http://replay.local/api/image", "*/*", buf, bmp.size() - 1, cycle) == -1 && !buf);
+    CHECK(net.getSized("http://replay.local/chunked", "*/*", buf, bmp.size() - 1, cycle) == -1 && !buf);
+    size_t live = replayHeapLive();
+    CHECK(net.getSized("http://replay.local/chunked", "*/*", buf, bmp.size() - 1, cycle) == -1 && !buf);
+    CHECK(replayHeapLive() == live);
+}
+
+typedef FirmwareCore<HttpsKeepAliveTransport, ImageDecoder, PartialRefresh> AltCore;
+static BBEPAPER altBbep(PANEL_BB_TYPE);
+static PanelAsync altPanel(altBbep);
+static AltCore alt(altBbep, altPanel);
+
+int main() {
+    // Polls land about 2.5s after each 20s mark (boot screens, then the interval plus 1s loop delays)
+    HttpTrace trace;
+    const std::string a = screenBmp(40), b = screenBmp(120);
+    trace.exchanges.push_back(image(0, 200, a));
+    trace.exchanges.push_back(image(20000, 200, a));        // unchanged: not drawn
+    trace.exchanges.push_back(image(40000, 200, b));
+    trace.exchanges.push_back(image(60000, 500, "error"));  // failed poll, backoff
+    trace.exchanges.push_back(image(80000, 200, b));        // unchanged again
+    ReplayIndex index(trace);
+
+    Preferences prefs;
+    prefs.begin("ptv-trmnl");
+    prefs.putString("serverUrl", "http://replay.local");
+    prefs.end();
+
+    replayEnv.heapBase = replayHeapLive();
+    setup();
+    CHECK(ESP.getFreeHeap() <= REPLAY_HEAP_BYTES - CORE_IMAGE_MAX);
+    CHECK(ESP.getMinFreeHeap() <= ESP.getFreeHeap());
+    Run sketch = run(index, loop);
+    CHECK(sketch.cycles < 1000);
+    CHECK(sketch.unmatched == 0);
+    CHECK(sketch.requests == 5);
+    CHECK(panel.refreshCount(true) == 2 && panel.refreshCount(false) == 0);
+    CHECK(showsBand(bbep.getBuffer(), 120));
+
+    // Same trace, another transport and refresh policy
+    nativeVirtualUs = 0;
+    replayEnv.heapBase = replayHeapLive();
+    alt.setup();
+    Run mixed = run(index, [] { alt.loop(); });
+    CHECK(mixed.unmatched == 0);
+    CHECK(mixed.requests == 5);
+    CHECK(altPanel.refreshCount(true) == 1 && altPanel.refreshCount(false) == 1);
+    CHECK(memcmp(altBbep.getBuffer(), bbep.getBuffer(), CorePanel::PITCH * CorePanel::H) == 0);
+    CHECK(!strcmp(alt.server(), "http://replay.local"));
+
+    testNoLength(b);
+    testSized(b);
+    return checkReport("core");
+}
@@ -0,0 +1,403 @@
+/**
+ * LAN edge relay: its cache and mDNS records, the firmware's discovery,
+ * then six displays through a relay in front of a stand-in server
+ *
+ * Checks request classification, per-display zone lists, single-flight
+ * fetches (eight callers, one fetch), invalidation on a change and the
+ * locally answered 304 and 206. The mDNS response is read back record by
+ * record, and EdgeDiscovery must take only a relay of its own server and
+ * drop it after failures. End to end, six displays (each on its own
+ * loopback address) fetch the same zone, tiles and page: the server must
+ * see one request for each, and an upstream push event must reach a
+ * display's local stream and its next zone list.
+ *
+ * Usage: ./test-edge-relay
+ */
+
+#include "edge_relay.hpp"
+#include "mdns_service.hpp"
+#include "edge_discovery.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// ESPmDNS as EdgeDiscovery sees it, answering from a table
+struct FakeIp {
+    std::string ip;
+    std::string toString() const { return ip; }
+};
+
+struct FakeMdns {
+    struct Service { std::string ip, upstream; uint16_t port; };
+    std::vector<Service> services;
+    int queries = 0;
+
+    int queryService(const char* service, const char* proto) { queries++; return strcmp(service, "ptv-trmnl") ? 0 : (int)services.size(); }
+    bool hasTxt(int i, const char* key) { return !strcmp(key, "upstream") && !services[i].upstream.empty(); }
+    std::string txt(int i, const char* key) { return services[i].upstream; }
+    FakeIp IP(int i) { return FakeIp{services[i].ip}; }
+    uint16_t port(int i) { return services[i].port; }
+};
+
+// The stand-in server: zone list, a zone, tiles, a page and the push stream, one connection at a time
+struct Upstream {
+    std::atomic<bool> stop{false};
+    std::atomic<int> lists{0}, forced{0}, zones{0}, tiles{0}, pages{0}, streams{0};
+    std::atomic<bool> sendEvent{false};
+};
+
+static const std::string ZONE_BODY = "BM" + std::string(998, 'z');
+
+static void serveUpstream(StandinServer& srv, Upstream& up) {
+    std::vector<int> streams;
+    while (!up.stop) {
+        if (up.sendEvent.exchange(false))
+            for (int fd : streams) StandinServer::send(fd, "id: 9\nevent: zones\ndata: trains\n\n");
+        int fd = srv.accept(5);
+        if (fd < 0) continue;
+        std::string head = StandinServer::readHead(fd);
+        char method[8] = "", path[128] = "";
+        sscanf(head.c_str(), "%7s %127s", method, path);
+        const char* cl = strcasestr(head.c_str(), "Content-Length:");
+        std::string body(cl ? atoi(cl + 15) : 0, '\0');
+        for (size_t got = 0; got < body.size();) {
+            ssize_t n = recv(fd, &body[got], body.size() - got, 0);
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        std::string p = path, reply;
+        if (p == "/api/zones/stream") {
+            up.streams++;
+            StandinServer::send(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\n: hb\n\n");
+            streams.push_back(fd);
+            continue;
+        }
+        // Conditionals and ranges are the relay's business; it must not forward them
+        bool conditional = strcasestr(head.c_str(), "If-None-Match") || strcasestr(head.c_str(), "Range:");
+        if (p.compare(0, 10, "/api/zones") == 0) {
+            up.lists++;
+            bool force = p.find("force=true") != std::string::npos;
+            up.forced += force;
+            std::string list = force ? "time,trains,footer" : "";
+            reply = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+            if (!list.empty()) { char n[24]; snprintf(n, sizeof(n), "%zx", list.size()); reply += std::string(n) + "\r\n" + list + "\r\n"; }
+            reply += "0\r\n\r\n";
+        } else if (p == "/api/zone/trains") {
+            up.zones++;
+            reply = std::string("HTTP/1.1 200 OK\r\nContent-Type: image/bmp\r\nX-Zone-X: 0\r\nETag: \"0000beef\"\r\n") +
+                    (conditional ? "X-Conditional: 1\r\n" : "") + "Content-Length: " + std::to_string(ZONE_BODY.size()) + "\r\n\r\n" + ZONE_BODY;
+        } else if (p == "/api/zone/trains/tiles") {
+            up.tiles++;
+            std::string s = "ZT" + body;        // echoes the hashes, so each body has its own answer
+            reply = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(s.size()) + "\r\n\r\n" + s;
+        } else if (p == "/api/page/departures") {
+            up.pages++;
+            reply = "HTTP/1.1 200 OK\r\nETag: \"00000042\"\r\nContent-Length: 4\r\n\r\npage";
+        } else {
+            reply = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+        }
+        StandinServer::send(fd, reply);
+        close(fd);
+    }
+    for (int fd : streams) close(fd);
+}
+
+// One request from a display at 127.0.0.<host>; returns the whole response (head and body)
+static std::string ask(int host, uint16_t port, const std::string& request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in from = {}, to = {};
+    from.sin_family = to.sin_family = AF_INET;
+    from.sin_addr.s_addr = htonl(0x7F000000u | (uint32_t)host);
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    to.sin_port = htons(port);
+    std::string out;
+    if (bind(fd, (struct sockaddr*)&from, sizeof(from)) == 0 && connect(fd, (struct sockaddr*)&to, sizeof(to)) == 0 &&
+        StandinServer::send(fd, request)) {
+        char buf[4096];
+        for (;;) {
+            struct pollfd p = { fd, POLLIN, 0 };
+            if (poll(&p, 1, 3000) <= 0) break;
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            out.append(buf, n);
+        }
+    }
+    close(fd);
+    return out;
+}
+
+static std::string body(const std::string& response) {
+    size_t at = response.find("\r\n\r\n");
+    return at == std::string::npos ? "" : response.substr(at + 4);
+}
+
+static bool waitFor(const std::function<bool()>& cond, int ms = 3000) {
+    for (int i = 0; i < ms / 5 && !cond(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    return cond();
+}
+
+int main() {
+    // 1. Classification and lists
+    std::string tag;
+    bool at;
+    CHECK(edgeClassify("GET", "/api/zones?plain=1&force=true", tag, at) == EDGE_LIST && !at);
+    CHECK(edgeClassify("GET", "/api/zones?plain=1&at=1760000000", tag, at) == EDGE_LIST && at);
+    CHECK(edgeClassify("GET", "/api/zones/stream", tag, at) == EDGE_STREAM);
+    CHECK(edgeClassify("GET", "/api/zone/trains?at=1760000000", tag, at) == EDGE_ZONE && tag == "trains" && at);
+    CHECK(edgeClassify("POST", "/api/zone/trains/tiles", tag, at) == EDGE_ZONE && tag == "trains" && !at);
+    CHECK(edgeClassify("GET", "/api/zone/trains/tiles", tag, at) == EDGE_PASS);
+    CHECK(edgeClassify("GET", "/api/page/alerts", tag, at) == EDGE_ZONE && tag == "alerts");
+    CHECK(edgeClassify("GET", "/api/firmware/delta?from=5.45", tag, at) == EDGE_PASS && tag.empty());
+    CHECK(edgeClassify("POST", "/api/log", tag, at) == EDGE_PASS);
+    std::vector<std::string> ids = edgeSplitList(" time, trains,,footer\r\n");
+    CHECK(ids.size() == 3 && ids[0] == "time" && ids[1] == "trains" && ids[2] == "footer");
+    CHECK(edgeSplitList("\n").empty());
+
+    // 2. Versions: each display hears of a change once; force names everything
+    EdgeCache cache(4096);
+    CHECK(cache.changed({"time", "trains", "footer"}) == 1);
+    CHECK(cache.listFor("a", false) == "footer,time,trains");
+    CHECK(cache.listFor("a", false) == "");
+    CHECK(cache.changed({"trains"}) == 2 && cache.changed({}) == 2);
+    CHECK(cache.listFor("a", false) == "trains");
+    CHECK(cache.listFor("b", false) == "footer,time,trains");
+    CHECK(cache.listFor("a", true) == "footer,time,trains");
+    CHECK(cache.changedSince(1) == "trains");
+
+    // 3. Single flight: eight callers, one fetch, the same answer
+    std::atomic<int> fetches{0};
+    auto slow = [&] {
+        fetches++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EdgeResponse r;
+        r.status = 200;
+        r.body = "zone";
+        return r;
+    };
+    std::vector<std::thread> callers;
+    std::vector<EdgeCache::Answer> answers(8);
+    for (int i = 0; i < 8; i++) callers.emplace_back([&, i] { answers[i] = cache.get("GET /api/zone/trains", "trains", 0, 1000, slow); });
+    for (std::thread& t : callers) t.join();
+    CHECK(fetches == 1);
+    for (const EdgeCache::Answer& a : answers) CHECK(a && a == answers[0] && a->body == "zone");
+    EdgeStats st;
+    cache.fill(st);
+    CHECK(st.coalesced == 7 && st.upstreamRequests == 1 && st.hits == 0);
+    CHECK(cache.get("GET /api/zone/trains", "trains", 0, 2000, slow)->body == "zone" && fetches == 1);
+    cache.changed({"trains"});
+    cache.get("GET /api/zone/trains", "trains", 0, 3000, slow);
+    CHECK(fetches == 2);
+    // TTL, failures not kept, and nothing kept across a change of its tag
+    cache.get("GET /api/sprites.bin", "", 500, 3000, slow);
+    cache.get("GET /api/sprites.bin", "", 500, 3400, slow);
+    CHECK(fetches == 3);
+    cache.get("GET /api/sprites.bin", "", 500, 3500, slow);
+    CHECK(fetches == 4);
+    auto failing = [&] { fetches++; return EdgeResponse(); };
+    CHECK(cache.get("GET /api/zone/time", "time", 0, 4000, failing)->status == 0);
+    cache.get("GET /api/zone/time", "time", 0, 4000, failing);
+    CHECK(fetches == 6);
+    auto racing = [&] { fetches++; cache.changed({"footer"}); EdgeResponse r; r.status = 200; return r; };
+    cache.get("GET /api/zone/footer", "footer", 0, 5000, racing);
+    cache.get("GET /api/zone/footer", "footer", 0, 5000, racing);
+    CHECK(fetches == 8);
+    // Least recently used goes first once past capacity
+    EdgeCache small(1500);
+    auto big = [] { EdgeResponse r; r.status = 200; r.body.assign(400, 'x'); return r; };
+    small.get("a", "", 0, 1, big); small.get("b", "", 0, 2, big); small.get("a", "", 0, 3, big);
+    small.get("c", "", 0, 4, big);
+    st = EdgeStats();
+    small.fill(st);
+    CHECK(st.cacheBytes <= 1500 && st.upstreamRequests == 3);
+    small.get("a", "", 0, 5, big);
+    small.get("b", "", 0, 6, big);
+    st = EdgeStats();
+    small.fill(st);
+    CHECK(st.upstreamRequests == 4);
+
+    // 4. Conditionals and ranges answered from the whole body
+    EdgeResponse full;
+    full.status = 200;
+    full.headers.push_back({"ETag", "\"0000beef\""});
+    full.body = "0123456789";
+    EdgeRequest req;
+    req.headers.push_back({"If-None-Match", "\"0000beef\""});
+    CHECK(edgeLocalise(req, full).status == 304 && edgeLocalise(req, full).body.empty());
+    req.headers.clear();
+    req.headers.push_back({"Range", "bytes=6-"});
+    req.headers.push_back({"If-Range", "\"0000beef\""});
+    EdgeResponse part = edgeLocalise(req, full);
+    CHECK(part.status == 206 && part.body == "6789" && !strcmp(part.header("Content-Range"), "bytes 6-9/10"));
+    req.headers[1].value = "\"00000000\"";
+    CHECK(edgeLocalise(req, full).status == 200 && edgeLocalise(req, full).body.size() == 10);
+    req.headers[0].value = "bytes=10-";
+    req.headers.pop_back();
+    CHECK(edgeLocalise(req, full).status == 200);
+
+    // 5. mDNS: a query for the service gets PTR, SRV, TXT and A back in one packet
+    MdnsService svc;
+    svc.instance = "shop.front";
+    svc.service = "_ptv-trmnl._tcp.local";
+    svc.host = "relaybox.local";
+    inet_pton(AF_INET, "192.168.1.20", &svc.addr);
+    svc.port = 8080;
+    svc.txt.push_back("upstream=ptvtrmnl.vercel.app");
+    svc.txt.push_back("v=1");
+    std::vector<uint8_t> q = mdnsQuery(svc.service, 7, true);
+    std::vector<MdnsQuestion> qs;
+    bool unicast = false;
+    CHECK(mdnsParseQuestions(q.data(), q.size(), qs) && qs.size() == 1 && qs[0].type == MDNS_PTR);
+    CHECK(mdnsWanted(svc, qs, &unicast) && unicast);
+    std::vector<uint8_t> other = mdnsQuery("_http._tcp.local");
+    CHECK(mdnsParseQuestions(other.data(), other.size(), qs) && !mdnsWanted(svc, qs));
+    // A for the host, its name ending in a compression pointer to "local" in the first question
+    std::vector<uint8_t> two;
+    for (uint16_t v : {0, 0, 2, 0, 0, 0}) mdnsPut16(two, v);
+    mdnsPutName(two, "_x._tcp.local");                 // "local" at 12 + 3 + 5
+    mdnsPut16(two, MDNS_PTR); mdnsPut16(two, 1);
+    two.push_back(8);
+    two.insert(two.end(), (const uint8_t*)"relaybox", (const uint8_t*)"relaybox" + 8);
+    two.push_back(0xC0); two.push_back(20);
+    mdnsPut16(two, MDNS_A); mdnsPut16(two, 1);
+    CHECK(mdnsParseQuestions(two.data(), two.size(), qs) && qs.size() == 2 && qs[1].name == "relaybox.local" && mdnsWanted(svc, qs));
+    std::vector<MdnsRecord> recs;
+    CHECK(!mdnsParseRecords(q.data(), q.size(), recs));
+    std::vector<uint8_t> resp = mdnsResponse(svc, 7);
+    CHECK(mdnsParseRecords(resp.data(), resp.size(), recs) && recs.size() == 4 && mdnsGet16(resp.data()) == 7);
+    if (recs.size() == 4) {
+        CHECK(recs[0].type == MDNS_PTR && recs[0].name == svc.service && recs[0].target == "shop.front._ptv-trmnl._tcp.local");
+        CHECK(recs[1].type == MDNS_SRV && recs[1].port == 8080 && recs[1].target == "relaybox.local" && recs[1].ttl == 120);
+        CHECK(recs[2].type == MDNS_TXT && recs[2].txt.size() == 2 && recs[2].txt[0] == "upstream=ptvtrmnl.vercel.app");
+        CHECK(recs[3].type == MDNS_A && recs[3].addr == svc.addr);
+    }
+    // The instance label keeps its dot: one label, not two
+    CHECK(resp.size() > 12 && std::string(resp.begin(), resp.end()).find("\x0ashop.front") != std::string::npos);
+    std::vector<uint8_t> bye = mdnsResponse(svc, 0, true);
+    CHECK(mdnsParseRecords(bye.data(), bye.size(), recs) && recs.size() == 4 && recs[1].ttl == 0);
+    CHECK(!mdnsParseRecords(resp.data(), resp.size() - 3, recs));
+
+    // 6. Discovery: only a relay of the configured server, dropped after failures, looked for again later
+    ServerEndpoint ep;
+    parseServerUrl("https://ptvtrmnl.vercel.app", ep);
+    CHECK(edgeServes("ptvtrmnl.vercel.app", ep) && edgeServes("PTVTRMNL.vercel.app:443", ep));
+    CHECK(!edgeServes("ptvtrmnl.vercel.app:8443", ep) && !edgeServes("other.example", ep) && !edgeServes("ptvtrmnl.vercel", ep));
+    FakeMdns mdns;
+    EdgeDiscovery<FakeMdns> edge;
+    const char* direct = "https://ptvtrmnl.vercel.app";
+    CHECK(!edge.due(0));
+    CHECK(!edge.discover(mdns, direct, 1000) && !edge.active() && !strcmp(edge.url(direct), direct));
+    CHECK(!edge.due(1000 + EDGE_RETRY_MS - 1) && edge.due(1000 + EDGE_RETRY_MS));
+    mdns.services.push_back({"192.168.1.30", "other.example", 8080});
+    mdns.services.push_back({"192.168.1.31", "", 8080});
+    mdns.services.push_back({"192.168.1.20", "ptvtrmnl.vercel.app", 8080});
+    CHECK(edge.discover(mdns, direct, 2000) && !strcmp(edge.url(direct), "http://192.168.1.20:8080"));
+    CHECK(!edge.due(2000 + EDGE_RETRY_MS));
+    CHECK(!edge.failed(3000));
+    edge.succeeded();
+    CHECK(!edge.failed(4000) && edge.active());
+    for (int i = 1; i < EDGE_MAX_FAILURES; i++) CHECK(edge.failed(5000) == (i == EDGE_MAX_FAILURES - 1));
+    CHECK(!edge.active() && !strcmp(edge.url(direct), direct) && edge.dropped() == 1 && edge.found() == 1);
+    CHECK(!edge.failed(5000) && !edge.due(5000) && edge.due(5000 + EDGE_RETRY_MS));
+    CHECK(!edge.discover(mdns, "not a url", 6000) && mdns.queries == 2);
+
+    // 7. Six displays through a relay: one upstream request per distinct answer
+    StandinServer server, lan;
+    CHECK(server.listen() && lan.listen());
+    Upstream up;
+    std::thread upstreamThread(serveUpstream, std::ref(server), std::ref(up));
+    EdgeConfig cfg;
+    std::string url = "http://127.0.0.1:" + std::to_string(server.port());
+    parseServerUrl(url.c_str(), cfg.upstream);
+    cfg.pollMs = 60000;            // the push stream carries the change; the interval poll stays out of the counts
+    EdgeRelay relay;
+    relay.start(cfg, lan.fd());
+    CHECK(waitFor([&] { return relay.ready() && up.streams == 1; }));
+    CHECK(up.forced == 1);
+
+    const int DISPLAYS = 6;
+    auto everyone = [&](const std::function<std::string(int)>& fn) {
+        std::vector<std::string> out(DISPLAYS);
+        std::vector<std::thread> ts;
+        for (int d = 0; d < DISPLAYS; d++) ts.emplace_back([&, d] { out[d] = fn(d); });
+        for (std::thread& t : ts) t.join();
+        return out;
+    };
+    auto get = [&](int d, const std::string& target, const std::string& extra = "") {
+        return ask(2 + d, lan.port(), "GET " + target + " HTTP/1.1\r\nHost: relay\r\nConnection: close\r\n" + extra + "\r\n");
+    };
+    for (const std::string& r : everyone([&](int d) { return get(d, "/api/zones?plain=1&force=true"); }))
+        CHECK(body(r) == "footer,time,trains");
+    for (const std::string& r : everyone([&](int d) { return get(d, "/api/zones?plain=1"); })) CHECK(body(r) == "");
+    for (const std::string& r : everyone([&](int d) { return get(d, "/api/zone/trains"); })) {
+        CHECK(r.compare(0, 12, "HTTP/1.1 200") == 0 && body(r) == ZONE_BODY);
+        CHECK(r.find("X-Zone-X: 0\r\n") != std::string::npos && r.find("X-Conditional") == std::string::npos);
+    }
+    CHECK(up.zones == 1);
+    std::string hashes(16, '\x01'), mine(16, '\x02');
+    auto post = [&](int d, const std::string& hb) {
+        return ask(2 + d, lan.port(), "POST /api/zone/trains/tiles HTTP/1.1\r\nHost: relay\r\nConnection: close\r\nContent-Length: " +
+                                          std::to_string(hb.size()) + "\r\n\r\n" + hb);
+    };
+    for (const std::string& r : everyone([&](int d) { return post(d, hashes); })) CHECK(body(r) == "ZT" + hashes);
+    CHECK(up.tiles == 1);
+    CHECK(body(post(0, mine)) == "ZT" + mine && up.tiles == 2);
+    for (const std::string& r : everyone([&](int d) { return get(d, "/api/page/departures", "If-None-Match: \"00000042\"\r\n"); }))
+        CHECK(r.compare(0, 12, "HTTP/1.1 304") == 0);
+    CHECK(up.pages == 1);
+    std::string resumed = get(0, "/api/zone/trains", "Range: bytes=990-\r\nIf-Range: \"0000beef\"\r\n");
+    CHECK(resumed.compare(0, 12, "HTTP/1.1 206") == 0 && body(resumed) == ZONE_BODY.substr(990) && up.zones == 1);
+    // Keep-alive: two requests on one connection
+    std::string both = ask(2, lan.port(), "GET /api/page/departures HTTP/1.1\r\nHost: relay\r\n\r\nGET /api/page/departures HTTP/1.1\r\nHost: relay\r\nConnection: close\r\n\r\n");
+    CHECK(both.find("page", both.find("\r\n\r\n")) != std::string::npos && both.rfind("HTTP/1.1 200") > 0 && up.pages == 1);
+    // Anything else goes straight through
+    CHECK(get(0, "/api/log").compare(0, 12, "HTTP/1.1 500") == 0);
+
+    // An upstream change: out on a display's local stream, in the next lists, and the zone is fetched again
+    int sfd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    to.sin_port = htons(lan.port());
+    CHECK(connect(sfd, (struct sockaddr*)&to, sizeof(to)) == 0);
+    StandinServer::send(sfd, "GET /api/zones/stream HTTP/1.1\r\nHost: relay\r\nAccept: text/event-stream\r\n\r\n");
+    CHECK(waitFor([&] { return relay.stats().streams == 1; }));
+    uint32_t before = relay.stats().version;
+    up.sendEvent = true;
+    CHECK(waitFor([&] { return relay.stats().version == before + 1; }));
+    std::string streamed;
+    char buf[512];
+    waitFor([&] {
+        ssize_t n = recv(sfd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) streamed.append(buf, n);
+        return streamed.find("data: trains\n\n") != std::string::npos;
+    });
+    CHECK(streamed.find("text/event-stream") != std::string::npos);
+    CHECK(streamed.find("id: " + std::to_string(before + 1) + "\nevent: zones\ndata: trains\n\n") != std::string::npos);
+    close(sfd);
+    for (const std::string& r : everyone([&](int d) { return get(d, "/api/zones?plain=1"); })) CHECK(body(r) == "trains");
+    everyone([&](int d) { return get(d, "/api/zone/trains"); });
+    CHECK(up.zones == 2);
+    // Reconnecting with Last-Event-ID: caught up straight away
+    std::string caught = "";
+    sfd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(connect(sfd, (struct sockaddr*)&to, sizeof(to)) == 0);
+    StandinServer::send(sfd, "GET /api/zones/stream HTTP/1.1\r\nHost: relay\r\nLast-Event-ID: 1\r\n\r\n");
+    waitFor([&] {
+        ssize_t n = recv(sfd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) caught.append(buf, n);
+        return caught.find("data: trains\n\n") != std::string::npos;
+    });
+    CHECK(caught.find("data: trains\n\n") != std::string::npos);
+    close(sfd);
+
+    EdgeStats s = relay.stats();
+    CHECK(s.displays == DISPLAYS && s.lists == 3 * DISPLAYS && s.hits > 0 && s.events == 2);
+    CHECK(up.lists == 1);
+    relay.stop();
+    up.stop = true;
+    upstreamThread.join();
+
+    return checkReport("edge-relay");
+}
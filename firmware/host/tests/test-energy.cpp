@@ -0,0 +1,100 @@
+/**
+ * Energy model and battery-aware cadence
+ *
+ * Covers the LiPo curve and divider, external-power detection, tier
+ * selection with its hysteresis band, the cadence each tier gets, and
+ * the cycle/hour accounting: deltas of the cumulative counters only,
+ * per-event charges, and hours left at the hour's rate.
+ *
+ * Usage: ./test-energy
+ */
+
+#include "energy_model.hpp"
+#include "check.hpp"
+
+#include <math.h>
+#include <stdio.h>
+
+static bool near(float a, float b) { return fabsf(a - b) < 0.01f * (fabsf(b) + 1.0f); }
+
+static BatteryState cell(uint8_t percent) { BatteryState b; b.external = false; b.percent = percent; return b; }
+
+static void testBattery() {
+    CHECK(batteryPercent(4200) == 100 && batteryPercent(4300) == 100);
+    CHECK(batteryPercent(3300) == 0 && batteryPercent(3000) == 0);
+    CHECK(batteryPercent(3800) == 52);
+    CHECK(batteryPercent(3675) == 25);           // halfway between 3650 and 3700
+    // Monotonic over the whole curve
+    uint8_t last = 0;
+    for (uint16_t mv = 3000; mv <= 4300; mv += 5) { CHECK(batteryPercent(mv) >= last); last = batteryPercent(mv); }
+
+    BatteryState b = batteryFromPin(1900);       // 3.8V behind the 1:2 divider
+    CHECK(!b.external && b.mv == 3800 && b.percent == 52);
+    CHECK(batteryFromPin(0).external);            // nothing fitted
+    CHECK(batteryFromPin(2150).external);         // charger holding 4.3V
+    CHECK(batteryFromPin(0).percent == 100);
+}
+
+static void testTiers() {
+    BatteryState usb;
+    CHECK(energyTier(usb, ENERGY_CRITICAL) == ENERGY_NORMAL);
+    CHECK(energyTier(cell(80), ENERGY_NORMAL) == ENERGY_NORMAL);
+    CHECK(energyTier(cell(49), ENERGY_NORMAL) == ENERGY_SAVER);
+    CHECK(energyTier(cell(19), ENERGY_NORMAL) == ENERGY_LOW);
+    CHECK(energyTier(cell(5), ENERGY_SAVER) == ENERGY_CRITICAL);
+    // Recovering needs the hysteresis band on top of the threshold
+    CHECK(energyTier(cell(21), ENERGY_LOW) == ENERGY_LOW);
+    CHECK(energyTier(cell(20 + ENERGY_HYSTERESIS_PCT), ENERGY_LOW) == ENERGY_SAVER);
+    CHECK(energyTier(cell(51), ENERGY_SAVER) == ENERGY_SAVER);
+    CHECK(energyTier(cell(90), ENERGY_CRITICAL) == ENERGY_NORMAL);
+    CHECK(energyTier(cell(9), ENERGY_CRITICAL) == ENERGY_CRITICAL);
+
+    // Each tier polls less often and forces fewer full refreshes
+    for (int t = ENERGY_NORMAL; t < ENERGY_CRITICAL; t++) {
+        EnergyCadence a = energyCadence((EnergyTier)t), b = energyCadence((EnergyTier)(t + 1));
+        CHECK(b.pollMs > a.pollMs && b.fullMs > a.fullMs && b.partialsPerFull > a.partialsPerFull);
+    }
+    CHECK(energyCadence(ENERGY_NORMAL).pollMs == 20000 && energyCadence(ENERGY_NORMAL).fullMs == 300000);
+}
+
+static void testAccounting() {
+    EnergyModel m;
+    // The first sample only sets the baseline
+    m.sample(5000000, 100000000, 18.0f, 10, 2);
+    CHECK(m.endCycle() == 0);
+
+    m.tlsHandshake();
+    m.received(10 * 1024);
+    m.sample(5000000 + 2000000, 100000000 + 18000000, 18.0f, 13, 3);
+    float expect = ENERGY_MAS_TLS_HANDSHAKE + 10 * ENERGY_MAS_PER_KB
+                 + 2 * ENERGY_MA_AWAKE + 18 * 18.0f
+                 + 3 * ENERGY_MAS_PARTIAL + 1 * ENERGY_MAS_FULL;
+    CHECK(near(m.endCycle(), expect / 3600.0f));
+
+    const EnergyBreakdown& h = m.hour();
+    CHECK(h.handshakes == 1 && h.bytes == 10 * 1024 && h.partial == 3 && h.full == 1);
+    CHECK(near(h.awake, 2 * ENERGY_MA_AWAKE) && near(h.idle, 18 * 18.0f));
+    CHECK(near(h.total(), expect));
+
+    // Nothing new since the last sample: nothing charged
+    m.sample(7000000, 118000000, 18.0f, 13, 3);
+    CHECK(m.endCycle() == 0);
+
+    CHECK(!m.hourDue(ENERGY_REPORT_MS - 1) && m.hourDue(ENERGY_REPORT_MS));
+    // At this rate over 20s, a full battery lasts ENERGY_BATTERY_MAH / (rate per hour)
+    float perHour = h.mAh() * 3600000.0f / 20000.0f;
+    CHECK(near(m.hoursLeft(100, 20000), ENERGY_BATTERY_MAH / perHour));
+    CHECK(near(m.hoursLeft(50, 20000), ENERGY_BATTERY_MAH / 2 / perHour));
+
+    m.nextHour(ENERGY_REPORT_MS);
+    CHECK(m.hour().total() == 0 && m.hour().handshakes == 0);
+    CHECK(!m.hourDue(ENERGY_REPORT_MS + 1000));
+    CHECK(m.hoursLeft(100, ENERGY_REPORT_MS + 1000) == 0);
+}
+
+int main() {
+    testBattery();
+    testTiers();
+    testAccounting();
+    return checkReport("energy");
+}
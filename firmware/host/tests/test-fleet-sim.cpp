@@ -0,0 +1,259 @@
+/**
+ * Fleet simulator: its pieces, then small fleets against a stand-in server
+ *
+ * Checks the latency histogram's buckets and quantiles, the poll and
+ * prefetch schedules, list parsing (CSV and /api/zones/changed JSON) and
+ * the incremental response parser fed a byte at a time. Then runs a tile
+ * fleet (each device must post back the hashes its decoder took from the
+ * first answer), a push fleet (one event, one tile fetch per device) and a
+ * zonedata fleet against a loopback server.
+ *
+ * Usage: ./test-fleet-sim
+ */
+
+#include "fleet_sim.hpp"
+#include "standin_server.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* const OK_HEAD = "HTTP/1.1 200 OK\r\nConnection: close\r\n";
+
+// The stand-in server: list, tiles, zonedata and the push stream, one connection at a time
+struct Script {
+    std::atomic<bool> stop{false};
+    std::atomic<int> lists{0}, tilePosts{0}, heldHashes{0}, streams{0}, zonedata{0};
+    int eventAfterMs = 300;
+};
+
+static uint32_t blackTileHash() {
+    uint8_t tile[TILE_BYTES];
+    memset(tile, 0x00, TILE_BYTES);
+    return tileHash(tile);
+}
+
+// One record turning tile 0 black, or none when the device already holds it
+static std::string tileStream(const ZoneDef& z, bool held) {
+    std::string s = {'Z', 'T', TILE_VERSION, 0, TILE_W, TILE_H};
+    int16_t v[] = {z.x, z.y, z.w, z.h, (int16_t)(held ? 0 : 1)};
+    for (int16_t x : v) { s += (char)(x & 0xFF); s += (char)((x >> 8) & 0xFF); }
+    if (held) return s;
+    uint32_t h = blackTileHash();
+    s += std::string("\0\0", 2);
+    s += (char)TILE_FILL;
+    s += (char)1;
+    for (int i = 0; i < 4; i++) s += (char)((h >> (8 * i)) & 0xFF);
+    s += '\0';
+    return s;
+}
+
+static void serve(StandinServer& srv, Script& sc) {
+    struct Stream { int fd; uint64_t at; bool sent; };
+    std::vector<Stream> streams;
+    while (!sc.stop) {
+        uint64_t now = fleetEpochMs();
+        for (Stream& s : streams)
+            if (!s.sent && now - s.at >= (uint64_t)sc.eventAfterMs) s.sent = StandinServer::send(s.fd, ": hb\n\nevent: zones\nid: 7\ndata: trains\n\n");
+        int fd = srv.accept(5);
+        if (fd < 0) continue;
+        std::string head = StandinServer::readHead(fd);
+        char method[8] = "", path[128] = "";
+        sscanf(head.c_str(), "%7s %127s", method, path);
+        const char* cl = strcasestr(head.c_str(), "Content-Length:");
+        std::string body(cl ? atoi(cl + 15) : 0, '\0');
+        for (size_t got = 0; got < body.size();) {
+            ssize_t n = recv(fd, &body[got], body.size() - got, 0);
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        std::string p = path;
+        if (p == "/api/zones/stream") {
+            sc.streams++;
+            StandinServer::send(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n");
+            streams.push_back({fd, fleetEpochMs(), false});
+            continue;
+        }
+        if (p.compare(0, 10, "/api/zones") == 0) {
+            sc.lists++;
+            // Chunked, as Express sends a res.write() body
+            StandinServer::send(fd, std::string(OK_HEAD) + "Transfer-Encoding: chunked\r\n\r\n5\r\ntime,\r\n6\r\ntrains\r\n0\r\n\r\n");
+        } else if (p == "/api/zonedata") {
+            sc.zonedata++;
+            StandinServer::send(fd, std::string(OK_HEAD) + "Content-Length: 11\r\n\r\n{\"zones\":{}");
+        } else if (p.compare(0, 10, "/api/zone/") == 0 && p.size() > 16 && p.compare(p.size() - 6, 6, "/tiles") == 0) {
+            sc.tilePosts++;
+            std::string id = p.substr(10, p.size() - 16);
+            const ZoneDef* z = nullptr;
+            for (const ZoneDef& zd : ZONES) if (id == zd.id) z = &zd;
+            uint32_t first = 0;
+            if (body.size() >= 4) memcpy(&first, body.data(), 4);
+            bool held = first == blackTileHash();
+            if (held) sc.heldHashes++;
+            std::string s = z ? tileStream(*z, held) : "";
+            StandinServer::send(fd, (z ? std::string(OK_HEAD) : "HTTP/1.1 404 Not Found\r\nConnection: close\r\n") +
+                                    "Content-Length: " + std::to_string(s.size()) + "\r\n\r\n" + s);
+        } else {
+            StandinServer::send(fd, "HTTP/1.1 404 Not Found\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+        }
+        close(fd);
+    }
+    for (Stream& s : streams) close(s.fd);
+}
+
+static FleetConfig fleetConfig(const StandinServer& srv, FleetMode mode, int devices, uint32_t durationMs, uint32_t pollMs) {
+    FleetConfig cfg;
+    std::string url = "http://127.0.0.1:" + std::to_string(srv.port());
+    parseServerUrl(url.c_str(), cfg.server);
+    cfg.mode = mode;
+    cfg.devices = devices;
+    cfg.durationMs = durationMs;
+    cfg.pollMs = pollMs;
+    cfg.jitterMs = 20;
+    cfg.spreadMs = 150;
+    cfg.prefetch = false;          // minute boundaries would make the counts depend on the wall clock
+    cfg.timeoutMs = 2000;
+    return cfg;
+}
+
+static bool sinkString(const uint8_t* data, size_t len, void* ctx) {
+    ((std::string*)ctx)->append((const char*)data, len);
+    return true;
+}
+
+int main() {
+    // 1. Histogram: exact below 32, within 1/32 above, quantiles in order
+    for (uint64_t v : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, 1ull << 40}) {
+        int i = LatencyHistogram::index(v);
+        CHECK(LatencyHistogram::lower(i) <= v && v <= LatencyHistogram::upper(i));
+        if (v < 32) CHECK(LatencyHistogram::lower(i) == v && LatencyHistogram::upper(i) == v);
+        else CHECK(LatencyHistogram::upper(i) - LatencyHistogram::lower(i) <= v / 32);
+    }
+    CHECK(LatencyHistogram::index(~0ull) == LatencyHistogram::BUCKETS - 1);
+    LatencyHistogram h;
+    CHECK(h.quantile(0.5) == 0 && h.count() == 0);
+    for (uint64_t v = 1; v <= 100000; v++) h.record(v);
+    uint64_t p50 = h.quantile(0.5), p99 = h.quantile(0.99), p999 = h.quantile(0.999);
+    CHECK(p50 >= 50000 && p50 <= 50000 * 33 / 32);
+    CHECK(p99 >= 99000 && p99 <= 99000 * 33 / 32);
+    CHECK(p999 >= 99900 && p999 <= 100000);
+    CHECK(h.quantile(1.0) == 100000 && h.max() == 100000 && h.mean() > 50000 && h.mean() < 50001);
+    LatencyHistogram tail;
+    tail.record(5000000);
+    h.merge(tail);
+    CHECK(h.count() == 100001 && h.max() == 5000000 && h.quantile(1.0) == 5000000 && h.quantile(0.99) >= p99);
+
+    // 2. Schedules: polls within +-jitter of the cadence; prefetch lead before the boundary
+    FleetRandom rng(42);
+    uint64_t lo = UINT64_MAX, hi = 0, sum = 0;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t t = fleetNextPoll(1000000, 20000, 500, rng) - 1000000;
+        lo = t < lo ? t : lo; hi = t > hi ? t : hi; sum += t;
+    }
+    CHECK(lo >= 19500 && lo < 19520 && hi <= 20500 && hi > 20480);
+    CHECK(sum / 10000 > 19950 && sum / 10000 < 20050);
+    CHECK(fleetNextPoll(1000, 20000, 0, rng) == 21000);
+    const uint64_t minute = 29000000ull * 60000;         // a minute boundary, in ms
+    uint32_t boundary = 0;
+    CHECK(fleetNextPrefetch(minute + 10000, 0, 0, rng, boundary) == minute + 45000 && boundary == minute / 1000 + 60);
+    // Inside the window: now; past its close: the next minute's
+    CHECK(fleetNextPrefetch(minute + 50000, 0, 0, rng, boundary) == minute + 50000 && boundary == minute / 1000 + 60);
+    CHECK(fleetNextPrefetch(minute + 58000, 0, 0, rng, boundary) == minute + 105000 && boundary == minute / 1000 + 120);
+    // Just prefetched for a boundary: the one after it
+    CHECK(fleetNextPrefetch(minute + 46000, minute / 1000 + 60, 0, rng, boundary) == minute + 105000);
+    for (int i = 0; i < 1000; i++) {
+        uint64_t at = fleetNextPrefetch(minute + 1000, 0, 30000, rng, boundary);
+        CHECK(at >= minute + 45000 && at < minute + 57000);
+    }
+
+    // 3. Lists: the firmware's CSV, and the JSON of /api/zones/changed
+    bool flags[ZONE_COUNT] = {false};
+    const char* csv = "time,footer";
+    CHECK(fleetParseChanged(csv, strlen(csv), flags) == 2 && flags[0] && flags[ZONE_COUNT - 1]);
+    memset(flags, 0, sizeof(flags));
+    const char* json = " {\"timestamp\":\"2026-10-18T00:00:00Z\",\"changed\":[\"trains\",\"coffee\"]}";
+    CHECK(fleetParseChanged(json, strlen(json), flags) == 2 && flags[2] && flags[4] && !flags[0]);
+    const char* full = "{\"zones\":[{\"id\":\"time\",\"changed\":true}]}";
+    CHECK(fleetParseChanged(full, strlen(full), flags) == 0);
+
+    // 4. Responses a byte at a time: chunked, close-delimited, broken
+    const char* chunked = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+    HttpResponseParser rp;
+    std::string got;
+    rp.begin();
+    for (size_t i = 0; i < strlen(chunked); i++) CHECK(rp.feed((const uint8_t*)chunked + i, 1, sinkString, &got));
+    CHECK(rp.done() && rp.status() == 200 && got == "hello world" && rp.bodyBytes() == 11);
+    const char* open = "HTTP/1.0 404 Not Found\r\nServer: x\r\n\r\nnope";
+    rp.begin(); got.clear();
+    CHECK(rp.feed((const uint8_t*)open, strlen(open), sinkString, &got));
+    CHECK(!rp.done() && rp.closed() && rp.status() == 404 && got == "nope");
+    rp.begin();
+    CHECK(rp.feed((const uint8_t*)"HTTP/1.1 200 OK\r\nContent-", 26, sinkString, &got) && !rp.closed());
+    rp.begin();
+    CHECK(!rp.feed((const uint8_t*)"SSH-2.0-OpenSSH\r\n", 17, sinkString, &got));
+    rp.begin();
+    CHECK(!rp.feed((const uint8_t*)"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 50, sinkString, &got));
+
+    // 5. A tile fleet: a full first cycle, then the list's two zones every poll, with the hashes held
+    StandinServer srv;
+    CHECK(srv.listen());
+    Script sc;
+    std::thread server(serve, std::ref(srv), std::ref(sc));
+    {
+        FleetSim sim;
+        CHECK(sim.begin(fleetConfig(srv, FLEET_TILES, 12, 1300, 300)));
+        sim.run();
+        const FleetStats& list = sim.stats(FLEET_LIST);
+        const FleetStats& tiles = sim.stats(FLEET_TILE);
+        printf("tile fleet: %lu lists, %lu tile posts, %d holding\n", (unsigned long)list.requests, (unsigned long)tiles.requests,
+               sc.heldHashes.load());
+        CHECK(list.requests >= 12 * 3 && list.ok == list.requests && list.failed == 0);
+        // Every list after the first names two zones; the first is a full refresh of all six
+        CHECK(tiles.requests >= 12 * ZONE_COUNT + 2 * (list.requests - 12) - 12 * 2);
+        CHECK(tiles.failed == 0 && tiles.client4xx == 0 && tiles.latency.count() == tiles.requests);
+        CHECK(sc.heldHashes > 0 && sim.decodeErrors() == 0 && sim.tileMismatches() == 0);
+        CHECK(list.bytesIn > 0 && list.bytesOut > 0 && tiles.bytesOut >= tiles.requests * 4);
+        CHECK(list.latency.quantile(0.5) <= list.latency.quantile(0.99) && list.latency.quantile(0.999) <= list.latency.max());
+        CHECK(sim.peakOpen() >= 1 && sim.elapsedMs() >= 1300);
+        sim.report(stdout);
+    }
+
+    // 6. A push fleet: one full cycle, the stream, then one event naming trains
+    sc.lists = 0; sc.tilePosts = 0;
+    {
+        FleetSim sim;
+        CHECK(sim.begin(fleetConfig(srv, FLEET_PUSH, 8, 900, 60000)));
+        sim.run();
+        CHECK(sim.stats(FLEET_STREAM).requests == 8 && sim.stats(FLEET_STREAM).ok == 8);
+        CHECK(sim.pushEvents() == 8);
+        CHECK(sim.stats(FLEET_LIST).requests == 8);
+        CHECK(sim.stats(FLEET_TILE).requests == 8 * ZONE_COUNT + 8 && sim.stats(FLEET_TILE).failed == 0);
+    }
+
+    // 7. V11's single request a poll
+    {
+        FleetSim sim;
+        CHECK(sim.begin(fleetConfig(srv, FLEET_ZONEDATA, 4, 700, 200)));
+        sim.run();
+        CHECK(sim.stats(FLEET_DATA).requests >= 4 * 3 && sim.stats(FLEET_DATA).ok == sim.stats(FLEET_DATA).requests);
+        CHECK(sim.stats(FLEET_LIST).requests == 0 && sim.stats(FLEET_TILE).requests == 0);
+    }
+    sc.stop = true;
+    server.join();
+
+    // 8. Nothing listening: every request fails, and the devices retry no sooner than the firmware would
+    {
+        StandinServer gone;
+        CHECK(gone.listen());
+        FleetConfig cfg = fleetConfig(gone, FLEET_TILES, 4, 300, 100);
+        gone.close();
+        FleetSim sim;
+        CHECK(sim.begin(cfg));
+        sim.run();
+        CHECK(sim.stats(FLEET_LIST).requests == 4 && sim.stats(FLEET_LIST).failed == 4);
+    }
+
+    return checkReport("fleet sim");
+}
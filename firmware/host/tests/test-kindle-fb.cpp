@@ -0,0 +1,245 @@
+/**
+ * Kindle client output path against a fake framebuffer file
+ *
+ * Maps a PW3-sized 8-bit framebuffer with a padded pitch from a temp file,
+ * places the 800x480 canvas rotated onto it and checks orientation,
+ * scaling, margins and the region updates that would go to MXCFB_SEND_UPDATE.
+ * Then fetches a zone's tiles from a stand-in server - chunked, like the
+ * real one - through httpRequest into the canvas and out to the panel.
+ *
+ * Usage: ./test-kindle-fb
+ */
+
+#include "http_fetch.hpp"
+#include "kindle_fb.hpp"
+#include "posix_client.hpp"
+#include "standin_server.hpp"
+#include "zone_tiles.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int CW = 800, CH = 480;
+static const int PW = 1072, PH = 1448, PPITCH = 1088;
+
+static uint8_t canvasPx[CW / 8 * CH];
+static const TileSurface canvas = { canvasPx, CW / 8, CW, CH };
+
+static void canvasBlack(int x, int y, int w, int h) {
+    for (int py = y; py < y + h; py++)
+        for (int px = x; px < x + w; px++) canvasPx[py * (CW / 8) + px / 8] &= ~(0x80 >> (px % 8));
+}
+
+static int countBlack(const KindleFramebuffer& fb, int x, int y, int w, int h) {
+    int n = 0;
+    for (int py = y; py < y + h; py++)
+        for (int px = x; px < x + w; px++) n += fb.pixels()[py * fb.pitch() + px] == 0x00;
+    return n;
+}
+
+static std::string tempPath() {
+    char path[] = "/tmp/test-kindle-fb-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) ::close(fd);
+    return path;
+}
+
+static void testView() {
+    std::string path = tempPath();
+    KindleFramebuffer fb;
+    CHECK(fb.openFake(path.c_str(), PW, PH, PPITCH));
+    CHECK(fb.width() == PW && fb.height() == PH && fb.pitch() == PPITCH);
+    fb.setView(CW, CH, 90);
+
+    // Rotated 90 clockwise the canvas is 480x800; height limits the fit: 1448/800
+    FbRect all = fb.mapRect(0, 0, CW, CH);
+    CHECK(all.y == 0 && all.h == PH);
+    CHECK(all.w >= 866 && all.w <= 870);
+    CHECK(abs(all.x - (PW - all.w) / 2) <= 1);
+
+    memset(canvasPx, 0xFF, sizeof(canvasPx));
+    canvasBlack(0, 0, 8, 8);    // canvas top-left -> panel top-right
+    fb.clear();
+    FbRect r = fb.blit(canvas, 0, 0, CW, CH);
+    CHECK(r.x == all.x && r.w == all.w);
+    int black = countBlack(fb, 0, 0, PW, PH);
+    CHECK(black >= 8 * 8 * 3 && black <= 8 * 8 * 4);          // scale ~1.81 squared
+    CHECK(countBlack(fb, all.x + all.w - 16, 0, 16, 16) == black);
+    CHECK(countBlack(fb, 0, 0, all.x, PH) == 0);                 // left margin
+    // Pitch padding is never written
+    bool padClean = true;
+    for (int y = 0; y < PH; y++)
+        for (int x = PW; x < PPITCH; x++) padClean &= fb.pixels()[y * PPITCH + x] == 0;
+    CHECK(padClean);
+
+    // Canvas bottom-right lands bottom-left; nothing else moves
+    canvasBlack(CW - 8, CH - 8, 8, 8);
+    FbRect br = fb.blit(canvas, CW - 8, CH - 8, 8, 8);
+    CHECK(br.x == all.x && br.y + br.h == PH);
+    CHECK(countBlack(fb, br.x, br.y, br.w, br.h) == countBlack(fb, 0, 0, PW, PH) - black);
+
+    // Updates are clipped and recorded, markers never 0
+    fb.update(br, WAVEFORM_MODE_DU, false);
+    fb.update(FbRect{-10, PH - 5, 40, 40}, WAVEFORM_MODE_GC16, true);
+    CHECK(fb.update(FbRect{PW, 0, 10, 10}, WAVEFORM_MODE_DU, false) == 0);
+    CHECK(fb.fakeUpdates().size() == 2);
+    if (fb.fakeUpdates().size() == 2) {
+        const FbUpdate& u = fb.fakeUpdates()[1];
+        CHECK(u.rect.x == 0 && u.rect.w == 30 && u.rect.h == 5 && u.full && u.waveform == WAVEFORM_MODE_GC16);
+        CHECK(fb.fakeUpdates()[0].marker != 0 && u.marker != fb.fakeUpdates()[0].marker);
+    }
+
+    // 180 with an explicit scale of 1: centred, upside down
+    fb.setView(CW, CH, 180, 1);
+    FbRect c = fb.mapRect(0, 0, CW, CH);
+    CHECK(c.x == (PW - CW) / 2 && c.y == (PH - CH) / 2 && c.w == CW && c.h == CH);
+    FbRect tl = fb.mapRect(0, 0, 1, 1);
+    CHECK(tl.x == c.x + CW - 1 && tl.y == c.y + CH - 1 && tl.w == 1 && tl.h == 1);
+
+    fb.close();
+    unlink(path.c_str());
+}
+
+static void put16(std::string& s, int v) { s += (char)(v & 0xFF); s += (char)((v >> 8) & 0xFF); }
+static void put32(std::string& s, uint32_t v) { for (int i = 0; i < 4; i++) s += (char)((v >> (8 * i)) & 0xFF); }
+
+static std::string chunked(const std::string& body, size_t piece) {
+    std::string out;
+    char len[16];
+    for (size_t i = 0; i < body.size(); i += piece) {
+        std::string part = body.substr(i, piece);
+        snprintf(len, sizeof(len), "%zx\r\n", part.size());
+        out += len + part + "\r\n";
+    }
+    return out + "0\r\n\r\n";
+}
+
+static bool feedDecoder(const uint8_t* data, size_t len, void* ctx) { return ((TileStreamDecoder*)ctx)->feed(data, len); }
+
+static void testZoneFetch() {
+    // Zone "time" (20,45 180x70) is 3x5 tiles; the server sends tile 4 as a black fill
+    const int ZX = 20, ZY = 45, ZW = 180, ZH = 70;
+    uint8_t black[TILE_BYTES];
+    memset(black, 0x00, sizeof(black));
+    std::string stream = {'Z', 'T', TILE_VERSION, 0, TILE_W, TILE_H};
+    put16(stream, ZX); put16(stream, ZY); put16(stream, ZW); put16(stream, ZH); put16(stream, 1);
+    put16(stream, 4); stream += (char)TILE_FILL; stream += (char)1; put32(stream, tileHash(black));
+    stream += (char)0x00;
+
+    StandinServer server;
+    CHECK(server.listen());
+    std::string head, posted;
+    std::thread script([&] {
+        int c = server.accept(2000);
+        head = StandinServer::readHead(c);
+        size_t want = tileCount(ZW, ZH) * sizeof(uint32_t);
+        char buf[256];
+        while (posted.size() < want) {
+            ssize_t n = ::recv(c, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            posted.append(buf, n);
+        }
+        StandinServer::send(c, "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nTransfer-Encoding: chunked\r\n\r\n");
+        StandinServer::send(c, chunked(stream, 5));
+        ::close(c);
+    });
+
+    ServerEndpoint ep;
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u", server.port());
+    CHECK(parseServerUrl(url, ep));
+    std::vector<uint32_t> hashes(tileCount(ZW, ZH), 0);
+    memset(canvasPx, 0xFF, sizeof(canvasPx));
+    TileStreamDecoder dec;
+    dec.begin(canvas, hashes.data(), (int)hashes.size());
+    PosixClient client;
+    HttpResult res = httpRequest(client, ep, "POST", "/api/zone/time/tiles", "Content-Type: application/octet-stream\r\n",
+                                 (const uint8_t*)hashes.data(), hashes.size() * sizeof(uint32_t), feedDecoder, &dec);
+    script.join();
+    server.close();
+
+    CHECK(res.status == 200 && res.complete && res.bodyBytes == stream.size());
+    CHECK(head.find("POST /api/zone/time/tiles HTTP/1.1\r\n") == 0);
+    CHECK(head.find("Content-Length: 60\r\n") != std::string::npos);
+    CHECK(posted.size() == 60);
+    CHECK(dec.done() && dec.applied() == 1 && hashes[4] == tileHash(black));
+
+    int x = 0, y = 0, w = 0, h = 0;
+    CHECK(dec.dirtyRect(x, y, w, h));
+    CHECK(x == ZX + TILE_W && y == ZY + TILE_H && w == TILE_W && h == TILE_H);
+
+    std::string path = tempPath();
+    KindleFramebuffer fb;
+    CHECK(fb.openFake(path.c_str(), PW, PH, PPITCH));
+    fb.setView(CW, CH, 90);
+    fb.clear();
+    FbRect r = fb.blit(canvas, x, y, w, h);
+    fb.update(r, WAVEFORM_MODE_DU, false);
+    CHECK(fb.fakeUpdates().size() == 1 && !fb.fakeUpdates()[0].full && fb.fakeUpdates()[0].waveform == WAVEFORM_MODE_DU);
+    // The whole region is the tile (scaled nearest-neighbour, so allow the rounded edge)
+    CHECK(countBlack(fb, 0, 0, PW, PH) >= (r.w - 2) * (r.h - 2));
+    CHECK(countBlack(fb, r.x, r.y, r.w, r.h) == countBlack(fb, 0, 0, PW, PH));
+    fb.close();
+    unlink(path.c_str());
+}
+
+static bool appendBody(const uint8_t* data, size_t len, void* ctx) { ((std::string*)ctx)->append((const char*)data, len); return true; }
+
+static void testHttpFraming() {
+    StandinServer server;
+    CHECK(server.listen());
+    std::thread script([&] {
+        // Content-Length with trailing junk the client must not read as body
+        int c = server.accept(2000);
+        StandinServer::readHead(c);
+        StandinServer::send(c, "HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\ntime,trainsXXXX");
+        ::close(c);
+        // Close-delimited
+        c = server.accept(2000);
+        StandinServer::readHead(c);
+        StandinServer::send(c, "HTTP/1.0 200 OK\r\n\r\nfooter");
+        ::close(c);
+        // Error status, headers only
+        c = server.accept(2000);
+        StandinServer::readHead(c);
+        StandinServer::send(c, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        ::close(c);
+    });
+
+    ServerEndpoint ep;
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/prefix", server.port());
+    CHECK(parseServerUrl(url, ep));
+    PosixClient client;
+    std::string body;
+    HttpResult r = httpRequest(client, ep, "GET", "/api/zones?plain=1", nullptr, nullptr, 0, appendBody, &body);
+    CHECK(r.status == 200 && r.complete && r.contentLength == 11 && body == "time,trains");
+    body.clear();
+    r = httpRequest(client, ep, "GET", "/api/zones?plain=1", nullptr, nullptr, 0, appendBody, &body);
+    CHECK(r.status == 200 && r.complete && body == "footer");
+    body.clear();
+    r = httpRequest(client, ep, "GET", "/api/zones?plain=1", nullptr, nullptr, 0, appendBody, &body);
+    CHECK(r.status == 404 && body.empty());
+    script.join();
+    server.close();
+
+    // Chunk framing split at every byte, with an extension
+    HttpBodyReader reader;
+    reader.begin(-1, true);
+    std::string raw = "4;ext=1\r\ntime\r\n7\r\n,trains\r\n0\r\n\r\n";
+    body.clear();
+    size_t got = 0;
+    for (char ch : raw) CHECK(reader.feed((const uint8_t*)&ch, 1, appendBody, &body, got));
+    CHECK(reader.done() && body == "time,trains" && got == 11);
+}
+
+int main() {
+    testView();
+    testZoneFetch();
+    testHttpFraming();
+    return checkReport("kindle fb");
+}
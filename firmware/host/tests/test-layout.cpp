@@ -0,0 +1,221 @@
+/**
+ * Dashboard layout: generated tables, precomputed spans and the blits
+ *
+ * Regenerates include/dashboard_layout.hpp from layout/dashboard.layout
+ * and fails if the checked-in copy differs, so the firmware can't drift
+ * from the file the server reads. Then checks every generated span
+ * against one worked out pixel by pixel, that fields sit inside their
+ * zones, and that layoutBlitBmp() and layoutFill() leave the framebuffer
+ * exactly as a per-pixel reference does: every zone of both screens,
+ * every bit shift, both BMP row orders, and BMPs it must refuse.
+ *
+ * Usage: ./test-layout
+ */
+
+#include "layout_compile.hpp"
+#include "dashboard_layout.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+static const int FB_W = 800, FB_H = 480, PITCH = FB_W / 8;
+static std::mt19937 rng(42);
+
+static std::string readText(const char* path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { fprintf(stderr, "%s: can't read\n", path); exit(1); }
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static bool pixel(const std::vector<uint8_t>& fb, int x, int y) { return fb[(size_t)y * PITCH + x / 8] & (0x80 >> (x & 7)); }
+static void setPixel(std::vector<uint8_t>& fb, int x, int y, bool white) {
+    uint8_t& b = fb[(size_t)y * PITCH + x / 8];
+    b = white ? (uint8_t)(b | (0x80 >> (x & 7))) : (uint8_t)(b & ~(0x80 >> (x & 7)));
+}
+
+static std::vector<uint8_t> noise(size_t n) {
+    std::vector<uint8_t> v(n);
+    for (uint8_t& b : v) b = (uint8_t)rng();
+    return v;
+}
+
+/** A 1-bit BMP as canvasToBMP() writes it (topDown) or bottom-up; px: non-zero = white. */
+static std::vector<uint8_t> makeBmp(int w, int h, const std::vector<uint8_t>& px, bool topDown, bool whiteAt1 = true) {
+    int row = (w + 31) / 32 * 4;
+    std::vector<uint8_t> b(62 + (size_t)row * h, 0);
+    auto put32 = [&](size_t at, uint32_t v) { for (int i = 0; i < 4; i++) b[at + i] = (uint8_t)(v >> (8 * i)); };
+    b[0] = 'B'; b[1] = 'M';
+    put32(2, (uint32_t)b.size());
+    put32(10, 62);
+    put32(14, 40);
+    put32(18, (uint32_t)w);
+    put32(22, (uint32_t)(topDown ? -h : h));
+    b[26] = 1; b[28] = 1;
+    put32(34, (uint32_t)row * h);
+    put32(46, 2);
+    put32(whiteAt1 ? 58 : 54, 0x00FFFFFF);
+    for (int y = 0; y < h; y++) {
+        uint8_t* dst = &b[62 + (size_t)(topDown ? y : h - 1 - y) * row];
+        for (int x = 0; x < w; x++) if (px[(size_t)y * w + x]) dst[x / 8] |= (uint8_t)(0x80 >> (x & 7));
+        // Junk in the pad bits and bytes: the blit must not copy it
+        for (int x = w; x < row * 8; x++) if (rng() & 1) dst[x / 8] |= (uint8_t)(0x80 >> (x & 7));
+    }
+    return b;
+}
+
+static void testGenerated() {
+    LayoutSource src;
+    std::string err;
+    CHECK(layoutParseSource(readText(LAYOUT_SOURCE), src, err));
+    if (!err.empty()) fprintf(stderr, "%s: %s\n", LAYOUT_SOURCE, err.c_str());
+    if (layoutEmitHeader(src) != readText(LAYOUT_HEADER)) {
+        fprintf(stderr, "FAIL: %s is out of date with %s (cmake --build . --target layout)\n", LAYOUT_HEADER, LAYOUT_SOURCE);
+        failures++;
+    }
+    CHECK(src.crc == DASHBOARD_LAYOUT_CRC);
+    CHECK(src.screens.size() == 4 && (int)src.screens[0].zones.size() == DASH_ZONE_COUNT);
+}
+
+/** The span of a rectangle, derived one pixel at a time. */
+static void checkSpan(const LayoutSpan& s, int x, int y, int w) {
+    int firstByte = x / 8, lastByte = (x + w - 1) / 8;
+    uint8_t first = 0, last = 0;
+    for (int px = x; px < x + w; px++) {
+        if (px / 8 == firstByte) first |= (uint8_t)(0x80 >> (px & 7));
+        if (px / 8 == lastByte) last |= (uint8_t)(0x80 >> (px & 7));
+    }
+    CHECK(s.offset == y * PITCH + firstByte);
+    CHECK(s.shift == (x & 7));
+    CHECK(s.bytes == lastByte - firstByte + 1);
+    CHECK(s.firstMask == first && s.lastMask == last);
+}
+
+static void testTables() {
+    static_assert(DASH_PITCH == PITCH && TPL_PITCH == PITCH, "800 pixel screens");
+    for (int i = 0; i < DASH_ZONE_COUNT; i++) {
+        const ZoneDef& z = DASH_ZONES[i];
+        const LayoutZone& l = DASH_LAYOUT[i];
+        checkSpan(l.span, z.x, z.y, z.w);
+        CHECK(l.w == z.w && l.h == z.h && l.srcPitch == (z.w + 31) / 32 * 4);
+        CHECK(z.x + z.w <= DASH_W && z.y + z.h <= DASH_H);
+    }
+    for (int i = 0; i < TPL_ZONE_COUNT; i++) checkSpan(TPL_LAYOUT[i].span, TPL_ZONES[i].x, TPL_ZONES[i].y, TPL_ZONES[i].w);
+
+    auto fieldsInside = [](const LayoutField* fields, int n, const ZoneDef* zones) {
+        for (int i = 0; i < n; i++) {
+            const LayoutField& f = fields[i];
+            const ZoneDef& z = zones[f.zone];
+            checkSpan(f.span, f.x, f.y, f.w);
+            CHECK(f.repeat >= 1 && (f.repeat == 1 || f.step > 0));
+            CHECK(f.x >= z.x && f.y >= z.y && f.x + f.w <= z.x + z.w);
+            CHECK(f.y + (f.repeat - 1) * f.step + f.h <= z.y + z.h);
+            CHECK(f.tx >= f.x && f.ty >= f.y && f.tx < f.x + f.w && f.ty < f.y + f.h);
+        }
+    };
+    fieldsInside(DASH_FIELDS, DASH_FIELD_COUNT, DASH_ZONES);
+    fieldsInside(TPL_FIELDS, TPL_FIELD_COUNT, TPL_ZONES);
+
+    // Enums index the tables
+    CHECK(strcmp(DASH_ZONES[DASH_TRAINS].id, "trains") == 0);
+    CHECK(DASH_FIELDS[DASH_TRAMS_DEP].zone == DASH_TRAMS && strcmp(DASH_FIELDS[DASH_TRAMS_DEP].id, "dep") == 0);
+    CHECK(TPL_FIELDS[TPL_TRAINS_TIME].zone == TPL_TRAINS);
+
+    // Alignment: right-aligned text ends at the far padding
+    const LayoutField& arrive = DASH_FIELDS[DASH_FOOTER_ARRIVE];
+    const LayoutFont& font = LAYOUT_FONTS[arrive.font];
+    CHECK(layoutTextX(arrive, font, 5) + 5 * font.cellW == arrive.x + arrive.w - (arrive.tx - arrive.x));
+    CHECK(layoutTextX(arrive, font, 1000) == arrive.tx);
+    CHECK(layoutRowY(DASH_FIELDS[DASH_TRAINS_DEP], 2) == DASH_FIELDS[DASH_TRAINS_DEP].ty + 2 * DASH_FIELDS[DASH_TRAINS_DEP].step);
+}
+
+/** Blit a random zone image through layoutBlitBmp() and per pixel; both framebuffers must match. */
+static void checkBlit(const LayoutZone& l, int x, int y, bool topDown) {
+    std::vector<uint8_t> px(l.w * l.h);
+    for (uint8_t& p : px) p = rng() & 1;
+    std::vector<uint8_t> bmp = makeBmp(l.w, l.h, px, topDown);
+    std::vector<uint8_t> fb = noise((size_t)PITCH * FB_H), ref = fb;
+    for (int r = 0; r < l.h; r++)
+        for (int c = 0; c < l.w; c++) setPixel(ref, x + c, y + r, px[(size_t)r * l.w + c]);
+    CHECK(layoutBlitBmp(fb.data(), PITCH, l, bmp.data(), bmp.size()));
+    if (fb != ref) {
+        fprintf(stderr, "FAIL: blit of %dx%d at (%d,%d)%s differs from per-pixel\n", l.w, l.h, x, y, topDown ? "" : " bottom-up");
+        failures++;
+    }
+}
+
+static LayoutZone zoneAt(int x, int y, int w, int h) {
+    LayoutZone l = {layoutSpan(PITCH, x, y, w), (int16_t)w, (int16_t)h, (uint16_t)((w + 31) / 32 * 4), 0, 0};
+    return l;
+}
+
+static void testBlit() {
+    for (int i = 0; i < DASH_ZONE_COUNT; i++) {
+        checkBlit(DASH_LAYOUT[i], DASH_ZONES[i].x, DASH_ZONES[i].y, true);
+        checkBlit(DASH_LAYOUT[i], DASH_ZONES[i].x, DASH_ZONES[i].y, false);
+    }
+    for (int i = 0; i < TPL_ZONE_COUNT; i++) checkBlit(TPL_LAYOUT[i], TPL_ZONES[i].x, TPL_ZONES[i].y, true);
+    // Every shift, against widths that end inside, on and past a byte, up to the screen edge
+    for (int x = 0; x < 16; x++)
+        for (int w : {1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 370, 800 - x}) checkBlit(zoneAt(x, 100, w, 3), x, 100, x & 1);
+    checkBlit(zoneAt(799, 479, 1, 1), 799, 479, true);
+
+    // What it must leave to loadBMP, without touching the framebuffer
+    const LayoutZone& trains = DASH_LAYOUT[DASH_TRAINS];
+    std::vector<uint8_t> px(trains.w * trains.h, 1), fb = noise((size_t)PITCH * FB_H), before = fb;
+    std::vector<uint8_t> good = makeBmp(trains.w, trains.h, px, true);
+    CHECK(!layoutBlitBmp(fb.data(), PITCH, trains, good.data(), good.size() - 1));                    // truncated
+    std::vector<uint8_t> narrow = makeBmp(trains.w - 1, trains.h, std::vector<uint8_t>((trains.w - 1) * trains.h, 1), true);
+    CHECK(!layoutBlitBmp(fb.data(), PITCH, trains, narrow.data(), narrow.size()));                     // wrong size
+    std::vector<uint8_t> inverted = makeBmp(trains.w, trains.h, px, true, false);
+    CHECK(!layoutBlitBmp(fb.data(), PITCH, trains, inverted.data(), inverted.size()));                 // white at index 0
+    std::vector<uint8_t> fourBit = good;
+    fourBit[28] = 4;
+    CHECK(!layoutBlitBmp(fb.data(), PITCH, trains, fourBit.data(), fourBit.size()));
+    CHECK(fb == before);
+}
+
+static void testFill() {
+    for (int x = 0; x < 16; x++)
+        for (int w : {1, 6, 8, 9, 25, 360, 800 - x})
+            for (bool white : {false, true}) {
+                std::vector<uint8_t> fb = noise((size_t)PITCH * FB_H), ref = fb;
+                for (int r = 0; r < 4; r++) for (int c = x; c < x + w; c++) setPixel(ref, c, 200 + r, white);
+                layoutFill(fb.data(), PITCH, layoutSpan(PITCH, x, 200, w), 4, white);
+                CHECK(fb == ref);
+            }
+    // A zone background, as the offline view clears it
+    std::vector<uint8_t> fb((size_t)PITCH * FB_H, 0);
+    const ZoneDef& z = DASH_ZONES[DASH_TRAMS];
+    layoutFill(fb.data(), PITCH, DASH_LAYOUT[DASH_TRAMS].span, DASH_LAYOUT[DASH_TRAMS].h, true);
+    int white = 0;
+    for (int y = 0; y < FB_H; y++) for (int x = 0; x < FB_W; x++) white += pixel(fb, x, y);
+    CHECK(white == z.w * z.h && pixel(fb, z.x, z.y) && pixel(fb, z.x + z.w - 1, z.y + z.h - 1));
+}
+
+static void testBadSources() {
+    const std::string head = "version 1\nfont f 8x8 \"11px sans-serif\"\nscreen s 800 480\nzone z 10 10 100 50 1\n";
+    auto parses = [](const std::string& text) { LayoutSource src; std::string err; return layoutParseSource(text, src, err); };
+    CHECK(parses(head + "field a 0 0 100 50 f\n"));
+    CHECK(!parses(head + "field a 0 0 101 50 f\n"));                      // wider than the zone
+    CHECK(!parses(head + "field a 0 0 10 10 f repeat=5 step=11\n"));      // last row past the bottom
+    CHECK(parses(head + "field a 0 0 10 10 f repeat=5 step=10\n"));
+    CHECK(!parses(head + "field a 0 0 10 10 f repeat=2\n"));               // repeat without step
+    CHECK(!parses(head + "field a 0 0 10 10 g\n"));                        // unknown font
+    CHECK(!parses(head + "field a 0 0 10 10 f\nfield a 0 20 10 10 f\n"));  // duplicate
+    CHECK(!parses(head + "field a 0 0 10 10 f wobble=1\n"));
+    CHECK(!parses(head + "zone y 750 10 100 50 1\n"));                     // off the screen
+    CHECK(!parses("version 1\nzone z 0 0 10 10 1\n"));                     // no screen
+    CHECK(!parses("font f 7x9 \"x\"\n"));
+}
+
+int main() {
+    testGenerated();
+    testTables();
+    testBlit();
+    testFill();
+    testBadSources();
+    return checkReport("layout");
+}
@@ -0,0 +1,16 @@
+// Built with LOG_LEVEL=LOG_LEVEL_ERROR: everything above it must vanish, arguments included
+#undef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_ERROR
+#include "trmnl_log.hpp"
+
+int logOffCalls = 0;
+
+static int sideEffect() { return ++logOffCalls; }
+
+void logAtErrorLevel() {
+    LOG_ERROR("kept %d", sideEffect());
+    LOG_WARN("dropped %d", sideEffect());
+    LOG_INFO("dropped %d", sideEffect());
+    LOG_DEBUG("dropped %d", sideEffect());
+    LOG_VERBOSE("dropped %d", sideEffect());
+}
@@ -0,0 +1,131 @@
+/**
+ * Deferred logging: records decode back to what printf would have printed
+ *
+ * Logs a spread of argument types at LOG_LEVEL_VERBOSE, drains the ring,
+ * decodes the "#L" lines with the host decoder's formatter and compares
+ * against snprintf of the same call. Also checks that the ring evicts whole
+ * records and reports the drop, and that levels above LOG_LEVEL compile
+ * away without evaluating their arguments (test-log-off.cpp).
+ *
+ * Usage: ./test-log
+ */
+
+#include "trmnl_log.hpp"
+#include "log_format.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+extern int logOffCalls;
+void logAtErrorLevel();
+
+// Captures drained lines like a serial monitor would
+struct Capture {
+    std::string text;
+    void print(const char* s) { text += s; }
+    std::vector<std::string> lines() const {
+        std::vector<std::string> out;
+        size_t p = 0, nl;
+        while ((nl = text.find('\n', p)) != std::string::npos) { out.push_back(text.substr(p, nl - p)); p = nl + 1; }
+        return out;
+    }
+};
+
+static bool decodeLine(const std::string& line, LogRecord& rec) {
+    if (line.compare(0, 3, "#L ") != 0) return false;
+    static const std::string b64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::vector<uint8_t> raw;
+    uint32_t v = 0;
+    int bits = 0;
+    for (size_t i = 3; i < line.size() && line[i] != '='; i++) {
+        v = v << 6 | (uint32_t)b64.find(line[i]);
+        if ((bits += 6) >= 8) { bits -= 8; raw.push_back((v >> bits) & 0xFF); }
+    }
+    return logParseRecord(raw.data(), raw.size(), rec);
+}
+
+// On the device the decoder finds formats in the ELF; here, in a table of the ones we used
+static const char F_MIXED[] = "Zone %s: %d/%u tiles, %lu bytes, %.2f%%";
+static const char F_WIDE[] = "[%-8s] %5d %08x %lld %llu";
+static const char F_STAR[] = "Push v%lu: %.*s";
+static const char F_CHAR[] = "level %c, ptr %p, none";
+static const char* const FORMATS[] = {F_MIXED, F_WIDE, F_STAR, F_CHAR};
+
+static const char* lookup(uint32_t addr) {
+    for (const char* f : FORMATS) if ((uint32_t)(uintptr_t)f == addr) return f;
+    return nullptr;
+}
+
+int main() {
+    // 1. Round trip against printf
+    char expect[4][160];
+    const char* zones = "time,trains,trams,coffee,footer";   // %.*s takes a prefix
+    long long big = -5000000000LL;
+    unsigned long long ubig = 18000000000000000000ULL;
+    LOG_INFO(F_MIXED, "trains", 14, 15u, 2040ul, 93.75);
+    snprintf(expect[0], sizeof(expect[0]), F_MIXED, "trains", 14, 15u, 2040ul, 93.75);
+    LOG_DEBUG(F_WIDE, "coffee", -42, 0xBEEFu, big, ubig);
+    snprintf(expect[1], sizeof(expect[1]), F_WIDE, "coffee", -42, 0xBEEFu, big, ubig);
+    LOG_WARN(F_STAR, 42ul, 11, zones);
+    snprintf(expect[2], sizeof(expect[2]), F_STAR, 42ul, 11, zones);
+    LOG_VERBOSE(F_CHAR, 'V', (void*)nullptr);
+    snprintf(expect[3], sizeof(expect[3]), "level %c, ptr 0x0, none", 'V');
+
+    Capture cap;
+    size_t n = logDrain(cap);
+    CHECK(n == cap.text.size());
+    std::vector<std::string> lines = cap.lines();
+    CHECK(lines.size() == 4);
+    const uint8_t levels[] = {LOG_LEVEL_INFO, LOG_LEVEL_DEBUG, LOG_LEVEL_WARN, LOG_LEVEL_VERBOSE};
+    for (size_t i = 0; i < lines.size() && i < 4; i++) {
+        LogRecord rec;
+        CHECK(decodeLine(lines[i], rec));
+        CHECK(rec.level == levels[i]);
+        const char* fmt = lookup(rec.fmt);
+        CHECK(fmt == FORMATS[i]);
+        if (!fmt) continue;
+        std::string got = logFormat(fmt, rec.args);
+        if (got != expect[i]) fprintf(stderr, "  got    \"%s\"\n  expect \"%s\"\n", got.c_str(), expect[i]);
+        CHECK(got == expect[i]);
+    }
+    CHECK(logRing().used() == 0);
+
+    // 2. Long strings are clipped to LOG_STR_MAX, not dropped
+    std::string longId(200, 'x');
+    LOG_INFO(F_MIXED, longId.c_str(), 1, 2u, 3ul, 4.0);
+    cap.text.clear();
+    logDrain(cap);
+    LogRecord rec;
+    CHECK(decodeLine(cap.lines().at(0), rec) && rec.args.size() == 5 && rec.args[0].s.size() == LOG_STR_MAX);
+
+    // 3. A full ring evicts the oldest whole records and reports how many
+    uint32_t before = logRing().written();
+    for (int i = 0; i < 1000; i++) LOG_INFO(F_MIXED, "trams", i, 0u, 0ul, 0.0);
+    CHECK(logRing().written() - before == 1000);
+    CHECK(logRing().dropped() > 0 && logRing().used() <= LOG_RING_SIZE);
+    cap.text.clear();
+    while (logDrain(cap, 1000) > 0) {}
+    lines = cap.lines();
+    CHECK(lines.size() > 1 && lines[0].compare(0, 11, "#L dropped ") == 0);
+    uint32_t dropped = (uint32_t)atol(lines[0].c_str() + 11);
+    CHECK(dropped + (lines.size() - 1) == 1000);
+    // Survivors are the newest, in order
+    int expectI = (int)dropped;
+    for (size_t i = 1; i < lines.size(); i++) {
+        CHECK(decodeLine(lines[i], rec) && rec.args.size() == 5);
+        CHECK(rec.args[1].i == expectI++);
+    }
+    CHECK(logRing().dropped() == 0);
+
+    // 4. Compiled-out levels don't evaluate their arguments
+    logRing().clear();
+    logAtErrorLevel();
+    CHECK(logOffCalls == 1);
+    cap.text.clear();
+    logDrain(cap);
+    CHECK(cap.lines().size() == 1);
+
+    return checkReport("log");
+}
@@ -0,0 +1,164 @@
+/**
+ * Deadline-driven reads against a stand-in server
+ *
+ * Covers a whole body, a peer that closes early, a server that stalls
+ * mid-body, the transfer budget, the cycle budget cutting a transfer
+ * short, and that waiting sleeps in select() instead of spinning. Bodies
+ * with no length, chunked or up to the close, must come through whole or
+ * fail: one that is cut short or needs more than the buffer holds is
+ * never handed on truncated.
+ *
+ * Usage: ./test-net-deadline
+ */
+
+#include "net_deadline.hpp"
+#include "posix_client.hpp"
+#include "standin_server.hpp"
+#include "check.hpp"
+
+#include <time.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sends `parts` with `gapMs` between them, then closes (or holds the socket for holdMs)
+static std::thread serve(StandinServer& srv, std::vector<std::string> parts, int gapMs, int holdMs = 0) {
+    return std::thread([&srv, parts, gapMs, holdMs] {
+        int c = srv.accept(2000);
+        if (c < 0) return;
+        for (size_t i = 0; i < parts.size(); i++) {
+            if (i) delay(gapMs);
+            StandinServer::send(c, parts[i]);
+        }
+        if (holdMs) delay(holdMs);
+        ::close(c);
+    });
+}
+
+static double cpuMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void testWholeBody() {
+    StandinServer srv; CHECK(srv.listen());
+    std::thread t = serve(srv, {"hello ", "world"}, 50);
+    PosixClient c; CHECK(c.connect("127.0.0.1", srv.port()));
+    NetDeadline cycle(2000);
+    NetReader<PosixClient> rd(c, cycle);
+    uint8_t buf[32];
+    size_t got = rd.readFully(buf, 11);
+    CHECK(got == 11 && memcmp(buf, "hello world", 11) == 0);
+    CHECK(rd.status() == NET_OK);
+    CHECK(rd.read(buf, sizeof(buf)) == 0 && rd.status() == NET_EOF);
+    t.join();
+}
+
+static void testEarlyClose() {
+    StandinServer srv; CHECK(srv.listen());
+    std::thread t = serve(srv, {"abc"}, 0);
+    PosixClient c; CHECK(c.connect("127.0.0.1", srv.port()));
+    NetDeadline cycle(2000);
+    NetReader<PosixClient> rd(c, cycle);
+    uint8_t buf[16];
+    CHECK(rd.readFully(buf, 10) == 3);
+    CHECK(rd.status() == NET_EOF && rd.bytes() == 3);
+    t.join();
+}
+
+static void testStall() {
+    StandinServer srv; CHECK(srv.listen());
+    // One byte, then silence well past NET_STALL_MS with the socket still open
+    std::thread t = serve(srv, {"x"}, 0, NET_STALL_MS + 500);
+    PosixClient c; CHECK(c.connect("127.0.0.1", srv.port()));
+    NetDeadline cycle(NET_STALL_MS * 4);
+    NetReader<PosixClient> rd(c, cycle);
+    uint8_t buf[16];
+    double cpu0 = cpuMs();
+    CHECK(rd.readFully(buf, 10) == 1);
+    CHECK(rd.status() == NET_STALLED);
+    CHECK(rd.elapsed() >= NET_STALL_MS && rd.elapsed() < NET_STALL_MS + 400);
+    // Blocked in select(), not spinning: a few ms of CPU over seconds of waiting
+    CHECK(cpuMs() - cpu0 < 100);
+    c.stop();
+    t.join();
+}
+
+static void testTransferBudget() {
+    StandinServer srv; CHECK(srv.listen());
+    // A trickle: never stalls, but never finishes inside the transfer budget
+    std::thread t = serve(srv, std::vector<std::string>(12, "."), 100);
+    PosixClient c; CHECK(c.connect("127.0.0.1", srv.port()));
+    NetDeadline cycle(5000);
+    NetReader<PosixClient> rd(c, cycle, 450);
+    uint8_t buf[16];
+    size_t got = rd.readFully(buf, 12);
+    CHECK(got >= 3 && got <= 6);
+    CHECK(rd.status() == NET_TIMEOUT);
+    c.stop();
+    t.join();
+}
+
+static void testCycleBudget() {
+    StandinServer srv; CHECK(srv.listen());
+    std::thread t = serve(srv, std::vector<std::string>(12, "."), 100);
+    PosixClient c; CHECK(c.connect("127.0.0.1", srv.port()));
+    NetDeadline cycle(350);
+    CHECK(cycle.clamp(NET_TTFB_MS) <= 350);
+    NetReader<PosixClient> rd(c, cycle);
+    uint8_t buf[16];
+    size_t got = rd.readFully(buf, 12);
+    CHECK(got >= 2 && got <= 5);
+    CHECK(rd.status() == NET_CYCLE_SPENT);
+    CHECK(cycle.expired() && cycle.clamp(NET_CONNECT_MS) == 0);
+    // Once spent, a reader on the same cycle gives up without waiting
+    NetReader<PosixClient> late(c, cycle);
+    unsigned long t0 = millis();
+    CHECK(late.read(buf, 1) == 0 && late.status() == NET_CYCLE_SPENT);
+    CHECK(millis() - t0 < 50);
+    c.stop();
+    t.join();
+}
+
+// netReadUnsized() over one response body, split into parts as given
+static bool unsized(std::vector<std::string> parts, bool chunked, size_t cap, std::string& out) {
+    StandinServer srv; CHECK(srv.listen());
+    std::thread t = serve(srv, parts, 10);
+    PosixClient c; CHECK(c.connect("127.0.0.1", srv.port()));
+    NetDeadline cycle(2000);
+    NetReader<PosixClient> rd(c, cycle);
+    std::vector<uint8_t> buf(cap);
+    size_t got;
+    bool ok = netReadUnsized(rd, chunked, buf.data(), cap, got);
+    out.assign((const char*)buf.data(), got);
+    c.stop();
+    t.join();
+    return ok;
+}
+
+static void testUnsized() {
+    std::string out;
+    // Chunks split across reads, an extension and a trailer
+    CHECK(unsized({"5\r\ntime,\r\n0", "e;x=y\r\nweather,trains\r\n0\r\nX-T: 1\r\n\r\n"}, true, 159, out));
+    CHECK(out == "time,weather,trains");
+    // The list exactly fills the buffer; one byte more doesn't fit
+    CHECK(unsized({"6\r\ntrains\r\n0\r\n\r\n"}, true, 6, out) && out == "trains");
+    CHECK(!unsized({"6\r\ntrains\r\n6\r\n,trams\r\n0\r\n\r\n"}, true, 10, out));
+    // Cut off before the last chunk, and a size line that isn't hex
+    CHECK(!unsized({"6\r\ntrains\r\n"}, true, 159, out) && out == "trains");
+    CHECK(!unsized({"zz\r\ntrains\r\n0\r\n\r\n"}, true, 159, out));
+    // Up to the close: whole, or too long for the buffer
+    CHECK(unsized({"time,", "footer"}, false, 11, out) && out == "time,footer");
+    CHECK(!unsized({"time,", "footer!"}, false, 11, out));
+}
+
+int main() {
+    testWholeBody();
+    testEarlyClose();
+    testStall();
+    testTransferBudget();
+    testCycleBudget();
+    testUnsized();
+    return checkReport("net deadline");
+}
@@ -0,0 +1,261 @@
+/**
+ * Network faults: the retry policy, the emulator, a fleet and the firmware
+ *
+ * RetryPolicy must keep every wait between its base and three times the
+ * last one (under the cap), drift two devices apart after one shared
+ * failure, open its breaker after a run of failures, let one probe through
+ * when the open time is up and close on a success. NetEmulator must parse
+ * a script (and say which line is bad), layer overlapping windows, charge
+ * each kind of failure what it costs and give the same outcomes for the
+ * same seed. The outage simulator has to show a power cut that a fixed
+ * 5 s retry never recovers from and that the jittered policy does.
+ *
+ * Then src/zones-v12.cpp runs on the replay shims through a scripted
+ * network: the server refuses connections for its first 30 s, so it boots
+ * into failed polls that must be spaced by the retry policy, and later
+ * the link is gone for three minutes, which opens the breaker; it must
+ * draw once the server is back each time and end with the policy reset.
+ *
+ * Usage: ./test-net-faults
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "energy_model.hpp"
+#include "net_retry.hpp"
+#include "outage_sim.hpp"
+#include "zone_layout.hpp"
+#include "zone_tiles.hpp"
+#include "check.hpp"
+
+#include <set>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern int failedPolls;
+const RetryPolicy& pollRetry();
+extern EnergyCadence cadence;
+
+static void testRetryPolicy() {
+    RetryPolicy a(1000, 20000, 4, 60000);
+    a.seed(7);
+    CHECK(a.ready(0) && a.msUntilReady(0) == 0 && a.state(0) == RETRY_CLOSED);
+    uint32_t prev = 1000;
+    for (int i = 0; i < 3; i++) {
+        uint32_t w = a.failure(1000 * i);
+        CHECK(w >= 1000 && w <= (prev * 3 < 20000 ? prev * 3 : 20000));
+        CHECK(!a.ready(1000 * i) && a.msUntilReady(1000 * i) == w && a.ready(1000 * i + w));
+        prev = w;
+    }
+    CHECK(a.state(3000) == RETRY_CLOSED && a.opened() == 0);
+    // The fourth failure in a row opens it for 30..60 s, then one probe
+    uint32_t open = a.failure(10000);
+    CHECK(open >= 30000 && open <= 60000);
+    CHECK(a.state(10000) == RETRY_OPEN && a.opened() == 1);
+    CHECK(!a.ready(10000 + open - 1) && a.state(10000 + open) == RETRY_HALF_OPEN);
+    // A failed probe opens it again (not counted as a new opening); a good one closes it
+    uint32_t again = a.failure(10000 + open);
+    CHECK(again >= 30000 && again <= 60000 && a.state(10000 + open) == RETRY_OPEN && a.opened() == 1);
+    a.success();
+    CHECK(a.ready(10000 + open) && a.state(10000 + open) == RETRY_CLOSED && a.failures() == 0);
+
+    // The cap holds however long it goes on, short of the breaker
+    RetryPolicy capped(2000, 30000, 0, 0);
+    for (int i = 0; i < 200; i++) { uint32_t w = capped.failure(0); CHECK(w >= 2000 && w <= 30000); }
+
+    // Same failure, different seeds: different waits, and they stay apart
+    RetryPolicy x, y;
+    x.seed(1); y.seed(2);
+    int same = 0;
+    for (int i = 0; i < 5; i++) same += x.failure(0) == y.failure(0);
+    CHECK(same < 2);
+}
+
+static void testEmulator() {
+    NetEmulator net(3);
+    std::string error;
+    CHECK(net.parse("# base\n0 * rtt=40 jitter=10 kbps=800\n10s 20s loss=1 # gone\n30s 40s dns=fail\n"
+                    "50s 60s tls=fail\n70s 80s refuse\n90s 100s status=503\n110s 2m loss=0.5\n", error));
+    CHECK(net.windows().size() == 7);
+    NetConditions c = net.at(15000);
+    CHECK(c.rttMs == 40 && c.loss == 1 && c.kbps == 800);      // the base shows through
+    CHECK(net.at(0).faulty() == false && net.at(95000).status == 503);
+    CHECK(net.down(15000) && net.down(75000) && !net.down(35000) && !net.down(5000));
+    uint64_t from = 0, to = 0;
+    CHECK(net.faultSpan(from, to) && from == 10000 && to == 120000);
+    CHECK(net.transfer(0, 1000) == 10);                         // 8000 bits at 800 kbps
+
+    NetAttempt ok = net.request(0, true, 3000);
+    CHECK(!ok.fault && ok.status == 0 && ok.ms >= 4 * 30 && ok.ms <= 4 * 50);   // TCP, two TLS round trips, the request
+    NetAttempt plain = net.request(0, false, 3000);
+    CHECK(!plain.fault && plain.ms >= 2 * 30 && plain.ms <= 2 * 50);
+    CHECK(net.request(15000, false, 3000).fault == NET_FAULT_LOST && net.request(15000, false, 3000).ms == 3000);
+    CHECK(net.request(35000, false).fault == NET_FAULT_DNS && net.request(35000, false).ms == NET_EMU_DNS_TIMEOUT_MS);
+    CHECK(net.request(55000, true).fault == NET_FAULT_TLS && net.request(55000, false).fault == NET_FAULT_NONE);
+    CHECK(net.request(75000, false).fault == NET_FAULT_REFUSED);
+    NetAttempt shed = net.request(95000, false);
+    CHECK(!shed.fault && shed.status == 503);
+    int lost = 0;
+    for (int i = 0; i < 1000; i++) lost += net.request(115000, false).fault == NET_FAULT_LOST;
+    CHECK(lost > 700 && lost < 800);                            // the connect or the request: 1 - 0.5^2
+    CHECK(net.faults(NET_FAULT_LOST) == (uint64_t)lost + 2 && net.faults(NET_FAULT_DNS) == 2);
+
+    // The same script and seed: the same outcomes
+    NetEmulator a(9), b(9);
+    CHECK(a.parse("0 * rtt=20 jitter=20 loss=0.3\n", error) && b.parse("0 * rtt=20 jitter=20 loss=0.3\n", error));
+    bool same = true;
+    for (int i = 0; i < 100; i++) {
+        NetAttempt p = a.request(i * 1000, true), q = b.request(i * 1000, true);
+        same &= p.fault == q.fault && p.ms == q.ms;
+    }
+    CHECK(same);
+
+    const char* bad[] = {"10s\n", "20s 10s loss=1\n", "0 * loss=2\n", "0 * dns=maybe\n", "0 * bogus=1\n", "0 5x rtt=1\n"};
+    for (const char* s : bad) {
+        NetEmulator e;
+        error.clear();
+        CHECK(!e.parse(std::string("0 * rtt=5\n") + s, error) && error.find("line 2") == 0);
+    }
+}
+
+static void testOutageSim() {
+    OutageConfig cfg;
+    cfg.devices = 1000;
+    cfg.capacity = 30;                 // steady load is 16.7 polls/s
+    cfg.cold = true;
+    cfg.durationMs = 1200000;
+    OutageReport r[OUTAGE_POLICIES];
+    for (int p = 0; p < OUTAGE_POLICIES; p++) {
+        NetEmulator net(1);
+        std::string error;
+        CHECK(net.parse("5m 8m loss=1\n", error));
+        cfg.policy = (OutagePolicy)p;
+        OutageSim sim(cfg, net);
+        sim.run();
+        r[p] = sim.report();
+        CHECK(r[p].outage && r[p].outageFromMs == 300000 && r[p].outageToMs == 480000);
+        CHECK(r[p].steadyPerSec > 16.6 && r[p].steadyPerSec < 16.7);
+        // Everyone boots within the spread: the first seconds after the cut are the busiest
+        CHECK(r[p].peakPerSec >= 200);
+    }
+    // A 5 s retry keeps the server full of polls that time out: part of the fleet never gets back
+    CHECK(r[OUTAGE_FIXED].unrecovered > 0 && r[OUTAGE_FIXED].timedOut > r[OUTAGE_FIXED].ok);
+    // Jitter and the breaker bring everyone back, with fewer polls than either old policy
+    CHECK(r[OUTAGE_JITTER].unrecovered == 0 && r[OUTAGE_JITTER].breakerOpens > 0);
+    CHECK(r[OUTAGE_JITTER].recovery(1.0) < 600000);
+    CHECK(r[OUTAGE_JITTER].amplification < r[OUTAGE_FIXED].amplification);
+    CHECK(r[OUTAGE_JITTER].attempts < r[OUTAGE_BACKOFF].attempts);
+
+    // An outage the fleet rides out with its picture: retries wait for the poll interval, no storm
+    cfg.cold = false;
+    cfg.capacity = 0;
+    cfg.policy = OUTAGE_JITTER;
+    NetEmulator net(1);
+    std::string error;
+    CHECK(net.parse("5m 8m refuse\n", error));
+    OutageSim warm(cfg, net);
+    warm.run();
+    CHECK(warm.report().unrecovered == 0 && warm.report().recovery(1.0) <= cfg.pollMs + RETRY_BASE_MS);
+    CHECK(warm.report().amplification < 1.05);
+}
+
+// ---------------------------------------------------------------------------
+// zones-v12 through a scripted network
+
+static std::string tiles(const ZoneDef& z) {
+    std::string s = {'Z', 'T', TILE_VERSION, 0, TILE_W, TILE_H};
+    auto put16 = [&](int v) { s += (char)(v & 0xFF); s += (char)((v >> 8) & 0xFF); };
+    put16(z.x); put16(z.y); put16(z.w); put16(z.h); put16(0);
+    return s;
+}
+
+static TraceExchange exchange(const char* method, const std::string& path, const std::string& body) {
+    TraceExchange ex;
+    ex.method = method; ex.path = path;
+    ex.status = 200; ex.ms = 100;
+    ex.respHeaders.push_back({"Content-Length", std::to_string(body.size())});
+    ex.body = body;
+    return ex;
+}
+
+static void testFirmware() {
+    HttpTrace trace;
+    trace.startEpochMs = 1760000000000ull;
+    trace.exchanges.push_back(exchange("GET", "/api/zones?plain=1&force=true", "time,weather,trains,trams,coffee,footer"));
+    trace.exchanges.push_back(exchange("GET", "/api/zones?plain=1", ""));
+    for (int i = 0; i < ZONE_COUNT; i++)
+        trace.exchanges.push_back(exchange("POST", std::string("/api/zone/") + ZONES[i].id + "/tiles", tiles(ZONES[i])));
+    // Button pages are prefetched after the first draw; what they hold doesn't matter here
+    trace.exchanges.push_back(exchange("GET", "/api/page/departures", ""));
+    trace.exchanges.push_back(exchange("GET", "/api/page/alerts", ""));
+    // The push stream is up from the start with a heartbeat every 15 s
+    TraceStreamEvent open;
+    open.kind = STREAM_OPEN; open.status = 200; open.data = "/api/zones/stream";
+    trace.stream.push_back(open);
+    for (uint64_t t = 15000; t <= 420000; t += 15000) {
+        TraceStreamEvent hb;
+        hb.t = t; hb.data = ": hb\n\n";
+        trace.stream.push_back(hb);
+    }
+    ReplayIndex index(trace);
+
+    NetEmulator net(5);
+    std::string error;
+    CHECK(net.parse("0 * rtt=30 jitter=10\n0 30s refuse\n2m 5m loss=1\n", error));
+    replayEnv.server = &index;
+    replayEnv.net = &net;
+    replayEnv.endMs = 420000;
+    Preferences prefs;
+    prefs.begin("ptv-trmnl");
+    prefs.putString("serverUrl", "http://replay.local");
+    prefs.end();
+
+    setup();
+    std::vector<uint64_t> failedAt;
+    uint64_t firstFull = 0, backAt = 0;
+    int cycles = 0, lastFailed = 0, maxFailed = 0;
+    uint32_t opened = 0;
+    while (replayEnv.nowMs() <= replayEnv.endMs && cycles < 20000) {
+        replayEnv.cycle = ReplayCycle();
+        replayEnv.cycle.startMs = replayEnv.nowMs();
+        loop();
+        cycles++;
+        if (failedPolls > lastFailed) failedAt.push_back(replayEnv.cycle.startMs);
+        if (failedPolls > maxFailed) maxFailed = failedPolls;
+        if (replayEnv.cycle.full && !firstFull) firstFull = replayEnv.cycle.startMs;
+        if (replayEnv.cycle.startMs >= 300000 && lastFailed && !failedPolls && !backAt) backAt = replayEnv.cycle.startMs;
+        lastFailed = failedPolls;
+        if (pollRetry().opened() > opened) opened = pollRetry().opened();
+    }
+    CHECK(cycles < 20000);
+    CHECK(replayEnv.cycle.unmatched == 0);
+
+    // Booted into a refusing server: failed polls, never closer than the base wait, then the first draw
+    int early = 0;
+    for (size_t i = 0; i < failedAt.size() && failedAt[i] < 30000; i++) {
+        early++;
+        if (i) CHECK(failedAt[i] - failedAt[i - 1] >= RETRY_BASE_MS);
+    }
+    CHECK(early >= 3 && early <= 10);
+    CHECK(firstFull >= 30000 && firstFull < 30000 + RETRY_CAP_MS);
+
+    // Three minutes without a link: polls fail on the interval until the breaker opens, then it's back
+    int late = 0;
+    for (uint64_t t : failedAt) if (t >= 120000) late++;
+    CHECK(late >= RETRY_BREAKER_FAILURES && maxFailed >= RETRY_BREAKER_FAILURES);
+    CHECK(opened >= 1);
+    CHECK(backAt > 300000 && backAt < 300000 + RETRY_BREAKER_OPEN_MS + cadence.pollMs);
+    CHECK(failedPolls == 0 && pollRetry().failures() == 0 && pollRetry().state(millis()) == RETRY_CLOSED);
+    CHECK(net.faults(NET_FAULT_REFUSED) >= 3 && net.faults(NET_FAULT_LOST) >= RETRY_BREAKER_FAILURES);
+    replayEnv.net = nullptr;
+}
+
+int main() {
+    testRetryPolicy();
+    testEmulator();
+    testOutageSim();
+    testFirmware();
+    return checkReport("net-faults");
+}
@@ -0,0 +1,151 @@
+/**
+ * Resumable bodies: a body cut short, picked up by range
+ *
+ * Plays the server's side of each exchange: a 200 that drops partway, the
+ * 206 with the rest, a body that changed in between (200 again), ranges
+ * that don't continue what is held, a tail that fails the CRC, bodies
+ * without a strong ETag, and the retry limits.
+ *
+ * Usage: ./test-net-resume
+ */
+
+#include "net_resume.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> bodyOf(size_t n, unsigned seed) {
+    std::vector<uint8_t> b(n);
+    for (size_t i = 0; i < n; i++) b[i] = (uint8_t)(i * 31 + seed);
+    return b;
+}
+
+static std::string hex(uint32_t v) {
+    char s[9];
+    snprintf(s, sizeof(s), "%08lx", (unsigned long)v);
+    return s;
+}
+
+static std::string tag(const std::vector<uint8_t>& b) { return "\"" + hex(ttCrc32(b.data(), b.size())) + "\""; }
+
+static std::string contentRange(size_t first, size_t total) {
+    return "bytes " + std::to_string(first) + "-" + std::to_string(total - 1) + "/" + std::to_string(total);
+}
+
+// The first response: a 200 that delivers only `upTo` bytes of b into buf
+static void firstPart(NetResume& rs, const std::vector<uint8_t>& b, std::vector<uint8_t>& buf, size_t upTo) {
+    std::string t = tag(b), crc = hex(ttCrc32(b.data(), b.size()));
+    long at = rs.start(200, (long)b.size(), "", t.c_str(), crc.c_str(), buf.size());
+    CHECK(at == 0);
+    memcpy(buf.data(), b.data(), upTo);
+    rs.advance(buf.data(), upTo);
+}
+
+int main() {
+    // 1. Header parsing
+    uint32_t crc = 0;
+    CHECK(netParseCrc("\"deadBEEF\"", crc) && crc == 0xDEADBEEF);
+    CHECK(netParseCrc("0000002a", crc) && crc == 42);
+    CHECK(!netParseCrc("W/\"deadbeef\"", crc) && !netParseCrc("deadbee", crc) && !netParseCrc("deadbeef0", crc) && !netParseCrc(nullptr, crc));
+    size_t first, last, total;
+    CHECK(netParseContentRange("bytes 100-199/200", first, last, total) && first == 100 && last == 199 && total == 200);
+    CHECK(!netParseContentRange("bytes */200", first, last, total));
+    CHECK(!netParseContentRange("bytes 200-199/200", first, last, total));
+    CHECK(!netParseContentRange("bytes 0-200/200", first, last, total));
+    CHECK(!netParseContentRange("items 0-1/2", first, last, total) && !netParseContentRange(nullptr, first, last, total));
+
+    // 2. Dropped at 3000 of 10000, the rest by range: whole, verified, nothing sent twice
+    std::vector<uint8_t> b = bodyOf(10000, 1), buf(16384);
+    std::string t = tag(b), crcHex = hex(ttCrc32(b.data(), b.size()));
+    NetResume rs;
+    CHECK(!rs.resuming());
+    firstPart(rs, b, buf, 3000);
+    CHECK(!rs.complete() && rs.want() == 7000);
+    CHECK(rs.retry(NET_STALLED, 1000) && rs.resuming());
+    CHECK(strcmp(rs.range(), "bytes=3000-") == 0 && rs.etag() == t);
+    std::string cr = contentRange(3000, b.size());
+    long at = rs.start(206, 7000, cr.c_str(), t.c_str(), crcHex.c_str(), buf.size());
+    CHECK(at == 3000);
+    memcpy(buf.data() + at, b.data() + at, 7000);
+    rs.advance(buf.data() + at, 7000);
+    CHECK(rs.complete() && rs.verified() && memcmp(buf.data(), b.data(), b.size()) == 0);
+    CHECK(rs.resumes() == 1 && rs.retransmitted() == 0 && rs.dropped() && rs.recoverMs(1450) == 450);
+
+    // 3. Changed meanwhile: If-Range doesn't match, the server sends the new body whole
+    NetResume changed;
+    firstPart(changed, b, buf, 4000);
+    CHECK(changed.retry(NET_EOF, 10));
+    std::vector<uint8_t> b2 = bodyOf(9000, 2);
+    std::string t2 = tag(b2), crc2 = hex(ttCrc32(b2.data(), b2.size()));
+    CHECK(changed.start(200, (long)b2.size(), "", t2.c_str(), crc2.c_str(), buf.size()) == 0);
+    memcpy(buf.data(), b2.data(), b2.size());
+    changed.advance(buf.data(), b2.size());
+    CHECK(changed.verified() && changed.resumes() == 0 && changed.retransmitted() == 4000 && changed.etag() == t2);
+
+    // 4. Ranges that don't continue what is held
+    struct { int code; long len; std::string range, etag; } bad[] = {
+        {206, 6000, contentRange(4000, 10000), t},              // starts past the held bytes
+        {206, 9000, contentRange(3000, 12000), t},              // another total
+        {206, 7000, "bytes 3000-9998/10000", t},                // stops short of the end
+        {206, 7001, contentRange(3000, 10000), t},              // length disagrees
+        {206, 7000, contentRange(3000, 10000), t2},             // another body's tag
+        {206, 7000, "", t},                                     // no Content-Range
+        {416, 0, "bytes */10000", t},
+        {304, 0, "", t},
+    };
+    for (const auto& x : bad) {
+        NetResume r;
+        firstPart(r, b, buf, 3000);
+        CHECK(r.retry(NET_STALLED, 5));
+        CHECK(r.start(x.code, x.len, x.range.c_str(), x.etag.c_str(), crcHex.c_str(), buf.size()) < 0);
+    }
+    {
+        // Another body's CRC on the tail
+        NetResume r;
+        firstPart(r, b, buf, 3000);
+        CHECK(r.retry(NET_STALLED, 5));
+        CHECK(r.start(206, 7000, cr.c_str(), t.c_str(), crc2.c_str(), buf.size()) < 0);
+    }
+
+    // 5. A tail whose bytes are wrong fails the whole body's CRC
+    NetResume corrupt;
+    firstPart(corrupt, b, buf, 3000);
+    CHECK(corrupt.retry(NET_STALLED, 5));
+    CHECK(corrupt.start(206, 7000, cr.c_str(), t.c_str(), "", buf.size()) == 3000);
+    std::vector<uint8_t> tail(b.begin() + 3000, b.end());
+    tail[1234] ^= 0x10;
+    corrupt.advance(tail.data(), tail.size());
+    CHECK(corrupt.complete() && !corrupt.verified());
+
+    // 6. No strong ETag, no resume: a drop loses the body as before
+    NetResume weak;
+    CHECK(weak.start(200, 10000, "", "W/\"2710-abc\"", "", buf.size()) == 0);
+    weak.advance(b.data(), 3000);
+    CHECK(!weak.resuming() && !weak.retry(NET_STALLED, 5));
+    NetResume untagged;
+    CHECK(untagged.start(200, 10000, "", "", "", buf.size()) == 0);
+    untagged.advance(b.data(), 3000);
+    CHECK(!untagged.retry(NET_STALLED, 5));
+    // Without X-Body-CRC a whole body is all there is to check
+    untagged.advance(b.data() + 3000, 7000);
+    CHECK(untagged.verified());
+
+    // 7. Limits: NET_RESUME_TRIES requests per body, no retry once the cycle is spent, cap
+    NetResume tries;
+    firstPart(tries, b, buf, 1000);
+    for (int i = 1; i < NET_RESUME_TRIES; i++) {
+        CHECK(tries.retry(NET_STALLED, 5));
+        std::string r = contentRange(tries.got(), b.size());
+        CHECK(tries.start(206, (long)tries.want(), r.c_str(), t.c_str(), crcHex.c_str(), buf.size()) == (long)tries.got());
+        tries.advance(b.data() + tries.got(), 1000);
+    }
+    CHECK(!tries.retry(NET_STALLED, 5) && tries.resumes() == NET_RESUME_TRIES - 1);
+    NetResume spent;
+    firstPart(spent, b, buf, 1000);
+    CHECK(!spent.retry(NET_CYCLE_SPENT, 5));
+    NetResume big;
+    CHECK(big.start(200, 20000, "", t.c_str(), crcHex.c_str(), buf.size()) < 0 && big.start(200, -1, "", "", "", buf.size()) < 0);
+
+    return checkReport("net resume");
+}
@@ -0,0 +1,352 @@
+/**
+ * Delta OTA: generate patches and apply them to a file-backed fake flash
+ *
+ * The old image is read from one file and the new one written into
+ * another that stands in for the inactive app partition: erased to 0xFF,
+ * written sequentially, and a write may only clear bits as on NOR flash.
+ * Patches are fed in uneven pieces, like network reads. Covers relinked
+ * code (moved blocks, shifted addresses), an unrelated image, identical
+ * and empty images, a patch for another base, a corrupted patch and a
+ * truncated one, a patch signed with another key or altered after signing,
+ * and records whose 64-bit lengths would wrap a sum. Ed25519 and SHA-512
+ * are checked against RFC 8032's and FIPS 180's vectors.
+ *
+ * Usage: ./test-ota-delta
+ */
+
+#include "ota_diff.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+
+#define PARTITION_SIZE (512 * 1024)
+
+static std::vector<uint8_t> unhex(const char* s) {
+    std::vector<uint8_t> out;
+    for (; s[0] && s[1]; s += 2) out.push_back((uint8_t)std::stoi(std::string(s, 2), nullptr, 16));
+    return out;
+}
+
+// The release key: RFC 8032's first test seed, and its public key
+static const std::vector<uint8_t> SEED = unhex("9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60");
+static const std::vector<uint8_t> KEY = unhex("d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a");
+
+static std::vector<uint8_t> diff(const std::vector<uint8_t>& oldImg, const std::vector<uint8_t>& newImg, OtaDiffStats* st = nullptr) {
+    return otaDiff(oldImg, newImg, SEED.data(), st);
+}
+
+/** Two files: the running image and the erased partition the patch writes into. */
+class FakeFlash {
+public:
+    FakeFlash(const std::vector<uint8_t>& running) {
+        char oldPath[] = "/tmp/ota-old-XXXXXX", newPath[] = "/tmp/ota-new-XXXXXX";
+        _old = fdopen(mkstemp(oldPath), "w+b");
+        _new = fdopen(mkstemp(newPath), "w+b");
+        unlink(oldPath); unlink(newPath);
+        fwrite(running.data(), 1, running.size(), _old);
+        std::vector<uint8_t> erased(PARTITION_SIZE, 0xFF);
+        fwrite(erased.data(), 1, erased.size(), _new);
+        _oldSize = running.size();
+    }
+    ~FakeFlash() { fclose(_old); fclose(_new); }
+
+    bool readOld(uint32_t off, uint8_t* buf, size_t n) {
+        reads++;
+        if (off + n > _oldSize) return false;
+        fseek(_old, off, SEEK_SET);
+        return fread(buf, 1, n, _old) == n;
+    }
+
+    bool writeNew(const uint8_t* buf, size_t n) {
+        if (_pos + n > PARTITION_SIZE) return false;
+        std::vector<uint8_t> cur(n);
+        fseek(_new, _pos, SEEK_SET);
+        if (fread(cur.data(), 1, n, _new) != n) return false;
+        for (size_t i = 0; i < n; i++) if ((cur[i] & buf[i]) != buf[i]) return false;    // 0 -> 1 needs an erase
+        fseek(_new, _pos, SEEK_SET);
+        fwrite(buf, 1, n, _new);
+        _pos += n;
+        maxWrite = n > maxWrite ? n : maxWrite;
+        return true;
+    }
+
+    std::vector<uint8_t> written() {
+        std::vector<uint8_t> out(_pos);
+        fseek(_new, 0, SEEK_SET);
+        if (fread(out.data(), 1, _pos, _new) != _pos) out.clear();
+        return out;
+    }
+
+    size_t reads = 0, maxWrite = 0;
+
+private:
+    FILE* _old;
+    FILE* _new;
+    size_t _oldSize, _pos = 0;
+};
+
+// Feeds the patch in pieces of 1..1460 bytes
+static OtaDeltaStatus applyTo(FakeFlash& flash, const std::vector<uint8_t>& patch, size_t limit = SIZE_MAX) {
+    OtaDeltaPatcher<FakeFlash> p(flash, KEY.data());
+    std::mt19937 rng(7);
+    size_t off = 0, end = std::min(limit, patch.size());
+    while (off < end && p.status() == OTA_DELTA_RUNNING) {
+        size_t n = std::min<size_t>(1 + rng() % 1460, end - off);
+        p.feed(patch.data() + off, n);
+        off += n;
+    }
+    return p.status();
+}
+
+// Something shaped like an app image: 32-bit words, a fair share of them
+// addresses into the image, runs of padding and repeated strings
+static std::vector<uint8_t> fakeImage(size_t words, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> img(words * 4);
+    for (size_t i = 0; i < words; i++) {
+        uint32_t w = rng();
+        if (w % 4 == 0) w = (0x42000000 + (uint32_t)(rng() % (words * 4))) & ~3u;   // a pointer
+        else if (w % 7 == 0) w = 0;
+        memcpy(&img[i * 4], &w, 4);
+    }
+    return img;
+}
+
+// The same program relinked: a function inserted in the middle moves every
+// address after it, and one string table grows
+static std::vector<uint8_t> relink(const std::vector<uint8_t>& old, size_t insertAt, size_t insertBytes) {
+    std::vector<uint8_t> nw(old.begin(), old.begin() + insertAt);
+    std::mt19937 rng(99);
+    for (size_t i = 0; i < insertBytes; i++) nw.push_back((uint8_t)rng());
+    nw.insert(nw.end(), old.begin() + insertAt, old.end());
+    for (size_t i = 0; i + 4 <= nw.size(); i += 4) {
+        uint32_t w;
+        memcpy(&w, &nw[i], 4);
+        if (w >= 0x42000000 + insertAt && w < 0x42000000 + old.size()) { w += (uint32_t)insertBytes; memcpy(&nw[i], &w, 4); }
+    }
+    const char* s = "PTV-TRMNL v5.46 zones\n";
+    nw.insert(nw.end() - 1024, s, s + strlen(s));
+    return nw;
+}
+
+static void testRelink() {
+    std::vector<uint8_t> oldImg = fakeImage(48 * 1024, 1);
+    std::vector<uint8_t> newImg = relink(oldImg, 70000, 1200);
+    OtaDiffStats st;
+    std::vector<uint8_t> patch = diff(oldImg, newImg, &st);
+    // Shifted addresses cost literals, but nothing like a full image
+    CHECK(patch.size() < newImg.size() / 3);
+    CHECK(st.extraBytes >= 1200 && st.extraBytes < 1200 + 256);
+    FakeFlash flash(oldImg);
+    CHECK(applyTo(flash, patch) == OTA_DELTA_DONE);
+    CHECK(flash.written() == newImg);
+    CHECK(flash.maxWrite <= OTA_DELTA_CHUNK);
+}
+
+static void testUnrelated() {
+    std::vector<uint8_t> oldImg = fakeImage(8 * 1024, 2), newImg = fakeImage(9 * 1024, 3);
+    std::vector<uint8_t> patch = diff(oldImg, newImg);
+    FakeFlash flash(oldImg);
+    CHECK(applyTo(flash, patch) == OTA_DELTA_DONE);
+    CHECK(flash.written() == newImg);
+}
+
+static void testIdenticalAndEmpty() {
+    std::vector<uint8_t> img = fakeImage(16 * 1024, 4);
+    std::vector<uint8_t> patch = diff(img, img);
+    CHECK(patch.size() < sizeof(OtaDeltaHeader) + 32);
+    FakeFlash flash(img);
+    CHECK(applyTo(flash, patch) == OTA_DELTA_DONE && flash.written() == img);
+
+    std::vector<uint8_t> empty;
+    patch = diff(empty, img);
+    FakeFlash fromNothing(empty);
+    CHECK(applyTo(fromNothing, patch) == OTA_DELTA_DONE && fromNothing.written() == img);
+}
+
+static void testWrongBase() {
+    std::vector<uint8_t> oldImg = fakeImage(8 * 1024, 5), newImg = relink(oldImg, 4000, 64);
+    std::vector<uint8_t> patch = diff(oldImg, newImg);
+    std::vector<uint8_t> other = oldImg;
+    other[100] ^= 1;
+    FakeFlash flash(other);
+    CHECK(applyTo(flash, patch) == OTA_DELTA_WRONG_BASE);
+    CHECK(flash.written().empty());    // refused before writing anything
+}
+
+static void testCorruptAndTruncated() {
+    std::vector<uint8_t> oldImg = fakeImage(8 * 1024, 6), newImg = relink(oldImg, 9000, 300);
+    std::vector<uint8_t> patch = diff(oldImg, newImg);
+
+    // A flipped byte in the extra data: everything applies, the hash catches it
+    std::vector<uint8_t> bad = patch;
+    bad[bad.size() - 10] ^= 0x20;
+    FakeFlash flash(oldImg);
+    CHECK(applyTo(flash, bad) == OTA_DELTA_HASH_MISMATCH);
+
+    // A control word pointing past the old image
+    bad = patch;
+    size_t ctrl = sizeof(OtaDeltaHeader);
+    bad[ctrl] = 0xFF; bad.insert(bad.begin() + ctrl + 1, {0xFF, 0xFF, 0x7F});
+    FakeFlash flash2(oldImg);
+    CHECK(applyTo(flash2, bad) == OTA_DELTA_CORRUPT);
+
+    FakeFlash flash3(oldImg);
+    CHECK(applyTo(flash3, patch, patch.size() / 2) == OTA_DELTA_RUNNING);
+
+    bad = patch;
+    bad[0] = 'X';
+    FakeFlash flash4(oldImg);
+    CHECK(applyTo(flash4, bad) == OTA_DELTA_BAD_HEADER);
+}
+
+// A signed header for newSize bytes from old, followed by hand-made records
+static std::vector<uint8_t> handMade(const std::vector<uint8_t>& old, uint32_t newSize, const std::vector<uint8_t>& records) {
+    OtaDeltaHeader h = {};
+    h.magic = OTA_DELTA_MAGIC;
+    h.version = OTA_DELTA_VERSION;
+    h.headerSize = sizeof(h);
+    h.oldSize = (uint32_t)old.size();
+    h.newSize = newSize;
+    Sha256 s;
+    s.update(old.data(), old.size()); s.finish(h.oldSha);
+    otaDeltaSign(h, SEED.data());
+    std::vector<uint8_t> out((const uint8_t*)&h, (const uint8_t*)&h + sizeof(h));
+    out.insert(out.end(), records.begin(), records.end());
+    return out;
+}
+
+// 10-byte varints (2^64 - 1) as lengths and seek: each sum with them wraps in
+// uint64, so only checks against the space left catch them
+static void testWrappingLengths() {
+    std::vector<uint8_t> oldImg = fakeImage(1024, 8);
+    const std::vector<uint8_t> max = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+    auto record = [&](std::vector<uint8_t> diffLen, std::vector<uint8_t> extraLen, std::vector<uint8_t> seek) {
+        std::vector<uint8_t> r = diffLen;
+        r.insert(r.end(), extraLen.begin(), extraLen.end());
+        r.insert(r.end(), seek.begin(), seek.end());
+        r.insert(r.end(), 4096, 0x01);    // zero runs / literals / extra bytes, whatever the patcher takes
+        return r;
+    };
+    const std::vector<uint8_t> patches[] = {
+        handMade(oldImg, 100, record({0x01}, max, {0x00})),    // 1 + (2^64 - 1) == 0
+        handMade(oldImg, 100, record(max, {0x01}, {0x00})),
+        handMade(oldImg, 100, record({0x00}, {0x00}, max)),    // seek -2^63
+        handMade(oldImg, 100, record({0x00}, {0x00}, {0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01})),    // +2^63 - 1
+    };
+    for (const auto& patch : patches) {
+        FakeFlash flash(oldImg);
+        OtaDeltaPatcher<FakeFlash> p(flash, KEY.data());
+        CHECK(p.feed(patch.data(), patch.size()) == OTA_DELTA_CORRUPT);
+        CHECK(p.written() <= 100 && flash.written().size() <= 100);
+    }
+    // An 11th varint byte is corrupt too
+    std::vector<uint8_t> longer = max;
+    longer[9] = 0x81; longer.push_back(0x01);
+    std::vector<uint8_t> patch = handMade(oldImg, 100, record(longer, {0x00}, {0x00}));
+    FakeFlash flash(oldImg);
+    CHECK(applyTo(flash, patch) == OTA_DELTA_CORRUPT && flash.written().empty());
+}
+
+// Only the release key's patches are written, and only as signed
+static void testSignature() {
+    std::vector<uint8_t> oldImg = fakeImage(8 * 1024, 9), newImg = relink(oldImg, 5000, 128);
+    std::vector<uint8_t> otherSeed(ED25519_KEY_SIZE, 0x42);
+    std::vector<uint8_t> patch = otaDiff(oldImg, newImg, otherSeed.data());
+    FakeFlash flash(oldImg);
+    CHECK(applyTo(flash, patch) == OTA_DELTA_BAD_SIGNATURE);
+    CHECK(flash.written().empty() && flash.reads == 0);    // before even hashing the base
+
+    // Someone else's image under the release's signature
+    patch = diff(oldImg, newImg);
+    std::vector<uint8_t> bad = patch;
+    bad[offsetof(OtaDeltaHeader, newSha)] ^= 1;
+    FakeFlash flash2(oldImg);
+    CHECK(applyTo(flash2, bad) == OTA_DELTA_BAD_SIGNATURE && flash2.written().empty());
+    bad = patch;
+    bad[offsetof(OtaDeltaHeader, sig) + 5] ^= 0x10;
+    FakeFlash flash3(oldImg);
+    CHECK(applyTo(flash3, bad) == OTA_DELTA_BAD_SIGNATURE);
+
+    // A firmware built for another key
+    uint8_t otherKey[ED25519_KEY_SIZE];
+    Ed25519::publicKey(otherSeed.data(), otherKey);
+    FakeFlash flash4(oldImg);
+    OtaDeltaPatcher<FakeFlash> p(flash4, otherKey);
+    CHECK(p.feed(patch.data(), patch.size()) == OTA_DELTA_BAD_SIGNATURE);
+}
+
+static void testEd25519() {
+    auto sha512 = [](const std::string& s) {
+        Sha512 h; h.update((const uint8_t*)s.data(), s.size());
+        std::vector<uint8_t> d(SHA512_SIZE); h.finish(d.data());
+        return d;
+    };
+    CHECK(sha512("abc") == unhex("ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+                                 "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"));
+    CHECK(sha512(std::string(200, 'a')) == sha512(std::string(100, 'a') + std::string(100, 'a')));
+
+    // RFC 8032 7.1, tests 1 and 2
+    struct { const char *seed, *pk, *msg, *sig; } vectors[] = {
+        {"9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+         "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a", "",
+         "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+        {"4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+         "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "72",
+         "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+    };
+    for (const auto& v : vectors) {
+        std::vector<uint8_t> seed = unhex(v.seed), msg = unhex(v.msg);
+        std::vector<uint8_t> pk(ED25519_KEY_SIZE), sig(ED25519_SIG_SIZE);
+        Ed25519::publicKey(seed.data(), pk.data());
+        CHECK(pk == unhex(v.pk));
+        Ed25519::sign(seed.data(), msg.data(), msg.size(), sig.data());
+        CHECK(sig == unhex(v.sig));
+        CHECK(Ed25519::verify(pk.data(), msg.data(), msg.size(), sig.data()));
+        msg.push_back(0);
+        CHECK(!Ed25519::verify(pk.data(), msg.data(), msg.size(), sig.data()));
+    }
+    // S + L verifies the same equation but is refused
+    std::vector<uint8_t> pk = unhex(vectors[0].pk), sig = unhex(vectors[0].sig);
+    const std::vector<uint8_t> L = unhex("edd3f55c1a631258d69cf7a2def9de1400000000000000000000000000000010");
+    int carry = 0;
+    for (int i = 0; i < 32; i++) { int v = sig[32 + i] + L[i] + carry; sig[32 + i] = (uint8_t)v; carry = v >> 8; }
+    CHECK(!Ed25519::verify(pk.data(), nullptr, 0, sig.data()));
+}
+
+static void testSha256() {
+    auto hex = [](const std::string& s) {
+        Sha256 h; h.update((const uint8_t*)s.data(), s.size());
+        uint8_t d[SHA256_SIZE]; h.finish(d);
+        char out[65];
+        for (int i = 0; i < SHA256_SIZE; i++) snprintf(out + 2 * i, 3, "%02x", d[i]);
+        return std::string(out);
+    };
+    CHECK(hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK(hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    CHECK(hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    // Same digest however the input is split
+    std::string big(1000, 'a');
+    Sha256 a, b;
+    a.update((const uint8_t*)big.data(), big.size());
+    for (size_t i = 0; i < big.size(); i += 7) b.update((const uint8_t*)big.data() + i, std::min<size_t>(7, big.size() - i));
+    uint8_t da[SHA256_SIZE], db[SHA256_SIZE];
+    a.finish(da); b.finish(db);
+    CHECK(memcmp(da, db, SHA256_SIZE) == 0);
+}
+
+int main() {
+    testSha256();
+    testEd25519();
+    testRelink();
+    testUnrelated();
+    testIdenticalAndEmpty();
+    testWrongBase();
+    testCorruptAndTruncated();
+    testWrappingLengths();
+    testSignature();
+    return checkReport("ota delta");
+}
@@ -0,0 +1,225 @@
+/**
+ * Delta OTA on the replayed firmware: apply, roll back, don't reapply
+ *
+ * src/zones-v12.cpp runs on the replay shims with two app slots. Its first
+ * daily check patches the running image into the other slot and restarts;
+ * the new image then crashes on every boot before it draws, so after
+ * OTA_MAX_BOOT_TRIES the boot check rolls it back. The old image's next
+ * check is offered the same patch and must leave it alone instead of
+ * flashing it and looping; a newer release after that is applied again.
+ * Patches only ever come from the configured https server: with a relay on
+ * the LAN and TLS failing, zones still come through the relay but the
+ * update waits for the server, and a device set up with an http:// server
+ * doesn't update at all.
+ *
+ * Usage: ./test-ota-rollback
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include "ota_diff.hpp"
+#include "zone_layout.hpp"
+#include "zone_tiles.hpp"
+#include "check.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#define OTA_MAX_BOOT_TRIES 3     // as src/zones-v12.cpp
+
+void setup();
+void loop();
+extern uint32_t ttCheckedDay;
+
+static std::vector<uint8_t> image(size_t bytes, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> img(bytes);
+    for (uint8_t& b : img) b = (uint8_t)(rng() % 16);
+    return img;
+}
+
+// A release as the firmware names it in Preferences: its hash's first 8 bytes in hex
+static std::string release(const std::vector<uint8_t>& img) {
+    uint8_t sha[SHA256_SIZE];
+    Sha256 h;
+    h.update(img.data(), img.size());
+    h.finish(sha);
+    char hex[17];
+    for (int i = 0; i < 8; i++) snprintf(hex + 2 * i, 3, "%02x", sha[i]);
+    return hex;
+}
+
+static std::string tiles(const ZoneDef& z) {
+    std::string s = {'Z', 'T', TILE_VERSION, 0, TILE_W, TILE_H};
+    auto put16 = [&](int v) { s += (char)(v & 0xFF); s += (char)((v >> 8) & 0xFF); };
+    put16(z.x); put16(z.y); put16(z.w); put16(z.h); put16(0);
+    return s;
+}
+
+static TraceExchange exchange(const char* method, const std::string& path, const std::string& body, uint64_t t = 0) {
+    TraceExchange ex;
+    ex.t = t;
+    ex.method = method; ex.path = path;
+    ex.status = 200; ex.ms = 100;
+    ex.respHeaders.push_back({"Content-Length", std::to_string(body.size())});
+    ex.body = body;
+    return ex;
+}
+
+static std::string str(const std::vector<uint8_t>& v) { return std::string(v.begin(), v.end()); }
+
+// The release key replay-firmware is built to trust: RFC 8032's first test seed
+static const uint8_t SEED[ED25519_KEY_SIZE] = {
+    0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+    0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60,
+};
+
+static std::string pref(const char* key) {
+    Preferences p;
+    p.begin("ota", true);
+    std::string v = p.getString(key).c_str();
+    p.end();
+    return v;
+}
+
+// A power-on as far as this test needs one: the slot otadata points at, and
+// the state setup() leaves to the reconnect in loop() or that outlives it
+// here. True if setup() restarted (the boot check rolled back).
+static bool boot() {
+    replayEnv.appRunning = replayEnv.appBoot;
+    ttCheckedDay = 0;
+    try { setup(); } catch (const ReplayRestart&) { return true; }
+    return false;
+}
+
+// loop() until virtual time passes untilMs; true if the firmware restarted
+static bool run(uint64_t untilMs) {
+    try {
+        while (replayEnv.nowMs() <= untilMs) {
+            replayEnv.cycle = ReplayCycle();
+            replayEnv.cycle.startMs = replayEnv.nowMs();
+            loop();
+        }
+    } catch (const ReplayRestart&) { return true; }
+    return false;
+}
+
+static std::vector<uint8_t> v1 = image(96 * 1024, 1), v2, v3;
+
+static HttpTrace server() {
+    v2 = v3 = v1;
+    for (size_t i = 40000; i < 41000; i++) v2[i] ^= 0x5A;
+    for (size_t i = 60000; i < 60500; i++) v3[i] ^= 0xA5;
+    v3.insert(v3.end(), 2048, 0x33);
+
+    HttpTrace trace;
+    trace.startEpochMs = 1760000000000ull;
+    trace.exchanges.push_back(exchange("GET", "/api/zones?plain=1&force=true", "time,weather,trains,trams,coffee,footer"));
+    trace.exchanges.push_back(exchange("GET", "/api/zones?plain=1", ""));
+    for (int i = 0; i < ZONE_COUNT; i++)
+        trace.exchanges.push_back(exchange("POST", std::string("/api/zone/") + ZONES[i].id + "/tiles", tiles(ZONES[i])));
+    trace.exchanges.push_back(exchange("GET", "/api/page/departures", ""));
+    trace.exchanges.push_back(exchange("GET", "/api/page/alerts", ""));
+    // The server offers v2 until it has v3 (a patch from the same base) at 10 min
+    trace.exchanges.push_back(exchange("GET", "/api/firmware/delta?from=5.45", str(otaDiff(v1, v2, SEED))));
+    trace.exchanges.push_back(exchange("GET", "/api/firmware/delta?from=5.45", str(otaDiff(v1, v3, SEED)), 600000));
+    TraceStreamEvent open;
+    open.kind = STREAM_OPEN; open.status = 200; open.data = "/api/zones/stream";
+    trace.stream.push_back(open);
+    for (uint64_t t = 15000; t <= 2400000; t += 15000) {
+        TraceStreamEvent hb;
+        hb.t = t; hb.data = ": hb\n\n";
+        trace.stream.push_back(hb);
+    }
+    return trace;
+}
+
+// A device fresh from the factory image v1, set up for serverUrl
+static void flash(const char* serverUrl) {
+    replayEnv.app[0] = v1;
+    replayEnv.app[1].clear();
+    replayEnv.appBoot = 0;
+    Preferences::store().clear();
+    Preferences prefs;
+    prefs.begin("ptv-trmnl");
+    prefs.putString("serverUrl", serverUrl);
+    prefs.end();
+}
+
+static void testRollback() {
+    flash("https://replay.local");
+
+    // v1 draws, finds v2 and restarts into it
+    CHECK(!boot());
+    CHECK(run(120000));
+    CHECK(replayEnv.app[1] == v2 && replayEnv.appBoot == 1);
+    CHECK(pref("pending") == release(v2) && pref("tries") == "1");
+
+    // v2 dies before it draws, boot after boot, until the boot check gives up on it
+    int boots = 0;
+    while (boots < 10 && !boot()) boots++;
+    CHECK(boots == OTA_MAX_BOOT_TRIES);
+    CHECK(replayEnv.appBoot == 0 && pref("rejected") == release(v2) && pref("tries") == "0");
+
+    // v1 again: the same patch is offered and left alone
+    CHECK(!boot() && replayEnv.appRunning == 0);
+    CHECK(!run(300000));
+    CHECK(ttCheckedDay != 0);
+    CHECK(replayEnv.appBoot == 0 && replayEnv.appWriting.empty());
+
+    // The next day the server has v3: that one is applied
+    ttCheckedDay = 0;
+    CHECK(replayEnv.nowMs() < 600000);
+    replayEnv.advanceTo(600000);
+    CHECK(run(900000));
+    CHECK(replayEnv.app[1] == v3 && replayEnv.appBoot == 1 && pref("pending") == release(v3));
+}
+
+// A relay on the LAN (anyone can announce one) and no TLS getting through:
+// the display draws through the relay, but the patch isn't asked of it
+static void testRelay() {
+    flash("https://replay.local");
+    replayEnv.relayUpstream = "replay.local";
+    NetEmulator blocked(3);
+    std::string error;
+    CHECK(blocked.parse("0 * rtt=20 tls=fail\n", error));
+    replayEnv.net = &blocked;
+
+    CHECK(!boot());
+    CHECK(!run(replayEnv.nowMs() + 300000));
+    CHECK(ttCheckedDay != 0);
+    CHECK(replayEnv.app[1].empty() && replayEnv.appBoot == 0);
+    CHECK(blocked.faults(NET_FAULT_TLS) >= 1);
+
+    // The next day the server is reachable: the patch comes from it
+    NetEmulator open(4);
+    CHECK(open.parse("0 * rtt=20\n", error));
+    replayEnv.net = &open;
+    ttCheckedDay = 0;
+    CHECK(run(replayEnv.nowMs() + 300000));
+    CHECK(replayEnv.app[1] == v3 && replayEnv.appBoot == 1);
+    replayEnv.net = nullptr;
+    replayEnv.relayUpstream.clear();
+}
+
+// Set up with a plain http:// server: everything else works, no update
+static void testPlainServer() {
+    flash("http://replay.local");
+    CHECK(!boot());
+    CHECK(!run(replayEnv.nowMs() + 120000));
+    CHECK(ttCheckedDay != 0);
+    CHECK(replayEnv.app[1].empty() && replayEnv.appBoot == 0);
+}
+
+int main() {
+    HttpTrace trace = server();
+    ReplayIndex index(trace);
+    replayEnv.server = &index;
+    replayEnv.endMs = 2400000;
+    testRollback();
+    testRelay();
+    testPlainServer();
+    return checkReport("ota-rollback");
+}
@@ -0,0 +1,125 @@
+/**
+ * Page cache: PackBits against the server's encoder, and the slots
+ *
+ * Checks pagePack() against bytes from packFrame() in src/services/pages.js,
+ * round trips full 800x480 frames (white, text-like, noise), rejects
+ * malformed and wrong-sized pages, and checks that a page that doesn't
+ * fit or fails commit() is not held while the others are unaffected.
+ *
+ * Usage: ./test-page-cache
+ */
+
+#include "page_cache.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static const int FB_W = 800, FB_H = 480, FRAME = FB_W / 8 * FB_H;
+
+// A dashboard-like frame: white, a black bar, some "text" rows
+static std::vector<uint8_t> textFrame(unsigned seed) {
+    std::vector<uint8_t> fb(FRAME, 0xFF);
+    memset(fb.data() + 445 * 100, 0x00, 35 * 100);
+    srand(seed);
+    for (int y = 160; y < 300; y += 20)
+        for (int r = 0; r < 12; r++)
+            for (int x = 3; x < 45; x++) fb[(y + r) * 100 + x] = (uint8_t)(rand() % 3 ? 0xFF : rand());
+    return fb;
+}
+
+// A server page: header, then the packed frame
+static std::vector<uint8_t> serverPage(const std::vector<uint8_t>& frame, int w, int h, uint32_t crc) {
+    std::vector<uint8_t> page(PAGE_HEADER_SIZE + frame.size() + frame.size() / 128 + 1);
+    pageHeader(page.data(), w, h, crc);
+    size_t n = pagePack(frame.data(), frame.size(), page.data() + PAGE_HEADER_SIZE, page.size() - PAGE_HEADER_SIZE);
+    page.resize(n ? PAGE_HEADER_SIZE + n : 0);
+    return page;
+}
+
+int main() {
+    // 1. Same bytes as the server's packFrame() for the same input
+    const uint8_t tail[] = {0x12, 0x34, 0x34, 0x56, 0x00, 0x00, 0x00, 0xAB};
+    std::vector<uint8_t> in(200 + sizeof(tail), 0xFF);
+    memcpy(in.data() + 200, tail, sizeof(tail));
+    const uint8_t want[] = {0x81, 0xFF, 0xB9, 0xFF, 0x03, 0x12, 0x34, 0x34, 0x56, 0xFE, 0x00, 0x00, 0xAB};
+    uint8_t out[64];
+    size_t n = pagePack(in.data(), in.size(), out, sizeof(out));
+    CHECK(n == sizeof(want) && memcmp(out, want, n) == 0);
+    CHECK(pagePack(in.data(), in.size(), out, n - 1) == 0);
+    std::vector<uint8_t> back(in.size());
+    CHECK(pageUnpack(out, n, back.data(), back.size()) && back == in);
+    CHECK(!pageUnpack(out, n, back.data(), back.size() - 1));      // longer than the frame
+    CHECK(!pageUnpack(out, n - 1, back.data(), back.size()));      // literal cut short
+    uint8_t bad[] = {0x80, 0x00};                                    // 128 is not a code
+    CHECK(!pageUnpack(bad, sizeof(bad), nullptr, 1));
+
+    // 2. Whole frames round trip; white and text pack small, noise still fits the worst case
+    std::vector<uint8_t> fb(FRAME), packed(FRAME + FRAME / 128 + 1), check(FRAME);
+    memset(fb.data(), 0xFF, FRAME);
+    n = pagePack(fb.data(), FRAME, packed.data(), packed.size());
+    CHECK(n == 2 * ((FRAME + 127) / 128));
+    CHECK(pageUnpack(packed.data(), n, check.data(), FRAME) && check == fb);
+    fb = textFrame(1);
+    n = pagePack(fb.data(), FRAME, packed.data(), packed.size());
+    CHECK(n > 0 && n < PAGE_SLOT_SIZE - PAGE_HEADER_SIZE);
+    CHECK(pageUnpack(packed.data(), n, check.data(), FRAME) && check == fb);
+    printf("text frame: %d -> %u bytes\n", FRAME, (unsigned)n);
+    srand(7);
+    for (auto& b : fb) b = (uint8_t)rand();
+    n = pagePack(fb.data(), FRAME, packed.data(), packed.size());
+    CHECK(n > FRAME && n <= packed.size());
+    CHECK(pageUnpack(packed.data(), n, check.data(), FRAME) && check == fb);
+
+    // 3. The journey page packed from the framebuffer and shown again
+    PageCache pages;
+    CHECK(pages.begin(FB_W, FB_H));
+    CHECK(!pages.held(0) && !pages.show(0, check.data()));
+    std::vector<uint8_t> journey = textFrame(2);
+    CHECK(pages.store(0, journey.data()));
+    CHECK(pages.held(0) && pages.crc(0) == 0 && pages.bytes(0) > PAGE_HEADER_SIZE);
+    memset(check.data(), 0x00, FRAME);
+    CHECK(pages.show(0, check.data()) && check == journey);
+    // Noise doesn't fit a slot: not held, and show() leaves the framebuffer alone
+    CHECK(!pages.store(0, fb.data()) && !pages.held(0));
+    CHECK(!pages.show(0, check.data()) && check == journey);
+
+    // 4. Server pages fetched into their slots
+    std::vector<uint8_t> board = textFrame(3);
+    std::vector<uint8_t> page = serverPage(board, FB_W, FB_H, 0xDEADBEEF);
+    uint8_t* dst = pages.reserve(1, page.size());
+    CHECK(dst != nullptr);
+    memcpy(dst, page.data(), page.size());
+    CHECK(!pages.held(1));
+    CHECK(pages.commit(1, page.size()));
+    CHECK(pages.held(1) && pages.crc(1) == 0xDEADBEEF);
+    CHECK(pages.show(1, check.data()) && check == board);
+    // Too big for a slot: nothing to write into, and the held page stays
+    CHECK(pages.reserve(1, pages.slotSize() + 1) == nullptr && pages.held(1));
+    // A slot past the last one
+    CHECK(pages.reserve(PAGE_SLOTS, 100) == nullptr && !pages.commit(PAGE_SLOTS, 100));
+
+    // 5. Rejected pages: another panel size, another version, a short body, trailing bytes
+    struct { int w, h; uint8_t version; int trim, extra; } bad2[] = {
+        {FB_W, FB_H - 1, PAGE_VERSION, 0, 0}, {FB_W, FB_H, PAGE_VERSION + 1, 0, 0},
+        {FB_W, FB_H, PAGE_VERSION, 3, 0}, {FB_W, FB_H, PAGE_VERSION, 0, 2},
+    };
+    for (const auto& b : bad2) {
+        std::vector<uint8_t> p = serverPage(board, b.w, b.h, 1);
+        p[2] = b.version;
+        p.resize(p.size() - b.trim);
+        p.insert(p.end(), b.extra, 0x00);
+        dst = pages.reserve(2, p.size());
+        CHECK(dst != nullptr);
+        memcpy(dst, p.data(), p.size());
+        CHECK(!pages.commit(2, p.size()) && !pages.held(2));
+    }
+    // A page started but never committed is not held either
+    CHECK(pages.reserve(1, page.size()) != nullptr && !pages.held(1));
+    CHECK(pages.store(0, journey.data()));
+    pages.drop(0);
+    CHECK(!pages.held(0));
+
+    return checkReport("page cache");
+}
@@ -0,0 +1,56 @@
+/**
+ * Panel async driver: BUSY edges and a BUSY line that never clears
+ *
+ * include/panel_async.hpp runs on the virtual clock against the stand-ins
+ * in panel_shim. A refresh asked for while one is in flight has to wait
+ * for the BUSY edge and then go out, with the first one's callback run.
+ * When BUSY sticks, the next refresh has to give up after
+ * PANEL_REFRESH_TIMEOUT_MS and still be sent to the panel, so the screen
+ * doesn't stay stale until something else changes; once the line behaves
+ * again, refreshes wait for it as before.
+ *
+ * Usage: ./test-panel-async
+ */
+
+#include "panel_async.hpp"
+#include "check.hpp"
+
+uint64_t nativeVirtualUs = 0;
+uint64_t panelBusyUntilMs = 0;
+void (*panelBusyIsr)() = nullptr;
+
+static int doneCalls = 0;
+static uint32_t doneMs = 0;
+static void onDone(int mode, uint32_t elapsedMs, void*) { doneCalls++; doneMs = elapsedMs; }
+
+int main() {
+    BBEPAPER epd;
+    PanelAsync panel(epd);
+    panel.begin();
+    CHECK(panelBusyIsr != nullptr);
+
+    // Two refreshes back to back: the second waits out the first's waveform
+    CHECK(panel.refresh(REFRESH_PARTIAL, onDone) && epd.refreshes == 1);
+    CHECK(panel.busy());
+    CHECK(panel.refresh(REFRESH_PARTIAL));
+    CHECK(epd.refreshes == 2 && millis() == 500);
+    CHECK(doneCalls == 1 && doneMs == 500);
+    CHECK(panel.waitIdle() && millis() == 1000 && !panel.busy());
+
+    // BUSY sticks: the next refresh gives up on it, and is still sent
+    epd.waveformMs = UINT32_MAX;
+    CHECK(panel.refresh(REFRESH_PARTIAL));
+    unsigned long stuckAt = millis();
+    epd.waveformMs = 500;
+    CHECK(!panel.refresh(REFRESH_FULL));
+    CHECK(millis() - stuckAt >= PANEL_REFRESH_TIMEOUT_MS && millis() - stuckAt < PANEL_REFRESH_TIMEOUT_MS + PANEL_WAIT_SLICE_MS);
+    CHECK(epd.refreshes == 4 && epd.lastMode == REFRESH_FULL);
+    CHECK(panel.timeouts() == 1 && panel.refreshCount(true) == 1 && panel.refreshCount(false) == 3);
+
+    // The line is back: waits end on the edge again
+    unsigned long fullAt = millis();
+    CHECK(panel.refresh(REFRESH_PARTIAL));
+    CHECK(millis() - fullAt == 500 && panel.timeouts() == 1 && epd.refreshes == 5);
+
+    return checkReport("panel async");
+}
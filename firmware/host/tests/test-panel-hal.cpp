@@ -0,0 +1,206 @@
+/**
+ * Panel kernels: every panel type against a per-pixel reference
+ *
+ * For the 7.5" panel (word rows), it flipped 180 degrees, the 4.2" panel
+ * (byte rows) and an LSB-first panel, the fill, invert, blit and XOR
+ * kernels must leave the framebuffer exactly as setting one pixel at a time
+ * through the panel's own mapping does. Rectangles are random, including
+ * ones hanging off every edge, and the checks cover both BMP row orders,
+ * an unaligned source buffer and the BMPs panelBlitBmp() must refuse.
+ *
+ * Usage: ./test-panel-hal
+ */
+
+#include "panel_hal.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+static std::mt19937 rng(47);
+static int uniform(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); }
+
+typedef PanelTraits<96, 40, 0, false> PanelLsb;
+
+// The panel's mapping, one pixel at a time
+template <class P>
+static size_t bitAt(int x, int y, uint8_t& mask) {
+    if (P::ROTATION == 180) { x = P::W - 1 - x; y = P::H - 1 - y; }
+    mask = P::MSB_FIRST ? (uint8_t)(0x80 >> (x & 7)) : (uint8_t)(1 << (x & 7));
+    return (size_t)y * P::PITCH + x / 8;
+}
+template <class P>
+static bool getPixel(const uint8_t* fb, int x, int y) { uint8_t m; return fb[bitAt<P>(x, y, m)] & m; }
+template <class P>
+static void setPixel(uint8_t* fb, int x, int y, bool white) {
+    uint8_t m;
+    uint8_t& b = fb[bitAt<P>(x, y, m)];
+    b = white ? (uint8_t)(b | m) : (uint8_t)(b & ~m);
+}
+
+static bool srcPixel(const uint8_t* row, int i) { return row[i >> 3] & (0x80 >> (i & 7)); }
+
+// A framebuffer with room for the word kernels' alignment
+struct Frame {
+    std::vector<uint32_t> words;
+    explicit Frame(size_t bytes) : words((bytes + 3) / 4) {}
+    uint8_t* data() { return (uint8_t*)words.data(); }
+};
+
+template <class P>
+static void randomize(uint8_t* fb) { for (int i = 0; i < P::PITCH * P::H; i++) fb[i] = (uint8_t)uniform(0, 255); }
+
+template <class P>
+static void randomRect(int& x, int& y, int& w, int& h) {
+    w = uniform(1, P::W / 2 + 40); h = uniform(1, 30);
+    x = uniform(-40, P::W - 1); y = uniform(-20, P::H - 1);
+}
+
+/** Source rows of w pixels padded to 4 bytes, as in a BMP, starting `skew` bytes into the buffer. */
+static std::vector<uint8_t> randomBits(int w, int h, int skew, int& pitch) {
+    pitch = (w + 31) / 32 * 4;
+    std::vector<uint8_t> v(skew + (size_t)pitch * h);
+    for (uint8_t& b : v) b = (uint8_t)uniform(0, 255);
+    return v;
+}
+
+template <class P>
+static void checkPanel(const char* name) {
+    const size_t size = (size_t)P::PITCH * P::H;
+    Frame got(size), want(size);
+    int bad = 0;
+    for (int iter = 0; iter < 400; iter++) {
+        int x, y, w, h;
+        randomRect<P>(x, y, w, h);
+        randomize<P>(got.data());
+        memcpy(want.data(), got.data(), size);
+        int op = iter % 4, pitch = 0, skew = uniform(0, 3);
+        std::vector<uint8_t> bits = randomBits(w, h, skew, pitch);
+        const uint8_t* src = bits.data() + skew;
+        bool white = uniform(0, 1);
+        switch (op) {
+            case 0: panelFill<P>(got.data(), x, y, w, h, white); break;
+            case 1: panelInvert<P>(got.data(), x, y, w, h); break;
+            case 2: panelBlit<P>(got.data(), x, y, w, h, src, pitch); break;
+            default: panelXor<P>(got.data(), x, y, w, h, src + (size_t)(h - 1) * pitch, -pitch); break;
+        }
+        for (int r = 0; r < h; r++) {
+            for (int c = 0; c < w; c++) {
+                int px = x + c, py = y + r;
+                if (px < 0 || px >= P::W || py < 0 || py >= P::H) continue;
+                bool was = getPixel<P>(want.data(), px, py), v;
+                switch (op) {
+                    case 0: v = white; break;
+                    case 1: v = !was; break;
+                    case 2: v = srcPixel(src + (size_t)r * pitch, c); break;
+                    default: v = was ^ srcPixel(src + (size_t)(h - 1 - r) * pitch, c); break;
+                }
+                setPixel<P>(want.data(), px, py, v);
+            }
+        }
+        if (memcmp(got.data(), want.data(), size) != 0 && bad++ < 3)
+            fprintf(stderr, "%s: op %d at %d,%d %dx%d differs from the reference\n", name, op, x, y, w, h);
+    }
+    CHECK(bad == 0);
+
+    // The flash: inverting twice restores the buffer exactly
+    randomize<P>(got.data());
+    memcpy(want.data(), got.data(), size);
+    panelInvert<P>(got.data(), 3, 5, P::W - 7, 9);
+    CHECK(memcmp(got.data(), want.data(), size) != 0);
+    panelInvert<P>(got.data(), 3, 5, P::W - 7, 9);
+    CHECK(memcmp(got.data(), want.data(), size) == 0);
+
+    // Nothing on the panel: nothing written
+    panelFill<P>(got.data(), P::W, 0, 10, 10, false);
+    panelFill<P>(got.data(), -10, 0, 10, 10, false);
+    panelFill<P>(got.data(), 0, P::H, 10, 10, false);
+    panelFill<P>(got.data(), 0, 0, 0, 10, false);
+    CHECK(memcmp(got.data(), want.data(), size) == 0);
+}
+
+// A server zone BMP: 1 bpp, palette index 0 black, either row order
+static std::vector<uint8_t> makeBmp(int w, int h, bool topDown, std::vector<bool>& px, uint8_t pal0 = 0, uint8_t pal1 = 255) {
+    int pitch = (w + 31) / 32 * 4;
+    std::vector<uint8_t> bmp(62 + (size_t)pitch * h, 0);
+    auto le32 = [&](size_t at, uint32_t v) { for (int i = 0; i < 4; i++) bmp[at + i] = (uint8_t)(v >> (8 * i)); };
+    bmp[0] = 'B'; bmp[1] = 'M';
+    le32(2, (uint32_t)bmp.size()); le32(10, 62); le32(14, 40);
+    le32(18, (uint32_t)w); le32(22, (uint32_t)(topDown ? -h : h));
+    bmp[26] = 1; bmp[28] = 1;
+    for (int i = 0; i < 3; i++) { bmp[54 + i] = pal0; bmp[58 + i] = pal1; }
+    px.assign((size_t)w * h, false);
+    for (int y = 0; y < h; y++) {
+        uint8_t* row = bmp.data() + 62 + (size_t)(topDown ? y : h - 1 - y) * pitch;
+        for (int x = 0; x < w; x++) {
+            bool white = uniform(0, 2) != 0;
+            px[(size_t)y * w + x] = white;
+            if (white) row[x >> 3] |= (uint8_t)(0x80 >> (x & 7));
+        }
+    }
+    return bmp;
+}
+
+template <class P>
+static void checkBmp(const char* name) {
+    const size_t size = (size_t)P::PITCH * P::H;
+    Frame fb(size), before(size);
+    memset(before.data(), 0x5A, size);
+    std::vector<bool> px;
+    int bad = 0;
+    for (int iter = 0; iter < 40; iter++) {
+        int x, y, w, h;
+        randomRect<P>(x, y, w, h);
+        bool topDown = iter & 1;
+        std::vector<uint8_t> bmp = makeBmp(w, h, topDown, px);
+        memset(fb.data(), 0x5A, size);
+        CHECK(panelBlitBmp<P>(fb.data(), x, y, bmp.data(), bmp.size()));
+        for (int py = 0; py < P::H; py++)
+            for (int pxl = 0; pxl < P::W; pxl++) {
+                bool inside = pxl >= x && pxl < x + w && py >= y && py < y + h;
+                bool expect = inside ? px[(size_t)(py - y) * w + pxl - x] : getPixel<P>(before.data(), pxl, py);
+                if (getPixel<P>(fb.data(), pxl, py) != expect) { bad++; break; }
+            }
+        if (bad) { fprintf(stderr, "%s: BMP %dx%d %s at %d,%d\n", name, w, h, topDown ? "top-down" : "bottom-up", x, y); break; }
+    }
+    CHECK(bad == 0);
+
+    // Refused, with the buffer untouched: a truncated body, an inverted palette, 4 bpp, not a BMP
+    std::vector<uint8_t> ok = makeBmp(64, 8, false, px);
+    memset(fb.data(), 0x5A, size);
+    CHECK(!panelBlitBmp<P>(fb.data(), 0, 0, ok.data(), ok.size() - 1));
+    std::vector<uint8_t> inverted = makeBmp(64, 8, false, px, 255, 0);
+    CHECK(!panelBlitBmp<P>(fb.data(), 0, 0, inverted.data(), inverted.size()));
+    std::vector<uint8_t> deep = ok;
+    deep[28] = 4;
+    CHECK(!panelBlitBmp<P>(fb.data(), 0, 0, deep.data(), deep.size()));
+    std::vector<uint8_t> junk = ok;
+    junk[0] = 'X';
+    CHECK(!panelBlitBmp<P>(fb.data(), 0, 0, junk.data(), junk.size()));
+    CHECK(!panelBlitBmp<P>(fb.data(), 0, 0, ok.data(), 40));
+    bool untouched = true;
+    for (size_t i = 0; i < size; i++) untouched &= fb.data()[i] == 0x5A;
+    CHECK(untouched);
+}
+
+int main() {
+    static_assert(PanelTrmnl75::PITCH == 100 && PanelTrmnl75::WORD_ROWS, "800 px rows are 25 words");
+    static_assert(PanelEp42::PITCH == 50 && !PanelEp42::WORD_ROWS, "400 px rows are worked in bytes");
+
+    CHECK(PanelUnit<uint32_t>::rev(0x80000001u) == 0x80000001u);
+    CHECK(PanelUnit<uint32_t>::rev(0x00000001u) == 0x80000000u);
+    CHECK(PanelUnit<uint32_t>::rev(0x12345678u) == 0x1E6A2C48u);
+    CHECK(PanelUnit<uint8_t>::rev(0x01) == 0x80);
+    CHECK(PanelUnit<uint8_t>::rev(0xC4) == 0x23);
+
+    checkPanel<PanelTrmnl75>("7.5\"");
+    checkPanel<PanelTrmnl75Flipped>("7.5\" flipped");
+    checkPanel<PanelEp42>("4.2\"");
+    checkPanel<PanelLsb>("LSB-first");
+    checkBmp<PanelTrmnl75>("7.5\"");
+    checkBmp<PanelTrmnl75Flipped>("7.5\" flipped");
+    checkBmp<PanelEp42>("4.2\"");
+
+    return checkReport("panel-hal");
+}
@@ -0,0 +1,20 @@
+// Built with PROFILE_ENABLED=0: the macros must vanish, arguments included, except the statement a lap wraps
+#undef PROFILE_ENABLED
+#define PROFILE_ENABLED 0
+#include "profile.hpp"
+
+int profileOffCalls = 0;
+
+[[maybe_unused]] static ProfileStage sideEffect() { profileOffCalls++; return PROF_BLIT; }
+
+int profileWhenDisabled() {
+    int fed = 0;
+    {
+        PROFILE_SCOPE(sideEffect());
+        PROFILE_LAP(lap);
+        PROFILE_LAP_RUN(lap, fed++);
+        PROFILE_LAP_END(lap, sideEffect());
+    }
+    PROFILE_DUMP(Serial, "off");
+    return fed;
+}
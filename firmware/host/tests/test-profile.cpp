@@ -0,0 +1,109 @@
+/**
+ * Stage profiler: histogram buckets, scopes, laps and the #P export
+ *
+ * Checks the log2 bucket edges and below(), that a scope adds one sample
+ * to its stage and a lap sums its pieces into one, that the export is the
+ * JSON compare-profile.py reads and that dumps wait PROFILE_DUMP_MS. Also
+ * checks that with PROFILE_ENABLED=0 nothing is recorded and the
+ * arguments are not evaluated (test-profile-off.cpp).
+ *
+ * Usage: ./test-profile
+ */
+
+#include "profile.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+extern int profileOffCalls;
+int profileWhenDisabled();
+
+struct Capture {
+    std::string text;
+    void print(const char* s) { text += s; }
+};
+
+static void spin(std::chrono::microseconds d) {
+    auto t0 = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - t0 < d) {}
+}
+
+int main() {
+    // Bucket i holds 2^i .. 2^(i+1)-1; zero joins bucket 0 and the top bucket takes the rest
+    CHECK(ProfileHistogram::bucket(0) == 0);
+    CHECK(ProfileHistogram::bucket(1) == 0);
+    CHECK(ProfileHistogram::bucket(2) == 1);
+    CHECK(ProfileHistogram::bucket(3) == 1);
+    CHECK(ProfileHistogram::bucket(1023) == 9);
+    CHECK(ProfileHistogram::bucket(1024) == 10);
+    CHECK(ProfileHistogram::bucket(1ull << 40) == PROFILE_BUCKETS - 1);
+
+    ProfileHistogram h;
+    CHECK(h.below(0.5) == 0);
+    for (int i = 0; i < 99; i++) h.add(100);    // bucket 6: 64..127
+    h.add(5000);                                // bucket 12
+    CHECK(h.count == 100);
+    CHECK(h.sum == 99 * 100 + 5000);
+    CHECK(h.max == 5000);
+    CHECK(h.buckets[6] == 99 && h.buckets[12] == 1);
+    CHECK(h.below(0.5) == 127);
+    CHECK(h.below(0.99) == 127);
+    CHECK(h.below(1.0) == 5000);               // top of bucket 12 is 8191, capped at the max
+
+    // A scope is one sample; a lap of three pieces is one sample worth at least their sum
+    uint64_t hz = profileTickHz();
+    CHECK(hz > 1000000);
+    Profiler& p = profiler();
+    {
+        PROFILE_SCOPE(PROF_BLIT);
+        spin(std::chrono::microseconds(2000));
+    }
+    CHECK(p.stage(PROF_BLIT).count == 1);
+    CHECK(p.stage(PROF_BLIT).sum >= hz / 1000);
+
+    PROFILE_LAP(lap);
+    int fed = 0;
+    for (int i = 0; i < 3; i++) {
+        PROFILE_LAP_RUN(lap, spin(std::chrono::microseconds(1000)); fed++);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));   // the network read between feeds
+    }
+    PROFILE_LAP_END(lap, PROF_TILES);
+    CHECK(fed == 3);
+    CHECK(p.stage(PROF_TILES).count == 1);
+    CHECK(p.stage(PROF_TILES).sum >= hz * 3 / 1000);
+    CHECK(p.stage(PROF_TILES).sum < hz * 15 / 1000);
+    CHECK(p.stage(PROF_FLASH).count == 0);
+
+    // Export: one line, empty stages left out, counts add up
+    Capture json;
+    size_t n = profileExport(json, p, "v12-test");
+    CHECK(n == json.text.size());
+    CHECK(json.text.find('\n') == std::string::npos);
+    CHECK(json.text.rfind("{\"v\":1,\"build\":\"v12-test\",\"hz\":", 0) == 0);
+    CHECK(json.text.find("\"blit\":{\"n\":1,") != std::string::npos);
+    CHECK(json.text.find("\"tiles\":{\"n\":1,") != std::string::npos);
+    CHECK(json.text.find("\"flash\"") == std::string::npos);
+    CHECK(json.text.compare(json.text.size() - 4, 4, "]}}}") == 0);
+
+    // Dumps wait PROFILE_DUMP_MS from boot, then from the last dump
+    Capture dump;
+    CHECK(profileDump(dump, "v12-test", PROFILE_DUMP_MS - 1) == 0);
+    CHECK(dump.text.empty());
+    CHECK(profileDump(dump, "v12-test", PROFILE_DUMP_MS) == dump.text.size());
+    CHECK(dump.text.find("Prof blit: 1, mean ") == 0);
+    CHECK(dump.text.find("\nProf tiles: 1, mean ") != std::string::npos);
+    CHECK(dump.text.find("\n#P {\"v\":1,") != std::string::npos);
+    CHECK(dump.text.back() == '\n');
+    CHECK(profileDump(dump, "v12-test", PROFILE_DUMP_MS * 2 - 1) == 0);
+    CHECK(profileDump(dump, "v12-test", PROFILE_DUMP_MS * 2) > 0);
+
+    // Disabled: the lap's statement still runs, nothing else does
+    p.reset();
+    CHECK(profileWhenDisabled() == 1);
+    CHECK(profileOffCalls == 0);
+    for (int i = 0; i < PROF_STAGES; i++) CHECK(p.stage((ProfileStage)i).count == 0);
+
+    return checkReport("profile");
+}
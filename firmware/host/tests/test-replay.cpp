@@ -0,0 +1,181 @@
+/**
+ * Record/replay harness against a trace built here
+ *
+ * Writes a minute of device traffic with TraceWriter (initial full draw
+ * from a chunked zone list, button pages, push stream with heartbeats and
+ * one zone change, prefetch polls), reads it back, then runs the real
+ * firmware (src/zones-v12.cpp) against it on the virtual clock and checks
+ * what it asked for and what it drew. A button press at 40s has to switch pages without a request.
+ *
+ * Usage: ./test-replay
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <bb_epaper.h>
+#include "metrics.hpp"
+#include "page_cache.hpp"
+#include "wake_loop.hpp"
+#include "zone_layout.hpp"
+#include "zone_tiles.hpp"
+#include "check.hpp"
+
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern BBEPAPER bbep;
+extern WakeLoop wake;
+extern DeviceMetrics stats;
+
+static const uint64_t START_EPOCH_MS = 1760000000000ull;   // 20s into a minute
+
+static void put16(std::string& s, int v) { s += (char)(v & 0xFF); s += (char)((v >> 8) & 0xFF); }
+
+// Tile stream for a zone: nothing changed, or tile 0 filled black
+static std::string tiles(const ZoneDef& z, bool fillFirst) {
+    std::string s = {'Z', 'T', TILE_VERSION, 0, TILE_W, TILE_H};
+    put16(s, z.x); put16(s, z.y); put16(s, z.w); put16(s, z.h); put16(s, fillFirst ? 1 : 0);
+    if (fillFirst) {
+        uint8_t black[TILE_BYTES] = {0};
+        uint32_t hash = tileHash(black);
+        put16(s, 0); s += (char)TILE_FILL; s += (char)1;
+        for (int i = 0; i < 4; i++) s += (char)((hash >> (8 * i)) & 0xFF);
+        s += (char)0x00;
+    }
+    return s;
+}
+
+// A button page: white with a black band across the top
+static std::string page() {
+    std::vector<uint8_t> frame(DASH_W / 8 * DASH_H, 0xFF);
+    memset(frame.data(), 0x00, DASH_W / 8 * 50);
+    std::string s(PAGE_HEADER_SIZE + frame.size(), '\0');
+    pageHeader((uint8_t*)&s[0], DASH_W, DASH_H, 0x1234);
+    s.resize(PAGE_HEADER_SIZE + pagePack(frame.data(), frame.size(), (uint8_t*)&s[PAGE_HEADER_SIZE], frame.size()));
+    return s;
+}
+
+static TraceExchange exchange(uint64_t t, const char* method, const std::string& path, const std::string& body, const char* type) {
+    TraceExchange ex;
+    ex.t = t; ex.method = method; ex.path = path;
+    ex.status = 200; ex.ms = 120;
+    ex.respHeaders.push_back({"Content-Type", type});
+    ex.respHeaders.push_back({"Content-Length", std::to_string(body.size())});
+    ex.body = body;
+    return ex;
+}
+
+static void writeTrace(const char* path, size_t& pushBytes) {
+    TraceWriter w;
+    CHECK(w.open(path, START_EPOCH_MS));
+    // The first list chunked, with no length, as Express sends it
+    TraceExchange list = exchange(0, "GET", "/api/zones?plain=1&force=true", "14\r\ntime,weather,trains,\r\n13\r\ntrams,coffee,footer\r\n0\r\n\r\n", "text/plain");
+    list.respHeaders[1] = {"Transfer-Encoding", "chunked"};
+    w.exchange(list);
+    for (int i = 0; i < ZONE_COUNT; i++)
+        w.exchange(exchange(200, "POST", std::string("/api/zone/") + ZONES[i].id + "/tiles", tiles(ZONES[i], false), "application/octet-stream"));
+    // The button pages, fetched into the page cache after the first draw
+    w.exchange(exchange(300, "GET", "/api/page/departures", page(), "application/octet-stream"));
+    w.exchange(exchange(300, "GET", "/api/page/alerts", page(), "application/octet-stream"));
+    // What changed for the next boundary: nothing
+    w.exchange(exchange(25000, "GET", "/api/zones?plain=1&at=1760000040", "", "text/plain"));
+    // Trains changed at 30s; the device holds white, so tile 0 arrives as a fill
+    w.exchange(exchange(30000, "POST", "/api/zone/trains/tiles", tiles(ZONES[2], true), "application/octet-stream"));
+
+    w.streamOpen(100, 200, "/api/zones/stream");
+    const std::pair<uint64_t, std::string> events[] = {
+        {15000, ": hb\n\n"}, {30000, "id: 1\ndata: trains\n\n"}, {45000, ": hb\n\n"}, {60000, ": hb\n\n"},
+    };
+    pushBytes = 0;
+    for (const auto& ev : events) { w.streamData(ev.first, ev.second); pushBytes += ev.second.size(); }
+    w.close();
+}
+
+static void testTraceFormat(const HttpTrace& trace) {
+    CHECK(trace.startEpochMs == START_EPOCH_MS);
+    CHECK(trace.exchanges.size() == (size_t)ZONE_COUNT + 5);
+    CHECK(trace.stream.size() == 5 && trace.stream[0].kind == STREAM_OPEN && trace.stream[0].status == 200);
+    CHECK(trace.durationMs() == 60000);
+    const TraceExchange& bin = trace.exchanges[1];
+    CHECK(bin.body == tiles(ZONES[0], false));
+    CHECK(bin.header("content-length") && atoi(bin.header("content-length")) == (int)bin.body.size());
+
+    ReplayIndex index(trace);
+    // at= is ignored for matching; the latest answer at or before t wins, else the first
+    CHECK(index.match("GET", "/api/zones?plain=1&at=1760000100", 90000) == &trace.exchanges[ZONE_COUNT + 3]);
+    CHECK(index.match("POST", "/api/zone/trains/tiles", 10)->body == tiles(ZONES[2], false));
+    CHECK(index.match("POST", "/api/zone/trains/tiles", 30000)->body == tiles(ZONES[2], true));
+    CHECK(index.match("GET", "/api/zone/trains/tiles", 30000) == nullptr);
+    CHECK(index.streamStatus(0) == 200 && index.hasStream());
+}
+
+static void testFirmware(const HttpTrace& trace, size_t pushBytes) {
+    ReplayIndex index(trace);
+    replayEnv.server = &index;
+    replayEnv.endMs = trace.durationMs();
+    Preferences prefs;
+    prefs.begin("ptv-trmnl");
+    prefs.putString("serverUrl", "http://replay.local");
+    prefs.end();
+
+    ReplayCycle total;
+    uint64_t trainsAt = 0;
+    int pressAt = -1, pressRequests = -1, pressPartial = -1;
+    setup();
+    int cycles = 0;
+    while (replayEnv.nowMs() <= replayEnv.endMs && cycles < 1000) {
+        // Press the button once, after the trains change has been drawn; this loop()'s wait() returns it, the next answers it
+        if (replayEnv.nowMs() >= 40000 && pressAt < 0) { wake.notify(WAKE_BIT(WAKE_BUTTON)); pressAt = cycles + 1; }
+        replayEnv.cycle = ReplayCycle();
+        replayEnv.cycle.startMs = replayEnv.nowMs();
+        loop();
+        cycles++;
+        const ReplayCycle& c = replayEnv.cycle;
+        if (c.startMs >= 30000 && c.partial && !trainsAt) trainsAt = c.startMs;
+        if (cycles - 1 == pressAt) { pressRequests = c.requests; pressPartial = c.partial; }
+        total.requests += c.requests; total.unmatched += c.unmatched;
+        total.bytesIn += c.bytesIn; total.streamBytes += c.streamBytes;
+        total.partial += c.partial; total.full += c.full;
+    }
+    CHECK(cycles < 1000);
+    CHECK(replayEnv.nowMs() > replayEnv.endMs);
+    if (total.unmatched) fprintf(stderr, "unmatched: %s\n", replayEnv.unmatchedLast.c_str());
+    CHECK(total.unmatched == 0);
+    // zone list + 6 zones + 2 pages + stream + prefetch list + trains
+    CHECK(total.requests == 12);
+    CHECK(total.full == 1);
+    // The changed tile is flashed (inverted and back) then refreshed; then the departures page
+    CHECK(total.partial == 3);
+    // The press went straight from the page cache to the panel: no request, one refresh, the page in the buffer
+    CHECK(pressRequests == 0 && pressPartial == 1);
+    CHECK(stats.pageSwitches == 1 && stats.pageMisses == 0);
+    CHECK(stats.buttonSeconds.count == 1 && stats.buttonSeconds.sumMs == REPLAY_PARTIAL_REFRESH_MS);
+    const uint8_t* fb = bbep.getBuffer();
+    CHECK(fb[0] == 0x00 && fb[DASH_W / 8 * 50 - 1] == 0x00 && fb[DASH_W / 8 * 50] == 0xFF);
+    CHECK(trainsAt >= 30000 && trainsAt < 31000);
+    CHECK(total.streamBytes == pushBytes);
+    CHECK(total.bytesIn > 0);
+}
+
+int main() {
+    char path[] = "/tmp/test-replay-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return 1;
+    close(fd);
+
+    size_t pushBytes = 0;
+    writeTrace(path, pushBytes);
+    HttpTrace trace;
+    std::string error;
+    CHECK(trace.load(path, error));
+    unlink(path);
+    if (!error.empty()) fprintf(stderr, "%s\n", error.c_str());
+
+    testTraceFormat(trace);
+    testFirmware(trace, pushBytes);
+    return checkReport("replay");
+}
@@ -0,0 +1,295 @@
+/**
+ * Sprite dictionary and draw lists: encode rendered zones, decode, compare
+ *
+ * Builds the dictionary from the real firmware/sprites/sprites.txt, draws
+ * zones the way src/services/zone-renderer-v12.js does (border, pictogram,
+ * text) and writes them out as its 1-bit BMPs. Each BMP is read back,
+ * encoded to a draw list and decoded into an 800x480 framebuffer at a byte
+ * aligned and an unaligned origin, one byte and random chunks at a time;
+ * every pixel must equal the BMP and nothing outside the zone may change.
+ * Also covers the blit kernel against a per-byte reference, a stale
+ * dictionary version, unknown sprites, ops outside the zone and corrupt
+ * dictionaries.
+ *
+ * Usage: ./test-sprites
+ */
+
+#include "sprite_pack.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+static const int FB_W = 800, FB_H = 480, PITCH = FB_W / 8;
+
+static std::vector<SpriteSource> sources;
+static std::vector<uint8_t> image;
+static SpriteDict dict;
+
+static const SpriteSource& sprite(const char* name) {
+    for (const SpriteSource& s : sources) if (s.name == name) return s;
+    fprintf(stderr, "no sprite %s\n", name);
+    exit(1);
+}
+
+static Bitmap blank(int w, int h) { Bitmap b; b.w = w; b.h = h; b.px.assign((size_t)w * h, 1); return b; }
+
+static void rect(Bitmap& b, int x, int y, int w, int h, bool white) {
+    for (int r = y; r < y + h; r++) for (int c = x; c < x + w; c++) b.px[(size_t)r * b.w + c] = white;
+}
+
+static void stroke(Bitmap& b, int x, int y, int w, int h) {
+    rect(b, x, y, w, 1, false); rect(b, x, y + h - 1, w, 1, false);
+    rect(b, x, y, 1, h, false); rect(b, x + w - 1, y, 1, h, false);
+}
+
+static void place(Bitmap& b, const SpriteSource& s, int x, int y) {
+    for (int r = 0; r < s.bits.h; r++)
+        for (int c = 0; c < s.bits.w; c++) b.px[(size_t)(y + r) * b.w + x + c] = s.bits.white(c, r);
+}
+
+// Glyph-like noise where the renderer puts text
+static void text(Bitmap& b, int x, int y, int w, int h, unsigned seed) {
+    std::mt19937 rng(seed);
+    for (int c = x; c < x + w; c += 9)
+        for (int r = y; r < y + h; r++)
+            for (int k = 0; k < 7; k++) if (rng() % 3 == 0) b.px[(size_t)r * b.w + c + k] = 0;
+}
+
+// Same layout as canvasToBMP() in zone-renderer-v12.js: top-down, black then white
+static std::vector<uint8_t> toBmp(const Bitmap& b) {
+    size_t stride = ((size_t)b.w + 31) / 32 * 4;
+    std::vector<uint8_t> f(62 + stride * b.h, 0);
+    auto put32 = [&](size_t o, uint32_t v) { for (int i = 0; i < 4; i++) f[o + i] = (uint8_t)(v >> (8 * i)); };
+    f[0] = 'B'; f[1] = 'M';
+    put32(2, (uint32_t)f.size()); put32(10, 62); put32(14, 40);
+    put32(18, (uint32_t)b.w); put32(22, (uint32_t)-b.h);
+    f[26] = 1; f[28] = 1;
+    put32(34, (uint32_t)(stride * b.h)); put32(46, 2); put32(58, 0x00FFFFFF);
+    for (int y = 0; y < b.h; y++) {
+        std::vector<uint8_t> row;
+        spritePackRow(b, 0, y, b.w, row);
+        memcpy(&f[62 + y * stride], row.data(), row.size());
+    }
+    return f;
+}
+
+static bool fbWhite(const std::vector<uint8_t>& fb, int x, int y) { return (fb[y * PITCH + (x >> 3)] >> (7 - (x & 7))) & 1; }
+
+// Decode into a noisy framebuffer; 0 chunk = random chunk sizes
+static bool decodeAndCompare(const std::vector<uint8_t>& list, const Bitmap& zone, int zx, int zy, size_t chunk, DrawListDecoder* out = nullptr) {
+    std::vector<uint8_t> fb(PITCH * FB_H);
+    std::mt19937 rng(zx * 31 + zy);
+    for (auto& v : fb) v = (uint8_t)rng();
+    std::vector<uint8_t> before = fb;
+    TileSurface s = {fb.data(), PITCH, FB_W, FB_H};
+    DrawListDecoder d;
+    d.begin(s, dict);
+    for (size_t off = 0; off < list.size();) {
+        size_t n = chunk ? chunk : 1 + rng() % 700;
+        n = std::min(n, list.size() - off);
+        if (!d.feed(list.data() + off, n)) return false;
+        off += n;
+    }
+    if (out) *out = d;
+    if (!d.done()) return false;
+    bool ok = true;
+    for (int y = 0; y < FB_H && ok; y++)
+        for (int x = 0; x < FB_W && ok; x++) {
+            bool in = x >= zx && x < zx + zone.w && y >= zy && y < zy + zone.h;
+            bool want = in ? zone.white(x - zx, y - zy) : (bool)((before[y * PITCH + (x >> 3)] >> (7 - (x & 7))) & 1);
+            ok = fbWhite(fb, x, y) == want;
+        }
+    return ok;
+}
+
+static void roundTrip(const char* what, const Bitmap& zone, const std::vector<SpritePlacement>& drawn, size_t maxBytes) {
+    Bitmap read;
+    CHECK(spriteReadBmp(toBmp(zone), read));
+    CHECK(read.w == zone.w && read.h == zone.h && read.px == zone.px);
+
+    // Placements recovered from pixels match what was drawn
+    std::vector<SpritePlacement> found = spriteFind(dict, read);
+    CHECK(found.size() == drawn.size());
+    for (size_t i = 0; i < found.size() && i < drawn.size(); i++)
+        CHECK(found[i].id == drawn[i].id && found[i].x == drawn[i].x && found[i].y == drawn[i].y);
+
+    const int origins[][2] = {{16, 136}, {21, 301}, {FB_W - zone.w, FB_H - zone.h}};
+    for (const auto& o : origins) {
+        DrawListStats st;
+        std::vector<uint8_t> list = drawListEncode(dict, read, o[0], o[1], drawn, &st);
+        CHECK(st.sprites == drawn.size());
+        CHECK(list.size() <= maxBytes);
+        DrawListDecoder d;
+        CHECK(decodeAndCompare(list, zone, o[0], o[1], 1, &d));
+        CHECK(d.sprites() == (int)drawn.size() && d.applied() == d.ops());
+        int rx, ry, rw, rh;
+        CHECK(d.dirtyRect(rx, ry, rw, rh) && rx == o[0] && ry == o[1] && rw == zone.w && rh == zone.h);
+        CHECK(decodeAndCompare(list, zone, o[0], o[1], 0));
+    }
+    DrawListStats st;
+    size_t bytes = drawListEncode(dict, read, 0, 0, drawn, &st).size();
+    printf("  %-14s %3dx%-3d BMP %5zu bytes, draw list %4zu bytes (%zu sprites, %zu fills, %zu bits ops / %zu bytes)\n",
+           what, zone.w, zone.h, toBmp(zone).size(), bytes, st.sprites, st.fills, st.bitsOps, st.bitsBytes);
+}
+
+static void testDictionary() {
+    std::ifstream f(SPRITE_SOURCE);
+    std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    uint32_t version;
+    std::string err;
+    CHECK(spriteParseSource(text, version, sources, err));
+    if (!err.empty()) fprintf(stderr, "%s: %s\n", SPRITE_SOURCE, err.c_str());
+    CHECK(version >= 1 && sources.size() >= 12);
+    image = spriteBuildDict(version, sources);
+    CHECK(dict.open(image.data(), image.size()));
+    CHECK(dict.version() == version && dict.count() == (int)sources.size());
+    for (const SpriteSource& s : sources) {
+        const SpriteEntry* e = dict.find(s.id);
+        CHECK(e && e->w == s.bits.w && e->h == s.bits.h);
+        if (e) CHECK(spriteMatches(dict, *e, s.bits, 0, 0));
+    }
+    CHECK(dict.find(0) == nullptr && dict.find(999) == nullptr);
+
+    // A whole partition is fine; a flipped bit or a short image is not
+    std::vector<uint8_t> partition = image;
+    partition.resize(0x4000, 0xFF);
+    SpriteDict d;
+    CHECK(d.open(partition.data(), partition.size()));
+    std::vector<uint8_t> bad = image;
+    bad[bad.size() - 1] ^= 1;
+    CHECK(!d.open(bad.data(), bad.size()));
+    CHECK(d.open(bad.data(), bad.size(), false));
+    CHECK(!d.open(image.data(), image.size() - 1));
+    std::vector<uint8_t> erased(0x4000, 0xFF);
+    CHECK(!d.open(erased.data(), erased.size()) && !d.valid());
+
+    std::vector<SpriteSource> out;
+    CHECK(!spriteParseSource("sprite 1 x 2x1\n##\n", version, out, err));                 // no version
+    CHECK(!spriteParseSource("version 1\nsprite 1 x 2x2\n##\n#\n", version, out, err));    // short row
+    CHECK(!spriteParseSource("version 1\nsprite 1 x 1x1\n#\nsprite 1 y 1x1\n.\n", version, out, err));
+}
+
+// The shift-merge path against writing every byte through tilePutByte()
+static void testBlitKernel() {
+    std::mt19937 rng(5);
+    std::vector<uint8_t> src(40 * 8);
+    for (auto& v : src) v = (uint8_t)rng();
+    for (int x : {0, 1, 7, 8, 13, 771, 790, -5}) {
+        for (int w : {1, 7, 8, 9, 24, 37, 64}) {
+            std::vector<uint8_t> fast(PITCH * 8), ref;
+            for (auto& v : fast) v = (uint8_t)rng();
+            ref = fast;
+            TileSurface sf = {fast.data(), PITCH, FB_W, 8}, sr = {ref.data(), PITCH, FB_W, 8};
+            spriteBlit(sf, x, 0, src.data(), w, 8, 8);
+            for (int r = 0; r < 8; r++)
+                for (int b = 0; b * 8 < w; b++) tilePutByte(sr, x + b * 8, r, src[r * 8 + b], tileEdgeMask(w - b * 8));
+            CHECK(fast == ref);
+        }
+    }
+    std::vector<uint8_t> fb(PITCH * 4, 0x5A);
+    TileSurface s = {fb.data(), PITCH, FB_W, 4};
+    spriteFill(s, 3, 1, 10, 2, true);
+    for (int y = 0; y < 4; y++)
+        for (int x = 0; x < 24; x++) {
+            bool want = (y >= 1 && y < 3 && x >= 3 && x < 13) ? true : (bool)((0x5A >> (7 - (x & 7))) & 1);
+            CHECK(fbWhite(fb, x, y) == want);
+        }
+}
+
+static void testZones() {
+    printf("zones:\n");
+    // leg.info: border, pictogram, two lines of text
+    for (const char* icon : {"train", "tram", "bus", "walk", "coffee"}) {
+        Bitmap z = blank(684, 50);
+        stroke(z, 0, 0, 684, 48);
+        place(z, sprite(icon), 8, 12);
+        text(z, 40, 8, 300, 12, 1);
+        text(z, 40, 27, 200, 9, 2);
+        roundTrip(icon, z, {{sprite(icon).id, 8, 12}}, 1400);
+    }
+    // header.weather without the temperature text: sprites and fills only
+    for (const char* icon : {"sun", "partly", "cloud", "rain", "storm", "fog"}) {
+        Bitmap z = blank(144, 80);
+        stroke(z, 0, 0, 144, 80);
+        place(z, sprite(icon), 144 - 24 - 10, 10);
+        roundTrip(icon, z, {{sprite(icon).id, 110, 10}}, 100);
+    }
+    // Black bar with white text, no sprites
+    Bitmap bar = blank(800, 28);
+    rect(bar, 0, 0, 800, 28, false);
+    Bitmap glyphs = blank(800, 28);
+    text(glyphs, 16, 8, 120, 12, 3);
+    for (size_t i = 0; i < bar.px.size(); i++) if (!glyphs.px[i]) bar.px[i] = 1;
+    roundTrip("footer", bar, {}, 1600);
+    // Two sprites side by side plus one the encoder is wrongly told about
+    Bitmap z = blank(200, 40);
+    place(z, sprite("walk"), 4, 6);
+    place(z, sprite("coffee"), 40, 6);
+    Bitmap read;
+    spriteReadBmp(toBmp(z), read);
+    DrawListStats st;
+    std::vector<uint8_t> list = drawListEncode(dict, read, 16, 16, {{sprite("walk").id, 4, 6}, {sprite("coffee").id, 40, 6}, {sprite("rain").id, 100, 6}}, &st);
+    CHECK(st.sprites == 2 && st.bitsOps == 0);
+    CHECK(decodeAndCompare(list, z, 16, 16, 3));
+}
+
+static void testMalformed() {
+    Bitmap z = blank(64, 32);
+    place(z, sprite("bus"), 4, 4);
+    std::vector<uint8_t> list = drawListEncode(dict, z, 8, 8, {{sprite("bus").id, 4, 4}});
+    CHECK(decodeAndCompare(list, z, 8, 8, 5));
+
+    std::vector<uint8_t> fb(PITCH * FB_H, 0xFF);
+    TileSurface s = {fb.data(), PITCH, FB_W, FB_H};
+    DrawListDecoder d;
+    auto run = [&](const std::vector<uint8_t>& l) { d.begin(s, dict); d.feed(l.data(), l.size()); return d.error(); };
+
+    // Made for another dictionary: refused before anything is drawn
+    std::vector<uint8_t> bad = list;
+    bad[12] ^= 1;
+    CHECK(run(bad) && d.staleDict() && d.applied() == 0);
+    SpriteDict none;
+    d.begin(s, none);
+    d.feed(list.data(), list.size());
+    CHECK(d.error() && d.staleDict());
+
+    bad = list;
+    bad[0] = 'X';
+    CHECK(run(bad) && !d.staleDict());
+
+    // The sprite op follows the background fill: id, then x past the zone
+    size_t spriteOp = DRAW_LIST_HEADER_SIZE + 10;
+    CHECK(list[spriteOp] == DRAW_SPRITE);
+    bad = list;
+    bad[spriteOp + 1] = 0xEE; bad[spriteOp + 2] = 0x03;
+    CHECK(run(bad));
+    bad = list;
+    bad[spriteOp + 3] = 50;    // 50 + 24 > 64
+    CHECK(run(bad));
+    bad = list;
+    bad[DRAW_LIST_HEADER_SIZE + 7] = 33;    // fill 64x33 in a 64x32 zone
+    CHECK(run(bad));
+    bad = list;
+    bad[DRAW_LIST_HEADER_SIZE] = 9;         // unknown op
+    CHECK(run(bad));
+
+    // Truncated: not an error, just not done
+    CHECK(!run(std::vector<uint8_t>(list.begin(), list.end() - 3)) && !d.done());
+    // An empty list is done at once and touches nothing
+    std::vector<uint8_t> empty(list.begin(), list.begin() + DRAW_LIST_HEADER_SIZE);
+    empty[16] = empty[17] = 0;
+    int x, y, w, h;
+    CHECK(!run(empty) && d.done() && !d.dirtyRect(x, y, w, h));
+}
+
+int main() {
+    testDictionary();
+    if (!dict.valid()) { fprintf(stderr, "no dictionary, giving up\n"); return 1; }
+    testBlitKernel();
+    testZones();
+    testMalformed();
+    return checkReport("sprites");
+}
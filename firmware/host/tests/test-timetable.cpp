@@ -0,0 +1,191 @@
+/**
+ * GTFS compiler and offline timetable lookups on a hand-written feed
+ *
+ * The feed covers a station with two platforms, a tram stop with enough
+ * departures to span several blocks, and a stop whose gap between
+ * departures doesn't fit a 16-bit delta. Checks weekday/weekend calendars,
+ * a public-holiday exception, trips running past midnight, arrival-only
+ * last stops, no-pickup stops, mode filtering, quoted CSV and CRC checks.
+ *
+ * Usage: ./test-timetable
+ */
+
+#include "gtfs_compile.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+static void writeFile(const std::string& dir, const char* name, const std::string& body) {
+    FILE* f = fopen((dir + "/" + name).c_str(), "wb");
+    fputs(body.c_str(), f);
+    fclose(f);
+}
+
+static std::string hms(int sec) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d", sec / 3600, sec / 60 % 60, sec % 60);
+    return buf;
+}
+
+static std::string makeFeed() {
+    char dir[] = "/tmp/test-timetable-XXXXXX";
+    if (!mkdtemp(dir)) return "";
+    writeFile(dir, "stops.txt",
+              "\xEF\xBB\xBFstop_id,stop_name,parent_station\n"
+              "S1,South Yarra Station,\n"
+              "S1P1,South Yarra Platform 1,S1\n"
+              "S1P2,South Yarra Platform 2,S1\n"
+              "T9,Toorak Rd/Chapel St,\n"
+              "G,Sparse Stop,\n"
+              "X,Terminus,\n");
+    writeFile(dir, "routes.txt",
+              "route_id,route_short_name,route_long_name,route_type\n"
+              "R1,,Frankston,2\n"
+              "R2,58,West Coburg - Toorak,0\n"
+              "R3,SUB,Suburban,109\n");
+    writeFile(dir, "trips.txt",
+              "route_id,service_id,trip_id,trip_headsign\n"
+              "R1,WK,W1,\"Flinders St, City\"\n"
+              "R1,WK,W2,Frankston\n"
+              "R1,WK,L1,Flinders Street\n"
+              "R1,WE,E1,Flinders Street\n"
+              "R1,WK,P1,Flinders Street\n"
+              "R1,OLD,O1,Flinders Street\n"
+              "R3,WK,G1,Sparse\n"
+              "R3,WK,G2,Sparse\n");
+    std::string st = "trip_id,arrival_time,departure_time,stop_id,stop_sequence,pickup_type\n"
+                     "W1,08:00:00,08:00:00,S1P1,1,0\n"
+                     "W1,08:10:00,08:10:00,X,2,0\n"
+                     "W2,08:05:00,08:05:00,S1P2,1,\n"
+                     "W2,08:30:00,08:30:00,X,2,\n"
+                     "L1,25:10:00,25:10:00,S1P1,1,0\n"
+                     "L1,25:20:00,25:20:00,X,2,0\n"
+                     "E1,09:00:00,09:00:00,S1P1,1,0\n"
+                     "E1,09:20:00,09:20:00,X,2,0\n"
+                     "P1,10:00:00,10:00:00,S1P1,1,1\n"
+                     "P1,10:10:00,10:10:00,X,2,0\n"
+                     "O1,07:00:00,07:00:00,S1P1,1,0\n"
+                     "O1,07:10:00,07:10:00,X,2,0\n"
+                     "G1,03:00:00,03:00:00,G,1,0\n"
+                     "G1,03:10:00,03:10:00,X,2,0\n"
+                     "G2,23:30:00,23:30:00,G,1,0\n"
+                     "G2,23:40:00,23:40:00,X,2,0\n"
+                     // Last stop of a trip that does stop at T9 earlier: arrival only
+                     "TL,23:00:00,23:00:00,X,1,0\n"
+                     "TL,23:10:00,23:10:00,T9,2,0\n";
+    // Trams every 10 minutes 06:00-12:50: 42 departures, three blocks
+    std::string trips;
+    for (int i = 0; i < 42; i++) {
+        std::string id = "T" + std::to_string(i);
+        int t = 6 * 3600 + i * 600;
+        st += id + "," + hms(t) + "," + hms(t) + ",T9,1,0\n";
+        st += id + "," + hms(t + 900) + "," + hms(t + 900) + ",X,2,0\n";
+        trips += "R2,WK," + id + ",West Coburg\n";
+    }
+    trips += "R2,WK,TL,Toorak\n";
+    FILE* f = fopen((std::string(dir) + "/trips.txt").c_str(), "ab");
+    fputs(trips.c_str(), f);
+    fclose(f);
+    writeFile(dir, "stop_times.txt", st);
+    writeFile(dir, "calendar.txt",
+              "service_id,monday,tuesday,wednesday,thursday,friday,saturday,sunday,start_date,end_date\n"
+              "WK,1,1,1,1,1,0,0,20260101,20261231\n"
+              "WE,0,0,0,0,0,1,1,20260101,20261231\n"
+              "OLD,1,1,1,1,1,1,1,20250101,20251231\n");
+    // Labour Day (Mon 9 Mar) runs to the weekend timetable
+    writeFile(dir, "calendar_dates.txt",
+              "service_id,date,exception_type\n"
+              "WK,20260309,2\n"
+              "WE,20260309,1\n");
+    return dir;
+}
+
+static void removeFeed(const std::string& dir) {
+    for (const char* f : {"stops.txt", "routes.txt", "trips.txt", "stop_times.txt", "calendar.txt", "calendar_dates.txt"})
+        unlink((dir + "/" + f).c_str());
+    rmdir(dir.c_str());
+}
+
+int main() {
+    std::string dir = makeFeed();
+    CHECK(!dir.empty());
+    GtfsOptions opt;
+    opt.dir = dir;
+    opt.stops = {"S1", "T9", "G"};
+    opt.firstDay = ttDaysFromCivil(2026, 3, 2);    // a Monday
+    opt.dayCount = 14;
+
+    GtfsCompiler compiler(opt);
+    std::vector<uint8_t> image;
+    CHECK(compiler.compile(image));
+    if (!compiler.error().empty()) fprintf(stderr, "compile: %s\n", compiler.error().c_str());
+    CHECK(compiler.stats().services == 2);                     // OLD is outside the window
+    CHECK(image.size() % 4 == 0 && image.size() < 2048);
+
+    Timetable tt;
+    CHECK(tt.open(image.data(), image.size() + 100));           // partition bigger than the image
+    CHECK(tt.stopCount() == 5);                                 // S1, S1P1, S1P2, T9, G
+    CHECK(tt.findStop("S1P2") >= 0 && tt.findStop("X") < 0 && tt.findStop("") < 0);
+    CHECK(strcmp(tt.stopName(tt.findStop("T9")), "Toorak Rd/Chapel St") == 0);
+
+    uint32_t mon = (uint32_t)opt.firstDay, tue = mon + 1, sat = mon + 5, holiday = mon + 7;
+    TtDeparture d[TT_MAX_RESULTS];
+    uint32_t rail = TT_MODE_BIT(TT_RAIL);
+
+    // Both platforms of the station, earliest first; P1 has no pickup, O1 is out of date
+    int n = tt.next(-1, mon, 7 * 3600, rail, d, 4);
+    CHECK(n == 4);
+    CHECK(n > 0 && d[0].time == 8 * 3600 && strcmp(d[0].headsign, "Flinders St, City") == 0 && strcmp(d[0].route, "Frankston") == 0);
+    CHECK(n > 1 && d[1].time == 8 * 3600 + 300 && d[1].stop == tt.findStop("S1P2"));
+    CHECK(n > 2 && d[2].time == 23 * 3600 + 1800 && strcmp(d[2].route, "SUB") == 0);   // extended type 109 is rail
+    CHECK(n > 3 && d[3].time == 25 * 3600 + 600);                                      // L1, tonight after midnight
+
+    // Tuesday 00:30: Monday's 25:10 trip shows as 01:10
+    n = tt.next(tt.findStop("S1P1"), tue, 1800, rail, d, 2);
+    CHECK(n == 2 && d[0].time == 3600 + 600 && d[1].time == 8 * 3600);
+
+    // Saturday and the holiday Monday run the weekend service only (Friday night's late trip still shows)
+    n = tt.next(tt.findStop("S1P1"), sat, 0, rail, d, 3);
+    CHECK(n == 2 && d[0].time == 3600 + 600 && d[1].time == 9 * 3600);
+    n = tt.next(tt.findStop("S1P1"), holiday, 0, rail, d, 3);
+    CHECK(n == 1 && d[0].time == 9 * 3600);
+
+    // Trams: across block boundaries, filtered by mode
+    int t9 = tt.findStop("T9");
+    n = tt.next(t9, mon, 6 * 3600 + 300, TT_MODE_BIT(TT_TRAM), d, 3);
+    CHECK(n == 3 && d[0].time == 6 * 3600 + 600 && d[2].time == 6 * 3600 + 1800 && strcmp(d[0].route, "58") == 0);
+    n = tt.next(t9, mon, 8 * 3600 + 40 * 60 + 1, TT_MODE_BIT(TT_TRAM), d, 2);    // 16th/17th departures
+    CHECK(n == 2 && d[0].time == 8 * 3600 + 50 * 60 && d[1].time == 9 * 3600);
+    n = tt.next(t9, mon, 13 * 3600, TT_MODE_BIT(TT_TRAM), d, 2);
+    CHECK(n == 0);                                     // TL ends at T9: arrival only
+    CHECK(tt.next(t9, mon, 0, rail, d, 2) == 0);
+
+    // 20.5h between departures: split into two blocks
+    int g = tt.findStop("G");
+    n = tt.next(g, mon, 4 * 3600, TT_ALL_MODES, d, 3);
+    CHECK(n == 1 && d[0].time == 23 * 3600 + 1800);
+    n = tt.next(g, mon, 0, TT_ALL_MODES, d, 3);
+    CHECK(n == 2 && d[0].time == 3 * 3600);
+
+    // Outside the window nothing runs; asking for more than the cap is clamped
+    CHECK(tt.next(-1, mon + 20, 0, TT_ALL_MODES, d, 4) == 0);
+    CHECK(tt.next(-1, mon, 0, TT_ALL_MODES, d, 100) == TT_MAX_RESULTS);
+
+    // Corruption is caught unless the caller opts out
+    image[image.size() - 8] ^= 0x01;
+    CHECK(!tt.open(image.data(), image.size()));
+    CHECK(tt.open(image.data(), image.size(), false));
+    CHECK(!tt.open(image.data(), image.size() - 4, false));
+
+    GtfsOptions bad = opt;
+    bad.stops = {"NOPE"};
+    GtfsCompiler missing(bad);
+    CHECK(!missing.compile(image) && missing.error().find("NOPE") != std::string::npos);
+
+    removeFeed(dir);
+    return checkReport("timetable");
+}
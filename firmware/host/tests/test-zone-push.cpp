@@ -0,0 +1,145 @@
+/**
+ * Zone push client against a stand-in SSE server
+ *
+ * Covers chunked and plain streams, events split across reads,
+ * heartbeats, reconnect with Last-Event-ID, heartbeat timeout, and the
+ * fallback to polling once the server goes away.
+ *
+ * Usage: ./test-zone-push
+ */
+
+#include "posix_client.hpp"
+#include "standin_server.hpp"
+#include "zone_push.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+static const ZoneDef ZONES[] = {
+    {"time", 20, 45, 180, 70, 1},
+    {"weather", 620, 10, 160, 95, 2},
+    {"trains", 20, 155, 370, 150, 1},
+    {"trams", 410, 155, 370, 150, 1},
+    {"coffee", 20, 315, 760, 65, 2},
+    {"footer", 0, 445, 800, 35, 3},
+};
+static const int ZONE_COUNT = sizeof(ZONES) / sizeof(ZONES[0]);
+
+struct Received { std::vector<uint32_t> versions; bool flags[ZONE_COUNT] = {false}; };
+
+static void onEvent(const ZonePushEvent& ev, void* ctx) {
+    Received* r = (Received*)ctx;
+    r->versions.push_back(ev.version);
+    parseZoneList(ev.zones, ev.zonesLen, ZONES, ZONE_COUNT, r->flags);
+}
+
+static std::string chunk(const std::string& s) {
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", s.size());
+    return size + s + "\r\n";
+}
+
+template <class Pred>
+static bool pollUntil(ZonePushClient<Client>& push, Received& rx, Pred done, int timeoutMs = 3000) {
+    unsigned long start = millis();
+    while (!done()) {
+        if (millis() - start > (unsigned long)timeoutMs) return false;
+        push.poll(onEvent, &rx);
+        delay(2);
+    }
+    return true;
+}
+
+static void testParseZoneList() {
+    bool flags[ZONE_COUNT] = {false};
+    const char* csv = " time, footer ,unknown,,trains\n";
+    CHECK(parseZoneList(csv, strlen(csv), ZONES, ZONE_COUNT, flags) == 3);
+    CHECK(flags[0] && flags[2] && flags[5] && !flags[1] && !flags[3] && !flags[4]);
+    const char* prefix = "tim,foot";
+    bool none[ZONE_COUNT] = {false};
+    CHECK(parseZoneList(prefix, strlen(prefix), ZONES, ZONE_COUNT, none) == 0);
+}
+
+static void testServerUrl() {
+    ServerEndpoint ep;
+    CHECK(parseServerUrl("https://ptvtrmnl.vercel.app", ep) && ep.tls && ep.port == 443 && strcmp(ep.host, "ptvtrmnl.vercel.app") == 0 && ep.prefix[0] == '\0');
+    CHECK(parseServerUrl("http://192.168.1.20:8080/trmnl/", ep) && !ep.tls && ep.port == 8080 && strcmp(ep.prefix, "/trmnl") == 0);
+    CHECK(!parseServerUrl("ftp://x", ep));
+    CHECK(!parseServerUrl("http://host:99999", ep));
+}
+
+static void testStream() {
+    StandinServer server;
+    CHECK(server.listen());
+    std::string head1, head2;
+
+    std::thread script([&] {
+        // 1: chunked stream, event split mid-line across chunks, then clean close
+        int c = server.accept(2000);
+        head1 = StandinServer::readHead(c);
+        StandinServer::send(c, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nTransfer-Encoding: chunked\r\n\r\n");
+        StandinServer::send(c, chunk("id: 3\nevent: hello\ndata:\n\n: hb\n\n"));
+        delay(20);
+        StandinServer::send(c, chunk("id: 7\nevent: zo"));
+        delay(20);
+        StandinServer::send(c, chunk("nes\ndata: time,trains\n\n"));
+        StandinServer::send(c, "0\r\n\r\n");
+        delay(50);
+        ::close(c);
+
+        // 2: plain stream resumed from Last-Event-ID, then goes silent
+        c = server.accept(2000);
+        head2 = StandinServer::readHead(c);
+        StandinServer::send(c, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\nid: 8\ndata: footer\n\n");
+        delay(700);   // longer than PUSH_HEARTBEAT_TIMEOUT_MS
+        ::close(c);
+
+        // 3: not an event stream -> rejected
+        c = server.accept(2000);
+        StandinServer::readHead(c);
+        StandinServer::send(c, "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\n\r\n");
+        ::close(c);
+        server.close();
+    });
+
+    ServerEndpoint ep;
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u", server.port());
+    CHECK(parseServerUrl(url, ep));
+    PosixClient transport;
+    ZonePushClient<Client> push;
+    CHECK(push.msUntilDue() == 0xFFFFFFFFu);
+    push.begin(transport, ep, "PTV-TRMNL/test");
+    Received rx;
+
+    CHECK(pollUntil(push, rx, [&] { return rx.versions.size() >= 1; }));
+    CHECK(rx.versions.size() == 1 && rx.versions[0] == 7);
+    CHECK(rx.flags[0] && rx.flags[2] && !rx.flags[5]);
+    CHECK(head1.find("GET /api/zones/stream HTTP/1.1") == 0);
+    CHECK(head1.find("Accept: text/event-stream") != std::string::npos);
+
+    CHECK(pollUntil(push, rx, [&] { return rx.versions.size() >= 2; }));
+    CHECK(rx.versions.size() == 2 && rx.versions[1] == 8 && rx.flags[5]);
+    CHECK(head2.find("Last-Event-ID: 7\r\n") != std::string::npos);
+    CHECK(push.streaming());
+    // A sleeping caller must be back by the heartbeat deadline
+    CHECK(push.msUntilDue() > 0 && push.msUntilDue() <= PUSH_HEARTBEAT_TIMEOUT_MS + 1);
+
+    // Silence past the heartbeat timeout forces a reconnect, which gets a 404,
+    // then the listener is gone: PUSH_MAX_FAILURES later we're polling.
+    CHECK(pollUntil(push, rx, [&] { return push.fallback(); }, 5000));
+    CHECK(!push.streaming());
+    CHECK(push.version() == 8);
+    CHECK(push.events() == 2);
+    CHECK(push.msUntilDue() > PUSH_FALLBACK_RETRY_MS - 1000 && push.msUntilDue() <= PUSH_FALLBACK_RETRY_MS);
+    script.join();
+}
+
+int main() {
+    testParseZoneList();
+    testServerUrl();
+    testStream();
+    return checkReport("zone push");
+}
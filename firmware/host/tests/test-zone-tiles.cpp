@@ -0,0 +1,192 @@
+/**
+ * Tile delta decoder against hand-built streams
+ *
+ * Applies RAW, FILL, SPARSE and XOR records to an 800x480 framebuffer at
+ * a zone origin that isn't byte aligned, with partial edge tiles, one byte
+ * at a time, and checks every pixel. Also covers hash bookkeeping, XOR against
+ * a tile the device doesn't hold and malformed streams.
+ *
+ * Usage: ./test-zone-tiles
+ */
+
+#include "zone_tiles.hpp"
+#include "check.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static const int FB_W = 800, FB_H = 480, PITCH = FB_W / 8;
+
+// Zone like "coffee": 760x65 at x=21, so tiles straddle bytes and the last row/column is partial
+static const int ZX = 21, ZY = 315, ZW = 760, ZH = 65;
+
+struct Image { int w, h; std::vector<uint8_t> px; bool at(int x, int y) const { return px[y * w + x]; } };  // true = white
+
+static Image pattern(int w, int h, unsigned seed) {
+    Image img = {w, h, std::vector<uint8_t>(w * h)};
+    srand(seed);
+    for (auto& p : img.px) p = (rand() % 5) != 0;
+    return img;
+}
+
+static void tileOf(const Image& img, int index, uint8_t* tile) {
+    int across = tilesAcross(img.w);
+    int tx = (index % across) * TILE_W, ty = (index / across) * TILE_H;
+    memset(tile, 0xFF, TILE_BYTES);
+    for (int r = 0; r < TILE_H && ty + r < img.h; r++)
+        for (int c = 0; c < TILE_W && tx + c < img.w; c++)
+            if (!img.at(tx + c, ty + r)) tile[r * TILE_ROW_BYTES + c / 8] &= ~(0x80 >> (c % 8));
+}
+
+static void put16(std::vector<uint8_t>& s, int v) { s.push_back(v & 0xFF); s.push_back((v >> 8) & 0xFF); }
+static void put32(std::vector<uint8_t>& s, uint32_t v) { for (int i = 0; i < 4; i++) s.push_back((v >> (8 * i)) & 0xFF); }
+
+static std::vector<uint8_t> header(int records) {
+    std::vector<uint8_t> s = {'Z', 'T', TILE_VERSION, 0, TILE_W, TILE_H};
+    put16(s, ZX); put16(s, ZY); put16(s, ZW); put16(s, ZH); put16(s, records);
+    return s;
+}
+
+static void record(std::vector<uint8_t>& s, int index, TileOp op, const std::vector<uint8_t>& payload, uint32_t hash) {
+    put16(s, index); s.push_back(op); s.push_back((uint8_t)payload.size()); put32(s, hash);
+    s.insert(s.end(), payload.begin(), payload.end());
+}
+
+// Mirrors the server's sparse runs (no gap absorption - the decoder doesn't care)
+static std::vector<uint8_t> xorRuns(const uint8_t* prev, const uint8_t* next) {
+    std::vector<uint8_t> out;
+    int i = 0;
+    while (i < TILE_BYTES) {
+        int skip = 0;
+        while (i < TILE_BYTES && prev[i] == next[i]) { skip++; i++; }
+        if (i >= TILE_BYTES) break;
+        int end = i;
+        while (end < TILE_BYTES && prev[end] != next[end]) end++;
+        out.push_back(skip); out.push_back(end - i);
+        for (int k = i; k < end; k++) out.push_back(prev[k] ^ next[k]);
+        i = end;
+    }
+    return out;
+}
+
+static bool fbPixel(const std::vector<uint8_t>& fb, int x, int y) { return fb[y * PITCH + x / 8] & (0x80 >> (x % 8)); }
+
+static int zoneDiffs(const std::vector<uint8_t>& fb, const Image& img) {
+    int bad = 0;
+    for (int y = 0; y < img.h; y++)
+        for (int x = 0; x < img.w; x++)
+            if (fbPixel(fb, ZX + x, ZY + y) != img.at(x, y)) bad++;
+    return bad;
+}
+
+static bool feedBytewise(TileStreamDecoder& dec, const std::vector<uint8_t>& s) {
+    for (uint8_t b : s) if (!dec.feed(&b, 1)) return false;
+    return dec.done();
+}
+
+int main() {
+    const int count = tileCount(ZW, ZH);
+    CHECK(count == 12 * 5);
+
+    std::vector<uint8_t> fb(PITCH * FB_H, 0x00);   // start black so padding bugs show up
+    TileSurface surface = {fb.data(), PITCH, FB_W, FB_H};
+    std::vector<uint32_t> hashes(count, 0);
+    uint8_t tile[TILE_BYTES];
+
+    // 1. Full send: tile 0 blank (FILL), tile 1 nearly blank (SPARSE), the rest RAW
+    Image first = pattern(ZW, ZH, 1);
+    for (int x = 0; x < 2 * TILE_W; x++) for (int y = 0; y < TILE_H; y++) first.px[y * ZW + x] = 1;
+    first.px[3 * ZW + 70] = first.px[9 * ZW + 100] = 0;
+    uint8_t white[TILE_BYTES];
+    memset(white, 0xFF, TILE_BYTES);
+    std::vector<uint8_t> s = header(count);
+    for (int i = 0; i < count; i++) {
+        tileOf(first, i, tile);
+        if (i == 0) record(s, i, TILE_FILL, {0xFF}, tileHash(tile));
+        else if (i == 1) record(s, i, TILE_SPARSE, xorRuns(white, tile), tileHash(tile));
+        else record(s, i, TILE_RAW, std::vector<uint8_t>(tile, tile + TILE_BYTES), tileHash(tile));
+    }
+    TileStreamDecoder dec;
+    dec.begin(surface, hashes.data(), count);
+    CHECK(feedBytewise(dec, s));
+    CHECK(dec.applied() == count && dec.mismatches() == 0);
+    CHECK(dec.bytes() == s.size());
+    CHECK(zoneDiffs(fb, first) == 0);
+    // Outside the zone is untouched
+    CHECK(!fbPixel(fb, ZX - 1, ZY) && !fbPixel(fb, ZX + ZW, ZY) && !fbPixel(fb, ZX, ZY + ZH));
+    int dx, dy, dw, dh;
+    CHECK(dec.dirtyRect(dx, dy, dw, dh) && dx == ZX && dy == ZY && dw == ZW && dh == ZH);
+
+    // The device's own view of the framebuffer agrees with the hashes it stored
+    std::vector<uint32_t> rehash(count, 0);
+    tileHashRegion(surface, ZX, ZY, ZW, ZH, rehash.data(), count);
+    CHECK(rehash == hashes);
+
+    // 2. Delta: a few words change in two tiles, sent as XOR against the held tiles
+    Image second = first;
+    for (int x = 200; x < 260; x++) for (int y = 20; y < 30; y++) second.px[y * ZW + x] = !second.px[y * ZW + x];
+    s = header(0);
+    int changed = 0;
+    for (int i = 0; i < count; i++) {
+        uint8_t prev[TILE_BYTES];
+        tileOf(first, i, prev); tileOf(second, i, tile);
+        if (tileHash(tile) == hashes[i]) continue;
+        record(s, i, TILE_XOR, xorRuns(prev, tile), tileHash(tile));
+        changed++;
+    }
+    s[14] = changed;
+    CHECK(changed == 2);
+    dec.begin(surface, hashes.data(), count);
+    // Arbitrary chunking
+    for (size_t off = 0; off < s.size(); off += 7) dec.feed(s.data() + off, s.size() - off < 7 ? s.size() - off : 7);
+    CHECK(dec.done() && !dec.error());
+    CHECK(dec.applied() == 2 && dec.mismatches() == 0);
+    CHECK(zoneDiffs(fb, second) == 0);
+    CHECK(dec.dirtyRect(dx, dy, dw, dh) && dx == ZX + 192 && dy == ZY + 16 && dw == 128 && dh == 16);
+    tileHashRegion(surface, ZX, ZY, ZW, ZH, rehash.data(), count);
+    CHECK(rehash == hashes);
+
+    // 3. XOR against a tile the device doesn't hold: applied, flagged, hash forgotten
+    Image third = second;
+    third.px[5 * ZW + 5] = !third.px[5 * ZW + 5];
+    uint8_t wrongPrev[TILE_BYTES];
+    tileOf(pattern(ZW, ZH, 99), 0, wrongPrev);
+    tileOf(third, 0, tile);
+    s = header(1);
+    record(s, 0, TILE_XOR, xorRuns(wrongPrev, tile), tileHash(tile));
+    dec.begin(surface, hashes.data(), count);
+    CHECK(feedBytewise(dec, s));
+    CHECK(dec.mismatches() == 1 && hashes[0] == 0);
+
+    // 4. Nothing changed: empty stream
+    s = header(0);
+    dec.begin(surface, hashes.data(), count);
+    CHECK(dec.feed(s.data(), s.size()) && dec.done() && dec.applied() == 0);
+    CHECK(!dec.dirtyRect(dx, dy, dw, dh));
+
+    // 5. Malformed streams are rejected
+    s = header(1); s[0] = 'X';
+    dec.begin(surface, hashes.data(), count);
+    CHECK(!dec.feed(s.data(), s.size()));
+    s = header(1); record(s, count, TILE_FILL, {0x00}, 1);          // index out of range
+    dec.begin(surface, hashes.data(), count);
+    CHECK(!dec.feed(s.data(), s.size()));
+    s = header(1); record(s, 1, TILE_RAW, {0x00, 0x00}, 1);         // short raw tile
+    dec.begin(surface, hashes.data(), count);
+    CHECK(!dec.feed(s.data(), s.size()));
+    s = header(1); record(s, 1, TILE_XOR, {120, 20, 1}, 1);         // run past the tile
+    dec.begin(surface, hashes.data(), count);
+    CHECK(!dec.feed(s.data(), s.size()));
+
+    // 6. Clipping at the framebuffer edge
+    uint8_t edge[TILE_BYTES];
+    memset(edge, 0x00, TILE_BYTES);
+    tileWrite(surface, FB_W - 20, FB_H - 4, TILE_W, TILE_H, edge);
+    tileWrite(surface, -5, -3, TILE_W, TILE_H, edge);
+    CHECK(!fbPixel(fb, FB_W - 1, FB_H - 1) && !fbPixel(fb, 0, 0));
+    tileRead(surface, FB_W - 20, FB_H - 4, TILE_W, TILE_H, edge);
+    CHECK(edge[0] == 0x00 && (edge[2] & 0x0F) == 0x0F && edge[3] == 0xFF && edge[4 * TILE_ROW_BYTES] == 0xFF);
+
+    return checkReport("zone tiles");
+}
@@ -0,0 +1,255 @@
+/**
+ * LAN edge relay for sites with several displays
+ *
+ * Usage: ./edge-relay [--listen ADDR:PORT] [--poll S] [--no-push] [--cache-mb N]
+ *                     [--advertise IP] [--name NAME] [--no-mdns] [--insecure] [-v] SERVER_URL
+ *        ./edge-relay --browse
+ *
+ * Follows SERVER_URL once for the whole site and serves the zone protocol
+ * to the displays from its cache (see edge_relay.hpp), so the server sees
+ * one poller per site however many displays there are, and a display's
+ * requests are answered in LAN time. It advertises itself over mDNS as
+ * _ptv-trmnl._tcp with TXT upstream=<server host>; the firmware finds it
+ * with that (include/edge_discovery.hpp) and goes straight to the server
+ * when it isn't there. A stats line goes to stderr every minute.
+ *
+ * --poll is the upstream zone list interval while the server's push
+ * stream is down (default 20, the display's own). --advertise is the
+ * address put in the A record, by default the first non-loopback IPv4
+ * interface. With avahi-daemon on the box the built-in responder still
+ * works (the port is shared); --no-mdns and an avahi service file for
+ * _ptv-trmnl._tcp with the same TXT do the same job.
+ *
+ * --browse: list the relays on this LAN and what they relay, then exit.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "edge_relay.hpp"
+#include "mdns_service.hpp"
+
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <signal.h>
+#include <stdlib.h>
+
+#define EDGE_MDNS_SERVICE "_ptv-trmnl._tcp.local"
+#define EDGE_STATS_MS 60000
+#define EDGE_BROWSE_MS 2000
+
+static volatile sig_atomic_t stopping = 0;
+
+static void onSignal(int) { stopping = 1; }
+
+static int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--listen ADDR:PORT] [--poll S] [--no-push] [--cache-mb N]\n"
+            "          [--advertise IP] [--name NAME] [--no-mdns] [--insecure] [-v] SERVER_URL\n"
+            "       %s --browse\n",
+            argv0, argv0);
+    return 2;
+}
+
+static int listenOn(const char* spec, uint16_t& port) {
+    char addr[64] = "";
+    unsigned p = 0;
+    if (sscanf(spec, "%63[^:]:%u", addr, &p) != 2 || p == 0 || p > 65535) return -1;
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)p);
+    if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1) return -1;
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (fd < 0 || ::bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 || ::listen(fd, 64) < 0) { if (fd >= 0) ::close(fd); return -1; }
+    port = (uint16_t)p;
+    return fd;
+}
+
+// The address displays should use: the first interface that is up, not loopback, with IPv4
+static uint32_t firstLanAddress() {
+    struct ifaddrs* ifs = nullptr;
+    uint32_t addr = 0;
+    if (getifaddrs(&ifs) != 0) return 0;
+    for (struct ifaddrs* i = ifs; i && !addr; i = i->ifa_next) {
+        if (!i->ifa_addr || i->ifa_addr->sa_family != AF_INET || !(i->ifa_flags & IFF_UP) || (i->ifa_flags & IFF_LOOPBACK)) continue;
+        addr = ((struct sockaddr_in*)i->ifa_addr)->sin_addr.s_addr;
+    }
+    freeifaddrs(ifs);
+    return addr;
+}
+
+static int mdnsSocket(uint32_t iface) {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(MDNS_PORT);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    struct ip_mreq mreq = {};
+    inet_pton(AF_INET, MDNS_GROUP, &mreq.imr_multiaddr);
+    mreq.imr_interface.s_addr = iface;
+    unsigned char ttl = 255;
+    if (::bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 || setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    struct in_addr out = {};
+    out.s_addr = iface;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &out, sizeof(out));
+    return fd;
+}
+
+static void sendTo(int fd, const std::vector<uint8_t>& pkt, const struct sockaddr_in& to) {
+    ::sendto(fd, pkt.data(), pkt.size(), 0, (const struct sockaddr*)&to, sizeof(to));
+}
+
+static struct sockaddr_in mdnsGroup() {
+    struct sockaddr_in g = {};
+    g.sin_family = AF_INET;
+    g.sin_port = htons(MDNS_PORT);
+    inet_pton(AF_INET, MDNS_GROUP, &g.sin_addr);
+    return g;
+}
+
+// Until stopped: the stats line, and with an mDNS socket the answers to queries for the service
+// (announced on the way in, goodbye on the way out)
+static void run(int fd, const MdnsService& svc, EdgeRelay& relay) {
+    struct sockaddr_in group = mdnsGroup();
+    if (fd >= 0) sendTo(fd, mdnsResponse(svc), group);
+    uint64_t announceAgain = fd >= 0 ? edgeNowMs() + 1000 : 0, lastStats = edgeNowMs();
+    uint8_t buf[1500];
+    std::vector<MdnsQuestion> qs;
+    while (!stopping) {
+        struct pollfd p = { fd, POLLIN, 0 };
+        if (::poll(&p, fd >= 0 ? 1 : 0, 200) > 0) {
+            struct sockaddr_in from = {};
+            socklen_t len = sizeof(from);
+            ssize_t n = ::recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr*)&from, &len);
+            bool unicast = false;
+            if (n > 0 && mdnsParseQuestions(buf, (size_t)n, qs) && mdnsWanted(svc, qs, &unicast)) {
+                // A one-shot (legacy) resolver asks from another port and wants its id back, unicast
+                bool legacy = ntohs(from.sin_port) != MDNS_PORT;
+                sendTo(fd, mdnsResponse(svc, legacy ? mdnsGet16(buf) : 0), legacy || unicast ? from : group);
+            }
+        }
+        uint64_t now = edgeNowMs();
+        if (announceAgain && now >= announceAgain) { sendTo(fd, mdnsResponse(svc), group); announceAgain = 0; }
+        if (now - lastStats >= EDGE_STATS_MS) {
+            lastStats = now;
+            EdgeStats s = relay.stats();
+            fprintf(stderr, "displays=%u streams=%u lan=%llu hits=%llu coalesced=%llu lists=%llu upstream=%llu bytes=%llu events=%llu v=%u cache=%zuKB\n",
+                    s.displays, s.streams, (unsigned long long)s.lanRequests, (unsigned long long)s.hits,
+                    (unsigned long long)s.coalesced, (unsigned long long)s.lists, (unsigned long long)s.upstreamRequests,
+                    (unsigned long long)s.upstreamBytes, (unsigned long long)s.events, s.version, s.cacheBytes / 1024);
+        }
+    }
+    if (fd >= 0) sendTo(fd, mdnsResponse(svc, 0, true), group);
+}
+
+static int browse() {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in group = mdnsGroup();
+    std::vector<uint8_t> q = mdnsQuery(EDGE_MDNS_SERVICE, 0x5254);
+    if (fd < 0 || ::sendto(fd, q.data(), q.size(), 0, (struct sockaddr*)&group, sizeof(group)) < 0) { perror("mdns query"); return 1; }
+    uint64_t until = edgeNowMs() + EDGE_BROWSE_MS;
+    uint8_t buf[1500];
+    std::vector<MdnsRecord> records;
+    int found = 0;
+    for (uint64_t now; (now = edgeNowMs()) < until;) {
+        struct pollfd p = { fd, POLLIN, 0 };
+        if (::poll(&p, 1, (int)(until - now)) <= 0) continue;
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0 || !mdnsParseRecords(buf, (size_t)n, records)) continue;
+        std::string instance, host, txt;
+        uint16_t port = 0;
+        uint32_t addr = 0;
+        for (const MdnsRecord& r : records) {
+            if (r.type == MDNS_PTR && strcasecmp(r.name.c_str(), EDGE_MDNS_SERVICE) == 0) instance = r.target;
+            else if (r.type == MDNS_SRV) { host = r.target; port = r.port; }
+            else if (r.type == MDNS_TXT) for (const std::string& t : r.txt) txt += (txt.empty() ? "" : " ") + t;
+            else if (r.type == MDNS_A) addr = r.addr;
+        }
+        if (instance.empty()) continue;
+        char ip[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr, ip, sizeof(ip));
+        printf("%s  http://%s:%u  (%s)  %s\n", instance.c_str(), ip, port, host.c_str(), txt.c_str());
+        found++;
+    }
+    ::close(fd);
+    if (!found) printf("no relays answered\n");
+    return found ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    EdgeConfig cfg;
+    const char* url = nullptr;
+    const char* listen = "0.0.0.0:8080";
+    const char* advertiseIp = nullptr;
+    std::string name;
+    bool mdns = true;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--browse") return browse();
+        if (a == "--listen" && more) listen = argv[++i];
+        else if (a == "--poll" && more) cfg.pollMs = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (a == "--cache-mb" && more) cfg.cacheBytes = (size_t)atol(argv[++i]) << 20;
+        else if (a == "--advertise" && more) advertiseIp = argv[++i];
+        else if (a == "--name" && more) name = argv[++i];
+        else if (a == "--no-push") cfg.push = false;
+        else if (a == "--no-mdns") mdns = false;
+        else if (a == "--insecure") cfg.insecure = true;
+        else if (a == "-v") cfg.verbose = true;
+        else if (a[0] != '-' && !url) url = argv[i];
+        else return usage(argv[0]);
+    }
+    if (!url || !cfg.pollMs || !cfg.cacheBytes) return usage(argv[0]);
+    if (!parseServerUrl(url, cfg.upstream)) { fprintf(stderr, "bad server URL %s\n", url); return 2; }
+#ifndef KINDLE_TLS
+    if (cfg.upstream.tls) { fprintf(stderr, "built without TLS; use an http:// server\n"); return 2; }
+#endif
+
+    uint16_t port = 0;
+    int lfd = listenOn(listen, port);
+    if (lfd < 0) { fprintf(stderr, "can't listen on %s\n", listen); return 2; }
+
+    MdnsService svc;
+    int mfd = -1;
+    if (mdns) {
+        svc.addr = firstLanAddress();
+        if (advertiseIp && inet_pton(AF_INET, advertiseIp, &svc.addr) != 1) { fprintf(stderr, "bad address %s\n", advertiseIp); return 2; }
+        char host[64] = "edge-relay";
+        gethostname(host, sizeof(host) - 1);
+        host[strcspn(host, ".")] = '\0';
+        svc.instance = (name.empty() ? std::string(host) : name).substr(0, 63);
+        svc.service = EDGE_MDNS_SERVICE;
+        svc.host = std::string(host) + ".local";
+        svc.port = port;
+        svc.txt.push_back(std::string("upstream=") + cfg.upstream.host +
+                          (cfg.upstream.port == (cfg.upstream.tls ? 443 : 80) ? "" : ":" + std::to_string(cfg.upstream.port)));
+        svc.txt.push_back("v=1");
+        mfd = svc.addr ? mdnsSocket(svc.addr) : -1;
+        if (mfd < 0) fprintf(stderr, "mDNS: can't advertise (no LAN address or port %d taken); displays won't find this relay\n", MDNS_PORT);
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    EdgeRelay relay;
+    relay.start(cfg, lfd);
+    char ip[INET_ADDRSTRLEN] = "-";
+    inet_ntop(AF_INET, &svc.addr, ip, sizeof(ip));
+    fprintf(stderr, "relaying %s on %s%s%s\n", url, listen, mfd >= 0 ? ", advertised as http://" : "",
+            mfd >= 0 ? (std::string(ip) + ":" + std::to_string(port)).c_str() : "");
+    run(mfd, svc, relay);
+    relay.stop();
+    if (mfd >= 0) ::close(mfd);
+    ::close(lfd);
+    return 0;
+}
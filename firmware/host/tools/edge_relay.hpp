@@ -0,0 +1,785 @@
+/**
+ * LAN edge relay: one upstream poll for every display on a site
+ *
+ * Sits on a box on the LAN between the displays and the server. It
+ * follows the server on its own - the push stream while it is up, the
+ * zone list every EDGE_POLL_MS while it is not - and keeps a version per
+ * zone (or page) id. The displays speak the zone protocol to it over
+ * plain HTTP exactly as they would to the server:
+ *
+ *   GET  /api/zones?plain=1[&force=true]  answered locally: the ids that
+ *        changed since this display (by address) last asked, or all of them
+ *   GET  /api/zones/stream               a local push stream; every
+ *        upstream change goes out to each display at once, and Last-Event-ID
+ *        catches a reconnecting one up from the versions
+ *   GET  /api/zone/<id>, /api/page/<id>, POST /api/zone/<id>/tiles
+ *        fetched upstream once and cached until <id> changes; tile requests
+ *        are keyed by their hash body, so displays showing the same thing
+ *        share one answer
+ *   ?at= prefetches, timetable, sprites
+ *        cached for EDGE_AT_TTL_MS / EDGE_STATIC_TTL_MS
+ *   firmware patches are not relayed from the cache; the firmware fetches
+ *        them from the server over TLS itself
+ *
+ * Concurrent requests for the same thing wait on one upstream fetch
+ * (single flight), so a room of displays waking on the same minute costs
+ * the server one request per distinct answer. The cache holds whole
+ * bodies - conditional and Range headers are not forwarded - and answers
+ * If-None-Match (304) and Range/If-Range (206) itself, so NetResume and
+ * the page cache work against it unchanged. Anything else (other paths,
+ * other methods) is passed straight through.
+ *
+ *   EdgeConfig cfg;
+ *   parseServerUrl("https://ptvtrmnl.vercel.app", cfg.upstream);
+ *   EdgeRelay relay;
+ *   relay.start(cfg, listenFd);   // accept loop and upstream follower threads
+ *   ...
+ *   relay.stop();
+ *
+ * Linux only. See tools/edge-relay.cpp for the daemon (command line,
+ * mDNS advertisement) and README "LAN Edge Relay".
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef EDGE_RELAY_HPP
+#define EDGE_RELAY_HPP
+
+#include "posix_client.hpp"
+#include "standin_server.hpp"
+#include "http_fetch.hpp"      // HttpBodyReader
+#include "zone_push.hpp"
+#ifdef KINDLE_TLS
+#include "tls_client.hpp"
+#endif
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef EDGE_POLL_MS
+#define EDGE_POLL_MS 20000          // upstream zone list while its push stream is down (the display's interval)
+#endif
+#ifndef EDGE_RETRY_MS
+#define EDGE_RETRY_MS 5000          // the first (forced) upstream list is retried this often until it is in
+#endif
+#ifndef EDGE_HEARTBEAT_MS
+#define EDGE_HEARTBEAT_MS 15000     // ": hb" on the local push streams, as the server sends
+#endif
+#ifndef EDGE_KEEPALIVE_MS
+#define EDGE_KEEPALIVE_MS 5000      // an idle display connection is closed after this
+#endif
+#ifndef EDGE_HEAD_TIMEOUT_MS
+#define EDGE_HEAD_TIMEOUT_MS 10000
+#endif
+#ifndef EDGE_UPSTREAM_TIMEOUT_MS
+#define EDGE_UPSTREAM_TIMEOUT_MS 30000
+#endif
+#ifndef EDGE_AT_TTL_MS
+#define EDGE_AT_TTL_MS 120000       // a prefetch answer is for one minute boundary
+#endif
+#ifndef EDGE_STATIC_TTL_MS
+#define EDGE_STATIC_TTL_MS 600000   // timetable and sprites change daily at most
+#endif
+#ifndef EDGE_CACHE_BYTES
+#define EDGE_CACHE_BYTES (32u << 20)
+#endif
+
+#define EDGE_USER_AGENT "ptv-trmnl-edge/1"
+
+struct EdgeHeader {
+    std::string name, value;
+};
+
+static inline const char* edgeHeader(const std::vector<EdgeHeader>& headers, const char* name) {
+    for (const EdgeHeader& h : headers) if (strcasecmp(h.name.c_str(), name) == 0) return h.value.c_str();
+    return nullptr;
+}
+
+struct EdgeRequest {
+    std::string method, target;
+    std::vector<EdgeHeader> headers;
+    std::string body;
+    bool keepAlive = false;
+
+    const char* header(const char* name) const { return edgeHeader(headers, name); }
+};
+
+struct EdgeResponse {
+    int status = 0;                      // 0 = the upstream didn't answer
+    std::vector<EdgeHeader> headers;     // end to end only; Content-Length is added when sent
+    std::string body;
+
+    const char* header(const char* name) const { return edgeHeader(headers, name); }
+};
+
+// What a request is, by path
+enum EdgeKind : uint8_t { EDGE_LIST, EDGE_STREAM, EDGE_ZONE, EDGE_STATIC, EDGE_PASS };
+
+/**
+ * Classify a request. tag is the zone or page id its answer follows; at is
+ * set for prefetches (?at=), whose answers are for one boundary.
+ */
+static inline EdgeKind edgeClassify(const std::string& method, const std::string& target, std::string& tag, bool& at) {
+    size_t q = target.find('?');
+    std::string path = target.substr(0, q);
+    std::string query = q == std::string::npos ? "" : target.substr(q + 1);
+    at = ("&" + query).find("&at=") != std::string::npos;
+    tag.clear();
+    if (path == "/api/zones" && method == "GET") return EDGE_LIST;
+    if (path == "/api/zones/stream" && method == "GET") return EDGE_STREAM;
+    const char* p = path.c_str();
+    const char* id = !strncmp(p, "/api/zone/", 10) ? p + 10 : !strncmp(p, "/api/page/", 10) ? p + 10 : nullptr;
+    if (id && *id) {
+        const char* slash = strchr(id, '/');
+        bool tiles = slash && !strcmp(slash, "/tiles");
+        if (tiles ? method == "POST" : !slash && (method == "GET" || method == "HEAD")) {
+            tag.assign(id, slash ? (size_t)(slash - id) : strlen(id));
+            return EDGE_ZONE;
+        }
+        return EDGE_PASS;
+    }
+    if ((method == "GET" || method == "HEAD") &&
+        (path == "/api/timetable.bin" || path == "/api/sprites.bin"))
+        return EDGE_STATIC;
+    return EDGE_PASS;
+}
+
+/** Split a zone list ("time,trains\n") into ids. */
+static inline std::vector<std::string> edgeSplitList(const std::string& csv) {
+    std::vector<std::string> ids;
+    size_t at = 0;
+    while (at <= csv.size()) {
+        size_t comma = csv.find(',', at);
+        if (comma == std::string::npos) comma = csv.size();
+        size_t a = csv.find_first_not_of(" \t\r\n", at), b = csv.find_last_not_of(" \t\r\n", comma - 1);
+        if (a != std::string::npos && a < comma && b != std::string::npos && b >= a) ids.push_back(csv.substr(a, b - a + 1));
+        at = comma + 1;
+    }
+    return ids;
+}
+
+struct EdgeStats {
+    uint64_t lanRequests = 0;     // answered to displays, streams not counted
+    uint64_t hits = 0;            // from the cache
+    uint64_t coalesced = 0;       // waited on another display's upstream fetch
+    uint64_t upstreamRequests = 0;
+    uint64_t upstreamBytes = 0;
+    uint64_t lists = 0;           // zone lists answered locally
+    uint64_t events = 0;          // upstream changes
+    uint32_t streams = 0;         // local push streams open
+    uint32_t displays = 0;        // addresses that have asked for a zone list
+    uint32_t version = 0;
+    size_t cacheBytes = 0;
+};
+
+/**
+ * Versions and cached answers; every method is thread-safe. Nothing here
+ * touches a socket, so the tests drive it directly.
+ */
+class EdgeCache {
+public:
+    typedef std::shared_ptr<const EdgeResponse> Answer;
+
+    explicit EdgeCache(size_t capacity = EDGE_CACHE_BYTES) : _capacity(capacity) {}
+
+    /**
+     * Upstream says these ids changed: one new version for all of them, and
+     * their cached answers are dropped. Returns the version.
+     */
+    uint32_t changed(const std::vector<std::string>& ids) {
+        std::lock_guard<std::mutex> lk(_m);
+        if (ids.empty()) return _version;
+        _version++;
+        _events++;
+        for (const std::string& id : ids) {
+            _zoneVersion[id] = _version;
+            for (auto it = _entries.begin(); it != _entries.end();) {
+                if (it->second.tag == id) { _bytes -= it->second.bytes; it = _entries.erase(it); }
+                else ++it;
+            }
+        }
+        return _version;
+    }
+
+    /** ids that changed after version since, comma separated */
+    std::string changedSince(uint32_t since) const {
+        std::lock_guard<std::mutex> lk(_m);
+        return listLocked(since);
+    }
+
+    /** The zone list for one display: all ids when forced, else those changed since it last asked. */
+    std::string listFor(const std::string& display, bool force) {
+        std::lock_guard<std::mutex> lk(_m);
+        auto seen = _seen.find(display);
+        uint32_t since = force || seen == _seen.end() ? 0 : seen->second;
+        _seen[display] = _version;
+        _lists++;
+        return listLocked(since);
+    }
+
+    /**
+     * The cached answer for key, or fetch() once for everyone asking for key
+     * at the same time. ttlMs 0 keeps it until tag changes. Only answers
+     * worth keeping (200, 204, 404) are kept, and not one fetched across a
+     * change of its tag.
+     */
+    Answer get(const std::string& key, const std::string& tag, uint64_t ttlMs, uint64_t nowMs,
+               const std::function<EdgeResponse()>& fetch) {
+        std::unique_lock<std::mutex> lk(_m);
+        auto it = _entries.find(key);
+        if (it != _entries.end() && (!it->second.expires || nowMs < it->second.expires)) {
+            it->second.used = ++_clock;
+            _hits++;
+            return it->second.answer;
+        }
+        auto f = _flights.find(key);
+        if (f != _flights.end()) {
+            std::shared_ptr<Flight> flight = f->second;
+            _coalesced++;
+            _cv.wait(lk, [&] { return flight->done; });
+            return flight->answer;
+        }
+        std::shared_ptr<Flight> flight = std::make_shared<Flight>();
+        _flights[key] = flight;
+        uint32_t tagVersion = versionOf(tag);
+        lk.unlock();
+
+        Answer answer = std::make_shared<const EdgeResponse>(fetch());
+
+        lk.lock();
+        flight->answer = answer;
+        flight->done = true;
+        _flights.erase(key);
+        _upstream++;
+        int s = answer->status;
+        if ((s == 200 || s == 204 || s == 404) && versionOf(tag) == tagVersion) {
+            Entry& e = _entries[key];
+            _bytes -= e.bytes;
+            e.answer = answer;
+            e.tag = tag;
+            e.expires = ttlMs ? nowMs + ttlMs : 0;
+            e.used = ++_clock;
+            e.bytes = key.size() + answer->body.size() + 256;
+            _bytes += e.bytes;
+            evictLocked();
+        }
+        _cv.notify_all();
+        return answer;
+    }
+
+    uint32_t version() const { std::lock_guard<std::mutex> lk(_m); return _version; }
+
+    /** Counters for the stats line; the relay adds its own. */
+    void fill(EdgeStats& s) const {
+        std::lock_guard<std::mutex> lk(_m);
+        s.hits = _hits;
+        s.coalesced = _coalesced;
+        s.upstreamRequests += _upstream;
+        s.lists = _lists;
+        s.events = _events;
+        s.displays = (uint32_t)_seen.size();
+        s.version = _version;
+        s.cacheBytes = _bytes;
+    }
+
+private:
+    struct Entry {
+        Answer answer;
+        std::string tag;
+        uint64_t expires = 0;
+        uint64_t used = 0;
+        size_t bytes = 0;
+    };
+    struct Flight {
+        bool done = false;
+        Answer answer;
+    };
+
+    uint32_t versionOf(const std::string& tag) const {
+        auto v = _zoneVersion.find(tag);
+        return v == _zoneVersion.end() ? 0 : v->second;
+    }
+
+    std::string listLocked(uint32_t since) const {
+        std::string out;
+        for (const auto& z : _zoneVersion) {
+            if (z.second <= since) continue;
+            if (!out.empty()) out += ',';
+            out += z.first;
+        }
+        return out;
+    }
+
+    // Least recently used first
+    void evictLocked() {
+        while (_bytes > _capacity && !_entries.empty()) {
+            auto oldest = _entries.begin();
+            for (auto it = _entries.begin(); it != _entries.end(); ++it)
+                if (it->second.used < oldest->second.used) oldest = it;
+            _bytes -= oldest->second.bytes;
+            _entries.erase(oldest);
+        }
+    }
+
+    mutable std::mutex _m;
+    std::condition_variable _cv;
+    std::map<std::string, Entry> _entries;
+    std::map<std::string, std::shared_ptr<Flight>> _flights;
+    std::map<std::string, uint32_t> _zoneVersion;
+    std::map<std::string, uint32_t> _seen;
+    size_t _capacity;
+    size_t _bytes = 0;
+    uint64_t _clock = 0;
+    uint32_t _version = 0;
+    uint64_t _hits = 0, _coalesced = 0, _upstream = 0, _lists = 0, _events = 0;
+};
+
+/**
+ * Answer a display from a whole cached body: 304 for a matching
+ * If-None-Match, 206 for a Range the cached body covers (and whose If-Range,
+ * if any, is its ETag), otherwise the answer as is.
+ */
+static inline EdgeResponse edgeLocalise(const EdgeRequest& req, const EdgeResponse& full) {
+    const char* etag = full.header("ETag");
+    if (full.status != 200 || !etag) return full;
+    const char* inm = req.header("If-None-Match");
+    if (inm && strcmp(inm, etag) == 0) {
+        EdgeResponse r;
+        r.status = 304;
+        r.headers.push_back({"ETag", etag});
+        return r;
+    }
+    const char* range = req.header("Range");
+    const char* ifRange = req.header("If-Range");
+    unsigned long from;
+    if (!range || sscanf(range, "bytes=%lu-", &from) != 1 || from >= full.body.size() || (ifRange && strcmp(ifRange, etag) != 0))
+        return full;
+    EdgeResponse r;
+    r.status = 206;
+    r.headers = full.headers;
+    char cr[64];
+    snprintf(cr, sizeof(cr), "bytes %lu-%lu/%lu", from, (unsigned long)full.body.size() - 1, (unsigned long)full.body.size());
+    r.headers.push_back({"Content-Range", cr});
+    r.body = full.body.substr(from);
+    return r;
+}
+
+static inline const char* edgeReason(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 502: return "Bad Gateway";
+    default: return "Status";
+    }
+}
+
+static inline uint64_t edgeNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct EdgeConfig {
+    ServerEndpoint upstream;
+    bool insecure = false;         // don't verify the upstream certificate
+    bool push = true;              // follow the upstream push stream (polling stays as the fallback)
+    uint32_t pollMs = EDGE_POLL_MS;
+    size_t cacheBytes = EDGE_CACHE_BYTES;
+    bool verbose = false;          // a line per display request on stderr
+};
+
+class EdgeRelay {
+public:
+    ~EdgeRelay() { stop(); }
+
+    /** Serve displays on listenFd (a listening socket) and follow the upstream, each on its own thread. */
+    bool start(const EdgeConfig& cfg, int listenFd) {
+        if (_running) return false;
+        _cfg = cfg;
+        _cache.reset(new EdgeCache(cfg.cacheBytes));
+        _listenFd = listenFd;
+        _stopping = false;
+        _running = true;
+        _acceptThread = std::thread(&EdgeRelay::acceptLoop, this);
+        _followThread = std::thread(&EdgeRelay::follow, this);
+        return true;
+    }
+
+    /** Stop both threads and close every display connection. */
+    void stop() {
+        if (!_running) return;
+        _stopping = true;
+        _acceptThread.join();
+        _followThread.join();
+        std::unique_lock<std::mutex> lk(_connM);
+        for (int fd : _conns) ::shutdown(fd, SHUT_RDWR);
+        _connCv.wait(lk, [&] { return _conns.empty(); });
+        _running = false;
+    }
+
+    EdgeStats stats() const {
+        EdgeStats s;
+        s.lanRequests = _lanRequests;
+        s.upstreamRequests = _directRequests;
+        s.upstreamBytes = _upstreamBytes;
+        if (_cache) _cache->fill(s);
+        std::lock_guard<std::mutex> lk(_streamM);
+        s.streams = (uint32_t)_streams.size();
+        return s;
+    }
+
+    /** True once the first upstream zone list is in, so every id has a version. */
+    bool ready() const { return _ready; }
+
+    /** One request upstream on a new connection, body collected. status 0 if it didn't answer. */
+    EdgeResponse fetchUpstream(const EdgeRequest& req) {
+        EdgeResponse res;
+        std::unique_ptr<Client> client(newClient());
+        const ServerEndpoint& ep = _cfg.upstream;
+        std::string out = req.method + " " + ep.prefix + req.target + " HTTP/1.1\r\nHost: " + ep.host + "\r\n";
+        bool agent = false;
+        for (const EdgeHeader& h : req.headers) {
+            // Whole bodies only: the cache answers conditionals and ranges itself
+            static const char* const DROP[] = {"Host", "Connection", "Keep-Alive", "Content-Length", "Transfer-Encoding",
+                                               "If-None-Match", "If-Modified-Since", "Range", "If-Range"};
+            bool drop = false;
+            for (const char* d : DROP) drop |= strcasecmp(h.name.c_str(), d) == 0;
+            if (drop) continue;
+            agent |= strcasecmp(h.name.c_str(), "User-Agent") == 0;
+            out += h.name + ": " + h.value + "\r\n";
+        }
+        if (!agent) out += "User-Agent: " EDGE_USER_AGENT "\r\n";
+        if (!req.body.empty() || req.method == "POST") out += "Content-Length: " + std::to_string(req.body.size()) + "\r\n";
+        out += "Connection: close\r\n\r\n" + req.body;
+        if (!client->connect(ep.host, ep.port) || client->write((const uint8_t*)out.data(), out.size()) != out.size()) {
+            client->stop();
+            return res;
+        }
+
+        std::string head;
+        uint8_t buf[4096];
+        unsigned long last = millis();
+        size_t end;
+        while ((end = head.find("\r\n\r\n")) == std::string::npos) {
+            int avail = client->available();
+            if (avail <= 0) {
+                if (!client->connected() || millis() - last > EDGE_UPSTREAM_TIMEOUT_MS) break;
+                delay(1);
+                continue;
+            }
+            int r = client->read(buf, std::min(avail, (int)sizeof(buf)));
+            if (r <= 0) break;
+            head.append((const char*)buf, r);
+            last = millis();
+        }
+        int status = 0;
+        if (end == std::string::npos || sscanf(head.c_str(), "HTTP/%*d.%*d %d", &status) != 1) { client->stop(); return res; }
+        std::string rest = head.substr(end + 4);
+        head.resize(end + 2);
+        long contentLength = -1;
+        bool chunked = false;
+        for (size_t p = head.find("\r\n"); p != std::string::npos;) {
+            size_t e = head.find("\r\n", p + 2);
+            if (e == std::string::npos) break;
+            std::string line = head.substr(p + 2, e - p - 2);
+            p = e;
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            size_t v = line.find_first_not_of(' ', colon + 1);
+            EdgeHeader h = {line.substr(0, colon), v == std::string::npos ? "" : line.substr(v)};
+            if (strcasecmp(h.name.c_str(), "Content-Length") == 0) contentLength = atol(h.value.c_str());
+            else if (strcasecmp(h.name.c_str(), "Transfer-Encoding") == 0) chunked = strstr(h.value.c_str(), "chunked") != nullptr;
+            else if (strcasecmp(h.name.c_str(), "Connection") != 0 && strcasecmp(h.name.c_str(), "Keep-Alive") != 0) res.headers.push_back(h);
+        }
+        if (req.method == "HEAD" || status == 304 || status == 204) contentLength = 0;
+
+        HttpBodyReader reader;
+        reader.begin(contentLength, chunked);
+        size_t delivered = 0;
+        bool ok = reader.feed((const uint8_t*)rest.data(), rest.size(), collect, &res.body, delivered);
+        last = millis();
+        while (ok && !reader.done()) {
+            int avail = client->available();
+            if (avail <= 0) {
+                if (!client->connected() || millis() - last > EDGE_UPSTREAM_TIMEOUT_MS) break;
+                delay(1);
+                continue;
+            }
+            int r = client->read(buf, std::min(avail, (int)sizeof(buf)));
+            if (r <= 0) break;
+            last = millis();
+            ok = reader.feed(buf, r, collect, &res.body, delivered);
+        }
+        _upstreamBytes += head.size() + rest.size() + delivered;
+        client->stop();
+        // A body cut short is not an answer to keep or pass on
+        if (ok && (reader.done() || reader.closeDelimited())) res.status = status;
+        else res.body.clear();
+        return res;
+    }
+
+    /** The answer for one display request (anything but the push stream). */
+    EdgeResponse answer(const EdgeRequest& req, const std::string& display) {
+        _lanRequests++;
+        std::string tag;
+        bool at;
+        EdgeKind kind = edgeClassify(req.method, req.target, tag, at);
+        if (kind == EDGE_LIST && !at && _ready) {
+            EdgeResponse r;
+            r.status = 200;
+            r.headers.push_back({"Content-Type", "text/plain"});
+            r.headers.push_back({"Cache-Control", "no-store"});
+            r.body = _cache->listFor(display, req.target.find("force=true") != std::string::npos);
+            return r;
+        }
+        if (kind == EDGE_PASS || kind == EDGE_STREAM || (kind == EDGE_LIST && !at)) {
+            // Before the first upstream list there are no versions to answer from
+            EdgeResponse r = fetchUpstream(req);
+            _directRequests++;
+            if (!r.status) r.status = 502;
+            return r;
+        }
+        // Whatever the answer depends on besides the target goes in the key
+        std::string key = req.method + " " + req.target;
+        static const char* const VARY[] = {"Accept", "X-Layout", "X-Sprites"};
+        for (const char* v : VARY) { const char* h = req.header(v); key += '\n'; if (h) key += h; }
+        key += '\n';
+        key += req.body;
+        uint64_t ttl = at ? EDGE_AT_TTL_MS : kind == EDGE_STATIC ? EDGE_STATIC_TTL_MS : 0;
+        EdgeCache::Answer full = _cache->get(key, kind == EDGE_ZONE ? tag : std::string(), ttl, edgeNowMs(),
+                                             [&] { return fetchUpstream(req); });
+        if (!full->status) {
+            EdgeResponse r;
+            r.status = 502;
+            return r;
+        }
+        return edgeLocalise(req, *full);
+    }
+
+    /** Serve one display connection (accepted by the relay) until it closes, idles out or the relay stops. */
+    void serve(int fd) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::string display = peerAddress(fd);
+        EdgeRequest req;
+        for (int timeout = EDGE_HEAD_TIMEOUT_MS; !_stopping && readRequest(fd, req, timeout); timeout = EDGE_KEEPALIVE_MS) {
+            std::string tag;
+            bool at;
+            if (edgeClassify(req.method, req.target, tag, at) == EDGE_STREAM) { stream(fd, req); break; }
+            uint64_t t0 = edgeNowMs();
+            EdgeResponse r = answer(req, display);
+            std::string out = "HTTP/1.1 " + std::to_string(r.status) + " " + edgeReason(r.status) + "\r\n";
+            for (const EdgeHeader& h : r.headers) out += h.name + ": " + h.value + "\r\n";
+            out += "Content-Length: " + std::to_string(r.body.size()) + "\r\n";
+            out += req.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+            if (req.method != "HEAD") out += r.body;
+            bool sent = StandinServer::send(fd, out);
+            if (_cfg.verbose)
+                fprintf(stderr, "%s %s %s -> %d, %zu bytes, %llums\n", display.c_str(), req.method.c_str(), req.target.c_str(),
+                        r.status, r.body.size(), (unsigned long long)(edgeNowMs() - t0));
+            if (!sent || !req.keepAlive) break;
+        }
+        std::lock_guard<std::mutex> lk(_connM);
+        ::close(fd);
+        _conns.erase(fd);
+        _connCv.notify_all();
+    }
+
+private:
+    static bool collect(const uint8_t* data, size_t len, void* ctx) {
+        ((std::string*)ctx)->append((const char*)data, len);
+        return true;
+    }
+
+    Client* newClient() {
+#ifdef KINDLE_TLS
+        if (_cfg.upstream.tls) {
+            TlsClient* tls = new TlsClient();
+            if (_cfg.insecure) tls->setInsecure();
+            return tls;
+        }
+#endif
+        return new PosixClient();
+    }
+
+    static std::string peerAddress(int fd) {
+        struct sockaddr_in sa = {};
+        socklen_t len = sizeof(sa);
+        char ip[INET_ADDRSTRLEN] = "?";
+        if (getpeername(fd, (struct sockaddr*)&sa, &len) == 0) inet_ntop(AF_INET, &sa.sin_addr, ip, sizeof(ip));
+        return ip;
+    }
+
+    static bool readRequest(int fd, EdgeRequest& req, int timeoutMs) {
+        req = EdgeRequest();
+        struct pollfd p = { fd, POLLIN, 0 };
+        if (::poll(&p, 1, timeoutMs) <= 0) return false;
+        std::string head = StandinServer::readHead(fd, EDGE_HEAD_TIMEOUT_MS);
+        char method[16], target[2048];
+        int minor = 0;
+        if (head.empty() || sscanf(head.c_str(), "%15s %2047s HTTP/1.%d", method, target, &minor) != 3) return false;
+        req.method = method;
+        req.target = target;
+        for (size_t at = head.find("\r\n"); at != std::string::npos;) {
+            size_t e = head.find("\r\n", at + 2);
+            if (e == std::string::npos || e == at + 2) break;
+            std::string line = head.substr(at + 2, e - at - 2);
+            at = e;
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            size_t v = line.find_first_not_of(' ', colon + 1);
+            req.headers.push_back({line.substr(0, colon), v == std::string::npos ? "" : line.substr(v)});
+        }
+        const char* conn = req.header("Connection");
+        req.keepAlive = conn ? strcasestr(conn, "keep-alive") != nullptr : minor >= 1;
+        if (conn && strcasestr(conn, "close")) req.keepAlive = false;
+        long len = req.header("Content-Length") ? atol(req.header("Content-Length")) : 0;
+        char buf[4096];
+        while ((long)req.body.size() < len) {
+            if (::poll(&p, 1, EDGE_HEAD_TIMEOUT_MS) <= 0) return false;
+            ssize_t n = ::recv(fd, buf, std::min((long)sizeof(buf), len - (long)req.body.size()), 0);
+            if (n <= 0) return false;
+            req.body.append(buf, n);
+        }
+        return true;
+    }
+
+    // A local push stream: held open here, written by the follower thread
+    void stream(int fd, const EdgeRequest& req) {
+        std::string head = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n";
+        const char* last = req.header("Last-Event-ID");
+        {
+            std::lock_guard<std::mutex> lk(_streamM);
+            uint32_t version = _cache->version();
+            // Reconnecting: whatever changed while it was away, as one event
+            if (last && strtoul(last, nullptr, 10) < version) head += event(version, _cache->changedSince(strtoul(last, nullptr, 10)));
+            if (!StandinServer::send(fd, head)) return;
+            _streams.insert(fd);
+        }
+        if (_cfg.verbose) fprintf(stderr, "%s stream open\n", peerAddress(fd).c_str());
+        char c;
+        while (!_stopping) {
+            struct pollfd p = { fd, POLLIN, 0 };
+            int n = ::poll(&p, 1, 200);
+            if (n < 0 && errno != EINTR) break;
+            if (n > 0 && ::recv(fd, &c, 1, MSG_DONTWAIT) <= 0) break;
+            std::lock_guard<std::mutex> lk(_streamM);
+            if (!_streams.count(fd)) break;     // dropped by broadcast()
+        }
+        std::lock_guard<std::mutex> lk(_streamM);
+        _streams.erase(fd);
+    }
+
+    static std::string event(uint32_t version, const std::string& ids) {
+        return "id: " + std::to_string(version) + "\nevent: zones\ndata: " + ids + "\n\n";
+    }
+
+    // To every local stream; one that can't take it right away is dropped (it reconnects with Last-Event-ID)
+    void broadcast(const std::string& text) {
+        std::lock_guard<std::mutex> lk(_streamM);
+        for (auto it = _streams.begin(); it != _streams.end();) {
+            ssize_t n = ::send(*it, text.data(), text.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n == (ssize_t)text.size()) ++it;
+            else it = _streams.erase(it);
+        }
+    }
+
+    void changed(const std::string& csv) {
+        std::vector<std::string> ids = edgeSplitList(csv);
+        if (ids.empty()) return;
+        uint32_t v = _cache->changed(ids);
+        broadcast(event(v, _cache->changedSince(v - 1)));
+        if (_cfg.verbose) fprintf(stderr, "upstream v%u: %s\n", v, csv.c_str());
+    }
+
+    static void onPush(const ZonePushEvent& ev, void* ctx) {
+        ((EdgeRelay*)ctx)->changed(std::string(ev.zones, ev.zonesLen));
+    }
+
+    bool pollList(bool force) {
+        EdgeRequest req;
+        req.method = "GET";
+        req.target = force ? "/api/zones?plain=1&force=true" : "/api/zones?plain=1";
+        EdgeResponse r = fetchUpstream(req);
+        _directRequests++;
+        if (r.status != 200) { fprintf(stderr, "upstream zone list: %s %d\n", r.status ? "HTTP" : "no answer", r.status); return false; }
+        changed(r.body);
+        if (force) _ready = true;
+        return true;
+    }
+
+    // The upstream follower: push stream when it is up, the zone list on the interval, heartbeats to displays
+    void follow() {
+        PosixClient plainPush;
+#ifdef KINDLE_TLS
+        TlsClient tlsPush;
+        if (_cfg.insecure) tlsPush.setInsecure();
+        Client& pushClient = _cfg.upstream.tls ? (Client&)tlsPush : (Client&)plainPush;
+#else
+        Client& pushClient = plainPush;
+#endif
+        ZonePushClient<Client> push;
+        if (_cfg.push) push.begin(pushClient, _cfg.upstream, EDGE_USER_AGENT);
+        pollList(true);
+        uint64_t lastPoll = edgeNowMs(), lastBeat = lastPoll;
+        while (!_stopping) {
+            if (_cfg.push) push.poll(onPush, this);
+            uint64_t now = edgeNowMs();
+            // With the stream live, polling is only a slow safety net
+            uint64_t pollMs = (push.streaming() ? 10ULL : 1ULL) * _cfg.pollMs;
+            if (now - lastPoll >= (_ready ? pollMs : EDGE_RETRY_MS)) {
+                lastPoll = now;
+                pollList(!_ready);
+            }
+            if (now - lastBeat >= EDGE_HEARTBEAT_MS) {
+                lastBeat = now;
+                broadcast(": hb\n\n");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(push.streaming() && pushClient.available() > 0 ? 0 : 20));
+        }
+        push.stop();
+    }
+
+    void acceptLoop() {
+        while (!_stopping) {
+            struct pollfd p = { _listenFd, POLLIN, 0 };
+            if (::poll(&p, 1, 100) <= 0) continue;
+            int fd = ::accept(_listenFd, nullptr, nullptr);
+            if (fd < 0) continue;
+            {
+                std::lock_guard<std::mutex> lk(_connM);
+                _conns.insert(fd);
+            }
+            std::thread(&EdgeRelay::serve, this, fd).detach();
+        }
+    }
+
+    EdgeConfig _cfg;
+    std::unique_ptr<EdgeCache> _cache;
+    int _listenFd = -1;
+    std::atomic<bool> _stopping{false}, _ready{false};
+    bool _running = false;
+    std::thread _acceptThread, _followThread;
+    std::mutex _connM;
+    std::condition_variable _connCv;
+    std::set<int> _conns;
+    mutable std::mutex _streamM;
+    std::set<int> _streams;
+    std::atomic<uint64_t> _lanRequests{0}, _directRequests{0}, _upstreamBytes{0};
+};
+
+#endif // EDGE_RELAY_HPP
@@ -0,0 +1,103 @@
+/**
+ * Load a zone server with a simulated fleet of devices
+ *
+ * Usage: ./fleet-sim [--devices N] [--duration S] [--mode tiles|bmp|push|zonedata]
+ *                    [--tier normal|saver|low|critical] [--cadence MS] [--jitter MS]
+ *                    [--spread MS] [--no-prefetch] [--list PATH] [--seed N] http://127.0.0.1:3000
+ *
+ * Runs N devices (see fleet_sim.hpp) against the server for S seconds and
+ * reports requests per second, p50/p99/p999 latency per endpoint and the
+ * bytes each device moves per hour. --tier picks that battery tier's poll
+ * and full-refresh intervals; --cadence overrides the poll. --spread 0
+ * boots the whole fleet at once, as after a power cut. --list /api/zones/changed
+ * takes the changed ids from that route's JSON instead of /api/zones?plain=1.
+ *
+ * Plain http:// only: aim it at a local instance (npm start). Every
+ * request is a new connection, as on the device, so past a few hundred
+ * requests a second this host's ephemeral ports run out before the
+ * server does: widen net.ipv4.ip_local_port_range or set
+ * net.ipv4.tcp_tw_reuse=1.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "fleet_sim.hpp"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+static FleetSim sim;
+
+static void onSignal(int) { sim.stop(); }
+
+static int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--devices N] [--duration S] [--mode tiles|bmp|push|zonedata]\n"
+            "          [--tier normal|saver|low|critical] [--cadence MS] [--jitter MS]\n"
+            "          [--spread MS] [--no-prefetch] [--list PATH] [--seed N] SERVER_URL\n",
+            argv0);
+    return 2;
+}
+
+static int pick(const char* name, const char* const* names, int count) {
+    for (int i = 0; i < count; i++) if (strcmp(name, names[i]) == 0) return i;
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    FleetConfig cfg;
+    const char* url = nullptr;
+    long cadence = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--devices" && more) cfg.devices = atoi(argv[++i]);
+        else if (a == "--duration" && more) cfg.durationMs = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (a == "--cadence" && more) cadence = atol(argv[++i]);
+        else if (a == "--jitter" && more) cfg.jitterMs = (uint32_t)atol(argv[++i]);
+        else if (a == "--spread" && more) cfg.spreadMs = (uint32_t)atol(argv[++i]);
+        else if (a == "--list" && more) cfg.listPath = argv[++i];
+        else if (a == "--seed" && more) cfg.seed = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--no-prefetch") cfg.prefetch = false;
+        else if (a == "--mode" && more) {
+            int m = pick(argv[++i], FLEET_MODE_NAMES, 4);
+            if (m < 0) return usage(argv[0]);
+            cfg.mode = (FleetMode)m;
+        } else if (a == "--tier" && more) {
+            static const char* const tiers[] = {"normal", "saver", "low", "critical"};
+            int t = pick(argv[++i], tiers, 4);
+            if (t < 0) return usage(argv[0]);
+            cfg.pollMs = energyCadence((EnergyTier)t).pollMs;
+            cfg.fullMs = energyCadence((EnergyTier)t).fullMs;
+        } else if (a[0] != '-' && !url) url = argv[i];
+        else return usage(argv[0]);
+    }
+    if (!url || cfg.devices <= 0 || cadence == 0) return usage(argv[0]);
+    if (cadence > 0) cfg.pollMs = (uint32_t)cadence;
+    if (!parseServerUrl(url, cfg.server) || cfg.server.tls) {
+        fprintf(stderr, "%s: need an http:// server URL\n", url);
+        return 1;
+    }
+
+    // A socket per device, two in push mode
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && (rlim_t)cfg.devices * 2 + 16 > rl.rlim_cur)
+        fprintf(stderr, "warning: %lu open files allowed, %d devices may need %d\n", (unsigned long)rl.rlim_cur, cfg.devices,
+                cfg.devices * 2 + 16);
+
+    if (!sim.begin(cfg)) {
+        fprintf(stderr, "%s: can't resolve %s\n", url, cfg.server.host);
+        return 1;
+    }
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    sim.run();
+    sim.report(stdout);
+    return 0;
+}
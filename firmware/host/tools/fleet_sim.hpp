@@ -0,0 +1,682 @@
+/**
+ * Fleet simulator: many zone-protocol devices against one server
+ *
+ * Each simulated device runs the firmware's request cycle on its own
+ * timers: the interval poll of the zone list, a tile (or BMP) fetch for
+ * each zone it names, a full refresh every few minutes, the prefetch
+ * PREFETCH_LEAD_S ahead of each minute boundary and, in push mode, the
+ * /api/zones/stream connection. Requests are plain HTTP, one connection
+ * each, as HTTPClient makes them. One thread drives every device from
+ * epoll, so a few thousand devices cost a few thousand sockets, not
+ * threads.
+ *
+ * The protocol code is the firmware's own: parseZoneList(), ZonePushParser,
+ * HttpBodyReader and the TileStreamDecoder that patches each device's
+ * framebuffer, so the hashes a device posts next are the ones a real one
+ * would post. energyCadence() gives each battery tier's poll and
+ * full-refresh intervals.
+ *
+ *   FleetConfig cfg;
+ *   parseServerUrl("http://127.0.0.1:3000", cfg.server);
+ *   cfg.devices = 1000;
+ *   FleetSim sim;
+ *   if (sim.begin(cfg)) { sim.run(); sim.report(stdout); }
+ *
+ * Tile and push modes keep a 48 KB framebuffer per device. Linux only
+ * (epoll); see tools/fleet-sim.cpp for the command line.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef FLEET_SIM_HPP
+#define FLEET_SIM_HPP
+
+#include "zone_layout.hpp"
+#include "zone_tiles.hpp"
+#include "zone_push.hpp"
+#include "energy_model.hpp"
+#include "http_fetch.hpp"      // HttpBodyReader
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+// As PREFETCH_LEAD_S / PREFETCH_MIN_LEAD_S in src/zones-v12.cpp
+#define FLEET_PREFETCH_LEAD_S 15
+#define FLEET_PREFETCH_MIN_LEAD_S 3
+// A failed list before the first draw is retried this soon (the firmware's delay(5000))
+#define FLEET_RETRY_MS 5000
+// List bodies are kept up to this much for parsing; the rest is only counted
+#define FLEET_LIST_MAX 2048
+
+enum FleetMode : uint8_t { FLEET_TILES, FLEET_BMP, FLEET_PUSH, FLEET_ZONEDATA };
+static const char* const FLEET_MODE_NAMES[] = {"tiles", "bmp", "push", "zonedata"};
+
+// What a request was for; each class gets its own latency histogram
+enum FleetClass : uint8_t { FLEET_LIST, FLEET_TILE, FLEET_ZONE, FLEET_DATA, FLEET_STREAM, FLEET_CLASSES };
+static const char* const FLEET_CLASS_NAMES[] = {"list", "tiles", "zone", "zonedata", "stream"};
+
+static inline uint64_t fleetEpochMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline uint64_t fleetMonoUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Log-linear histogram of microseconds: exact below 32, then 32 buckets
+ * per power of two, so any quantile is within about 3% of the true value.
+ */
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5, SUB = 1 << SUB_BITS, BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    static int index(uint64_t v) {
+        if (v < (uint64_t)SUB) return (int)v;
+        int k = 63 - __builtin_clzll(v);
+        return (k - SUB_BITS + 1) * SUB + (int)((v >> (k - SUB_BITS)) - SUB);
+    }
+    static uint64_t lower(int i) { return i < SUB ? (uint64_t)i : (uint64_t)(SUB + i % SUB) << (i / SUB - 1); }
+    static uint64_t upper(int i) { return i < SUB ? (uint64_t)i : lower(i) + ((uint64_t)1 << (i / SUB - 1)) - 1; }
+
+    void record(uint64_t us) {
+        _counts[index(us)]++;
+        _count++;
+        _sum += us;
+        if (us > _max) _max = us;
+    }
+
+    void merge(const LatencyHistogram& o) {
+        for (int i = 0; i < BUCKETS; i++) _counts[i] += o._counts[i];
+        _count += o._count;
+        _sum += o._sum;
+        if (o._max > _max) _max = o._max;
+    }
+
+    /** The value q (0..1) of the samples are at or below: its bucket's top, never above the largest seen. */
+    uint64_t quantile(double q) const {
+        if (!_count) return 0;
+        double want = q * (double)_count;
+        uint64_t rank = (uint64_t)want;
+        if ((double)rank < want || rank == 0) rank++;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += _counts[i];
+            if (seen >= rank) return upper(i) < _max ? upper(i) : _max;
+        }
+        return _max;
+    }
+
+    uint64_t count() const { return _count; }
+    uint64_t max() const { return _max; }
+    double mean() const { return _count ? (double)_sum / (double)_count : 0; }
+
+private:
+    uint64_t _counts[BUCKETS] = {};
+    uint64_t _count = 0, _sum = 0, _max = 0;
+};
+
+/** xorshift64*: the same fleet for the same seed. */
+class FleetRandom {
+public:
+    explicit FleetRandom(uint64_t seed = 1) : _s(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+    uint64_t next() {
+        _s ^= _s >> 12; _s ^= _s << 25; _s ^= _s >> 27;
+        return _s * 0x2545F4914F6CDD1Dull;
+    }
+    /** Uniform in [0, n). */
+    uint32_t below(uint32_t n) { return n ? (uint32_t)(next() >> 32) % n : 0; }
+
+private:
+    uint64_t _s;
+};
+
+/** The interval poll after one at lastMs: cadence later, moved by up to +-jitter. */
+static inline uint64_t fleetNextPoll(uint64_t lastMs, uint32_t cadenceMs, uint32_t jitterMs, FleetRandom& rng) {
+    int64_t j = jitterMs ? (int64_t)rng.below(2 * jitterMs + 1) - (int64_t)jitterMs : 0;
+    int64_t next = (int64_t)(lastMs + cadenceMs) + j;
+    return next > (int64_t)lastMs ? (uint64_t)next : lastMs + 1;
+}
+
+/**
+ * When a device next prefetches, and for which boundary (epoch seconds):
+ * lead seconds before the first minute boundary after `after` that is
+ * still at least the minimum lead away, up to jitter late. Every device's
+ * clock is NTP-set, so without jitter the whole fleet asks at once.
+ */
+static inline uint64_t fleetNextPrefetch(uint64_t nowMs, uint32_t after, uint32_t jitterMs, FleetRandom& rng, uint32_t& boundary) {
+    boundary = (uint32_t)(nowMs / 60000 + 1) * 60;
+    if (boundary <= after) boundary = after + 60;
+    while ((uint64_t)(boundary - FLEET_PREFETCH_MIN_LEAD_S) * 1000 <= nowMs) boundary += 60;
+    uint64_t close = (uint64_t)(boundary - FLEET_PREFETCH_MIN_LEAD_S) * 1000 - 1;
+    uint64_t at = (uint64_t)(boundary - FLEET_PREFETCH_LEAD_S) * 1000 + rng.below(jitterMs + 1);
+    if (at > close) at = close;
+    return at > nowMs ? at : nowMs;
+}
+
+/**
+ * Mark the zones a list response names: the firmware's CSV, or the
+ * "changed" array of /api/zones/changed when the body is JSON.
+ */
+static inline int fleetParseChanged(const char* body, size_t len, bool* flags) {
+    size_t i = 0;
+    while (i < len && (body[i] == ' ' || body[i] == '\r' || body[i] == '\n')) i++;
+    if (i == len || body[i] != '{') return parseZoneList(body, len, ZONES, ZONE_COUNT, flags);
+    const char* key = "\"changed\":[";
+    const char* p = (const char*)memmem(body, len, key, strlen(key));
+    if (!p) return 0;
+    p += strlen(key);
+    const char* end = (const char*)memchr(p, ']', len - (size_t)(p - body));
+    if (!end) return 0;
+    std::string csv;
+    for (; p < end; p++) if (*p != '"') csv += *p;
+    return parseZoneList(csv.data(), csv.size(), ZONES, ZONE_COUNT, flags);
+}
+
+/**
+ * Incremental HTTP/1.1 response: status line and headers, then the body
+ * through HttpBodyReader to a sink, in whatever pieces the socket gives.
+ */
+class HttpResponseParser {
+public:
+    void begin() {
+        _lineLen = 0; _status = 0; _length = -1; _chunked = false;
+        _inBody = false; _bad = false; _body = 0;
+    }
+
+    /** Feed response bytes. False once the head or body framing is broken or the sink stops. */
+    bool feed(const uint8_t* buf, size_t n, HttpBodySink sink, void* ctx) {
+        size_t i = 0;
+        while (!_inBody && i < n) {
+            char c = (char)buf[i++];
+            if (c == '\r') continue;
+            if (c != '\n') { if (_lineLen < sizeof(_line) - 1) _line[_lineLen++] = c; continue; }
+            _line[_lineLen] = '\0';
+            _lineLen = 0;
+            if (_status == 0) {
+                if (sscanf(_line, "HTTP/%*d.%*d %d", &_status) != 1 || _status <= 0) { _bad = true; return false; }
+            } else if (_line[0] == '\0') {
+                _inBody = true;
+                _reader.begin(_length, _chunked);
+            } else if (strncasecmp(_line, "Content-Length:", 15) == 0) {
+                _length = atol(_line + 15);
+            } else if (strncasecmp(_line, "Transfer-Encoding:", 18) == 0 && strstr(_line + 18, "chunked")) {
+                _chunked = true;
+            }
+        }
+        if (_inBody && i < n && !_reader.feed(buf + i, n - i, sink, ctx, _body)) { _bad = true; return false; }
+        return true;
+    }
+
+    /** The server closed: true if that was the end of a whole response (a close-delimited body). */
+    bool closed() const { return _inBody && !_bad && (_reader.done() || _reader.closeDelimited()); }
+
+    bool headersDone() const { return _inBody; }
+    bool done() const { return _inBody && _reader.done(); }
+    int status() const { return _status; }
+    size_t bodyBytes() const { return _body; }
+
+private:
+    char _line[256];
+    size_t _lineLen = 0;
+    int _status = 0;
+    long _length = -1;
+    bool _chunked = false, _inBody = false, _bad = false;
+    size_t _body = 0;
+    HttpBodyReader _reader;
+};
+
+struct FleetConfig {
+    ServerEndpoint server = {};
+    FleetMode mode = FLEET_TILES;
+    int devices = 100;
+    uint32_t durationMs = 60000;
+    uint32_t pollMs = energyCadence(ENERGY_NORMAL).pollMs;
+    uint32_t fullMs = energyCadence(ENERGY_NORMAL).fullMs;
+    uint32_t jitterMs = 500;       // each poll lands up to this early or late
+    uint32_t spreadMs = 20000;     // boots spread over this; 0 = every device at once (a power cut)
+    bool prefetch = true;          // fetch the next minute's zones ahead of the boundary
+    const char* listPath = "/api/zones?plain=1";
+    const char* zonedataPath = "/api/zonedata";
+    uint32_t timeoutMs = HTTP_TIMEOUT_MS;
+    uint64_t seed = 1;
+};
+
+struct FleetStats {
+    LatencyHistogram latency;      // connect to last byte; a stream's to its headers
+    uint64_t requests = 0, ok = 0, client4xx = 0, server5xx = 0, failed = 0;
+    uint64_t bytesIn = 0, bytesOut = 0;
+};
+
+class FleetSim {
+public:
+    FleetSim() = default;
+    FleetSim(const FleetSim&) = delete;
+    FleetSim& operator=(const FleetSim&) = delete;
+    ~FleetSim() {
+        for (Device& d : _dev) { drop(d.req); drop(d.push); }
+        if (_ep >= 0) close(_ep);
+    }
+
+    /** Resolve the server and lay out the fleet. False if the server's address doesn't resolve. */
+    bool begin(const FleetConfig& cfg) {
+        _cfg = cfg;
+        if (_cfg.mode == FLEET_ZONEDATA) _cfg.prefetch = false;
+        struct addrinfo hints = {}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        char port[8];
+        snprintf(port, sizeof(port), "%u", (unsigned)_cfg.server.port);
+        if (_cfg.server.tls || getaddrinfo(_cfg.server.host, port, &hints, &res) != 0 || !res) return false;
+        memcpy(&_addr, res->ai_addr, sizeof(_addr));
+        freeaddrinfo(res);
+        _ep = epoll_create1(EPOLL_CLOEXEC);
+        if (_ep < 0) return false;
+
+        _rng = FleetRandom(_cfg.seed);
+        _dev = std::vector<Device>(_cfg.devices);
+        bool drawn = _cfg.mode == FLEET_TILES || _cfg.mode == FLEET_PUSH;
+        for (int i = 0; i < _cfg.devices; i++) {
+            Device& d = _dev[i];
+            d.sim = this;
+            d.req.device = d.push.device = i;
+            d.req.owner = d.push.owner = &d;
+            d.push.stream = true;
+            d.parser.reset();
+            d.bootAt = _rng.below(_cfg.spreadMs + 1);     // relative until run() starts the clock
+            if (drawn) {
+                d.fb.assign(ZONE_CANVAS_W / 8 * ZONE_CANVAS_H, 0xFF);
+                for (int z = 0; z < ZONE_COUNT; z++) d.hashes[z].assign(tileCount(ZONES[z].w, ZONES[z].h), 0);
+            }
+        }
+        return true;
+    }
+
+    /** Run the fleet for the configured duration, or until stop(). */
+    void run() {
+        _startMs = fleetEpochMs();
+        uint64_t end = _startMs + _cfg.durationMs;
+        for (int i = 0; i < (int)_dev.size(); i++) {
+            _dev[i].bootAt += _startMs;
+            schedule(i);
+        }
+        struct epoll_event evs[256];
+        uint64_t now = _startMs;
+        while (!_stop && (now = fleetEpochMs()) < end) {
+            while (!_wakes.empty() && _wakes.top().first <= now) {
+                Wake w = _wakes.top();
+                _wakes.pop();
+                if (_dev[w.second].wakeAt == w.first) tick(w.second, now);
+            }
+            uint64_t next = _wakes.empty() || _wakes.top().first > end ? end : _wakes.top().first;
+            int timeout = next <= now ? 0 : next - now > 1000 ? 1000 : (int)(next - now);
+            int n = epoll_wait(_ep, evs, 256, timeout);
+            for (int k = 0; k < n; k++) onEvent(*(Conn*)evs[k].data.ptr, evs[k].events);
+        }
+        _elapsedMs = now - _startMs;
+        for (Device& d : _dev) { drop(d.req); drop(d.push); }
+    }
+
+    /** Safe from a signal handler: run() returns at its next turn. */
+    void stop() { _stop = true; }
+
+    const FleetStats& stats(FleetClass c) const { return _stats[c]; }
+    uint64_t elapsedMs() const { return _elapsedMs; }
+    uint64_t pushEvents() const { return _pushEvents; }
+    uint64_t decodeErrors() const { return _decodeErrors; }
+    uint64_t tileMismatches() const { return _tileMismatches; }
+    int peakOpen() const { return _peakOpen; }
+
+    void report(FILE* out) const {
+        double secs = _elapsedMs ? _elapsedMs / 1000.0 : 1, deviceHours = _cfg.devices * secs / 3600.0;
+        fprintf(out, "%d devices, %s mode, %.1f s: poll %lu ms +-%lu, full every %lu s, boots over %lu ms, prefetch %s\n",
+                _cfg.devices, FLEET_MODE_NAMES[_cfg.mode], secs, (unsigned long)_cfg.pollMs, (unsigned long)_cfg.jitterMs,
+                (unsigned long)(_cfg.fullMs / 1000), (unsigned long)_cfg.spreadMs, _cfg.prefetch ? "on" : "off");
+        fprintf(out, "%-9s %9s %8s %8s %6s %6s %6s %9s %9s %9s %9s %10s\n", "endpoint", "requests", "req/s", "ok", "4xx", "5xx",
+                "failed", "p50 ms", "p99 ms", "p999 ms", "max ms", "in KB");
+        FleetStats total;
+        for (int c = 0; c < FLEET_CLASSES; c++) {
+            const FleetStats& s = _stats[c];
+            if (!s.requests) continue;
+            row(out, FLEET_CLASS_NAMES[c], s, secs);
+            total.latency.merge(s.latency);
+            total.requests += s.requests; total.ok += s.ok; total.client4xx += s.client4xx; total.server5xx += s.server5xx;
+            total.failed += s.failed; total.bytesIn += s.bytesIn; total.bytesOut += s.bytesOut;
+        }
+        row(out, "all", total, secs);
+        fprintf(out, "per device-hour: %.1f KB in, %.1f KB out, %.1f requests\n", total.bytesIn / 1024.0 / deviceHours,
+                total.bytesOut / 1024.0 / deviceHours, total.requests / deviceHours);
+        fprintf(out, "push events %lu, tile streams broken %lu, tiles failing their hash %lu, peak open connections %d\n",
+                (unsigned long)_pushEvents, (unsigned long)_decodeErrors, (unsigned long)_tileMismatches, _peakOpen);
+    }
+
+private:
+    struct Device;
+
+    struct Conn {
+        int fd = -1;
+        int device = -1;
+        Device* owner = nullptr;
+        bool stream = false, connected = false;
+        FleetClass cls = FLEET_LIST;
+        int zone = -1;
+        std::string out;
+        size_t sent = 0;
+        uint64_t startUs = 0, deadlineMs = 0, bytesIn = 0;
+        HttpResponseParser resp;
+    };
+
+    struct Device {
+        FleetSim* sim = nullptr;
+        Conn req, push;
+        uint64_t bootAt = 0, wakeAt = 0;
+        bool booted = false, inCycle = false, full = false;
+        uint64_t cycleAt = 0, nextPoll = 0, lastFull = 0, holdUntil = 0;
+        uint32_t applyAt = 0;                  // the boundary a prefetch cycle is for, 0 otherwise
+        uint64_t nextPrefetch = 0;
+        uint32_t prefetchFor = 0;              // boundary nextPrefetch is for
+        bool pending[ZONE_COUNT] = {};
+        bool pushChanged[ZONE_COUNT] = {};
+        bool pushPending = false, streaming = false;
+        int pushFailures = 0;
+        uint64_t pushRetryAt = 0;
+        std::vector<uint8_t> fb;
+        std::vector<uint32_t> hashes[ZONE_COUNT];
+        std::string list;
+        TileStreamDecoder dec;
+        ZonePushParser parser;
+    };
+
+    typedef std::pair<uint64_t, int> Wake;
+
+    static void row(FILE* out, const char* name, const FleetStats& s, double secs) {
+        fprintf(out, "%-9s %9lu %8.1f %8lu %6lu %6lu %6lu %9.1f %9.1f %9.1f %9.1f %10.1f\n", name, (unsigned long)s.requests,
+                s.requests / secs, (unsigned long)s.ok, (unsigned long)s.client4xx, (unsigned long)s.server5xx,
+                (unsigned long)s.failed, s.latency.quantile(0.5) / 1000.0, s.latency.quantile(0.99) / 1000.0,
+                s.latency.quantile(0.999) / 1000.0, s.latency.max() / 1000.0, s.bytesIn / 1024.0);
+    }
+
+    // ---- Device logic: the firmware's loop() on timers ----
+
+    void tick(int di, uint64_t now) {
+        Device& d = _dev[di];
+        if (d.req.fd >= 0 && now >= d.req.deadlineMs) finish(d.req, false);
+        if (_cfg.mode == FLEET_PUSH && d.push.fd < 0 && now >= d.bootAt && now >= d.pushRetryAt) openStream(d);
+        if (d.req.fd < 0 && !d.inCycle && now >= d.bootAt) {
+            if (_cfg.prefetch && d.booted && now >= d.nextPrefetch) {
+                uint32_t boundary = d.prefetchFor;
+                d.nextPrefetch = fleetNextPrefetch(now, boundary, _cfg.jitterMs, _rng, d.prefetchFor);
+                // Busy until past the window: this boundary is left to the regular poll
+                if (now < (uint64_t)(boundary - FLEET_PREFETCH_MIN_LEAD_S) * 1000) startCycle(d, now, boundary);
+            }
+            if (!d.inCycle) {
+                bool intervalDue = now >= d.nextPoll && now >= d.holdUntil;
+                bool needsFull = !d.booted || now - d.lastFull >= _cfg.fullMs;
+                if ((intervalDue && !d.streaming) || d.pushPending || (needsFull && intervalDue)) startCycle(d, now, 0);
+            }
+        }
+        schedule(di);
+    }
+
+    void schedule(int di) {
+        Device& d = _dev[di];
+        uint64_t w = UINT64_MAX;
+        if (d.req.fd >= 0) w = d.req.deadlineMs;
+        else if (!d.inCycle) {
+            if (!d.booted) w = d.nextPoll > d.bootAt ? d.nextPoll : d.bootAt;
+            else {
+                uint64_t poll = d.nextPoll > d.holdUntil ? d.nextPoll : d.holdUntil;
+                // While streaming only the full refresh is on a timer
+                if (d.streaming && d.lastFull + _cfg.fullMs > poll) poll = d.lastFull + _cfg.fullMs;
+                w = d.pushPending ? 0 : poll;
+                if (_cfg.prefetch && d.nextPrefetch < w) w = d.nextPrefetch;
+            }
+        }
+        if (_cfg.mode == FLEET_PUSH && d.push.fd < 0) {
+            uint64_t p = d.pushRetryAt > d.bootAt ? d.pushRetryAt : d.bootAt;
+            if (p < w) w = p;
+        }
+        d.wakeAt = w;
+        if (w != UINT64_MAX) _wakes.push(Wake(w, di));
+    }
+
+    void startCycle(Device& d, uint64_t now, uint32_t applyAt) {
+        d.inCycle = true;
+        d.cycleAt = now;
+        d.applyAt = applyAt;
+        d.full = !applyAt && (!d.booted || now - d.lastFull >= _cfg.fullMs);
+        memset(d.pending, 0, sizeof(d.pending));
+        if (_cfg.mode == FLEET_ZONEDATA) { request(d, FLEET_DATA, -1, "GET", _cfg.zonedataPath, ""); return; }
+        if (!applyAt && d.pushPending && !d.full) {
+            memcpy(d.pending, d.pushChanged, sizeof(d.pending));
+            memset(d.pushChanged, 0, sizeof(d.pushChanged));
+            d.pushPending = false;
+            nextZone(d);
+            return;
+        }
+        std::string path = _cfg.listPath;
+        char sep = strchr(_cfg.listPath, '?') ? '&' : '?';
+        if (d.full) { path += sep; path += "force=true"; sep = '&'; }
+        if (applyAt) { path += sep; path += "at=" + std::to_string(applyAt); }
+        d.list.clear();
+        request(d, FLEET_LIST, -1, "GET", path, "");
+    }
+
+    void nextZone(Device& d) {
+        int z = 0;
+        while (z < ZONE_COUNT && !d.pending[z]) z++;
+        if (z == ZONE_COUNT) { endCycle(d, true); return; }
+        d.pending[z] = false;
+        std::string path = std::string("/api/zone/") + ZONES[z].id;
+        const char* layout = "X-Layout: " DASHBOARD_LAYOUT_TAG "\r\n";
+        // A prefetch stages whole BMPs as of the boundary, whatever the mode
+        if (d.applyAt) request(d, FLEET_ZONE, z, "GET", path + "?at=" + std::to_string(d.applyAt), std::string("Accept: application/octet-stream\r\n") + layout);
+        else if (_cfg.mode == FLEET_BMP) request(d, FLEET_ZONE, z, "GET", path, std::string("Accept: application/octet-stream\r\n") + layout);
+        else {
+            d.dec.begin(TileSurface{d.fb.data(), ZONE_CANVAS_W / 8, ZONE_CANVAS_W, ZONE_CANVAS_H}, d.hashes[z].data(), (int)d.hashes[z].size());
+            request(d, FLEET_TILE, z, "POST", path + "/tiles", std::string("Content-Type: application/octet-stream\r\n") + layout,
+                    d.hashes[z].data(), d.hashes[z].size() * sizeof(uint32_t));
+        }
+    }
+
+    void endCycle(Device& d, bool ok) {
+        d.inCycle = false;
+        uint64_t now = fleetEpochMs();
+        if (d.applyAt) {
+            // The staged frame covers the boundary; the interval poll waits for it to land
+            d.holdUntil = (uint64_t)d.applyAt * 1000;
+            return;
+        }
+        // Before the first draw a failed poll is retried after the firmware's delay(5000)
+        d.nextPoll = !ok && !d.booted ? now + FLEET_RETRY_MS : fleetNextPoll(d.cycleAt, _cfg.pollMs, _cfg.jitterMs, _rng);
+        if (ok && d.full) {
+            d.lastFull = d.cycleAt;
+            if (!d.booted && _cfg.prefetch) d.nextPrefetch = fleetNextPrefetch(now, 0, _cfg.jitterMs, _rng, d.prefetchFor);
+            d.booted = true;
+        }
+    }
+
+    // A response in: move the device's cycle on
+    void responded(Device& d, Conn& c, bool ok) {
+        if (c.stream) {
+            d.streaming = false;
+            if (ok) d.pushFailures = 0;
+            // After PUSH_MAX_FAILURES failed connects the client parks and polls
+            bool parked = !ok && ++d.pushFailures >= PUSH_MAX_FAILURES;
+            if (parked) d.pushFailures = 0;
+            d.pushRetryAt = fleetEpochMs() + (parked ? PUSH_FALLBACK_RETRY_MS : PUSH_CONNECT_BACKOFF_MS);
+            return;
+        }
+        ok = ok && c.resp.status() == 200;
+        if (c.cls == FLEET_LIST) {
+            if (!ok) { endCycle(d, false); return; }
+            if (d.full) for (int z = 0; z < ZONE_COUNT; z++) d.pending[z] = true;
+            else fleetParseChanged(d.list.data(), d.list.size(), d.pending);
+            if (!d.applyAt) { memset(d.pushChanged, 0, sizeof(d.pushChanged)); d.pushPending = false; }
+            nextZone(d);
+            return;
+        }
+        if (c.cls == FLEET_TILE) {
+            _tileMismatches += d.dec.mismatches();
+            if (!d.dec.done()) {
+                // Part of the zone may have been written; nothing it holds can be trusted now
+                if (c.resp.status() == 200) _decodeErrors++;
+                memset(d.hashes[c.zone].data(), 0, d.hashes[c.zone].size() * sizeof(uint32_t));
+            }
+        }
+        if (c.cls == FLEET_DATA) { endCycle(d, ok); return; }
+        nextZone(d);
+    }
+
+    static void onPushEvent(const ZonePushEvent& ev, void* ctx) {
+        Device& d = *(Device*)ctx;
+        d.sim->_pushEvents++;
+        if (parseZoneList(ev.zones, ev.zonesLen, ZONES, ZONE_COUNT, d.pushChanged) > 0) d.pushPending = true;
+    }
+
+    static bool sink(const uint8_t* data, size_t len, void* ctx) {
+        Conn& c = *(Conn*)ctx;
+        Device& d = *c.owner;
+        if (c.stream) d.parser.feed(data, len, onPushEvent, &d);
+        else if (c.cls == FLEET_LIST) d.list.append((const char*)data, len < FLEET_LIST_MAX - d.list.size() ? len : FLEET_LIST_MAX - d.list.size());
+        else if (c.cls == FLEET_TILE && !d.dec.error()) d.dec.feed(data, len);
+        return true;
+    }
+
+    void openStream(Device& d) {
+        d.parser.reset();
+        request(d, FLEET_STREAM, -1, "GET", "/api/zones/stream", "Accept: text/event-stream\r\nCache-Control: no-cache\r\n");
+    }
+
+    // ---- Connections ----
+
+    void request(Device& d, FleetClass cls, int zone, const char* method, const std::string& path, const std::string& headers,
+                 const void* body = nullptr, size_t bodyLen = 0) {
+        Conn& c = cls == FLEET_STREAM ? d.push : d.req;
+        c.cls = cls;
+        c.zone = zone;
+        c.connected = false;
+        c.sent = 0;
+        c.bytesIn = 0;
+        c.resp.begin();
+        c.out = std::string(method) + " " + _cfg.server.prefix + path + " HTTP/1.1\r\nHost: " + _cfg.server.host +
+                "\r\nUser-Agent: PTV-TRMNL/fleet-sim\r\n" + (c.stream ? "" : "Connection: close\r\n") + headers;
+        if (body) c.out += "Content-Length: " + std::to_string(bodyLen) + "\r\n";
+        c.out += "\r\n";
+        if (body) c.out.append((const char*)body, bodyLen);
+        c.startUs = fleetMonoUs();
+        c.deadlineMs = fleetEpochMs() + _cfg.timeoutMs;
+        _stats[cls].requests++;
+
+        c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (c.fd >= 0 && ++_open > _peakOpen) _peakOpen = _open;
+        struct epoll_event ev = {};
+        ev.events = EPOLLOUT;
+        ev.data.ptr = &c;
+        if (c.fd < 0 || (connect(c.fd, (struct sockaddr*)&_addr, sizeof(_addr)) < 0 && errno != EINPROGRESS) ||
+            epoll_ctl(_ep, EPOLL_CTL_ADD, c.fd, &ev) < 0)
+            finish(c, false);
+    }
+
+    void onEvent(Conn& c, uint32_t events) {
+        if (!c.connected) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) { finish(c, false); return; }
+            c.connected = true;
+        }
+        if (c.sent < c.out.size()) {
+            ssize_t n = ::send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+            if (n <= 0) { finish(c, false); return; }
+            c.sent += (size_t)n;
+            _stats[c.cls].bytesOut += (uint64_t)n;
+            if (c.sent == c.out.size()) {
+                struct epoll_event ev = {};
+                ev.events = EPOLLIN;
+                ev.data.ptr = &c;
+                epoll_ctl(_ep, EPOLL_CTL_MOD, c.fd, &ev);
+            }
+            return;
+        }
+        uint8_t buf[16384];
+        for (;;) {
+            ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) break;
+            if (n <= 0) { finish(c, n == 0 && c.resp.closed()); return; }
+            _stats[c.cls].bytesIn += (uint64_t)n;
+            bool head = c.resp.headersDone();
+            if (!c.resp.feed(buf, (size_t)n, sink, &c)) { finish(c, false); return; }
+            if (c.stream) {
+                if (!head && c.resp.headersDone()) {
+                    bool ok = c.resp.status() == 200;
+                    account(c, ok);
+                    if (!ok) { finish(c, false); return; }
+                    c.owner->streaming = true;
+                }
+                if (c.owner->pushPending) tick(c.device, fleetEpochMs());
+            } else if (c.resp.done()) {
+                finish(c, true);
+                return;
+            }
+        }
+    }
+
+    void account(Conn& c, bool ok) {
+        FleetStats& s = _stats[c.cls];
+        if (!ok && !c.resp.headersDone()) { s.failed++; return; }
+        s.latency.record(fleetMonoUs() - c.startUs);
+        int st = c.resp.status();
+        if (st >= 500) s.server5xx++;
+        else if (st >= 400) s.client4xx++;
+        else if (ok) s.ok++;
+        else s.failed++;
+    }
+
+    void drop(Conn& c) {
+        if (c.fd < 0) return;
+        close(c.fd);             // leaves the epoll set with it
+        c.fd = -1;
+        _open--;
+    }
+
+    // The request is over (ok: a whole response arrived). A stream was accounted when its headers came.
+    void finish(Conn& c, bool ok) {
+        drop(c);
+        if (!c.stream || !c.resp.headersDone()) account(c, ok);
+        responded(*c.owner, c, c.stream ? c.resp.headersDone() && c.resp.status() == 200 : ok);
+        schedule(c.device);
+    }
+
+    FleetConfig _cfg;
+    struct sockaddr_in _addr = {};
+    int _ep = -1;
+    FleetRandom _rng;
+    std::vector<Device> _dev;
+    std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> _wakes;
+    FleetStats _stats[FLEET_CLASSES];
+    uint64_t _startMs = 0, _elapsedMs = 0;
+    uint64_t _pushEvents = 0, _decodeErrors = 0, _tileMismatches = 0;
+    int _open = 0, _peakOpen = 0;
+    volatile bool _stop = false;
+};
+
+#endif // FLEET_SIM_HPP
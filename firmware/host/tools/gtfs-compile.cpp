@@ -0,0 +1,102 @@
+/**
+ * Compile a GTFS feed into the device's offline timetable image
+ *
+ * Usage: ./gtfs-compile -o timetable.bin --stop ID [--stop ID...] [--from YYYYMMDD] [--days N] gtfs-dir
+ *        ./gtfs-compile --query ID@YYYYMMDD-HH:MM timetable.bin
+ *
+ * gtfs-dir is an extracted feed (PTV publishes one zip per mode; unzip the
+ * ones you need into the same directory or compile them separately). A
+ * parent station id pulls in all of its platforms. --query prints the next
+ * departures the device would show and how long the lookup took.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "gtfs_compile.hpp"
+
+#include <time.h>
+#include <chrono>
+
+static int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s -o OUT --stop ID [--stop ID...] [--from YYYYMMDD] [--days N] [--max-bytes N] GTFS_DIR\n"
+            "       %s --query STOP@YYYYMMDD-HH:MM [-n N] IMAGE\n",
+            argv0, argv0);
+    return 2;
+}
+
+static int query(const char* spec, int n, const char* imagePath) {
+    std::ifstream f(imagePath, std::ios::binary);
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    Timetable tt;
+    if (!tt.open(image.data(), image.size())) { fprintf(stderr, "%s: not a timetable image (or CRC mismatch)\n", imagePath); return 1; }
+    std::string s = spec;
+    size_t at = s.rfind('@');
+    int y, mo, d, hh, mm;
+    if (at == std::string::npos || sscanf(s.c_str() + at + 1, "%4d%2d%2d-%d:%d", &y, &mo, &d, &hh, &mm) != 5) return usage("gtfs-compile");
+    std::string stopId = s.substr(0, at);
+    int stop = stopId == "*" ? -1 : tt.findStop(stopId.c_str());
+    if (stopId != "*" && stop < 0) { fprintf(stderr, "stop %s not in image\n", stopId.c_str()); return 1; }
+    uint32_t day = (uint32_t)ttDaysFromCivil(y, mo, d);
+    if (!tt.covers(day)) fprintf(stderr, "warning: %s is outside the image's %d days\n", s.c_str() + at + 1, tt.dayCount());
+
+    TtDeparture out[TT_MAX_RESULTS];
+    int count = 0;
+    const int reps = 10000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++) count = tt.next(stop, day, hh * 3600 + mm * 60, TT_ALL_MODES, out, n);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / reps;
+    for (int i = 0; i < count; i++) {
+        int t = out[i].time;
+        printf("%02d:%02d:%02d  %-8s %-28s %s\n", t / 3600, t / 60 % 60, t % 60, out[i].route, out[i].headsign, tt.stopName(out[i].stop));
+    }
+    printf("%d departures, %.2f us per lookup\n", count, us);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    GtfsOptions opt;
+    const char* out = nullptr;
+    const char* q = nullptr;
+    int n = TT_OFFLINE_DEPARTURES;
+    long maxBytes = 0;
+    time_t now = time(nullptr);
+    struct tm lt;
+    localtime_r(&now, &lt);
+    opt.firstDay = ttDaysFromCivil(lt.tm_year + 1900, lt.tm_mon + 1, lt.tm_mday);
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a[0] != '-') { opt.dir = a; continue; }
+        if (!v) return usage(argv[0]);
+        if (a == "-o") out = v;
+        else if (a == "--stop") opt.stops.push_back(v);
+        else if (a == "--days") opt.dayCount = atoi(v);
+        else if (a == "--max-bytes") maxBytes = atol(v);
+        else if (a == "--query") q = v;
+        else if (a == "-n") n = atoi(v);
+        else if (a == "--from") {
+            opt.firstDay = gtfsDate(v);
+            if (opt.firstDay == INT32_MIN) return usage(argv[0]);
+        } else return usage(argv[0]);
+        i++;
+    }
+    if (q) return opt.dir.empty() ? usage(argv[0]) : query(q, n, opt.dir.c_str());
+    if (!out || opt.stops.empty() || opt.dir.empty()) return usage(argv[0]);
+
+    GtfsCompiler compiler(opt);
+    std::vector<uint8_t> image;
+    if (!compiler.compile(image)) { fprintf(stderr, "gtfs-compile: %s\n", compiler.error().c_str()); return 1; }
+    const GtfsStats& st = compiler.stats();
+    printf("%zu stops, %zu routes, %zu services, %zu patterns, %zu departures in %zu blocks: %zu bytes\n",
+           st.stops, st.routes, st.services, st.patterns, st.events, st.blocks, st.bytes);
+    if (maxBytes > 0 && (long)image.size() > maxBytes) {
+        fprintf(stderr, "gtfs-compile: image is %zu bytes, partition holds %ld; use fewer --days or stops\n", image.size(), maxBytes);
+        return 1;
+    }
+    FILE* f = fopen(out, "wb");
+    if (!f || fwrite(image.data(), 1, image.size(), f) != image.size() || fclose(f) != 0) { perror(out); return 1; }
+    return 0;
+}
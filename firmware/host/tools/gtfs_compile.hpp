@@ -0,0 +1,396 @@
+/**
+ * GTFS feed -> offline timetable image (see include/timetable.hpp)
+ *
+ * Reads an extracted GTFS directory, keeps only departures from the
+ * requested stops (a parent station brings in all its platforms) on
+ * services running inside the date window, and lays them out for
+ * Timetable to read in place. stop_times.txt is streamed, so full state
+ * feeds compile without holding them in memory.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef GTFS_COMPILE_HPP
+#define GTFS_COMPILE_HPP
+
+#include "timetable.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <tuple>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct GtfsOptions {
+    std::string dir;
+    std::vector<std::string> stops;   // stop_ids or parent station ids
+    int32_t firstDay = 0;             // days since 1970-01-01
+    int dayCount = 28;
+};
+
+struct GtfsStats {
+    size_t stops = 0, routes = 0, patterns = 0, services = 0, events = 0, blocks = 0, bytes = 0;
+};
+
+/** One CSV file with a header row; quoted fields and a UTF-8 BOM are handled. */
+class CsvReader {
+public:
+    bool open(const std::string& path) {
+        _in.open(path);
+        if (!_in) return false;
+        std::vector<std::string> head;
+        if (!next(head)) return false;
+        if (!head.empty() && head[0].compare(0, 3, "\xEF\xBB\xBF") == 0) head[0].erase(0, 3);
+        for (size_t i = 0; i < head.size(); i++) _cols[head[i]] = (int)i;
+        return true;
+    }
+
+    int col(const char* name) const {
+        auto it = _cols.find(name);
+        return it == _cols.end() ? -1 : it->second;
+    }
+
+    bool next(std::vector<std::string>& fields) {
+        fields.clear();
+        std::string line;
+        if (!std::getline(_in, line)) return false;
+        std::string cur;
+        bool quoted = false;
+        for (size_t i = 0;; i++) {
+            if (i == line.size()) {
+                if (!quoted) break;
+                // Newline inside a quoted field
+                cur += '\n';
+                if (!std::getline(_in, line)) break;
+                i = (size_t)-1;
+                continue;
+            }
+            char c = line[i];
+            if (quoted) {
+                if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') { cur += '"'; i++; }
+                else if (c == '"') quoted = false;
+                else cur += c;
+            } else if (c == '"') quoted = true;
+            else if (c == ',') { fields.push_back(cur); cur.clear(); }
+            else if (c != '\r') cur += c;
+        }
+        fields.push_back(cur);
+        return true;
+    }
+
+    static const std::string& get(const std::vector<std::string>& f, int col) {
+        static const std::string empty;
+        return col >= 0 && (size_t)col < f.size() ? f[col] : empty;
+    }
+
+private:
+    std::ifstream _in;
+    std::map<std::string, int> _cols;
+};
+
+/** "HH:MM:SS" (hours may exceed 23) to seconds, -1 if blank or malformed. */
+static inline int32_t gtfsTime(const std::string& s) {
+    int h, m, sec;
+    if (sscanf(s.c_str(), "%d:%d:%d", &h, &m, &sec) != 3 || h < 0 || m < 0 || sec < 0) return -1;
+    return h * 3600 + m * 60 + sec;
+}
+
+/** "YYYYMMDD" to days since 1970-01-01, INT32_MIN if malformed. */
+static inline int32_t gtfsDate(const std::string& s) {
+    int y, m, d;
+    if (s.size() != 8 || sscanf(s.c_str(), "%4d%2d%2d", &y, &m, &d) != 3) return INT32_MIN;
+    return ttDaysFromCivil(y, m, d);
+}
+
+static inline uint8_t gtfsMode(int routeType) {
+    if (routeType >= 0 && routeType <= 3) return (uint8_t)routeType;
+    if (routeType >= 100 && routeType < 200) return TT_RAIL;
+    if (routeType >= 400 && routeType < 500) return TT_METRO;
+    if (routeType >= 700 && routeType < 800) return TT_BUS;
+    if (routeType >= 900 && routeType < 1000) return TT_TRAM;
+    return TT_OTHER;
+}
+
+class GtfsCompiler {
+public:
+    explicit GtfsCompiler(const GtfsOptions& opt) : _opt(opt) {}
+
+    const std::string& error() const { return _error; }
+    const GtfsStats& stats() const { return _stats; }
+
+    bool compile(std::vector<uint8_t>& image) {
+        if (_opt.dayCount <= 0 || _opt.dayCount > 366) return fail("day window must be 1..366");
+        return loadStops() && loadStopTimes() && loadTrips() && loadRoutes() && loadCalendar() && build(image);
+    }
+
+private:
+    struct Stop { std::string id, name; std::vector<std::pair<int32_t, uint32_t>> events; };   // (time, trip)
+    struct Trip { std::string route, service, headsign; };
+
+    bool fail(const std::string& msg) { _error = msg; return false; }
+    std::string path(const char* file) const { return _opt.dir + "/" + file; }
+
+    bool loadStops() {
+        CsvReader csv;
+        if (!csv.open(path("stops.txt"))) return fail("cannot read stops.txt");
+        int cId = csv.col("stop_id"), cName = csv.col("stop_name"), cParent = csv.col("parent_station");
+        std::set<std::string> wanted(_opt.stops.begin(), _opt.stops.end());
+        std::vector<std::string> f;
+        std::map<std::string, std::string> keep;
+        while (csv.next(f)) {
+            const std::string& id = CsvReader::get(f, cId);
+            if (wanted.count(id) || wanted.count(CsvReader::get(f, cParent))) keep[id] = CsvReader::get(f, cName);
+        }
+        for (const std::string& id : _opt.stops)
+            if (!keep.count(id)) return fail("stop " + id + " not in stops.txt");
+        // Ordered by stop_id so the device can binary-search
+        for (auto& kv : keep) {
+            _stopIndex[kv.first] = _stops.size();
+            _stops.push_back({kv.first, kv.second, {}});
+        }
+        return true;
+    }
+
+    bool loadStopTimes() {
+        CsvReader csv;
+        if (!csv.open(path("stop_times.txt"))) return fail("cannot read stop_times.txt");
+        int cTrip = csv.col("trip_id"), cStop = csv.col("stop_id"), cDep = csv.col("departure_time"),
+            cArr = csv.col("arrival_time"), cSeq = csv.col("stop_sequence"), cPickup = csv.col("pickup_type");
+        if (cTrip < 0 || cStop < 0 || cDep < 0) return fail("stop_times.txt lacks trip_id/stop_id/departure_time");
+        // The last stop of a trip is arrival-only; only know which it is once the file is read
+        std::unordered_map<std::string, int> lastSeq;
+        struct Pending { size_t stop; int32_t time; uint32_t trip; int seq; };
+        std::vector<Pending> pending;
+        std::vector<std::string> f;
+        while (csv.next(f)) {
+            const std::string& trip = CsvReader::get(f, cTrip);
+            int seq = atoi(CsvReader::get(f, cSeq).c_str());
+            auto ls = lastSeq.find(trip);
+            if (ls == lastSeq.end()) lastSeq.emplace(trip, seq);
+            else if (seq > ls->second) ls->second = seq;
+            auto st = _stopIndex.find(CsvReader::get(f, cStop));
+            if (st == _stopIndex.end() || CsvReader::get(f, cPickup) == "1") continue;
+            int32_t t = gtfsTime(CsvReader::get(f, cDep));
+            if (t < 0) t = gtfsTime(CsvReader::get(f, cArr));
+            if (t < 0) continue;    // untimed stop; interpolating isn't worth it for a fallback
+            auto ti = _tripIndex.emplace(trip, (uint32_t)_tripIds.size());
+            if (ti.second) _tripIds.push_back(trip);
+            pending.push_back({st->second, t, ti.first->second, seq});
+        }
+        for (const Pending& p : pending)
+            if (p.seq < lastSeq[_tripIds[p.trip]]) _stops[p.stop].events.push_back({p.time, p.trip});
+        return true;
+    }
+
+    bool loadTrips() {
+        CsvReader csv;
+        if (!csv.open(path("trips.txt"))) return fail("cannot read trips.txt");
+        int cTrip = csv.col("trip_id"), cRoute = csv.col("route_id"), cService = csv.col("service_id"), cHead = csv.col("trip_headsign");
+        _trips.resize(_tripIds.size());
+        std::vector<std::string> f;
+        while (csv.next(f)) {
+            auto it = _tripIndex.find(CsvReader::get(f, cTrip));
+            if (it == _tripIndex.end()) continue;
+            _trips[it->second] = {CsvReader::get(f, cRoute), CsvReader::get(f, cService), CsvReader::get(f, cHead)};
+        }
+        return true;
+    }
+
+    bool loadRoutes() {
+        CsvReader csv;
+        if (!csv.open(path("routes.txt"))) return fail("cannot read routes.txt");
+        int cId = csv.col("route_id"), cShort = csv.col("route_short_name"), cLong = csv.col("route_long_name"), cType = csv.col("route_type");
+        std::unordered_set<std::string> used;
+        for (const Trip& t : _trips) used.insert(t.route);
+        std::vector<std::string> f;
+        while (csv.next(f)) {
+            const std::string& id = CsvReader::get(f, cId);
+            if (!used.count(id)) continue;
+            const std::string& shortName = CsvReader::get(f, cShort);
+            _routes[id] = {shortName.empty() ? CsvReader::get(f, cLong) : shortName, gtfsMode(atoi(CsvReader::get(f, cType).c_str()))};
+        }
+        return true;
+    }
+
+    bool loadCalendar() {
+        std::unordered_set<std::string> used;
+        for (const Trip& t : _trips) used.insert(t.service);
+        auto row = [&](const std::string& id) -> std::vector<bool>& {
+            auto it = _services.find(id);
+            if (it == _services.end()) it = _services.emplace(id, std::vector<bool>(_opt.dayCount, false)).first;
+            return it->second;
+        };
+        CsvReader csv;
+        std::vector<std::string> f;
+        bool any = false;
+        if (csv.open(path("calendar.txt"))) {
+            any = true;
+            static const char* days[] = {"monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"};
+            int cId = csv.col("service_id"), cStart = csv.col("start_date"), cEnd = csv.col("end_date"), cDay[7];
+            for (int i = 0; i < 7; i++) cDay[i] = csv.col(days[i]);
+            while (csv.next(f)) {
+                const std::string& id = CsvReader::get(f, cId);
+                if (!used.count(id)) continue;
+                int32_t start = gtfsDate(CsvReader::get(f, cStart)), end = gtfsDate(CsvReader::get(f, cEnd));
+                std::vector<bool>& r = row(id);
+                for (int d = 0; d < _opt.dayCount; d++) {
+                    int32_t day = _opt.firstDay + d;
+                    int weekday = (int)(((day % 7) + 7 + 3) % 7);    // 1970-01-01 was a Thursday; 0 = Monday
+                    if (day >= start && day <= end && CsvReader::get(f, cDay[weekday]) == "1") r[d] = true;
+                }
+            }
+        }
+        CsvReader dates;
+        if (dates.open(path("calendar_dates.txt"))) {
+            any = true;
+            int cId = dates.col("service_id"), cDate = dates.col("date"), cType = dates.col("exception_type");
+            while (dates.next(f)) {
+                const std::string& id = CsvReader::get(f, cId);
+                if (!used.count(id)) continue;
+                int32_t d = gtfsDate(CsvReader::get(f, cDate)) - _opt.firstDay;
+                if (d < 0 || d >= _opt.dayCount) continue;
+                row(id)[d] = CsvReader::get(f, cType) == "1";
+            }
+        }
+        return any || fail("neither calendar.txt nor calendar_dates.txt");
+    }
+
+    uint32_t addString(const std::string& s) {
+        auto it = _strings.find(s);
+        if (it != _strings.end()) return it->second;
+        uint32_t off = (uint32_t)_stringData.size();
+        _stringData.insert(_stringData.end(), s.begin(), s.end());
+        _stringData.push_back(0);
+        _strings.emplace(s, off);
+        return off;
+    }
+
+    template <class T>
+    static uint32_t append(std::vector<uint8_t>& out, const std::vector<T>& v) {
+        while (out.size() % 4) out.push_back(0);
+        uint32_t off = (uint32_t)out.size();
+        const uint8_t* p = (const uint8_t*)v.data();
+        out.insert(out.end(), p, p + v.size() * sizeof(T));
+        return off;
+    }
+
+    bool build(std::vector<uint8_t>& image) {
+        // Only services with a day in the window survive
+        std::map<std::string, uint16_t> serviceIndex;
+        std::vector<const std::vector<bool>*> serviceRows;
+        for (auto& kv : _services) {
+            if (std::find(kv.second.begin(), kv.second.end(), true) == kv.second.end()) continue;
+            serviceIndex[kv.first] = (uint16_t)serviceRows.size();
+            serviceRows.push_back(&kv.second);
+        }
+        std::map<std::string, uint16_t> routeIndex;
+        std::vector<TtRoute> routes;
+        std::map<std::tuple<uint16_t, uint16_t, uint32_t>, uint16_t> patternIndex;
+        std::vector<TtPattern> patterns;
+        std::vector<TtStop> stops;
+        std::vector<TtBlock> blocks;
+        std::vector<TtEvent> events;
+
+        for (Stop& st : _stops) {
+            TtStop rec = {addString(st.id), addString(st.name), (uint32_t)events.size(), 0, (uint32_t)blocks.size(), 0};
+            std::sort(st.events.begin(), st.events.end());
+            uint32_t prev = 0, inBlock = 0;
+            for (auto& ev : st.events) {
+                const Trip& trip = _trips[ev.second];
+                auto svc = serviceIndex.find(trip.service);
+                auto route = _routes.find(trip.route);
+                if (svc == serviceIndex.end() || route == _routes.end()) continue;
+                auto ri = routeIndex.find(trip.route);
+                if (ri == routeIndex.end()) {
+                    ri = routeIndex.emplace(trip.route, (uint16_t)routes.size()).first;
+                    routes.push_back({addString(route->second.first), route->second.second, {0, 0, 0}});
+                }
+                uint32_t head = addString(trip.headsign);
+                auto key = std::make_tuple(ri->second, svc->second, head);
+                auto pi = patternIndex.find(key);
+                if (pi == patternIndex.end()) {
+                    if (patterns.size() == 0xFFFF) return fail("more than 65535 route/service/headsign patterns");
+                    pi = patternIndex.emplace(key, (uint16_t)patterns.size()).first;
+                    patterns.push_back({ri->second, svc->second, head});
+                }
+                uint32_t t = (uint32_t)ev.first;
+                // New block every TT_BLOCK events, or early when the gap won't fit a u16 delta
+                if (rec.eventCount == 0 || inBlock == TT_BLOCK || t - prev > 0xFFFF) {
+                    blocks.push_back({t, (uint32_t)events.size()});
+                    rec.blockCount++;
+                    inBlock = 0;
+                    prev = t;
+                }
+                events.push_back({(uint16_t)(t - prev), pi->second});
+                prev = t;
+                inBlock++;
+                rec.eventCount++;
+            }
+            stops.push_back(rec);
+        }
+        if (stops.size() > 0xFFFF || routes.size() > 0xFFFF || serviceRows.size() > 0xFFFF) return fail("too many stops, routes or services");
+
+        uint32_t rowBytes = (_opt.dayCount + 7) / 8;
+        std::vector<uint8_t> calendar(serviceRows.size() * rowBytes, 0);
+        for (size_t s = 0; s < serviceRows.size(); s++)
+            for (int d = 0; d < _opt.dayCount; d++)
+                if ((*serviceRows[s])[d]) calendar[s * rowBytes + d / 8] |= (uint8_t)(1u << (d & 7));
+
+        TtHeader h;
+        memset(&h, 0, sizeof(h));
+        h.magic = TT_MAGIC;
+        h.version = TT_VERSION;
+        h.headerSize = sizeof(TtHeader);
+        h.firstDay = (uint32_t)_opt.firstDay;
+        h.dayCount = (uint16_t)_opt.dayCount;
+        h.stopCount = (uint16_t)stops.size();
+        h.routeCount = (uint16_t)routes.size();
+        h.patternCount = (uint16_t)patterns.size();
+        h.serviceCount = (uint16_t)serviceRows.size();
+        h.blockSize = TT_BLOCK;
+
+        image.assign(sizeof(TtHeader), 0);
+        h.stopsOff = append(image, stops);
+        h.routesOff = append(image, routes);
+        h.patternsOff = append(image, patterns);
+        h.calendarOff = append(image, calendar);
+        h.blocksOff = append(image, blocks);
+        h.eventsOff = append(image, events);
+        h.stringsOff = append(image, _stringData);
+        while (image.size() % 4) image.push_back(0);
+        h.totalSize = (uint32_t)image.size();
+        h.crc = ttCrc32(image.data() + sizeof(TtHeader), image.size() - sizeof(TtHeader));
+        memcpy(image.data(), &h, sizeof(h));
+
+        _stats.stops = stops.size();
+        _stats.routes = routes.size();
+        _stats.patterns = patterns.size();
+        _stats.services = serviceRows.size();
+        _stats.events = events.size();
+        _stats.blocks = blocks.size();
+        _stats.bytes = image.size();
+        return true;
+    }
+
+    GtfsOptions _opt;
+    std::string _error;
+    GtfsStats _stats;
+    std::vector<Stop> _stops;
+    std::map<std::string, size_t> _stopIndex;
+    std::unordered_map<std::string, uint32_t> _tripIndex;
+    std::vector<std::string> _tripIds;
+    std::vector<Trip> _trips;
+    std::map<std::string, std::pair<std::string, uint8_t>> _routes;
+    std::map<std::string, std::vector<bool>> _services;
+    std::map<std::string, uint32_t> _strings;
+    std::vector<char> _stringData;
+};
+
+#endif // GTFS_COMPILE_HPP
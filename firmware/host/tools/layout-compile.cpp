@@ -0,0 +1,75 @@
+/**
+ * Compile the dashboard layout into constexpr tables
+ *
+ * Usage: ./layout-compile -o ../include/dashboard_layout.hpp ../layout/dashboard.layout
+ *        ./layout-compile --check ../include/dashboard_layout.hpp ../layout/dashboard.layout
+ *
+ * The generated header is checked in, so PlatformIO builds need nothing
+ * from the host. The "layout" target of the host build runs the first
+ * form; --check exits 1 if the checked-in header is out of date.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "layout_compile.hpp"
+
+#include <stdio.h>
+#include <fstream>
+#include <iterator>
+
+static int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s -o HEADER LAYOUT\n"
+            "       %s --check HEADER LAYOUT\n",
+            argv0, argv0);
+    return 2;
+}
+
+static bool readFile(const char* path, std::string& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { fprintf(stderr, "%s: can't read\n", path); return false; }
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* out = nullptr;
+    const char* check = nullptr;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-o" && i + 1 < argc) out = argv[++i];
+        else if (a == "--check" && i + 1 < argc) check = argv[++i];
+        else if (a[0] != '-') files.push_back(argv[i]);
+        else return usage(argv[0]);
+    }
+    if (files.size() != 1 || !out == !check) return usage(argv[0]);
+
+    std::string text, err;
+    if (!readFile(files[0], text)) return 1;
+    LayoutSource src;
+    if (!layoutParseSource(text, src, err)) {
+        fprintf(stderr, "%s: %s\n", files[0], err.c_str());
+        return 1;
+    }
+    std::string header = layoutEmitHeader(src);
+
+    if (check) {
+        std::string have;
+        if (!readFile(check, have)) return 1;
+        if (have != header) {
+            fprintf(stderr, "%s is out of date with %s: regenerate it (cmake --build host/build --target layout)\n", check, files[0]);
+            return 1;
+        }
+        return 0;
+    }
+    std::ofstream f(out, std::ios::binary);
+    f << header;
+    if (!f) { fprintf(stderr, "%s: can't write\n", out); return 1; }
+    size_t zones = 0;
+    for (const LayoutSrcScreen& s : src.screens) zones += s.zones.size();
+    printf("%s: version %u, %zu screens, %zu zones, CRC %08x\n", out, (unsigned)src.version, src.screens.size(), zones,
+           (unsigned)src.crc);
+    return 0;
+}
@@ -0,0 +1,327 @@
+/**
+ * Dashboard layout compiler (see include/layout.hpp)
+ *
+ * layoutParseSource() reads firmware/layout/dashboard.layout and checks
+ * that every field fits its zone and every zone its screen.
+ * layoutEmitHeader() writes it out as include/dashboard_layout.hpp, with
+ * the framebuffer offsets and masks of each rectangle worked out here
+ * rather than on the device. src/services/dashboard-layout.js reads the
+ * same file on the server.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef LAYOUT_COMPILE_HPP
+#define LAYOUT_COMPILE_HPP
+
+#include "layout.hpp"
+#include "timetable.hpp"    // ttCrc32
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+struct LayoutSrcFont {
+    std::string name, css;
+    LayoutCell cell;
+    int cellW, cellH;
+};
+
+struct LayoutSrcField {
+    std::string id;
+    int x, y, w, h;             // relative to the zone
+    int font = 0;
+    int flags = 0;
+    int padX = 0, padY = 0;
+    int repeat = 1, step = 0;
+};
+
+struct LayoutSrcZone {
+    std::string id;
+    int x, y, w, h, priority;
+    bool fillBlack = false;
+    int border = 0;
+    std::vector<LayoutSrcField> fields;
+};
+
+struct LayoutSrcScreen {
+    std::string name;
+    int w, h;
+    std::vector<LayoutSrcZone> zones;
+};
+
+struct LayoutSource {
+    uint32_t version = 0;
+    uint32_t crc = 0;           // of the source text without CRs, as the server computes it
+    std::vector<LayoutSrcFont> fonts;
+    std::vector<LayoutSrcScreen> screens;
+};
+
+/** Split a line into words; "double quoted" words keep their spaces. */
+static inline std::vector<std::string> layoutWords(const std::string& line) {
+    std::vector<std::string> out;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) i++;
+        if (i >= line.size()) break;
+        if (line[i] == '"') {
+            size_t end = line.find('"', i + 1);
+            if (end == std::string::npos) end = line.size();
+            out.push_back(line.substr(i + 1, end - i - 1));
+            i = end + 1;
+        } else {
+            size_t end = line.find_first_of(" \t", i);
+            if (end == std::string::npos) end = line.size();
+            out.push_back(line.substr(i, end - i));
+            i = end;
+        }
+    }
+    return out;
+}
+
+static inline bool layoutIdent(const std::string& s) {
+    if (s.empty() || !(s[0] >= 'a' && s[0] <= 'z')) return false;
+    for (char c : s) if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_')) return false;
+    return true;
+}
+
+static inline bool layoutInts(const std::vector<std::string>& w, size_t from, size_t n, int* out) {
+    if (w.size() < from + n) return false;
+    for (size_t i = 0; i < n; i++) {
+        char* end;
+        long v = strtol(w[from + i].c_str(), &end, 10);
+        if (*end || w[from + i].empty() || v < 0 || v > 4096) return false;
+        out[i] = (int)v;
+    }
+    return true;
+}
+
+/** Parse dashboard.layout; the format is described at the top of that file. */
+static inline bool layoutParseSource(const std::string& text, LayoutSource& out, std::string& err) {
+    out = LayoutSource();
+    std::string clean;
+    for (char c : text) if (c != '\r') clean += c;
+    out.crc = ttCrc32((const uint8_t*)clean.data(), clean.size());
+
+    int lineNo = 0;
+    auto fail = [&](const std::string& why) { err = "line " + std::to_string(lineNo) + ": " + why; return false; };
+    size_t pos = 0;
+    while (pos < clean.size()) {
+        size_t nl = clean.find('\n', pos);
+        if (nl == std::string::npos) nl = clean.size();
+        std::string line = clean.substr(pos, nl - pos);
+        pos = nl + 1;
+        lineNo++;
+        std::vector<std::string> w = layoutWords(line);
+        if (w.empty() || w[0][0] == '#') continue;
+        const std::string& kw = w[0];
+        if (kw == "version") {
+            int v[1];
+            if (!layoutInts(w, 1, 1, v) || !v[0]) return fail("bad version");
+            out.version = (uint32_t)v[0];
+        } else if (kw == "font") {
+            LayoutSrcFont f;
+            if (w.size() != 4 || !layoutIdent(w[1])) return fail("expected \"font NAME CWxCH \\\"CSS font\\\"\"");
+            f.name = w[1];
+            f.css = w[3];
+            if (w[2] == "6x8") f.cell = LAYOUT_CELL_6x8, f.cellW = 6, f.cellH = 8;
+            else if (w[2] == "8x8") f.cell = LAYOUT_CELL_8x8, f.cellW = 8, f.cellH = 8;
+            else if (w[2] == "12x16") f.cell = LAYOUT_CELL_12x16, f.cellW = 12, f.cellH = 16;
+            else return fail("font cell must be 6x8, 8x8 or 12x16");
+            for (const LayoutSrcFont& o : out.fonts) if (o.name == f.name) return fail("duplicate font " + f.name);
+            out.fonts.push_back(f);
+        } else if (kw == "screen") {
+            LayoutSrcScreen s;
+            int v[2];
+            if (w.size() != 4 || !layoutIdent(w[1]) || !layoutInts(w, 2, 2, v) || !v[0] || !v[1]) return fail("expected \"screen NAME W H\"");
+            s.name = w[1]; s.w = v[0]; s.h = v[1];
+            for (const LayoutSrcScreen& o : out.screens) if (o.name == s.name) return fail("duplicate screen " + s.name);
+            out.screens.push_back(s);
+        } else if (kw == "zone") {
+            if (out.screens.empty()) return fail("zone before any screen");
+            LayoutSrcScreen& s = out.screens.back();
+            LayoutSrcZone z;
+            int v[5];
+            if (w.size() < 7 || !layoutIdent(w[1]) || !layoutInts(w, 2, 5, v)) return fail("expected \"zone ID X Y W H PRIORITY\"");
+            z.id = w[1]; z.x = v[0]; z.y = v[1]; z.w = v[2]; z.h = v[3]; z.priority = v[4];
+            for (size_t i = 7; i < w.size(); i++) {
+                if (w[i] == "fill=black") z.fillBlack = true;
+                else if (w[i] == "fill=white") z.fillBlack = false;
+                else if (sscanf(w[i].c_str(), "border=%d", &z.border) == 1 && z.border >= 0 && z.border < 16) {}
+                else return fail("unknown zone option " + w[i]);
+            }
+            if (!z.w || !z.h || z.x + z.w > s.w || z.y + z.h > s.h) return fail("zone " + z.id + " is not inside the screen");
+            if (z.priority > 255) return fail("priority out of range");
+            for (const LayoutSrcZone& o : s.zones) if (o.id == z.id) return fail("duplicate zone " + z.id);
+            s.zones.push_back(z);
+        } else if (kw == "field" || kw == "icon") {
+            if (out.screens.empty() || out.screens.back().zones.empty()) return fail(kw + " before any zone");
+            LayoutSrcZone& z = out.screens.back().zones.back();
+            LayoutSrcField f;
+            int v[4];
+            bool icon = kw == "icon";
+            if (w.size() < (icon ? 6u : 7u) || !layoutIdent(w[1]) || !layoutInts(w, 2, 4, v))
+                return fail(icon ? "expected \"icon ID X Y W H\"" : "expected \"field ID X Y W H FONT\"");
+            f.id = w[1]; f.x = v[0]; f.y = v[1]; f.w = v[2]; f.h = v[3];
+            size_t opt = 6;
+            if (icon) {
+                f.flags = FIELD_ICON;
+            } else {
+                f.font = -1;
+                for (size_t i = 0; i < out.fonts.size(); i++) if (out.fonts[i].name == w[6]) f.font = (int)i;
+                if (f.font < 0) return fail("unknown font " + w[6]);
+                opt = 7;
+            }
+            for (size_t i = opt; i < w.size(); i++) {
+                const std::string& o = w[i];
+                if (o == "align=left") f.flags = (f.flags & ~FIELD_ALIGN_MASK) | FIELD_ALIGN_LEFT;
+                else if (o == "align=center") f.flags = (f.flags & ~FIELD_ALIGN_MASK) | FIELD_ALIGN_CENTER;
+                else if (o == "align=right") f.flags = (f.flags & ~FIELD_ALIGN_MASK) | FIELD_ALIGN_RIGHT;
+                else if (o == "ink=white") f.flags |= FIELD_INK_WHITE;
+                else if (o == "ink=black") f.flags &= ~FIELD_INK_WHITE;
+                else if (o == "fill=black") f.flags = (f.flags & ~FIELD_FILL_WHITE) | FIELD_FILL;
+                else if (o == "fill=white") f.flags |= FIELD_FILL | FIELD_FILL_WHITE;
+                else if (sscanf(o.c_str(), "pad=%d,%d", &f.padX, &f.padY) == 2 && f.padX >= 0 && f.padY >= 0) {}
+                else if (sscanf(o.c_str(), "repeat=%d", &f.repeat) == 1 && f.repeat >= 1 && f.repeat <= 32) {}
+                else if (sscanf(o.c_str(), "step=%d", &f.step) == 1 && f.step > 0 && f.step < 256) {}
+                else return fail("unknown " + kw + " option " + o);
+            }
+            if ((f.repeat > 1) != (f.step > 0)) return fail("repeat and step go together");
+            if (!f.w || !f.h || f.x + f.w > z.w || f.y + (f.repeat - 1) * f.step + f.h > z.h)
+                return fail(kw + " " + z.id + "." + f.id + " is not inside its zone");
+            if (2 * f.padX >= f.w || f.padY >= f.h) return fail(kw + " " + z.id + "." + f.id + ": padding leaves no room");
+            for (const LayoutSrcField& o : z.fields) if (o.id == f.id) return fail("duplicate field " + z.id + "." + f.id);
+            z.fields.push_back(f);
+        } else {
+            return fail("unknown line");
+        }
+    }
+    if (!out.version) { err = "no version line"; return false; }
+    if (out.screens.empty()) { err = "no screens"; return false; }
+    return true;
+}
+
+/** Bytes of a pitch-wide row covered by the rectangle at x, y of width w. */
+static inline LayoutSpan layoutSpan(int pitch, int x, int y, int w) {
+    LayoutSpan s;
+    int last = x + w - 1;
+    s.offset = (uint16_t)(y * pitch + x / 8);
+    s.shift = (uint8_t)(x & 7);
+    s.bytes = (uint8_t)(last / 8 - x / 8 + 1);
+    s.firstMask = (uint8_t)(0xFF >> (x & 7));
+    s.lastMask = (uint8_t)(0xFF << (7 - (last & 7)));
+    if (s.bytes == 1) s.firstMask = s.lastMask = (uint8_t)(s.firstMask & s.lastMask);
+    return s;
+}
+
+static inline std::string layoutUpper(std::string s) {
+    for (char& c : s) if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+    return s;
+}
+
+static inline std::string layoutFormat(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline std::string layoutFormat(const char* fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return buf;
+}
+
+static inline std::string layoutSpanInit(const LayoutSpan& s) {
+    return layoutFormat("{%u, %u, %u, 0x%02X, 0x%02X}", s.offset, s.shift, s.bytes, s.firstMask, s.lastMask);
+}
+
+static inline std::string layoutFlagNames(int flags) {
+    static const char* const align[] = {"FIELD_ALIGN_LEFT", "FIELD_ALIGN_CENTER", "FIELD_ALIGN_RIGHT"};
+    std::string s = align[flags & FIELD_ALIGN_MASK];
+    if (flags & FIELD_INK_WHITE) s += " | FIELD_INK_WHITE";
+    if (flags & FIELD_FILL) s += " | FIELD_FILL";
+    if (flags & FIELD_FILL_WHITE) s += " | FIELD_FILL_WHITE";
+    if (flags & FIELD_ICON) s += " | FIELD_ICON";
+    return s;
+}
+
+/** The generated header, byte for byte what is checked in as include/dashboard_layout.hpp. */
+static inline std::string layoutEmitHeader(const LayoutSource& src) {
+    std::string o;
+    o += "/**\n"
+         " * Dashboard layout tables: GENERATED from layout/dashboard.layout, do not edit\n"
+         " *\n"
+         " * Regenerate with: cmake --build host/build --target layout\n"
+         " * Types and the blits that use these tables are in layout.hpp.\n"
+         " *\n"
+         " * Copyright (c) 2026 Angus Bergman\n"
+         " * Licensed under CC BY-NC 4.0\n"
+         " */\n\n"
+         "#ifndef DASHBOARD_LAYOUT_HPP\n#define DASHBOARD_LAYOUT_HPP\n\n"
+         "#include \"layout.hpp\"\n#include \"zone_protocol.hpp\"\n\n";
+    o += layoutFormat("#define DASHBOARD_LAYOUT_VERSION %u\n", (unsigned)src.version);
+    o += layoutFormat("#define DASHBOARD_LAYOUT_CRC 0x%08Xu\n", (unsigned)src.crc);
+    o += layoutFormat("#define DASHBOARD_LAYOUT_TAG \"%08x\"    // sent as X-Layout; the server warns when its file differs\n\n",
+                      (unsigned)src.crc);
+
+    o += "enum : uint8_t {\n";
+    for (const LayoutSrcFont& f : src.fonts) o += "    LAYOUT_FONT_" + layoutUpper(f.name) + ",\n";
+    o += "};\n\n";
+    static const char* const cells[] = {"LAYOUT_CELL_6x8", "LAYOUT_CELL_8x8", "LAYOUT_CELL_12x16"};
+    o += "static constexpr LayoutFont LAYOUT_FONTS[] = {\n";
+    for (const LayoutSrcFont& f : src.fonts)
+        o += layoutFormat("    {\"%s\", %s, %d, %d},\n", f.name.c_str(), cells[f.cell], f.cellW, f.cellH);
+    o += "};\n";
+
+    for (const LayoutSrcScreen& s : src.screens) {
+        std::string P = layoutUpper(s.name);
+        int pitch = (s.w + 7) / 8;
+        o += layoutFormat("\n// ---- screen %s ----\n\n", s.name.c_str());
+        o += layoutFormat("#define %s_W %d\n#define %s_H %d\n#define %s_PITCH %d\n\n", P.c_str(), s.w, P.c_str(), s.h, P.c_str(), pitch);
+
+        o += "enum : uint8_t {\n";
+        for (const LayoutSrcZone& z : s.zones) o += "    " + P + "_" + layoutUpper(z.id) + ",\n";
+        o += "};\n";
+        o += "enum : uint8_t {\n";
+        for (const LayoutSrcZone& z : s.zones)
+            for (const LayoutSrcField& f : z.fields) o += "    " + P + "_" + layoutUpper(z.id) + "_" + layoutUpper(f.id) + ",\n";
+        o += "};\n\n";
+
+        o += layoutFormat("static constexpr ZoneDef %s_ZONES[] = {\n", P.c_str());
+        for (const LayoutSrcZone& z : s.zones)
+            o += layoutFormat("    {\"%s\", %d, %d, %d, %d, %d},\n", z.id.c_str(), z.x, z.y, z.w, z.h, z.priority);
+        o += "};\n";
+        o += layoutFormat("static constexpr int %s_ZONE_COUNT = %zu;\n\n", P.c_str(), s.zones.size());
+
+        o += "// span, w, h, BMP row bytes, black background, border\n";
+        o += layoutFormat("static constexpr LayoutZone %s_LAYOUT[] = {\n", P.c_str());
+        for (const LayoutSrcZone& z : s.zones)
+            o += layoutFormat("    {%s, %d, %d, %d, %d, %d},\n", layoutSpanInit(layoutSpan(pitch, z.x, z.y, z.w)).c_str(), z.w, z.h,
+                              (z.w + 31) / 32 * 4, z.fillBlack ? 1 : 0, z.border);
+        o += "};\n\n";
+
+        size_t nFields = 0;
+        o += "// zone, id, x, y, w, h, text x, text y, span, font, flags, repeat, step\n";
+        o += layoutFormat("static constexpr LayoutField %s_FIELDS[] = {\n", P.c_str());
+        for (size_t zi = 0; zi < s.zones.size(); zi++) {
+            const LayoutSrcZone& z = s.zones[zi];
+            for (const LayoutSrcField& f : z.fields) {
+                int x = z.x + f.x, y = z.y + f.y;
+                o += layoutFormat("    {%s_%s, \"%s\", %d, %d, %d, %d, %d, %d, %s, %s, %s, %d, %d},\n", P.c_str(),
+                                  layoutUpper(z.id).c_str(), f.id.c_str(), x, y, f.w, f.h, x + f.padX, y + f.padY,
+                                  layoutSpanInit(layoutSpan(pitch, x, y, f.w)).c_str(),
+                                  (f.flags & FIELD_ICON) ? "0" : ("LAYOUT_FONT_" + layoutUpper(src.fonts[f.font].name)).c_str(),
+                                  layoutFlagNames(f.flags).c_str(), f.repeat, f.step);
+                nFields++;
+            }
+        }
+        o += "};\n";
+        o += layoutFormat("static constexpr int %s_FIELD_COUNT = %zu;\n", P.c_str(), nFields);
+    }
+    o += "\n#endif // DASHBOARD_LAYOUT_HPP\n";
+    return o;
+}
+
+#endif // LAYOUT_COMPILE_HPP
@@ -0,0 +1,120 @@
+/**
+ * Decode deferred log records from a captured serial log
+ *
+ * Ordinary lines pass through unchanged. "#L <base64>" lines are decoded
+ * (see include/trmnl_log.hpp) and their format strings are read from the
+ * firmware ELF that produced them, so the ELF must match the flashed build.
+ *
+ * Usage: ./log-decode .pio/build/trmnl/firmware.elf [serial.log]
+ *        pio device monitor | ./log-decode .pio/build/trmnl/firmware.elf
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "log_format.hpp"
+
+#include <elf.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct Segment { uint32_t addr; std::vector<uint8_t> data; };
+
+static bool loadElf(const char* path, std::vector<Segment>& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    std::vector<uint8_t> elf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (elf.size() < sizeof(Elf32_Ehdr) || memcmp(elf.data(), ELFMAG, SELFMAG) != 0 || elf[EI_CLASS] != ELFCLASS32) return false;
+    Elf32_Ehdr eh;
+    memcpy(&eh, elf.data(), sizeof(eh));
+    for (int i = 0; i < eh.e_shnum; i++) {
+        size_t off = eh.e_shoff + (size_t)i * eh.e_shentsize;
+        if (off + sizeof(Elf32_Shdr) > elf.size()) return false;
+        Elf32_Shdr sh;
+        memcpy(&sh, elf.data() + off, sizeof(sh));
+        // Format strings live in .rodata (flash DROM); skip .bss and debug sections
+        if (sh.sh_type != SHT_PROGBITS || !(sh.sh_flags & SHF_ALLOC) || sh.sh_size == 0) continue;
+        if ((size_t)sh.sh_offset + sh.sh_size > elf.size()) continue;
+        out.push_back({sh.sh_addr, std::vector<uint8_t>(elf.begin() + sh.sh_offset, elf.begin() + sh.sh_offset + sh.sh_size)});
+    }
+    return !out.empty();
+}
+
+static const char* lookup(const std::vector<Segment>& segs, uint32_t addr) {
+    for (const Segment& s : segs) {
+        if (addr < s.addr || addr - s.addr >= s.data.size()) continue;
+        const char* p = (const char*)s.data.data() + (addr - s.addr);
+        if (!memchr(p, '\0', s.data.size() - (addr - s.addr))) return nullptr;
+        return p;
+    }
+    return nullptr;
+}
+
+static bool base64Decode(const char* s, std::vector<uint8_t>& out) {
+    out.clear();
+    uint32_t v = 0;
+    int bits = 0;
+    for (; *s && *s != '\r' && *s != '\n'; s++) {
+        int c = *s;
+        int d = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 : c >= '0' && c <= '9' ? c - '0' + 52 :
+                c == '+' ? 62 : c == '/' ? 63 : c == '=' ? -2 : -1;
+        if (d == -2) break;
+        if (d < 0) return false;
+        v = v << 6 | d;
+        bits += 6;
+        if (bits >= 8) { bits -= 8; out.push_back((v >> bits) & 0xFF); }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s firmware.elf [serial.log]\n", argv[0]);
+        return 2;
+    }
+    std::vector<Segment> segs;
+    if (!loadElf(argv[1], segs)) {
+        fprintf(stderr, "%s: not a readable ELF32 image\n", argv[1]);
+        return 2;
+    }
+    std::ifstream file;
+    if (argc > 2) {
+        file.open(argv[2]);
+        if (!file) { fprintf(stderr, "%s: cannot open\n", argv[2]); return 2; }
+    }
+    std::istream& in = argc > 2 ? file : std::cin;
+
+    std::string line;
+    std::vector<uint8_t> raw;
+    LogRecord rec;
+    int bad = 0;
+    while (std::getline(in, line)) {
+        // Serial monitors may prefix timestamps; look for the marker anywhere
+        size_t at = line.find("#L ");
+        if (at == std::string::npos || line.compare(at + 3, 8, "dropped ") == 0) {
+            std::cout << line << '\n';
+            continue;
+        }
+        if (!base64Decode(line.c_str() + at + 3, raw) || !logParseRecord(raw.data(), raw.size(), rec)) {
+            std::cout << line << "  [undecodable]\n";
+            bad++;
+            continue;
+        }
+        const char* fmt = lookup(segs, rec.fmt);
+        char head[32];
+        snprintf(head, sizeof(head), "[%6lu.%06lu] %c ", (unsigned long)(rec.micros / 1000000), (unsigned long)(rec.micros % 1000000),
+                 rec.level <= 5 ? "-EWIDV"[rec.level] : '?');
+        if (!fmt) {
+            std::cout << head << "<unknown format @0x" << std::hex << rec.fmt << std::dec << ", wrong ELF?>\n";
+            bad++;
+            continue;
+        }
+        std::cout << head << logFormat(fmt, rec.args) << '\n';
+    }
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * Host-side decoding of deferred log records (see include/trmnl_log.hpp)
+ *
+ * Parses a binary record and re-applies its format string with printf
+ * semantics. Length modifiers in the format are ignored: every argument
+ * carries its own type tag, so 32/64-bit differences between the ESP32 and
+ * the host don't matter.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct LogArg {
+    char tag;
+    int64_t i;
+    uint64_t u;
+    double f;
+    std::string s;
+};
+
+struct LogRecord {
+    uint8_t level;
+    uint32_t micros;
+    uint32_t fmt;
+    std::vector<LogArg> args;
+};
+
+inline bool logParseRecord(const uint8_t* rec, size_t len, LogRecord& out) {
+    if (len < 10 || rec[0] != len) return false;
+    out.level = rec[1];
+    memcpy(&out.micros, rec + 2, 4);
+    memcpy(&out.fmt, rec + 6, 4);
+    out.args.clear();
+    size_t p = 10;
+    while (p < len) {
+        LogArg a = {(char)rec[p++], 0, 0, 0.0, std::string()};
+        size_t need = a.tag == 'i' || a.tag == 'u' ? 4 : a.tag == 'I' || a.tag == 'U' || a.tag == 'f' ? 8 : a.tag == 's' ? 1 : 0;
+        if (need == 0 || p + need > len) return false;
+        if (a.tag == 'i') { int32_t v; memcpy(&v, rec + p, 4); a.i = v; a.u = (uint32_t)v; a.f = v; }
+        else if (a.tag == 'u') { uint32_t v; memcpy(&v, rec + p, 4); a.u = v; a.i = (int32_t)v; a.f = v; }
+        else if (a.tag == 'I') { memcpy(&a.i, rec + p, 8); a.u = (uint64_t)a.i; a.f = (double)a.i; }
+        else if (a.tag == 'U') { memcpy(&a.u, rec + p, 8); a.i = (int64_t)a.u; a.f = (double)a.u; }
+        else if (a.tag == 'f') { memcpy(&a.f, rec + p, 8); a.i = (int64_t)a.f; a.u = (uint64_t)a.i; }
+        else {
+            size_t n = rec[p];
+            if (p + 1 + n > len) return false;
+            a.s.assign((const char*)rec + p + 1, n);
+            need = 1 + n;
+        }
+        p += need;
+        out.args.push_back(a);
+    }
+    return true;
+}
+
+template <class T>
+inline int logSnprintf(char* buf, size_t cap, const std::string& spec, const std::vector<int>& stars, T v) {
+    switch (stars.size()) {
+    case 0: return snprintf(buf, cap, spec.c_str(), v);
+    case 1: return snprintf(buf, cap, spec.c_str(), stars[0], v);
+    default: return snprintf(buf, cap, spec.c_str(), stars[0], stars[1], v);
+    }
+}
+
+/** Apply a format string to decoded arguments. Missing arguments print as "?". */
+inline std::string logFormat(const char* fmt, const std::vector<LogArg>& args) {
+    std::string out;
+    size_t next = 0;
+    char buf[512];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    for (const char* p = fmt; *p; p++) {
+        if (*p != '%') { out += *p; continue; }
+        if (p[1] == '%') { out += '%'; p++; continue; }
+        std::string spec = "%";
+        std::vector<int> stars;
+        const char* q = p + 1;
+        while (*q && strchr("-+ #0", *q)) spec += *q++;
+        if (*q == '*') { spec += *q++; stars.push_back(next < args.size() ? (int)args[next++].i : 0); }
+        while (*q >= '0' && *q <= '9') spec += *q++;
+        if (*q == '.') {
+            spec += *q++;
+            if (*q == '*') { spec += *q++; stars.push_back(next < args.size() ? (int)args[next++].i : 0); }
+            while (*q >= '0' && *q <= '9') spec += *q++;
+        }
+        while (*q && strchr("hlLqjzt", *q)) q++;
+        char conv = *q;
+        if (!conv) break;
+        p = q;
+        if (next >= args.size()) { out += '?'; continue; }
+        const LogArg& a = args[next++];
+        switch (conv) {
+        case 'd': case 'i': logSnprintf(buf, sizeof(buf), spec + "lld", stars, (long long)a.i); break;
+        case 'u': case 'o': case 'x': case 'X':
+            logSnprintf(buf, sizeof(buf), spec + "ll" + conv, stars, (unsigned long long)a.u); break;
+        case 'c': logSnprintf(buf, sizeof(buf), spec + "c", stars, (int)a.i); break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            logSnprintf(buf, sizeof(buf), spec + conv, stars, a.f); break;
+        case 's': logSnprintf(buf, sizeof(buf), spec + "s", stars, a.tag == 's' ? a.s.c_str() : "?"); break;
+        case 'p': snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)a.u); break;
+        default: snprintf(buf, sizeof(buf), "%%%c", conv); break;
+        }
+        out += buf;
+    }
+#pragma GCC diagnostic pop
+    return out;
+}
+
+#endif // LOG_FORMAT_HPP
@@ -0,0 +1,249 @@
+/**
+ * Just enough mDNS (RFC 6762) to advertise one service and find it again
+ *
+ * edge-relay answers queries for _ptv-trmnl._tcp.local with a PTR to its
+ * instance plus the SRV (port and host), TXT and A records a device needs
+ * to connect, all in one packet, so an ESPmDNS queryService() resolves it
+ * from a single response. Names are written uncompressed; responses are
+ * a few hundred bytes. Queries and responses are parsed with compression
+ * pointers followed, so edge-relay --browse can list the relays on a LAN
+ * (and the tests can read back what the responder says).
+ *
+ *   MdnsService s;
+ *   s.instance = "shopfront"; s.service = "_ptv-trmnl._tcp.local";
+ *   s.host = "shopfront.local"; s.addr = ...; s.port = 8080;
+ *   s.txt.push_back("upstream=ptvtrmnl.vercel.app");
+ *   std::vector<MdnsQuestion> qs;
+ *   if (mdnsParseQuestions(buf, n, qs) && mdnsWanted(s, qs)) send(mdnsResponse(s));
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef MDNS_SERVICE_HPP
+#define MDNS_SERVICE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+#include <vector>
+
+#define MDNS_PORT 5353
+#define MDNS_GROUP "224.0.0.251"
+
+enum MdnsType : uint16_t { MDNS_A = 1, MDNS_PTR = 12, MDNS_TXT = 16, MDNS_SRV = 33, MDNS_ANY = 255 };
+
+struct MdnsService {
+    std::string instance;          // "shopfront": the instance is <instance>.<service>
+    std::string service;           // "_ptv-trmnl._tcp.local"
+    std::string host;              // "shopfront.local"
+    uint32_t addr = 0;             // IPv4, network byte order
+    uint16_t port = 0;
+    std::vector<std::string> txt;  // "key=value"
+    uint32_t ttl = 120;
+
+    std::string fullName() const { return instance + "." + service; }
+};
+
+struct MdnsQuestion {
+    std::string name;
+    uint16_t type;
+    bool unicast;                  // QU bit: the asker wants the answer sent to it directly
+};
+
+// A record from a response, with the fields its type uses filled in
+struct MdnsRecord {
+    std::string name;
+    uint16_t type = 0;
+    uint32_t ttl = 0;
+    std::string target;            // PTR: the instance; SRV: the host
+    uint16_t port = 0;             // SRV
+    uint32_t addr = 0;             // A, network byte order
+    std::vector<std::string> txt;  // TXT
+};
+
+static inline void mdnsPut16(std::vector<uint8_t>& out, uint16_t v) { out.push_back((uint8_t)(v >> 8)); out.push_back((uint8_t)v); }
+static inline void mdnsPut32(std::vector<uint8_t>& out, uint32_t v) { mdnsPut16(out, (uint16_t)(v >> 16)); mdnsPut16(out, (uint16_t)v); }
+static inline uint16_t mdnsGet16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static inline uint32_t mdnsGet32(const uint8_t* p) { return (uint32_t)mdnsGet16(p) << 16 | mdnsGet16(p + 2); }
+
+/** A dotted name as labels. The instance label may hold dots of its own, so it is written whole first. */
+static inline void mdnsPutName(std::vector<uint8_t>& out, const std::string& name, size_t firstLabel = 0) {
+    size_t at = 0;
+    if (firstLabel) {
+        out.push_back((uint8_t)firstLabel);
+        out.insert(out.end(), name.begin(), name.begin() + firstLabel);
+        at = firstLabel + 1;
+    }
+    while (at < name.size()) {
+        size_t dot = name.find('.', at);
+        if (dot == std::string::npos) dot = name.size();
+        size_t len = dot - at < 63 ? dot - at : 63;
+        out.push_back((uint8_t)len);
+        out.insert(out.end(), name.begin() + at, name.begin() + at + len);
+        at = dot + 1;
+    }
+    out.push_back(0);
+}
+
+/** Read a name at p[*at], following compression pointers. Advances *at past it. */
+static inline bool mdnsReadName(const uint8_t* p, size_t n, size_t* at, std::string& name) {
+    name.clear();
+    size_t pos = *at;
+    bool jumped = false;
+    for (int hops = 0; hops < 16;) {
+        if (pos >= n) return false;
+        uint8_t len = p[pos];
+        if (len == 0) { if (!jumped) *at = pos + 1; return true; }
+        if ((len & 0xC0) == 0xC0) {
+            if (pos + 1 >= n) return false;
+            if (!jumped) *at = pos + 2;
+            jumped = true;
+            pos = (size_t)(len & 0x3F) << 8 | p[pos + 1];
+            hops++;
+            continue;
+        }
+        if (len > 63 || pos + 1 + len > n) return false;
+        if (!name.empty()) name += '.';
+        name.append((const char*)p + pos + 1, len);
+        pos += 1 + len;
+    }
+    return false;
+}
+
+/** The questions of a query. False for a response or a malformed packet. */
+static inline bool mdnsParseQuestions(const uint8_t* p, size_t n, std::vector<MdnsQuestion>& out) {
+    out.clear();
+    if (n < 12 || (p[2] & 0x80)) return false;
+    size_t at = 12;
+    for (int i = 0, qd = mdnsGet16(p + 4); i < qd; i++) {
+        MdnsQuestion q;
+        if (!mdnsReadName(p, n, &at, q.name) || at + 4 > n) return false;
+        q.type = mdnsGet16(p + at);
+        q.unicast = (p[at + 2] & 0x80) != 0;
+        at += 4;
+        out.push_back(q);
+    }
+    return true;
+}
+
+/** True if any question is for the service, the instance or its host. unicast is set if one asked for QU. */
+static inline bool mdnsWanted(const MdnsService& s, const std::vector<MdnsQuestion>& qs, bool* unicast = nullptr) {
+    bool wanted = false;
+    for (const MdnsQuestion& q : qs) {
+        bool any = q.type == MDNS_ANY;
+        bool hit = (strcasecmp(q.name.c_str(), s.service.c_str()) == 0 && (any || q.type == MDNS_PTR)) ||
+                   (strcasecmp(q.name.c_str(), s.fullName().c_str()) == 0 && (any || q.type == MDNS_SRV || q.type == MDNS_TXT)) ||
+                   (strcasecmp(q.name.c_str(), s.host.c_str()) == 0 && (any || q.type == MDNS_A));
+        if (hit && unicast && q.unicast) *unicast = true;
+        wanted |= hit;
+    }
+    return wanted;
+}
+
+/**
+ * The whole answer in one packet: PTR, then SRV, TXT and A as additional
+ * records. id is 0 for multicast, the query's id for a legacy unicast reply.
+ * ttl 0 says goodbye.
+ */
+static inline std::vector<uint8_t> mdnsResponse(const MdnsService& s, uint16_t id = 0, bool goodbye = false) {
+    std::vector<uint8_t> out;
+    uint32_t ttl = goodbye ? 0 : s.ttl;
+    mdnsPut16(out, id);
+    mdnsPut16(out, 0x8400);                  // response, authoritative
+    mdnsPut16(out, 0); mdnsPut16(out, 1);    // no questions, one answer
+    mdnsPut16(out, 0); mdnsPut16(out, 3);    // no authority, three additional
+    std::string full = s.fullName();
+    auto record = [&](const std::string& name, size_t firstLabel, uint16_t type, bool unique) {
+        mdnsPutName(out, name, firstLabel);
+        mdnsPut16(out, type);
+        mdnsPut16(out, (uint16_t)(unique ? 0x8001 : 0x0001));   // cache-flush for records only we own
+        mdnsPut32(out, ttl);
+    };
+    auto rdata = [&](size_t start) { size_t len = out.size() - start - 2; out[start] = (uint8_t)(len >> 8); out[start + 1] = (uint8_t)len; };
+
+    record(s.service, 0, MDNS_PTR, false);
+    size_t at = out.size(); mdnsPut16(out, 0);
+    mdnsPutName(out, full, s.instance.size());
+    rdata(at);
+
+    record(full, s.instance.size(), MDNS_SRV, true);
+    at = out.size(); mdnsPut16(out, 0);
+    mdnsPut16(out, 0); mdnsPut16(out, 0); mdnsPut16(out, s.port);   // priority, weight, port
+    mdnsPutName(out, s.host);
+    rdata(at);
+
+    record(full, s.instance.size(), MDNS_TXT, true);
+    at = out.size(); mdnsPut16(out, 0);
+    if (s.txt.empty()) out.push_back(0);
+    for (const std::string& t : s.txt) {
+        size_t len = t.size() < 255 ? t.size() : 255;
+        out.push_back((uint8_t)len);
+        out.insert(out.end(), t.begin(), t.begin() + len);
+    }
+    rdata(at);
+
+    record(s.host, 0, MDNS_A, true);
+    mdnsPut16(out, 4);
+    const uint8_t* a = (const uint8_t*)&s.addr;
+    out.insert(out.end(), a, a + 4);
+    return out;
+}
+
+/** A one-question PTR query for service; unicast sets QU. */
+static inline std::vector<uint8_t> mdnsQuery(const std::string& service, uint16_t id = 0, bool unicast = false) {
+    std::vector<uint8_t> out;
+    mdnsPut16(out, id);
+    mdnsPut16(out, 0);
+    mdnsPut16(out, 1); mdnsPut16(out, 0); mdnsPut16(out, 0); mdnsPut16(out, 0);
+    mdnsPutName(out, service);
+    mdnsPut16(out, MDNS_PTR);
+    mdnsPut16(out, (uint16_t)(unicast ? 0x8001 : 0x0001));
+    return out;
+}
+
+/** Every record of a response (answers, authority and additional). False for a query or a malformed packet. */
+static inline bool mdnsParseRecords(const uint8_t* p, size_t n, std::vector<MdnsRecord>& out) {
+    out.clear();
+    if (n < 12 || !(p[2] & 0x80)) return false;
+    size_t at = 12;
+    std::string skip;
+    for (int i = 0, qd = mdnsGet16(p + 4); i < qd; i++) {
+        if (!mdnsReadName(p, n, &at, skip) || at + 4 > n) return false;
+        at += 4;
+    }
+    int records = mdnsGet16(p + 6) + mdnsGet16(p + 8) + mdnsGet16(p + 10);
+    for (int i = 0; i < records; i++) {
+        MdnsRecord r;
+        if (!mdnsReadName(p, n, &at, r.name) || at + 10 > n) return false;
+        r.type = mdnsGet16(p + at);
+        r.ttl = mdnsGet32(p + at + 4);
+        size_t len = mdnsGet16(p + at + 8);
+        at += 10;
+        if (at + len > n) return false;
+        size_t data = at;
+        if (r.type == MDNS_PTR) {
+            if (!mdnsReadName(p, n, &data, r.target)) return false;
+        } else if (r.type == MDNS_SRV) {
+            if (len < 7) return false;
+            r.port = mdnsGet16(p + at + 4);
+            data = at + 6;
+            if (!mdnsReadName(p, n, &data, r.target)) return false;
+        } else if (r.type == MDNS_TXT) {
+            for (size_t t = at; t < at + len;) {
+                size_t l = p[t];
+                if (t + 1 + l > at + len) return false;
+                if (l) r.txt.push_back(std::string((const char*)p + t + 1, l));
+                t += 1 + l;
+            }
+        } else if (r.type == MDNS_A && len == 4) {
+            memcpy(&r.addr, p + at, 4);
+        }
+        at += len;
+        out.push_back(r);
+    }
+    return true;
+}
+
+#endif // MDNS_SERVICE_HPP
@@ -0,0 +1,141 @@
+/**
+ * Build (or check) a delta OTA patch between two firmware images
+ *
+ * Usage: ./ota-delta --keygen release.key
+ *        ./ota-delta --key release.key -o patch.bin old.bin new.bin
+ *        ./ota-delta --key release.key --apply old.bin patch.bin -o new.bin
+ *
+ * --keygen writes a new release key (a 32-byte Ed25519 seed: keep it off
+ * the server) and prints its public key for the OTA_SIGNING_KEY build
+ * flag. Devices only accept patches signed with the key they were built
+ * with.
+ *
+ * old.bin is the image the device runs (.pio/build/trmnl/firmware.bin of
+ * that release), new.bin the one it should get. Put the patch at
+ * data/firmware/<old version>.delta on the server; a device on that version
+ * finds it with its daily check. --apply runs the device's patcher over
+ * files, signature check included, so a patch can be checked before it
+ * ships.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "ota_diff.hpp"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+static int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s --keygen KEY\n"
+            "       %s --key KEY -o PATCH OLD NEW\n"
+            "       %s --key KEY --apply OLD PATCH -o NEW\n",
+            argv0, argv0, argv0);
+    return 2;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { fprintf(stderr, "%s: can't read\n", path); return false; }
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    std::ofstream f(path, std::ios::binary);
+    f.write((const char*)data.data(), (std::streamsize)data.size());
+    if (!f) { fprintf(stderr, "%s: can't write\n", path); return false; }
+    return true;
+}
+
+static bool readKey(const char* path, uint8_t seed[ED25519_KEY_SIZE]) {
+    std::vector<uint8_t> key;
+    if (!readFile(path, key)) return false;
+    if (key.size() != ED25519_KEY_SIZE) { fprintf(stderr, "%s: not a release key (%zu bytes)\n", path, key.size()); return false; }
+    memcpy(seed, key.data(), ED25519_KEY_SIZE);
+    return true;
+}
+
+static void printPublicKey(const uint8_t seed[ED25519_KEY_SIZE]) {
+    uint8_t pk[ED25519_KEY_SIZE];
+    Ed25519::publicKey(seed, pk);
+    printf("OTA_SIGNING_KEY=");
+    for (uint8_t b : pk) printf("%02x", b);
+    printf("\n");
+}
+
+static int keygen(const char* path) {
+    std::vector<uint8_t> seed(ED25519_KEY_SIZE);
+    std::ifstream rnd("/dev/urandom", std::ios::binary);
+    if (!rnd.read((char*)seed.data(), (std::streamsize)seed.size())) { fprintf(stderr, "/dev/urandom: can't read\n"); return 1; }
+    if (std::ifstream(path)) { fprintf(stderr, "%s: exists, not overwriting a release key\n", path); return 1; }
+    if (!writeFile(path, seed)) return 1;
+    chmod(path, 0600);
+    printPublicKey(seed.data());
+    return 0;
+}
+
+struct FileTarget {
+    const std::vector<uint8_t>& old;
+    std::vector<uint8_t> out;
+    bool readOld(uint32_t off, uint8_t* buf, size_t n) {
+        if (off + n > old.size()) return false;
+        memcpy(buf, old.data() + off, n);
+        return true;
+    }
+    bool writeNew(const uint8_t* buf, size_t n) { out.insert(out.end(), buf, buf + n); return true; }
+};
+
+static int apply(const uint8_t seed[ED25519_KEY_SIZE], const char* oldPath, const char* patchPath, const char* outPath) {
+    std::vector<uint8_t> old, patch;
+    if (!readFile(oldPath, old) || !readFile(patchPath, patch)) return 1;
+    uint8_t pk[ED25519_KEY_SIZE];
+    Ed25519::publicKey(seed, pk);
+    FileTarget t{old, {}};
+    OtaDeltaPatcher<FileTarget> p(t, pk);
+    OtaDeltaStatus s = p.feed(patch.data(), patch.size());
+    if (s != OTA_DELTA_DONE) {
+        fprintf(stderr, "%s: %s after %u bytes\n", patchPath, s == OTA_DELTA_RUNNING ? "truncated" : otaDeltaStatusName(s), (unsigned)p.written());
+        return 1;
+    }
+    if (!writeFile(outPath, t.out)) return 1;
+    printf("%s: %u bytes, SHA-256 verified\n", outPath, (unsigned)t.out.size());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* out = nullptr;
+    const char* keyPath = nullptr;
+    bool applyMode = false;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--keygen" && i + 1 < argc && argc == 3) return keygen(argv[++i]);
+        if (a == "-o" && i + 1 < argc) out = argv[++i];
+        else if (a == "--key" && i + 1 < argc) keyPath = argv[++i];
+        else if (a == "--apply") applyMode = true;
+        else if (a[0] != '-') files.push_back(argv[i]);
+        else return usage(argv[0]);
+    }
+    if (!out || !keyPath || files.size() != 2) return usage(argv[0]);
+    uint8_t seed[ED25519_KEY_SIZE];
+    if (!readKey(keyPath, seed)) return 1;
+    if (applyMode) return apply(seed, files[0], files[1], out);
+
+    std::vector<uint8_t> oldImg, newImg;
+    if (!readFile(files[0], oldImg) || !readFile(files[1], newImg)) return 1;
+    OtaDiffStats st;
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<uint8_t> patch = otaDiff(oldImg, newImg, seed, &st);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (!writeFile(out, patch)) return 1;
+    printf("%s: %zu bytes for a %zu byte image (%.1f%%), %zu records: %zu diffed (%zu changed), %zu extra; %.0f ms\n",
+           out, patch.size(), newImg.size(), newImg.empty() ? 0.0 : 100.0 * patch.size() / newImg.size(),
+           st.records, st.diffBytes, st.literalBytes, st.extraBytes, ms);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * How a fleet comes back from an outage, per retry policy
+ *
+ * Usage: ./outage-sim [--devices N] [--poll S] [--duration S] [--capacity N] [--queue MS]
+ *                     [--timeout MS] [--outage FROM-TO] [--cold] [--boot-spread MS]
+ *                     [--policy fixed|backoff|jitter|all] [--http] [--seed N]
+ *                     [--timeline S] [script]
+ *
+ * Runs the fleet of outage_sim.hpp on a virtual clock through the network
+ * script (host/replay/net_emulator.hpp has the format); --outage 10m-15m
+ * adds a window where the link is gone, for when that's all the script
+ * would say. --capacity is the polls a second the server answers; --queue
+ * turns away the ones that would wait longer with a 503. --cold makes the
+ * outage a power cut. --policy all runs each policy on the same fleet and
+ * script, one row each. --timeline prints attempts and good answers per
+ * S seconds from just before the outage.
+ *
+ *   outage-sim --devices 2000 --capacity 60 --cold --outage 5m-10m --policy all
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "outage_sim.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--devices N] [--poll S] [--duration S] [--capacity N] [--queue MS]\n"
+            "          [--timeout MS] [--outage FROM-TO] [--cold] [--boot-spread MS]\n"
+            "          [--policy fixed|backoff|jitter|all] [--http] [--seed N] [--timeline S] [script]\n",
+            argv0);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    OutageConfig cfg;
+    const char* scriptPath = nullptr;
+    std::string extra;
+    int policy = OUTAGE_JITTER;
+    bool all = false;
+    uint32_t timelineS = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--devices" && more) cfg.devices = atoi(argv[++i]);
+        else if (a == "--poll" && more) cfg.pollMs = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (a == "--duration" && more) cfg.durationMs = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (a == "--capacity" && more) cfg.capacity = (uint32_t)atol(argv[++i]);
+        else if (a == "--queue" && more) cfg.queueMs = (uint32_t)atol(argv[++i]);
+        else if (a == "--timeout" && more) cfg.timeoutMs = (uint32_t)atol(argv[++i]);
+        else if (a == "--boot-spread" && more) cfg.bootSpreadMs = (uint32_t)atol(argv[++i]);
+        else if (a == "--seed" && more) cfg.seed = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--timeline" && more) timelineS = (uint32_t)atol(argv[++i]);
+        else if (a == "--cold") cfg.cold = true;
+        else if (a == "--http") cfg.tls = false;
+        else if (a == "--outage" && more) {
+            std::string span = argv[++i];
+            size_t dash = span.find('-');
+            if (dash == std::string::npos) return usage(argv[0]);
+            extra += span.substr(0, dash) + " " + span.substr(dash + 1) + " loss=1\n";
+        } else if (a == "--policy" && more) {
+            std::string p = argv[++i];
+            all = p == "all";
+            policy = -1;
+            for (int k = 0; k < OUTAGE_POLICIES; k++) if (p == OUTAGE_POLICY_NAMES[k]) policy = k;
+            if (policy < 0 && !all) return usage(argv[0]);
+        } else if (a[0] != '-' && !scriptPath) scriptPath = argv[i];
+        else return usage(argv[0]);
+    }
+    if (cfg.devices <= 0 || !cfg.pollMs || !cfg.durationMs) return usage(argv[0]);
+
+    // Each policy gets a fresh emulator: the same script and seed, so the same network
+    auto network = [&](NetEmulator& net) {
+        std::string error;
+        if ((scriptPath && !net.load(scriptPath, error)) || !net.parse(extra, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            exit(2);
+        }
+    };
+
+    bool first = true;
+    for (int p = 0; p < OUTAGE_POLICIES; p++) {
+        if (!all && p != policy) continue;
+        cfg.policy = (OutagePolicy)p;
+        NetEmulator net(cfg.seed);
+        network(net);
+        OutageSim sim(cfg, net);
+        sim.run();
+        if (first) sim.print(stdout);
+        else sim.row(stdout);
+        first = false;
+        if (timelineS) { sim.timeline(stdout, timelineS); if (all) printf("\n"); }
+    }
+    return 0;
+}
@@ -0,0 +1,279 @@
+/**
+ * Outage simulator: how a fleet's retries behave when the server comes back
+ *
+ * fleet-sim measures a live server under a fleet's steady load. This is
+ * the other half: a fleet on a virtual clock, a scripted outage between it
+ * and the server (host/replay/net_emulator.hpp) and a model server that
+ * answers `capacity` polls a second from one queue. Each device polls on
+ * its interval and, when a poll fails, waits as its retry policy says:
+ *
+ *   fixed      5 s, as zones-v12 did with delay(5000)
+ *   backoff    2^min(n, 5) s, as the image firmware's loop did
+ *   jitter     RetryPolicy (include/net_retry.hpp): decorrelated jitter
+ *              and a circuit breaker, what both firmwares use now
+ *
+ * A device that has a picture still waits out its poll interval between
+ * tries, as the firmwares do; one that has none (it just booted) tries
+ * again as soon as its policy allows. With cold set the outage is a power
+ * cut: every device is off while it lasts and boots, within a few seconds
+ * of the others, when it ends. That is where a fleet retries in step.
+ *
+ * The server does not shed load unless queueMs is set: a poll that waits
+ * longer than the device's timeout fails at the device but still costs
+ * the server its slot, so a fleet that retries faster than the server can
+ * answer keeps it saturated with work nobody is waiting for.
+ *
+ * Measured, per policy: every poll attempt and how it ended, the busiest
+ * second, time to recovery (outage end to each device's first good poll;
+ * up to one poll interval of it is just the device's own cadence) and
+ * amplification: attempts in the storm, from the outage's start (a power
+ * cut's end) to the last device's recovery, over what steady polling
+ * makes in that time.
+ *
+ *   NetEmulator net(1);
+ *   net.parse("10m 15m loss=1\n", error);
+ *   OutageConfig cfg; cfg.devices = 2000; cfg.capacity = 100;
+ *   OutageSim sim(cfg, net);
+ *   sim.run();
+ *   sim.print(stdout);
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef OUTAGE_SIM_HPP
+#define OUTAGE_SIM_HPP
+
+#include "net_emulator.hpp"
+#include "net_retry.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#define OUTAGE_FIXED_MS 5000      // zones-v12's old delay(5000)
+#define OUTAGE_BACKOFF_MAX 5      // the image firmware's old 2^min(n, 5) s
+#define OUTAGE_SERVICE_MS 50      // an answer from a server with no capacity limit
+
+enum OutagePolicy : uint8_t { OUTAGE_FIXED, OUTAGE_BACKOFF, OUTAGE_JITTER, OUTAGE_POLICIES };
+static const char* const OUTAGE_POLICY_NAMES[] = {"fixed", "backoff", "jitter"};
+
+struct OutageConfig {
+    int devices = 1000;
+    OutagePolicy policy = OUTAGE_JITTER;
+    uint32_t pollMs = 60000;
+    uint32_t durationMs = 1800000;
+    uint32_t capacity = 0;          // polls the server answers a second; 0 = no limit
+    uint32_t queueMs = 0;           // a poll that would queue longer is turned away with a 503; 0 = never
+    uint32_t timeoutMs = 8000;      // the device gives up on an answer (NET_TTFB_MS)
+    bool tls = true;
+    bool cold = false;              // the outage is a power cut: every device boots as it ends
+    uint32_t bootSpreadMs = 3000;   // cold boots (WiFi association) land within this
+    uint64_t seed = 1;
+};
+
+struct OutageReport {
+    bool outage = false;
+    uint64_t outageFromMs = 0, outageToMs = 0;
+    uint64_t attempts = 0, ok = 0, netFailed = 0, shed = 0, timedOut = 0;
+    uint32_t breakerOpens = 0;
+    double steadyPerSec = 0;
+    uint32_t peakPerSec = 0;        // the busiest second of the storm
+    uint64_t stormMs = 0, stormAttempts = 0;
+    double amplification = 0;
+    std::vector<uint32_t> recoveryMs;   // sorted; one per device that recovered
+    int unrecovered = 0;
+    std::vector<uint32_t> perSecAttempts, perSecOk;
+
+    /** Recovery time q (0..1) of the fleet had reached; a device that never recovered counts as never. */
+    uint64_t recovery(double q) const {
+        size_t total = recoveryMs.size() + (size_t)unrecovered;
+        if (!total) return 0;
+        size_t rank = (size_t)(q * (double)total + 0.999999);
+        if (rank == 0) rank = 1;
+        return rank <= recoveryMs.size() ? recoveryMs[rank - 1] : UINT64_MAX;
+    }
+};
+
+class OutageSim {
+public:
+    OutageSim(const OutageConfig& cfg, NetEmulator& net) : _cfg(cfg), _net(net), _rng(cfg.seed) {}
+
+    void run() {
+        OutageReport& r = _report;
+        r = OutageReport();
+        r.outage = _net.faultSpan(r.outageFromMs, r.outageToMs);
+        if (r.outageToMs > _cfg.durationMs) r.outageToMs = _cfg.durationMs;
+        r.steadyPerSec = _cfg.pollMs ? _cfg.devices * 1000.0 / _cfg.pollMs : 0;
+        size_t secs = _cfg.durationMs / 1000 + 1;
+        r.perSecAttempts.assign(secs, 0);
+        r.perSecOk.assign(secs, 0);
+        _serverFree = 0;
+        _queue = Queue();
+
+        // Steady state to begin with: every device has a picture and its own phase in the interval
+        _dev.assign(_cfg.devices, Device());
+        for (int i = 0; i < _cfg.devices; i++) {
+            Device& d = _dev[i];
+            d.retry.seed((uint32_t)_rng.next() | 1);
+            schedule(i, _rng.below(_cfg.pollMs ? _cfg.pollMs : 1));
+        }
+        bool cut = !(_cfg.cold && r.outage);
+        while (!_queue.empty() && _queue.top().first < _cfg.durationMs) {
+            if (!cut && _queue.top().first >= r.outageFromMs) {
+                cut = true;
+                powerCut(r.outageToMs);
+                continue;
+            }
+            Wake w = _queue.top();
+            _queue.pop();
+            if (_dev[w.second].next == w.first) attempt(w.second, w.first);
+        }
+
+        for (const Device& d : _dev) {
+            r.breakerOpens += d.retry.opened();
+            if (r.outage && !d.recovered) r.unrecovered++;
+        }
+        std::sort(r.recoveryMs.begin(), r.recoveryMs.end());
+        if (!r.outage) return;
+        // Powered off, the fleet makes no polls: a power cut's storm starts when the power comes back
+        uint64_t from = _cfg.cold ? r.outageToMs : r.outageFromMs;
+        uint64_t end = r.unrecovered ? _cfg.durationMs : r.outageToMs + r.recoveryMs.back();
+        r.stormMs = end > from ? end - from : 0;
+        for (size_t s = from / 1000; s < secs && s * 1000 < end; s++) {
+            r.stormAttempts += r.perSecAttempts[s];
+            if (r.perSecAttempts[s] > r.peakPerSec) r.peakPerSec = r.perSecAttempts[s];
+        }
+        double steady = r.steadyPerSec * r.stormMs / 1000.0;
+        r.amplification = steady > 0 ? r.stormAttempts / steady : 0;
+    }
+
+    const OutageReport& report() const { return _report; }
+
+    static void header(FILE* out) {
+        fprintf(out, "%-8s %9s %9s %8s %8s %8s %7s %7s %9s %9s %9s %6s %8s\n", "policy", "attempts", "ok", "net", "shed",
+                "timeout", "peak/s", "amplif", "ttr p50", "ttr p99", "ttr max", "never", "breaker");
+    }
+
+    void row(FILE* out) const {
+        const OutageReport& r = _report;
+        char p50[16], p99[16], max[16];
+        seconds(p50, sizeof(p50), r.recovery(0.5));
+        seconds(p99, sizeof(p99), r.recovery(0.99));
+        seconds(max, sizeof(max), r.recovery(1.0));
+        fprintf(out, "%-8s %9lu %9lu %8lu %8lu %8lu %7lu %7.2f %9s %9s %9s %6d %8lu\n", OUTAGE_POLICY_NAMES[_cfg.policy],
+                (unsigned long)r.attempts, (unsigned long)r.ok, (unsigned long)r.netFailed, (unsigned long)r.shed,
+                (unsigned long)r.timedOut, (unsigned long)r.peakPerSec, r.amplification, p50, p99, max, r.unrecovered,
+                (unsigned long)r.breakerOpens);
+    }
+
+    /** Attempts and good answers per bucket of seconds, from just before the outage to the end. */
+    void timeline(FILE* out, uint32_t bucketS) const {
+        const OutageReport& r = _report;
+        if (!bucketS) bucketS = 10;
+        size_t from = r.outageFromMs / 1000 > bucketS ? (r.outageFromMs / 1000 / bucketS - 1) * bucketS : 0;
+        for (size_t s = from; s < r.perSecAttempts.size(); s += bucketS) {
+            uint64_t a = 0, ok = 0;
+            for (size_t k = s; k < s + bucketS && k < r.perSecAttempts.size(); k++) { a += r.perSecAttempts[k]; ok += r.perSecOk[k]; }
+            fprintf(out, "  t=%6lus %7.1f attempts/s %7.1f ok/s\n", (unsigned long)s, (double)a / bucketS, (double)ok / bucketS);
+        }
+    }
+
+    void print(FILE* out) const {
+        const OutageReport& r = _report;
+        fprintf(out, "%d devices, poll %lu s, capacity %s, %s: steady %.1f polls/s\n", _cfg.devices, (unsigned long)(_cfg.pollMs / 1000),
+                _cfg.capacity ? (std::to_string(_cfg.capacity) + "/s").c_str() : "unlimited",
+                !r.outage ? "no outage" : (std::string(_cfg.cold ? "power cut " : "outage ") + std::to_string(r.outageFromMs / 1000) +
+                                           "-" + std::to_string(r.outageToMs / 1000) + " s").c_str(), r.steadyPerSec);
+        header(out);
+        row(out);
+    }
+
+private:
+    struct Device {
+        uint64_t next = 0;
+        bool drawn = true, recovered = false;
+        int failures = 0;
+        RetryPolicy retry;
+    };
+
+    typedef std::pair<uint64_t, int> Wake;
+    typedef std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> Queue;
+
+    static void seconds(char* out, size_t size, uint64_t ms) {
+        if (ms == UINT64_MAX) snprintf(out, size, "never");
+        else snprintf(out, size, "%.1fs", ms / 1000.0);
+    }
+
+    void schedule(int i, uint64_t at) {
+        _dev[i].next = at;
+        _queue.push(Wake(at, i));
+    }
+
+    // Everything off until `until`, then every device boots with no picture within the boot spread
+    void powerCut(uint64_t until) {
+        _queue = Queue();
+        for (int i = 0; i < (int)_dev.size(); i++) {
+            Device& d = _dev[i];
+            d.drawn = false;
+            d.failures = 0;
+            d.retry.success();
+            schedule(i, until + _rng.below(_cfg.bootSpreadMs + 1));
+        }
+    }
+
+    void attempt(int i, uint64_t t) {
+        Device& d = _dev[i];
+        OutageReport& r = _report;
+        r.attempts++;
+        r.perSecAttempts[t / 1000]++;
+
+        NetAttempt a = _net.request(t, _cfg.tls, _cfg.timeoutMs);
+        uint64_t end = t + a.ms;
+        bool ok = false;
+        if (a.fault || a.status >= 400) r.netFailed++;
+        else if (!_cfg.capacity) { ok = true; end += OUTAGE_SERVICE_MS; }
+        else {
+            // One queue at capacity/s; a device stops waiting at its timeout, the server doesn't notice
+            double start = std::max((double)end, _serverFree);
+            if (_cfg.queueMs && start - (double)end > _cfg.queueMs) r.shed++;
+            else {
+                _serverFree = start + 1000.0 / _cfg.capacity;
+                if (_serverFree - (double)t > _cfg.timeoutMs) { r.timedOut++; end = t + _cfg.timeoutMs; }
+                else { ok = true; end = (uint64_t)_serverFree; }
+            }
+        }
+
+        if (ok) {
+            r.ok++;
+            if (end / 1000 < r.perSecOk.size()) r.perSecOk[end / 1000]++;
+            if (r.outage && !d.recovered && t >= r.outageToMs) {
+                d.recovered = true;
+                r.recoveryMs.push_back((uint32_t)(end - r.outageToMs));
+            }
+            d.drawn = true;
+            d.failures = 0;
+            d.retry.success();
+            schedule(i, t + _cfg.pollMs);
+            return;
+        }
+        uint64_t wait;
+        if (_cfg.policy == OUTAGE_FIXED) wait = OUTAGE_FIXED_MS;
+        else if (_cfg.policy == OUTAGE_BACKOFF) wait = (1ull << std::min(++d.failures, OUTAGE_BACKOFF_MAX)) * 1000;
+        else wait = d.retry.failure(end);
+        schedule(i, d.drawn ? std::max(t + _cfg.pollMs, end + wait) : end + wait);
+    }
+
+    OutageConfig _cfg;
+    NetEmulator& _net;
+    NetRandom _rng;
+    std::vector<Device> _dev;
+    Queue _queue;
+    double _serverFree = 0;
+    OutageReport _report;
+};
+
+#endif // OUTAGE_SIM_HPP
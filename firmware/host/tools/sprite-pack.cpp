@@ -0,0 +1,96 @@
+/**
+ * Compile the sprite dictionary, or encode a zone BMP as a draw list
+ *
+ * Usage: ./sprite-pack -o sprites.bin firmware/sprites/sprites.txt
+ *        ./sprite-pack --encode sprites.bin [--at X,Y] [-o zone.zdl] zone.bmp
+ *
+ * The server builds the same dictionary from sprites.txt by itself; the
+ * image here is for flashing the "sprites" partition directly (esptool.py
+ * write_flash 0x3EC000 sprites.bin) and for checking changes to the file.
+ * --encode finds the dictionary's sprites in a zone BMP (e.g. one saved
+ * from /api/zone/<id>) and reports what its draw list costs against the BMP.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include "sprite_pack.hpp"
+
+#include <stdio.h>
+#include <fstream>
+#include <iterator>
+
+static int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s -o IMAGE SPRITES_TXT\n"
+            "       %s --encode IMAGE [--at X,Y] [-o LIST] ZONE_BMP\n",
+            argv0, argv0);
+    return 2;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { fprintf(stderr, "%s: can't read\n", path); return false; }
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    std::ofstream f(path, std::ios::binary);
+    f.write((const char*)data.data(), (std::streamsize)data.size());
+    if (!f) { fprintf(stderr, "%s: can't write\n", path); return false; }
+    return true;
+}
+
+static int compile(const char* src, const char* out) {
+    std::vector<uint8_t> text;
+    if (!readFile(src, text)) return 1;
+    uint32_t version;
+    std::vector<SpriteSource> sprites;
+    std::string err;
+    if (!spriteParseSource(std::string(text.begin(), text.end()), version, sprites, err)) {
+        fprintf(stderr, "%s: %s\n", src, err.c_str());
+        return 1;
+    }
+    std::vector<uint8_t> image = spriteBuildDict(version, sprites);
+    if (!writeFile(out, image)) return 1;
+    printf("%s: version %u, %zu sprites, %zu bytes, CRC %08x\n", out, version, sprites.size(), image.size(),
+           (unsigned)((const SpriteDictHeader*)image.data())->crc);
+    return 0;
+}
+
+static int encode(const char* imagePath, const char* bmpPath, int zx, int zy, const char* out) {
+    std::vector<uint8_t> image, bmp;
+    if (!readFile(imagePath, image) || !readFile(bmpPath, bmp)) return 1;
+    SpriteDict dict;
+    if (!dict.open(image.data(), image.size())) { fprintf(stderr, "%s: not a sprite dictionary (or CRC mismatch)\n", imagePath); return 1; }
+    Bitmap zone;
+    if (!spriteReadBmp(bmp, zone)) { fprintf(stderr, "%s: not a 1-bit BMP\n", bmpPath); return 1; }
+    std::vector<SpritePlacement> found = spriteFind(dict, zone);
+    DrawListStats st;
+    std::vector<uint8_t> list = drawListEncode(dict, zone, zx, zy, found, &st);
+    if (out && !writeFile(out, list)) return 1;
+    for (const SpritePlacement& p : found) printf("sprite #%u at (%d,%d)\n", p.id, p.x, p.y);
+    printf("%s: %dx%d, %zu byte BMP -> %zu byte draw list (%zu ops: %zu fills, %zu sprites, %zu bits with %zu bytes)\n",
+           bmpPath, zone.w, zone.h, bmp.size(), list.size(), st.ops, st.fills, st.sprites, st.bitsOps, st.bitsBytes);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* out = nullptr;
+    const char* dictPath = nullptr;
+    int zx = 0, zy = 0;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-o" && i + 1 < argc) out = argv[++i];
+        else if (a == "--encode" && i + 1 < argc) dictPath = argv[++i];
+        else if (a == "--at" && i + 1 < argc) { if (sscanf(argv[++i], "%d,%d", &zx, &zy) != 2) return usage(argv[0]); }
+        else if (a[0] != '-') files.push_back(argv[i]);
+        else return usage(argv[0]);
+    }
+    if (files.size() != 1) return usage(argv[0]);
+    if (dictPath) return encode(dictPath, files[0], zx, zy, out);
+    if (!out) return usage(argv[0]);
+    return compile(files[0], out);
+}
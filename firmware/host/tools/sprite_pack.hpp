@@ -0,0 +1,308 @@
+/**
+ * Sprite dictionary compiler and draw list encoder (see include/sprite_dict.hpp)
+ *
+ * spriteParseSource() reads firmware/sprites/sprites.txt and
+ * spriteBuildDict() lays it out as the image the device keeps in flash.
+ *
+ * drawListEncode() turns a rendered zone into a draw list. The zone is
+ * explained, in order, by:
+ *   1. a fill in its majority colour
+ *   2. the sprites placed in it, each checked pixel for pixel
+ *   3. rules and borders: runs of 32 or more pixels of one colour, as fills
+ *   4. what is still different, cut into rectangles: row bands that differ,
+ *      split where 16 or more clean columns separate them. A uniform
+ *      rectangle becomes a fill, anything else raw bits.
+ * src/services/zone-sprites.js does the same on the server with the
+ * placements the renderer recorded. spriteFind() recovers them from pixels,
+ * so any captured zone BMP can be encoded.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef SPRITE_PACK_HPP
+#define SPRITE_PACK_HPP
+
+#include "sprite_dict.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DRAW_RUN_MIN 32       // a rule this long is sent as a fill
+#define DRAW_GROUP_GAP 16     // clean columns that split a band of residual bits
+
+/** A 1-bit image, one byte per pixel: non-zero = white. */
+struct Bitmap {
+    int w = 0, h = 0;
+    std::vector<uint8_t> px;
+    bool white(int x, int y) const { return px[(size_t)y * w + x] != 0; }
+};
+
+struct SpriteSource {
+    uint16_t id;
+    std::string name;
+    Bitmap bits;
+};
+
+struct SpritePlacement { uint16_t id; int x, y; };
+
+struct DrawListStats {
+    size_t ops = 0, fills = 0, sprites = 0, bitsOps = 0, bitsBytes = 0;
+};
+
+/**
+ * Parse sprites.txt: "version N", then per sprite "sprite ID NAME WxH" and
+ * H rows of W '#'/'.' characters. '#' starts a comment outside a sprite.
+ */
+static inline bool spriteParseSource(const std::string& text, uint32_t& version, std::vector<SpriteSource>& out, std::string& err) {
+    std::istringstream in(text);
+    std::string line;
+    int lineNo = 0;
+    version = 0;
+    out.clear();
+    auto fail = [&](const std::string& why) { err = "line " + std::to_string(lineNo) + ": " + why; return false; };
+    while (std::getline(in, line)) {
+        lineNo++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream words(line);
+        std::string kw;
+        words >> kw;
+        if (kw == "version") {
+            long v = -1;
+            words >> v;
+            if (v <= 0) return fail("bad version");
+            version = (uint32_t)v;
+        } else if (kw == "sprite") {
+            long id = 0;
+            std::string name, size;
+            words >> id >> name >> size;
+            int w = 0, h = 0;
+            if (id <= 0 || id > 65535 || name.empty() || sscanf(size.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0 || w > 255 || h > 255)
+                return fail("expected \"sprite ID NAME WxH\"");
+            for (const SpriteSource& s : out)
+                if (s.id == id || s.name == name) return fail("duplicate sprite " + name);
+            SpriteSource s;
+            s.id = (uint16_t)id;
+            s.name = name;
+            s.bits.w = w; s.bits.h = h;
+            for (int r = 0; r < h; r++) {
+                if (!std::getline(in, line)) return fail("sprite " + name + " ends early");
+                lineNo++;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if ((int)line.size() != w || line.find_first_not_of("#.") != std::string::npos)
+                    return fail("sprite " + name + ": expected " + std::to_string(w) + " of '#' and '.'");
+                for (char c : line) s.bits.px.push_back(c == '.');
+            }
+            out.push_back(s);
+        } else {
+            return fail("unknown line");
+        }
+    }
+    if (!version) { err = "no version line"; return false; }
+    return true;
+}
+
+static inline void spritePut16(std::vector<uint8_t>& s, uint32_t v) { s.push_back(v & 0xFF); s.push_back((v >> 8) & 0xFF); }
+
+/** Pack w pixels of row y, bit 7 leftmost, 1 = white. */
+static inline void spritePackRow(const Bitmap& b, int x, int y, int w, std::vector<uint8_t>& out) {
+    for (int i = 0; i < w; i += 8) {
+        uint8_t v = 0;
+        for (int k = 0; k < 8 && i + k < w; k++) if (b.white(x + i + k, y)) v |= (uint8_t)(0x80 >> k);
+        out.push_back(v);
+    }
+}
+
+/** The dictionary image, sprites in id order. */
+static inline std::vector<uint8_t> spriteBuildDict(uint32_t version, std::vector<SpriteSource> sprites) {
+    std::sort(sprites.begin(), sprites.end(), [](const SpriteSource& a, const SpriteSource& b) { return a.id < b.id; });
+    size_t entriesOff = sizeof(SpriteDictHeader);
+    std::vector<uint8_t> image(entriesOff + sprites.size() * sizeof(SpriteEntry));
+    for (size_t i = 0; i < sprites.size(); i++) {
+        const Bitmap& b = sprites[i].bits;
+        SpriteEntry e = {sprites[i].id, (uint8_t)b.w, (uint8_t)b.h, (uint32_t)image.size()};
+        memcpy(&image[entriesOff + i * sizeof(SpriteEntry)], &e, sizeof(e));
+        for (int y = 0; y < b.h; y++) spritePackRow(b, 0, y, b.w, image);
+    }
+    SpriteDictHeader h = {};
+    h.magic = SPRITE_DICT_MAGIC;
+    h.format = SPRITE_DICT_FORMAT;
+    h.headerSize = sizeof(h);
+    h.totalSize = (uint32_t)image.size();
+    h.dictVersion = version;
+    h.count = (uint16_t)sprites.size();
+    h.crc = ttCrc32(image.data() + sizeof(h), image.size() - sizeof(h));
+    memcpy(image.data(), &h, sizeof(h));
+    return image;
+}
+
+/** A 1-bit BMP (top-down or bottom-up, either palette order) as a Bitmap. */
+static inline bool spriteReadBmp(const std::vector<uint8_t>& f, Bitmap& out) {
+    auto u32 = [&](size_t o) { return (uint32_t)f[o] | (uint32_t)f[o + 1] << 8 | (uint32_t)f[o + 2] << 16 | (uint32_t)f[o + 3] << 24; };
+    if (f.size() < 62 || f[0] != 'B' || f[1] != 'M' || f[28] != 1) return false;
+    uint32_t dataOff = u32(10);
+    int32_t w = (int32_t)u32(18), h = (int32_t)u32(22);
+    bool topDown = h < 0;
+    if (topDown) h = -h;
+    size_t stride = ((size_t)w + 31) / 32 * 4;
+    if (w <= 0 || h <= 0 || dataOff + stride * h > f.size()) return false;
+    // Palette entry 1 is white in our BMPs; flip if a writer chose the other order
+    bool flip = (u32(54) & 0xFFFFFF) != 0;
+    out.w = w; out.h = h;
+    out.px.assign((size_t)w * h, 0);
+    for (int y = 0; y < h; y++) {
+        const uint8_t* row = f.data() + dataOff + (topDown ? y : h - 1 - y) * stride;
+        for (int x = 0; x < w; x++) out.px[(size_t)y * w + x] = (uint8_t)((((row[x >> 3] >> (7 - (x & 7))) & 1) != 0) != flip);
+    }
+    return true;
+}
+
+static inline bool spriteMatches(const SpriteDict& dict, const SpriteEntry& e, const Bitmap& img, int x, int y) {
+    const uint8_t* bits = dict.bits(e);
+    int pitch = spritePitch(e.w);
+    for (int r = 0; r < e.h; r++)
+        for (int c = 0; c < e.w; c++)
+            if (((bits[r * pitch + c / 8] >> (7 - c % 8)) & 1) != img.white(x + c, y + r)) return false;
+    return true;
+}
+
+/** Every place a dictionary sprite appears whole in img, first match wins where they'd overlap. */
+static inline std::vector<SpritePlacement> spriteFind(const SpriteDict& dict, const Bitmap& img) {
+    std::vector<SpritePlacement> found;
+    std::vector<uint8_t> claimed((size_t)img.w * img.h, 0);
+    for (int i = 0; i < dict.count(); i++) {
+        const SpriteEntry& e = dict.entry(i);
+        for (int y = 0; y + e.h <= img.h; y++) {
+            for (int x = 0; x + e.w <= img.w; x++) {
+                if (claimed[(size_t)y * img.w + x] || !spriteMatches(dict, e, img, x, y)) continue;
+                bool overlaps = false;
+                for (int r = 0; r < e.h && !overlaps; r++)
+                    for (int c = 0; c < e.w && !overlaps; c++) overlaps = claimed[(size_t)(y + r) * img.w + x + c];
+                if (overlaps) continue;
+                for (int r = 0; r < e.h; r++) memset(&claimed[(size_t)(y + r) * img.w + x], 1, e.w);
+                found.push_back({e.id, x, y});
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * Draw list for a rendered zone at (zx, zy). Placements that don't match
+ * the pixels are dropped, so the result always reproduces img exactly.
+ */
+static inline std::vector<uint8_t> drawListEncode(const SpriteDict& dict, const Bitmap& img, int zx, int zy,
+                                                  const std::vector<SpritePlacement>& placements, DrawListStats* stats = nullptr) {
+    DrawListStats st;
+    std::vector<uint8_t> out = {'Z', 'D', DRAW_LIST_VERSION, 0};
+    spritePut16(out, (uint16_t)zx); spritePut16(out, (uint16_t)zy);
+    spritePut16(out, (uint16_t)img.w); spritePut16(out, (uint16_t)img.h);
+    spritePut16(out, dict.version() & 0xFFFF); spritePut16(out, dict.version() >> 16);
+    spritePut16(out, 0);    // op count, patched below
+
+    size_t whites = 0;
+    for (uint8_t p : img.px) whites += p != 0;
+    uint8_t bg = whites * 2 >= img.px.size();
+    Bitmap canvas = img;
+    canvas.px.assign(img.px.size(), bg);
+    out.push_back(DRAW_FILL);
+    spritePut16(out, 0); spritePut16(out, 0); spritePut16(out, img.w); spritePut16(out, img.h);
+    out.push_back(bg);
+    st.ops++; st.fills++;
+
+    for (const SpritePlacement& p : placements) {
+        const SpriteEntry* e = dict.find(p.id);
+        if (!e || p.x < 0 || p.y < 0 || p.x + e->w > img.w || p.y + e->h > img.h || !spriteMatches(dict, *e, img, p.x, p.y)) continue;
+        for (int r = 0; r < e->h; r++)
+            for (int c = 0; c < e->w; c++) canvas.px[(size_t)(p.y + r) * img.w + p.x + c] = img.px[(size_t)(p.y + r) * img.w + p.x + c];
+        out.push_back(DRAW_SPRITE);
+        spritePut16(out, p.id); spritePut16(out, (uint16_t)p.x); spritePut16(out, (uint16_t)p.y);
+        st.ops++; st.sprites++;
+    }
+
+    auto differs = [&](int x, int y) { return canvas.px[(size_t)y * img.w + x] != img.px[(size_t)y * img.w + x]; };
+    auto fill = [&](int x, int y, int w, int h, uint8_t white) {
+        out.push_back(DRAW_FILL);
+        spritePut16(out, x); spritePut16(out, y); spritePut16(out, w); spritePut16(out, h);
+        out.push_back(white);
+        for (int r = y; r < y + h; r++) memset(&canvas.px[(size_t)r * img.w + x], white, w);
+        st.ops++; st.fills++;
+    };
+    // A run of one colour that still differs, as a w x h rectangle
+    auto runOf = [&](int x, int y, int w, int h, uint8_t c) {
+        for (int r = y; r < y + h; r++)
+            for (int k = x; k < x + w; k++)
+                if (!differs(k, r) || img.px[(size_t)r * img.w + k] != c) return false;
+        return true;
+    };
+
+    // Rules and borders: long runs first across, then down, each grown as far as it goes
+    for (int pass = 0; pass < 2; pass++) {
+        bool across = pass == 0;
+        int lines = across ? img.h : img.w, len = across ? img.w : img.h;
+        for (int l = 0; l < lines; l++) {
+            for (int i = 0; i < len;) {
+                int x = across ? i : l, y = across ? l : i;
+                if (!differs(x, y)) { i++; continue; }
+                uint8_t c = img.px[(size_t)y * img.w + x];
+                int n = 1;
+                while (i + n < len && (across ? runOf(x + n, y, 1, 1, c) : runOf(x, y + n, 1, 1, c))) n++;
+                if (n < DRAW_RUN_MIN) { i += n; continue; }
+                int depth = 1;
+                if (across) { while (y + depth < img.h && runOf(x, y + depth, n, 1, c)) depth++; fill(x, y, n, depth, c); }
+                else { while (x + depth < img.w && runOf(x + depth, y, 1, n, c)) depth++; fill(x, y, depth, n, c); }
+                i += n;
+            }
+        }
+    }
+
+    auto rowDiffers = [&](int y) { for (int x = 0; x < img.w; x++) if (differs(x, y)) return true; return false; };
+    std::vector<uint8_t> used(img.w);
+    for (int y = 0; y < img.h;) {
+        if (!rowDiffers(y)) { y++; continue; }
+        int y1 = y;
+        while (y1 < img.h && rowDiffers(y1)) y1++;
+        std::fill(used.begin(), used.end(), 0);
+        for (int r = y; r < y1; r++) for (int x = 0; x < img.w; x++) if (differs(x, r)) used[x] = 1;
+        for (int x = 0; x < img.w;) {
+            if (!used[x]) { x++; continue; }
+            int gx0 = x, gx1 = x, gap = 0;
+            for (x++; x < img.w && gap < DRAW_GROUP_GAP; x++) {
+                if (used[x]) { gx1 = x; gap = 0; } else gap++;
+            }
+            x = gx1 + 1;
+            int gy0 = y1, gy1 = y;
+            for (int r = y; r < y1; r++)
+                for (int c = gx0; c <= gx1; c++)
+                    if (differs(c, r)) { gy0 = std::min(gy0, r); gy1 = std::max(gy1, r); break; }
+            int rw = gx1 - gx0 + 1, rh = gy1 - gy0 + 1;
+            uint8_t first = img.px[(size_t)gy0 * img.w + gx0];
+            bool uniform = true;
+            for (int r = gy0; r <= gy1 && uniform; r++)
+                for (int c = gx0; c <= gx1 && uniform; c++) uniform = img.px[(size_t)r * img.w + c] == first;
+            if (uniform) {
+                fill(gx0, gy0, rw, rh, first);
+                continue;
+            }
+            out.push_back(DRAW_BITS);
+            spritePut16(out, gx0); spritePut16(out, gy0); spritePut16(out, rw); spritePut16(out, rh);
+            size_t before = out.size();
+            for (int r = gy0; r <= gy1; r++) spritePackRow(img, gx0, r, rw, out);
+            st.ops++; st.bitsOps++;
+            st.bitsBytes += out.size() - before;
+        }
+        y = y1;
+    }
+    out[16] = st.ops & 0xFF;
+    out[17] = (st.ops >> 8) & 0xFF;
+    if (stats) *stats = st;
+    return out;
+}
+
+#endif // SPRITE_PACK_HPP
@@ -39,33 +39,29 @@
 #define EPD_DC_PIN   5
 #define EPD_BUSY_PIN 4
 
+// Panel SPI clock. UC8179 accepts writes well above the old 8 MHz setting;
+// drop back to 8000000 if a panel batch shows corrupted partial updates.
+#define EPD_SPI_HZ 16000000
+
+// BUSY is held LOW while the controller runs a waveform
+#define EPD_BUSY_ACTIVE_LEVEL LOW
+
 // Button and battery pins
 #define PIN_INTERRUPT 2
 #define PIN_BATTERY 3
 
-// Regions for partial refresh
-#define TIME_X 20
-#define TIME_Y 10
-#define TIME_W 135
-#define TIME_H 48
-
-#define DEPARTURES_X 30
-#define DEPARTURES_Y 100
-#define DEPARTURES_W 350
-#define DEPARTURES_H 300
-
-#define JOURNEY_BOX_X 500
-#define JOURNEY_BOX_Y 110
-#define JOURNEY_BOX_W 280
-#define JOURNEY_BOX_H 140
+// Zone and field rectangles live in layout/dashboard.layout (compiled to
+// dashboard_layout.hpp, read by the server as is), not here.
 
 // NTP Configuration
 #define NTP_SERVER "pool.ntp.org"
 #define NTP_OFFSET_SECONDS 39600  // UTC+11 (AEDT)
 #define NTP_UPDATE_INTERVAL 60000
 
-// Firmware Version
+// Firmware Version (a sketch that reports its own defines it before including this)
+#ifndef FIRMWARE_VERSION
 #define FIRMWARE_VERSION "v5.25"
+#endif
 
 // Journey Display endpoints
 #define API_JOURNEY_DISPLAY "/api/journey-display"
@@ -0,0 +1,252 @@
+/**
+ * Dashboard layout tables: GENERATED from layout/dashboard.layout, do not edit
+ *
+ * Regenerate with: cmake --build host/build --target layout
+ * Types and the blits that use these tables are in layout.hpp.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef DASHBOARD_LAYOUT_HPP
+#define DASHBOARD_LAYOUT_HPP
+
+#include "layout.hpp"
+#include "zone_protocol.hpp"
+
+#define DASHBOARD_LAYOUT_VERSION 1
+#define DASHBOARD_LAYOUT_CRC 0x3CF629B7u
+#define DASHBOARD_LAYOUT_TAG "3cf629b7"    // sent as X-Layout; the server warns when its file differs
+
+enum : uint8_t {
+    LAYOUT_FONT_TINY,
+    LAYOUT_FONT_SMALL,
+    LAYOUT_FONT_BODY,
+    LAYOUT_FONT_LARGE,
+    LAYOUT_FONT_TEMP,
+    LAYOUT_FONT_CLOCK,
+};
+
+static constexpr LayoutFont LAYOUT_FONTS[] = {
+    {"tiny", LAYOUT_CELL_6x8, 6, 8},
+    {"small", LAYOUT_CELL_8x8, 8, 8},
+    {"body", LAYOUT_CELL_8x8, 8, 8},
+    {"large", LAYOUT_CELL_12x16, 12, 16},
+    {"temp", LAYOUT_CELL_12x16, 12, 16},
+    {"clock", LAYOUT_CELL_12x16, 12, 16},
+};
+
+// ---- screen dash ----
+
+#define DASH_W 800
+#define DASH_H 480
+#define DASH_PITCH 100
+
+enum : uint8_t {
+    DASH_TIME,
+    DASH_WEATHER,
+    DASH_TRAINS,
+    DASH_TRAMS,
+    DASH_COFFEE,
+    DASH_FOOTER,
+};
+enum : uint8_t {
+    DASH_TIME_CLOCK,
+    DASH_WEATHER_TEMP,
+    DASH_WEATHER_CONDITION,
+    DASH_WEATHER_ICON,
+    DASH_TRAINS_TITLE,
+    DASH_TRAINS_DEP,
+    DASH_TRAMS_TITLE,
+    DASH_TRAMS_DEP,
+    DASH_COFFEE_ICON,
+    DASH_COFFEE_DECISION,
+    DASH_COFFEE_DETAIL,
+    DASH_FOOTER_DESTINATION,
+    DASH_FOOTER_ARRIVE,
+};
+
+static constexpr ZoneDef DASH_ZONES[] = {
+    {"time", 20, 45, 180, 70, 1},
+    {"weather", 620, 10, 160, 95, 2},
+    {"trains", 20, 155, 370, 150, 1},
+    {"trams", 410, 155, 370, 150, 1},
+    {"coffee", 20, 315, 760, 65, 2},
+    {"footer", 0, 445, 800, 35, 3},
+};
+static constexpr int DASH_ZONE_COUNT = 6;
+
+// span, w, h, BMP row bytes, black background, border
+static constexpr LayoutZone DASH_LAYOUT[] = {
+    {{4502, 4, 23, 0x0F, 0xFF}, 180, 70, 24, 0, 0},
+    {{1077, 4, 21, 0x0F, 0xF0}, 160, 95, 20, 0, 1},
+    {{15502, 4, 47, 0x0F, 0xFC}, 370, 150, 48, 0, 0},
+    {{15551, 2, 47, 0x3F, 0xF0}, 370, 150, 48, 0, 0},
+    {{31502, 4, 96, 0x0F, 0xF0}, 760, 65, 96, 0, 0},
+    {{44500, 0, 100, 0xFF, 0xFF}, 800, 35, 100, 1, 0},
+};
+
+// zone, id, x, y, w, h, text x, text y, span, font, flags, repeat, step
+static constexpr LayoutField DASH_FIELDS[] = {
+    {DASH_TIME, "clock", 20, 45, 180, 70, 20, 51, {4502, 4, 23, 0x0F, 0xFF}, LAYOUT_FONT_CLOCK, FIELD_ALIGN_LEFT, 1, 0},
+    {DASH_WEATHER, "temp", 630, 18, 100, 34, 630, 18, {1878, 6, 14, 0x03, 0xC0}, LAYOUT_FONT_TEMP, FIELD_ALIGN_LEFT, 1, 0},
+    {DASH_WEATHER, "condition", 630, 66, 140, 14, 630, 66, {6678, 6, 19, 0x03, 0xC0}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 1, 0},
+    {DASH_WEATHER, "icon", 746, 18, 24, 24, 746, 18, {1893, 2, 4, 0x3F, 0xC0}, 0, FIELD_ALIGN_LEFT | FIELD_ICON, 1, 0},
+    {DASH_TRAINS, "title", 24, 159, 362, 12, 24, 159, {15903, 0, 46, 0xFF, 0xC0}, LAYOUT_FONT_BODY, FIELD_ALIGN_LEFT, 1, 0},
+    {DASH_TRAINS, "dep", 24, 179, 362, 16, 24, 179, {17903, 0, 46, 0xFF, 0xC0}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 6, 20},
+    {DASH_TRAMS, "title", 414, 159, 362, 12, 414, 159, {15951, 6, 46, 0x03, 0xFF}, LAYOUT_FONT_BODY, FIELD_ALIGN_LEFT, 1, 0},
+    {DASH_TRAMS, "dep", 414, 179, 362, 16, 414, 179, {17951, 6, 46, 0x03, 0xFF}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 6, 20},
+    {DASH_COFFEE, "icon", 28, 335, 24, 24, 28, 335, {33503, 4, 4, 0x0F, 0xF0}, 0, FIELD_ALIGN_LEFT | FIELD_ICON, 1, 0},
+    {DASH_COFFEE, "decision", 60, 325, 712, 20, 60, 325, {32507, 4, 90, 0x0F, 0xF0}, LAYOUT_FONT_BODY, FIELD_ALIGN_LEFT, 1, 0},
+    {DASH_COFFEE, "detail", 60, 353, 712, 16, 60, 353, {35307, 4, 90, 0x0F, 0xF0}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 1, 0},
+    {DASH_FOOTER, "destination", 16, 455, 480, 16, 16, 455, {45502, 0, 60, 0xFF, 0xFF}, LAYOUT_FONT_BODY, FIELD_ALIGN_LEFT | FIELD_INK_WHITE, 1, 0},
+    {DASH_FOOTER, "arrive", 496, 455, 288, 16, 496, 455, {45562, 0, 36, 0xFF, 0xFF}, LAYOUT_FONT_BODY, FIELD_ALIGN_RIGHT | FIELD_INK_WHITE, 1, 0},
+};
+static constexpr int DASH_FIELD_COUNT = 13;
+
+// ---- screen tpl ----
+
+#define TPL_W 800
+#define TPL_H 480
+#define TPL_PITCH 100
+
+enum : uint8_t {
+    TPL_STATION,
+    TPL_CLOCK,
+    TPL_TRAMS,
+    TPL_TRAINS,
+    TPL_SIDEBAR,
+};
+enum : uint8_t {
+    TPL_STATION_NAME,
+    TPL_CLOCK_TIME,
+    TPL_TRAMS_HEADER,
+    TPL_TRAMS_TIME,
+    TPL_TRAMS_DEST,
+    TPL_TRAINS_HEADER,
+    TPL_TRAINS_TIME,
+    TPL_TRAINS_DEST,
+    TPL_SIDEBAR_ALERT,
+    TPL_SIDEBAR_WEATHER,
+    TPL_SIDEBAR_TEMPERATURE,
+};
+
+static constexpr ZoneDef TPL_ZONES[] = {
+    {"station", 10, 10, 90, 50, 0},
+    {"clock", 135, 20, 120, 50, 0},
+    {"trams", 10, 120, 370, 160, 0},
+    {"trains", 400, 120, 360, 160, 0},
+    {"sidebar", 775, 120, 25, 300, 0},
+};
+static constexpr int TPL_ZONE_COUNT = 5;
+
+// span, w, h, BMP row bytes, black background, border
+static constexpr LayoutZone TPL_LAYOUT[] = {
+    {{1001, 2, 12, 0x3F, 0xF0}, 90, 50, 12, 0, 2},
+    {{2016, 7, 16, 0x01, 0xFE}, 120, 50, 16, 0, 0},
+    {{12001, 2, 47, 0x3F, 0xF0}, 370, 160, 48, 0, 0},
+    {{12050, 0, 45, 0xFF, 0xFF}, 360, 160, 48, 0, 0},
+    {{12096, 7, 4, 0x01, 0xFF}, 25, 300, 4, 0, 0},
+};
+
+// zone, id, x, y, w, h, text x, text y, span, font, flags, repeat, step
+static constexpr LayoutField TPL_FIELDS[] = {
+    {TPL_STATION, "name", 15, 30, 80, 8, 15, 30, {3001, 7, 11, 0x01, 0xFE}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 1, 0},
+    {TPL_CLOCK, "time", 135, 20, 120, 50, 140, 25, {2016, 7, 16, 0x01, 0xFE}, LAYOUT_FONT_LARGE, FIELD_ALIGN_LEFT, 1, 0},
+    {TPL_TRAMS, "header", 10, 120, 370, 25, 15, 130, {12001, 2, 47, 0x3F, 0xF0}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT | FIELD_FILL, 1, 0},
+    {TPL_TRAMS, "time", 15, 160, 150, 25, 20, 165, {16001, 7, 20, 0x01, 0xF8}, LAYOUT_FONT_LARGE, FIELD_ALIGN_LEFT, 2, 70},
+    {TPL_TRAMS, "dest", 20, 190, 350, 8, 20, 190, {19002, 4, 45, 0x0F, 0xC0}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 2, 70},
+    {TPL_TRAINS, "header", 400, 120, 360, 25, 405, 130, {12050, 0, 45, 0xFF, 0xFF}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT | FIELD_FILL, 1, 0},
+    {TPL_TRAINS, "time", 405, 160, 150, 25, 410, 165, {16050, 5, 20, 0x07, 0xE0}, LAYOUT_FONT_LARGE, FIELD_ALIGN_LEFT, 2, 70},
+    {TPL_TRAINS, "dest", 410, 190, 340, 8, 410, 190, {19051, 2, 43, 0x3F, 0xFC}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 2, 70},
+    {TPL_SIDEBAR, "alert", 775, 120, 25, 8, 775, 120, {12096, 7, 4, 0x01, 0xFF}, LAYOUT_FONT_TINY, FIELD_ALIGN_LEFT, 1, 0},
+    {TPL_SIDEBAR, "weather", 775, 340, 25, 8, 775, 340, {34096, 7, 4, 0x01, 0xFF}, LAYOUT_FONT_TINY, FIELD_ALIGN_LEFT, 1, 0},
+    {TPL_SIDEBAR, "temperature", 775, 410, 25, 8, 775, 410, {41096, 7, 4, 0x01, 0xFF}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 1, 0},
+};
+static constexpr int TPL_FIELD_COUNT = 11;
+
+// ---- screen departures ----
+
+#define DEPARTURES_W 800
+#define DEPARTURES_H 480
+#define DEPARTURES_PITCH 100
+
+enum : uint8_t {
+    DEPARTURES_HEADER,
+    DEPARTURES_BOARD,
+    DEPARTURES_FOOTER,
+};
+enum : uint8_t {
+    DEPARTURES_HEADER_TITLE,
+    DEPARTURES_BOARD_HEADING,
+    DEPARTURES_BOARD_WHEN,
+    DEPARTURES_BOARD_MODE,
+    DEPARTURES_BOARD_DEST,
+    DEPARTURES_FOOTER_HINT,
+};
+
+static constexpr ZoneDef DEPARTURES_ZONES[] = {
+    {"header", 0, 0, 800, 50, 0},
+    {"board", 20, 60, 760, 390, 0},
+    {"footer", 0, 460, 800, 20, 0},
+};
+static constexpr int DEPARTURES_ZONE_COUNT = 3;
+
+// span, w, h, BMP row bytes, black background, border
+static constexpr LayoutZone DEPARTURES_LAYOUT[] = {
+    {{0, 0, 100, 0xFF, 0xFF}, 800, 50, 100, 1, 0},
+    {{6002, 4, 96, 0x0F, 0xF0}, 760, 390, 96, 0, 1},
+    {{46000, 0, 100, 0xFF, 0xFF}, 800, 20, 100, 0, 0},
+};
+
+// zone, id, x, y, w, h, text x, text y, span, font, flags, repeat, step
+static constexpr LayoutField DEPARTURES_FIELDS[] = {
+    {DEPARTURES_HEADER, "title", 20, 14, 760, 24, 20, 14, {1402, 4, 96, 0x0F, 0xF0}, LAYOUT_FONT_LARGE, FIELD_ALIGN_LEFT | FIELD_INK_WHITE, 1, 0},
+    {DEPARTURES_BOARD, "heading", 21, 61, 758, 20, 29, 67, {6102, 5, 96, 0x07, 0xE0}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT | FIELD_INK_WHITE | FIELD_FILL, 1, 0},
+    {DEPARTURES_BOARD, "when", 28, 88, 80, 16, 28, 88, {8803, 4, 11, 0x0F, 0xF0}, LAYOUT_FONT_BODY, FIELD_ALIGN_LEFT, 18, 20},
+    {DEPARTURES_BOARD, "mode", 116, 88, 96, 16, 116, 92, {8814, 4, 13, 0x0F, 0xF0}, LAYOUT_FONT_SMALL, FIELD_ALIGN_LEFT, 18, 20},
+    {DEPARTURES_BOARD, "dest", 220, 88, 552, 16, 220, 88, {8827, 4, 70, 0x0F, 0xF0}, LAYOUT_FONT_BODY, FIELD_ALIGN_LEFT, 18, 20},
+    {DEPARTURES_FOOTER, "hint", 16, 464, 768, 12, 16, 464, {46402, 0, 96, 0xFF, 0xFF}, LAYOUT_FONT_TINY, FIELD_ALIGN_CENTER, 1, 0},
+};
+static constexpr int DEPARTURES_FIELD_COUNT = 6;
+
+// ---- screen alerts ----
+
+#define ALERTS_W 800
+#define ALERTS_H 480
+#define ALERTS_PITCH 100
+
+enum : uint8_t {
+    ALERTS_HEADER,
+    ALERTS_LIST,
+    ALERTS_FOOTER,
+};
+enum : uint8_t {
+    ALERTS_HEADER_TITLE,
+    ALERTS_LIST_ALERT,
+    ALERTS_FOOTER_HINT,
+};
+
+static constexpr ZoneDef ALERTS_ZONES[] = {
+    {"header", 0, 0, 800, 50, 0},
+    {"list", 20, 70, 760, 380, 0},
+    {"footer", 0, 460, 800, 20, 0},
+};
+static constexpr int ALERTS_ZONE_COUNT = 3;
+
+// span, w, h, BMP row bytes, black background, border
+static constexpr LayoutZone ALERTS_LAYOUT[] = {
+    {{0, 0, 100, 0xFF, 0xFF}, 800, 50, 100, 1, 0},
+    {{7002, 4, 96, 0x0F, 0xF0}, 760, 380, 96, 0, 0},
+    {{46000, 0, 100, 0xFF, 0xFF}, 800, 20, 100, 0, 0},
+};
+
+// zone, id, x, y, w, h, text x, text y, span, font, flags, repeat, step
+static constexpr LayoutField ALERTS_FIELDS[] = {
+    {ALERTS_HEADER, "title", 20, 14, 760, 24, 20, 14, {1402, 4, 96, 0x0F, 0xF0}, LAYOUT_FONT_LARGE, FIELD_ALIGN_LEFT | FIELD_INK_WHITE, 1, 0},
+    {ALERTS_LIST, "alert", 20, 70, 760, 40, 28, 82, {7002, 4, 96, 0x0F, 0xF0}, LAYOUT_FONT_BODY, FIELD_ALIGN_LEFT, 8, 46},
+    {ALERTS_FOOTER, "hint", 16, 464, 768, 12, 16, 464, {46402, 0, 96, 0xFF, 0xFF}, LAYOUT_FONT_TINY, FIELD_ALIGN_CENTER, 1, 0},
+};
+static constexpr int ALERTS_FIELD_COUNT = 3;
+
+#endif // DASHBOARD_LAYOUT_HPP
@@ -0,0 +1,327 @@
+/**
+ * Ed25519 signatures (RFC 8032), portable
+ *
+ * OTA patches carry a signature over their header, made with the release
+ * key on the host (host/tools/ota-delta) and checked on the device against
+ * the public key compiled into the firmware (include/ota_delta.hpp). The
+ * header holds the new image's SHA-256, so a good signature vouches for
+ * every byte the patch writes.
+ *
+ *   Ed25519::publicKey(seed, pk);                 // 32-byte secret seed
+ *   Ed25519::sign(seed, msg, n, sig);             // 64-byte signature
+ *   bool ok = Ed25519::verify(pk, msg, n, sig);
+ *
+ * Field arithmetic after TweetNaCl: 16 limbs of 16 bits in int64, no
+ * tables, constant time in the secret. Small and slow by design - a check
+ * is one scalar multiplication by the base and one by the key, about a
+ * second on the ESP32-C3 at 160 MHz, once per update - and about 3 KB of
+ * stack.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef ED25519_HPP
+#define ED25519_HPP
+
+#include "sha512.hpp"
+
+#define ED25519_KEY_SIZE 32
+#define ED25519_SIG_SIZE 64
+
+class Ed25519 {
+public:
+    static void publicKey(const uint8_t seed[ED25519_KEY_SIZE], uint8_t pk[ED25519_KEY_SIZE]) {
+        uint8_t d[SHA512_SIZE];
+        expand(seed, d);
+        gf p[4];
+        scalarbase(p, d);
+        pack(pk, p);
+    }
+
+    static void sign(const uint8_t seed[ED25519_KEY_SIZE], const uint8_t* msg, size_t n, uint8_t sig[ED25519_SIG_SIZE]) {
+        uint8_t d[SHA512_SIZE], pk[ED25519_KEY_SIZE], r[SHA512_SIZE], h[SHA512_SIZE];
+        expand(seed, d);
+        gf p[4];
+        scalarbase(p, d);
+        pack(pk, p);
+        // r = H(prefix || msg), R = rB
+        Sha512 s;
+        s.update(d + 32, 32); s.update(msg, n); s.finish(r);
+        reduce(r);
+        scalarbase(p, r);
+        pack(sig, p);
+        // S = r + H(R || A || msg) a  (mod L)
+        s.reset();
+        s.update(sig, 32); s.update(pk, 32); s.update(msg, n); s.finish(h);
+        reduce(h);
+        int64_t x[64] = {0};
+        for (int i = 0; i < 32; i++) x[i] = r[i];
+        for (int i = 0; i < 32; i++)
+            for (int j = 0; j < 32; j++) x[i + j] += (int64_t)h[i] * d[j];
+        modL(sig + 32, x);
+    }
+
+    static bool verify(const uint8_t pk[ED25519_KEY_SIZE], const uint8_t* msg, size_t n, const uint8_t sig[ED25519_SIG_SIZE]) {
+        if (!canonicalS(sig + 32)) return false;
+        gf p[4], q[4];
+        if (!unpackneg(q, pk)) return false;
+        uint8_t h[SHA512_SIZE], t[32];
+        Sha512 s;
+        s.update(sig, 32); s.update(pk, 32); s.update(msg, n); s.finish(h);
+        reduce(h);
+        // SB - hA must come out as R
+        scalarmult(p, q, h);
+        scalarbase(q, sig + 32);
+        add(p, q);
+        pack(t, p);
+        uint8_t diff = 0;
+        for (int i = 0; i < 32; i++) diff |= t[i] ^ sig[i];
+        return diff == 0;
+    }
+
+private:
+    typedef int64_t gf[16];
+
+    static const int64_t* gf0() { static const gf v = {0}; return v; }
+    static const int64_t* gf1() { static const gf v = {1}; return v; }
+    static const int64_t* D() {
+        static const gf v = {0x78a3, 0x1359, 0x4dca, 0x75eb, 0xd8ab, 0x4141, 0x0a4d, 0x0070,
+                             0xe898, 0x7779, 0x4079, 0x8cc7, 0xfe73, 0x2b6f, 0x6cee, 0x5203};
+        return v;
+    }
+    static const int64_t* D2() {
+        static const gf v = {0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0,
+                             0xd130, 0xeef3, 0x80f2, 0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406};
+        return v;
+    }
+    static const int64_t* X() {
+        static const gf v = {0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c,
+                             0xdc5c, 0xfdd6, 0xe231, 0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169};
+        return v;
+    }
+    static const int64_t* Y() {
+        static const gf v = {0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666,
+                             0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666};
+        return v;
+    }
+    static const int64_t* I() {
+        static const gf v = {0xa0b0, 0x4a0e, 0x1b27, 0xc4ee, 0xe478, 0xad2f, 0x1806, 0x2f43,
+                             0xd7a7, 0x3dfb, 0x0099, 0x2b4d, 0xdf0b, 0x4fc1, 0x2480, 0x2b83};
+        return v;
+    }
+    // The group order L, little-endian
+    static const uint8_t* L() {
+        static const uint8_t v[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                                      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10};
+        return v;
+    }
+
+    // Secret scalar (clamped) in d[0..31], signing prefix in d[32..63]
+    static void expand(const uint8_t seed[ED25519_KEY_SIZE], uint8_t d[SHA512_SIZE]) {
+        Sha512 s;
+        s.update(seed, ED25519_KEY_SIZE);
+        s.finish(d);
+        d[0] &= 248; d[31] &= 127; d[31] |= 64;
+    }
+
+    static void set(gf r, const int64_t* a) { for (int i = 0; i < 16; i++) r[i] = a[i]; }
+
+    static void carry(gf o) {
+        for (int i = 0; i < 16; i++) {
+            o[i] += (int64_t)1 << 16;
+            int64_t c = o[i] >> 16;
+            o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+            o[i] -= c * 65536;
+        }
+    }
+
+    // Swap p and q when b is 1, without a branch
+    static void select(gf p, gf q, int b) {
+        int64_t c = ~(int64_t)(b - 1);
+        for (int i = 0; i < 16; i++) {
+            int64_t t = c & (p[i] ^ q[i]);
+            p[i] ^= t; q[i] ^= t;
+        }
+    }
+
+    static void pack25519(uint8_t o[32], const gf n) {
+        gf m, t;
+        set(t, n);
+        carry(t); carry(t); carry(t);
+        for (int j = 0; j < 2; j++) {
+            m[0] = t[0] - 0xffed;
+            for (int i = 1; i < 15; i++) {
+                m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+                m[i - 1] &= 0xffff;
+            }
+            m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+            int b = (int)((m[15] >> 16) & 1);
+            m[14] &= 0xffff;
+            select(t, m, 1 - b);
+        }
+        for (int i = 0; i < 16; i++) { o[2 * i] = (uint8_t)(t[i] & 0xff); o[2 * i + 1] = (uint8_t)(t[i] >> 8); }
+    }
+
+    static bool differ(const gf a, const gf b) {
+        uint8_t c[32], d[32], x = 0;
+        pack25519(c, a); pack25519(d, b);
+        for (int i = 0; i < 32; i++) x |= c[i] ^ d[i];
+        return x != 0;
+    }
+
+    static uint8_t parity(const gf a) {
+        uint8_t d[32];
+        pack25519(d, a);
+        return d[0] & 1;
+    }
+
+    static void unpack25519(gf o, const uint8_t n[32]) {
+        for (int i = 0; i < 16; i++) o[i] = n[2 * i] + ((int64_t)n[2 * i + 1] << 8);
+        o[15] &= 0x7fff;
+    }
+
+    static void A(gf o, const gf a, const gf b) { for (int i = 0; i < 16; i++) o[i] = a[i] + b[i]; }
+    static void Z(gf o, const gf a, const gf b) { for (int i = 0; i < 16; i++) o[i] = a[i] - b[i]; }
+
+    static void M(gf o, const gf a, const gf b) {
+        int64_t t[31] = {0};
+        for (int i = 0; i < 16; i++)
+            for (int j = 0; j < 16; j++) t[i + j] += a[i] * b[j];
+        for (int i = 0; i < 15; i++) t[i] += 38 * t[i + 16];
+        for (int i = 0; i < 16; i++) o[i] = t[i];
+        carry(o); carry(o);
+    }
+
+    static void S(gf o, const gf a) { M(o, a, a); }
+
+    static void inverse(gf o, const gf i) {
+        gf c;
+        set(c, i);
+        for (int a = 253; a >= 0; a--) {
+            S(c, c);
+            if (a != 2 && a != 4) M(c, c, i);
+        }
+        set(o, c);
+    }
+
+    // i^((p-5)/8), for the square root in unpackneg()
+    static void pow2523(gf o, const gf i) {
+        gf c;
+        set(c, i);
+        for (int a = 250; a >= 0; a--) {
+            S(c, c);
+            if (a != 1) M(c, c, i);
+        }
+        set(o, c);
+    }
+
+    // p += q, extended coordinates
+    static void add(gf p[4], gf q[4]) {
+        gf a, b, c, d, t, e, f, g, h;
+        Z(a, p[1], p[0]); Z(t, q[1], q[0]); M(a, a, t);
+        A(b, p[0], p[1]); A(t, q[0], q[1]); M(b, b, t);
+        M(c, p[3], q[3]); M(c, c, D2());
+        M(d, p[2], q[2]); A(d, d, d);
+        Z(e, b, a); Z(f, d, c); A(g, d, c); A(h, b, a);
+        M(p[0], e, f); M(p[1], h, g); M(p[2], g, f); M(p[3], e, h);
+    }
+
+    static void cswap(gf p[4], gf q[4], uint8_t b) { for (int i = 0; i < 4; i++) select(p[i], q[i], b); }
+
+    static void pack(uint8_t r[32], gf p[4]) {
+        gf tx, ty, zi;
+        inverse(zi, p[2]);
+        M(tx, p[0], zi);
+        M(ty, p[1], zi);
+        pack25519(r, ty);
+        r[31] ^= (uint8_t)(parity(tx) << 7);
+    }
+
+    // p = s q (q is clobbered)
+    static void scalarmult(gf p[4], gf q[4], const uint8_t s[32]) {
+        set(p[0], gf0()); set(p[1], gf1()); set(p[2], gf1()); set(p[3], gf0());
+        for (int i = 255; i >= 0; --i) {
+            uint8_t b = (s[i / 8] >> (i & 7)) & 1;
+            cswap(p, q, b);
+            add(q, p);
+            add(p, p);
+            cswap(p, q, b);
+        }
+    }
+
+    static void scalarbase(gf p[4], const uint8_t s[32]) {
+        gf q[4];
+        set(q[0], X()); set(q[1], Y()); set(q[2], gf1());
+        M(q[3], X(), Y());
+        scalarmult(p, q, s);
+    }
+
+    // r = x mod L, x as 64 signed limbs of 8 bits
+    static void modL(uint8_t r[32], int64_t x[64]) {
+        int64_t c;
+        int i, j;
+        for (i = 63; i >= 32; --i) {
+            c = 0;
+            for (j = i - 32; j < i - 12; ++j) {
+                x[j] += c - 16 * x[i] * L()[j - (i - 32)];
+                c = (x[j] + 128) >> 8;
+                x[j] -= c * 256;
+            }
+            x[j] += c;
+            x[i] = 0;
+        }
+        c = 0;
+        for (j = 0; j < 32; j++) {
+            x[j] += c - (x[31] >> 4) * L()[j];
+            c = x[j] >> 8;
+            x[j] &= 255;
+        }
+        for (j = 0; j < 32; j++) x[j] -= c * L()[j];
+        for (i = 0; i < 32; i++) {
+            x[i + 1] += x[i] >> 8;
+            r[i] = (uint8_t)(x[i] & 255);
+        }
+    }
+
+    // A 64-byte hash reduced mod L into its first 32 bytes
+    static void reduce(uint8_t r[64]) {
+        int64_t x[64];
+        for (int i = 0; i < 64; i++) { x[i] = r[i]; r[i] = 0; }
+        modL(r, x);
+    }
+
+    // S < L, so a signature can't be reshaped into a second valid one
+    static bool canonicalS(const uint8_t s[32]) {
+        for (int i = 31; i >= 0; i--) {
+            if (s[i] < L()[i]) return true;
+            if (s[i] > L()[i]) return false;
+        }
+        return false;
+    }
+
+    // -A from its encoding; false if it isn't a point on the curve
+    static bool unpackneg(gf r[4], const uint8_t p[32]) {
+        gf t, chk, num, den, den2, den4, den6;
+        set(r[2], gf1());
+        unpack25519(r[1], p);
+        S(num, r[1]);
+        M(den, num, D());
+        Z(num, num, r[2]);
+        A(den, r[2], den);
+        S(den2, den); S(den4, den2); M(den6, den4, den2);
+        M(t, den6, num); M(t, t, den);
+        pow2523(t, t);
+        M(t, t, num); M(t, t, den); M(t, t, den);
+        M(r[0], t, den);
+        S(chk, r[0]); M(chk, chk, den);
+        if (differ(chk, num)) M(r[0], r[0], I());
+        S(chk, r[0]); M(chk, chk, den);
+        if (differ(chk, num)) return false;
+        if (parity(r[0]) == (p[31] >> 7)) Z(r[0], gf0(), r[0]);
+        M(r[3], r[0], r[1]);
+        return true;
+    }
+};
+
+#endif // ED25519_HPP
@@ -0,0 +1,119 @@
+/**
+ * LAN edge relay discovery
+ *
+ * A site with several displays can run host/tools/edge-relay on a box on
+ * the LAN: it polls the server once for all of them and answers the zone
+ * protocol over plain HTTP from its cache. It advertises itself over
+ * mDNS as _ptv-trmnl._tcp with a TXT "upstream" naming the server it
+ * relays. discover() looks for one relaying the configured server; while
+ * one is found, url() is the relay's http://ip:port and the firmware
+ * talks to it instead of the server. After EDGE_MAX_FAILURES requests in
+ * a row fail through it, the relay is dropped and url() is the server
+ * again. Without a relay the firmware looks again every EDGE_RETRY_MS
+ * (due()), so a relay that comes back, or is added later, is picked up.
+ *
+ * Templated on the mDNS client (ESPmDNS's MDNS on the device):
+ *
+ *   EdgeDiscovery<MDNSResponder> edge;
+ *   MDNS.begin("ptv-trmnl");
+ *   edge.discover(MDNS, serverUrl, millis());
+ *   String url = String(edge.url(serverUrl)) + "/api/zones?plain=1";
+ *   ...
+ *   if (ok) edge.succeeded(); else if (edge.failed(millis())) restartPush();
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef EDGE_DISCOVERY_HPP
+#define EDGE_DISCOVERY_HPP
+
+#include <Arduino.h>
+#include "zone_protocol.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#ifndef EDGE_ENABLED
+#define EDGE_ENABLED 1
+#endif
+// Service type without the underscores, as ESPmDNS's queryService() takes it
+#ifndef EDGE_SERVICE
+#define EDGE_SERVICE "ptv-trmnl"
+#endif
+#ifndef EDGE_MAX_FAILURES
+#define EDGE_MAX_FAILURES 2       // failed polls through the relay before going direct
+#endif
+#ifndef EDGE_RETRY_MS
+#define EDGE_RETRY_MS 900000UL    // look for a relay again this long after the last look
+#endif
+#ifndef EDGE_URL_MAX
+#define EDGE_URL_MAX 32           // "http://255.255.255.255:65535"
+#endif
+
+/** True if a relay's TXT "upstream" (host, or host:port) is the server ep points at. */
+static inline bool edgeServes(const char* upstream, const ServerEndpoint& ep) {
+    size_t hostLen = strcspn(upstream, ":");
+    if (hostLen != strlen(ep.host) || strncasecmp(upstream, ep.host, hostLen) != 0) return false;
+    return upstream[hostLen] != ':' || strtoul(upstream + hostLen + 1, nullptr, 10) == ep.port;
+}
+
+template <class MdnsT>
+class EdgeDiscovery {
+public:
+    /**
+     * Query the LAN for a relay of serverUrl and use the first one found.
+     * Blocks for the mDNS query. True if a relay is in use afterwards.
+     */
+    bool discover(MdnsT& mdns, const char* serverUrl, unsigned long now) {
+        _url[0] = '\0';
+        _failures = 0;
+        _nextLook = now + EDGE_RETRY_MS;
+        _looked = true;
+        ServerEndpoint ep;
+        if (!parseServerUrl(serverUrl, ep)) return false;
+        int n = mdns.queryService(EDGE_SERVICE, "tcp");
+        for (int i = 0; i < n; i++) {
+            if (!mdns.hasTxt(i, "upstream") || !edgeServes(mdns.txt(i, "upstream").c_str(), ep)) continue;
+            uint16_t port = mdns.port(i);
+            if (!port) continue;
+            snprintf(_url, sizeof(_url), "http://%s:%u", mdns.IP(i).toString().c_str(), (unsigned)port);
+            _found++;
+            return true;
+        }
+        return false;
+    }
+
+    /** Base URL for requests: the relay while one is in use, otherwise direct. */
+    const char* url(const char* direct) const { return _url[0] ? _url : direct; }
+    bool active() const { return _url[0] != '\0'; }
+
+    void succeeded() { _failures = 0; }
+
+    /** A request through the relay failed. True if that dropped it; the caller is direct from now on. */
+    bool failed(unsigned long now) {
+        if (!_url[0] || ++_failures < EDGE_MAX_FAILURES) return false;
+        _url[0] = '\0';
+        _failures = 0;
+        _nextLook = now + EDGE_RETRY_MS;
+        _dropped++;
+        return true;
+    }
+
+    /** Direct, and it is time to look for a relay again. */
+    bool due(unsigned long now) const { return _looked && !_url[0] && (long)(now - _nextLook) >= 0; }
+
+    uint32_t found() const { return _found; }
+    uint32_t dropped() const { return _dropped; }
+
+private:
+    char _url[EDGE_URL_MAX] = "";
+    uint8_t _failures = 0;
+    bool _looked = false;
+    unsigned long _nextLook = 0;
+    uint32_t _found = 0;
+    uint32_t _dropped = 0;
+};
+
+#endif // EDGE_DISCOVERY_HPP
@@ -0,0 +1,224 @@
+/**
+ * Energy accounting and battery-aware refresh cadence
+ *
+ * The board has no current sensor, so charge is modelled from what the
+ * firmware already knows:
+ *   awake     time the loop ran (WakeLoop::awakeUs) at ENERGY_MA_AWAKE
+ *   idle      time it waited (WakeLoop::waitUs) at the wake mode's idle current
+ *   tls       TLS handshakes: the CPU burst on top of the awake baseline
+ *   rx        bytes received: radio time on top of the awake baseline
+ *   panel     partial and full waveforms, on the panel's own rail
+ * Totals are kept per cycle and per hour. The hourly breakdown is logged
+ * with the battery level and the hours that level would last at this rate.
+ *
+ * Battery level is read from the PIN_BATTERY divider. energyTier() maps it
+ * to a cadence: on USB or above ENERGY_SAVER_PCT the normal 20s poll and
+ * 5 min full refresh, then progressively longer intervals and fewer full
+ * refreshes at 50%, 20% and 8%. It only climbs back a tier once the level
+ * is ENERGY_HYSTERESIS_PCT clear of the threshold, so a sagging cell
+ * doesn't flap between tiers.
+ *
+ *   EnergyModel energy;
+ *   energy.tlsHandshake(); energy.received(bytes);           // per request
+ *   energy.sample(wake.awakeUs(), wake.waitUs(), wake.idleMa(),
+ *                 panel.refreshCount(false), panel.refreshCount(true));
+ *   float mAh = energy.endCycle();
+ *
+ * Charge figures are estimates for an ESP32-C3 and the 7.5" UC8179 panel,
+ * not measurements; override them per board.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef ENERGY_MODEL_HPP
+#define ENERGY_MODEL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Incremental charge per event, mA·s
+#ifndef ENERGY_MAS_TLS_HANDSHAKE
+#define ENERGY_MAS_TLS_HANDSHAKE 30.0f   // ~300ms of ECDHE at 160 MHz over the awake baseline
+#endif
+#ifndef ENERGY_MAS_PER_KB
+#define ENERGY_MAS_PER_KB 0.4f           // RX at ~1 Mbit/s effective, ~50 mA over baseline
+#endif
+#ifndef ENERGY_MAS_PARTIAL
+#define ENERGY_MAS_PARTIAL 9.0f          // ~0.6s at 15 mA
+#endif
+#ifndef ENERGY_MAS_FULL
+#define ENERGY_MAS_FULL 70.0f            // ~3.5s at 20 mA
+#endif
+#ifndef ENERGY_MA_AWAKE
+#define ENERGY_MA_AWAKE 80.0f            // CPU at speed, radio associated
+#endif
+
+#ifndef ENERGY_BATTERY_MAH
+#define ENERGY_BATTERY_MAH 1800.0f
+#endif
+
+#ifndef ENERGY_REPORT_MS
+#define ENERGY_REPORT_MS 3600000UL
+#endif
+
+// PIN_BATTERY sits behind a 1:2 divider
+#ifndef BATTERY_DIVIDER
+#define BATTERY_DIVIDER 2
+#endif
+// Below this the pin is floating (no cell fitted): treat as external power
+#ifndef BATTERY_MIN_MV
+#define BATTERY_MIN_MV 2500
+#endif
+// Only the charger holds a cell this high
+#ifndef BATTERY_EXTERNAL_MV
+#define BATTERY_EXTERNAL_MV 4250
+#endif
+
+#ifndef ENERGY_SAVER_PCT
+#define ENERGY_SAVER_PCT 50
+#endif
+#ifndef ENERGY_LOW_PCT
+#define ENERGY_LOW_PCT 20
+#endif
+#ifndef ENERGY_CRITICAL_PCT
+#define ENERGY_CRITICAL_PCT 8
+#endif
+#ifndef ENERGY_HYSTERESIS_PCT
+#define ENERGY_HYSTERESIS_PCT 3
+#endif
+
+struct BatteryState {
+    uint16_t mv = 0;           // cell voltage
+    uint8_t percent = 100;
+    bool external = true;      // USB, or no cell to measure
+};
+
+/** Remaining charge of a LiPo cell from its resting voltage. */
+static inline uint8_t batteryPercent(uint16_t mv) {
+    static const uint16_t curve[][2] = {
+        {4200, 100}, {4100, 90}, {4000, 79}, {3900, 66}, {3800, 52}, {3750, 42},
+        {3700, 30}, {3650, 20}, {3600, 12}, {3500, 5}, {3300, 0},
+    };
+    const int n = sizeof(curve) / sizeof(curve[0]);
+    if (mv >= curve[0][0]) return 100;
+    for (int i = 1; i < n; i++) {
+        if (mv >= curve[i][0]) {
+            uint32_t span = curve[i - 1][0] - curve[i][0];
+            return (uint8_t)(curve[i][1] + (uint32_t)(mv - curve[i][0]) * (curve[i - 1][1] - curve[i][1]) / span);
+        }
+    }
+    return 0;
+}
+
+/** BatteryState from the millivolts measured at PIN_BATTERY. */
+static inline BatteryState batteryFromPin(uint32_t pinMv) {
+    BatteryState b;
+    uint32_t mv = pinMv * BATTERY_DIVIDER;
+    b.mv = (uint16_t)(mv > 65535 ? 65535 : mv);
+    b.external = mv < BATTERY_MIN_MV || mv >= BATTERY_EXTERNAL_MV;
+    b.percent = b.external ? 100 : batteryPercent(b.mv);
+    return b;
+}
+
+enum EnergyTier : uint8_t { ENERGY_NORMAL, ENERGY_SAVER, ENERGY_LOW, ENERGY_CRITICAL };
+
+struct EnergyCadence {
+    uint32_t pollMs;           // interval poll while the push stream is down
+    uint32_t fullMs;           // time between full refreshes
+    uint8_t partialsPerFull;   // partial refreshes before a full one is forced
+};
+
+static inline EnergyCadence energyCadence(EnergyTier tier) {
+    static const EnergyCadence table[] = {
+        {20000, 300000, 30},       // normal
+        {30000, 600000, 45},       // saver
+        {60000, 1800000, 60},      // low
+        {300000, 3600000, 90},     // critical
+    };
+    return table[tier <= ENERGY_CRITICAL ? tier : ENERGY_CRITICAL];
+}
+
+static inline const char* energyTierName(EnergyTier tier) {
+    static const char* names[] = {"normal", "saver", "low", "critical"};
+    return names[tier <= ENERGY_CRITICAL ? tier : ENERGY_CRITICAL];
+}
+
+/** Tier for this battery level; drops at once, recovers only past the hysteresis band. */
+static inline EnergyTier energyTier(const BatteryState& b, EnergyTier current) {
+    if (b.external) return ENERGY_NORMAL;
+    static const uint8_t floor[] = {ENERGY_SAVER_PCT, ENERGY_LOW_PCT, ENERGY_CRITICAL_PCT};
+    EnergyTier want = ENERGY_NORMAL;
+    for (int i = 0; i < 3; i++) if (b.percent < floor[i]) want = (EnergyTier)(i + 1);
+    if (want >= current) return want;
+    // Climbing: each tier above `want` up to current needs its threshold plus the band
+    while (current > want && b.percent >= floor[current - 1] + ENERGY_HYSTERESIS_PCT) current = (EnergyTier)(current - 1);
+    return current;
+}
+
+/** Modelled charge by where it went, mA·s. */
+struct EnergyBreakdown {
+    float awake = 0, idle = 0, tls = 0, rx = 0, panel = 0;
+    uint32_t handshakes = 0, partial = 0, full = 0;
+    uint64_t bytes = 0;
+
+    float total() const { return awake + idle + tls + rx + panel; }
+    float mAh() const { return total() / 3600.0f; }
+    void add(const EnergyBreakdown& o) {
+        awake += o.awake; idle += o.idle; tls += o.tls; rx += o.rx; panel += o.panel;
+        handshakes += o.handshakes; partial += o.partial; full += o.full; bytes += o.bytes;
+    }
+};
+
+class EnergyModel {
+public:
+    void tlsHandshake() { _cycle.handshakes++; _cycle.tls += ENERGY_MAS_TLS_HANDSHAKE; }
+    void received(size_t bytes) { _cycle.bytes += bytes; _cycle.rx += ENERGY_MAS_PER_KB * (float)bytes / 1024.0f; }
+
+    /**
+     * Fold in the cumulative counters kept elsewhere (WakeLoop time, panel
+     * refreshes); only what changed since the last sample is charged.
+     */
+    void sample(uint64_t awakeUs, uint64_t waitUs, float idleMa, uint32_t partials, uint32_t fulls) {
+        if (_sampled) {
+            _cycle.awake += (float)(awakeUs - _awakeUs) / 1e6f * ENERGY_MA_AWAKE;
+            _cycle.idle += (float)(waitUs - _waitUs) / 1e6f * idleMa;
+            uint32_t p = partials - _partials, f = fulls - _fulls;
+            _cycle.partial += p; _cycle.full += f;
+            _cycle.panel += p * ENERGY_MAS_PARTIAL + f * ENERGY_MAS_FULL;
+        }
+        _sampled = true;
+        _awakeUs = awakeUs; _waitUs = waitUs; _partials = partials; _fulls = fulls;
+    }
+
+    /** Close the cycle: returns its mAh and moves it into the hour. */
+    float endCycle() {
+        float mAh = _cycle.mAh();
+        _hour.add(_cycle);
+        _cycle = EnergyBreakdown();
+        return mAh;
+    }
+
+    /** True once every ENERGY_REPORT_MS; the caller logs hour() then calls nextHour(). */
+    bool hourDue(unsigned long nowMs) const { return nowMs - _hourStart >= ENERGY_REPORT_MS; }
+    const EnergyBreakdown& hour() const { return _hour; }
+    uint32_t hourMs(unsigned long nowMs) const { return (uint32_t)(nowMs - _hourStart); }
+    void nextHour(unsigned long nowMs) { _hour = EnergyBreakdown(); _hourStart = nowMs; }
+
+    /** Hours a battery at `percent` lasts at the rate of the hour so far; 0 if unknown. */
+    float hoursLeft(uint8_t percent, unsigned long nowMs) const {
+        uint32_t ms = hourMs(nowMs);
+        if (!ms || _hour.total() <= 0) return 0;
+        float mAhPerHour = _hour.mAh() * 3600000.0f / (float)ms;
+        return ENERGY_BATTERY_MAH * percent / 100.0f / mAhPerHour;
+    }
+
+private:
+    EnergyBreakdown _cycle, _hour;
+    bool _sampled = false;
+    uint64_t _awakeUs = 0, _waitUs = 0;
+    uint32_t _partials = 0, _fulls = 0;
+    unsigned long _hourStart = 0;
+};
+
+#endif // ENERGY_MODEL_HPP
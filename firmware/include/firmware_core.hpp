@@ -0,0 +1,886 @@
+/**
+ * Firmware core: one setup() and loop() for the single-request firmwares
+ *
+ * src/main.cpp is a FirmwareCore put together from three strategies, each
+ * a plain class picked at compile time, so a build env can swap one and
+ * keep the rest:
+ *
+ *   Transport  how a URL becomes bytes: HttpsTransport (a TLS connection
+ *              per request), HttpsKeepAliveTransport (one per cycle),
+ *              HttpTransport (plain, kept alive; for a server on the LAN)
+ *   Decoder    what is asked for and how it lands in the framebuffer:
+ *              ImageDecoder (/api/image, one full-screen BMP) or
+ *              ZoneJsonDecoder (V11 /api/zones JSON with base64 zone BMPs)
+ *   Refresh    how drawn regions reach the glass: FullRefresh,
+ *              PartialRefresh (a full one every 20 partials or 10 min) or
+ *              FlashRefresh (each zone flashed black first; every 30 or 5 min)
+ *
+ *   typedef FirmwareCore<HttpsTransport, ZoneJsonDecoder, FlashRefresh> Core;
+ *   Core core(bbep, panel);
+ *   void setup() { core.setup(); }
+ *   void loop() { core.loop(); }
+ *
+ * The core does the rest once: WiFiManager with the server URL kept in
+ * Preferences, the poll interval, jittered retries after a failed fetch
+ * with a circuit breaker behind them (include/net_retry.hpp), and after
+ * every poll one "Cycle" line - fetch, draw and refresh time, requests,
+ * bytes, free heap, its low-water mark and the largest block - in the
+ * same format whatever the strategies, so two builds left running side
+ * by side compare with host/bench/compare-core.py. Everything else goes
+ * through include/trmnl_log.hpp, drained once a loop as zones-v12 does.
+ *
+ * A fourth, optional strategy carries what a firmware does around the
+ * poll rather than in it:
+ *
+ *   Extras     CoreExtras (nothing: poll on the interval, sleep a second)
+ *              or the zone firmware's push channel, button pages, offline
+ *              timetable, prefetch and daily updates (src/zones-v12.cpp,
+ *              which is FirmwareCore<ZoneTransport, ZoneDecoder,
+ *              ZoneRefresh, ZoneExtras>)
+ *
+ * Its hooks are called from loop() in this order: front() before anything
+ * touches the network, offline() when WiFi won't connect, connected() and
+ * disconnected(), service() each loop once online, due() to ask whether a
+ * poll should run, failed() or polled() after one, after() and idle() to
+ * end the loop.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef FIRMWARE_CORE_HPP
+#define FIRMWARE_CORE_HPP
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <WiFiManager.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include <bb_epaper.h>
+#include <panel_async.hpp>       // <>: the replay harness puts its own first
+#include "soc/soc.h"
+#include "soc/rtc_cntl_reg.h"
+#include "config.h"
+#include "base64.hpp"
+#include "net_resume.hpp"
+#include "net_retry.hpp"
+#include "panel_hal.hpp"
+#include "profile.hpp"
+#include "trmnl_log.hpp"
+#include "zone_tiles.hpp"
+
+#ifndef CORE_FIRMWARE_VERSION
+#define CORE_FIRMWARE_VERSION "5.34"
+#endif
+
+// Used until the portal saves one; "" for none, and the firmware waits for it
+#ifndef CORE_DEFAULT_SERVER_URL
+#define CORE_DEFAULT_SERVER_URL "https://ptvtrmnl.vercel.app"
+#endif
+
+#ifndef CORE_AP_NAME
+#define CORE_AP_NAME "PTV-TRMNL-Setup"
+#endif
+
+// "Connecting..." and "CONNECTED!" full-screen refreshes around the WiFi connect
+#ifndef CORE_STATUS_SCREENS
+#define CORE_STATUS_SCREENS 1
+#endif
+
+// Between polls
+#ifndef CORE_INTERVAL_MS
+#define CORE_INTERVAL_MS 20000UL
+#endif
+
+// Network budget for one poll, every request and resume included
+#ifndef CORE_CYCLE_MS
+#define CORE_CYCLE_MS 30000
+#endif
+
+#ifndef CORE_URL_MAX
+#define CORE_URL_MAX 192
+#endif
+
+// ImageDecoder: the whole-screen BMP (800x480 at 1 bpp is 48062 bytes)
+#ifndef CORE_IMAGE_MAX
+#define CORE_IMAGE_MAX 50000
+#endif
+
+// ZoneJsonDecoder: caps on the response and on a zone's decoded BMP; each
+// is allocated at its actual size for one poll (larger zones stream as tiles)
+#ifndef CORE_ZONES_JSON_MAX
+#define CORE_ZONES_JSON_MAX 65536
+#endif
+#ifndef CORE_MAX_ZONES
+#define CORE_MAX_ZONES 6
+#endif
+#ifndef CORE_ZONE_ID_MAX
+#define CORE_ZONE_ID_MAX 32
+#endif
+#ifndef CORE_ZONE_BMP_MAX
+#define CORE_ZONE_BMP_MAX 20000
+#endif
+
+// The panel's traits (include/panel_hal.hpp) and its bb_epaper type
+#ifndef PANEL_MODEL
+#define PANEL_MODEL PanelTrmnl75
+#define PANEL_BB_TYPE EP75_800x480
+#endif
+typedef PANEL_MODEL CorePanel;
+static_assert(CorePanel::ROTATION == 0 && CorePanel::MSB_FIRST, "tile streams and loadBMP draw an upright, MSB-first panel");
+
+struct CoreRect { int x, y, w, h; };
+
+/** server + "/" + path, without doubling the slash. False if it doesn't fit. */
+static inline bool coreUrl(char* out, size_t size, const char* server, const char* path) {
+    size_t n = strlen(server);
+    int len = snprintf(out, size, "%s%s%s", server, n && server[n - 1] == '/' ? "" : "/", path);
+    return len > 0 && (size_t)len < size;
+}
+
+// ---------------------------------------------------------------------------
+// Transports
+
+// The sketches have never checked the server's certificate
+static inline void coreClientSetup(WiFiClientSecure& c) { c.setInsecure(); }
+static inline void coreClientSetup(WiFiClient&) {}
+static inline const char* coreClientName(WiFiClientSecure*, bool reuse) { return reuse ? "https-ka" : "https"; }
+static inline const char* coreClientName(WiFiClient*, bool reuse) { return reuse ? "http-ka" : "http"; }
+
+/**
+ * HTTP GETs on one client. With REUSE the connection stays up between the
+ * requests of a poll (HTTP/1.1 keep-alive) and is closed by close() at the
+ * end of it; without, every request connects afresh, as the sketches did.
+ */
+template <class ClientT, bool REUSE>
+class CoreHttp {
+public:
+    static const char* name() { return coreClientName((ClientT*)nullptr, REUSE); }
+
+    /**
+     * GET url into buf, at most cap bytes. A body that stops short is asked
+     * for again from where it stopped (include/net_resume.hpp). Returns its
+     * length, -1 on failure.
+     */
+    long get(const char* url, const char* accept, uint8_t* buf, size_t cap, const NetDeadline& cycle) {
+        return read(url, accept, buf, cap, false, cycle);
+    }
+
+    /**
+     * get() into a buffer malloc'd for the body: as large as its
+     * Content-Length, at most cap. A body with no length is read into cap
+     * bytes and trimmed to what came. On success the caller frees buf; on
+     * failure there is nothing to free.
+     */
+    long getSized(const char* url, const char* accept, uint8_t*& buf, size_t cap, const NetDeadline& cycle) {
+        buf = nullptr;
+        return read(url, accept, buf, cap, true, cycle);
+    }
+
+    /**
+     * GET url and hand the body to sink(data, n) as it arrives, until the
+     * body ends or the sink returns false. True if the body was read to
+     * its end.
+     */
+    template <class Sink>
+    bool stream(const char* url, const char* accept, Sink& sink, const NetDeadline& cycle) {
+        NetResume none;
+        int code = request(url, accept, cycle, none);
+        if (code != 200) {
+            LOG_WARN("HTTP %d: %s", code, url);
+            finish(false);
+            return false;
+        }
+        long left = _http.getSize();
+        NetReader<WiFiClient> rd(*_http.getStreamPtr(), cycle);
+        uint8_t chunk[256];
+        bool more = true;
+        while (more && left != 0) {
+            int r = rd.read(chunk, left > 0 && left < (long)sizeof(chunk) ? (size_t)left : sizeof(chunk));
+            if (r <= 0) break;
+            if (left > 0) left -= r;
+            more = sink(chunk, (size_t)r);
+        }
+        _bytes += rd.bytes();
+        finish(left == 0);
+        return left == 0 || (left < 0 && rd.status() == NET_EOF);
+    }
+
+    /** The poll is over: drop a kept-alive connection. */
+    void close() { _client.stop(); }
+
+    void reset() { _requests = 0; _bytes = 0; }
+    int requests() const { return _requests; }
+    size_t bytes() const { return _bytes; }
+
+private:
+    long read(const char* url, const char* accept, uint8_t*& buf, size_t cap, bool own, const NetDeadline& cycle) {
+        NetResume body;
+        NetStatus status = NET_OK;
+        size_t size = 0;
+        do {
+            int code = request(url, accept, cycle, body);
+            // No length (chunked, or until close): nothing to resume by, read it whole
+            if (code == 200 && _http.getSize() < 0) return whole(url, buf, cap, own, cycle);
+            long at = body.start(code, _http.getSize(), _http.header("Content-Range").c_str(), _http.header("ETag").c_str(),
+                                 _http.header("X-Body-CRC").c_str(), cap);
+            if (at < 0) {
+                LOG_WARN("HTTP %d, size %d: %s", code, _http.getSize(), url);
+                finish(false);
+                return drop(buf, own);
+            }
+            // The first response, or a 200 that started over at another length
+            if (own && body.total() != size) {
+                uint8_t* p = (uint8_t*)realloc(buf, body.total());
+                if (!p) {
+                    LOG_WARN("No memory for %u bytes: %s", (unsigned)body.total(), url);
+                    finish(false);
+                    return drop(buf, own);
+                }
+                buf = p;
+                size = body.total();
+            }
+            NetReader<WiFiClient> rd(*_http.getStreamPtr(), cycle);
+            body.advance(buf + at, rd.readFully(buf + at, body.want()));
+            status = rd.status();
+            _bytes += rd.bytes();
+            finish(body.complete());
+            if (at) LOG_INFO("Resumed at %ld: %u/%u bytes", at, (unsigned)body.got(), (unsigned)body.total());
+        } while (!body.complete() && body.retry(status, millis()));
+        if (!body.verified()) {
+            LOG_WARN("%s: %s", body.complete() ? "CRC mismatch" : "Transfer incomplete", url);
+            return drop(buf, own);
+        }
+        return (long)body.total();
+    }
+
+    static long drop(uint8_t*& buf, bool own) {
+        if (own) { free(buf); buf = nullptr; }
+        return -1;
+    }
+
+    int request(const char* url, const char* accept, const NetDeadline& cycle, NetResume& body) {
+        static const char* keys[] = {"Content-Range", "ETag", "X-Body-CRC", "Transfer-Encoding"};
+        _requests++;
+        coreClientSetup(_client);
+        netArm(_http, cycle);
+        _http.setReuse(REUSE);
+        _http.collectHeaders(keys, 4);
+        if (!_http.begin(_client, url)) return -1;
+        _http.addHeader("User-Agent", "PTV-TRMNL/" CORE_FIRMWARE_VERSION);
+        _http.addHeader("Accept", accept);
+        if (body.resuming()) {
+            _http.addHeader("Range", body.range());
+            _http.addHeader("If-Range", body.etag());
+        }
+        return _http.GET();
+    }
+
+    /**
+     * A body with no length, read through the cycle's deadline like any
+     * other (netReadUnsized): de-chunked, or everything up to the close.
+     */
+    long whole(const char* url, uint8_t*& buf, size_t cap, bool own, const NetDeadline& cycle) {
+        if (own && !(buf = (uint8_t*)malloc(cap))) {
+            LOG_WARN("No memory for %u bytes: %s", (unsigned)cap, url);
+            finish(false);
+            return -1;
+        }
+        NetReader<WiFiClient> rd(*_http.getStreamPtr(), cycle);
+        bool chunked = _http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+        size_t got;
+        bool ok = netReadUnsized(rd, chunked, buf, cap, got);
+        _bytes += rd.bytes();
+        finish(ok && chunked);
+        if (!ok || !got) {
+            LOG_WARN("Body %s after %u bytes (room for %u, %s): %s", ok ? "empty" : "cut short", (unsigned)got,
+                     (unsigned)cap, netStatusName(rd.status()), url);
+            return drop(buf, own);
+        }
+        if (own) {
+            uint8_t* p = (uint8_t*)realloc(buf, got);
+            if (p) buf = p;
+        }
+        return (long)got;
+    }
+
+    // A connection with part of a body still unread can't carry the next request
+    void finish(bool clean) {
+        if (!clean) _client.stop();
+        _http.end();
+    }
+
+    ClientT _client;
+    HTTPClient _http;
+    int _requests = 0;
+    size_t _bytes = 0;
+};
+
+typedef CoreHttp<WiFiClientSecure, false> HttpsTransport;
+typedef CoreHttp<WiFiClientSecure, true> HttpsKeepAliveTransport;
+typedef CoreHttp<WiFiClient, true> HttpTransport;
+
+// ---------------------------------------------------------------------------
+// Decoders
+//
+// fetch() asks the server what changed and holds it; regions() and rect()
+// say where it goes, draw() puts one region in the framebuffer and
+// returns what it drew: -1 if it failed, 0 if nothing had changed after
+// all, otherwise a count (tiles, ops; 1 for a whole BMP). release() ends
+// the poll, fetched or not.
+
+/**
+ * /api/image: the whole screen as one BMP, drawn over a white frame. A
+ * frame identical to the one on the panel is not drawn again unless the
+ * refresh policy asked for everything.
+ */
+class ImageDecoder {
+public:
+    static const char* name() { return "image"; }
+
+    bool begin() {
+        _bmp = (uint8_t*)malloc(CORE_IMAGE_MAX);
+        return _bmp != nullptr;
+    }
+
+    template <class Net>
+    bool fetch(Net& net, const char* server, bool whole, const NetDeadline& cycle) {
+        char url[CORE_URL_MAX];
+        if (!coreUrl(url, sizeof(url), server, "api/image")) return false;
+        long len = net.get(url, "image/bmp", _bmp, CORE_IMAGE_MAX, cycle);
+        if (len < 0) return false;
+        if (len < 54 || _bmp[0] != 'B' || _bmp[1] != 'M') {
+            LOG_WARN("Invalid BMP");
+            return false;
+        }
+        uint32_t crc = ttCrc32(_bmp, (size_t)len);
+        _changed = whole || !_shown || crc != _crc;
+        _crc = crc;
+        _len = (size_t)len;
+        return true;
+    }
+
+    int regions() const { return _changed ? 1 : 0; }
+    CoreRect rect(int) const { CoreRect r = { 0, 0, CorePanel::W, CorePanel::H }; return r; }
+
+    template <class Net>
+    int draw(Net&, const char*, BBEPAPER& bbep, int, const NetDeadline&) {
+        PROFILE_SCOPE(PROF_BLIT);
+        bbep.fillScreen(BBEP_WHITE);
+        int r = panelBlitBmp<CorePanel>(bbep.getBuffer(), 0, 0, _bmp, _len) ? BBEP_SUCCESS
+                : bbep.loadBMP(_bmp, 0, 0, BBEP_BLACK, BBEP_WHITE);
+        if (r != BBEP_SUCCESS) LOG_WARN("loadBMP err: %d", r);
+        _shown = r == BBEP_SUCCESS;
+        return _shown ? 1 : -1;
+    }
+
+    /** Nothing to give back: the one buffer is reused by every poll. */
+    void release() {}
+
+private:
+    uint8_t* _bmp = nullptr;
+    size_t _len = 0;
+    uint32_t _crc = 0;
+    bool _changed = false, _shown = false;
+};
+
+/** Feeds a tile stream to its decoder until the stream is over. */
+struct CoreTileSink {
+    TileStreamDecoder& dec;
+    bool operator()(const uint8_t* data, size_t n) { dec.feed(data, n); return !dec.done() && !dec.error(); }
+};
+
+#ifdef ARDUINOJSON_VERSION
+/**
+ * V11 /api/zones?batch=0: a JSON list of zones, each changed one carrying
+ * its BMP as base64. Nothing is held between polls: the response goes
+ * into a buffer the size of its Content-Length, freed as soon as it is
+ * parsed (the JsonDocument has its own copy of every string), and each
+ * changed zone is decoded from the document into a BMP of its own, freed
+ * once drawn. A zone too large to inline is streamed from
+ * /api/zone/<id>/tiles instead, with no size limit.
+ */
+class ZoneJsonDecoder {
+public:
+    static const char* name() { return "zones-json"; }
+
+    ~ZoneJsonDecoder() { release(); }
+
+    bool begin() { return true; }
+
+    template <class Net>
+    bool fetch(Net& net, const char* server, bool whole, const NetDeadline& cycle) {
+        release();
+        char url[CORE_URL_MAX];
+        if (!coreUrl(url, sizeof(url), server, whole ? "api/zones?batch=0&force=true" : "api/zones?batch=0")) return false;
+        uint8_t* body;
+        long len = net.getSized(url, "application/json", body, CORE_ZONES_JSON_MAX, cycle);
+        if (len < 0) return false;
+
+        JsonDocument doc;
+        DeserializationError err;
+        { PROFILE_SCOPE(PROF_JSON_PARSE); err = deserializeJson(doc, (const char*)body, (size_t)len); }
+        free(body);
+        if (err) {
+            LOG_WARN("JSON error: %s", err.c_str());
+            return false;
+        }
+        for (JsonObject z : doc["zones"].as<JsonArray>()) {
+            const char* data = z["data"] | (const char*)nullptr;
+            if (!(z["changed"] | false) || !data) continue;
+            if (_count == CORE_MAX_ZONES) break;
+            Zone& zone = _zones[_count++];
+            snprintf(zone.id, sizeof(zone.id), "%s", (const char*)(z["id"] | "unknown"));
+            zone.rect.x = z["x"] | 0;
+            zone.rect.y = z["y"] | 0;
+            zone.rect.w = z["w"] | 0;
+            zone.rect.h = z["h"] | 0;
+            size_t n = strlen(data);
+            size_t size = decode_base64_length((const unsigned char*)data, n);
+            if (size > CORE_ZONE_BMP_MAX) {
+                LOG_DEBUG("Zone %s BMP too large (%u), streaming tiles", zone.id, (unsigned)size);
+                continue;
+            }
+            if (!(zone.bmp = (uint8_t*)malloc(size))) {
+                LOG_WARN("Zone %s: no memory for %u bytes, streaming tiles", zone.id, (unsigned)size);
+                continue;
+            }
+            PROFILE_SCOPE(PROF_BASE64);
+            zone.len = decode_base64((const unsigned char*)data, n, zone.bmp);
+        }
+        LOG_DEBUG("Parsed %d changed zones", _count);
+        return true;
+    }
+
+    int regions() const { return _count; }
+    CoreRect rect(int i) const { return _zones[i].rect; }
+
+    template <class Net>
+    int draw(Net& net, const char* server, BBEPAPER& bbep, int i, const NetDeadline& cycle) {
+        Zone& z = _zones[i];
+        if (!z.bmp) return tiles(net, server, bbep, z, cycle);
+        bool ok = blit(bbep, z);
+        free(z.bmp);
+        z.bmp = nullptr;
+        return ok ? 1 : -1;
+    }
+
+    /** The poll is drawn: free what a zone that wasn't drawn still holds. */
+    void release() {
+        for (int i = 0; i < _count; i++) free(_zones[i].bmp);
+        memset(_zones, 0, sizeof(_zones));
+        _count = 0;
+    }
+
+private:
+    struct Zone {
+        char id[CORE_ZONE_ID_MAX];
+        CoreRect rect;
+        uint8_t* bmp;       // nullptr: streamed as tiles
+        size_t len;
+    };
+
+    static bool blit(BBEPAPER& bbep, const Zone& z) {
+        if (z.len < 2 || z.bmp[0] != 'B' || z.bmp[1] != 'M') {
+            LOG_WARN("Zone %s invalid BMP header", z.id);
+            return false;
+        }
+        PROFILE_SCOPE(PROF_BLIT);
+        // The server's plain 1 bpp BMPs go through the word blit; loadBMP takes anything else
+        int r = panelBlitBmp<CorePanel>(bbep.getBuffer(), z.rect.x, z.rect.y, z.bmp, z.len) ? BBEP_SUCCESS
+                : bbep.loadBMP(z.bmp, z.rect.x, z.rect.y, BBEP_BLACK, BBEP_WHITE);
+        if (r != BBEP_SUCCESS) LOG_WARN("Zone %s loadBMP failed: %d", z.id, r);
+        return r == BBEP_SUCCESS;
+    }
+
+    // Straight into the framebuffer; no hashes, the zone holds nothing worth keeping
+    template <class Net>
+    int tiles(Net& net, const char* server, BBEPAPER& bbep, const Zone& z, const NetDeadline& cycle) {
+        char path[CORE_ZONE_ID_MAX + 20], url[CORE_URL_MAX];
+        snprintf(path, sizeof(path), "api/zone/%s/tiles", z.id);
+        if (!coreUrl(url, sizeof(url), server, path)) return -1;
+        TileSurface fb = { bbep.getBuffer(), CorePanel::PITCH, CorePanel::W, CorePanel::H };
+        TileStreamDecoder dec;
+        dec.begin(fb, nullptr, 0);
+        CoreTileSink sink = { dec };
+        {
+            PROFILE_SCOPE(PROF_TILES);
+            net.stream(url, "application/octet-stream", sink, cycle);
+        }
+        LOG_DEBUG("Zone %s: %d tiles, %lu bytes", z.id, dec.applied(), (unsigned long)dec.bytes());
+        return dec.done() ? dec.applied() : -1;
+    }
+
+    Zone _zones[CORE_MAX_ZONES] = {};
+    int _count = 0;
+};
+#endif // ARDUINOJSON_VERSION
+
+// ---------------------------------------------------------------------------
+// Refresh policies
+//
+// wantsWhole() is asked before each poll: true has the decoder fetch
+// everything and present() end in a full refresh. present() draws the
+// poll's changed regions through the frame it is given and starts the
+// refresh; it returns true if that was a full one.
+
+/** A full refresh for every change: no ghosting, a few seconds of flashing each time. */
+class FullRefresh {
+public:
+    static const char* name() { return "full"; }
+
+    bool wantsWhole(unsigned long now, bool drawn) const { return !drawn; }
+
+    template <class Frame>
+    bool present(Frame& f, bool whole, unsigned long now) {
+        if (!f.regions()) return false;
+        for (int i = 0; i < f.regions(); i++) f.draw(i);
+        f.panel().refresh(REFRESH_FULL);
+        return true;
+    }
+};
+
+/** Everything drawn, then one partial refresh; a full one after MAX_PARTIALS of them or FULL_MS. */
+template <int MAX_PARTIALS, unsigned long FULL_MS>
+class PartialEvery {
+public:
+    static const char* name() { return "partial"; }
+
+    bool wantsWhole(unsigned long now, bool drawn) const {
+        return !drawn || now - _lastFull >= FULL_MS || _partials >= MAX_PARTIALS;
+    }
+
+    template <class Frame>
+    bool present(Frame& f, bool whole, unsigned long now) {
+        if (!f.regions()) return false;
+        for (int i = 0; i < f.regions(); i++) f.draw(i);
+        if (whole) return full(f, now);
+        f.panel().refresh(REFRESH_PARTIAL);
+        _partials++;
+        return false;
+    }
+
+protected:
+    template <class Frame>
+    bool full(Frame& f, unsigned long now) {
+        f.panel().refresh(REFRESH_FULL);
+        _lastFull = now;
+        _partials = 0;
+        return true;
+    }
+
+    unsigned long _lastFull = 0;
+    int _partials = 0;
+};
+
+/**
+ * As PartialEvery, but each changed zone is first filled black and
+ * refreshed, then drawn while that waveform runs and refreshed again:
+ * the black flash clears the zone's ghost. Two partials per zone.
+ */
+template <int MAX_PARTIALS, unsigned long FULL_MS>
+class FlashEvery : public PartialEvery<MAX_PARTIALS, FULL_MS> {
+public:
+    static const char* name() { return "flash"; }
+
+    template <class Frame>
+    bool present(Frame& f, bool whole, unsigned long now) {
+        if (!f.regions()) return false;
+        if (whole) {
+            for (int i = 0; i < f.regions(); i++) f.draw(i);
+            return this->full(f, now);
+        }
+        for (int i = 0; i < f.regions(); i++) {
+            CoreRect r = f.rect(i);
+            {
+                PROFILE_SCOPE(PROF_FLASH);
+                f.panel().waitIdle();
+                panelFill<CorePanel>(f.buffer(), r.x, r.y, r.w, r.h, false);
+                f.panel().refresh(REFRESH_PARTIAL);
+            }
+            // Decoded into RAM while the flash runs; white if it can't be drawn
+            if (f.draw(i) < 0) panelFill<CorePanel>(f.buffer(), r.x, r.y, r.w, r.h, true);
+            f.panel().refresh(REFRESH_PARTIAL);
+            this->_partials++;
+        }
+        return false;
+    }
+};
+
+typedef PartialEvery<20, 600000UL> PartialRefresh;
+typedef FlashEvery<30, 300000UL> FlashRefresh;
+
+// ---------------------------------------------------------------------------
+// Extras
+
+/** Nothing around the poll: one on the interval (and straight away until something is drawn), a second's sleep between loops. */
+class CoreExtras {
+public:
+    template <class Core> void begin(Core&) {}
+    template <class Core> bool front(Core&) { return false; }
+    template <class Core> void offline(Core&) {}
+    template <class Core> void connected(Core&) {}
+    template <class Core> void disconnected(Core&) {}
+    template <class Core> void service(Core&) {}
+
+    template <class Core>
+    bool due(Core& core, unsigned long now, bool, bool) {
+        return !core.polls() || !core.drawn() || now - core.lastPoll() >= CORE_INTERVAL_MS;
+    }
+
+    /** A poll failed; true goes straight round the loop instead of idling. */
+    template <class Core> bool failed(Core&) { return false; }
+    /** A poll was drawn; full if it ended in a full refresh. */
+    template <class Core> void polled(Core&, bool) {}
+    template <class Core> void after(Core&) {}
+    template <class Core> void idle(Core&) { delay(1000); }
+};
+
+// ---------------------------------------------------------------------------
+
+template <class Transport, class Decoder, class Refresh, class Extras = CoreExtras>
+class FirmwareCore {
+public:
+    FirmwareCore(BBEPAPER& bbep, PanelAsync& panel)
+        : _bbep(bbep), _panel(panel), _serverParam("server", "Server URL (e.g. https://your-app.vercel.app)", "", 120) {}
+
+    void setup() {
+        WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
+        Serial.begin(115200);
+        delay(500);
+        LOG_INFO("PTV-TRMNL v%s %s/%s/%s", CORE_FIRMWARE_VERSION, Transport::name(), Decoder::name(), Refresh::name());
+        _wifi = false;
+
+        bool configured = loadServer();
+        if (!configured && CORE_DEFAULT_SERVER_URL[0]) {
+            LOG_INFO("No server configured, using default");
+            saveServer(CORE_DEFAULT_SERVER_URL);
+        }
+        _ready = _decoder.begin();
+        if (!_ready) LOG_ERROR("Failed to allocate decoder buffers");
+
+        _bbep.initIO(EPD_DC_PIN, EPD_RST_PIN, EPD_BUSY_PIN, EPD_CS_PIN, EPD_MOSI_PIN, EPD_SCK_PIN, EPD_SPI_HZ);
+        _bbep.setPanelType(PANEL_BB_TYPE);
+        _bbep.setRotation(CorePanel::ROTATION);
+        _bbep.allocBuffer(false);
+        _panel.begin();
+        pinMode(PIN_INTERRUPT, INPUT_PULLUP);
+        _extras.begin(*this);
+
+        if (!_ready) showError("Out of memory");
+        else if (!configured) { showWelcome(); delay(3000); }
+        LOG_INFO("Setup complete");
+    }
+
+    void loop() {
+        // What setup() and the last loop logged, before any of the early returns below
+        logDrain(Serial);
+        if (!_ready) { delay(10000); return; }
+        bool catchUp = _extras.front(*this);
+        if (!_wifi) {
+            connectWiFi();
+            if (!_wifi) { _extras.offline(*this); delay(5000); return; }
+            _drawn = false;
+            _retry.success();
+            _retry.seed(esp_random());     // with the radio up this is hardware entropy: no two devices retry in step
+            _extras.connected(*this);
+        }
+        if (WiFi.status() != WL_CONNECTED) {
+            LOG_WARN("WiFi disconnected");
+            _wifi = false;
+            _extras.disconnected(*this);
+            return;
+        }
+        if (!_server[0]) { delay(10000); return; }
+        _extras.service(*this);
+
+        unsigned long now = millis();
+        bool whole = _refresh.wantsWhole(now, _drawn);
+        if (_retry.ready(now) && _extras.due(*this, now, whole, catchUp)) {
+            _lastPoll = now;
+            if (!poll(now, whole) && _extras.failed(*this)) return;
+        }
+        _extras.after(*this);
+        _panel.poll();
+        logDrain(Serial);
+        PROFILE_DUMP(Serial, CORE_FIRMWARE_VERSION);
+        _extras.idle(*this);
+    }
+
+    const char* server() const { return _server; }
+    bool wifi() const { return _wifi; }
+    /** Something was drawn and ended in a full refresh since WiFi last came up. */
+    bool drawn() const { return _drawn; }
+    /** The panel no longer shows what the polls drew: the next one fetches everything. */
+    void redraw() { _drawn = false; }
+    unsigned long polls() const { return _polls; }
+    unsigned long lastPoll() const { return _lastPoll; }
+    const RetryPolicy& retry() const { return _retry; }
+
+private:
+    // What a refresh policy works on: the poll's changed regions and the panel
+    struct Frame {
+        FirmwareCore& core;
+        int regions() const { return core._decoder.regions(); }
+        CoreRect rect(int i) const { return core._decoder.rect(i); }
+        int draw(int i) { return core.drawRegion(i); }
+        PanelAsync& panel() { return core._panel; }
+        uint8_t* buffer() { return core._bbep.getBuffer(); }
+    };
+
+    bool poll(unsigned long now, bool whole) {
+        NetDeadline budget(CORE_CYCLE_MS);
+        _cycle = &budget;
+        _net.reset();
+        _drawMs = 0;
+        uint32_t partial = _panel.refreshCount(false), full = _panel.refreshCount(true);
+
+        unsigned long start = millis();
+        bool ok = _decoder.fetch(_net, _server, whole, budget);
+        unsigned long fetched = millis();
+        int regions = ok ? _decoder.regions() : 0;
+        bool wasFull = false;
+        if (ok) {
+            Frame f = { *this };
+            wasFull = _refresh.present(f, whole, now);
+            if (wasFull) _drawn = true;
+            _retry.success();
+        } else {
+            _retry.failure(millis());
+        }
+        _decoder.release();
+        _net.close();
+        unsigned long drawn = millis();
+        _cycle = nullptr;
+        _polls++;
+
+        // One line per poll, the same for every transport, decoder and policy: host/bench/compare-core.py reads it
+        Serial.printf("Cycle %lu ok=%d whole=%d regions=%d req=%d bytes=%lu fetch=%lums draw=%lums refresh=%lums "
+                      "partial=%lu full=%lu heap=%lu min=%lu block=%lu core=%s/%s/%s\n",
+                      _polls, ok, whole, regions, _net.requests(), (unsigned long)_net.bytes(),
+                      fetched - start, _drawMs, drawn - fetched - _drawMs,
+                      (unsigned long)(_panel.refreshCount(false) - partial), (unsigned long)(_panel.refreshCount(true) - full),
+                      (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(), (unsigned long)ESP.getMaxAllocHeap(),
+                      Transport::name(), Decoder::name(), Refresh::name());
+        if (!ok) LOG_WARN("Fetch failed (attempt %d), retry in %lums, breaker %s", _retry.failures(),
+                          (unsigned long)_retry.lastWaitMs(), retryStateName(_retry.state(millis())));
+        else _extras.polled(*this, wasFull);
+        return ok;
+    }
+
+    int drawRegion(int i) {
+        unsigned long start = millis();
+        int n = _decoder.draw(_net, _server, _bbep, i, *_cycle);
+        _drawMs += millis() - start;
+        return n;
+    }
+
+    void connectWiFi() {
+#if CORE_STATUS_SCREENS
+        showConnecting();
+#endif
+        WiFiManager wm;
+        wm.setConfigPortalTimeout(180);
+        _serverParam.setValue(_server, 120);
+        wm.addParameter(&_serverParam);
+        instance() = this;
+        wm.setSaveParamsCallback(onSaveParams);
+        _wifi = wm.autoConnect(CORE_AP_NAME);
+        if (!_wifi) {
+            LOG_WARN("WiFi connection failed");
+            return;
+        }
+        LOG_INFO("Connected: %s", WiFi.localIP().toString().c_str());
+#if CORE_STATUS_SCREENS
+        showConfigured();
+        delay(2000);
+#endif
+    }
+
+    static FirmwareCore*& instance() { static FirmwareCore* core = nullptr; return core; }
+
+    static void onSaveParams() {
+        FirmwareCore* core = instance();
+        const char* url = core ? core->_serverParam.getValue() : nullptr;
+        if (url && url[0]) core->saveServer(url);
+    }
+
+    bool loadServer() {
+        Preferences prefs;
+        prefs.begin("ptv-trmnl", true);
+        String url = prefs.getString("serverUrl", "");
+        prefs.end();
+        snprintf(_server, sizeof(_server), "%s", url.c_str());
+        LOG_INFO("Server: %s", _server[0] ? _server : "(not set)");
+        return _server[0] != '\0';
+    }
+
+    void saveServer(const char* url) {
+        snprintf(_server, sizeof(_server), "%s", url);
+        Preferences prefs;
+        prefs.begin("ptv-trmnl", false);
+        prefs.putString("serverUrl", _server);
+        prefs.end();
+        LOG_INFO("Settings saved. Server: %s", _server);
+    }
+
+    void beginScreen() {
+        _bbep.fillScreen(BBEP_WHITE);
+        _bbep.setFont(FONT_8x8);
+        _bbep.setTextColor(BBEP_BLACK, BBEP_WHITE);
+    }
+
+    void showWelcome() {
+        beginScreen();
+        _bbep.setCursor(220, 50); _bbep.print("PTV-TRMNL Smart Transit Display");
+        _bbep.setCursor(300, 80); _bbep.print("Firmware v" CORE_FIRMWARE_VERSION);
+        _bbep.drawRect(100, 120, 600, 250, BBEP_BLACK);
+        _bbep.setCursor(120, 140); _bbep.print("SETUP INSTRUCTIONS");
+        _bbep.setCursor(120, 180); _bbep.print("1. Connect to WiFi: " CORE_AP_NAME);
+        _bbep.setCursor(120, 210); _bbep.print("2. Open browser: 192.168.4.1");
+        _bbep.setCursor(120, 240); _bbep.print("3. Enter WiFi credentials");
+        _bbep.setCursor(120, 270); _bbep.print("4. Enter your server URL");
+        _bbep.setCursor(120, 300); _bbep.print("5. Visit [server]/setup to configure");
+        _bbep.setCursor(200, 400); _bbep.print("github.com/angusbergman17-cpu/PTV-TRMNL-NEW");
+        _bbep.setCursor(300, 430); _bbep.print("(c) 2026 Angus Bergman");
+        _bbep.refresh(REFRESH_FULL, true);
+    }
+
+    void showConnecting() {
+        beginScreen();
+        _bbep.setCursor(300, 220); _bbep.print("Connecting...");
+        _bbep.refresh(REFRESH_FULL, true);
+    }
+
+    void showConfigured() {
+        beginScreen();
+        _bbep.setCursor(280, 180); _bbep.print("CONNECTED!");
+        _bbep.setCursor(150, 220); _bbep.printf("Server: %s", _server);
+        _bbep.setCursor(200, 260); _bbep.print("Fetching transit data...");
+        _bbep.refresh(REFRESH_FULL, true);
+    }
+
+    void showError(const char* error) {
+        beginScreen();
+        _bbep.setCursor(300, 200); _bbep.print("ERROR");
+        _bbep.setCursor(150, 240); _bbep.print(error);
+        _bbep.refresh(REFRESH_FULL, true);
+    }
+
+    BBEPAPER& _bbep;
+    PanelAsync& _panel;
+    WiFiManagerParameter _serverParam;
+    Transport _net;
+    Decoder _decoder;
+    Refresh _refresh;
+    Extras _extras;
+    const NetDeadline* _cycle = nullptr;
+    char _server[128] = "";
+    bool _ready = false, _wifi = false, _drawn = false;
+    RetryPolicy _retry;
+    unsigned long _lastPoll = 0, _drawMs = 0, _polls = 0;
+};
+
+#endif // FIRMWARE_CORE_HPP
@@ -0,0 +1,174 @@
+/**
+ * Dashboard layout tables and the blits that use them
+ *
+ * The geometry itself lives in firmware/layout/dashboard.layout. The
+ * host layout-compile tool turns that file into dashboard_layout.hpp:
+ * constexpr tables of the structs below, one set per screen. Every
+ * zone and field has its framebuffer byte offset, bit shift and edge
+ * masks worked out already. The kernels here use those and do no
+ * geometry math at draw time.
+ *
+ * Framebuffer: 1 bpp, bit 7 leftmost, 1 = white, `pitch` bytes a row
+ * (bb_epaper's buffer, the Kindle canvas).
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * The bytes of one framebuffer row a rectangle covers. bytes == 1 means
+ * firstMask and lastMask are the same byte and equal.
+ */
+struct LayoutSpan {
+    uint16_t offset;    // y * pitch + x / 8 of the top-left pixel
+    uint8_t shift;      // x % 8
+    uint8_t bytes;      // bytes touched in each row
+    uint8_t firstMask;  // pixels of the first byte inside the rectangle
+    uint8_t lastMask;   // pixels of the last byte inside the rectangle
+};
+
+/** Panel font cells. LAYOUT_BB_FONT() names the matching bb_epaper font. */
+enum LayoutCell : uint8_t { LAYOUT_CELL_6x8, LAYOUT_CELL_8x8, LAYOUT_CELL_12x16 };
+#define LAYOUT_BB_FONT(cell) ((cell) == LAYOUT_CELL_6x8 ? FONT_6x8 : (cell) == LAYOUT_CELL_8x8 ? FONT_8x8 : FONT_12x16)
+
+struct LayoutFont {
+    const char* name;
+    LayoutCell cell;
+    uint8_t cellW, cellH;
+};
+
+/** A zone as drawn: where its BMP lands and how the zone is styled. */
+struct LayoutZone {
+    LayoutSpan span;
+    int16_t w, h;
+    uint16_t srcPitch;  // BMP row size: (w + 31) / 32 * 4
+    uint8_t fillBlack;  // background, when the zone is drawn locally
+    uint8_t border;     // frame width in pixels
+};
+
+enum : uint8_t {
+    FIELD_ALIGN_LEFT = 0,
+    FIELD_ALIGN_CENTER = 1,
+    FIELD_ALIGN_RIGHT = 2,
+    FIELD_ALIGN_MASK = 3,
+    FIELD_INK_WHITE = 4,    // white text
+    FIELD_FILL = 8,         // clear the field before drawing...
+    FIELD_FILL_WHITE = 16,  // ...to white instead of black
+    FIELD_ICON = 32,        // sprite slot, no text
+};
+
+/** A text field or icon slot, in absolute panel coordinates. */
+struct LayoutField {
+    uint8_t zone;
+    const char* id;
+    int16_t x, y, w, h;
+    int16_t tx, ty;     // text origin: field origin plus padding
+    LayoutSpan span;
+    uint8_t font;       // index into LAYOUT_FONTS
+    uint8_t flags;
+    uint8_t repeat;     // rows in a repeated field (1 otherwise)
+    uint8_t step;       // pixels between rows
+};
+
+/** Fill a rectangle h rows tall, black or white. */
+static inline void layoutFill(uint8_t* fb, int pitch, const LayoutSpan& s, int h, bool white) {
+    uint8_t* row = fb + s.offset;
+    uint8_t v = white ? 0xFF : 0x00;
+    for (int r = 0; r < h; r++, row += pitch) {
+        row[0] = (uint8_t)((row[0] & ~s.firstMask) | (v & s.firstMask));
+        if (s.bytes == 1) continue;
+        if (s.bytes > 2) memset(row + 1, v, s.bytes - 2);
+        uint8_t* last = row + s.bytes - 1;
+        *last = (uint8_t)((*last & ~s.lastMask) | (v & s.lastMask));
+    }
+}
+
+/**
+ * A zone's rows into the framebuffer, S = destination bit shift. srcBytes
+ * is the number of source bytes holding pixels; the rest of each row is
+ * padding and never read. srcStep is negative for a bottom-up BMP.
+ */
+template <int S>
+static inline void layoutBlitRows(uint8_t* dst, int pitch, const uint8_t* src, ptrdiff_t srcStep, int h, LayoutSpan s, int srcBytes) {
+    const int bytes = s.bytes;
+    const uint8_t first = s.firstMask, last = s.lastMask;
+    for (int r = 0; r < h; r++, dst += pitch, src += srcStep) {
+        if (S == 0) {
+            // Byte aligned: srcBytes == bytes
+            dst[0] = (uint8_t)((dst[0] & ~first) | (src[0] & first));
+            if (bytes == 1) continue;
+            memcpy(dst + 1, src + 1, bytes - 2);
+            dst[bytes - 1] = (uint8_t)((dst[bytes - 1] & ~last) | (src[bytes - 1] & last));
+            continue;
+        }
+        // Each output byte takes the low bits of one source byte and the high bits of the next
+        uint8_t prev = 0;
+        for (int j = 0; j < bytes; j++) {
+            uint8_t cur = j < srcBytes ? src[j] : 0;
+            uint8_t v = (uint8_t)((prev << (8 - S)) | (cur >> S));
+            prev = cur;
+            uint8_t m = j == 0 ? first : j == bytes - 1 ? last : 0xFF;
+            dst[j] = (uint8_t)((dst[j] & ~m) | (v & m));
+        }
+    }
+}
+
+static inline uint32_t layoutLe32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+/**
+ * Draw a zone BMP at its place in the framebuffer. Takes what the server
+ * renders (canvasToBMP(): 1 bpp, uncompressed, palette index 1 white, in
+ * either row order) at exactly the zone's size. Returns false, leaving fb
+ * untouched, for anything else; the caller then goes through the general
+ * loader.
+ */
+static inline bool layoutBlitBmp(uint8_t* fb, int pitch, const LayoutZone& z, const uint8_t* bmp, size_t len) {
+    if (len < 62 || bmp[0] != 'B' || bmp[1] != 'M') return false;
+    uint32_t dataOff = layoutLe32(bmp + 10), infoSize = layoutLe32(bmp + 14);
+    int32_t w = (int32_t)layoutLe32(bmp + 18), h = (int32_t)layoutLe32(bmp + 22);
+    uint16_t bpp = bmp[28] | (bmp[29] << 8);
+    bool topDown = h < 0;
+    if (topDown) h = -h;
+    if (w != z.w || h != z.h || bpp != 1 || layoutLe32(bmp + 30) != 0) return false;
+    if (infoSize > len - 22 || dataOff > len || (size_t)z.srcPitch * h > len - dataOff) return false;
+    // Palette entries are B,G,R,0: index 0 dark, index 1 light
+    const uint8_t* pal = bmp + 14 + infoSize;
+    if (pal[1] >= 128 || pal[5] < 128) return false;
+
+    const uint8_t* data = bmp + dataOff;
+    ptrdiff_t step = topDown ? z.srcPitch : -(ptrdiff_t)z.srcPitch;
+    const uint8_t* src = topDown ? data : data + (size_t)(z.h - 1) * z.srcPitch;
+    uint8_t* dst = fb + z.span.offset;
+    int srcBytes = (z.w + 7) / 8;
+    switch (z.span.shift) {
+        case 0: layoutBlitRows<0>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+        case 1: layoutBlitRows<1>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+        case 2: layoutBlitRows<2>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+        case 3: layoutBlitRows<3>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+        case 4: layoutBlitRows<4>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+        case 5: layoutBlitRows<5>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+        case 6: layoutBlitRows<6>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+        default: layoutBlitRows<7>(dst, pitch, src, step, z.h, z.span, srcBytes); break;
+    }
+    return true;
+}
+
+/** Text origin of row i of a field, and x for a string of n characters in its alignment. */
+static inline int layoutRowY(const LayoutField& f, int i) { return f.ty + i * f.step; }
+static inline int layoutTextX(const LayoutField& f, const LayoutFont& font, int n) {
+    int used = n * font.cellW, room = f.w - 2 * (f.tx - f.x);
+    switch (f.flags & FIELD_ALIGN_MASK) {
+        case FIELD_ALIGN_CENTER: return used < room ? f.tx + (room - used) / 2 : f.tx;
+        case FIELD_ALIGN_RIGHT: return used < room ? f.tx + room - used : f.tx;
+        default: return f.tx;
+    }
+}
+
+#endif // LAYOUT_HPP
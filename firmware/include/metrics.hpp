@@ -0,0 +1,323 @@
+/**
+ * Prometheus metrics endpoint
+ *
+ * An optional HTTP listener (METRICS_ENABLED, port METRICS_PORT) that
+ * answers GET /metrics in the Prometheus text format, so a fleet can be
+ * scraped instead of attaching serial to each unit. The firmware keeps
+ * the counters in a DeviceMetrics as it goes. Gauges (heap, RSSI, battery)
+ * are filled in just before poll(), so they are read as of the scrape.
+ *
+ * It is built to stay out of the refresh path. There is no task and no
+ * heap: poll() runs from the loop, once per wake, and never blocks. The
+ * listening socket (fd()) goes to WakeLoop::listen() so a scrape wakes the
+ * loop like any other event. A request line has METRICS_REQUEST_MS to
+ * arrive and the reply METRICS_SEND_MS to drain, so a slow or stuck
+ * scraper costs at most that. One connection is served at a time and
+ * others wait in the backlog.
+ *
+ *   MetricsServer metrics; DeviceMetrics m;
+ *   metrics.begin(METRICS_PORT);
+ *   m.cycleSeconds.observe(cycle.elapsed());
+ *   wake.listen(metrics.fd());
+ *   ...
+ *   m.heapFree = ESP.getFreeHeap(); ...
+ *   metrics.poll(m);
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#if defined(ESP_PLATFORM)
+#include "lwip/sockets.h"
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef METRICS_ENABLED
+#define METRICS_ENABLED 0
+#endif
+#ifndef METRICS_PORT
+#define METRICS_PORT 9100
+#endif
+
+// Rendered body; the full set is ~5.7 KB
+#ifndef METRICS_BUF_SIZE
+#define METRICS_BUF_SIZE 8192
+#endif
+// Only the request line matters; the rest of the headers are read and dropped
+#ifndef METRICS_REQUEST_MAX
+#define METRICS_REQUEST_MAX 256
+#endif
+#ifndef METRICS_REQUEST_MS
+#define METRICS_REQUEST_MS 500
+#endif
+#ifndef METRICS_SEND_MS
+#define METRICS_SEND_MS 200
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define METRICS_BUCKETS 8
+
+/** Durations in ms, rendered as seconds with fixed bucket bounds. */
+struct MetricsHistogram {
+    uint32_t buckets[METRICS_BUCKETS + 1] = {};     // last is +Inf; not cumulative
+    uint64_t sumMs = 0;
+    uint32_t count = 0;
+
+    static const uint32_t* boundsMs() {
+        static const uint32_t b[METRICS_BUCKETS] = {100, 250, 500, 1000, 2500, 5000, 10000, 20000};
+        return b;
+    }
+    void observe(uint32_t ms) {
+        int i = 0;
+        while (i < METRICS_BUCKETS && ms > boundsMs()[i]) i++;
+        buckets[i]++;
+        sumMs += ms;
+        count++;
+    }
+};
+
+/** What the firmware reports. Counters only go up; gauges are set before each poll(). */
+struct DeviceMetrics {
+    MetricsHistogram cycleSeconds;      // one poll/push cycle: zone list plus changed zones
+    MetricsHistogram requestSeconds;    // one HTTP request, connect to last byte
+    MetricsHistogram buttonSeconds;     // button press to the new page's waveform done
+    MetricsHistogram recoverSeconds;    // a body's first drop to its last byte, over the resumes
+    uint64_t requests = 0;
+    uint64_t bytesFetched = 0;
+    uint32_t handshakes = 0;
+    uint32_t zonesDeferred = 0;
+    uint32_t resumes = 0, crcFailures = 0;
+    uint64_t bytesRetransmitted = 0;
+    uint32_t pageSwitches = 0, pageMisses = 0;
+    uint32_t partialRefreshes = 0, fullRefreshes = 0;
+
+    uint32_t uptimeS = 0;
+    uint32_t heapFree = 0, heapMinFree = 0, heapLargestBlock = 0;
+    int32_t consecutiveErrors = 0;      // failed polls in a row; drives the offline fallback
+    bool offline = false;               // offline timetable on screen
+    bool pushStreaming = false;
+    int32_t rssi = 0;                   // dBm, 0 when not associated
+    uint16_t batteryMv = 0;             // 0 on external power
+    uint8_t batteryPercent = 100;
+    uint8_t energyTier = 0;
+};
+
+/** Appends to a fixed buffer; anything past the end is dropped and overflowed() says so. */
+class MetricsText {
+public:
+    MetricsText(char* buf, size_t cap) : _buf(buf), _cap(cap) { if (cap) buf[0] = '\0'; }
+
+    void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (_len >= _cap) { _over = true; return; }
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(_buf + _len, _cap - _len, fmt, ap);
+        va_end(ap);
+        if (n < 0 || (size_t)n >= _cap - _len) { _over = true; _len = _cap; _buf[_cap - 1] = '\0'; return; }
+        _len += (size_t)n;
+    }
+    void family(const char* name, const char* type, const char* help) {
+        printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+    void counter(const char* name, const char* help, uint64_t v) {
+        family(name, "counter", help);
+        printf("%s %llu\n", name, (unsigned long long)v);
+    }
+    void gauge(const char* name, const char* help, long v) {
+        family(name, "gauge", help);
+        printf("%s %ld\n", name, v);
+    }
+    void histogram(const char* name, const char* help, const MetricsHistogram& h) {
+        family(name, "histogram", help);
+        uint32_t cumulative = 0;
+        for (int i = 0; i < METRICS_BUCKETS; i++) {
+            cumulative += h.buckets[i];
+            uint32_t ms = MetricsHistogram::boundsMs()[i];
+            printf("%s_bucket{le=\"%lu.%03lu\"} %lu\n", name, (unsigned long)(ms / 1000), (unsigned long)(ms % 1000), (unsigned long)cumulative);
+        }
+        printf("%s_bucket{le=\"+Inf\"} %lu\n", name, (unsigned long)h.count);
+        printf("%s_sum %llu.%03llu\n", name, (unsigned long long)(h.sumMs / 1000), (unsigned long long)(h.sumMs % 1000));
+        printf("%s_count %lu\n", name, (unsigned long)h.count);
+    }
+
+    size_t length() const { return _len; }
+    bool overflowed() const { return _over; }
+
+private:
+    char* _buf;
+    size_t _cap, _len = 0;
+    bool _over = false;
+};
+
+/** The exposition body for m. Returns its length, 0 if it didn't fit in cap. */
+static inline size_t metricsRender(const DeviceMetrics& m, uint32_t scrapes, char* buf, size_t cap) {
+    MetricsText t(buf, cap);
+    t.gauge("trmnl_uptime_seconds", "Seconds since boot.", (long)m.uptimeS);
+    t.histogram("trmnl_cycle_duration_seconds", "Refresh cycle: zone list plus changed zones.", m.cycleSeconds);
+    t.histogram("trmnl_request_duration_seconds", "HTTP request, connect to last byte.", m.requestSeconds);
+    t.counter("trmnl_requests_total", "HTTP requests completed.", m.requests);
+    t.counter("trmnl_fetch_bytes_total", "Response body bytes received.", m.bytesFetched);
+    t.counter("trmnl_tls_handshakes_total", "TLS handshakes.", m.handshakes);
+    t.counter("trmnl_zones_deferred_total", "Zones left for the next cycle when its time budget ran out.", m.zonesDeferred);
+    t.counter("trmnl_download_resumes_total", "Bodies picked up with a Range request after a drop.", m.resumes);
+    t.counter("trmnl_download_retransmitted_bytes_total", "Body bytes received again after a drop.", m.bytesRetransmitted);
+    t.histogram("trmnl_download_recover_seconds", "A dropped body's first drop to its last byte.", m.recoverSeconds);
+    t.counter("trmnl_download_crc_failures_total", "Whole bodies that failed their X-Body-CRC check.", m.crcFailures);
+    t.histogram("trmnl_button_latency_seconds", "Button press to the new page on the panel.", m.buttonSeconds);
+    t.counter("trmnl_page_switches_total", "Pages put on the panel by the button or its timeout.", m.pageSwitches);
+    t.counter("trmnl_page_misses_total", "Presses that found the next page neither cached nor fetchable.", m.pageMisses);
+    t.family("trmnl_refreshes_total", "counter", "Panel refreshes started.");
+    t.printf("trmnl_refreshes_total{mode=\"partial\"} %lu\n", (unsigned long)m.partialRefreshes);
+    t.printf("trmnl_refreshes_total{mode=\"full\"} %lu\n", (unsigned long)m.fullRefreshes);
+    t.gauge("trmnl_heap_free_bytes", "Free heap.", (long)m.heapFree);
+    t.gauge("trmnl_heap_min_free_bytes", "Lowest free heap since boot.", (long)m.heapMinFree);
+    t.gauge("trmnl_heap_largest_block_bytes", "Largest allocatable heap block.", (long)m.heapLargestBlock);
+    t.gauge("trmnl_consecutive_errors", "Failed polls in a row.", (long)m.consecutiveErrors);
+    t.gauge("trmnl_offline", "1 while the offline timetable is shown.", m.offline ? 1 : 0);
+    t.gauge("trmnl_push_streaming", "1 while the push stream is connected.", m.pushStreaming ? 1 : 0);
+    t.gauge("trmnl_wifi_rssi_dbm", "WiFi signal strength.", (long)m.rssi);
+    t.gauge("trmnl_battery_millivolts", "Battery voltage, 0 on external power.", (long)m.batteryMv);
+    t.gauge("trmnl_battery_percent", "Estimated battery charge.", (long)m.batteryPercent);
+    t.gauge("trmnl_energy_tier", "Refresh cadence tier: 0 normal, 1 saver, 2 low, 3 critical.", (long)m.energyTier);
+    t.counter("trmnl_scrapes_total", "Metrics requests served, including this one.", scrapes);
+    return t.overflowed() ? 0 : t.length();
+}
+
+class MetricsServer {
+public:
+    ~MetricsServer() { end(); }
+
+    /** Listen on port (0 = any free port, see port()). */
+    bool begin(uint16_t port) {
+        end();
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, 2) != 0 || !nonBlocking(fd)) {
+            ::close(fd);
+            return false;
+        }
+        socklen_t len = sizeof(addr);
+        _port = getsockname(fd, (struct sockaddr*)&addr, &len) == 0 ? ntohs(addr.sin_port) : port;
+        _listen = fd;
+        return true;
+    }
+
+    void end() {
+        drop();
+        if (_listen >= 0) ::close(_listen);
+        _listen = -1;
+    }
+
+    /** The socket to wake on: the connection being served, else the listener. -1 before begin(). */
+    int fd() const { return _client >= 0 ? _client : _listen; }
+    uint16_t port() const { return _port; }
+    uint32_t scrapes() const { return _scrapes; }
+    /** A connection is open and its request hasn't been answered yet. */
+    bool busy() const { return _client >= 0; }
+
+    /**
+     * Accept and answer what is ready without waiting for more. Returns
+     * true when a scrape was answered on this call.
+     */
+    bool poll(const DeviceMetrics& m) {
+        if (_client < 0) {
+            if (_listen < 0) return false;
+            int c = ::accept(_listen, nullptr, nullptr);
+            if (c < 0) return false;
+            if (!nonBlocking(c)) { ::close(c); return false; }
+            _client = c;
+            _since = millis();
+            _reqLen = 0;
+        }
+        while (_reqLen < sizeof(_req) - 1) {
+            int n = (int)::recv(_client, _req + _reqLen, sizeof(_req) - 1 - _reqLen, MSG_DONTWAIT);
+            if (n == 0) { drop(); return false; }       // gone before asking
+            if (n < 0) break;
+            _reqLen += (size_t)n;
+        }
+        _req[_reqLen] = '\0';
+        bool complete = strstr(_req, "\r\n\r\n") || _reqLen == sizeof(_req) - 1;
+        if (!complete) {
+            if (millis() - _since >= METRICS_REQUEST_MS) drop();
+            return false;
+        }
+        bool scrape = strncmp(_req, "GET /metrics ", 13) == 0 || strncmp(_req, "GET /metrics?", 13) == 0;
+        if (scrape) {
+            size_t len = metricsRender(m, ++_scrapes, _body, sizeof(_body));
+            reply(len ? "200 OK" : "500 Internal Server Error", "text/plain; version=0.0.4", _body, len);
+        } else {
+            reply("404 Not Found", "text/plain", "GET /metrics\n", 13);
+        }
+        drop();
+        return scrape;
+    }
+
+private:
+    static bool nonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    void reply(const char* status, const char* type, const char* body, size_t len) {
+        char head[160];
+        int n = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                         status, type, (unsigned)len);
+        unsigned long start = millis();
+        if (sendAll(head, (size_t)n, start)) sendAll(body, len, start);
+    }
+
+    // Non-blocking send, waiting in select() for room until METRICS_SEND_MS after start
+    bool sendAll(const char* p, size_t len, unsigned long start) {
+        while (len) {
+            int n = (int)::send(_client, p, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) { p += n; len -= (size_t)n; continue; }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+            unsigned long used = millis() - start;
+            if (used >= METRICS_SEND_MS) return false;
+            uint32_t left = METRICS_SEND_MS - used;
+            fd_set wr; FD_ZERO(&wr); FD_SET(_client, &wr);
+            struct timeval tv = { (long)(left / 1000), (long)(left % 1000) * 1000 };
+            select(_client + 1, nullptr, &wr, nullptr, &tv);
+        }
+        return true;
+    }
+
+    void drop() {
+        if (_client >= 0) ::close(_client);
+        _client = -1;
+        _reqLen = 0;
+    }
+
+    int _listen = -1, _client = -1;
+    uint16_t _port = 0;
+    unsigned long _since = 0;
+    uint32_t _scrapes = 0;
+    size_t _reqLen = 0;
+    char _req[METRICS_REQUEST_MAX];
+    char _body[METRICS_BUF_SIZE];
+};
+
+#endif // METRICS_HPP
@@ -0,0 +1,249 @@
+/**
+ * Deadline-driven network reads
+ *
+ * A refresh cycle gets one time budget (NetDeadline) and each request in it
+ * gets per-stage budgets on top: connect, time to first byte, transfer.
+ * Whichever runs out first wins, so one slow zone can't eat the time of
+ * the zones after it. NetReader blocks in select() on the socket until data
+ * arrives rather than spinning on available() + yield(), and gives up when
+ * the transfer budget or the cycle budget runs out, or when nothing has
+ * arrived for NET_STALL_MS. When it gives up, the caller keeps the bytes
+ * read so far and status() says why. The loop uses NET_CYCLE_SPENT to defer
+ * the rest of the cycle rather than fail it.
+ *
+ *   NetDeadline cycle(NET_CYCLE_MS);
+ *   netArm(http, cycle);                        // connect + TTFB timeouts
+ *   int code = http.GET();
+ *   NetReader<WiFiClient> rd(*http.getStreamPtr(), cycle);
+ *   while ((n = rd.read(buf, sizeof(buf))) > 0) ...
+ *   if (rd.status() == NET_CYCLE_SPENT) ...     // defer, don't count as a failure
+ *
+ * A client with no descriptor to select() on (WiFiClientSecure keeps its
+ * socket inside mbedTLS) is checked every NET_POLL_MS instead. That is
+ * still a sleep, not a spin.
+ *
+ * A body with no Content-Length goes through the same reader:
+ * netReadUnsized() takes a chunked one apart (HTTPClient's stream is the
+ * raw socket) or reads up to the close, and fails rather than truncate one
+ * that doesn't fit.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef NET_DEADLINE_HPP
+#define NET_DEADLINE_HPP
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#if defined(ESP_PLATFORM)
+#include "lwip/sockets.h"
+#else
+#include <sys/select.h>
+#endif
+
+// One poll cycle: zone list plus every changed zone
+#ifndef NET_CYCLE_MS
+#define NET_CYCLE_MS 20000
+#endif
+
+// Per request, clamped to what is left of the cycle
+#ifndef NET_CONNECT_MS
+#define NET_CONNECT_MS 5000      // TCP + TLS handshake
+#endif
+#ifndef NET_TTFB_MS
+#define NET_TTFB_MS 8000         // request sent to response headers
+#endif
+#ifndef NET_TRANSFER_MS
+#define NET_TRANSFER_MS 10000    // response body
+#endif
+
+// No byte for this long mid-body and the server has stalled
+#ifndef NET_STALL_MS
+#define NET_STALL_MS 3000
+#endif
+
+// Readiness check interval for clients without a descriptor
+#ifndef NET_POLL_MS
+#define NET_POLL_MS 10
+#endif
+
+// Longest single select(); bounds how late a cycle deadline is noticed
+#ifndef NET_WAIT_SLICE_MS
+#define NET_WAIT_SLICE_MS 250
+#endif
+
+enum NetStatus : uint8_t {
+    NET_OK,              // reading; nothing has gone wrong
+    NET_EOF,             // peer closed
+    NET_STALLED,         // no data for NET_STALL_MS
+    NET_TIMEOUT,         // transfer budget spent
+    NET_CYCLE_SPENT,     // cycle budget spent: defer, don't retry now
+};
+
+static inline const char* netStatusName(NetStatus s) {
+    switch (s) {
+    case NET_OK: return "ok";
+    case NET_EOF: return "closed";
+    case NET_STALLED: return "stalled";
+    case NET_TIMEOUT: return "timed out";
+    case NET_CYCLE_SPENT: return "cycle budget spent";
+    }
+    return "?";
+}
+
+static inline uint32_t netLeft(unsigned long since, uint32_t budget, unsigned long now) {
+    unsigned long used = now - since;
+    return used >= budget ? 0 : (uint32_t)(budget - used);
+}
+
+/** A time budget that started when it was made. */
+class NetDeadline {
+public:
+    explicit NetDeadline(uint32_t ms) : _start(millis()), _ms(ms) {}
+
+    uint32_t remaining() const { return netLeft(_start, _ms, millis()); }
+    bool expired() const { return remaining() == 0; }
+    uint32_t elapsed() const { return (uint32_t)(millis() - _start); }
+    /** A stage budget, cut short by the cycle's. */
+    uint32_t clamp(uint32_t stageMs) const { uint32_t r = remaining(); return stageMs < r ? stageMs : r; }
+
+private:
+    unsigned long _start;
+    uint32_t _ms;
+};
+
+/** Connect and first-byte timeouts for an HTTPClient, from the cycle's remaining time. */
+template <class HttpT>
+static inline void netArm(HttpT& http, const NetDeadline& cycle) {
+    uint32_t connect = cycle.clamp(NET_CONNECT_MS), ttfb = cycle.clamp(NET_TTFB_MS);
+    http.setConnectTimeout(connect ? (int32_t)connect : 1);
+    http.setTimeout(ttfb ? (uint16_t)ttfb : 1);
+}
+
+// The client's socket if it exposes one (WiFiClient::fd()), else -1
+template <class C>
+static inline auto netClientFd(C& c, int) -> decltype((int)c.fd()) { return c.fd(); }
+template <class C>
+static inline int netClientFd(C&, long) { return -1; }
+
+/** Sleep until fd is readable or ms pass. */
+static inline void netWaitReadable(int fd, uint32_t ms) {
+    if (ms > NET_WAIT_SLICE_MS) ms = NET_WAIT_SLICE_MS;
+    if (fd < 0) { delay(ms < NET_POLL_MS ? ms : NET_POLL_MS); return; }
+    fd_set rd, ex;
+    FD_ZERO(&rd); FD_SET(fd, &rd);
+    FD_ZERO(&ex); FD_SET(fd, &ex);
+    struct timeval tv = { (long)(ms / 1000), (long)(ms % 1000) * 1000 };
+    select(fd + 1, &rd, nullptr, &ex, &tv);
+}
+
+template <class ClientT>
+class NetReader {
+public:
+    NetReader(ClientT& client, const NetDeadline& cycle, uint32_t transferMs = NET_TRANSFER_MS)
+        : _client(client), _cycle(cycle), _start(millis()), _last(_start), _transferMs(transferMs) {}
+
+    /**
+     * Read up to n bytes, waiting for at least one. Returns how many; 0
+     * once the body is over or a budget ran out (see status()).
+     */
+    int read(uint8_t* buf, size_t n) {
+        if (_status != NET_OK) return 0;
+        for (;;) {
+            int avail = _client.available();
+            if (avail > 0) {
+                int r = _client.read(buf, (size_t)avail < n ? (size_t)avail : n);
+                if (r > 0) { _bytes += (size_t)r; _last = millis(); return r; }
+            }
+            if (avail <= 0 && !_client.connected()) return stop(NET_EOF);
+            unsigned long now = millis();
+            uint32_t cycleLeft = _cycle.remaining();
+            uint32_t transferLeft = netLeft(_start, _transferMs, now);
+            uint32_t stallLeft = netLeft(_last, NET_STALL_MS, now);
+            if (!cycleLeft) return stop(NET_CYCLE_SPENT);
+            if (!transferLeft) return stop(NET_TIMEOUT);
+            if (!stallLeft) return stop(NET_STALLED);
+            uint32_t wait = cycleLeft < transferLeft ? cycleLeft : transferLeft;
+            netWaitReadable(netClientFd(_client, 0), wait < stallLeft ? wait : stallLeft);
+        }
+    }
+
+    /** Read exactly n bytes unless a budget runs out or the peer closes first. */
+    size_t readFully(uint8_t* buf, size_t n) {
+        size_t got = 0;
+        while (got < n) {
+            int r = read(buf + got, n - got);
+            if (r <= 0) break;
+            got += (size_t)r;
+        }
+        return got;
+    }
+
+    NetStatus status() const { return _status; }
+    size_t bytes() const { return _bytes; }
+    uint32_t elapsed() const { return (uint32_t)(millis() - _start); }
+
+private:
+    int stop(NetStatus s) { _status = s; return 0; }
+
+    ClientT& _client;
+    const NetDeadline& _cycle;
+    unsigned long _start, _last;
+    uint32_t _transferMs;
+    size_t _bytes = 0;
+    NetStatus _status = NET_OK;
+};
+
+// One CRLF-terminated line, cut to size (a long chunk extension doesn't matter)
+template <class ClientT>
+static inline bool netReadLine(NetReader<ClientT>& rd, char* line, size_t size) {
+    size_t n = 0;
+    uint8_t c;
+    while (rd.read(&c, 1) == 1) {
+        if (c == '\n') { line[n] = 0; return true; }
+        if (c != '\r' && n + 1 < size) line[n++] = (char)c;
+    }
+    return false;
+}
+
+// Everything up to the close, if it fits in cap
+template <class ClientT>
+static inline bool netReadUntilClose(NetReader<ClientT>& rd, uint8_t* buf, size_t cap, size_t& got) {
+    got = rd.readFully(buf, cap);
+    uint8_t more;
+    return got < cap ? rd.status() == NET_EOF : rd.read(&more, 1) == 0 && rd.status() == NET_EOF;
+}
+
+// size CRLF data CRLF ... 0 CRLF CRLF; chunk extensions and trailers are skipped
+template <class ClientT>
+static inline bool netDechunk(NetReader<ClientT>& rd, uint8_t* buf, size_t cap, size_t& got) {
+    char line[24];
+    for (;;) {
+        if (!netReadLine(rd, line, sizeof(line))) return false;
+        char* end;
+        unsigned long n = strtoul(line, &end, 16);
+        if (end == line) return false;
+        if (n == 0) {
+            while (netReadLine(rd, line, sizeof(line)) && line[0]) {}
+            return true;
+        }
+        if (n > cap - got || rd.readFully(buf + got, n) != n) return false;
+        got += n;
+        if (!netReadLine(rd, line, sizeof(line)) || line[0]) return false;
+    }
+}
+
+/**
+ * A body with no length into buf: got is how much arrived. False if it
+ * was cut short or needed more than cap bytes.
+ */
+template <class ClientT>
+static inline bool netReadUnsized(NetReader<ClientT>& rd, bool chunked, uint8_t* buf, size_t cap, size_t& got) {
+    got = 0;
+    return chunked ? netDechunk(rd, buf, cap, got) : netReadUntilClose(rd, buf, cap, got);
+}
+
+#endif // NET_DEADLINE_HPP
@@ -0,0 +1,164 @@
+/**
+ * Resumable response bodies
+ *
+ * A body that stops short (WiFi drop, stall, server gone) is kept, and the
+ * next request asks only for the rest: Range: bytes=<held>-, with If-Range
+ * naming the ETag the first part came with. If the body changed meanwhile
+ * the server sends it whole again (200) rather than a tail that doesn't
+ * belong to the bytes already held. X-Body-CRC, the CRC-32 of the whole
+ * body, is checked once the last byte is in, over every part.
+ *
+ *   NetResume body;
+ *   do {
+ *       if (body.resuming()) { http.addHeader("Range", body.range()); http.addHeader("If-Range", body.etag()); }
+ *       int code = http.GET();
+ *       long at = body.start(code, http.getSize(), <Content-Range>, <ETag>, <X-Body-CRC>, cap);
+ *       if (at < 0) break;
+ *       body.advance(buf + at, rd.readFully(buf + at, body.want()));
+ *   } while (!body.complete() && body.retry(rd.status(), millis()));
+ *   if (body.verified()) ...
+ *
+ * Only a body with a strong ETag is resumed; without one a drop loses the
+ * body as before.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef NET_RESUME_HPP
+#define NET_RESUME_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "net_deadline.hpp"     // NetStatus
+#include "timetable.hpp"        // ttCrc32
+
+// Requests one body may take: the first and the resumes after it
+#ifndef NET_RESUME_TRIES
+#define NET_RESUME_TRIES 3
+#endif
+
+#define NET_ETAG_MAX 40
+
+/** Eight hex digits (X-Body-CRC, or an ETag made of a CRC), quotes allowed. False if it isn't one. */
+static inline bool netParseCrc(const char* s, uint32_t& crc) {
+    if (!s) return false;
+    if (*s == '"') s++;
+    uint32_t v = 0;
+    int i = 0;
+    for (; i < 8; i++) {
+        char c = s[i];
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (d < 0) return false;
+        v = (v << 4) | (uint32_t)d;
+    }
+    if (s[i] != '\0' && !(s[i] == '"' && s[i + 1] == '\0')) return false;
+    crc = v;
+    return true;
+}
+
+/** A 206's Content-Range, "bytes first-last/total". False if it isn't one. */
+static inline bool netParseContentRange(const char* s, size_t& first, size_t& last, size_t& total) {
+    if (!s || strncmp(s, "bytes ", 6) != 0) return false;
+    s += 6;
+    size_t v[3];
+    const char seps[3] = {'-', '/', '\0'};
+    for (int k = 0; k < 3; k++) {
+        if (*s < '0' || *s > '9') return false;
+        size_t n = 0;
+        while (*s >= '0' && *s <= '9') n = n * 10 + (size_t)(*s++ - '0');
+        if (*s != seps[k]) return false;
+        if (k < 2) s++;
+        v[k] = n;
+    }
+    first = v[0]; last = v[1]; total = v[2];
+    return first <= last && last < total;
+}
+
+class NetResume {
+public:
+    /** Part of the body is held and can be asked for by range: send range() and etag(). */
+    bool resuming() const { return _etag[0] && _got > 0 && _got < _total; }
+    const char* range() { snprintf(_range, sizeof(_range), "bytes=%lu-", (unsigned long)_got); return _range; }
+    const char* etag() const { return _etag; }
+
+    /**
+     * Take a response's status and headers (nullptr or "" when absent).
+     * Returns the body offset its bytes go to, -1 if it can't be used:
+     * not 200/206, no length, longer than cap, or a range that doesn't
+     * continue what is held. A 200 starts over; anything held is counted
+     * as retransmitted.
+     */
+    long start(int code, long length, const char* contentRange, const char* etag, const char* bodyCrc, size_t cap) {
+        if (code == 200) {
+            if (length <= 0 || (size_t)length > cap) return -1;
+            _retransmitted += _got;
+            _got = 0;
+            _run = 0;
+            _total = (size_t)length;
+            _hasCrc = netParseCrc(bodyCrc, _crc);
+            // If-Range only takes a strong validator
+            size_t n = etag && strncmp(etag, "W/", 2) != 0 ? strlen(etag) : 0;
+            if (n >= sizeof(_etag)) n = 0;
+            memcpy(_etag, etag ? etag : "", n);
+            _etag[n] = '\0';
+            _attempts++;
+            return 0;
+        }
+        size_t first, last, total;
+        uint32_t crc;
+        if (code != 206 || !resuming() || !netParseContentRange(contentRange, first, last, total)) return -1;
+        if (first != _got || last + 1 != total || total != _total) return -1;
+        if (length >= 0 && (size_t)length != total - first) return -1;
+        if (etag && etag[0] && strcmp(etag, _etag) != 0) return -1;
+        if (_hasCrc && bodyCrc && bodyCrc[0] && (!netParseCrc(bodyCrc, crc) || crc != _crc)) return -1;
+        _attempts++;
+        _resumes++;
+        return (long)_got;
+    }
+
+    /** The next n bytes of the body, in order. */
+    void advance(const uint8_t* p, size_t n) {
+        if (n > want()) n = want();
+        _run = ttCrc32(p, n, _run);
+        _got += n;
+    }
+
+    /**
+     * After an attempt that stopped short: true if another request should
+     * pick the body up. Not when nothing resumable is held, the tries are
+     * used up, or the cycle's budget ran out (that defers, as elsewhere).
+     * The first drop starts the clock recoverMs() reads.
+     */
+    bool retry(NetStatus why, unsigned long now) {
+        if (complete()) return false;
+        if (!_droppedAt) _droppedAt = now ? now : 1;
+        return resuming() && _attempts < NET_RESUME_TRIES && why != NET_CYCLE_SPENT;
+    }
+
+    size_t want() const { return _total - _got; }
+    size_t got() const { return _got; }
+    size_t total() const { return _total; }
+    bool complete() const { return _total && _got == _total; }
+    /** Complete, and the CRC of every byte matches X-Body-CRC (a body sent without one only has to be complete). */
+    bool verified() const { return complete() && (!_hasCrc || _run == _crc); }
+    bool dropped() const { return _droppedAt != 0; }
+    /** From the first drop to now; 0 if the body never dropped. */
+    uint32_t recoverMs(unsigned long now) const { return _droppedAt ? (uint32_t)(now - _droppedAt) : 0; }
+    /** Bytes received more than once: what a 200 threw away after a drop. */
+    size_t retransmitted() const { return _retransmitted; }
+    uint8_t resumes() const { return _resumes; }
+
+private:
+    size_t _total = 0, _got = 0, _retransmitted = 0;
+    uint32_t _crc = 0, _run = 0;
+    bool _hasCrc = false;
+    uint8_t _attempts = 0, _resumes = 0;
+    unsigned long _droppedAt = 0;
+    char _etag[NET_ETAG_MAX] = "";
+    char _range[32] = "";
+};
+
+#endif // NET_RESUME_HPP
@@ -0,0 +1,128 @@
+/**
+ * Retry policy: decorrelated jitter with a circuit breaker
+ *
+ * A fixed retry delay, or a plain 2^n backoff, keeps a fleet that failed
+ * together retrying together: every device that lost the server at the
+ * same moment comes back at the same moments, and the server's first
+ * minute after an outage is a series of spikes. RetryPolicy spreads the
+ * retries instead. Each wait is drawn between RETRY_BASE_MS and three
+ * times the last wait, capped at RETRY_CAP_MS ("decorrelated jitter"), so
+ * two devices with different seeds drift apart after the first failure.
+ *
+ * After RETRY_BREAKER_FAILURES failures in a row the breaker opens: no
+ * request for a jittered RETRY_BREAKER_OPEN_MS, then one probe (half-open).
+ * A success closes it; a failed probe opens it again. A server that is
+ * down for an hour sees a probe every minute or two from each device rather
+ * than one every RETRY_CAP_MS.
+ *
+ *   RetryPolicy retry;
+ *   retry.seed(esp_random());
+ *   if (retry.ready(millis())) {
+ *       if (fetch()) retry.success();
+ *       else retry.failure(millis());     // the wait before the next try
+ *   }
+ *   wake.arm(WAKE_POLL, max(pollIn, retry.msUntilReady(millis())));
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef NET_RETRY_HPP
+#define NET_RETRY_HPP
+
+#include <stdint.h>
+
+#ifndef RETRY_BASE_MS
+#define RETRY_BASE_MS 2000UL            // shortest wait after a failure
+#endif
+#ifndef RETRY_CAP_MS
+#define RETRY_CAP_MS 30000UL            // longest wait while the breaker is closed
+#endif
+#ifndef RETRY_BREAKER_FAILURES
+#define RETRY_BREAKER_FAILURES 6        // failures in a row that open the breaker
+#endif
+#ifndef RETRY_BREAKER_OPEN_MS
+#define RETRY_BREAKER_OPEN_MS 120000UL  // open for 1/2 to 1 times this, then one probe
+#endif
+
+enum RetryState : uint8_t {
+    RETRY_CLOSED,        // requests go out; waits grow with the failures
+    RETRY_OPEN,          // too many failures: nothing until the open time is up
+    RETRY_HALF_OPEN,     // open time up: the next request is the probe
+};
+
+static inline const char* retryStateName(RetryState s) {
+    switch (s) {
+    case RETRY_CLOSED: return "closed";
+    case RETRY_OPEN: return "open";
+    case RETRY_HALF_OPEN: return "half-open";
+    }
+    return "?";
+}
+
+class RetryPolicy {
+public:
+    explicit RetryPolicy(uint32_t baseMs = RETRY_BASE_MS, uint32_t capMs = RETRY_CAP_MS,
+                         uint8_t openAfter = RETRY_BREAKER_FAILURES, uint32_t openMs = RETRY_BREAKER_OPEN_MS)
+        : _baseMs(baseMs), _capMs(capMs), _openMs(openMs), _openAfter(openAfter) {}
+
+    /** Devices seeded alike retry alike: give each its own (esp_random() on the device). */
+    void seed(uint32_t s) { _rng = s ? s : 0x9E3779B9u; }
+
+    /** True once the wait after the last failure is over. */
+    bool ready(unsigned long now) const { return !_failures || now - _failedAt >= _waitMs; }
+
+    uint32_t msUntilReady(unsigned long now) const {
+        unsigned long waited = now - _failedAt;
+        return ready(now) ? 0 : (uint32_t)(_waitMs - waited);
+    }
+
+    /** A request failed at now: returns how long to wait before the next one. */
+    uint32_t failure(unsigned long now) {
+        _failures = _failures < 0xFFFF ? _failures + 1 : _failures;
+        _failedAt = now;
+        // While open the only request is the probe: its failure opens the breaker again
+        if (_state == RETRY_OPEN || (_openAfter && _failures >= _openAfter)) {
+            if (_state == RETRY_CLOSED) _opened++;
+            _state = RETRY_OPEN;
+            _waitMs = between(_openMs / 2, _openMs);
+        } else {
+            // Between base and three times the last wait (base after a success)
+            uint32_t prev = _waitMs > _baseMs ? _waitMs : _baseMs;
+            uint32_t hi = prev > _capMs / 3 ? _capMs : prev * 3;
+            _waitMs = between(_baseMs, hi > _baseMs ? hi : _baseMs);
+        }
+        return _waitMs;
+    }
+
+    void success() {
+        _failures = 0;
+        _waitMs = 0;
+        _state = RETRY_CLOSED;
+    }
+
+    /** Where the breaker is at now: an open one whose time is up is half-open. */
+    RetryState state(unsigned long now) const { return _state == RETRY_OPEN && ready(now) ? RETRY_HALF_OPEN : _state; }
+
+    uint16_t failures() const { return _failures; }
+    uint32_t lastWaitMs() const { return _waitMs; }
+    /** Times the breaker has opened from closed. */
+    uint32_t opened() const { return _opened; }
+
+private:
+    // xorshift32: uniform in [lo, hi]
+    uint32_t between(uint32_t lo, uint32_t hi) {
+        _rng ^= _rng << 13; _rng ^= _rng >> 17; _rng ^= _rng << 5;
+        return hi > lo ? lo + _rng % (hi - lo + 1) : lo;
+    }
+
+    uint32_t _baseMs, _capMs, _openMs;
+    uint8_t _openAfter;
+    RetryState _state = RETRY_CLOSED;
+    uint16_t _failures = 0;
+    uint32_t _waitMs = 0, _opened = 0;
+    unsigned long _failedAt = 0;
+    uint32_t _rng = 0x9E3779B9u;
+};
+
+#endif // NET_RETRY_HPP
@@ -0,0 +1,304 @@
+/**
+ * Streaming delta OTA: apply a binary patch against the running image
+ *
+ * host/tools/ota-delta builds a bsdiff-style patch from the release the
+ * device runs to the new one. The device streams it from the server and
+ * OtaDeltaPatcher writes the new image straight into the inactive app
+ * partition as the bytes arrive. It never holds either image or the patch
+ * in RAM: a few hundred bytes of state plus one OTA_DELTA_CHUNK buffer.
+ *
+ * Patch layout (little-endian):
+ *   OtaDeltaHeader           sizes and SHA-256 of the base and new images,
+ *                            Ed25519-signed with the release key
+ *   records until newSize bytes are produced:
+ *     varint diffLen, varint extraLen, zigzag varint seek
+ *     diff     diffLen bytes of new = old + delta, coded as runs of
+ *              (varint zeros, varint literals, literal bytes): where the
+ *              delta is zero the old bytes are copied unchanged
+ *     extra    extraLen bytes copied from the patch as they are
+ *   then old position += diffLen + seek
+ *
+ * bsdiff compresses its mostly-zero delta with bzip2. Here the zero runs
+ * are coded in-line instead, so applying needs no decompressor and no
+ * window. Relinked code differs from the old image mostly in the
+ * displacements of moved calls and loads. Those are short literal runs
+ * between long zero runs.
+ *
+ * The target supplies the flash:
+ *   bool readOld(uint32_t offset, uint8_t* buf, size_t n);
+ *   bool writeNew(const uint8_t* buf, size_t n);      // sequential
+ * The patcher checks the header's signature against the public key built
+ * into the firmware and the base image's hash before writing anything, and
+ * the hash of everything written before it reports OTA_DELTA_DONE. The
+ * signature covers newSha, so only an image the key holder released can
+ * pass; a record's lengths are checked against the space left in both
+ * images before any of it is read or written.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef OTA_DELTA_HPP
+#define OTA_DELTA_HPP
+
+#include "ed25519.hpp"
+#include "sha256.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define OTA_DELTA_MAGIC 0x544C4454u   // "TDLT"
+#define OTA_DELTA_VERSION 2
+
+// Old bytes read and new bytes written per flash call
+#ifndef OTA_DELTA_CHUNK
+#define OTA_DELTA_CHUNK 512
+#endif
+
+struct OtaDeltaHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t oldSize;                 // bytes of the base image the patch reads
+    uint32_t newSize;
+    uint8_t oldSha[SHA256_SIZE];      // of the base image's first oldSize bytes
+    uint8_t newSha[SHA256_SIZE];
+    uint8_t sig[ED25519_SIG_SIZE];    // over every field above
+};
+
+#define OTA_DELTA_SIGNED_BYTES offsetof(OtaDeltaHeader, sig)
+
+static_assert(sizeof(OtaDeltaHeader) == 144 && OTA_DELTA_SIGNED_BYTES == 80, "OtaDeltaHeader layout");
+
+enum OtaDeltaStatus : uint8_t {
+    OTA_DELTA_RUNNING,
+    OTA_DELTA_DONE,               // newSize bytes written and their hash matched
+    OTA_DELTA_BAD_HEADER,
+    OTA_DELTA_BAD_SIGNATURE,      // not signed with the key this firmware trusts
+    OTA_DELTA_WRONG_BASE,         // the running image isn't the one the patch was made from
+    OTA_DELTA_CORRUPT,            // a record points outside the images
+    OTA_DELTA_FLASH_ERROR,
+    OTA_DELTA_HASH_MISMATCH,
+};
+
+static inline const char* otaDeltaStatusName(OtaDeltaStatus s) {
+    switch (s) {
+    case OTA_DELTA_RUNNING: return "running";
+    case OTA_DELTA_DONE: return "done";
+    case OTA_DELTA_BAD_HEADER: return "bad header";
+    case OTA_DELTA_BAD_SIGNATURE: return "bad signature";
+    case OTA_DELTA_WRONG_BASE: return "wrong base image";
+    case OTA_DELTA_CORRUPT: return "corrupt patch";
+    case OTA_DELTA_FLASH_ERROR: return "flash error";
+    case OTA_DELTA_HASH_MISMATCH: return "hash mismatch";
+    }
+    return "?";
+}
+
+/** SHA-256 of the first size bytes the target's readOld() returns. */
+template <class Target>
+static inline bool otaDeltaHashOld(Target& t, uint32_t size, uint8_t out[SHA256_SIZE]) {
+    Sha256 h;
+    uint8_t buf[OTA_DELTA_CHUNK];
+    for (uint32_t off = 0; off < size;) {
+        size_t n = size - off < sizeof(buf) ? size - off : sizeof(buf);
+        if (!t.readOld(off, buf, n)) return false;
+        h.update(buf, n);
+        off += (uint32_t)n;
+    }
+    h.finish(out);
+    return true;
+}
+
+/** Signs a header in place with the release key's 32-byte seed (host side). */
+static inline void otaDeltaSign(OtaDeltaHeader& h, const uint8_t seed[ED25519_KEY_SIZE]) {
+    Ed25519::sign(seed, (const uint8_t*)&h, OTA_DELTA_SIGNED_BYTES, h.sig);
+}
+
+template <class Target>
+class OtaDeltaPatcher {
+public:
+    /** signingKey: the release key's 32-byte Ed25519 public key. */
+    OtaDeltaPatcher(Target& target, const uint8_t signingKey[ED25519_KEY_SIZE], bool verifyBase = true)
+        : _t(target), _verifyBase(verifyBase) {
+        memcpy(_key, signingKey, sizeof(_key));
+    }
+
+    /** Feed the next n bytes of the patch, any split. Returns status(). */
+    OtaDeltaStatus feed(const uint8_t* p, size_t n) {
+        while (n && _status == OTA_DELTA_RUNNING) {
+            size_t used = step(p, n);
+            p += used; n -= used;
+        }
+        return _status;
+    }
+
+    OtaDeltaStatus status() const { return _status; }
+    bool headerReady() const { return _state != S_HEADER; }
+    const OtaDeltaHeader& header() const { return _h; }
+    uint32_t written() const { return _newPos; }
+
+private:
+    enum State : uint8_t { S_HEADER, S_DIFF_LEN, S_EXTRA_LEN, S_SEEK, S_ZEROS, S_LITERAL_LEN, S_LITERAL, S_EXTRA };
+
+    size_t step(const uint8_t* p, size_t n) {
+        switch (_state) {
+        case S_HEADER: {
+            size_t k = sizeof(_h) - _got < n ? sizeof(_h) - _got : n;
+            memcpy((uint8_t*)&_h + _got, p, k);
+            if ((_got += k) == sizeof(_h)) beginPatch();
+            return k;
+        }
+        case S_DIFF_LEN: case S_EXTRA_LEN: case S_SEEK: case S_ZEROS: case S_LITERAL_LEN:
+            if (varint(p[0])) afterVarint();
+            return 1;
+        case S_LITERAL: {
+            // new = old + delta for as much as the input, the run and the buffer allow
+            size_t k = min3(n, _runLeft, room());
+            if (!readOld(_buf + _bufLen, k)) return n;
+            for (size_t i = 0; i < k; i++) _buf[_bufLen + i] += p[i];
+            produced(k);
+            _runLeft -= k; _diffLeft -= k;
+            if (!_runLeft) _state = _diffLeft ? S_ZEROS : S_EXTRA;
+            if (_state == S_EXTRA && !_extraLeft) endRecord();
+            return k;
+        }
+        case S_EXTRA: {
+            size_t k = min3(n, _extraLeft, room());
+            memcpy(_buf + _bufLen, p, k);
+            produced(k);
+            if (!(_extraLeft -= k)) endRecord();
+            return k;
+        }
+        }
+        return n;
+    }
+
+    void beginPatch() {
+        if (_h.magic != OTA_DELTA_MAGIC || _h.version != OTA_DELTA_VERSION || _h.headerSize != sizeof(_h)) { fail(OTA_DELTA_BAD_HEADER); return; }
+        if (!Ed25519::verify(_key, (const uint8_t*)&_h, OTA_DELTA_SIGNED_BYTES, _h.sig)) { fail(OTA_DELTA_BAD_SIGNATURE); return; }
+        if (_verifyBase) {
+            uint8_t sha[SHA256_SIZE];
+            if (!otaDeltaHashOld(_t, _h.oldSize, sha)) { fail(OTA_DELTA_FLASH_ERROR); return; }
+            if (memcmp(sha, _h.oldSha, SHA256_SIZE) != 0) { fail(OTA_DELTA_WRONG_BASE); return; }
+        }
+        _state = S_DIFF_LEN;
+        if (!_h.newSize) finish();
+    }
+
+    // Accumulates one LEB128 varint; true once its last byte is in
+    bool varint(uint8_t b) {
+        if (_shift >= 64) { fail(OTA_DELTA_CORRUPT); return false; }
+        _value |= (uint64_t)(b & 0x7F) << _shift;
+        _shift += 7;
+        return !(b & 0x80);
+    }
+
+    void afterVarint() {
+        uint64_t v = _value;
+        _value = 0; _shift = 0;
+        switch (_state) {
+        case S_DIFF_LEN:
+            _diffLeft = v;
+            _state = S_EXTRA_LEN;
+            break;
+        case S_EXTRA_LEN:
+            _extraLeft = v;
+            _state = S_SEEK;
+            break;
+        case S_SEEK:
+            _seek = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            // Against the space left, so no sum of 64-bit lengths can wrap
+            if (_diffLeft > _h.newSize - _newPos || _extraLeft > _h.newSize - _newPos - _diffLeft ||
+                _diffLeft > _h.oldSize - _oldPos) { fail(OTA_DELTA_CORRUPT); return; }
+            _state = _diffLeft ? S_ZEROS : S_EXTRA;
+            if (!_diffLeft && !_extraLeft) endRecord();
+            break;
+        case S_ZEROS:
+            if (v > _diffLeft) { fail(OTA_DELTA_CORRUPT); return; }
+            // Unchanged bytes: straight copies from the old image
+            while (v && _status == OTA_DELTA_RUNNING) {
+                size_t k = v < room() ? (size_t)v : room();
+                if (!readOld(_buf + _bufLen, k)) return;
+                produced(k);
+                v -= k; _diffLeft -= k;
+            }
+            _state = _diffLeft ? S_LITERAL_LEN : S_EXTRA;
+            if (_state == S_EXTRA && !_extraLeft) endRecord();
+            break;
+        case S_LITERAL_LEN:
+            if (!v || v > _diffLeft) { fail(OTA_DELTA_CORRUPT); return; }
+            _runLeft = v;
+            _state = S_LITERAL;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void endRecord() {
+        // _seek is any int64; _oldPos <= oldSize < 2^32, so neither side can overflow
+        if (_seek < -(int64_t)_oldPos || _seek > (int64_t)(_h.oldSize - _oldPos)) { fail(OTA_DELTA_CORRUPT); return; }
+        _oldPos = (uint32_t)((int64_t)_oldPos + _seek);
+        _state = S_DIFF_LEN;
+        if (_newPos == _h.newSize) finish();
+    }
+
+    bool readOld(uint8_t* dst, size_t n) {
+        if (n > _h.oldSize - _oldPos) { fail(OTA_DELTA_CORRUPT); return false; }
+        if (!_t.readOld(_oldPos, dst, n)) { fail(OTA_DELTA_FLASH_ERROR); return false; }
+        _oldPos += (uint32_t)n;
+        return true;
+    }
+
+    size_t room() const { return sizeof(_buf) - _bufLen; }
+
+    void produced(size_t n) {
+        if (n > _h.newSize - _newPos) { fail(OTA_DELTA_CORRUPT); return; }
+        _bufLen += n;
+        _newPos += (uint32_t)n;
+        if (_bufLen == sizeof(_buf)) flush();
+    }
+
+    bool flush() {
+        if (!_bufLen) return true;
+        _sha.update(_buf, _bufLen);
+        bool ok = _t.writeNew(_buf, _bufLen);
+        _bufLen = 0;
+        if (!ok) fail(OTA_DELTA_FLASH_ERROR);
+        return ok;
+    }
+
+    void finish() {
+        if (!flush()) return;
+        uint8_t sha[SHA256_SIZE];
+        _sha.finish(sha);
+        _status = memcmp(sha, _h.newSha, SHA256_SIZE) == 0 ? OTA_DELTA_DONE : OTA_DELTA_HASH_MISMATCH;
+    }
+
+    void fail(OtaDeltaStatus s) { if (_status == OTA_DELTA_RUNNING) _status = s; }
+
+    static size_t min3(size_t a, uint64_t b, size_t c) {
+        size_t m = b < (uint64_t)a ? (size_t)b : a;
+        return c < m ? c : m;
+    }
+
+    Target& _t;
+    bool _verifyBase;
+    uint8_t _key[ED25519_KEY_SIZE];
+    OtaDeltaStatus _status = OTA_DELTA_RUNNING;
+    State _state = S_HEADER;
+    OtaDeltaHeader _h = {};
+    size_t _got = 0;
+    uint64_t _value = 0;
+    int _shift = 0;
+    uint64_t _diffLeft = 0, _extraLeft = 0, _runLeft = 0;
+    int64_t _seek = 0;
+    uint32_t _oldPos = 0, _newPos = 0;
+    Sha256 _sha;
+    uint8_t _buf[OTA_DELTA_CHUNK];
+    size_t _bufLen = 0;
+};
+
+#endif // OTA_DELTA_HPP
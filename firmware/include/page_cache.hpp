@@ -0,0 +1,176 @@
+/**
+ * Page cache - compressed frames for the button's pages
+ *
+ * The button cycles the panel through pages: the journey dashboard, drawn
+ * zone by zone as usual, and whole-screen pages the server renders (the
+ * departures board and alerts screens in layout/dashboard.layout). Every
+ * page that is not on the panel is held here as a packed 1 bpp frame, so
+ * a press is an unpack into the framebuffer and a refresh, with no request
+ * in between. Server pages arrive already packed (src/services/pages.js)
+ * and are kept as they come in, replaced in the background when their
+ * data changes. The journey page is packed from the framebuffer when the
+ * button takes it off the panel.
+ *
+ * Page layout (little-endian):
+ *   header  'P' 'G' version 0 | w:u16 h:u16 | crc:u32
+ *   body    the frame's rows end to end, PackBits as in TIFF:
+ *           n = 0..127    n + 1 literal bytes follow
+ *           n = 129..255  the next byte, 257 - n times
+ * crc is the server's CRC-32 of the unpacked frame, sent back as the
+ * ETag; 0 for a frame packed here. A mostly white 800x480 page packs to
+ * a few KB.
+ *
+ * One arena of PAGE_SLOTS fixed slots, no per-page allocations:
+ *   uint8_t* p = pages.reserve(page, len);   // fetch straight into p
+ *   pages.commit(page, len);
+ *   ...
+ *   pages.store(PAGE_JOURNEY, fb); pages.show(next, fb);
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef PAGE_CACHE_HPP
+#define PAGE_CACHE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PAGE_SLOTS
+#define PAGE_SLOTS 3
+#endif
+
+// Packed page, header included. Mostly white pages are a few KB; a denser one isn't held (a server page
+// is fetched on demand, the journey page redrawn from the server)
+#ifndef PAGE_SLOT_SIZE
+#define PAGE_SLOT_SIZE 10240
+#endif
+
+#define PAGE_VERSION 1
+#define PAGE_HEADER_SIZE 12
+
+/** PackBits n bytes of src into dst. Returns the packed length, 0 if it doesn't fit in cap. */
+static inline size_t pagePack(const uint8_t* src, size_t n, uint8_t* dst, size_t cap) {
+    size_t i = 0, o = 0;
+    while (i < n) {
+        size_t run = 1;
+        while (i + run < n && run < 128 && src[i + run] == src[i]) run++;
+        if (run >= 2) {
+            if (o + 2 > cap) return 0;
+            dst[o++] = (uint8_t)(257 - run);
+            dst[o++] = src[i];
+            i += run;
+            continue;
+        }
+        // Literals up to the next run of three; a pair costs the same either way
+        size_t start = i;
+        while (i < n && i - start < 128 && !(i + 2 < n && src[i] == src[i + 1] && src[i] == src[i + 2])) i++;
+        size_t k = i - start;
+        if (o + 1 + k > cap) return 0;
+        dst[o++] = (uint8_t)(k - 1);
+        memcpy(dst + o, src + start, k);
+        o += k;
+    }
+    return o;
+}
+
+/** Unpack into exactly n bytes of dst; dst == nullptr only checks. False if src isn't a whole frame of n bytes. */
+static inline bool pageUnpack(const uint8_t* src, size_t len, uint8_t* dst, size_t n) {
+    size_t i = 0, o = 0;
+    while (i < len) {
+        uint8_t c = src[i++];
+        if (c < 128) {
+            size_t k = (size_t)c + 1;
+            if (k > len - i || k > n - o) return false;
+            if (dst) memcpy(dst + o, src + i, k);
+            i += k; o += k;
+        } else if (c > 128) {
+            size_t k = 257 - (size_t)c;
+            if (i >= len || k > n - o) return false;
+            if (dst) memset(dst + o, src[i], k);
+            i++; o += k;
+        } else {
+            return false;
+        }
+    }
+    return o == n;
+}
+
+static inline uint32_t pageLe32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static inline void pageHeader(uint8_t* p, int w, int h, uint32_t crc) {
+    p[0] = 'P'; p[1] = 'G'; p[2] = PAGE_VERSION; p[3] = 0;
+    p[4] = (uint8_t)w; p[5] = (uint8_t)(w >> 8); p[6] = (uint8_t)h; p[7] = (uint8_t)(h >> 8);
+    for (int i = 0; i < 4; i++) p[8 + i] = (uint8_t)(crc >> (8 * i));
+}
+
+class PageCache {
+public:
+    ~PageCache() { free(_arena); }
+
+    /** Slots for frames of a width x height panel (1 bpp, rows of (width + 7) / 8 bytes). */
+    bool begin(int width, int height, size_t slotSize = PAGE_SLOT_SIZE) {
+        if (_arena) return true;
+        _w = width; _h = height;
+        _frame = (size_t)(width + 7) / 8 * height;
+        _arena = (uint8_t*)malloc(slotSize * PAGE_SLOTS);
+        _slotSize = _arena ? slotSize : 0;
+        return _arena != nullptr;
+    }
+
+    bool ready() const { return _arena != nullptr; }
+    bool held(int page) const { return valid(page) && _len[page] != 0; }
+    /** The server's CRC of a held page (its ETag), 0 if not held or packed here. */
+    uint32_t crc(int page) const { return held(page) ? pageLe32(slot(page) + 8) : 0; }
+    size_t bytes(int page) const { return valid(page) ? _len[page] : 0; }
+    size_t slotSize() const { return _slotSize; }
+
+    /** Pack a framebuffer into a page's slot, e.g. the journey page as the button takes it off the panel. */
+    bool store(int page, const uint8_t* fb) {
+        if (!valid(page)) return false;
+        uint8_t* s = slot(page);
+        size_t n = _slotSize > PAGE_HEADER_SIZE ? pagePack(fb, _frame, s + PAGE_HEADER_SIZE, _slotSize - PAGE_HEADER_SIZE) : 0;
+        _len[page] = n ? PAGE_HEADER_SIZE + n : 0;
+        if (n) pageHeader(s, _w, _h, 0);
+        return n != 0;
+    }
+
+    /** Where a fetched page of len bytes goes. The page is not held again until commit(). */
+    uint8_t* reserve(int page, size_t len) {
+        if (!valid(page) || len > _slotSize) return nullptr;
+        _len[page] = 0;
+        return slot(page);
+    }
+
+    /** Keep the len bytes written at reserve() if they are a whole page the size of this panel. */
+    bool commit(int page, size_t len) {
+        if (!valid(page) || len < PAGE_HEADER_SIZE || len > _slotSize) return false;
+        const uint8_t* s = slot(page);
+        if (s[0] != 'P' || s[1] != 'G' || s[2] != PAGE_VERSION) return false;
+        if ((s[4] | (s[5] << 8)) != _w || (s[6] | (s[7] << 8)) != _h) return false;
+        if (!pageUnpack(s + PAGE_HEADER_SIZE, len - PAGE_HEADER_SIZE, nullptr, _frame)) return false;
+        _len[page] = len;
+        return true;
+    }
+
+    /** Unpack a held page into the framebuffer. Only whole pages are held, so this can't stop halfway. */
+    bool show(int page, uint8_t* fb) const {
+        if (!held(page)) return false;
+        return pageUnpack(slot(page) + PAGE_HEADER_SIZE, _len[page] - PAGE_HEADER_SIZE, fb, _frame);
+    }
+
+    void drop(int page) { if (valid(page)) _len[page] = 0; }
+
+private:
+    bool valid(int page) const { return _arena && page >= 0 && page < PAGE_SLOTS; }
+    uint8_t* slot(int page) const { return _arena + (size_t)page * _slotSize; }
+
+    uint8_t* _arena = nullptr;
+    size_t _slotSize = 0, _frame = 0;
+    int _w = 0, _h = 0;
+    size_t _len[PAGE_SLOTS] = {};
+};
+
+#endif // PAGE_CACHE_HPP
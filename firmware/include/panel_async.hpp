@@ -0,0 +1,172 @@
+/**
+ * Asynchronous e-ink panel driver
+ *
+ * Wraps bb_epaper so a refresh returns as soon as the framebuffer has been
+ * clocked out. Completion is signalled by the EPD_BUSY_PIN edge interrupt,
+ * which wakes the waiting task (or light-sleeps the chip) instead of
+ * busy-polling the pin. The CPU and radio are free to fetch and decode the
+ * next zone while the panel is still driving its waveform.
+ *
+ * Usage:
+ *   panel.begin();
+ *   panel.refresh(REFRESH_PARTIAL);      // returns immediately
+ *   ...fetch / decode next zone...
+ *   panel.refresh(REFRESH_PARTIAL);      // waits for the previous one first
+ *   panel.poll();                        // dispatch completion callbacks
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef PANEL_ASYNC_HPP
+#define PANEL_ASYNC_HPP
+
+#include <Arduino.h>
+#include <bb_epaper.h>
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "config.h"
+#include "trmnl_log.hpp"
+
+// Upper bound for a single waveform (full refresh on the 7.5" panel ~3.5s)
+#ifndef PANEL_REFRESH_TIMEOUT_MS
+#define PANEL_REFRESH_TIMEOUT_MS 8000
+#endif
+
+// Grace period before BUSY is trusted after issuing an update
+#ifndef PANEL_BUSY_ASSERT_MS
+#define PANEL_BUSY_ASSERT_MS 2
+#endif
+
+// Longest single sleep while waiting; the ISR normally wakes us much sooner
+#ifndef PANEL_WAIT_SLICE_MS
+#define PANEL_WAIT_SLICE_MS 250
+#endif
+
+// Light-sleep while waiting for BUSY. Off by default: light sleep pauses the
+// WiFi MAC, so only enable it when the radio is idle (or already in modem sleep).
+#ifndef PANEL_WAIT_LIGHT_SLEEP
+#define PANEL_WAIT_LIGHT_SLEEP 0
+#endif
+
+typedef void (*PanelDoneCallback)(int mode, uint32_t elapsedMs, void* ctx);
+
+class PanelAsync {
+public:
+    explicit PanelAsync(BBEPAPER& panel) : _panel(panel) {}
+
+    void begin() {
+        instance() = this;
+        pinMode(EPD_BUSY_PIN, INPUT);
+        // Completion is the transition back to the idle level
+        attachInterrupt(digitalPinToInterrupt(EPD_BUSY_PIN), onBusyEdge,
+                        EPD_BUSY_ACTIVE_LEVEL == LOW ? RISING : FALLING);
+    }
+
+    bool busy() const {
+        if (!_pending || _done) return false;
+        // The controller takes a moment to assert BUSY after the update command
+        if (millis() - _started < PANEL_BUSY_ASSERT_MS) return true;
+        return digitalRead(EPD_BUSY_PIN) == EPD_BUSY_ACTIVE_LEVEL;
+    }
+
+    /**
+     * Start a refresh without blocking. Waits for any refresh still in
+     * flight first, since the controller ignores commands while BUSY. If
+     * BUSY never clears the refresh is issued anyway: a stuck or missed
+     * BUSY line must not leave the picture stale until the next change.
+     * Returns false when it had to.
+     */
+    bool refresh(int mode, PanelDoneCallback cb = nullptr, void* ctx = nullptr) {
+        bool idle = waitIdle();
+        if (!idle) LOG_WARN("Panel: refresh %d issued after BUSY timeout", mode);
+        _mode = mode; _cb = cb; _ctx = ctx;
+        _waiter = xTaskGetCurrentTaskHandle();
+        _done = false; _pending = true;
+        _started = millis();
+        _panel.refresh(mode, false);
+        _count[mode == REFRESH_FULL]++;
+        return idle;
+    }
+
+    /**
+     * Block until the panel is idle. The task sleeps on a notification from
+     * the BUSY ISR, so WiFi and other tasks keep running.
+     */
+    bool waitIdle(uint32_t timeoutMs = PANEL_REFRESH_TIMEOUT_MS) {
+        if (!_pending) return true;
+        unsigned long start = millis();
+        while (busy()) {
+            uint32_t elapsed = millis() - start;
+            if (elapsed >= timeoutMs) {
+                LOG_WARN("Panel: BUSY timeout after %lums", (unsigned long)elapsed);
+                _pending = false;
+                _timeouts++;
+                return false;
+            }
+            // Bounded slices guard against an edge that fired before we armed
+            sleepUntilEdge(min(timeoutMs - elapsed, (uint32_t)PANEL_WAIT_SLICE_MS));
+        }
+        finish();
+        return true;
+    }
+
+    /** Dispatch the completion callback from loop context (non-blocking). */
+    void poll() {
+        if (_pending && !busy()) finish();
+    }
+
+    uint32_t lastRefreshMs() const { return _lastElapsed; }
+    /** Refreshes started since boot, for energy accounting. */
+    uint32_t refreshCount(bool full) const { return _count[full]; }
+    /** Waits that gave up on BUSY since boot. */
+    uint32_t timeouts() const { return _timeouts; }
+
+private:
+    static void IRAM_ATTR onBusyEdge() {
+        PanelAsync* self = instance();
+        if (!self || !self->_pending) return;
+        self->_done = true;
+        BaseType_t woken = pdFALSE;
+        if (self->_waiter) vTaskNotifyGiveFromISR(self->_waiter, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+
+    void sleepUntilEdge(uint32_t maxMs) {
+#if PANEL_WAIT_LIGHT_SLEEP
+        gpio_wakeup_enable((gpio_num_t)EPD_BUSY_PIN,
+                           EPD_BUSY_ACTIVE_LEVEL == LOW ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+        esp_sleep_enable_timer_wakeup((uint64_t)maxMs * 1000ULL);
+        esp_light_sleep_start();
+        gpio_wakeup_disable((gpio_num_t)EPD_BUSY_PIN);
+#else
+        _waiter = xTaskGetCurrentTaskHandle();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(maxMs));
+#endif
+    }
+
+    void finish() {
+        _pending = false;
+        _lastElapsed = millis() - _started;
+        PanelDoneCallback cb = _cb;
+        _cb = nullptr;
+        if (cb) cb(_mode, _lastElapsed, _ctx);
+    }
+
+    BBEPAPER& _panel;
+    volatile bool _done = true;
+    volatile bool _pending = false;
+    TaskHandle_t _waiter = nullptr;
+    int _mode = 0;
+    unsigned long _started = 0;
+    uint32_t _lastElapsed = 0;
+    uint32_t _count[2] = {0, 0};
+    uint32_t _timeouts = 0;
+    PanelDoneCallback _cb = nullptr;
+    void* _ctx = nullptr;
+
+    static PanelAsync*& instance() { static PanelAsync* self = nullptr; return self; }
+};
+
+#endif // PANEL_ASYNC_HPP
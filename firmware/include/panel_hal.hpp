@@ -0,0 +1,280 @@
+/**
+ * Panel traits and 1 bpp kernels specialised on them
+ *
+ * A panel is a PanelTraits<W, H, ROTATION, MSB_FIRST> type: its size,
+ * row pitch, rotation and the bit order of its framebuffer, all
+ * constexpr. The kernels below are templates on that type. Clipping,
+ * rotation and bit order are resolved at compile time, not on every call
+ * the way bbep.loadBMP() and bbep.fillRect() resolve them. When rows are
+ * a whole number of 32-bit words (800 px: 100 bytes), every row is worked
+ * a word at a time. Otherwise it is worked a byte at a time. The
+ * framebuffer must then be 4-byte aligned, which bb_epaper's malloc'd
+ * buffer is.
+ *
+ *   typedef PanelTrmnl75 Panel;
+ *   panelBlitBmp<Panel>(fb, x, y, bmp, len);       // zone BMP, false if not plain 1 bpp
+ *   panelInvert<Panel>(fb, x, y, w, h);            // anti-ghosting flash; twice restores
+ *   panelFill<Panel>(fb, x, y, w, h, true);
+ *   panelXor<Panel>(fb, x, y, w, h, bits, pitch);  // apply an XOR delta
+ *
+ * Coordinates are the panel's upright ones. ROTATION 180 (a panel
+ * mounted upside down) maps them onto the buffer in the kernels. Source
+ * rows are MSB-first 1 bpp, 1 = white, each readable to the next 4-byte
+ * boundary (BMP row padding).
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef PANEL_HAL_HPP
+#define PANEL_HAL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+template <int W_, int H_, int ROTATION_ = 0, bool MSB_FIRST_ = true>
+struct PanelTraits {
+    static_assert(ROTATION_ == 0 || ROTATION_ == 180, "panel kernels rotate by 0 or 180 degrees");
+    enum {
+        W = W_,
+        H = H_,
+        PITCH = (W_ + 7) / 8,
+        ROTATION = ROTATION_,
+        MSB_FIRST = MSB_FIRST_,         // pixel 0 in bit 7 (bb_epaper); else bit 0
+        WORD_ROWS = (W_ + 7) / 8 % 4 == 0,
+    };
+};
+
+// TRMNL 7.5" (OG): bb_epaper EP75_800x480
+typedef PanelTraits<800, 480> PanelTrmnl75;
+// The same panel mounted upside down
+typedef PanelTraits<800, 480, 180> PanelTrmnl75Flipped;
+// 4.2" 400x300 (bb_epaper EP42_400x300): 50-byte rows, worked a byte at a time
+typedef PanelTraits<400, 300> PanelEp42;
+
+// ---------------------------------------------------------------------------
+// Units: a row is worked in uint32_t words or bytes. Values are MSB-first,
+// so bit (BITS - 1) of a unit is its leftmost pixel whatever the memory order.
+
+template <class U> struct PanelUnit;
+
+template <> struct PanelUnit<uint8_t> {
+    enum { BITS = 8 };
+    static uint8_t be(const uint8_t* p) { return *p; }
+    static uint8_t le(const uint8_t* p) { return *p; }
+    static void putBe(uint8_t* p, uint8_t v) { *p = v; }
+    static void putLe(uint8_t* p, uint8_t v) { *p = v; }
+    static uint8_t rev(uint8_t v) {
+        v = (uint8_t)((v >> 4) | (v << 4));
+        v = (uint8_t)(((v >> 2) & 0x33) | ((v & 0x33) << 2));
+        return (uint8_t)(((v >> 1) & 0x55) | ((v & 0x55) << 1));
+    }
+};
+
+template <> struct PanelUnit<uint32_t> {
+    enum { BITS = 32 };
+    static uint32_t le(const uint8_t* p) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+    static uint32_t be(const uint8_t* p) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+    static void putLe(uint8_t* p, uint32_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        memcpy(p, &v, 4);
+    }
+    static void putBe(uint8_t* p, uint32_t v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        memcpy(p, &v, 4);
+    }
+    static uint32_t rev(uint32_t v) {
+        v = __builtin_bswap32(v);
+        v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+        v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+        return ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    }
+};
+
+/** The unit a panel's rows are worked in. */
+template <int WORDS> struct PanelUnitFor { typedef uint8_t type; };
+template <> struct PanelUnitFor<1> { typedef uint32_t type; };
+
+// Framebuffer units in and out, MSB-first whatever the panel's bit order
+template <class P, class U>
+static inline U panelLoad(const uint8_t* p) {
+    return P::MSB_FIRST ? PanelUnit<U>::be(p) : PanelUnit<U>::rev(PanelUnit<U>::le(p));
+}
+template <class P, class U>
+static inline void panelStore(uint8_t* p, U v) {
+    if (P::MSB_FIRST) PanelUnit<U>::putBe(p, v);
+    else PanelUnit<U>::putLe(p, PanelUnit<U>::rev(v));
+}
+
+// ---------------------------------------------------------------------------
+// Pixel streams and the ops that write them
+
+/** Rows of source bits. REVERSE walks each row right to left (ROTATION 180). */
+template <class U, bool REVERSE>
+struct PanelBits {
+    const uint8_t* row;
+    ptrdiff_t step;
+    int units;      // units holding the row's pixels
+
+    U unit(int j) const {
+        if (j < 0 || j >= units) return 0;
+        if (!REVERSE) return PanelUnit<U>::be(row + j * sizeof(U));
+        return PanelUnit<U>::rev(PanelUnit<U>::be(row + (units - 1 - j) * sizeof(U)));
+    }
+    void next() { row += step; }
+};
+
+/** The same unit everywhere: a fill, or all ones to invert. */
+template <class U>
+struct PanelSolid {
+    U v;
+    U unit(int) const { return v; }
+    void next() {}
+};
+
+// apply() writes the pixels in mask m; whole() a unit with every pixel in it
+struct PanelOpCopy {
+    template <class U> static U apply(U d, U v, U m) { return (U)((d & ~m) | (v & m)); }
+    template <class U> static U whole(U, U v) { return v; }
+};
+struct PanelOpXor {
+    template <class U> static U apply(U d, U v, U m) { return (U)(d ^ (v & m)); }
+    template <class U> static U whole(U d, U v) { return (U)(d ^ v); }
+};
+
+/**
+ * Buffer columns [x0, x1) of one row from a stream whose bit 0 lands on
+ * column base (base may lie left of x0, or left of the row). Only the two
+ * edge units are masked.
+ */
+template <class P, class Op, class U, class Src>
+static inline void panelRow(uint8_t* row, int x0, int x1, int base, const Src& src) {
+    const int B = PanelUnit<U>::BITS;
+    const U ones = (U)~(U)0;
+    int k0 = x0 / B, k1 = (x1 - 1) / B;
+    int off = k0 * B - base;
+    int j = off >= 0 ? off / B : -((-off + B - 1) / B);
+    const int sh = off - j * B;
+    U first = (U)(ones >> (x0 - k0 * B)), last = (U)(ones << ((k1 + 1) * B - x1));
+    U cur = src.unit(j);
+    // The stream's next B bits at the unit boundary
+    auto take = [&]() {
+        U nxt = src.unit(++j);
+        U v = sh ? (U)((U)(cur << sh) | (U)(nxt >> (B - sh))) : cur;
+        cur = nxt;
+        return v;
+    };
+    uint8_t* p = row + k0 * sizeof(U);
+    if (k0 == k1) {
+        panelStore<P, U>(p, Op::apply(panelLoad<P, U>(p), take(), (U)(first & last)));
+        return;
+    }
+    panelStore<P, U>(p, Op::apply(panelLoad<P, U>(p), take(), first));
+    for (p += sizeof(U); p < row + k1 * sizeof(U); p += sizeof(U)) panelStore<P, U>(p, Op::whole(panelLoad<P, U>(p), take()));
+    panelStore<P, U>(p, Op::apply(panelLoad<P, U>(p), take(), last));
+}
+
+/**
+ * A w x h rectangle at (x, y), clipped to the panel. For ROTATION 180 the
+ * rows go bottom up and each is mirrored into the buffer.
+ */
+template <class P, class Op, class U, class Src>
+static inline void panelRect(uint8_t* fb, int x, int y, int w, int h, Src src, int units) {
+    const int B = PanelUnit<U>::BITS;
+    int cx0 = x < 0 ? 0 : x, cx1 = x + w > P::W ? P::W : x + w;
+    int cy0 = y < 0 ? 0 : y, cy1 = y + h > P::H ? P::H : y + h;
+    if (cx0 >= cx1 || cy0 >= cy1) return;
+    for (int r = y; r < cy0; r++) src.next();
+    fb = (uint8_t*)__builtin_assume_aligned(fb, sizeof(U));
+    for (int r = cy0; r < cy1; r++, src.next()) {
+        if (P::ROTATION == 0) panelRow<P, Op, U>(fb + (size_t)r * P::PITCH, cx0, cx1, x, src);
+        else panelRow<P, Op, U>(fb + (size_t)(P::H - 1 - r) * P::PITCH, P::W - cx1, P::W - cx0, P::W - x - units * B, src);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Kernels
+
+/** Fill a rectangle white or black. */
+template <class P>
+static inline void panelFill(uint8_t* fb, int x, int y, int w, int h, bool white) {
+    typedef typename PanelUnitFor<P::WORD_ROWS>::type U;
+    PanelSolid<U> s = { white ? (U)~(U)0 : (U)0 };
+    panelRect<P, PanelOpCopy, U>(fb, x, y, w, h, s, 0);
+}
+
+/** Invert a rectangle in place (the flash); doing it twice restores it exactly. */
+template <class P>
+static inline void panelInvert(uint8_t* fb, int x, int y, int w, int h) {
+    typedef typename PanelUnitFor<P::WORD_ROWS>::type U;
+    PanelSolid<U> s = { (U)~(U)0 };
+    panelRect<P, PanelOpXor, U>(fb, x, y, w, h, s, 0);
+}
+
+/** Copy w x h source bits to (x, y). srcStep is the row step, negative for bottom-up rows. */
+template <class P>
+static inline void panelBlit(uint8_t* fb, int x, int y, int w, int h, const uint8_t* src, ptrdiff_t srcStep) {
+    typedef typename PanelUnitFor<P::WORD_ROWS>::type U;
+    const int units = (w + PanelUnit<U>::BITS - 1) / PanelUnit<U>::BITS;
+    PanelBits<U, (int)P::ROTATION == 180> s = { src, srcStep, units };
+    panelRect<P, PanelOpCopy, U>(fb, x, y, w, h, s, units);
+}
+
+/** XOR w x h source bits into (x, y): a delta against what the buffer holds. */
+template <class P>
+static inline void panelXor(uint8_t* fb, int x, int y, int w, int h, const uint8_t* src, ptrdiff_t srcStep) {
+    typedef typename PanelUnitFor<P::WORD_ROWS>::type U;
+    const int units = (w + PanelUnit<U>::BITS - 1) / PanelUnit<U>::BITS;
+    PanelBits<U, (int)P::ROTATION == 180> s = { src, srcStep, units };
+    panelRect<P, PanelOpXor, U>(fb, x, y, w, h, s, units);
+}
+
+static inline uint32_t panelLe32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+/**
+ * Draw a BMP with its top-left at (x, y), clipped to the panel. Takes what
+ * the server renders (1 bpp, uncompressed, palette index 1 light, in
+ * either row order) at any size. Returns false, leaving fb untouched, for
+ * anything else; the caller then goes through bbep.loadBMP().
+ */
+template <class P>
+static inline bool panelBlitBmp(uint8_t* fb, int x, int y, const uint8_t* bmp, size_t len) {
+    if (len < 62 || bmp[0] != 'B' || bmp[1] != 'M') return false;
+    uint32_t dataOff = panelLe32(bmp + 10), infoSize = panelLe32(bmp + 14);
+    int32_t w = (int32_t)panelLe32(bmp + 18), h = (int32_t)panelLe32(bmp + 22);
+    uint16_t bpp = bmp[28] | (bmp[29] << 8);
+    bool topDown = h < 0;
+    if (topDown) h = -h;
+    if (w <= 0 || w > 32767 || h == 0 || h > 32767 || bpp != 1 || panelLe32(bmp + 30) != 0) return false;
+    size_t pitch = (size_t)(w + 31) / 32 * 4;
+    if (infoSize > len - 22 || dataOff > len || pitch * h > len - dataOff) return false;
+    // Palette entries are B,G,R,0: index 0 dark, index 1 light
+    const uint8_t* pal = bmp + 14 + infoSize;
+    if (pal[1] >= 128 || pal[5] < 128) return false;
+
+    const uint8_t* data = bmp + dataOff;
+    if (topDown) panelBlit<P>(fb, x, y, w, h, data, (ptrdiff_t)pitch);
+    else panelBlit<P>(fb, x, y, w, h, data + (h - 1) * pitch, -(ptrdiff_t)pitch);
+    return true;
+}
+
+#endif // PANEL_HAL_HPP
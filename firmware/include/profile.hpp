@@ -0,0 +1,249 @@
+/**
+ * Stage profiler: scoped cycle counts in per-stage log2 histograms
+ *
+ * PROFILE_SCOPE(stage) times the rest of the enclosing block and adds
+ * that time to the stage's histogram. The time is in CPU cycles on the
+ * ESP32 and TSC ticks on an x86 host (steady_clock ns elsewhere). Bucket
+ * i counts the samples of 2^i .. 2^(i+1)-1 ticks. A stage interleaved
+ * with network reads (a tile stream's decoder feeds) is summed over a
+ * ProfileLap and recorded as one sample:
+ *
+ *   PROFILE_SCOPE(PROF_LIST_PARSE);
+ *   PROFILE_LAP(lap);
+ *   while (...) { r = rd.read(...); PROFILE_LAP_RUN(lap, dec.feed(chunk, r)); }
+ *   PROFILE_LAP_END(lap, PROF_TILES);
+ *   ...
+ *   PROFILE_DUMP(Serial, FIRMWARE_VERSION);        // idle point, next to logDrain()
+ *
+ * Every PROFILE_DUMP_MS the dump prints a line per stage and one
+ * "#P {json}" line with the raw histograms since boot;
+ * host/bench/compare-profile.py compares the last #P line of two serial
+ * captures. With PROFILE_ENABLED=0 (the default) the macros are empty,
+ * their arguments are not evaluated and nothing is linked in.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdio.h>
+#if defined(ESP_PLATFORM)
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "esp_cpu.h"
+#else
+#include "hal/cpu_hal.h"
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <chrono>
+#else
+#include <chrono>
+#endif
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 0
+#endif
+#ifndef PROFILE_DUMP_MS
+#define PROFILE_DUMP_MS 3600000UL
+#endif
+
+#define PROFILE_BUCKETS 32
+#define PROFILE_VERSION 1
+
+enum ProfileStage : uint8_t {
+    PROF_LIST_PARSE,    // zone list CSV
+    PROF_JSON_PARSE,    // V11 zone JSON (main.cpp)
+    PROF_BASE64,        // V11 zone BMP decode (main.cpp)
+    PROF_BLIT,          // a whole zone BMP into the framebuffer: layout spans or loadBMP
+    PROF_TILES,         // tile stream decoder, one sample per zone
+    PROF_FLASH,         // zone flash: fill (or invert) and the partial refresh
+    PROF_STAGES
+};
+
+static const char* const PROFILE_STAGE_NAMES[PROF_STAGES] = {"list_parse", "json_parse", "base64", "blit", "tiles", "flash"};
+
+#if defined(ESP_PLATFORM)
+// 32-bit cycle counter: wraps after ~27 s at 160 MHz, far longer than any stage
+typedef uint32_t ProfileTicks;
+#if ESP_IDF_VERSION_MAJOR >= 5
+static inline ProfileTicks profileTicks() { return (ProfileTicks)esp_cpu_get_cycle_count(); }
+#else
+static inline ProfileTicks profileTicks() { return (ProfileTicks)cpu_hal_get_cycle_count(); }
+#endif
+static inline uint64_t profileTickHz() { return (uint64_t)getCpuFrequencyMhz() * 1000000; }
+#elif defined(__x86_64__) || defined(__i386__)
+typedef uint64_t ProfileTicks;
+static inline ProfileTicks profileTicks() { return __rdtsc(); }
+/** TSC rate, measured once against steady_clock over 20 ms. */
+static inline uint64_t profileTickHz() {
+    static uint64_t hz = 0;
+    if (!hz) {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = __rdtsc();
+        while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(20)) {}
+        uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        hz = (__rdtsc() - c0) * 1000000000ull / (ns ? ns : 1);
+    }
+    return hz;
+}
+#else
+typedef uint64_t ProfileTicks;
+static inline ProfileTicks profileTicks() {
+    return (ProfileTicks)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static inline uint64_t profileTickHz() { return 1000000000ull; }
+#endif
+
+struct ProfileHistogram {
+    uint32_t buckets[PROFILE_BUCKETS] = {};
+    uint32_t count = 0;
+    uint64_t sum = 0, max = 0;
+
+    static int bucket(uint64_t ticks) {
+        int b = ticks ? 63 - __builtin_clzll(ticks) : 0;
+        return b < PROFILE_BUCKETS ? b : PROFILE_BUCKETS - 1;
+    }
+    void add(uint64_t ticks) {
+        buckets[bucket(ticks)]++;
+        count++;
+        sum += ticks;
+        if (ticks > max) max = ticks;
+    }
+    /** Ticks that q (0..1) of the samples are below: the top of its bucket, never above the largest seen. */
+    uint64_t below(double q) const {
+        uint64_t rank = (uint64_t)(q * count + 0.999999), seen = 0;
+        if (!count) return 0;
+        if (rank == 0) rank = 1;
+        for (int b = 0; b < PROFILE_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                uint64_t top = b == PROFILE_BUCKETS - 1 ? max : ((uint64_t)2 << b) - 1;
+                return top < max ? top : max;
+            }
+        }
+        return max;
+    }
+};
+
+class Profiler {
+public:
+    void add(ProfileStage s, uint64_t ticks) { if (s < PROF_STAGES) _stages[s].add(ticks); }
+    const ProfileHistogram& stage(ProfileStage s) const { return _stages[s]; }
+    void reset() { for (ProfileHistogram& h : _stages) h = ProfileHistogram(); }
+
+    /** PROFILE_DUMP_MS since the last dump (or since boot for the first). */
+    bool due(unsigned long now) const { return now - _dumpedAt >= PROFILE_DUMP_MS; }
+    void dumped(unsigned long now) { _dumpedAt = now; }
+
+private:
+    ProfileHistogram _stages[PROF_STAGES];
+    unsigned long _dumpedAt = 0;
+};
+
+inline Profiler& profiler() { static Profiler p; return p; }
+
+/** Times its own lifetime into a stage. */
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileStage s) : _stage(s), _t0(profileTicks()) {}
+    ~ProfileScope() { profiler().add(_stage, (ProfileTicks)(profileTicks() - _t0)); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileStage _stage;
+    ProfileTicks _t0;
+};
+
+/** Sums the pieces of one stage spread over a loop; record() adds them as one sample. */
+class ProfileLap {
+public:
+    void start() { _t0 = profileTicks(); }
+    void stop() { _total += (ProfileTicks)(profileTicks() - _t0); }
+    void record(ProfileStage s) { profiler().add(s, _total); _total = 0; }
+
+private:
+    ProfileTicks _t0 = 0;
+    uint64_t _total = 0;
+};
+
+/**
+ * The histograms as one JSON object on one line (no newline):
+ * {"v":1,"build":"..","hz":N,"stages":{"blit":{"n":..,"sum":..,"max":..,"log2":[..32 counts..]},..}}
+ * Stages with no samples are left out. Returns bytes written.
+ */
+template <class Out>
+inline size_t profileExport(Out& out, const Profiler& p, const char* build) {
+    char s[96];
+    size_t total = 0;
+    auto put = [&](const char* t) { out.print(t); total += strlen(t); };
+    snprintf(s, sizeof(s), "{\"v\":%d,\"build\":\"%.40s\",\"hz\":%llu,\"stages\":{", PROFILE_VERSION, build ? build : "",
+             (unsigned long long)profileTickHz());
+    put(s);
+    bool first = true;
+    for (int i = 0; i < PROF_STAGES; i++) {
+        const ProfileHistogram& h = p.stage((ProfileStage)i);
+        if (!h.count) continue;
+        snprintf(s, sizeof(s), "%s\"%s\":{\"n\":%lu,\"sum\":%llu,\"max\":%llu,\"log2\":[", first ? "" : ",", PROFILE_STAGE_NAMES[i],
+                 (unsigned long)h.count, (unsigned long long)h.sum, (unsigned long long)h.max);
+        put(s);
+        for (int b = 0; b < PROFILE_BUCKETS; b++) {
+            snprintf(s, sizeof(s), b ? ",%lu" : "%lu", (unsigned long)h.buckets[b]);
+            put(s);
+        }
+        put("]}");
+        first = false;
+    }
+    put("}}");
+    return total;
+}
+
+/**
+ * Once PROFILE_DUMP_MS has passed: a summary line per stage, then "#P " and
+ * profileExport(). Call from an idle point. Returns bytes written, 0 when not due.
+ */
+template <class Out>
+inline size_t profileDump(Out& out, const char* build, unsigned long now) {
+    Profiler& p = profiler();
+    if (!p.due(now)) return 0;
+    p.dumped(now);
+    double usPerTick = 1e6 / (double)profileTickHz();
+    char line[128];
+    size_t total = 0;
+    for (int i = 0; i < PROF_STAGES; i++) {
+        const ProfileHistogram& h = p.stage((ProfileStage)i);
+        if (!h.count) continue;
+        snprintf(line, sizeof(line), "Prof %s: %lu, mean %.0f us, p50 < %.0f us, p99 < %.0f us, max %.0f us\n", PROFILE_STAGE_NAMES[i],
+                 (unsigned long)h.count, h.sum * usPerTick / h.count, h.below(0.5) * usPerTick, h.below(0.99) * usPerTick,
+                 h.max * usPerTick);
+        out.print(line);
+        total += strlen(line);
+    }
+    out.print("#P ");
+    total += 3 + profileExport(out, p, build);
+    out.print("\n");
+    return total + 1;
+}
+
+#if PROFILE_ENABLED
+#define PROFILE_CAT2(a, b) a##b
+#define PROFILE_CAT(a, b) PROFILE_CAT2(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CAT(_profileScope, __LINE__)(stage)
+#define PROFILE_LAP(name) ProfileLap name
+#define PROFILE_LAP_RUN(name, stmt) do { name.start(); stmt; name.stop(); } while (0)
+#define PROFILE_LAP_END(name, stage) name.record(stage)
+#define PROFILE_DUMP(out, build) profileDump(out, build, millis())
+#else
+#define PROFILE_SCOPE(stage) do {} while (0)
+#define PROFILE_LAP(name) do {} while (0)
+#define PROFILE_LAP_RUN(name, stmt) do { stmt; } while (0)
+#define PROFILE_LAP_END(name, stage) do {} while (0)
+#define PROFILE_DUMP(out, build) do {} while (0)
+#endif
+
+#endif // PROFILE_HPP
@@ -0,0 +1,314 @@
+/**
+ * Sprite dictionary and zone draw lists
+ *
+ * The pictograms the server draws into zones (train, tram, walk, coffee,
+ * the weather icons, ...) live in firmware/sprites/sprites.txt. Both sides
+ * compile that file into one dictionary image: the server to draw with, the
+ * device in its "sprites" partition, read in place like the timetable. A
+ * zone can then arrive as a draw list: fill the background, put sprite #7
+ * at (8,20), and send as raw bits only what no sprite or fill explains.
+ *
+ * Dictionary image (little-endian):
+ *   SpriteDictHeader
+ *   SpriteEntry[count]       sorted by id
+ *   bitmaps                  rows of (w+7)/8 bytes, bit 7 leftmost, 1 = white
+ *
+ * Draw list, see src/services/zone-sprites.js:
+ *   header  'Z' 'D' version 0 | x:i16 y:i16 w:u16 h:u16 | dictVersion:u32 | ops:u16
+ *   op      FILL   0 x:u16 y:u16 w:u16 h:u16 white:u8
+ *           SPRITE 1 id:u16 x:u16 y:u16
+ *           BITS   2 x:u16 y:u16 w:u16 h:u16, then h rows of (w+7)/8 bytes
+ * Op coordinates are relative to the zone and must lie inside it. The
+ * server only sends a draw list to a device that reported the same
+ * dictVersion (X-Sprites), so a sprite id always means the same pixels.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef SPRITE_DICT_HPP
+#define SPRITE_DICT_HPP
+
+#include "timetable.hpp"     // ttCrc32: the image CRC doubles as its ETag, as for the timetable
+#include "zone_tiles.hpp"    // TileSurface and the clipped byte helpers
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SPRITE_DICT_MAGIC 0x31525053u     // "SPR1"
+#define SPRITE_DICT_FORMAT 1
+#define SPRITE_PARTITION_SUBTYPE 0x41     // custom data partition, see partitions-timetable.csv
+
+#define DRAW_LIST_VERSION 1
+#define DRAW_LIST_HEADER_SIZE 18
+#define DRAW_LIST_ROW_MAX 128             // BITS rows up to 1024 pixels
+
+enum DrawOp : uint8_t { DRAW_FILL = 0, DRAW_SPRITE = 1, DRAW_BITS = 2 };
+
+struct SpriteDictHeader {
+    uint32_t magic;
+    uint16_t format;
+    uint16_t headerSize;
+    uint32_t crc;                 // CRC-32 of everything after the header
+    uint32_t totalSize;
+    uint32_t dictVersion;         // "version" line of sprites.txt
+    uint16_t count;
+    uint16_t reserved;
+};
+
+struct SpriteEntry {
+    uint16_t id;
+    uint8_t w, h;
+    uint32_t off;                 // of the bitmap, from the start of the image
+};
+
+static_assert(sizeof(SpriteDictHeader) == 24 && sizeof(SpriteEntry) == 8, "sprite dictionary layout");
+
+static inline int spritePitch(int w) { return (w + 7) / 8; }
+
+/**
+ * Copy one row of w pixels (bit 7 leftmost) to (x, py). A row wholly on the
+ * surface is shifted and merged a byte at a time with no per-pixel work;
+ * one that hangs off an edge goes through the clipped tilePutByte().
+ */
+static inline void spriteBlitRow(const TileSurface& s, int x, int py, const uint8_t* src, int w) {
+    if (py < 0 || py >= s.height || w <= 0) return;
+    int full = w >> 3, rem = w & 7;
+    if (x < 0 || x + w > s.width) {
+        for (int b = 0; b * 8 < w; b++) tilePutByte(s, x + b * 8, py, src[b], tileEdgeMask(w - b * 8));
+        return;
+    }
+    uint8_t* d = s.fb + py * s.pitch + (x >> 3);
+    int sh = x & 7;
+    if (!sh) {
+        memcpy(d, src, full);
+        if (rem) { uint8_t m = (uint8_t)(0xFF << (8 - rem)); d[full] = (uint8_t)((d[full] & ~m) | (src[full] & m)); }
+        return;
+    }
+    // Each source byte straddles two framebuffer bytes: the low bits of one, the high bits of the next
+    uint8_t keep = (uint8_t)(0xFF << (8 - sh));
+    for (int i = 0; i < full; i++) {
+        uint8_t v = src[i];
+        d[i] = (uint8_t)((d[i] & keep) | (v >> sh));
+        d[i + 1] = (uint8_t)((d[i + 1] & ~keep) | (uint8_t)(v << (8 - sh)));
+    }
+    if (rem) {
+        uint8_t m = (uint8_t)(0xFF << (8 - rem)), v = src[full];
+        uint8_t m1 = (uint8_t)(m >> sh), m2 = (uint8_t)(m << (8 - sh));
+        d[full] = (uint8_t)((d[full] & ~m1) | ((v >> sh) & m1));
+        if (m2) d[full + 1] = (uint8_t)((d[full + 1] & ~m2) | ((uint8_t)(v << (8 - sh)) & m2));
+    }
+}
+
+/** Copy a w x h image with rows of srcPitch bytes to (x, y), clipped to the surface. */
+static inline void spriteBlit(const TileSurface& s, int x, int y, const uint8_t* src, int w, int h, int srcPitch) {
+    for (int r = 0; r < h; r++) spriteBlitRow(s, x, y + r, src + r * srcPitch, w);
+}
+
+/** Fill a rectangle black or white, clipped to the surface. */
+static inline void spriteFill(const TileSurface& s, int x, int y, int w, int h, bool white) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > s.width) w = s.width - x;
+    if (y + h > s.height) h = s.height - y;
+    if (w <= 0 || h <= 0) return;
+    uint8_t v = white ? 0xFF : 0x00;
+    int b0 = x >> 3, b1 = (x + w - 1) >> 3;
+    uint8_t m0 = (uint8_t)(0xFF >> (x & 7)), m1 = (uint8_t)(0xFF << (7 - ((x + w - 1) & 7)));
+    for (int py = y; py < y + h; py++) {
+        uint8_t* row = s.fb + py * s.pitch;
+        if (b0 == b1) { uint8_t m = m0 & m1; row[b0] = (uint8_t)((row[b0] & ~m) | (v & m)); continue; }
+        row[b0] = (uint8_t)((row[b0] & ~m0) | (v & m0));
+        if (b1 - b0 > 1) memset(row + b0 + 1, v, b1 - b0 - 1);
+        row[b1] = (uint8_t)((row[b1] & ~m1) | (v & m1));
+    }
+}
+
+class SpriteDict {
+public:
+    /**
+     * Adopt an image (normally mapped flash). size may exceed the image,
+     * e.g. the whole partition. Nothing is copied; data must outlive this.
+     */
+    bool open(const uint8_t* data, size_t size, bool verifyCrc = true) {
+        _h = nullptr;
+        if (!data || size < sizeof(SpriteDictHeader)) return false;
+        const SpriteDictHeader* h = (const SpriteDictHeader*)data;
+        if (h->magic != SPRITE_DICT_MAGIC || h->format != SPRITE_DICT_FORMAT || h->headerSize != sizeof(SpriteDictHeader)) return false;
+        if (h->totalSize > size || h->totalSize < sizeof(SpriteDictHeader) + (size_t)h->count * sizeof(SpriteEntry)) return false;
+        if (verifyCrc && ttCrc32(data + sizeof(SpriteDictHeader), h->totalSize - sizeof(SpriteDictHeader)) != h->crc) return false;
+        const SpriteEntry* e = (const SpriteEntry*)(data + sizeof(SpriteDictHeader));
+        for (int i = 0; i < h->count; i++) {
+            if (i > 0 && e[i].id <= e[i - 1].id) return false;
+            if (e[i].off > h->totalSize || (size_t)spritePitch(e[i].w) * e[i].h > h->totalSize - e[i].off) return false;
+        }
+        _base = data;
+        _h = h;
+        _entries = e;
+        return true;
+    }
+
+    bool valid() const { return _h != nullptr; }
+    uint32_t crc() const { return _h ? _h->crc : 0; }
+    uint32_t size() const { return _h ? _h->totalSize : 0; }
+    uint32_t version() const { return _h ? _h->dictVersion : 0; }
+    int count() const { return _h ? _h->count : 0; }
+    const SpriteEntry& entry(int i) const { return _entries[i]; }
+    const uint8_t* bits(const SpriteEntry& e) const { return _base + e.off; }
+
+    /** The sprite with this id, nullptr if the dictionary has none. */
+    const SpriteEntry* find(uint16_t id) const {
+        int lo = 0, hi = count() - 1;
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+            if (_entries[mid].id == id) return &_entries[mid];
+            if (_entries[mid].id < id) lo = mid + 1; else hi = mid - 1;
+        }
+        return nullptr;
+    }
+
+private:
+    const uint8_t* _base = nullptr;
+    const SpriteDictHeader* _h = nullptr;
+    const SpriteEntry* _entries = nullptr;
+};
+
+class DrawListDecoder {
+public:
+    void begin(const TileSurface& surface, const SpriteDict& dict) {
+        _s = surface; _dict = &dict;
+        _stage = STAGE_HEADER; _need = DRAW_LIST_HEADER_SIZE; _have = 0;
+        _ops = _applied = _sprites = 0; _bytes = 0; _error = false; _staleDict = false;
+        _dx0 = _dy0 = 32767; _dx1 = _dy1 = -32768;
+    }
+
+    /** Feed bytes in whatever chunks they arrive. Returns false once the list is malformed. */
+    bool feed(const uint8_t* data, size_t len) {
+        while (len > 0 && !_error && _stage != STAGE_DONE) {
+            size_t n = _need - _have;
+            if (n > len) n = len;
+            memcpy(_buf + _have, data, n);
+            _have += n; data += n; len -= n; _bytes += n;
+            if (_have == _need) step();
+        }
+        return !_error;
+    }
+
+    bool done() const { return _stage == STAGE_DONE; }
+    bool error() const { return _error; }
+    /** The list was made for another dictionary version than the one we hold. */
+    bool staleDict() const { return _staleDict; }
+    int16_t x() const { return _x; }
+    int16_t y() const { return _y; }
+    uint16_t w() const { return _w; }
+    uint16_t h() const { return _h; }
+    int ops() const { return _ops; }
+    int applied() const { return _applied; }
+    int sprites() const { return _sprites; }
+    uint32_t bytes() const { return _bytes; }
+
+    /** Bounding box of everything drawn; false if nothing was. */
+    bool dirtyRect(int& x, int& y, int& w, int& h) const {
+        if (_applied == 0) return false;
+        x = _dx0; y = _dy0; w = _dx1 - _dx0; h = _dy1 - _dy0;
+        return true;
+    }
+
+private:
+    enum Stage : uint8_t { STAGE_HEADER, STAGE_OP, STAGE_ARGS, STAGE_ROW, STAGE_DONE };
+
+    static uint16_t u16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+    void expect(Stage stage, size_t n) { _stage = stage; _need = n; _have = 0; }
+
+    static size_t argBytes(uint8_t op) { return op == DRAW_FILL ? 9 : op == DRAW_SPRITE ? 6 : op == DRAW_BITS ? 8 : 0; }
+
+    bool inside(int x, int y, int w, int h) const { return w > 0 && h > 0 && x + w <= _w && y + h <= _h; }
+
+    void nextOp() {
+        if (++_applied == _ops) expect(STAGE_DONE, 0);
+        else expect(STAGE_OP, 1);
+    }
+
+    void touched(int x, int y, int w, int h) {
+        x += _x; y += _y;
+        if (x < _dx0) _dx0 = x;
+        if (y < _dy0) _dy0 = y;
+        if (x + w > _dx1) _dx1 = x + w;
+        if (y + h > _dy1) _dy1 = y + h;
+    }
+
+    void step() {
+        switch (_stage) {
+        case STAGE_HEADER: {
+            if (_buf[0] != 'Z' || _buf[1] != 'D' || _buf[2] != DRAW_LIST_VERSION) { _error = true; return; }
+            _x = (int16_t)u16(_buf + 4); _y = (int16_t)u16(_buf + 6);
+            _w = u16(_buf + 8); _h = u16(_buf + 10);
+            uint32_t version = (uint32_t)u16(_buf + 12) | ((uint32_t)u16(_buf + 14) << 16);
+            _ops = u16(_buf + 16);
+            if (_ops && (!_dict->valid() || version != _dict->version())) { _staleDict = true; _error = true; return; }
+            if (_ops == 0) expect(STAGE_DONE, 0);
+            else expect(STAGE_OP, 1);
+            break;
+        }
+        case STAGE_OP:
+            _op = _buf[0];
+            if (!argBytes(_op)) { _error = true; return; }
+            expect(STAGE_ARGS, argBytes(_op));
+            break;
+        case STAGE_ARGS:
+            if (!apply()) { _error = true; return; }
+            break;
+        case STAGE_ROW:
+            spriteBlitRow(_s, _x + _bx, _y + _by + _row, _buf, _bw);
+            if (++_row == _bh) nextOp();
+            else expect(STAGE_ROW, spritePitch(_bw));
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool apply() {
+        if (_op == DRAW_SPRITE) {
+            const SpriteEntry* e = _dict->find(u16(_buf));
+            int x = u16(_buf + 2), y = u16(_buf + 4);
+            if (!e || !inside(x, y, e->w, e->h)) return false;
+            spriteBlit(_s, _x + x, _y + y, _dict->bits(*e), e->w, e->h, spritePitch(e->w));
+            touched(x, y, e->w, e->h);
+            _sprites++;
+            nextOp();
+            return true;
+        }
+        int x = u16(_buf), y = u16(_buf + 2), w = u16(_buf + 4), h = u16(_buf + 6);
+        if (!inside(x, y, w, h)) return false;
+        touched(x, y, w, h);
+        if (_op == DRAW_FILL) {
+            spriteFill(_s, _x + x, _y + y, w, h, _buf[8] != 0);
+            nextOp();
+            return true;
+        }
+        // BITS: rows are drawn as they arrive, one row buffer whatever the size
+        if (spritePitch(w) > DRAW_LIST_ROW_MAX) return false;
+        _bx = x; _by = y; _bw = w; _bh = h; _row = 0;
+        expect(STAGE_ROW, spritePitch(w));
+        return true;
+    }
+
+    TileSurface _s = {nullptr, 0, 0, 0};
+    const SpriteDict* _dict = nullptr;
+    Stage _stage = STAGE_HEADER;
+    size_t _need = DRAW_LIST_HEADER_SIZE, _have = 0;
+    uint8_t _buf[DRAW_LIST_ROW_MAX];
+    int16_t _x = 0, _y = 0;
+    uint16_t _w = 0, _h = 0;
+    int _ops = 0, _applied = 0, _sprites = 0;
+    uint32_t _bytes = 0;
+    bool _error = false, _staleDict = false;
+    uint8_t _op = 0;
+    int _bx = 0, _by = 0, _bw = 0, _bh = 0, _row = 0;
+    int _dx0 = 0, _dy0 = 0, _dx1 = 0, _dy1 = 0;
+};
+
+#endif // SPRITE_DICT_HPP
@@ -0,0 +1,233 @@
+/**
+ * Offline timetable: compiled GTFS schedule, read in place from flash
+ *
+ * host/tools/gtfs-compile turns a GTFS feed, filtered to the configured
+ * stops, into one little-endian image that the firmware memory-maps from
+ * the "timetable" partition. When the server or network is unreachable
+ * the device still answers "next N departures from stop S after T" from
+ * it - a binary search and a short scan, no heap, no parsing.
+ *
+ * Image layout (all offsets from the start, 4-byte aligned):
+ *   TtHeader
+ *   TtStop[stopCount]        sorted by stop_id, for binary search
+ *   TtRoute[routeCount]
+ *   TtPattern[patternCount]  (route, service, headsign) shared by many trips
+ *   calendar                 serviceCount rows of ceil(dayCount/8) bytes,
+ *                            bit d set = service runs on firstDay + d
+ *   TtBlock[]                per stop: absolute time of every TT_BLOCK'th event
+ *   TtEvent[]                per stop, by departure time: delta seconds + pattern
+ *   strings                  NUL-terminated
+ *
+ * Times are GTFS service-day seconds, so they run past 86400 for trips that
+ * started the day before; a lookup checks yesterday's service day too.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef TIMETABLE_HPP
+#define TIMETABLE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TT_MAGIC 0x31425454u          // "TTB1"
+#define TT_VERSION 1
+#define TT_BLOCK 16                    // events between absolute times
+#define TT_PARTITION_SUBTYPE 0x40      // custom data partition, see partitions-timetable.csv
+#define TT_MAX_RESULTS 16
+
+#ifndef TT_OFFLINE_DEPARTURES
+#define TT_OFFLINE_DEPARTURES 4
+#endif
+
+// GTFS route_type, extended types folded onto these by the compiler
+enum TtMode : uint8_t { TT_TRAM = 0, TT_METRO = 1, TT_RAIL = 2, TT_BUS = 3, TT_OTHER = 15 };
+#define TT_MODE_BIT(m) (1u << (m))
+#define TT_ALL_MODES 0xFFFFu
+
+struct TtHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t crc;                 // CRC-32 of everything after the header
+    uint32_t totalSize;
+    uint32_t firstDay;            // days since 1970-01-01 (local service days)
+    uint16_t dayCount;
+    uint16_t stopCount;
+    uint16_t routeCount;
+    uint16_t patternCount;
+    uint16_t serviceCount;
+    uint16_t blockSize;
+    uint32_t stopsOff, routesOff, patternsOff, calendarOff, blocksOff, eventsOff, stringsOff;
+};
+
+struct TtStop {
+    uint32_t idOff, nameOff;
+    uint32_t firstEvent, eventCount;
+    uint32_t firstBlock, blockCount;
+};
+
+struct TtRoute { uint32_t nameOff; uint8_t mode; uint8_t pad[3]; };
+struct TtPattern { uint16_t route, service; uint32_t headsignOff; };
+struct TtBlock { uint32_t time, event; };
+struct TtEvent { uint16_t delta, pattern; };    // delta: seconds after the previous event in the block
+
+static_assert(sizeof(TtHeader) == 60, "TtHeader layout");
+static_assert(sizeof(TtStop) == 24 && sizeof(TtRoute) == 8 && sizeof(TtPattern) == 8, "timetable record layout");
+static_assert(sizeof(TtBlock) == 8 && sizeof(TtEvent) == 4, "timetable record layout");
+
+struct TtDeparture {
+    int32_t time;                 // seconds after midnight of the queried day
+    uint16_t stop;
+    uint8_t mode;
+    const char* route;
+    const char* headsign;
+};
+
+static inline uint32_t ttCrc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/** Days since 1970-01-01 for a proleptic Gregorian date. */
+static inline int32_t ttDaysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+class Timetable {
+public:
+    /**
+     * Adopt an image (normally mapped flash). size may exceed the image,
+     * e.g. the whole partition. Nothing is copied; data must outlive this.
+     */
+    bool open(const uint8_t* data, size_t size, bool verifyCrc = true) {
+        _h = nullptr;
+        if (!data || size < sizeof(TtHeader)) return false;
+        const TtHeader* h = (const TtHeader*)data;
+        if (h->magic != TT_MAGIC || h->version != TT_VERSION || h->headerSize != sizeof(TtHeader)) return false;
+        if (h->totalSize > size || h->totalSize < sizeof(TtHeader) || h->blockSize != TT_BLOCK) return false;
+        if (h->stringsOff > h->totalSize || h->eventsOff > h->stringsOff || h->blocksOff > h->eventsOff) return false;
+        if (verifyCrc && ttCrc32(data + sizeof(TtHeader), h->totalSize - sizeof(TtHeader)) != h->crc) return false;
+        _base = data;
+        _h = h;
+        _stops = (const TtStop*)(data + h->stopsOff);
+        _routes = (const TtRoute*)(data + h->routesOff);
+        _patterns = (const TtPattern*)(data + h->patternsOff);
+        _calendar = data + h->calendarOff;
+        _blocks = (const TtBlock*)(data + h->blocksOff);
+        _events = (const TtEvent*)(data + h->eventsOff);
+        _rowBytes = (h->dayCount + 7) / 8;
+        return true;
+    }
+
+    bool valid() const { return _h != nullptr; }
+    uint32_t crc() const { return _h ? _h->crc : 0; }
+    uint32_t size() const { return _h ? _h->totalSize : 0; }
+    uint32_t firstDay() const { return _h ? _h->firstDay : 0; }
+    int dayCount() const { return _h ? _h->dayCount : 0; }
+    bool covers(uint32_t day) const { return _h && day >= _h->firstDay && day - _h->firstDay < _h->dayCount; }
+    int stopCount() const { return _h ? _h->stopCount : 0; }
+    const char* stopId(int i) const { return str(_stops[i].idOff); }
+    const char* stopName(int i) const { return str(_stops[i].nameOff); }
+
+    /** Index of a stop_id, -1 if the image doesn't hold it. */
+    int findStop(const char* id) const {
+        int lo = 0, hi = stopCount() - 1;
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+            int c = strcmp(stopId(mid), id);
+            if (c == 0) return mid;
+            if (c < 0) lo = mid + 1; else hi = mid - 1;
+        }
+        return -1;
+    }
+
+    /**
+     * Up to n departures at or after secOfDay on local service day `day`,
+     * earliest first, from one stop (or every stop when stop < 0) on the
+     * modes in modeMask. Returns how many were written to out.
+     */
+    int next(int stop, uint32_t day, uint32_t secOfDay, uint32_t modeMask, TtDeparture* out, int n) const {
+        if (!_h || n <= 0) return 0;
+        if (n > TT_MAX_RESULTS) n = TT_MAX_RESULTS;
+        int count = 0;
+        int first = stop < 0 ? 0 : stop, last = stop < 0 ? stopCount() - 1 : stop;
+        for (int s = first; s <= last && s < stopCount(); s++) {
+            // Today's service day, then yesterday's trips still running past midnight
+            scan(s, day, secOfDay, 0, modeMask, out, count, n);
+            if (day > 0) scan(s, day - 1, secOfDay + 86400, 86400, modeMask, out, count, n);
+        }
+        return count;
+    }
+
+private:
+    const char* str(uint32_t off) const { return (const char*)_base + _h->stringsOff + off; }
+
+    bool runs(uint16_t service, uint32_t day) const {
+        if (!covers(day)) return false;
+        uint32_t d = day - _h->firstDay;
+        return _calendar[(size_t)service * _rowBytes + d / 8] & (1u << (d & 7));
+    }
+
+    // Insert in time order, keeping the n earliest
+    static void insert(TtDeparture* out, int& count, int n, const TtDeparture& dep) {
+        if (count == n && dep.time >= out[n - 1].time) return;
+        int i = count < n ? count++ : n - 1;
+        while (i > 0 && out[i - 1].time > dep.time) { out[i] = out[i - 1]; i--; }
+        out[i] = dep;
+    }
+
+    void scan(int s, uint32_t day, uint32_t from, int32_t shift, uint32_t modeMask, TtDeparture* out, int& count, int n) const {
+        if (!covers(day)) return;
+        const TtStop& st = _stops[s];
+        if (st.blockCount == 0) return;
+        // Last block starting at or before `from`
+        uint32_t lo = 0, hi = st.blockCount;
+        while (hi - lo > 1) {
+            uint32_t mid = (lo + hi) / 2;
+            if (_blocks[st.firstBlock + mid].time <= from) lo = mid; else hi = mid;
+        }
+        int found = 0;
+        for (uint32_t b = lo; b < st.blockCount; b++) {
+            const TtBlock& blk = _blocks[st.firstBlock + b];
+            uint32_t end = b + 1 < st.blockCount ? _blocks[st.firstBlock + b + 1].event : st.firstEvent + st.eventCount;
+            // Everything past here is later than what we already hold
+            if (count == n && (int32_t)blk.time - shift >= out[n - 1].time) return;
+            uint32_t t = blk.time;
+            for (uint32_t e = blk.event; e < end; e++) {
+                t += _events[e].delta;
+                if (t < from) continue;
+                if (count == n && (int32_t)t - shift >= out[n - 1].time) return;
+                const TtPattern& p = _patterns[_events[e].pattern];
+                const TtRoute& r = _routes[p.route];
+                if (!(modeMask & TT_MODE_BIT(r.mode)) || !runs(p.service, day)) continue;
+                TtDeparture dep = { (int32_t)t - shift, (uint16_t)s, r.mode, str(r.nameOff), str(p.headsignOff) };
+                insert(out, count, n, dep);
+                if (++found == n) return;
+            }
+        }
+    }
+
+    const uint8_t* _base = nullptr;
+    const TtHeader* _h = nullptr;
+    const TtStop* _stops = nullptr;
+    const TtRoute* _routes = nullptr;
+    const TtPattern* _patterns = nullptr;
+    const uint8_t* _calendar = nullptr;
+    const TtBlock* _blocks = nullptr;
+    const TtEvent* _events = nullptr;
+    uint32_t _rowBytes = 0;
+};
+
+#endif // TIMETABLE_HPP
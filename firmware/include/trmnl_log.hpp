@@ -0,0 +1,255 @@
+/**
+ * Logging with compile-time levels and deferred binary records
+ *
+ * LOG_ERROR .. LOG_VERBOSE above LOG_LEVEL compile to nothing; their
+ * arguments are not even evaluated. Enabled calls don't format text on the
+ * hot path: they store the format string's address and the raw arguments
+ * in a RAM ring. logDrain() ships records later, from an idle point in the
+ * loop, as base64 "#L " lines. host/tools/log-decode turns a captured serial
+ * log back into text using the firmware ELF.
+ *
+ *   LOG_INFO("Zone %s: %d tiles", zone.id, n);     // no trailing newline
+ *   ...
+ *   logDrain(Serial);                              // before the loop sleeps
+ *
+ * LOG_DEFERRED=0 prints immediately through printf instead, for debug builds
+ * where the log must be readable without the decoder.
+ *
+ * Record: len:u8 level:u8 micros:u32 fmt:u32, then one tagged value per argument:
+ *   'i' int32  'u' uint32  'I' int64  'U' uint64  'f' double  's' len:u8 bytes
+ * Strings are copied up to LOG_STR_MAX bytes. Call from the loop task only.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef TRMNL_LOG_HPP
+#define TRMNL_LOG_HPP
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// Same numbering as CORE_DEBUG_LEVEL
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_VERBOSE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_DEFERRED
+#define LOG_DEFERRED 1
+#endif
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 4096
+#endif
+
+#ifndef LOG_STR_MAX
+#define LOG_STR_MAX 48
+#endif
+
+// Where immediate logs and drained records go
+#ifndef LOG_OUTPUT
+#define LOG_OUTPUT Serial
+#endif
+
+#define LOG_RECORD_MAX 255
+#define LOG_RECORD_HEADER 10
+
+class LogRing {
+public:
+    /** Append one record, evicting the oldest ones to make room. */
+    void push(const uint8_t* rec, size_t len) {
+        if (len == 0 || len > LOG_RING_SIZE) return;
+        while (LOG_RING_SIZE - _used < len) {
+            size_t n = _buf[_tail];
+            _tail = (_tail + n) % LOG_RING_SIZE;
+            _used -= n;
+            _dropped++;
+        }
+        for (size_t i = 0; i < len; i++) _buf[(_head + i) % LOG_RING_SIZE] = rec[i];
+        _head = (_head + len) % LOG_RING_SIZE;
+        _used += len;
+        _written++;
+    }
+
+    /** Copy out the oldest record (out must hold LOG_RECORD_MAX). Returns 0 when empty. */
+    size_t pop(uint8_t* out) {
+        if (_used == 0) return 0;
+        size_t n = _buf[_tail];
+        for (size_t i = 0; i < n; i++) out[i] = _buf[(_tail + i) % LOG_RING_SIZE];
+        _tail = (_tail + n) % LOG_RING_SIZE;
+        _used -= n;
+        return n;
+    }
+
+    void clear() { _head = _tail = _used = 0; }
+    size_t used() const { return _used; }
+    uint32_t written() const { return _written; }
+    uint32_t dropped() const { return _dropped; }
+    uint32_t takeDropped() { uint32_t d = _dropped; _dropped = 0; return d; }
+
+private:
+    uint8_t _buf[LOG_RING_SIZE];
+    size_t _head = 0, _tail = 0, _used = 0;
+    uint32_t _written = 0, _dropped = 0;
+};
+
+inline LogRing& logRing() { static LogRing ring; return ring; }
+
+struct LogRecordWriter {
+    uint8_t buf[LOG_RECORD_MAX];
+    size_t len = LOG_RECORD_HEADER;
+
+    LogRecordWriter(uint8_t level, uint32_t ts, const char* fmt) {
+        uint32_t f = (uint32_t)(uintptr_t)fmt;
+        buf[1] = level;
+        memcpy(buf + 2, &ts, 4);
+        memcpy(buf + 6, &f, 4);
+    }
+
+    // Arguments that don't fit are left off; the decoder prints them as "?"
+    void tagged(char tag, const void* p, size_t n) {
+        if (len + 1 + n > LOG_RECORD_MAX) return;
+        buf[len++] = (uint8_t)tag;
+        memcpy(buf + len, p, n);
+        len += n;
+    }
+
+    void str(const char* s) {
+        if (!s) s = "(null)";
+        size_t n = strnlen(s, LOG_STR_MAX);
+        if (len + 2 + n > LOG_RECORD_MAX) return;
+        buf[len++] = 's';
+        buf[len++] = (uint8_t)n;
+        memcpy(buf + len, s, n);
+        len += n;
+    }
+
+    const uint8_t* finish() { buf[0] = (uint8_t)len; return buf; }
+};
+
+template <class T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+logArg(LogRecordWriter& w, T v) {
+    typedef typename std::conditional<std::is_enum<T>::value, int, T>::type I;
+    if (sizeof(I) <= 4) {
+        if (std::is_signed<I>::value) { int32_t x = (int32_t)v; w.tagged('i', &x, 4); }
+        else { uint32_t x = (uint32_t)v; w.tagged('u', &x, 4); }
+    } else {
+        if (std::is_signed<I>::value) { int64_t x = (int64_t)v; w.tagged('I', &x, 8); }
+        else { uint64_t x = (uint64_t)v; w.tagged('U', &x, 8); }
+    }
+}
+
+template <class T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type
+logArg(LogRecordWriter& w, T v) { double x = v; w.tagged('f', &x, 8); }
+
+inline void logArg(LogRecordWriter& w, const char* s) { w.str(s); }
+inline void logArg(LogRecordWriter& w, char* s) { w.str(s); }
+
+template <class T>
+inline void logArg(LogRecordWriter& w, T* p) { uint32_t x = (uint32_t)(uintptr_t)p; w.tagged('u', &x, 4); }
+
+inline void logArgs(LogRecordWriter&) {}
+
+template <class T, class... Rest>
+inline void logArgs(LogRecordWriter& w, const T& v, const Rest&... rest) {
+    logArg(w, v);
+    logArgs(w, rest...);
+}
+
+template <class... Args>
+inline void logWrite(uint8_t level, const char* fmt, const Args&... args) {
+    LogRecordWriter w(level, (uint32_t)micros(), fmt);
+    logArgs(w, args...);
+    logRing().push(w.finish(), w.len);
+}
+
+// Never called; gives deferred calls the same printf format checking as immediate ones
+static inline void logFormatCheck(const char*, ...) __attribute__((format(printf, 1, 2)));
+static inline void logFormatCheck(const char*, ...) {}
+
+#if LOG_DEFERRED
+#define LOG_EMIT(level, fmt, ...) do { if (0) logFormatCheck(fmt, ##__VA_ARGS__); logWrite(level, fmt, ##__VA_ARGS__); } while (0)
+#else
+#define LOG_EMIT(level, fmt, ...) LOG_OUTPUT.printf("%c " fmt "\n", "-EWIDV"[level], ##__VA_ARGS__)
+#endif
+
+#define LOG_NOTHING() do {} while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_EMIT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_EMIT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_EMIT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_EMIT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_VERBOSE
+#define LOG_VERBOSE(fmt, ...) LOG_EMIT(LOG_LEVEL_VERBOSE, fmt, ##__VA_ARGS__)
+#else
+#define LOG_VERBOSE(fmt, ...) LOG_NOTHING()
+#endif
+
+/**
+ * Ship up to maxRecords buffered records as "#L <base64>" lines.
+ * Call where the loop would otherwise sleep. Returns bytes written.
+ */
+template <class Out>
+inline size_t logDrain(Out& out, int maxRecords = 16) {
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint8_t rec[LOG_RECORD_MAX];
+    char line[3 + (LOG_RECORD_MAX + 2) / 3 * 4 + 2];
+    size_t total = 0;
+    uint32_t dropped = logRing().takeDropped();
+    if (dropped) {
+        snprintf(line, sizeof(line), "#L dropped %lu\n", (unsigned long)dropped);
+        out.print(line);
+        total += strlen(line);
+    }
+    for (int r = 0; r < maxRecords; r++) {
+        size_t n = logRing().pop(rec);
+        if (n == 0) break;
+        size_t o = 0;
+        line[o++] = '#'; line[o++] = 'L'; line[o++] = ' ';
+        for (size_t i = 0; i < n; i += 3) {
+            uint32_t v = (uint32_t)rec[i] << 16 | (i + 1 < n ? rec[i + 1] << 8 : 0) | (i + 2 < n ? rec[i + 2] : 0);
+            line[o++] = b64[(v >> 18) & 63];
+            line[o++] = b64[(v >> 12) & 63];
+            line[o++] = i + 1 < n ? b64[(v >> 6) & 63] : '=';
+            line[o++] = i + 2 < n ? b64[v & 63] : '=';
+        }
+        line[o++] = '\n';
+        line[o] = '\0';
+        out.print(line);
+        total += o;
+    }
+    return total;
+}
+
+#endif // TRMNL_LOG_HPP
@@ -0,0 +1,315 @@
+/**
+ * Event-driven idle for the main loop
+ *
+ * Replaces the fixed delay(1000) tick. The loop arms one FreeRTOS one-shot
+ * timer per deadline it knows about (next poll, full refresh, prefetch
+ * window, staged commit, push housekeeping, page timeout) and then blocks in wait() until
+ * one fires, the button is pressed, the push socket or the metrics
+ * listener becomes readable or WiFi drops. While blocked the loop holds no power-management lock, so
+ * with automatic light sleep available the chip sleeps between DTIM
+ * beacons with the association kept; otherwise it idles at the lowest CPU
+ * frequency with the radio in modem sleep.
+ *
+ *   wake.begin(PIN_INTERRUPT);
+ *   ...
+ *   wake.arm(WAKE_POLL, msUntilNextPoll);
+ *   wake.watch(pushSocketFd);
+ *   if (wake.wait() & WAKE_BIT(WAKE_BUTTON)) ...
+ *
+ * Automatic light sleep needs an ESP-IDF build with
+ * CONFIG_FREERTOS_USE_TICKLESS_IDLE; the stock Arduino core lacks it, and
+ * begin() then falls back to frequency scaling only (see mode()).
+ * Light sleep also suspends the USB serial console, so debug builds set
+ * WAKE_LIGHT_SLEEP=0.
+ *
+ * Idle current is not measured on the board; report() estimates it from
+ * the time spent awake vs waiting and the WAKE_MA_* figures below.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef WAKE_LOOP_HPP
+#define WAKE_LOOP_HPP
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "esp_idf_version.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "driver/gpio.h"
+#include "freertos/event_groups.h"
+#include "freertos/timers.h"
+#include "lwip/sockets.h"
+#include "trmnl_log.hpp"
+
+#ifndef WAKE_LIGHT_SLEEP
+#define WAKE_LIGHT_SLEEP 1
+#endif
+
+#ifndef WAKE_CPU_MAX_MHZ
+#define WAKE_CPU_MAX_MHZ 160
+#endif
+
+// Lowest frequency the radio tolerates (XTAL)
+#ifndef WAKE_CPU_MIN_MHZ
+#define WAKE_CPU_MIN_MHZ 40
+#endif
+
+// Beacons between wakeups in modem sleep; higher saves power, adds push latency (~100ms each)
+#ifndef WAKE_WIFI_LISTEN_INTERVAL
+#define WAKE_WIFI_LISTEN_INTERVAL 3
+#endif
+
+// Re-check for a new push or metrics socket at least this often
+#ifndef WAKE_WATCH_SLICE_MS
+#define WAKE_WATCH_SLICE_MS 10000
+#endif
+
+#ifndef WAKE_REPORT_MS
+#define WAKE_REPORT_MS 300000
+#endif
+
+// Modelled supply current (mA) for the idle estimate, ESP32-C3 + radio.
+// POLLING is the old loop: delay(1000) with WiFi power save off.
+#ifndef WAKE_MA_AWAKE
+#define WAKE_MA_AWAKE 80.0f
+#endif
+#ifndef WAKE_MA_POLLING
+#define WAKE_MA_POLLING 85.0f
+#endif
+#ifndef WAKE_MA_MODEM_SLEEP
+#define WAKE_MA_MODEM_SLEEP 18.0f
+#endif
+#ifndef WAKE_MA_LIGHT_SLEEP
+#define WAKE_MA_LIGHT_SLEEP 2.5f
+#endif
+
+#define WAKE_NEVER 0xFFFFFFFFu
+
+// Why wait() returned. The first WAKE_TIMER_COUNT are deadline timers armed with arm().
+enum WakeSource : uint8_t {
+    WAKE_POLL, WAKE_FULL, WAKE_PREFETCH, WAKE_COMMIT, WAKE_PUSH_TIMER, WAKE_PAGE, WAKE_RELEASE,
+    WAKE_BUTTON, WAKE_PUSH, WAKE_NET, WAKE_SCRAPE, WAKE_SOURCE_COUNT
+};
+#define WAKE_TIMER_COUNT (WAKE_RELEASE + 1)
+#define WAKE_BIT(source) (1u << (source))
+#define WAKE_BITS_ALL (WAKE_BIT(WAKE_SOURCE_COUNT) - 1)
+
+enum WakeMode : uint8_t { WAKE_MODE_NONE, WAKE_MODE_DFS, WAKE_MODE_LIGHT_SLEEP };
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+typedef esp_pm_config_t WakePmConfig;
+#else
+typedef esp_pm_config_esp32c3_t WakePmConfig;
+#endif
+
+class WakeLoop {
+public:
+    /** Configure power management, the button wake and the push watcher. Call once from setup(). */
+    bool begin(int buttonPin) {
+        instance() = this;
+        _events = xEventGroupCreate();
+        if (!_events) return false;
+        for (int i = 0; i < WAKE_TIMER_COUNT; i++) {
+            _timers[i] = xTimerCreate("wake", 1, pdFALSE, (void*)(intptr_t)i, onTimer);
+        }
+
+        WakePmConfig pm = {};
+        pm.max_freq_mhz = WAKE_CPU_MAX_MHZ;
+        pm.min_freq_mhz = WAKE_CPU_MIN_MHZ;
+        pm.light_sleep_enable = WAKE_LIGHT_SLEEP;
+        esp_err_t err = esp_pm_configure(&pm);
+        if (err == ESP_ERR_NOT_SUPPORTED && pm.light_sleep_enable) {
+            pm.light_sleep_enable = false;     // core built without tickless idle
+            err = esp_pm_configure(&pm);
+        }
+        _mode = err != ESP_OK ? WAKE_MODE_NONE : pm.light_sleep_enable ? WAKE_MODE_LIGHT_SLEEP : WAKE_MODE_DFS;
+        // Held whenever the loop is running so SPI/UART/TLS see full clocks and no sleep
+        if (_mode != WAKE_MODE_NONE && esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "loop", &_awakeLock) == ESP_OK)
+            esp_pm_lock_acquire(_awakeLock);
+
+        if (buttonPin >= 0) {
+            _button = (gpio_num_t)buttonPin;
+            gpio_install_isr_service(0);       // already installed by attachInterrupt is fine
+            // Level-triggered so it can also wake from light sleep; the ISR masks itself until release
+            gpio_set_intr_type(_button, GPIO_INTR_LOW_LEVEL);
+            gpio_isr_handler_add(_button, onButton, this);
+            gpio_wakeup_enable(_button, GPIO_INTR_LOW_LEVEL);
+            esp_sleep_enable_gpio_wakeup();
+        }
+
+        WiFi.onEvent(onWifiLost, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+        xTaskCreate(watchTask, "wake-watch", 2048, this, 1, &_watcher);
+
+        _lastMark = _lastReport = esp_timer_get_time();
+        LOG_INFO("Wake: %s, CPU %d-%d MHz", modeName(), WAKE_CPU_MIN_MHZ, WAKE_CPU_MAX_MHZ);
+        return true;
+    }
+
+    /** Radio power save; call after each (re)association. */
+    void wifiConnected() {
+        wifi_config_t conf;
+        if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK && conf.sta.listen_interval != WAKE_WIFI_LISTEN_INTERVAL) {
+            // Sent in the association request, so it applies from the next reconnect
+            conf.sta.listen_interval = WAKE_WIFI_LISTEN_INTERVAL;
+            esp_wifi_set_config(WIFI_IF_STA, &conf);
+        }
+        esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+    }
+
+    /** Fire deadline `timer` in ms from now (0 = immediately, WAKE_NEVER = cancel). */
+    void arm(WakeSource timer, uint32_t ms) {
+        TimerHandle_t t = timer < WAKE_TIMER_COUNT ? _timers[timer] : nullptr;
+        if (!t) return;
+        if (ms == WAKE_NEVER) { xTimerStop(t, 0); return; }
+        if (ms == 0) { xTimerStop(t, 0); xEventGroupSetBits(_events, WAKE_BIT(timer)); return; }
+        TickType_t ticks = pdMS_TO_TICKS(ms);
+        xTimerChangePeriod(t, ticks ? ticks : 1, 0);    // also (re)starts it
+    }
+
+    /** Wake on data arriving on this socket (-1 = none). Re-call after each drain. */
+    void watch(int fd) {
+        _watchFd = fd;
+        _watchArmed = fd >= 0;
+        if (_watcher) xTaskNotifyGive(_watcher);
+    }
+
+    /** Wake on a connection or request arriving on the metrics socket (-1 = none). Re-call after each poll. */
+    void listen(int fd) {
+        _listenFd = fd;
+        _listenArmed = fd >= 0;
+        if (_watcher) xTaskNotifyGive(_watcher);
+    }
+
+    void notify(uint32_t bits) { if (_events) xEventGroupSetBits(_events, bits); }
+
+    /**
+     * Block until any wake source fires. Returns the WAKE_BIT() set. The
+     * button is re-enabled here once released.
+     */
+    uint32_t wait() {
+        if (!_events) { delay(1000); return WAKE_BIT(WAKE_POLL); }
+        rearmButton();
+        Serial.flush();                        // finish UART output before the clocks drop
+        int64_t t0 = esp_timer_get_time();
+        _awakeUs += t0 - _lastMark;
+        if (_awakeLock) esp_pm_lock_release(_awakeLock);
+        EventBits_t bits = xEventGroupWaitBits(_events, WAKE_BITS_ALL, pdTRUE, pdFALSE, portMAX_DELAY);
+        if (_awakeLock) esp_pm_lock_acquire(_awakeLock);
+        _lastMark = esp_timer_get_time();
+        _waitUs += _lastMark - t0;
+        for (int i = 0; i < WAKE_SOURCE_COUNT; i++) if (bits & WAKE_BIT(i)) _wakes[i]++;
+        if (_lastMark - _lastReport >= (int64_t)WAKE_REPORT_MS * 1000) { report(); _lastReport = _lastMark; }
+        return bits;
+    }
+
+    /** Estimated average supply current since begin(), in mA. */
+    float estimatedMa() const {
+        float total = (float)(_awakeUs + _waitUs);
+        if (total <= 0) return WAKE_MA_AWAKE;
+        return ((float)_awakeUs * WAKE_MA_AWAKE + (float)_waitUs * idleMa()) / total;
+    }
+
+    float idleMa() const {
+        return _mode == WAKE_MODE_LIGHT_SLEEP ? WAKE_MA_LIGHT_SLEEP : _mode == WAKE_MODE_DFS ? WAKE_MA_MODEM_SLEEP : WAKE_MA_POLLING;
+    }
+
+    void report() const {
+        uint64_t total = _awakeUs + _waitUs;
+        LOG_INFO("Wake: %s, awake %.1f%%, est %.1f mA (always-on %.0f mA); wakes poll %lu full %lu prefetch %lu commit %lu push %lu+%lu button %lu net %lu scrape %lu",
+                 modeName(), total ? 100.0 * _awakeUs / total : 100.0, estimatedMa(), WAKE_MA_POLLING,
+                 (unsigned long)_wakes[WAKE_POLL], (unsigned long)_wakes[WAKE_FULL], (unsigned long)_wakes[WAKE_PREFETCH],
+                 (unsigned long)_wakes[WAKE_COMMIT], (unsigned long)_wakes[WAKE_PUSH], (unsigned long)_wakes[WAKE_PUSH_TIMER],
+                 (unsigned long)_wakes[WAKE_BUTTON], (unsigned long)_wakes[WAKE_NET], (unsigned long)_wakes[WAKE_SCRAPE]);
+    }
+
+    WakeMode mode() const { return _mode; }
+    const char* modeName() const {
+        return _mode == WAKE_MODE_LIGHT_SLEEP ? "light sleep" : _mode == WAKE_MODE_DFS ? "modem sleep + DFS" : "no power management";
+    }
+    uint64_t awakeUs() const { return _awakeUs; }
+    uint64_t waitUs() const { return _waitUs; }
+    uint32_t wakes(WakeSource source) const { return source < WAKE_SOURCE_COUNT ? _wakes[source] : 0; }
+    /** When the button last went down, on the millis() clock: the start of a button-to-pixels time. */
+    uint32_t pressedMs() const { return (uint32_t)(_pressedUs / 1000); }
+
+private:
+    static void onTimer(TimerHandle_t t) {
+        WakeLoop* self = instance();
+        if (self) xEventGroupSetBits(self->_events, WAKE_BIT((intptr_t)pvTimerGetTimerID(t)));
+    }
+
+    static void IRAM_ATTR onButton(void* arg) {
+        WakeLoop* self = (WakeLoop*)arg;
+        gpio_intr_disable(self->_button);      // level interrupt: stay quiet until released
+        self->_buttonMasked = true;
+        self->_pressedUs = esp_timer_get_time();
+        BaseType_t woken = pdFALSE;
+        xEventGroupSetBitsFromISR(self->_events, WAKE_BIT(WAKE_BUTTON), &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+
+    static void onWifiLost(WiFiEvent_t event, WiFiEventInfo_t info) {
+        WakeLoop* self = instance();
+        if (self) self->notify(WAKE_BIT(WAKE_NET));
+    }
+
+    void rearmButton() {
+        if (!_buttonMasked) return;
+        if (gpio_get_level(_button) == 0) { arm(WAKE_RELEASE, 50); return; }   // still held; look again shortly
+        _buttonMasked = false;
+        gpio_intr_enable(_button);
+    }
+
+    // Blocks in select() on the push and metrics sockets so data wakes the loop without it polling
+    static void watchTask(void* arg) {
+        WakeLoop* self = (WakeLoop*)arg;
+        for (;;) {
+            int push = self->_watchArmed ? self->_watchFd : -1;
+            int scrape = self->_listenArmed ? self->_listenFd : -1;
+            if (push < 0 && scrape < 0) { ulTaskNotifyTake(pdTRUE, portMAX_DELAY); continue; }
+            fd_set rd, ex;
+            FD_ZERO(&rd); FD_ZERO(&ex);
+            if (push >= 0) { FD_SET(push, &rd); FD_SET(push, &ex); }
+            if (scrape >= 0) { FD_SET(scrape, &rd); FD_SET(scrape, &ex); }
+            struct timeval tv = { WAKE_WATCH_SLICE_MS / 1000, (WAKE_WATCH_SLICE_MS % 1000) * 1000 };
+            int n = select(max(push, scrape) + 1, &rd, nullptr, &ex, &tv);
+            if (n == 0) continue;
+            // Readable, closed or errored: the loop's push.poll() / metrics.poll() sorts out which
+            uint32_t bits = 0;
+            if (push >= 0 && push == self->_watchFd && (n < 0 || FD_ISSET(push, &rd) || FD_ISSET(push, &ex))) {
+                self->_watchArmed = false;
+                bits |= WAKE_BIT(WAKE_PUSH);
+            }
+            if (scrape >= 0 && scrape == self->_listenFd && (n < 0 || FD_ISSET(scrape, &rd) || FD_ISSET(scrape, &ex))) {
+                self->_listenArmed = false;
+                bits |= WAKE_BIT(WAKE_SCRAPE);
+            }
+            if (bits) xEventGroupSetBits(self->_events, bits);
+            else if (n < 0) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // both sockets swapped under us
+        }
+    }
+
+    static WakeLoop*& instance() { static WakeLoop* self = nullptr; return self; }
+
+    EventGroupHandle_t _events = nullptr;
+    TimerHandle_t _timers[WAKE_TIMER_COUNT] = {};
+    TaskHandle_t _watcher = nullptr;
+    esp_pm_lock_handle_t _awakeLock = nullptr;
+    WakeMode _mode = WAKE_MODE_NONE;
+    gpio_num_t _button = GPIO_NUM_NC;
+    volatile bool _buttonMasked = false;
+    volatile int64_t _pressedUs = 0;
+    volatile int _watchFd = -1;
+    volatile bool _watchArmed = false;
+    volatile int _listenFd = -1;
+    volatile bool _listenArmed = false;
+    int64_t _lastMark = 0, _lastReport = 0;
+    uint64_t _awakeUs = 0, _waitUs = 0;
+    uint32_t _wakes[WAKE_SOURCE_COUNT] = {};
+};
+
+#endif // WAKE_LOOP_HPP
@@ -0,0 +1,25 @@
+/**
+ * Zone layout of the 800x480 dashboard
+ *
+ * Shared by every client that speaks the zone protocol (zones-v12 on the
+ * TRMNL, the native Kindle client) so zone ids and geometry stay in step
+ * with what the server renders. The geometry comes from
+ * layout/dashboard.layout, which the server reads too.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef ZONE_LAYOUT_HPP
+#define ZONE_LAYOUT_HPP
+
+#include "zone_protocol.hpp"
+#include "dashboard_layout.hpp"   // generated from layout/dashboard.layout
+
+#define ZONE_CANVAS_W DASH_W
+#define ZONE_CANVAS_H DASH_H
+
+static constexpr const ZoneDef (&ZONES)[DASH_ZONE_COUNT] = DASH_ZONES;
+static constexpr int ZONE_COUNT = DASH_ZONE_COUNT;
+
+#endif // ZONE_LAYOUT_HPP
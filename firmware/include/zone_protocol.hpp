@@ -0,0 +1,84 @@
+/**
+ * Zone protocol helpers shared by the firmware and host tools
+ *
+ * Plain C, no Arduino String - safe to call from any loop context and to
+ * build natively on Linux.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef ZONE_PROTOCOL_HPP
+#define ZONE_PROTOCOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+struct ZoneDef { const char* id; int16_t x, y, w, h; uint8_t refreshPriority; };
+
+/**
+ * Mark zones named in a comma-separated id list ("time,trains,footer").
+ * Whitespace around ids is ignored, unknown ids are skipped.
+ * Returns the number of zones marked.
+ */
+static inline int parseZoneList(const char* csv, size_t len, const ZoneDef* zones, int zoneCount, bool* changedFlags) {
+    int marked = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && csv[end] != ',') end++;
+        size_t a = pos, b = end;
+        while (a < b && (csv[a] == ' ' || csv[a] == '\t' || csv[a] == '\r' || csv[a] == '\n')) a++;
+        while (b > a && (csv[b - 1] == ' ' || csv[b - 1] == '\t' || csv[b - 1] == '\r' || csv[b - 1] == '\n')) b--;
+        size_t n = b - a;
+        for (int i = 0; n > 0 && i < zoneCount; i++) {
+            if (strncmp(zones[i].id, csv + a, n) == 0 && zones[i].id[n] == '\0') {
+                if (!changedFlags[i]) marked++;
+                changedFlags[i] = true;
+                break;
+            }
+        }
+        pos = end + 1;
+    }
+    return marked;
+}
+
+/**
+ * Split a server URL ("https://host[:port][/prefix]") into its parts.
+ * The path prefix has no trailing slash so "/api/..." can be appended.
+ */
+struct ServerEndpoint {
+    char host[96];
+    char prefix[64];
+    uint16_t port;
+    bool tls;
+};
+
+static inline bool parseServerUrl(const char* url, ServerEndpoint& ep) {
+    memset(&ep, 0, sizeof(ep));
+    const char* p = url;
+    if (strncmp(p, "https://", 8) == 0) { ep.tls = true; ep.port = 443; p += 8; }
+    else if (strncmp(p, "http://", 7) == 0) { ep.tls = false; ep.port = 80; p += 7; }
+    else return false;
+
+    size_t hostLen = strcspn(p, ":/");
+    if (hostLen == 0 || hostLen >= sizeof(ep.host)) return false;
+    memcpy(ep.host, p, hostLen);
+    p += hostLen;
+
+    if (*p == ':') {
+        long port = strtol(p + 1, (char**)&p, 10);
+        if (port <= 0 || port > 65535) return false;
+        ep.port = (uint16_t)port;
+    }
+
+    size_t prefixLen = strlen(p);
+    while (prefixLen > 0 && p[prefixLen - 1] == '/') prefixLen--;
+    if (prefixLen >= sizeof(ep.prefix)) return false;
+    memcpy(ep.prefix, p, prefixLen);
+    return true;
+}
+
+#endif // ZONE_PROTOCOL_HPP
@@ -0,0 +1,348 @@
+/**
+ * Zone push channel (Server-Sent Events)
+ *
+ * Holds one long-lived connection to /api/zones/stream and turns
+ *
+ *   id: 42
+ *   event: zones
+ *   data: time,trains
+ *
+ * into "zones time,trains changed, version 42" callbacks, so the firmware
+ * only fetches zone bitmaps when something actually changed. Comment lines
+ * (": hb") are server heartbeats; silence longer than
+ * PUSH_HEARTBEAT_TIMEOUT_MS drops the connection and reconnects with
+ * Last-Event-ID. After PUSH_MAX_FAILURES failed connects the client parks
+ * itself in fallback mode and the caller goes back to interval polling
+ * until PUSH_FALLBACK_RETRY_MS has passed.
+ *
+ * Templated on the transport (normally Arduino's Client base, so plain
+ * and TLS servers both work) and built natively against POSIX sockets.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef ZONE_PUSH_HPP
+#define ZONE_PUSH_HPP
+
+#include <Arduino.h>
+#include "trmnl_log.hpp"
+#include "zone_protocol.hpp"
+
+#ifndef PUSH_HEARTBEAT_TIMEOUT_MS
+#define PUSH_HEARTBEAT_TIMEOUT_MS 45000   // server sends ": hb" every 15s
+#endif
+#ifndef PUSH_CONNECT_BACKOFF_MS
+#define PUSH_CONNECT_BACKOFF_MS 2000
+#endif
+#ifndef PUSH_MAX_FAILURES
+#define PUSH_MAX_FAILURES 3
+#endif
+#ifndef PUSH_FALLBACK_RETRY_MS
+#define PUSH_FALLBACK_RETRY_MS 300000     // retry push every 5 minutes while polling
+#endif
+#ifndef PUSH_LINE_MAX
+#define PUSH_LINE_MAX 192
+#endif
+
+struct ZonePushEvent {
+    uint32_t version;
+    const char* zones;     // comma-separated zone ids, not NUL-terminated
+    size_t zonesLen;
+};
+
+typedef void (*ZonePushHandler)(const ZonePushEvent& ev, void* ctx);
+
+/**
+ * Incremental SSE parser. Feed it body bytes in any split; it dispatches
+ * each complete "zones" event. Over-long lines are truncated, not fatal.
+ */
+class ZonePushParser {
+public:
+    void reset() { _lineLen = 0; _dataLen = 0; _event[0] = '\0'; _pendingId = 0; _hasId = false; }
+
+    int feed(const uint8_t* buf, size_t n, ZonePushHandler handler, void* ctx) {
+        int dispatched = 0;
+        for (size_t i = 0; i < n; i++) {
+            char c = (char)buf[i];
+            if (c == '\r') continue;
+            if (c != '\n') {
+                if (_lineLen < PUSH_LINE_MAX - 1) _line[_lineLen++] = c;
+                continue;
+            }
+            _line[_lineLen] = '\0';
+            if (_lineLen == 0) dispatched += dispatch(handler, ctx);
+            else processLine();
+            _lineLen = 0;
+        }
+        return dispatched;
+    }
+
+    uint32_t lastId() const { return _lastId; }
+    void setLastId(uint32_t id) { _lastId = id; }
+
+private:
+    void processLine() {
+        if (_line[0] == ':') return;                       // comment / heartbeat
+        char* colon = strchr(_line, ':');
+        const char* value = "";
+        if (colon) { *colon = '\0'; value = colon + 1; if (*value == ' ') value++; }
+        if (strcmp(_line, "event") == 0) {
+            strncpy(_event, value, sizeof(_event) - 1);
+            _event[sizeof(_event) - 1] = '\0';
+        } else if (strcmp(_line, "data") == 0) {
+            size_t n = strlen(value);
+            if (_dataLen > 0 && _dataLen < sizeof(_data) - 1) _data[_dataLen++] = ',';
+            if (n > sizeof(_data) - 1 - _dataLen) n = sizeof(_data) - 1 - _dataLen;
+            memcpy(_data + _dataLen, value, n);
+            _dataLen += n;
+        } else if (strcmp(_line, "id") == 0) {
+            _pendingId = (uint32_t)strtoul(value, nullptr, 10);
+            _hasId = true;
+        }
+    }
+
+    int dispatch(ZonePushHandler handler, void* ctx) {
+        int fired = 0;
+        if (_hasId) _lastId = _pendingId;
+        bool isZones = _event[0] == '\0' || strcmp(_event, "zones") == 0;
+        if (isZones && _dataLen > 0 && handler) {
+            ZonePushEvent ev = { _lastId, _data, _dataLen };
+            handler(ev, ctx);
+            fired = 1;
+        }
+        _dataLen = 0; _event[0] = '\0'; _hasId = false;
+        return fired;
+    }
+
+    char _line[PUSH_LINE_MAX];
+    size_t _lineLen = 0;
+    char _data[PUSH_LINE_MAX];
+    size_t _dataLen = 0;
+    char _event[16] = "";
+    uint32_t _pendingId = 0;
+    uint32_t _lastId = 0;
+    bool _hasId = false;
+};
+
+enum PushState : uint8_t { PUSH_IDLE, PUSH_HEADERS, PUSH_STREAMING, PUSH_FALLBACK };
+
+template <class ClientT>
+class ZonePushClient {
+public:
+    void begin(ClientT& client, const ServerEndpoint& ep, const char* userAgent) {
+        stop();
+        _client = &client;
+        _ep = ep;
+        _userAgent = userAgent;
+        _state = PUSH_IDLE;
+        _nextAttempt = 0;
+        _failures = 0;
+    }
+
+    /** True while the stream is live; callers skip interval polling then. */
+    bool streaming() const { return _state == PUSH_STREAMING; }
+    bool fallback() const { return _state == PUSH_FALLBACK; }
+    PushState state() const { return _state; }
+    uint32_t version() const { return _parser.lastId(); }
+    uint32_t events() const { return _events; }
+    uint32_t reconnects() const { return _reconnects; }
+    uint32_t bytesReceived() const { return _bytes; }
+
+    /**
+     * Milliseconds until poll() has time-based work (a reconnect attempt or
+     * the heartbeat check); 0 if overdue. Incoming data is not covered - a
+     * caller that sleeps should also wake on the socket.
+     */
+    uint32_t msUntilDue() const {
+        if (!_client) return 0xFFFFFFFFu;
+        unsigned long now = millis();
+        long left = _state == PUSH_IDLE || _state == PUSH_FALLBACK
+                        ? (long)(_nextAttempt - now)
+                        : (long)(_lastActivity + PUSH_HEARTBEAT_TIMEOUT_MS + 1 - now);
+        return left > 0 ? (uint32_t)left : 0;
+    }
+
+    /**
+     * Service the connection without blocking (apart from the connect
+     * itself). Returns the number of change events dispatched.
+     */
+    int poll(ZonePushHandler handler, void* ctx) {
+        if (!_client) return 0;
+        unsigned long now = millis();
+        if (_state == PUSH_FALLBACK) {
+            if ((long)(now - _nextAttempt) < 0) return 0;
+            _state = PUSH_IDLE;
+            _failures = 0;
+        }
+        if (_state == PUSH_IDLE) {
+            if ((long)(now - _nextAttempt) < 0) return 0;
+            if (!open()) { fail(now); return 0; }
+        }
+
+        int fired = 0;
+        uint8_t buf[128];
+        int avail;
+        while ((avail = _client->available()) > 0) {
+            int r = _client->read(buf, avail < (int)sizeof(buf) ? avail : (int)sizeof(buf));
+            if (r <= 0) break;
+            _bytes += r;
+            _lastActivity = millis();
+            fired += consume(buf, (size_t)r, handler, ctx);
+            if (_state == PUSH_IDLE || _state == PUSH_FALLBACK) return fired;   // rejected by server
+        }
+
+        now = millis();
+        if (!_client->connected()) {
+            // A stream that was live and got closed (server/proxy timeout) is
+            // routine; one that never got past the headers counts as a failure.
+            bool wasLive = _state == PUSH_STREAMING;
+            close();
+            if (wasLive) { _failures = 0; _nextAttempt = now; }
+            else fail(now);
+        } else if (now - _lastActivity > PUSH_HEARTBEAT_TIMEOUT_MS) {
+            LOG_INFO("Push: heartbeat lost, reconnecting");
+            close();
+            _nextAttempt = now;
+        }
+        return fired;
+    }
+
+    void stop() { if (_client) _client->stop(); _state = PUSH_IDLE; }
+
+private:
+    bool open() {
+        if (!_client->connect(_ep.host, _ep.port)) return false;
+        char req[384];
+        int n = snprintf(req, sizeof(req),
+                         "GET %s/api/zones/stream HTTP/1.1\r\n"
+                         "Host: %s\r\n"
+                         "User-Agent: %s\r\n"
+                         "Accept: text/event-stream\r\n"
+                         "Cache-Control: no-cache\r\n",
+                         _ep.prefix, _ep.host, _userAgent);
+        if (_parser.lastId() > 0 && n > 0 && n < (int)sizeof(req))
+            n += snprintf(req + n, sizeof(req) - n, "Last-Event-ID: %lu\r\n", (unsigned long)_parser.lastId());
+        if (n > 0 && n < (int)sizeof(req)) n += snprintf(req + n, sizeof(req) - n, "\r\n");
+        if (n <= 0 || n >= (int)sizeof(req) || _client->write((const uint8_t*)req, n) != (size_t)n) {
+            _client->stop();
+            return false;
+        }
+        uint32_t keepId = _parser.lastId();
+        _parser.reset();
+        _parser.setLastId(keepId);
+        _state = PUSH_HEADERS;
+        _hdrLen = 0; _status = 0; _chunked = false; _eventStream = false;
+        _chunkState = CHUNK_SIZE; _chunkLeft = 0; _chunkExt = false;
+        _lastActivity = millis();
+        _reconnects++;
+        return true;
+    }
+
+    void close() {
+        _client->stop();
+        if (_state != PUSH_FALLBACK) _state = PUSH_IDLE;
+    }
+
+    void fail(unsigned long now) {
+        _client->stop();
+        _failures++;
+        if (_failures >= PUSH_MAX_FAILURES) {
+            LOG_WARN("Push: %d failures, falling back to polling", _failures);
+            _state = PUSH_FALLBACK;
+            _nextAttempt = now + PUSH_FALLBACK_RETRY_MS;
+        } else {
+            _state = PUSH_IDLE;
+            _nextAttempt = now + (unsigned long)PUSH_CONNECT_BACKOFF_MS * _failures;
+        }
+    }
+
+    int consume(const uint8_t* buf, size_t n, ZonePushHandler handler, void* ctx) {
+        size_t i = 0;
+        while (i < n && _state == PUSH_HEADERS) {
+            char c = (char)buf[i++];
+            if (c == '\r') continue;
+            if (c != '\n') { if (_hdrLen < sizeof(_hdr) - 1) _hdr[_hdrLen++] = c; continue; }
+            _hdr[_hdrLen] = '\0';
+            if (_hdrLen == 0) {
+                if (_status != 200 || !_eventStream) {
+                    LOG_WARN("Push: rejected (HTTP %d)", _status);
+                    fail(millis());
+                    return 0;
+                }
+                _state = PUSH_STREAMING;
+                _failures = 0;
+            } else {
+                headerLine();
+            }
+            _hdrLen = 0;
+        }
+        if (i >= n) return 0;
+        return _chunked ? dechunk(buf + i, n - i, handler, ctx)
+                        : deliver(buf + i, n - i, handler, ctx);
+    }
+
+    void headerLine() {
+        if (_status == 0) {
+            const char* sp = strchr(_hdr, ' ');
+            _status = sp ? atoi(sp + 1) : -1;
+            return;
+        }
+        for (char* p = _hdr; *p && *p != ':'; p++) if (*p >= 'A' && *p <= 'Z') *p += 32;
+        if (strncmp(_hdr, "transfer-encoding:", 18) == 0 && strstr(_hdr + 18, "chunked")) _chunked = true;
+        if (strncmp(_hdr, "content-type:", 13) == 0 && strstr(_hdr + 13, "text/event-stream")) _eventStream = true;
+    }
+
+    int deliver(const uint8_t* buf, size_t n, ZonePushHandler handler, void* ctx) {
+        int fired = _parser.feed(buf, n, handler, ctx);
+        _events += fired;
+        return fired;
+    }
+
+    int dechunk(const uint8_t* buf, size_t n, ZonePushHandler handler, void* ctx) {
+        int fired = 0;
+        size_t i = 0;
+        while (i < n) {
+            if (_chunkState == CHUNK_DATA) {
+                size_t take = n - i < _chunkLeft ? n - i : _chunkLeft;
+                fired += deliver(buf + i, take, handler, ctx);
+                i += take; _chunkLeft -= take;
+                if (_chunkLeft == 0) _chunkState = CHUNK_CRLF;
+                continue;
+            }
+            char c = (char)buf[i++];
+            if (_chunkState == CHUNK_CRLF) { if (c == '\n') { _chunkState = CHUNK_SIZE; _chunkLeft = 0; } continue; }
+            // CHUNK_SIZE: hex digits, optional extensions, then CRLF
+            if (c == '\n') { _chunkState = _chunkLeft ? CHUNK_DATA : CHUNK_CRLF; _chunkExt = false; continue; }
+            int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (v >= 0 && !_chunkExt) _chunkLeft = (_chunkLeft << 4) | (size_t)v;
+            else if (c == ';') _chunkExt = true;
+        }
+        return fired;
+    }
+
+    enum ChunkState : uint8_t { CHUNK_SIZE, CHUNK_DATA, CHUNK_CRLF };
+
+    ClientT* _client = nullptr;
+    ServerEndpoint _ep;
+    const char* _userAgent = "PTV-TRMNL";
+    ZonePushParser _parser;
+    PushState _state = PUSH_IDLE;
+    unsigned long _nextAttempt = 0;
+    unsigned long _lastActivity = 0;
+    int _failures = 0;
+    char _hdr[128];
+    size_t _hdrLen = 0;
+    int _status = 0;
+    bool _chunked = false;
+    bool _eventStream = false;
+    ChunkState _chunkState = CHUNK_SIZE;
+    size_t _chunkLeft = 0;
+    bool _chunkExt = false;
+    uint32_t _events = 0;
+    uint32_t _reconnects = 0;
+    uint32_t _bytes = 0;
+};
+
+#endif // ZONE_PUSH_HPP
@@ -0,0 +1,99 @@
+/**
+ * Zone staging buffer - prefetched frames committed at an apply-at time
+ *
+ * The zones that change on a minute boundary (clock, countdowns) are known
+ * ahead of time. The firmware fetches them during the lead-up, parks the BMPs
+ * here tagged with the epoch second they become valid, and draws them all
+ * with a single partial refresh when the boundary arrives. Network latency
+ * is moved off the critical moment.
+ *
+ * One contiguous arena, no per-zone allocations:
+ *   uint8_t* p = staging.reserve(room);    // fetch straight into p
+ *   staging.commit(zoneIdx, x, y, w, h, len);
+ *   ...
+ *   if (staging.due(epochNow)) { staging.forEach(draw, ctx); staging.clear(); }
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef ZONE_STAGING_HPP
+#define ZONE_STAGING_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// Room for the clock, both departure boards and the footer in one frame
+#ifndef STAGING_ARENA_SIZE
+#define STAGING_ARENA_SIZE 24576
+#endif
+
+#ifndef STAGING_MAX_ZONES
+#define STAGING_MAX_ZONES 8
+#endif
+
+struct StagedZone {
+    int8_t zone;            // index into the firmware ZONES[] table
+    int16_t x, y, w, h;     // geometry reported by the server
+    uint32_t offset, len;   // BMP bytes within the arena
+};
+
+typedef void (*StagedZoneFn)(const StagedZone& sz, const uint8_t* bmp, void* ctx);
+
+class ZoneStaging {
+public:
+    ~ZoneStaging() { free(_arena); }
+
+    bool begin(size_t capacity = STAGING_ARENA_SIZE) {
+        if (_arena) return true;
+        _arena = (uint8_t*)malloc(capacity);
+        _capacity = _arena ? capacity : 0;
+        return _arena != nullptr;
+    }
+
+    /** Start a new frame for the given epoch second, dropping anything staged. */
+    void open(uint32_t applyAt) { clear(); _applyAt = applyAt; }
+
+    /** Free space at the tail of the arena; fetch the next BMP directly into it. */
+    uint8_t* reserve(size_t& room) {
+        room = _count < STAGING_MAX_ZONES ? _capacity - _used : 0;
+        return _arena ? _arena + _used : nullptr;
+    }
+
+    /** Keep the len bytes just written at reserve(). */
+    bool commit(int zone, int16_t x, int16_t y, int16_t w, int16_t h, size_t len) {
+        if (!_arena || _count >= STAGING_MAX_ZONES || len == 0 || len > _capacity - _used) return false;
+        StagedZone& sz = _zones[_count++];
+        sz.zone = (int8_t)zone;
+        sz.x = x; sz.y = y; sz.w = w; sz.h = h;
+        sz.offset = (uint32_t)_used; sz.len = (uint32_t)len;
+        _used += len;
+        return true;
+    }
+
+    void clear() { _count = 0; _used = 0; _applyAt = 0; }
+
+    bool ready() const { return _arena != nullptr; }
+    int count() const { return _count; }
+    size_t used() const { return _used; }
+    uint32_t applyAt() const { return _applyAt; }
+    // An open frame stays pending until its boundary even with nothing staged
+    bool pending() const { return _applyAt != 0; }
+    bool due(uint32_t epochNow) const { return _applyAt != 0 && epochNow >= _applyAt; }
+
+    /** Visit staged zones in fetch order, so a later copy of a zone wins. */
+    void forEach(StagedZoneFn fn, void* ctx) const {
+        for (int i = 0; i < _count; i++) fn(_zones[i], _arena + _zones[i].offset, ctx);
+    }
+
+private:
+    uint8_t* _arena = nullptr;
+    size_t _capacity = 0;
+    size_t _used = 0;
+    uint32_t _applyAt = 0;
+    int _count = 0;
+    StagedZone _zones[STAGING_MAX_ZONES];
+};
+
+#endif // ZONE_STAGING_HPP
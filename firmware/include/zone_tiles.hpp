@@ -0,0 +1,247 @@
+/**
+ * Zone tile delta decoder
+ *
+ * Zones are split into 64x16 tiles. The device sends the hash of every tile
+ * it holds; the server answers with only the tiles that differ, as raw rows,
+ * a sparse XOR delta against the held tile (or against white), or a single
+ * fill byte. Records are applied straight into the framebuffer as they
+ * stream in, so memory use is one tile regardless of zone size.
+ *
+ * Stream layout (little-endian), see src/services/zone-tiles.js:
+ *   header  'Z' 'T' version 0 | tileW tileH | x:i16 y:i16 w:u16 h:u16 | records:u16
+ *   record  index:u16 op:u8 len:u8 hash:u32 payload[len]
+ *
+ * Framebuffer layout is bb_epaper's for 1-bit panels: rows of `pitch` bytes,
+ * bit 7 leftmost, 1 = white.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef ZONE_TILES_HPP
+#define ZONE_TILES_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TILE_W 64
+#define TILE_H 16
+#define TILE_ROW_BYTES (TILE_W / 8)
+#define TILE_BYTES (TILE_ROW_BYTES * TILE_H)
+#define TILE_VERSION 1
+#define TILE_HEADER_SIZE 16
+#define TILE_RECORD_HEADER 8
+
+enum TileOp : uint8_t { TILE_RAW = 0, TILE_XOR = 1, TILE_FILL = 2, TILE_SPARSE = 3 };
+
+struct TileSurface { uint8_t* fb; int pitch, width, height; };
+
+/** FNV-1a over a tile; 0 is reserved for "nothing held". */
+static inline uint32_t tileHash(const uint8_t* tile) {
+    uint32_t h = 0x811c9dc5u;
+    for (int i = 0; i < TILE_BYTES; i++) { h ^= tile[i]; h *= 0x01000193u; }
+    return h ? h : 1;
+}
+
+static inline int tilesAcross(int w) { return (w + TILE_W - 1) / TILE_W; }
+static inline int tileCount(int w, int h) { return tilesAcross(w) * ((h + TILE_H - 1) / TILE_H); }
+
+// Eight pixels starting at (px, py); pixels off the surface read as white
+static inline uint8_t tileGetByte(const TileSurface& s, int px, int py) {
+    if (py < 0 || py >= s.height) return 0xFF;
+    const uint8_t* row = s.fb + py * s.pitch;
+    int idx = px >> 3, shift = px & 7;
+    uint8_t hi = (idx >= 0 && idx < s.pitch) ? row[idx] : 0xFF;
+    uint8_t lo = (idx + 1 >= 0 && idx + 1 < s.pitch) ? row[idx + 1] : 0xFF;
+    uint8_t v = shift ? (uint8_t)((hi << shift) | (lo >> (8 - shift))) : hi;
+    if (px < 0) v |= (uint8_t)(0xFF << (8 + (px > -8 ? px : -8)));
+    if (px + 8 > s.width) v |= (uint8_t)(0xFF >> (s.width - px > 0 ? s.width - px : 0));
+    return v;
+}
+
+// Write the pixels selected by mask (bit 7 = px), clipped to the surface
+static inline void tilePutByte(const TileSurface& s, int px, int py, uint8_t v, uint8_t mask) {
+    if (py < 0 || py >= s.height) return;
+    if (px < 0) { if (px <= -8) return; mask &= (uint8_t)(0xFF >> -px); }
+    if (px + 8 > s.width) { int n = s.width - px; if (n <= 0) return; mask &= (uint8_t)(0xFF << (8 - n)); }
+    uint8_t* row = s.fb + py * s.pitch;
+    int idx = px >> 3, shift = px & 7;
+    uint8_t m = (uint8_t)(mask >> shift);
+    if (idx >= 0 && m) row[idx] = (uint8_t)((row[idx] & ~m) | ((v >> shift) & m));
+    if (shift) {
+        m = (uint8_t)(mask << (8 - shift));
+        if (idx + 1 < s.pitch && m) row[idx + 1] = (uint8_t)((row[idx + 1] & ~m) | ((uint8_t)(v << (8 - shift)) & m));
+    }
+}
+
+static inline uint8_t tileEdgeMask(int visible) { return visible >= 8 ? 0xFF : (uint8_t)(0xFF << (8 - visible)); }
+
+/** Copy the visible w x h part of a tile at (x, y) out of the surface; the rest reads white. */
+static inline void tileRead(const TileSurface& s, int x, int y, int w, int h, uint8_t* tile) {
+    memset(tile, 0xFF, TILE_BYTES);
+    for (int r = 0; r < h && r < TILE_H; r++) {
+        for (int b = 0; b < TILE_ROW_BYTES && b * 8 < w; b++) {
+            uint8_t m = tileEdgeMask(w - b * 8);
+            tile[r * TILE_ROW_BYTES + b] = (uint8_t)(tileGetByte(s, x + b * 8, y + r) | ~m);
+        }
+    }
+}
+
+/** Write the visible w x h part of a tile to (x, y). */
+static inline void tileWrite(const TileSurface& s, int x, int y, int w, int h, const uint8_t* tile) {
+    for (int r = 0; r < h && r < TILE_H; r++)
+        for (int b = 0; b < TILE_ROW_BYTES && b * 8 < w; b++)
+            tilePutByte(s, x + b * 8, y + r, tile[r * TILE_ROW_BYTES + b], tileEdgeMask(w - b * 8));
+}
+
+/** Hash what the surface holds for a zone, e.g. after it was drawn from a full BMP. */
+static inline void tileHashRegion(const TileSurface& s, int x, int y, int w, int h, uint32_t* hashes, int cap) {
+    uint8_t tile[TILE_BYTES];
+    int across = tilesAcross(w), count = tileCount(w, h);
+    for (int i = 0; i < count && i < cap; i++) {
+        int tx = (i % across) * TILE_W, ty = (i / across) * TILE_H;
+        tileRead(s, x + tx, y + ty, w - tx < TILE_W ? w - tx : TILE_W, h - ty < TILE_H ? h - ty : TILE_H, tile);
+        hashes[i] = tileHash(tile);
+    }
+}
+
+class TileStreamDecoder {
+public:
+    /**
+     * hashes/hashCap: the tile hashes the device reported for this zone.
+     * Each applied tile updates its entry (0 when it failed verification).
+     */
+    void begin(const TileSurface& surface, uint32_t* hashes, int hashCap) {
+        _s = surface; _hashes = hashes; _hashCap = hashCap;
+        _stage = STAGE_HEADER; _need = TILE_HEADER_SIZE; _have = 0;
+        _records = _applied = _mismatches = 0; _bytes = 0; _error = false;
+        _dx0 = _dy0 = 32767; _dx1 = _dy1 = -32768;
+    }
+
+    /** Feed bytes in whatever chunks they arrive. Returns false once the stream is malformed. */
+    bool feed(const uint8_t* data, size_t len) {
+        while (len > 0 && !_error && _stage != STAGE_DONE) {
+            size_t n = _need - _have;
+            if (n > len) n = len;
+            memcpy(_buf + _have, data, n);
+            _have += n; data += n; len -= n; _bytes += n;
+            if (_have == _need) step();
+        }
+        return !_error;
+    }
+
+    bool done() const { return _stage == STAGE_DONE; }
+    bool error() const { return _error; }
+    int16_t x() const { return _x; }
+    int16_t y() const { return _y; }
+    uint16_t w() const { return _w; }
+    uint16_t h() const { return _h; }
+    int tiles() const { return tileCount(_w, _h); }
+    int records() const { return _records; }
+    int applied() const { return _applied; }
+    int mismatches() const { return _mismatches; }
+    uint32_t bytes() const { return _bytes; }
+
+    /** Bounding box of the tiles written; false if none were. */
+    bool dirtyRect(int& x, int& y, int& w, int& h) const {
+        if (_applied == 0) return false;
+        x = _dx0; y = _dy0; w = _dx1 - _dx0; h = _dy1 - _dy0;
+        return true;
+    }
+
+private:
+    enum Stage : uint8_t { STAGE_HEADER, STAGE_RECORD, STAGE_PAYLOAD, STAGE_DONE };
+
+    static uint16_t u16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+    void expect(Stage stage, size_t n) { _stage = stage; _need = n; _have = 0; }
+
+    void step() {
+        switch (_stage) {
+        case STAGE_HEADER:
+            if (_buf[0] != 'Z' || _buf[1] != 'T' || _buf[2] != TILE_VERSION ||
+                _buf[4] != TILE_W || _buf[5] != TILE_H) { _error = true; return; }
+            _x = (int16_t)u16(_buf + 6); _y = (int16_t)u16(_buf + 8);
+            _w = u16(_buf + 10); _h = u16(_buf + 12);
+            _records = u16(_buf + 14);
+            if (_records == 0) expect(STAGE_DONE, 0);
+            else expect(STAGE_RECORD, TILE_RECORD_HEADER);
+            break;
+        case STAGE_RECORD:
+            _index = u16(_buf); _op = _buf[2]; _len = _buf[3];
+            _hash = (uint32_t)_buf[4] | ((uint32_t)_buf[5] << 8) | ((uint32_t)_buf[6] << 16) | ((uint32_t)_buf[7] << 24);
+            if (_index >= tiles() || _len == 0 ||
+                (_op == TILE_RAW && _len != TILE_BYTES) || (_op == TILE_FILL && _len != 1) || _op > TILE_SPARSE) {
+                _error = true; return;
+            }
+            expect(STAGE_PAYLOAD, _len);
+            break;
+        case STAGE_PAYLOAD:
+            if (!apply()) { _error = true; return; }
+            if (++_applied == _records) expect(STAGE_DONE, 0);
+            else expect(STAGE_RECORD, TILE_RECORD_HEADER);
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool apply() {
+        int across = tilesAcross(_w);
+        int tx = (_index % across) * TILE_W, ty = (_index / across) * TILE_H;
+        int px = _x + tx, py = _y + ty;
+        int vw = _w - tx < TILE_W ? _w - tx : TILE_W;
+        int vh = _h - ty < TILE_H ? _h - ty : TILE_H;
+        uint8_t tile[TILE_BYTES];
+
+        if (_op == TILE_RAW) {
+            memcpy(tile, _buf, TILE_BYTES);
+        } else if (_op == TILE_FILL) {
+            memset(tile, _buf[0], TILE_BYTES);
+        } else {
+            if (_op == TILE_XOR) tileRead(_s, px, py, vw, vh, tile);
+            else memset(tile, 0xFF, TILE_BYTES);
+            size_t p = 0, pos = 0;
+            while (p + 2 <= _len) {
+                pos += _buf[p];
+                size_t n = _buf[p + 1];
+                p += 2;
+                if (pos + n > TILE_BYTES || p + n > _len) return false;
+                for (size_t k = 0; k < n; k++) tile[pos + k] ^= _buf[p + k];
+                pos += n; p += n;
+            }
+            if (p != _len) return false;
+        }
+
+        // An XOR against a tile we don't actually hold shows up here
+        bool ok = tileHash(tile) == _hash;
+        if (!ok) _mismatches++;
+        tileWrite(_s, px, py, vw, vh, tile);
+        if (_hashes && _index < _hashCap) _hashes[_index] = ok ? _hash : 0;
+
+        if (px < _dx0) _dx0 = px;
+        if (py < _dy0) _dy0 = py;
+        if (px + vw > _dx1) _dx1 = px + vw;
+        if (py + vh > _dy1) _dy1 = py + vh;
+        return true;
+    }
+
+    TileSurface _s = {nullptr, 0, 0, 0};
+    uint32_t* _hashes = nullptr;
+    int _hashCap = 0;
+    Stage _stage = STAGE_HEADER;
+    size_t _need = TILE_HEADER_SIZE, _have = 0;
+    uint8_t _buf[256];
+    int16_t _x = 0, _y = 0;
+    uint16_t _w = 0, _h = 0;
+    int _records = 0, _applied = 0, _mismatches = 0;
+    uint32_t _bytes = 0;
+    bool _error = false;
+    uint16_t _index = 0;
+    uint8_t _op = 0, _len = 0;
+    uint32_t _hash = 0;
+    int _dx0 = 0, _dy0 = 0, _dx1 = 0, _dy1 = 0;
+};
+
+#endif // ZONE_TILES_HPP
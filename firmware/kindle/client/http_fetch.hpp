@@ -0,0 +1,167 @@
+/**
+ * Minimal HTTP/1.1 request over an Arduino-style Client
+ *
+ * One request per connection ("Connection: close"). The body is handed to
+ * a sink as it arrives - Content-Length, chunked and close-delimited
+ * bodies all work - so tile streams go straight into the decoder.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef HTTP_FETCH_HPP
+#define HTTP_FETCH_HPP
+
+#include <Arduino.h>
+#include "zone_protocol.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#ifndef HTTP_TIMEOUT_MS
+#define HTTP_TIMEOUT_MS 15000
+#endif
+
+// Return false to abandon the body
+typedef bool (*HttpBodySink)(const uint8_t* data, size_t len, void* ctx);
+
+struct HttpResult {
+    int status = 0;           // 0 = no response (connect/write failed, timeout, bad framing)
+    long contentLength = -1;
+    size_t bodyBytes = 0;
+    bool complete = false;    // whole body delivered
+};
+
+class HttpBodyReader {
+public:
+    void begin(long contentLength, bool chunked) {
+        _left = contentLength;
+        _chunked = chunked;
+        _state = CHUNK_SIZE;
+        _chunkLeft = 0;
+        _done = !chunked && contentLength == 0;
+        _bad = false;
+    }
+
+    /** Feed raw body bytes; returns false if the sink stopped or framing is broken. */
+    bool feed(const uint8_t* buf, size_t n, HttpBodySink sink, void* ctx, size_t& delivered) {
+        if (!_chunked) {
+            if (_left >= 0 && (long)n > _left) n = (size_t)_left;
+            if (n && !sink(buf, n, ctx)) return false;
+            delivered += n;
+            if (_left >= 0) { _left -= (long)n; _done = _left == 0; }
+            return true;
+        }
+        for (size_t i = 0; i < n && !_done;) {
+            if (_state == CHUNK_DATA) {
+                size_t take = n - i < _chunkLeft ? n - i : _chunkLeft;
+                if (!sink(buf + i, take, ctx)) return false;
+                delivered += take;
+                i += take;
+                if ((_chunkLeft -= take) == 0) _state = CHUNK_CRLF;
+                continue;
+            }
+            char c = (char)buf[i++];
+            if (_state == CHUNK_CRLF) { if (c == '\n') _state = CHUNK_SIZE; continue; }
+            // CHUNK_SIZE: hex digits, optional extension, CRLF
+            if (c == '\r' || c == ';') { _ext = true; continue; }
+            if (c == '\n') {
+                _ext = false;
+                if (_chunkLeft == 0) { _done = true; break; }
+                _state = CHUNK_DATA;
+                continue;
+            }
+            if (_ext) continue;
+            int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (v < 0) { _bad = true; return false; }
+            _chunkLeft = _chunkLeft * 16 + v;
+        }
+        return true;
+    }
+
+    bool done() const { return _done; }
+    bool bad() const { return _bad; }
+    bool closeDelimited() const { return !_chunked && _left < 0; }
+
+private:
+    enum ChunkState : uint8_t { CHUNK_SIZE, CHUNK_DATA, CHUNK_CRLF };
+    long _left = -1;
+    bool _chunked = false;
+    ChunkState _state = CHUNK_SIZE;
+    size_t _chunkLeft = 0;
+    bool _ext = false;
+    bool _done = false;
+    bool _bad = false;
+};
+
+/**
+ * Send one request and stream the response body to sink. extraHeaders, if
+ * given, is inserted verbatim ("Name: value\r\n" lines).
+ */
+template <class ClientT>
+HttpResult httpRequest(ClientT& client, const ServerEndpoint& ep, const char* method, const char* path,
+                       const char* extraHeaders, const uint8_t* body, size_t bodyLen,
+                       HttpBodySink sink, void* ctx, const char* userAgent = "PTV-TRMNL") {
+    HttpResult res;
+    if (!client.connect(ep.host, ep.port)) return res;
+    char head[512];
+    int n = snprintf(head, sizeof(head),
+                     "%s %s%s HTTP/1.1\r\nHost: %s\r\nUser-Agent: %s\r\nConnection: close\r\n%s",
+                     method, ep.prefix, path, ep.host, userAgent, extraHeaders ? extraHeaders : "");
+    if (n > 0 && n < (int)sizeof(head) && body) n += snprintf(head + n, sizeof(head) - n, "Content-Length: %u\r\n", (unsigned)bodyLen);
+    if (n > 0 && n < (int)sizeof(head)) n += snprintf(head + n, sizeof(head) - n, "\r\n");
+    if (n <= 0 || n >= (int)sizeof(head) || client.write((const uint8_t*)head, n) != (size_t)n ||
+        (body && bodyLen && client.write(body, bodyLen) != bodyLen)) {
+        client.stop();
+        return res;
+    }
+
+    char line[256];
+    size_t lineLen = 0;
+    bool inHeaders = true, chunked = false;
+    int status = 0;
+    HttpBodyReader reader;
+    uint8_t buf[1024];
+    unsigned long last = millis();
+    for (;;) {
+        int avail = client.available();
+        if (avail <= 0) {
+            if (!client.connected()) break;
+            if (millis() - last > HTTP_TIMEOUT_MS) break;
+            delay(1);
+            continue;
+        }
+        int r = client.read(buf, avail < (int)sizeof(buf) ? avail : (int)sizeof(buf));
+        if (r <= 0) break;
+        last = millis();
+        size_t i = 0;
+        while (inHeaders && i < (size_t)r) {
+            char c = (char)buf[i++];
+            if (c == '\r') continue;
+            if (c != '\n') { if (lineLen < sizeof(line) - 1) line[lineLen++] = c; continue; }
+            line[lineLen] = '\0';
+            if (lineLen == 0) {
+                inHeaders = false;
+                res.status = status;
+                reader.begin(res.contentLength, chunked);
+            } else if (status == 0) {
+                if (sscanf(line, "HTTP/%*d.%*d %d", &status) != 1) { client.stop(); return res; }
+            } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+                res.contentLength = atol(line + 15);
+            } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strstr(line + 18, "chunked")) {
+                chunked = true;
+            }
+            lineLen = 0;
+        }
+        if (!inHeaders && i < (size_t)r && !reader.feed(buf + i, r - i, sink, ctx, res.bodyBytes)) break;
+        if (!inHeaders && reader.done()) break;
+    }
+    // A close-delimited body is complete when the server closes
+    res.complete = !inHeaders && !reader.bad() && (reader.done() || (reader.closeDelimited() && !client.connected()));
+    if (inHeaders) res.status = 0;
+    client.stop();
+    return res;
+}
+
+#endif // HTTP_FETCH_HPP
@@ -0,0 +1,252 @@
+/**
+ * Kindle framebuffer output for the zone client
+ *
+ * Zones are decoded into the same 800x480 1-bit canvas the TRMNL uses.
+ * blit() copies a canvas rectangle into the 8-bit framebuffer - rotated to
+ * suit a portrait panel and scaled (nearest neighbour) to fill it - and
+ * update() asks the EPDC to refresh just that region with MXCFB_SEND_UPDATE.
+ *
+ * openFake() maps a plain file instead of /dev/fb0. Writes land in the file
+ * and updates are recorded in fakeUpdates(), so the whole path runs on a
+ * Linux host without a panel.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef KINDLE_FB_HPP
+#define KINDLE_FB_HPP
+
+#include "mxcfb_kindle.h"
+#include "zone_tiles.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fb.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+struct FbRect { int x, y, w, h; };
+
+struct FbUpdate {
+    FbRect rect;
+    uint32_t waveform;
+    bool full;
+    uint32_t marker;
+};
+
+class KindleFramebuffer {
+public:
+    ~KindleFramebuffer() { close(); }
+
+    /** Open a real framebuffer device (8 bits per pixel). */
+    bool open(const char* path, MxcfbAbi abi = MXCFB_ABI_REX) {
+        close();
+        _fd = ::open(path, O_RDWR);
+        if (_fd < 0) { fprintf(stderr, "fb: %s: %s\n", path, strerror(errno)); return false; }
+        struct fb_var_screeninfo var;
+        struct fb_fix_screeninfo fix;
+        if (ioctl(_fd, FBIOGET_VSCREENINFO, &var) < 0 || ioctl(_fd, FBIOGET_FSCREENINFO, &fix) < 0) {
+            fprintf(stderr, "fb: %s is not a framebuffer\n", path);
+            close();
+            return false;
+        }
+        if (var.bits_per_pixel != 8) {
+            fprintf(stderr, "fb: %u bpp not supported (need 8)\n", var.bits_per_pixel);
+            close();
+            return false;
+        }
+        _width = var.xres;
+        _height = var.yres;
+        _pitch = fix.line_length;
+        _size = fix.smem_len;
+        _abi = abi;
+        _fake = false;
+        return map();
+    }
+
+    /** Map a regular file as a width x height 8-bit framebuffer; it is created or resized to fit. */
+    bool openFake(const char* path, int width, int height, int pitch = 0) {
+        close();
+        _fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (_fd < 0) { fprintf(stderr, "fb: %s: %s\n", path, strerror(errno)); return false; }
+        _width = width;
+        _height = height;
+        _pitch = pitch > width ? pitch : width;
+        _size = (size_t)_pitch * height;
+        struct stat st;
+        if (fstat(_fd, &st) < 0 || ((size_t)st.st_size != _size && ftruncate(_fd, _size) < 0)) { close(); return false; }
+        _fake = true;
+        return map();
+    }
+
+    void close() {
+        if (_fb) munmap(_fb, _size);
+        if (_fd >= 0) ::close(_fd);
+        _fb = nullptr;
+        _fd = -1;
+    }
+
+    /**
+     * Place the canvas on the panel: rotation in degrees clockwise (0/90/180/270);
+     * scale 0 picks the largest that fits. The result is centred.
+     */
+    void setView(int canvasW, int canvasH, int rotation, float scale = 0) {
+        _cw = canvasW;
+        _ch = canvasH;
+        _rot = ((rotation % 360) + 360) % 360 / 90;
+        int rw = _rot & 1 ? canvasH : canvasW, rh = _rot & 1 ? canvasW : canvasH;
+        if (scale <= 0) scale = (float)_width / rw < (float)_height / rh ? (float)_width / rw : (float)_height / rh;
+        // 16.16 fixed point in both directions so blits are pure integer work
+        _scale16 = (uint32_t)(scale * 65536.0f + 0.5f);
+        _inv16 = (uint32_t)(65536.0f / scale + 0.5f);
+        _ox = (_width - (int)(rw * scale)) / 2;
+        _oy = (_height - (int)(rh * scale)) / 2;
+        if (_ox < 0) _ox = 0;
+        if (_oy < 0) _oy = 0;
+    }
+
+    /** Panel rectangle covered by a canvas rectangle. */
+    FbRect mapRect(int x, int y, int w, int h) const {
+        int u0, v0, u1, v1;    // rotated canvas space, half-open
+        switch (_rot) {
+        default: u0 = x; v0 = y; u1 = x + w; v1 = y + h; break;
+        case 1: u0 = _ch - (y + h); v0 = x; u1 = _ch - y; v1 = x + w; break;
+        case 2: u0 = _cw - (x + w); v0 = _ch - (y + h); u1 = _cw - x; v1 = _ch - y; break;
+        case 3: u0 = y; v0 = _cw - (x + w); u1 = y + h; v1 = _cw - x; break;
+        }
+        FbRect r;
+        r.x = _ox + (int)(((uint64_t)u0 * _scale16) >> 16);
+        r.y = _oy + (int)(((uint64_t)v0 * _scale16) >> 16);
+        r.w = _ox + (int)(((uint64_t)u1 * _scale16 + 0xFFFF) >> 16) - r.x;
+        r.h = _oy + (int)(((uint64_t)v1 * _scale16 + 0xFFFF) >> 16) - r.y;
+        return clip(r);
+    }
+
+    /** Copy a canvas rectangle (1 = white) to the panel. Returns the panel rectangle written. */
+    FbRect blit(const TileSurface& canvas, int x, int y, int w, int h) {
+        FbRect r = mapRect(x, y, w, h);
+        if (!_fb || r.w <= 0 || r.h <= 0) return r;
+        uint8_t black = _invert ? 0xFF : 0x00, white = _invert ? 0x00 : 0xFF;
+        for (int py = r.y; py < r.y + r.h; py++) {
+            uint8_t* row = _fb + (size_t)py * _pitch;
+            int v = (int)(((uint64_t)(py - _oy) * _inv16) >> 16);
+            for (int px = r.x; px < r.x + r.w; px++) {
+                int u = (int)(((uint64_t)(px - _ox) * _inv16) >> 16);
+                int cx, cy;
+                switch (_rot) {
+                default: cx = u; cy = v; break;
+                case 1: cx = v; cy = _ch - 1 - u; break;
+                case 2: cx = _cw - 1 - u; cy = _ch - 1 - v; break;
+                case 3: cx = _cw - 1 - v; cy = u; break;
+                }
+                // Rounding at the far edge can land just outside the canvas: that's margin, so white
+                bool inside = cx >= 0 && cy >= 0 && cx < _cw && cy < _ch;
+                row[px] = !inside || (canvas.fb[cy * canvas.pitch + (cx >> 3)] & (0x80 >> (cx & 7))) ? white : black;
+            }
+        }
+        return r;
+    }
+
+    /** Fill the whole panel white (the area outside the canvas stays that way). */
+    void clear() { if (_fb) for (int y = 0; y < _height; y++) memset(_fb + (size_t)y * _pitch, _invert ? 0x00 : 0xFF, _width); }
+
+    /**
+     * Refresh a panel region. Partial DU for zone changes; full GC16 flashes
+     * and clears ghosting. Returns the update marker, 0 on failure.
+     */
+    uint32_t update(const FbRect& rect, uint32_t waveform, bool full) {
+        FbRect r = clip(rect);
+        if (r.w <= 0 || r.h <= 0) return 0;
+        uint32_t marker = ++_marker ? _marker : ++_marker;
+        if (_fake) {
+            _fakeUpdates.push_back({r, waveform, full, marker});
+            return marker;
+        }
+        for (int tries = 0; tries < MXCFB_ABI_COUNT; tries++) {
+            if (send(r, waveform, full, marker) == 0) return marker;
+            if (errno != ENOTTY && errno != EINVAL) break;
+            _abi = (MxcfbAbi)((_abi + 1) % MXCFB_ABI_COUNT);    // wrong struct for this kernel; try the other
+        }
+        fprintf(stderr, "fb: MXCFB_SEND_UPDATE failed: %s\n", strerror(errno));
+        return 0;
+    }
+
+    /** Block until an update has been driven to the panel. */
+    bool waitFor(uint32_t marker) {
+        if (_fake || !marker) return true;
+        struct mxcfb_update_marker_data m = { marker, 0 };
+        return ioctl(_fd, MXCFB_WAIT_FOR_UPDATE_COMPLETE, &m) >= 0;
+    }
+
+    FbRect all() const { FbRect r = {0, 0, _width, _height}; return r; }
+    int width() const { return _width; }
+    int height() const { return _height; }
+    int pitch() const { return _pitch; }
+    const uint8_t* pixels() const { return _fb; }
+    MxcfbAbi abi() const { return _abi; }
+    void setInvert(bool invert) { _invert = invert; }
+    std::vector<FbUpdate>& fakeUpdates() { return _fakeUpdates; }
+
+private:
+    bool map() {
+        void* p = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (p == MAP_FAILED) { fprintf(stderr, "fb: mmap: %s\n", strerror(errno)); close(); return false; }
+        _fb = (uint8_t*)p;
+        setView(_width, _height, 0, 1);
+        return true;
+    }
+
+    FbRect clip(FbRect r) const {
+        if (r.x < 0) { r.w += r.x; r.x = 0; }
+        if (r.y < 0) { r.h += r.y; r.y = 0; }
+        if (r.x + r.w > _width) r.w = _width - r.x;
+        if (r.y + r.h > _height) r.h = _height - r.y;
+        return r;
+    }
+
+    int send(const FbRect& r, uint32_t waveform, bool full, uint32_t marker) {
+        struct mxcfb_rect region = { (uint32_t)r.y, (uint32_t)r.x, (uint32_t)r.w, (uint32_t)r.h };
+        uint32_t mode = full ? UPDATE_MODE_FULL : UPDATE_MODE_PARTIAL;
+        if (_abi == MXCFB_ABI_WARIO) {
+            struct mxcfb_update_data_wario u;
+            memset(&u, 0, sizeof(u));
+            u.update_region = region;
+            u.waveform_mode = waveform;
+            u.update_mode = mode;
+            u.update_marker = marker;
+            u.hist_bw_waveform_mode = WAVEFORM_MODE_DU;
+            u.hist_gray_waveform_mode = WAVEFORM_MODE_GC16;
+            u.temp = TEMP_USE_AMBIENT;
+            return ioctl(_fd, MXCFB_SEND_UPDATE_WARIO, &u);
+        }
+        struct mxcfb_update_data_rex u;
+        memset(&u, 0, sizeof(u));
+        u.update_region = region;
+        u.waveform_mode = waveform;
+        u.update_mode = mode;
+        u.update_marker = marker;
+        u.temp = TEMP_USE_AMBIENT;
+        u.hist_bw_waveform_mode = WAVEFORM_MODE_DU;
+        u.hist_gray_waveform_mode = WAVEFORM_MODE_GC16;
+        return ioctl(_fd, MXCFB_SEND_UPDATE_REX, &u);
+    }
+
+    int _fd = -1;
+    uint8_t* _fb = nullptr;
+    size_t _size = 0;
+    int _width = 0, _height = 0, _pitch = 0;
+    bool _fake = false;
+    bool _invert = false;
+    MxcfbAbi _abi = MXCFB_ABI_REX;
+    uint32_t _marker = 0;
+    int _cw = 0, _ch = 0, _rot = 0, _ox = 0, _oy = 0;
+    uint32_t _scale16 = 65536, _inv16 = 65536;
+    std::vector<FbUpdate> _fakeUpdates;
+};
+
+#endif // KINDLE_FB_HPP
@@ -0,0 +1,86 @@
+/**
+ * EPDC update ioctls for Kindle framebuffers
+ *
+ * The Kindle kernels don't ship usable userspace headers, and the layout of
+ * struct mxcfb_update_data changed between generations, so both layouts
+ * the client knows are spelled out here. The ioctl number encodes the
+ * struct size, so a kernel rejects (ENOTTY/EINVAL) a layout that isn't its
+ * own; KindleFramebuffer uses that to probe.
+ *
+ *   MXCFB_ABI_WARIO  PW3 (i.MX6SL)
+ *   MXCFB_ABI_REX    PW4, Basic 10th gen and later
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef MXCFB_KINDLE_H
+#define MXCFB_KINDLE_H
+
+#include <stdint.h>
+#include <sys/ioctl.h>
+
+#define WAVEFORM_MODE_INIT 0x0
+#define WAVEFORM_MODE_DU 0x1      // 1-bit, fast, no flash: black/white text
+#define WAVEFORM_MODE_GC16 0x2    // full greyscale, flashes: clears ghosting
+#define WAVEFORM_MODE_AUTO 257
+
+#define UPDATE_MODE_PARTIAL 0x0
+#define UPDATE_MODE_FULL 0x1
+
+#define TEMP_USE_AMBIENT 0x1000
+
+enum MxcfbAbi { MXCFB_ABI_WARIO, MXCFB_ABI_REX, MXCFB_ABI_COUNT };
+
+struct mxcfb_rect {
+    uint32_t top;
+    uint32_t left;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct mxcfb_alt_buffer_data {
+    uint32_t phys_addr;
+    uint32_t width;
+    uint32_t height;
+    struct mxcfb_rect alt_update_region;
+};
+
+struct mxcfb_update_data_wario {
+    struct mxcfb_rect update_region;
+    uint32_t waveform_mode;
+    uint32_t update_mode;
+    uint32_t update_marker;
+    uint32_t hist_bw_waveform_mode;
+    uint32_t hist_gray_waveform_mode;
+    int temp;
+    unsigned int flags;
+    struct mxcfb_alt_buffer_data alt_buffer_data;
+};
+
+struct mxcfb_update_data_rex {
+    struct mxcfb_rect update_region;
+    uint32_t waveform_mode;
+    uint32_t update_mode;
+    uint32_t update_marker;
+    int temp;
+    unsigned int flags;
+    int dither_mode;
+    int quant_bit;
+    struct mxcfb_alt_buffer_data alt_buffer_data;
+    uint32_t hist_bw_waveform_mode;
+    uint32_t hist_gray_waveform_mode;
+    uint32_t ts_pxp;
+    uint32_t ts_epdc;
+};
+
+struct mxcfb_update_marker_data {
+    uint32_t update_marker;
+    uint32_t collision_test;
+};
+
+#define MXCFB_SEND_UPDATE_WARIO _IOW('F', 0x2E, struct mxcfb_update_data_wario)
+#define MXCFB_SEND_UPDATE_REX _IOW('F', 0x2E, struct mxcfb_update_data_rex)
+#define MXCFB_WAIT_FOR_UPDATE_COMPLETE _IOWR('F', 0x2F, struct mxcfb_update_marker_data)
+
+#endif // MXCFB_KINDLE_H
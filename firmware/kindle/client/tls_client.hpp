@@ -0,0 +1,128 @@
+/**
+ * TLS Client over OpenSSL for the Kindle zone client
+ *
+ * Same non-blocking shape as PosixClient: available() reports decrypted
+ * bytes ready to read without waiting, so ZonePushClient and httpRequest
+ * drive it exactly like WiFiClientSecure on the TRMNL.
+ *
+ * Certificates are verified against the system store (or KINDLE_CA_FILE)
+ * unless setInsecure() is called - the Kindle's own CA bundle is often
+ * years out of date, hence the escape hatch.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#ifndef KINDLE_TLS_CLIENT_HPP
+#define KINDLE_TLS_CLIENT_HPP
+
+#include "posix_client.hpp"
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+class TlsClient : public Client {
+public:
+    ~TlsClient() override { stop(); if (_ctx) SSL_CTX_free(_ctx); }
+
+    void setInsecure() { _insecure = true; }
+    void setCaFile(const char* path) { _caFile = path; }
+
+    int connect(const char* host, uint16_t port) override {
+        stop();
+        if (!_ctx && !initContext()) return 0;
+        if (!_tcp.connect(host, port)) return 0;
+        _ssl = SSL_new(_ctx);
+        if (!_ssl) { _tcp.stop(); return 0; }
+        SSL_set_fd(_ssl, _tcp.fd());
+        SSL_set_tlsext_host_name(_ssl, host);
+        if (!_insecure) {
+            SSL_set_verify(_ssl, SSL_VERIFY_PEER, nullptr);
+            X509_VERIFY_PARAM_set1_host(SSL_get0_param(_ssl), host, 0);
+        }
+        // Blocking handshake, like WiFiClientSecure::connect; non-blocking afterwards
+        if (SSL_connect(_ssl) != 1) {
+            unsigned long e = ERR_get_error();
+            fprintf(stderr, "tls: %s:%u: %s\n", host, port, e ? ERR_error_string(e, nullptr) : "handshake failed");
+            stop();
+            return 0;
+        }
+        fcntl(_tcp.fd(), F_SETFL, fcntl(_tcp.fd(), F_GETFL) | O_NONBLOCK);
+        return 1;
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!_ssl) return 0;
+        size_t sent = 0;
+        while (sent < size) {
+            int n = SSL_write(_ssl, buf + sent, (int)(size - sent));
+            if (n > 0) { sent += (size_t)n; continue; }
+            int err = SSL_get_error(_ssl, n);
+            if (err != SSL_ERROR_WANT_WRITE && err != SSL_ERROR_WANT_READ) break;
+            struct pollfd p = { _tcp.fd(), (short)(err == SSL_ERROR_WANT_WRITE ? POLLOUT : POLLIN), 0 };
+            if (::poll(&p, 1, 5000) <= 0) break;
+        }
+        return sent;
+    }
+
+    int available() override {
+        if (!_ssl) return 0;
+        if (SSL_pending(_ssl) == 0 && _tcp.available() > 0) fill();
+        return SSL_pending(_ssl);
+    }
+
+    int read(uint8_t* buf, size_t size) override {
+        if (!_ssl || !available()) return -1;
+        int n = SSL_read(_ssl, buf, (int)size);
+        return n > 0 ? n : -1;
+    }
+
+    void stop() override {
+        if (_ssl) {
+            SSL_shutdown(_ssl);
+            SSL_free(_ssl);
+        }
+        _ssl = nullptr;
+        _closed = false;
+        _tcp.stop();
+    }
+
+    uint8_t connected() override { return _ssl && !_closed && (SSL_pending(_ssl) > 0 || _tcp.connected()); }
+
+    int fd() const { return _tcp.fd(); }
+
+private:
+    bool initContext() {
+        _ctx = SSL_CTX_new(TLS_client_method());
+        if (!_ctx) return false;
+        SSL_CTX_set_min_proto_version(_ctx, TLS1_2_VERSION);
+        if (!_insecure && !(_caFile ? SSL_CTX_load_verify_locations(_ctx, _caFile, nullptr) : SSL_CTX_set_default_verify_paths(_ctx))) {
+            fprintf(stderr, "tls: no CA certificates (pass --insecure to skip verification)\n");
+            SSL_CTX_free(_ctx);
+            _ctx = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // Pull waiting socket bytes through the record layer without blocking; a
+    // partial record just leaves SSL_pending at 0 until the rest arrives
+    void fill() {
+        uint8_t dummy;
+        int n = SSL_peek(_ssl, &dummy, 1);
+        if (n <= 0) {
+            int err = SSL_get_error(_ssl, n);
+            if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) _closed = true;
+        }
+    }
+
+    PosixClient _tcp;
+    SSL_CTX* _ctx = nullptr;
+    SSL* _ssl = nullptr;
+    const char* _caFile = nullptr;
+    bool _insecure = false;
+    bool _closed = false;
+};
+
+#endif // KINDLE_TLS_CLIENT_HPP
@@ -0,0 +1,284 @@
+/**
+ * PTV-TRMNL native Kindle client
+ *
+ * Speaks the same zone protocol as the TRMNL firmware (zones-v12): a push
+ * channel says which zones changed, only the tiles that differ are
+ * fetched, and only the panel region under them is refreshed - a DU
+ * partial update instead of redrawing a whole PNG. That makes 20 second
+ * cadences practical where the shell launcher needed 15 minutes.
+ *
+ *   trmnl-kindle --server https://example.com            (runs on /dev/fb0)
+ *   trmnl-kindle --fake 1072x1448 --fb /tmp/fb.raw --once (Linux host)
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+#include <Arduino.h>
+#include "http_fetch.hpp"
+#include "kindle_fb.hpp"
+#include "posix_client.hpp"
+#include "trmnl_log.hpp"
+#include "zone_layout.hpp"
+#include "zone_push.hpp"
+#include "zone_tiles.hpp"
+#ifdef KINDLE_TLS
+#include "tls_client.hpp"
+#endif
+
+#include <poll.h>
+#include <signal.h>
+#include <string>
+
+#define CLIENT_VERSION "1.0.0"
+#define USER_AGENT "PTV-TRMNL-Kindle/" CLIENT_VERSION
+
+struct Options {
+    const char* server = "https://ptvtrmnl.vercel.app";
+    const char* fbPath = "/dev/fb0";
+    const char* caFile = nullptr;
+    int fakeW = 0, fakeH = 0, fakePitch = 0;
+    int rotate = 90;              // 800x480 landscape canvas on a portrait panel
+    float scale = 0;              // 0 = fit
+    int interval = 20;            // seconds between polls when push is down
+    int fullEvery = 10;           // partial updates between GC16 flashes
+    bool once = false;
+    bool insecure = false;
+    bool invert = false;
+    MxcfbAbi abi = MXCFB_ABI_REX;
+};
+
+static volatile sig_atomic_t stopping = 0;
+static void onSignal(int) { stopping = 1; }
+
+static uint8_t canvasPixels[(ZONE_CANVAS_W / 8) * ZONE_CANVAS_H];
+static const TileSurface canvas = { canvasPixels, ZONE_CANVAS_W / 8, ZONE_CANVAS_W, ZONE_CANVAS_H };
+static uint32_t* tileHashes[ZONE_COUNT];
+static int tileHashCount[ZONE_COUNT];
+static bool changed[ZONE_COUNT];
+static bool pending = false;
+
+static ServerEndpoint ep;
+static Client* http = nullptr;
+static KindleFramebuffer fb;
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --server URL       zone server (env PTV_TRMNL_SERVER)\n"
+            "  --fb PATH          framebuffer device, or the file for --fake (default /dev/fb0)\n"
+            "  --fake WxH[:PITCH] treat --fb as a plain file of that geometry\n"
+            "  --rotate DEG       canvas rotation, clockwise (default 90)\n"
+            "  --scale F          canvas scale (default: fit the panel)\n"
+            "  --interval S       poll interval when push is unavailable (default 20)\n"
+            "  --full-every N     GC16 full refresh after N partials (env PTV_TRMNL_FULL_REFRESH_INTERVAL)\n"
+            "  --mxcfb wario|rex  MXCFB_SEND_UPDATE layout (default from PTV_TRMNL_DEVICE)\n"
+            "  --ca FILE          CA bundle for https\n"
+            "  --insecure         skip certificate verification\n"
+            "  --invert           white-on-black\n"
+            "  --once             fetch every zone, refresh once and exit\n",
+            argv0);
+}
+
+static bool parseArgs(int argc, char** argv, Options& o) {
+    if (const char* s = getenv("PTV_TRMNL_SERVER")) o.server = s;
+    if (const char* s = getenv("PTV_TRMNL_FULL_REFRESH_INTERVAL")) o.fullEvery = atoi(s);
+    // The PW3 is on the older Wario EPDC driver; everything later takes the Rex struct
+    if (const char* s = getenv("PTV_TRMNL_DEVICE")) o.abi = strcmp(s, "kindle-pw3") == 0 ? MXCFB_ABI_WARIO : MXCFB_ABI_REX;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool takes = true;
+        if (strcmp(a, "--once") == 0) { o.once = true; takes = false; }
+        else if (strcmp(a, "--insecure") == 0) { o.insecure = true; takes = false; }
+        else if (strcmp(a, "--invert") == 0) { o.invert = true; takes = false; }
+        else if (!v) { usage(argv[0]); return false; }
+        else if (strcmp(a, "--server") == 0) o.server = v;
+        else if (strcmp(a, "--fb") == 0) o.fbPath = v;
+        else if (strcmp(a, "--ca") == 0) o.caFile = v;
+        else if (strcmp(a, "--rotate") == 0) o.rotate = atoi(v);
+        else if (strcmp(a, "--scale") == 0) o.scale = (float)atof(v);
+        else if (strcmp(a, "--interval") == 0) o.interval = atoi(v);
+        else if (strcmp(a, "--full-every") == 0) o.fullEvery = atoi(v);
+        else if (strcmp(a, "--fake") == 0) {
+            if (sscanf(v, "%dx%d:%d", &o.fakeW, &o.fakeH, &o.fakePitch) < 2 || o.fakeW <= 0 || o.fakeH <= 0) { usage(argv[0]); return false; }
+        } else if (strcmp(a, "--mxcfb") == 0) {
+            if (strcmp(v, "wario") == 0) o.abi = MXCFB_ABI_WARIO;
+            else if (strcmp(v, "rex") == 0) o.abi = MXCFB_ABI_REX;
+            else { usage(argv[0]); return false; }
+        } else { usage(argv[0]); return false; }
+        if (takes) i++;
+    }
+    if (o.interval < 1) o.interval = 1;
+    if (o.fullEvery < 1) o.fullEvery = 1;
+    return true;
+}
+
+static bool appendBody(const uint8_t* data, size_t len, void* ctx) {
+    std::string* s = (std::string*)ctx;
+    if (s->size() + len > 1024) return false;    // a zone list is a few dozen bytes
+    s->append((const char*)data, len);
+    return true;
+}
+
+static bool feedDecoder(const uint8_t* data, size_t len, void* ctx) {
+    return ((TileStreamDecoder*)ctx)->feed(data, len);
+}
+
+static bool fetchChangedZoneList(bool forceAll) {
+    std::string body;
+    HttpResult r = httpRequest(*http, ep, "GET", forceAll ? "/api/zones?plain=1&force=true" : "/api/zones?plain=1",
+                               nullptr, nullptr, 0, appendBody, &body, USER_AGENT);
+    if (r.status != 200 || !r.complete) {
+        LOG_WARN("Zones: HTTP %d", r.status);
+        return false;
+    }
+    LOG_DEBUG("Zones: %s", body.c_str());
+    if (parseZoneList(body.data(), body.size(), ZONES, ZONE_COUNT, changed) > 0) pending = true;
+    return true;
+}
+
+// Stream the zone's changed tiles into the canvas. Returns tiles applied, -1 on failure.
+static int fetchZoneTiles(int zi, int& x, int& y, int& w, int& h, bool resync = false) {
+    const ZoneDef& zone = ZONES[zi];
+    char path[64];
+    snprintf(path, sizeof(path), "/api/zone/%s/tiles", zone.id);
+    TileStreamDecoder dec;
+    dec.begin(canvas, tileHashes[zi], tileHashCount[zi]);
+    HttpResult r = httpRequest(*http, ep, "POST", path, "Content-Type: application/octet-stream\r\n",
+                               (const uint8_t*)tileHashes[zi], tileHashCount[zi] * sizeof(uint32_t),
+                               feedDecoder, &dec, USER_AGENT);
+    if (r.status != 200 || !dec.done()) {
+        // Part of the zone may have been written; nothing it holds can be trusted now
+        memset(tileHashes[zi], 0, tileHashCount[zi] * sizeof(uint32_t));
+        LOG_WARN("Zone %s: HTTP %d, tile stream %s", zone.id, r.status, dec.error() ? "malformed" : "truncated");
+        return -1;
+    }
+    LOG_DEBUG("Zone %s: %d/%d tiles, %lu bytes", zone.id, dec.applied(), dec.tiles(), (unsigned long)dec.bytes());
+    int dx, dy, dw, dh;
+    if (dec.dirtyRect(dx, dy, dw, dh)) {
+        // Union with whatever an earlier pass already dirtied
+        if (w > 0 && h > 0) {
+            int x1 = std::max(x + w, dx + dw), y1 = std::max(y + h, dy + dh);
+            x = std::min(x, dx); y = std::min(y, dy); w = x1 - x; h = y1 - y;
+        } else { x = dx; y = dy; w = dw; h = dh; }
+    }
+    if (dec.mismatches() > 0 && !resync) {
+        LOG_WARN("Zone %s: %d tiles out of sync, resyncing", zone.id, dec.mismatches());
+        int again = fetchZoneTiles(zi, x, y, w, h, true);
+        return again < 0 ? again : dec.applied() + again;
+    }
+    return dec.applied();
+}
+
+static void onZonePush(const ZonePushEvent& ev, void* ctx) {
+    LOG_INFO("Push v%lu: %.*s", (unsigned long)ev.version, (int)ev.zonesLen, ev.zones);
+    if (parseZoneList(ev.zones, ev.zonesLen, ZONES, ZONE_COUNT, changed) > 0) pending = true;
+}
+
+static void fullRefresh() {
+    fb.clear();
+    fb.blit(canvas, 0, 0, ZONE_CANVAS_W, ZONE_CANVAS_H);
+    fb.waitFor(fb.update(fb.all(), WAVEFORM_MODE_GC16, true));
+}
+
+// Fetch every pending zone; each one that changed gets its own region update
+static int applyPending(bool full) {
+    int updated = 0;
+    pending = false;
+    for (int i = 0; i < ZONE_COUNT; i++) {
+        if (!changed[i]) continue;
+        changed[i] = false;
+        int x = 0, y = 0, w = 0, h = 0;
+        if (fetchZoneTiles(i, x, y, w, h) <= 0 || w <= 0 || h <= 0) continue;
+        updated++;
+        if (full) continue;
+        // DU is the fast 1-bit waveform; the region keeps the rest of the panel still
+        FbRect r = fb.blit(canvas, x, y, w, h);
+        fb.update(r, WAVEFORM_MODE_DU, false);
+    }
+    if (full) fullRefresh();
+    return updated;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) return 2;
+    if (!parseServerUrl(opt.server, ep)) { fprintf(stderr, "bad server URL: %s\n", opt.server); return 2; }
+
+    bool ok = opt.fakeW ? fb.openFake(opt.fbPath, opt.fakeW, opt.fakeH, opt.fakePitch) : fb.open(opt.fbPath, opt.abi);
+    if (!ok) return 1;
+    fb.setInvert(opt.invert);
+    fb.setView(ZONE_CANVAS_W, ZONE_CANVAS_H, opt.rotate, opt.scale);
+
+    PosixClient plainHttp, plainPush;
+#ifdef KINDLE_TLS
+    TlsClient tlsHttp, tlsPush;
+    if (opt.insecure) { tlsHttp.setInsecure(); tlsPush.setInsecure(); }
+    if (opt.caFile) { tlsHttp.setCaFile(opt.caFile); tlsPush.setCaFile(opt.caFile); }
+    Client& pushClient = ep.tls ? (Client&)tlsPush : (Client&)plainPush;
+    http = ep.tls ? (Client*)&tlsHttp : (Client*)&plainHttp;
+#else
+    if (ep.tls) { fprintf(stderr, "built without TLS; use an http:// server\n"); return 2; }
+    Client& pushClient = plainPush;
+    http = &plainHttp;
+#endif
+
+    memset(canvasPixels, 0xFF, sizeof(canvasPixels));
+    for (int i = 0; i < ZONE_COUNT; i++) {
+        tileHashCount[i] = tileCount(ZONES[i].w, ZONES[i].h);
+        tileHashes[i] = (uint32_t*)calloc(tileHashCount[i], sizeof(uint32_t));
+        if (!tileHashes[i]) return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    LOG_INFO("Kindle client %s: %s, %dx%d panel, rotate %d", CLIENT_VERSION, opt.server, fb.width(), fb.height(), opt.rotate);
+
+    // First pass: everything, drawn with one GC16 flash
+    if (!fetchChangedZoneList(true)) {
+        if (opt.once) return 1;
+        for (int i = 0; i < ZONE_COUNT; i++) changed[i] = true;
+        pending = true;
+    }
+    applyPending(true);
+    if (opt.once) return 0;
+
+    ZonePushClient<Client> push;
+    push.begin(pushClient, ep, USER_AGENT);
+    int partials = 0;
+    unsigned long lastPoll = millis();
+    while (!stopping) {
+        push.poll(onZonePush, nullptr);
+        unsigned long now = millis();
+        // With the stream live, polling is only a slow safety net
+        unsigned long pollMs = (push.streaming() ? 10UL : 1UL) * opt.interval * 1000;
+        if (now - lastPoll >= pollMs) {
+            lastPoll = now;
+            fetchChangedZoneList(false);
+        }
+        if (pending) {
+            bool full = partials >= opt.fullEvery;
+            int n = applyPending(full);
+            partials = full ? 0 : partials + n;
+        }
+
+        // Sleep until the next poll or push deadline, or until the push socket has data
+        unsigned long elapsed = millis() - lastPoll;
+        uint32_t ms = elapsed < pollMs ? (uint32_t)(pollMs - elapsed) : 0;
+        ms = std::min(ms, push.msUntilDue());
+        struct pollfd p = { -1, POLLIN, 0 };
+#ifdef KINDLE_TLS
+        p.fd = ep.tls ? tlsPush.fd() : plainPush.fd();
+#else
+        p.fd = plainPush.fd();
+#endif
+        if (push.streaming() && pushClient.available() > 0) ms = 0;
+        if (ms > 0) ::poll(&p, p.fd >= 0 ? 1 : 0, (int)ms);
+    }
+    LOG_INFO("Stopping");
+    push.stop();
+    return 0;
+}
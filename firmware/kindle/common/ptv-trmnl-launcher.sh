@@ -41,6 +41,9 @@ IMAGE_FILE="${CACHE_DIR}/dashboard.png"
 LOG_FILE="${CACHE_DIR}/ptv-trmnl.log"
 PID_FILE="${CACHE_DIR}/ptv-trmnl.pid"
 
+# Native zone client (built from firmware/kindle/client); used when present
+NATIVE_CLIENT="${SCRIPT_DIR}/trmnl-kindle"
+
 # ============================================
 # FUNCTIONS
 # ============================================
@@ -134,6 +137,24 @@ show_error() {
     eips 10 16 "and server URL"
 }
 
+run_native() {
+    # Zone updates arrive over a held-open push connection and are drawn as
+    # partial refreshes, so WiFi stays up and there is no sleep loop here.
+    source "${CONFIG_DIR}/device-config.sh" 2>/dev/null
+    log "Starting native client (${DEVICE_MODEL})..."
+    enable_wifi
+    PTV_TRMNL_SERVER="$SERVER_URL" "$NATIVE_CLIENT" >> "$LOG_FILE" 2>&1 &
+    echo $! > "$PID_FILE"
+}
+
+start_daemon() {
+    if [ -x "$NATIVE_CLIENT" ]; then
+        run_native
+    else
+        run_daemon &
+    fi
+}
+
 run_daemon() {
     log "Starting PTV-TRMNL daemon..."
     log "Device: ${DEVICE_MODEL}"
@@ -233,7 +254,7 @@ fi
 
 case "${1:-start}" in
     start)
-        run_daemon &
+        start_daemon
         echo "PTV-TRMNL started in background"
         ;;
     stop)
@@ -242,7 +263,7 @@ case "${1:-start}" in
     restart)
         stop_daemon
         sleep 2
-        run_daemon &
+        start_daemon
         echo "PTV-TRMNL restarted"
         ;;
     status)
@@ -252,7 +273,10 @@ case "${1:-start}" in
         # Run once without daemon mode
         enable_wifi
         sleep 5
-        if fetch_image; then
+        if [ -x "$NATIVE_CLIENT" ]; then
+            source "${CONFIG_DIR}/device-config.sh" 2>/dev/null
+            PTV_TRMNL_SERVER="$SERVER_URL" "$NATIVE_CLIENT" --once >> "$LOG_FILE" 2>&1 || show_error "Failed to fetch"
+        elif fetch_image; then
             display_image
         else
             show_error "Failed to fetch"
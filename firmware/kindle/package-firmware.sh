@@ -11,6 +11,8 @@ set -e
 SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
 OUTPUT_DIR="${1:-$SCRIPT_DIR/dist}"
 VERSION="1.0.0"
+# Statically linked ARM build of client/trmnl-kindle.cpp; shipped when present
+NATIVE_CLIENT="${TRMNL_KINDLE_BIN:-$SCRIPT_DIR/client/build/trmnl-kindle}"
 
 echo "=== PTV-TRMNL Kindle Firmware Packager ==="
 echo "Version: $VERSION"
@@ -48,6 +50,12 @@ for device_entry in "${DEVICES[@]}"; do
     # Copy device-specific config
     cp "$SCRIPT_DIR/$device_id/device-config.sh" "$package_dir/"
 
+    # Native zone client; without it the launcher falls back to full-image refreshes
+    if [ -f "$NATIVE_CLIENT" ]; then
+        cp "$NATIVE_CLIENT" "$package_dir/trmnl-kindle"
+        chmod +x "$package_dir/trmnl-kindle"
+    fi
+
     # Create sample config file
     cat > "$package_dir/config.sh.example" << 'EOF'
 #!/bin/sh
@@ -11,9 +11,56 @@
 
 #include <bb_epaper.h>
 #include <ArduinoJson.h>
+#include "dashboard_layout.hpp"   // TPL_*: rectangles from layout/dashboard.layout
 
 extern BBEPAPER bbep;
 
+static void tplFont(const LayoutField& f) { bbep.setFont(LAYOUT_BB_FONT(LAYOUT_FONTS[f.font].cell)); }
+
+// Draw text several times with 1px offsets: a bolder FONT_12x16
+static void tplPrintBold(const LayoutField& f, int row, const char* text, const char* suffix = "") {
+    static const int8_t offsets[][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+    tplFont(f);
+    for (const auto& o : offsets) {
+        bbep.setCursor(f.tx + o[0], layoutRowY(f, row) + o[1]);
+        bbep.print(text);
+        bbep.print(suffix);
+    }
+}
+
+static void tplDeparture(const LayoutField& timeField, const LayoutField& destField, int row,
+                         const char* time, const char* dest, const char* status) {
+    tplFont(timeField);
+    bbep.setCursor(timeField.tx, layoutRowY(timeField, row));
+    bbep.print(time);
+    bbep.print(" min*");
+
+    tplFont(destField);
+    bbep.setCursor(destField.tx, layoutRowY(destField, row));
+    bbep.print(dest);
+    if (strlen(status) > 0) {
+        bbep.print(" (");
+        bbep.print(status);
+        bbep.print(")");
+    }
+}
+
+// Blank one row of a field and redraw its time, then refresh that part
+static void tplUpdateTime(const LayoutField& f, int row, const char* text, const char* suffix, bool bold) {
+    int y = f.y + row * f.step;
+    bbep.fillRect(f.x, y, f.w, f.h, BBEP_BLACK);
+    bbep.fillRect(f.x, y, f.w, f.h, BBEP_WHITE);
+    if (bold) {
+        tplPrintBold(f, row, text, suffix);
+    } else {
+        tplFont(f);
+        bbep.setCursor(f.tx, layoutRowY(f, row));
+        bbep.print(text);
+        bbep.print(suffix);
+    }
+    bbep.refresh(REFRESH_PARTIAL, true);
+}
+
 // ============================================================================
 // DASHBOARD TEMPLATE DRAWING FUNCTION
 // ============================================================================
@@ -86,49 +133,35 @@ void drawDashboardTemplate(JsonDocument& doc) {
     // 1. STATION NAME BOX (Top-Left)
     // ========================================================================
     // Draw rounded rectangle approximation (using simple rect for e-ink)
-    bbep.drawRect(10, 10, 90, 50, BBEP_BLACK);
-    bbep.drawRect(11, 11, 88, 48, BBEP_BLACK); // Double border for thickness
+    const ZoneDef& station = TPL_ZONES[TPL_STATION];
+    for (int i = 0; i < TPL_LAYOUT[TPL_STATION].border; i++)   // Double border for thickness
+        bbep.drawRect(station.x + i, station.y + i, station.w - 2 * i, station.h - 2 * i, BBEP_BLACK);
 
-    bbep.setFont(FONT_8x8);
-    bbep.setCursor(15, 30);
+    const LayoutField& name = TPL_FIELDS[TPL_STATION_NAME];
+    tplFont(name);
+    bbep.setCursor(name.tx, name.ty);
     bbep.print(stationName);
 
     // ========================================================================
     // 2. LARGE TIME DISPLAY (Center-Top)
     // ========================================================================
-    // Use largest available font (FONT_12x16), scale by drawing multiple times
-    // or use custom large font rendering
-    bbep.setFont(FONT_12x16);
-
-    // For extra large time, we'll draw it in FONT_12x16 (biggest available)
-    // Position for centering: 5 chars × 12px = 60px width at 12x16 font
-    // But we want it HUGE, so let's position it prominently
-    int timeX = 140;
-    int timeY = 25;
-
-    bbep.setCursor(timeX, timeY);
-    bbep.print(timeText);
-
-    // Draw a second pass offset slightly to make it look bolder
-    bbep.setCursor(timeX + 1, timeY);
-    bbep.print(timeText);
-    bbep.setCursor(timeX, timeY + 1);
-    bbep.print(timeText);
-    bbep.setCursor(timeX + 1, timeY + 1);
-    bbep.print(timeText);
+    // FONT_12x16 is the biggest available; draw it several times, offset,
+    // to make it look bolder
+    tplPrintBold(TPL_FIELDS[TPL_CLOCK_TIME], 0, timeText);
 
     // ========================================================================
     // 3. TRAM SECTION (Left Column)
     // ========================================================================
 
     // Header strip (black background)
-    bbep.fillRect(10, 120, 370, 25, BBEP_BLACK);
+    const LayoutField& tramStrip = TPL_FIELDS[TPL_TRAMS_HEADER];
+    bbep.fillRect(tramStrip.x, tramStrip.y, tramStrip.w, tramStrip.h, BBEP_BLACK);
 
     // Header text (white on black)
     // Note: bb_epaper may not support white text on black directly
     // We'll need to use XOR mode or draw inverted
     // For now, we'll draw the box and text separately
-    bbep.setFont(FONT_8x8);
+    tplFont(tramStrip);
 
     // Create header text string
     char tramHeader[50];
@@ -142,87 +175,32 @@ void drawDashboardTemplate(JsonDocument& doc) {
     // Instead, clear a text area and draw black text there
     // This is complex - let's simplify to just black text below black strip for now
 
-    bbep.setCursor(15, 130);
+    bbep.setCursor(tramStrip.tx, tramStrip.ty);
     bbep.print(tramHeader); // This may not be visible on black background
 
     // TRAM DEPARTURES:
-
-    // Departure 1
-    bbep.setFont(FONT_12x16);
-    bbep.setCursor(20, 165);
-    bbep.print(tram1Time);
-    bbep.print(" min*");
-
-    bbep.setFont(FONT_8x8);
-    bbep.setCursor(20, 190);
-    bbep.print(tram1Dest);
-    if (strlen(tram1Status) > 0) {
-        bbep.print(" (");
-        bbep.print(tram1Status);
-        bbep.print(")");
-    }
-
-    // Departure 2
-    bbep.setFont(FONT_12x16);
-    bbep.setCursor(20, 235);
-    bbep.print(tram2Time);
-    bbep.print(" min*");
-
-    bbep.setFont(FONT_8x8);
-    bbep.setCursor(20, 260);
-    bbep.print(tram2Dest);
-    if (strlen(tram2Status) > 0) {
-        bbep.print(" (");
-        bbep.print(tram2Status);
-        bbep.print(")");
-    }
+    tplDeparture(TPL_FIELDS[TPL_TRAMS_TIME], TPL_FIELDS[TPL_TRAMS_DEST], 0, tram1Time, tram1Dest, tram1Status);
+    tplDeparture(TPL_FIELDS[TPL_TRAMS_TIME], TPL_FIELDS[TPL_TRAMS_DEST], 1, tram2Time, tram2Dest, tram2Status);
 
     // ========================================================================
     // 4. TRAIN SECTION (Right Column)
     // ========================================================================
 
     // Header strip (black background)
-    bbep.fillRect(400, 120, 360, 25, BBEP_BLACK);
+    const LayoutField& trainStrip = TPL_FIELDS[TPL_TRAINS_HEADER];
+    bbep.fillRect(trainStrip.x, trainStrip.y, trainStrip.w, trainStrip.h, BBEP_BLACK);
 
     // Header text
-    bbep.setFont(FONT_8x8);
+    tplFont(trainStrip);
     char trainHeader[50];
     snprintf(trainHeader, sizeof(trainHeader), "TRAINS (%s)", trainLine);
 
-    bbep.setCursor(405, 130);
+    bbep.setCursor(trainStrip.tx, trainStrip.ty);
     bbep.print(trainHeader);
 
     // TRAIN DEPARTURES:
-
-    // Departure 1
-    bbep.setFont(FONT_12x16);
-    bbep.setCursor(410, 165);
-    bbep.print(train1Time);
-    bbep.print(" min*");
-
-    bbep.setFont(FONT_8x8);
-    bbep.setCursor(410, 190);
-    bbep.print(train1Dest);
-    if (strlen(train1Status) > 0) {
-        bbep.print(" (");
-        bbep.print(train1Status);
-        bbep.print(")");
-    }
-
-    // Departure 2
-    bbep.setFont(FONT_12x16);
-    bbep.setCursor(410, 235);
-    bbep.print(train2Time);
-    bbep.print(" min*");
-
-    bbep.setFont(FONT_8x8);
-    bbep.setCursor(410, 260);
-    bbep.print(train2Dest);
-    if (strlen(train2Status) > 0) {
-        bbep.print(" (");
-        bbep.print(train2Status);
-        bbep.print(")");
-    }
+    tplDeparture(TPL_FIELDS[TPL_TRAINS_TIME], TPL_FIELDS[TPL_TRAINS_DEST], 0, train1Time, train1Dest, train1Status);
+    tplDeparture(TPL_FIELDS[TPL_TRAINS_TIME], TPL_FIELDS[TPL_TRAINS_DEST], 1, train2Time, train2Dest, train2Status);
 
     // ========================================================================
     // 5. RIGHT SIDEBAR (Optional - Weather/Alerts)
@@ -231,20 +209,23 @@ void drawDashboardTemplate(JsonDocument& doc) {
     if (strlen(alert) > 0) {
         // Draw vertical text (rotated 90°) - complex, skip for now
         // Or draw horizontally at right edge
-        bbep.setFont(FONT_6x8);
-        bbep.setCursor(775, 120);
+        const LayoutField& f = TPL_FIELDS[TPL_SIDEBAR_ALERT];
+        tplFont(f);
+        bbep.setCursor(f.tx, f.ty);
         bbep.print(alert);
     }
 
     if (strlen(weather) > 0) {
-        bbep.setFont(FONT_6x8);
-        bbep.setCursor(775, 340);
+        const LayoutField& f = TPL_FIELDS[TPL_SIDEBAR_WEATHER];
+        tplFont(f);
+        bbep.setCursor(f.tx, f.ty);
         bbep.print(weather);
     }
 
     if (strlen(temperature) > 0) {
-        bbep.setFont(FONT_8x8);
-        bbep.setCursor(775, 410);
+        const LayoutField& f = TPL_FIELDS[TPL_SIDEBAR_TEMPERATURE];
+        tplFont(f);
+        bbep.setCursor(f.tx, f.ty);
         bbep.print(temperature);
         bbep.print((char)248); // Degree symbol (°)
     }
@@ -286,83 +267,27 @@ void updateDashboardTemplateRegions(JsonDocument& doc) {
 
     // Update TIME region (most frequent)
     if (strcmp(prevTime, timeText) != 0) {
-        int boxX = 135, boxY = 20, boxW = 120, boxH = 50;
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_BLACK);
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_WHITE);
-
-        bbep.setFont(FONT_12x16);
-        int timeX = 140, timeY = 25;
-        bbep.setCursor(timeX, timeY);
-        bbep.print(timeText);
-        // Bold effect
-        bbep.setCursor(timeX + 1, timeY);
-        bbep.print(timeText);
-        bbep.setCursor(timeX, timeY + 1);
-        bbep.print(timeText);
-        bbep.setCursor(timeX + 1, timeY + 1);
-        bbep.print(timeText);
-
-        bbep.refresh(REFRESH_PARTIAL, true);
+        tplUpdateTime(TPL_FIELDS[TPL_CLOCK_TIME], 0, timeText, "", true);
         strncpy(prevTime, timeText, sizeof(prevTime) - 1);
     }
 
-    // Update TRAM 1 time
+    // Update TRAM 1 and 2 times
     if (strcmp(prevTram1Time, tram1Time) != 0) {
-        int boxX = 15, boxY = 160, boxW = 150, boxH = 25;
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_BLACK);
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_WHITE);
-
-        bbep.setFont(FONT_12x16);
-        bbep.setCursor(20, 165);
-        bbep.print(tram1Time);
-        bbep.print(" min*");
-
-        bbep.refresh(REFRESH_PARTIAL, true);
+        tplUpdateTime(TPL_FIELDS[TPL_TRAMS_TIME], 0, tram1Time, " min*", false);
         strncpy(prevTram1Time, tram1Time, sizeof(prevTram1Time) - 1);
     }
-
-    // Update TRAM 2 time
     if (strcmp(prevTram2Time, tram2Time) != 0) {
-        int boxX = 15, boxY = 230, boxW = 150, boxH = 25;
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_BLACK);
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_WHITE);
-
-        bbep.setFont(FONT_12x16);
-        bbep.setCursor(20, 235);
-        bbep.print(tram2Time);
-        bbep.print(" min*");
-
-        bbep.refresh(REFRESH_PARTIAL, true);
+        tplUpdateTime(TPL_FIELDS[TPL_TRAMS_TIME], 1, tram2Time, " min*", false);
         strncpy(prevTram2Time, tram2Time, sizeof(prevTram2Time) - 1);
     }
 
-    // Update TRAIN 1 time
+    // Update TRAIN 1 and 2 times
     if (strcmp(prevTrain1Time, train1Time) != 0) {
-        int boxX = 405, boxY = 160, boxW = 150, boxH = 25;
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_BLACK);
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_WHITE);
-
-        bbep.setFont(FONT_12x16);
-        bbep.setCursor(410, 165);
-        bbep.print(train1Time);
-        bbep.print(" min*");
-
-        bbep.refresh(REFRESH_PARTIAL, true);
+        tplUpdateTime(TPL_FIELDS[TPL_TRAINS_TIME], 0, train1Time, " min*", false);
         strncpy(prevTrain1Time, train1Time, sizeof(prevTrain1Time) - 1);
     }
-
-    // Update TRAIN 2 time
     if (strcmp(prevTrain2Time, train2Time) != 0) {
-        int boxX = 405, boxY = 230, boxW = 150, boxH = 25;
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_BLACK);
-        bbep.fillRect(boxX, boxY, boxW, boxH, BBEP_WHITE);
-
-        bbep.setFont(FONT_12x16);
-        bbep.setCursor(410, 235);
-        bbep.print(train2Time);
-        bbep.print(" min*");
-
-        bbep.refresh(REFRESH_PARTIAL, true);
+        tplUpdateTime(TPL_FIELDS[TPL_TRAINS_TIME], 1, train2Time, " min*", false);
         strncpy(prevTrain2Time, train2Time, sizeof(prevTrain2Time) - 1);
     }
 }
@@ -6,179 +6,1222 @@
  * - Fetch ONE zone at a time, decode, draw, discard
  * - Never hold full payload in memory
  *
+ * Built on include/firmware_core.hpp: the poll is the zone list and a tile
+ * stream per changed zone (ZoneTransport, ZoneDecoder, ZoneRefresh); push,
+ * button pages, prefetch, the offline timetable and the daily updates are
+ * its extras (ZoneExtras).
+ *
  * Copyright (c) 2026 Angus Bergman
  * Licensed under CC BY-NC 4.0
  */
 
+// Ahead of every include: config.h (pulled in by panel_async.hpp too) only defaults it
+#define FIRMWARE_VERSION "5.45"
+// The core's settings for this firmware: no default server, straight to the zones after the portal
+#define CORE_FIRMWARE_VERSION FIRMWARE_VERSION
+#define CORE_DEFAULT_SERVER_URL ""
+#define CORE_STATUS_SCREENS 0
+#define CORE_CYCLE_MS NET_CYCLE_MS
+
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
+#include <ESPmDNS.h>
 #include <WiFiManager.h>
 #include <Preferences.h>
 #include <ArduinoJson.h>
 #include <bb_epaper.h>
 #include "base64.hpp"
+#include "edge_discovery.hpp"
+#include "energy_model.hpp"
+#include "firmware_core.hpp"
+#include "metrics.hpp"
+#include "net_deadline.hpp"
+#include "net_resume.hpp"
+#include "net_retry.hpp"
+#include "ota_delta.hpp"
+#include "page_cache.hpp"
+#include "panel_async.hpp"
+#include "panel_hal.hpp"
+#include "profile.hpp"
+#include "timetable.hpp"
+#include "sprite_dict.hpp"
+#include "trmnl_log.hpp"
+#include "wake_loop.hpp"
+#include "zone_layout.hpp"
+#include "zone_protocol.hpp"
+#include "zone_push.hpp"
+#include "zone_staging.hpp"
+#include "zone_tiles.hpp"
+#include <sys/time.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
 
 #include "soc/soc.h"
 #include "soc/rtc_cntl_reg.h"
 #include "../include/config.h"
 
-#define SCREEN_W 800
-#define SCREEN_H 480
-#define FIRMWARE_VERSION "5.45"
-#define ZONE_BUFFER_SIZE 16384
-static uint8_t* zoneBuffer = nullptr;
+#define SCREEN_W DASH_W
+#define SCREEN_H DASH_H
+#define PREFETCH_LEAD_S 15       // start fetching the next minute's zones this early
+#define PREFETCH_MIN_LEAD_S 3    // closer than this, leave the boundary to the regular poll
+#define OFFLINE_AFTER_FAILURES 3 // failed polls before scheduled departures replace live ones
+#define TT_DOWNLOAD_MS 20000     // partition image body (timetable, sprites), on top of connect and TTFB
+#define BATTERY_READ_MS 60000    // battery level sampled this often
+#define BATTERY_SAMPLES 8        // ADC reads averaged per sample
+#define OTA_DOWNLOAD_MS 120000   // firmware patch body, on top of connect and TTFB
+#define OTA_MAX_BOOT_TRIES 3     // boots a new image gets to reach the server before it is rolled back
+#define PAGE_RETURN_MS 120000    // back to the journey page after this long on another one
 
-BBEPAPER bbep(EP75_800x480);
+// Public half of the release key patches are signed with, 64 hex digits
+// (host/tools/ota-delta --keygen). Without one the firmware never updates itself.
+#ifndef OTA_SIGNING_KEY
+#define OTA_SIGNING_KEY ""
+#endif
+
+// The glass: PANEL_MODEL's traits for the kernels in panel_hal.hpp (firmware_core.hpp defaults it)
+typedef CorePanel Panel;
+static_assert(Panel::W == DASH_W && Panel::H == DASH_H, "layout/dashboard.layout is drawn for another panel size");
+// Tile streams, layout spans and page frames write the buffer as is
+static_assert(Panel::ROTATION == 0 && Panel::MSB_FIRST, "the zone paths need an upright, MSB-first buffer");
+
+BBEPAPER bbep(PANEL_BB_TYPE);
+PanelAsync panel(bbep);
 Preferences preferences;
-char serverUrl[128] = "";
-bool wifiConnected = false;
-bool initialDrawDone = false;
-unsigned long lastRefresh = 0;
-const unsigned long REFRESH_INTERVAL = 20000;
 unsigned long lastFullRefresh = 0;
-const unsigned long FULL_REFRESH_INTERVAL = 300000;
 int partialCount = 0;
-WiFiManagerParameter customServerUrl("server", "Server URL", "", 120);
 
-struct ZoneDef { const char* id; int16_t x, y, w, h; uint8_t refreshPriority; };
+// A relay on the LAN (host/tools/edge-relay) answers for the server while it is up
+EdgeDiscovery<MDNSResponder> edge;
+bool mdnsStarted = false;
+
+// Push channel: one long-lived SSE connection replaces interval polling while healthy
+WiFiClient pushPlain;
+WiFiClientSecure pushTls;
+ZonePushClient<Client> push;
+bool pushStarted = false;
+bool pushPending = false;
+bool pushUsesTls = false;
+
+// Idle blocks on timers / button / push socket instead of a 1s delay tick
+WakeLoop wake;
+uint32_t wokeFor = 0;
+
+// Next minute's zones, fetched ahead and committed exactly on the boundary
+ZoneStaging staging;
+uint32_t prefetchedFor = 0;
+
+bool pushChanged[ZONE_COUNT] = {false};
+bool lateChanged[ZONE_COUNT] = {false};    // didn't fit in staging, fetched live after commit
+
+// Hash of every 64x16 tile each zone holds on screen (0 = unknown), sent with tile requests
+uint32_t* tileHashes[ZONE_COUNT] = {nullptr};
+int tileHashCount[ZONE_COUNT] = {0};
+
+// Offline timetable: compiled GTFS in the "timetable" partition, shown while the server is unreachable
+Timetable timetable;
+const esp_partition_t* ttPart = nullptr;
+spi_flash_mmap_handle_t ttMap = 0;
+uint32_t ttCheckedDay = 0;
+
+// Pictograms in the "sprites" partition; zones drawn mostly from them can arrive as draw lists
+SpriteDict sprites;
+const esp_partition_t* spritePart = nullptr;
+spi_flash_mmap_handle_t spriteMap = 0;
+int failedPolls = 0;
+bool offlineShown = false;
+bool offlineZone[ZONE_COUNT] = {false};    // drawn over by the offline view
+uint32_t offlineMinute = 0;
 
-static const ZoneDef ZONES[] = {
-    {"time", 20, 45, 180, 70, 1},
-    {"weather", 620, 10, 160, 95, 2},
-    {"trains", 20, 155, 370, 150, 1},
-    {"trams", 410, 155, 370, 150, 1},
-    {"coffee", 20, 315, 760, 65, 2},
-    {"footer", 0, 445, 800, 35, 3},
+// Button pages: the journey dashboard, then whole-screen pages the server renders.
+// Pages off the panel are held packed, so a press never waits on the network.
+enum : uint8_t { PAGE_JOURNEY, PAGE_DEPARTURES, PAGE_ALERTS, PAGE_COUNT };
+const ZoneDef PAGES[PAGE_COUNT] = {
+    {"journey", 0, 0, DASH_W, DASH_H, 0},
+    {"departures", 0, 0, DEPARTURES_W, DEPARTURES_H, 0},
+    {"alerts", 0, 0, ALERTS_W, ALERTS_H, 0},
 };
-static const int ZONE_COUNT = sizeof(ZONES) / sizeof(ZONES[0]);
-
-void initDisplay();
-void showWelcomeScreen();
-void connectWiFi();
-void loadSettings();
-void saveSettings();
-bool fetchChangedZoneList(bool forceAll, bool* changedFlags);
-bool fetchAndDrawZone(const ZoneDef& zone, bool doFlash);
+static_assert(DEPARTURES_W == DASH_W && DEPARTURES_H == DASH_H && ALERTS_W == DASH_W && ALERTS_H == DASH_H, "a page is a whole frame");
+static_assert(PAGE_COUNT <= PAGE_SLOTS, "a cache slot per page");
+PageCache pages;
+uint8_t page = PAGE_JOURNEY;               // on the panel
+bool pageStale[PAGE_COUNT] = {false};      // server pages to fetch in the background
+unsigned long pageShownAt = 0;
+struct { uint8_t page; bool cached; uint32_t pressedMs, drawnMs; } pageSwitch = {};
+
+// Modelled charge per cycle and per hour; the battery level picks the poll and full-refresh cadence
+EnergyModel energy;
+BatteryState battery;
+EnergyTier energyLevel = ENERGY_NORMAL;
+EnergyCadence cadence = energyCadence(ENERGY_NORMAL);
+unsigned long batteryReadAt = 0;
+
+// Counters for the optional /metrics endpoint (METRICS_ENABLED)
+DeviceMetrics stats;
+#if METRICS_ENABLED
+MetricsServer metrics;
+#endif
+
+bool fetchChangedZoneList(bool forceAll, bool* changedFlags, const NetDeadline& cycle, uint32_t applyAt = 0);
+int fetchZoneBmp(const ZoneDef& zone, uint32_t applyAt, uint8_t* buf, size_t cap, int16_t* geom, const NetDeadline& cycle);
+int fetchZoneTiles(int zi, bool doFlash, const NetDeadline& cycle, bool resync = false);
+void resetTileHashes();
+void prefetchFrame(uint32_t applyAt);
+void commitStagedFrame();
+uint64_t epochMs();
 void doFullRefresh();
+void startPush();
+int pushSocket();
+const char* baseUrl();
+WiFiClient* newClient();
+void discoverEdge();
+void armWakeups();
+void mapTimetable();
+void updateTimetable();
+void mapSprites();
+void updateSprites();
+bool pullPartitionImage(const esp_partition_t* part, const char* path, const char* what, bool haveImage, uint32_t crc, size_t minLen, void (*release)());
+int applyDrawList(int zi, DrawListDecoder& dl, NetReader<WiFiClient>& rd, bool doFlash);
+void showOfflineTimetable();
+void readBattery();
+void otaBootCheck();
+void otaConfirm();
+void updateFirmware();
+void accountRequest(size_t bytes, unsigned long startMs);
+void resumeHeaders(HTTPClient& http, NetResume& body);
+long startBody(HTTPClient& http, int httpCode, NetResume& body, size_t cap);
+void accountBody(const NetResume& body, bool ok);
+void accountCycle();
+void startMetrics();
+void serveMetrics();
+bool showPage(uint8_t next, uint32_t pressedMs);
+int fetchPage(int p, const NetDeadline& cycle);
+void refreshPages();
+// Socket under the push stream, for the wake watcher; -1 when not connected
+int pushSocket() {
+    if (!pushStarted || push.state() == PUSH_IDLE || push.state() == PUSH_FALLBACK) return -1;
+    return pushUsesTls ? pushTls.fd() : pushPlain.fd();
+}
 
-void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
-    Serial.begin(115200); delay(500);
-    Serial.printf("\nPTV-TRMNL v%s\n", FIRMWARE_VERSION);
-    loadSettings();
-    zoneBuffer = (uint8_t*)malloc(ZONE_BUFFER_SIZE);
-    if (!zoneBuffer) { Serial.println("FATAL: No memory"); while(1) delay(1000); }
-    initDisplay();
-    if (strlen(serverUrl) == 0) { showWelcomeScreen(); delay(3000); }
-}
-
-void loop() {
-    if (!wifiConnected) { connectWiFi(); if (!wifiConnected) { delay(5000); return; } initialDrawDone = false; }
-    if (WiFi.status() != WL_CONNECTED) { wifiConnected = false; return; }
-    if (strlen(serverUrl) == 0) { delay(10000); return; }
-    unsigned long now = millis();
-    bool needsFull = !initialDrawDone || (now - lastFullRefresh >= FULL_REFRESH_INTERVAL) || (partialCount >= 30);
-    if (now - lastRefresh >= REFRESH_INTERVAL || !initialDrawDone) {
-        lastRefresh = now;
+void onZonePush(const ZonePushEvent& ev, void* ctx);
+
+// ---------------------------------------------------------------------------
+// The firmware core's strategies for the zones (include/firmware_core.hpp)
+
+/** Each request opens its own HTTPClient (fetchChangedZoneList, fetchZoneTiles); this only counts them for the Cycle line. */
+class ZoneTransport {
+public:
+    static const char* name() { return "zones"; }
+    void reset() { _requests = stats.requests; _bytes = stats.bytesFetched; }
+    int requests() const { return (int)(stats.requests - _requests); }
+    size_t bytes() const { return (size_t)(stats.bytesFetched - _bytes); }
+    void close() {}
+
+private:
+    uint64_t _requests = 0, _bytes = 0;
+};
+
+/**
+ * The zones that changed, from a push if one is waiting or else the server's
+ * list, each drawn from a tile stream against the hashes of what it holds.
+ * A zone the cycle has no time left for goes round again with the next poll.
+ */
+class ZoneDecoder {
+public:
+    static const char* name() { return "zones-v12"; }
+
+    bool begin() {
+        for (int i = 0; i < ZONE_COUNT; i++) {
+            int n = tileCount(ZONES[i].w, ZONES[i].h);
+            tileHashes[i] = (uint32_t*)calloc(n, sizeof(uint32_t));
+            tileHashCount[i] = tileHashes[i] ? n : 0;     // without a table the server just sends every tile
+        }
+        return true;
+    }
+
+    template <class Net>
+    bool fetch(Net&, const char* server, bool whole, const NetDeadline& cycle) {
         bool changedFlags[ZONE_COUNT] = {false};
-        if (!fetchChangedZoneList(needsFull, changedFlags)) { delay(5000); return; }
+        if (pushPending && !whole) memcpy(changedFlags, pushChanged, sizeof(changedFlags));
+        else {
+            bool listed = fetchChangedZoneList(whole, changedFlags, cycle);
+            // The relay has gone quiet: this poll and the ones after go to the server, push channel included
+            if (!listed && edge.failed(millis())) {
+                LOG_WARN("Edge: relay not answering, back to %s", server);
+                push.stop(); pushStarted = false;
+                listed = fetchChangedZoneList(whole, changedFlags, cycle);
+            }
+            if (!listed) return false;
+            edge.succeeded();
+        }
+        if (offlineShown) {
+            // Zones the offline view drew over have zeroed tile hashes, so the server resends them whole
+            offlineShown = false;
+            for (int i = 0; i < ZONE_COUNT; i++) { if (offlineZone[i]) changedFlags[i] = true; offlineZone[i] = false; }
+        }
+        memset(pushChanged, 0, sizeof(pushChanged)); pushPending = false;
+        _count = 0;
+        for (int i = 0; i < ZONE_COUNT; i++) if (changedFlags[i] || whole) _zones[_count++] = i;
+        _whole = whole;
+        _cycle = &cycle;
+        _deferred = 0;
+        return true;
+    }
+
+    int regions() const { return _count; }
+    CoreRect rect(int i) const { const ZoneDef& z = ZONES[_zones[i]]; CoreRect r = { z.x, z.y, z.w, z.h }; return r; }
+
+    template <class Net>
+    int draw(Net&, const char*, BBEPAPER&, int i, const NetDeadline& cycle) {
+        int zi = _zones[i];
+        // Out of cycle budget: the rest go straight round again rather than time out one by one
+        if (cycle.expired()) return defer(zi);
+        int tiles = fetchZoneTiles(zi, !_whole, cycle);
+        if (tiles < 0 && cycle.expired()) defer(zi);
+        yield();
+        return tiles;
+    }
+
+    void release() {
+        if (!_cycle) return;
+        stats.cycleSeconds.observe(_cycle->elapsed());
+        stats.zonesDeferred += _deferred;
+        if (_deferred) { pushPending = true; LOG_WARN("Cycle: %d zones deferred after %lums", _deferred, (unsigned long)_cycle->elapsed()); }
+        _cycle = nullptr;
+    }
+
+private:
+    int defer(int zi) { pushChanged[zi] = true; _deferred++; return -1; }
+
+    int _zones[ZONE_COUNT];
+    int _count = 0, _deferred = 0;
+    bool _whole = false;
+    const NetDeadline* _cycle = nullptr;
+};
+
+/** A partial refresh per zone as its tiles land; a whole frame on one full refresh, on the battery's cadence. */
+class ZoneRefresh {
+public:
+    static const char* name() { return "zones"; }
+
+    bool wantsWhole(unsigned long now, bool drawn) const {
+        return !drawn || now - lastFullRefresh >= cadence.fullMs || partialCount >= cadence.partialsPerFull;
+    }
+
+    template <class Frame>
+    bool present(Frame& f, bool whole, unsigned long now) {
         int drawn = 0;
-        for (int i = 0; i < ZONE_COUNT; i++) {
-            if (changedFlags[i] || needsFull) {
-                if (fetchAndDrawZone(ZONES[i], !needsFull)) {
-                    drawn++;
-                    if (!needsFull) { bbep.refresh(REFRESH_PARTIAL, true); partialCount++; delay(50); }
-                }
-                yield();
+        for (int i = 0; i < f.regions(); i++) {
+            int tiles = f.draw(i);
+            if (tiles < 0) continue;
+            drawn++;
+            // Returns once the frame is clocked out; the next fetch overlaps the waveform
+            if (!whole && tiles > 0) { f.panel().refresh(REFRESH_PARTIAL); partialCount++; }
+        }
+        if (!whole || !drawn) return false;
+        doFullRefresh(); lastFullRefresh = now; partialCount = 0;
+        return true;
+    }
+};
+
+/** Everything around the poll: push channel, button pages, prefetch, offline timetable, daily updates. */
+class ZoneExtras {
+public:
+    template <class Core>
+    void begin(Core&) {
+        otaBootCheck();
+        if (!staging.begin()) LOG_WARN("Staging: no memory, prefetch disabled");
+        if (!pages.begin(SCREEN_W, SCREEN_H)) LOG_WARN("Pages: no memory, fetched when shown");
+        mapTimetable();
+        mapSprites();
+        wake.begin(PIN_INTERRUPT);
+    }
+
+    // A press is answered from the page cache before anything touches the network.
+    // Until the journey page has been drawn, or while it shows the offline timetable, it just polls as before.
+    // True when back on the journey page: the next poll catches up on what changed while it was off the panel.
+    template <class Core>
+    bool front(Core& core) {
+        bool button = wokeFor & WAKE_BIT(WAKE_BUTTON);
+        if (button && core.drawn() && !offlineShown && showPage((page + 1) % PAGE_COUNT, wake.pressedMs())) button = page == PAGE_JOURNEY;
+        if (page != PAGE_JOURNEY && (!core.wifi() || millis() - pageShownAt >= PAGE_RETURN_MS) && showPage(PAGE_JOURNEY, 0)) button = true;
+        return button;
+    }
+
+    template <class Core> void offline(Core&) { showOfflineTimetable(); }
+
+    template <class Core>
+    void connected(Core&) {
+        pushStarted = false;
+        discoverEdge();
+        resetTileHashes();
+        memset(pageStale, true, sizeof(pageStale));
+        configTime(NTP_OFFSET_SECONDS, 0, NTP_SERVER);
+        wake.wifiConnected();
+        startMetrics();
+    }
+
+    template <class Core> void disconnected(Core&) { push.stop(); }
+
+    template <class Core>
+    void service(Core& core) {
+        if (edge.due(millis())) discoverEdge();
+        if (!pushStarted) startPush();
+        push.poll(onZonePush, nullptr);
+        serveMetrics();
+        uint64_t nowMs = epochMs();
+        if (nowMs) {
+            uint32_t sec = nowMs / 1000;
+            uint32_t boundary = (sec / 60 + 1) * 60, lead = boundary - sec;
+            if (core.drawn() && page == PAGE_JOURNEY && staging.ready() && boundary != prefetchedFor && lead <= PREFETCH_LEAD_S && lead >= PREFETCH_MIN_LEAD_S) {
+                prefetchedFor = boundary;
+                prefetchFrame(boundary);
             }
+            if (staging.due(sec)) commitStagedFrame();
         }
-        if (needsFull && drawn > 0) { doFullRefresh(); lastFullRefresh = now; partialCount = 0; initialDrawDone = true; }
+        unsigned long now = millis();
+        if (!batteryReadAt || now - batteryReadAt >= BATTERY_READ_MS) readBattery();
+        wokeFor = 0;
+    }
+
+    template <class Core>
+    bool due(Core& core, unsigned long now, bool whole, bool catchUp) {
+        // Interval polling only runs while the push channel is down or in fallback
+        // A staged frame already covers the next boundary, so hold the poll until it lands
+        bool intervalDue = (now - core.lastPoll() >= cadence.pollMs && !staging.pending()) || !core.drawn();
+        bool pollDue = (intervalDue && !push.streaming()) || catchUp;
+        return page == PAGE_JOURNEY && (pollDue || pushPending || (whole && intervalDue));
+    }
+
+    template <class Core>
+    bool failed(Core&) {
+        if (++failedPolls >= OFFLINE_AFTER_FAILURES) showOfflineTimetable();
+        return true;
+    }
+
+    template <class Core>
+    void polled(Core& core, bool full) {
+        failedPolls = 0;
+        if (full) otaConfirm();
+        // Once a (local) day, while the server is answering, see if it has a newer timetable, sprites or firmware
+        uint64_t nowMs = epochMs();
+        uint32_t today = nowMs ? (uint32_t)((nowMs / 1000 + NTP_OFFSET_SECONDS) / 86400) : 0;
+        if (core.drawn() && today && today != ttCheckedDay) { ttCheckedDay = today; updateTimetable(); updateSprites(); updateFirmware(); }
+    }
+
+    template <class Core>
+    void after(Core& core) {
+        if (core.drawn()) refreshPages();
+        // A page switch is timed to its last pixel; the cycle's work is done, so see its waveform out here, not after the next wake
+        if (pageSwitch.pressedMs && panel.busy()) panel.waitIdle();
+    }
+
+    template <class Core>
+    void idle(Core& core) {
+        if (pushPending && page == PAGE_JOURNEY && core.retry().ready(millis())) return;     // late zones from a commit go straight round again
+        armWakeups();
+        accountCycle();
+        wokeFor = wake.wait();
+    }
+};
+
+typedef FirmwareCore<ZoneTransport, ZoneDecoder, ZoneRefresh, ZoneExtras> ZoneCore;
+ZoneCore core(bbep, panel);
+
+void setup() { core.setup(); }
+void loop() { core.loop(); }
+
+// When a failed poll is tried again; opens after a run of them. For the host tests.
+const RetryPolicy& pollRetry() { return core.retry(); }
+
+static uint32_t msLeft(unsigned long since, unsigned long interval, unsigned long now) {
+    unsigned long elapsed = now - since;
+    return elapsed >= interval ? 0 : (uint32_t)(interval - elapsed);
+}
+
+// One timer per deadline the loop checks, so wait() sleeps until exactly the earliest
+void armWakeups() {
+    unsigned long now = millis();
+    // Zones are only drawn on the journey page; until it is back, the page timeout is the one deadline for them
+    bool journey = page == PAGE_JOURNEY;
+    // Before the first draw a poll is due as soon as the retry policy allows one
+    uint32_t pollIn = max(core.drawn() ? msLeft(core.lastPoll(), cadence.pollMs, now) : 0, core.retry().msUntilReady(now));
+    wake.arm(WAKE_POLL, journey && (!push.streaming() || !core.drawn()) && !staging.pending() ? pollIn : WAKE_NEVER);
+    // A full refresh also waits for the poll interval (see intervalDue)
+    uint32_t fullIn = partialCount >= cadence.partialsPerFull ? 0 : msLeft(lastFullRefresh, cadence.fullMs, now);
+    wake.arm(WAKE_FULL, !journey || staging.pending() ? WAKE_NEVER : max(fullIn, pollIn));
+    wake.arm(WAKE_PAGE, journey ? WAKE_NEVER : msLeft(pageShownAt, PAGE_RETURN_MS, now));
+
+    uint64_t nowMs = epochMs();
+    if (!nowMs) {
+        // No SNTP time yet: nothing to prefetch or commit; look again shortly
+        wake.arm(WAKE_COMMIT, WAKE_NEVER);
+        wake.arm(WAKE_PREFETCH, core.drawn() ? 5000 : WAKE_NEVER);
+    } else {
+        uint64_t at = (uint64_t)staging.applyAt() * 1000;
+        wake.arm(WAKE_COMMIT, !staging.pending() ? WAKE_NEVER : at > nowMs ? (uint32_t)(at - nowMs) : 0);
+        uint32_t boundary = (uint32_t)(nowMs / 60000 + 1) * 60;
+        uint64_t open = (uint64_t)(boundary - PREFETCH_LEAD_S) * 1000;
+        // This boundary's window is used or too close; aim for the next one
+        if (prefetchedFor == boundary || nowMs >= (uint64_t)(boundary - PREFETCH_MIN_LEAD_S) * 1000) open += 60000;
+        bool canPrefetch = core.drawn() && journey && staging.ready() && !staging.pending();
+        wake.arm(WAKE_PREFETCH, !canPrefetch ? WAKE_NEVER : open > nowMs ? (uint32_t)(open - nowMs) : 0);
     }
-    delay(1000);
+
+    int fd = pushSocket();
+    uint32_t pushIn = pushStarted ? push.msUntilDue() : WAKE_NEVER;
+    // Without a socket to watch, fall back to checking the stream every second
+    if (fd < 0 && push.state() == PUSH_STREAMING) pushIn = min(pushIn, (uint32_t)1000);
+    wake.arm(WAKE_PUSH_TIMER, pushIn);
+    wake.watch(fd);
+#if METRICS_ENABLED
+    wake.listen(metrics.fd());
+#endif
 }
 
-bool fetchChangedZoneList(bool forceAll, bool* changedFlags) {
-    WiFiClientSecure* client = new WiFiClientSecure(); if (!client) return false;
-    client->setInsecure();
+// Epoch milliseconds from the SNTP clock, 0 until the first sync
+uint64_t epochMs() {
+    struct timeval tv; gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < 1700000000) return 0;
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// Battery level from the PIN_BATTERY divider; a new level can move the cadence a tier
+void readBattery() {
+    uint32_t sum = 0;
+    for (int i = 0; i < BATTERY_SAMPLES; i++) sum += analogReadMilliVolts(PIN_BATTERY);
+    battery = batteryFromPin(sum / BATTERY_SAMPLES);
+    batteryReadAt = millis();
+    EnergyTier tier = energyTier(battery, energyLevel);
+    if (tier == energyLevel) return;
+    LOG_INFO("Energy: battery %u%% (%umV), cadence %s -> %s", battery.percent, battery.mv, energyTierName(energyLevel), energyTierName(tier));
+    energyLevel = tier;
+    cadence = energyCadence(tier);
+}
+
+// One request's handshake (on an https server), the bytes it brought in and how long it took
+void accountRequest(size_t bytes, unsigned long startMs) {
+    bool tls = strncmp(baseUrl(), "https", 5) == 0;
+    if (tls) { energy.tlsHandshake(); stats.handshakes++; }
+    energy.received(bytes);
+    stats.requests++;
+    stats.bytesFetched += bytes;
+    stats.requestSeconds.observe((uint32_t)(millis() - startMs));
+}
+
+// Range and If-Range for the part of a body not yet held
+void resumeHeaders(HTTPClient& http, NetResume& body) {
+    if (!body.resuming()) return;
+    http.addHeader("Range", body.range());
+    http.addHeader("If-Range", body.etag());
+}
+
+// Where this response's bytes go in the body, -1 if they can't be used (see NetResume::start)
+long startBody(HTTPClient& http, int httpCode, NetResume& body, size_t cap) {
+    return body.start(httpCode, http.getSize(), http.header("Content-Range").c_str(), http.header("ETag").c_str(),
+                      http.header("X-Body-CRC").c_str(), cap);
+}
+
+// How a resumable body went, for /metrics
+void accountBody(const NetResume& body, bool ok) {
+    stats.resumes += body.resumes();
+    stats.bytesRetransmitted += body.retransmitted();
+    if (body.complete() && !body.verified()) stats.crcFailures++;
+    if (ok && body.dropped()) stats.recoverSeconds.observe(body.recoverMs(millis()));
+}
+
+void startMetrics() {
+#if METRICS_ENABLED
+    if (metrics.fd() >= 0) return;
+    if (metrics.begin(METRICS_PORT)) LOG_INFO("Metrics: http://%s:%d/metrics", WiFi.localIP().toString().c_str(), METRICS_PORT);
+    else LOG_WARN("Metrics: can't listen on %d", METRICS_PORT);
+#endif
+}
+
+// Answer a scrape if one is waiting; gauges are read here so they are current as of it
+void serveMetrics() {
+#if METRICS_ENABLED
+    stats.uptimeS = millis() / 1000;
+    stats.partialRefreshes = panel.refreshCount(false);
+    stats.fullRefreshes = panel.refreshCount(true);
+    stats.heapFree = ESP.getFreeHeap();
+    stats.heapMinFree = ESP.getMinFreeHeap();
+    stats.heapLargestBlock = ESP.getMaxAllocHeap();
+    stats.consecutiveErrors = failedPolls;
+    stats.offline = offlineShown;
+    stats.pushStreaming = push.streaming();
+    stats.rssi = WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0;
+    stats.batteryMv = battery.external ? 0 : battery.mv;
+    stats.batteryPercent = battery.percent;
+    stats.energyTier = energyLevel;
+    if (metrics.poll(stats)) LOG_DEBUG("Metrics: scrape %lu", (unsigned long)metrics.scrapes());
+#endif
+}
+
+// Close the cycle's energy account before sleeping; once an hour, log where the charge went
+void accountCycle() {
+    energy.sample(wake.awakeUs(), wake.waitUs(), wake.idleMa(), panel.refreshCount(false), panel.refreshCount(true));
+    float mAh = energy.endCycle();    // not inside LOG_DEBUG: that compiles out with its arguments
+    LOG_DEBUG("Energy: cycle %.3f mAh", mAh);
+    (void)mAh;
+    unsigned long now = millis();
+    if (!energy.hourDue(now)) return;
+    const EnergyBreakdown& h = energy.hour();
+    LOG_INFO("Energy: %.2f mAh in %lus (awake %.2f idle %.2f tls %.2f/%lu rx %.2f/%luKB panel %.2f/%lu+%lu); battery %u%% %umV %s, %.0fh left",
+             h.mAh(), (unsigned long)(energy.hourMs(now) / 1000), h.awake / 3600, h.idle / 3600, h.tls / 3600, (unsigned long)h.handshakes,
+             h.rx / 3600, (unsigned long)(h.bytes / 1024), h.panel / 3600, (unsigned long)h.partial, (unsigned long)h.full,
+             battery.percent, battery.mv, battery.external ? "external" : energyTierName(energyLevel), energy.hoursLeft(battery.percent, now));
+    energy.nextHour(now);
+}
+
+void prefetchFrame(uint32_t applyAt) {
+    // Everything has to be staged before the boundary; what isn't by then is fetched live after it
+    uint64_t nowMs = epochMs(), atMs = (uint64_t)applyAt * 1000;
+    NetDeadline cycle(atMs > nowMs ? (uint32_t)(atMs - nowMs) : 0);
+    bool changedFlags[ZONE_COUNT] = {false};
+    if (!fetchChangedZoneList(false, changedFlags, cycle, applyAt)) return;
+    staging.open(applyAt);
+    int staged = 0, late = 0;
+    for (int i = 0; i < ZONE_COUNT; i++) {
+        if (!changedFlags[i]) continue;
+        size_t room; uint8_t* dst = staging.reserve(room);
+        int16_t g[4];
+        int len = room && !cycle.expired() ? fetchZoneBmp(ZONES[i], applyAt, dst, room, g, cycle) : 0;
+        if (len > 0 && staging.commit(i, g[0], g[1], g[2], g[3], len)) staged++;
+        else { lateChanged[i] = true; late++; }
+        yield();
+    }
+    LOG_INFO("Prefetch @%lu: %d staged (%u bytes), %d late", (unsigned long)applyAt, staged, (unsigned)staging.used(), late);
+}
+
+TileSurface screenSurface() { TileSurface s = { bbep.getBuffer(), Panel::PITCH, SCREEN_W, SCREEN_H }; return s; }
+
+void resetTileHashes() {
+    for (int i = 0; i < ZONE_COUNT; i++) if (tileHashes[i]) memset(tileHashes[i], 0, tileHashCount[i] * sizeof(uint32_t));
+}
+
+void drawStagedZone(const StagedZone& sz, const uint8_t* bmp, void* ctx) {
+    // A zone where the layout puts it goes straight into the buffer on its
+    // precomputed spans; anything else (server on another layout) through the
+    // panel's word blit, and only a BMP neither takes through loadBMP
+    const ZoneDef& z = ZONES[sz.zone];
+    bool home = sz.x == z.x && sz.y == z.y && sz.w == z.w && sz.h == z.h, drawn;
+    {
+        PROFILE_SCOPE(PROF_BLIT);
+        drawn = (home && layoutBlitBmp(bbep.getBuffer(), DASH_PITCH, DASH_LAYOUT[sz.zone], bmp, sz.len))
+                || panelBlitBmp<Panel>(bbep.getBuffer(), sz.x, sz.y, bmp, sz.len)
+                || bbep.loadBMP((uint8_t*)bmp, sz.x, sz.y, BBEP_BLACK, BBEP_WHITE) == BBEP_SUCCESS;
+    }
+    if (!drawn) return;
+    (*(int*)ctx)++;
+    // Drawn from a whole BMP, so re-derive what the zone's tiles now hold
+    if (tileHashes[sz.zone]) tileHashRegion(screenSurface(), sz.x, sz.y, sz.w, sz.h, tileHashes[sz.zone], tileHashCount[sz.zone]);
+}
+
+void commitStagedFrame() {
+    int drawn = 0;
+    staging.forEach(drawStagedZone, &drawn);
+    if (drawn > 0) { panel.refresh(REFRESH_PARTIAL); partialCount++; }
+    long skewMs = (long)(epochMs() - (uint64_t)staging.applyAt() * 1000);
+    LOG_INFO("Commit @%lu: %d zones, +%ldms", (unsigned long)staging.applyAt(), drawn, skewMs);
+    staging.clear();
+    // Anything that missed the arena goes through the normal fetch-and-draw path now
+    for (int i = 0; i < ZONE_COUNT; i++) {
+        if (lateChanged[i]) { pushChanged[i] = true; pushPending = true; lateChanged[i] = false; }
+    }
+}
+
+// Button to pixels: from the press to the end of the new page's waveform
+void onPageDrawn(int mode, uint32_t elapsedMs, void* ctx) {
+    if (!pageSwitch.pressedMs) return;
+    uint32_t toPanel = pageSwitch.drawnMs - pageSwitch.pressedMs, total = toPanel + elapsedMs;
+    pageSwitch.pressedMs = 0;
+    stats.buttonSeconds.observe(total);
+    LOG_INFO("Page %s: %lums to the panel, %lums to pixels (%s)", PAGES[pageSwitch.page].id, (unsigned long)toPanel,
+             (unsigned long)total, pageSwitch.cached ? "cached" : "fetched");
+}
+
+// Put a page on the panel. Server pages come out of the cache; the journey page is
+// packed on its way off and unpacked on its way back, so its tile hashes stay good.
+// pressedMs is the button press behind it, 0 for the timeout back to the journey.
+bool showPage(uint8_t next, uint32_t pressedMs) {
+    if (next == page) return false;
+    uint8_t* fb = bbep.getBuffer();
+    bool cached = next == PAGE_JOURNEY || pages.held(next);
+    // Not held (no memory, too big, never fetched): the one case with a request before the pixels
+    if (!cached && (!core.wifi() || fetchPage(next, NetDeadline(NET_CYCLE_MS)) <= 0)) {
+        LOG_WARN("Page %s: not available", PAGES[next].id);
+        stats.pageMisses++;
+        return false;
+    }
+    if (page == PAGE_JOURNEY) {
+        if (!pages.store(PAGE_JOURNEY, fb)) LOG_WARN("Pages: journey page doesn't fit, redrawn on return");
+        // Zones are drawn on the journey page only; a staged frame goes round again once it is back
+        if (staging.pending()) {
+            staging.forEach([](const StagedZone& sz, const uint8_t*, void*) { pushChanged[sz.zone] = true; }, nullptr);
+            for (int i = 0; i < ZONE_COUNT; i++) { if (lateChanged[i]) pushChanged[i] = true; lateChanged[i] = false; }
+            pushPending = true;
+            staging.clear();
+        }
+    }
+    if (next != PAGE_JOURNEY) pages.show(next, fb);
+    else if (!pages.show(PAGE_JOURNEY, fb)) {
+        // Not held: start it from white and let the next cycle redraw all of it
+        memset(fb, 0xFF, (size_t)Panel::PITCH * SCREEN_H);
+        resetTileHashes();
+        core.redraw();
+    }
+    page = next;
+    pageShownAt = millis();
+    pageSwitch.page = next; pageSwitch.cached = cached; pageSwitch.pressedMs = pressedMs; pageSwitch.drawnMs = pageShownAt;
+    panel.refresh(REFRESH_PARTIAL, onPageDrawn, nullptr);
+    partialCount++;
+    stats.pageSwitches++;
+    // Polling rather than pushed, a server page may have moved on since it was fetched; look now it is up
+    if (next != PAGE_JOURNEY && !push.streaming()) pageStale[next] = true;
+    return true;
+}
+
+// A server page into its cache slot; If-None-Match keeps one that hasn't changed, and a body cut
+// short is resumed. Returns 1 for a new page, 0 if the server had none for us, -1 if it didn't answer.
+int fetchPage(int p, const NetDeadline& cycle) {
+    String url = String(baseUrl()) + "/api/page/" + PAGES[p].id; url.replace("//api", "/api");
+    char etag[16]; snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)pages.crc(p));
+    NetResume body;
+    for (;;) {
+        unsigned long t0 = millis();
+        WiFiClient* client = newClient(); if (!client) return -1;
+        HTTPClient http;
+        netArm(http, cycle);
+        const char* hk[] = {"Content-Range", "ETag", "X-Body-CRC"};
+        http.collectHeaders(hk, 3);
+        if (!http.begin(*client, url)) { delete client; return -1; }
+        http.addHeader("User-Agent", "PTV-TRMNL/" FIRMWARE_VERSION);
+        http.addHeader("X-Layout", DASHBOARD_LAYOUT_TAG);
+        if (pages.crc(p)) http.addHeader("If-None-Match", etag);    // 0 once reserved: a resume
+        resumeHeaders(http, body);
+        bool resuming = body.resuming();
+        int httpCode = http.GET();
+        long at = startBody(http, httpCode, body, pages.slotSize());
+        uint8_t* dst = at >= 0 ? pages.reserve(p, body.total()) : nullptr;
+        if (!dst) {
+            int len = http.getSize();
+            if (httpCode == 200) { pages.drop(p); LOG_WARN("Page %s: %d bytes, slots hold %u", PAGES[p].id, len, (unsigned)pages.slotSize()); }
+            else if (httpCode != 304) LOG_WARN("Page %s: HTTP %d", PAGES[p].id, httpCode);
+            http.end(); delete client; accountRequest(0, t0); accountBody(body, false);
+            // Answered, just not with a page to keep (unchanged, too big, none on this server): left until named again
+            return httpCode > 0 && !resuming ? 0 : -1;
+        }
+        NetReader<WiFiClient> rd(*http.getStreamPtr(), cycle);
+        body.advance(dst + at, rd.readFully(dst + at, body.want()));
+        http.end(); delete client;
+        accountRequest(rd.bytes(), t0);
+        if (body.complete()) break;
+        bool again = body.retry(rd.status(), millis()) && !cycle.expired();
+        LOG_WARN("Page %s: %s at %u/%u bytes%s", PAGES[p].id, netStatusName(rd.status()), (unsigned)body.got(), (unsigned)body.total(),
+                 again ? ", resuming" : "");
+        if (!again) { accountBody(body, false); return -1; }
+    }
+    accountBody(body, body.verified());
+    if (!body.verified()) { LOG_WARN("Page %s: fails its CRC (%u bytes)", PAGES[p].id, (unsigned)body.total()); return -1; }
+    if (!pages.commit(p, body.total())) { LOG_WARN("Page %s: malformed (%u bytes)", PAGES[p].id, (unsigned)body.total()); return 0; }
+    LOG_DEBUG("Page %s: %u bytes, crc %08lx, %d resumed", PAGES[p].id, (unsigned)body.total(), (unsigned long)pages.crc(p), body.resumes());
+    return 1;
+}
+
+// Server pages whose data changed, fetched after the zones while nobody is waiting on them
+void refreshPages() {
+    if (!pages.ready()) return;
+    NetDeadline cycle(NET_CYCLE_MS);
+    for (int p = PAGE_JOURNEY + 1; p < PAGE_COUNT; p++) {
+        if (!pageStale[p] || cycle.expired()) continue;
+        int r = fetchPage(p, cycle);
+        if (r < 0) continue;    // still stale, tried again after the next cycle
+        pageStale[p] = false;
+        // The page on the panel follows its data, as a zone does
+        if (r > 0 && p == page && pages.show(p, bbep.getBuffer())) { panel.refresh(REFRESH_PARTIAL); partialCount++; }
+    }
+}
+
+bool fetchChangedZoneList(bool forceAll, bool* changedFlags, const NetDeadline& cycle, uint32_t applyAt) {
+    unsigned long t0 = millis();
+    WiFiClient* client = newClient(); if (!client) return false;
     HTTPClient http;
-    String url = String(serverUrl) + "/api/zones?plain=1"; if (forceAll) url += "&force=true";
+    String url = String(baseUrl()) + "/api/zones?plain=1"; if (forceAll) url += "&force=true";
+    if (applyAt) { url += "&at="; url += applyAt; }
     url.replace("//api", "/api");
-    http.setTimeout(10000); if (!http.begin(*client, url)) { delete client; return false; }
+    netArm(http, cycle);
+    const char* hk[] = {"Transfer-Encoding"};
+    http.collectHeaders(hk, 1);
+    if (!http.begin(*client, url)) { delete client; return false; }
     http.addHeader("User-Agent", "PTV-TRMNL/" FIRMWARE_VERSION);
     int httpCode = http.GET();
     if (httpCode != 200) { http.end(); delete client; return false; }
-    String payload = http.getString(); Serial.printf("Zones: %s\n", payload.c_str()); http.end(); delete client;
-    // Simple CSV parsing: time,weather,trains,trams,coffee,footer
-    int pos = 0;
-    while (pos < (int)payload.length()) {
-        int comma = payload.indexOf(',', pos);
-        if (comma < 0) comma = payload.length();
-        String zid = payload.substring(pos, comma);
-        zid.trim();
-        for (int i = 0; i < ZONE_COUNT; i++) {
-            if (zid.equals(ZONES[i].id)) { changedFlags[i] = true; break; }
-        }
-        pos = comma + 1;
+    // Simple CSV parsing: time,weather,trains,trams,coffee,footer. A list that
+    // doesn't fit fails the poll rather than lose the ids past the end.
+    char list[160]; int len = http.getSize(); size_t got = 0; bool ok;
+    NetReader<WiFiClient> rd(*http.getStreamPtr(), cycle);
+    if (len >= 0) ok = len < (int)sizeof(list) && (got = rd.readFully((uint8_t*)list, len)) == (size_t)len;
+    else ok = netReadUnsized(rd, http.header("Transfer-Encoding").equalsIgnoreCase("chunked"), (uint8_t*)list, sizeof(list) - 1, got);
+    accountRequest(rd.bytes(), t0);
+    http.end(); delete client;
+    if (!ok) {
+        LOG_WARN("Zones: list %s after %u bytes (%d, room for %u)", netStatusName(rd.status()), (unsigned)got, len, (unsigned)sizeof(list) - 1);
+        return false;
     }
-    Serial.println("Zones parsed");
+    list[got] = '\0'; LOG_DEBUG("Zones: %s", list);
+    { PROFILE_SCOPE(PROF_LIST_PARSE); parseZoneList(list, got, ZONES, ZONE_COUNT, changedFlags); }
+    LOG_VERBOSE("Zones parsed");
     return true;
 }
 
-bool fetchAndDrawZone(const ZoneDef& zone, bool doFlash) {
-    WiFiClientSecure* client = new WiFiClientSecure(); if (!client) return false;
-    client->setInsecure();
+// Where requests go: the LAN relay while one is answering, otherwise the configured server
+const char* baseUrl() {
+#if EDGE_ENABLED
+    return edge.url(core.server());
+#else
+    return core.server();
+#endif
+}
+
+// A client for baseUrl(): TLS to the server, plain HTTP to a relay (or an http:// server)
+WiFiClient* newClient() {
+    if (strncmp(baseUrl(), "https", 5) != 0) return new WiFiClient();
+    WiFiClientSecure* tls = new WiFiClientSecure(); if (tls) tls->setInsecure();
+    return tls;
+}
+
+// Look for a relay of this server on the LAN; the push channel follows a change of base URL
+void discoverEdge() {
+#if EDGE_ENABLED
+    const char* server = core.server();
+    if (!server[0]) return;
+    if (!mdnsStarted) mdnsStarted = MDNS.begin("ptv-trmnl");
+    if (!mdnsStarted) { LOG_WARN("Edge: mDNS unavailable, %s direct", server); return; }
+    bool was = edge.active();
+    if (edge.discover(MDNS, server, millis())) LOG_INFO("Edge: relay at %s", edge.url(server));
+    else LOG_DEBUG("Edge: no relay, %s direct", server);
+    if (edge.active() != was) { push.stop(); pushStarted = false; }
+#endif
+}
+
+void startPush() {
+    ServerEndpoint ep;
+    pushStarted = true;
+    if (!parseServerUrl(baseUrl(), ep)) { LOG_WARN("Push: bad server URL, polling only"); return; }
+    pushTls.setInsecure();
+    pushUsesTls = ep.tls;
+    push.begin(ep.tls ? (Client&)pushTls : (Client&)pushPlain, ep, "PTV-TRMNL/" FIRMWARE_VERSION);
+}
+
+void onZonePush(const ZonePushEvent& ev, void* ctx) {
+    LOG_INFO("Push v%lu: %.*s", (unsigned long)ev.version, (int)ev.zonesLen, ev.zones);
+    if (parseZoneList(ev.zones, ev.zonesLen, ZONES, ZONE_COUNT, pushChanged) > 0) pushPending = true;
+    // Server pages are named in the same list; they are refetched after the zones
+    parseZoneList(ev.zones, ev.zonesLen, PAGES, PAGE_COUNT, pageStale);
+}
+
+// Fetch one zone BMP into buf (rendered as of applyAt when non-zero). Returns its length, 0 on failure.
+// A body cut short is picked up where it stopped, as long as the cycle has time left.
+int fetchZoneBmp(const ZoneDef& zone, uint32_t applyAt, uint8_t* buf, size_t cap, int16_t* geom, const NetDeadline& cycle) {
+    String url = String(baseUrl()) + "/api/zone/" + zone.id; url.replace("//api", "/api");
+    if (applyAt) { url += "?at="; url += applyAt; }
+    NetResume body;
+    for (;;) {
+        unsigned long t0 = millis();
+        WiFiClient* client = newClient(); if (!client) return 0;
+        HTTPClient http;
+        netArm(http, cycle);
+        const char* hk[] = {"X-Zone-X", "X-Zone-Y", "X-Zone-Width", "X-Zone-Height", "Content-Range", "ETag", "X-Body-CRC"};
+        http.collectHeaders(hk, 7);
+        if (!http.begin(*client, url)) { delete client; return 0; }
+        http.addHeader("User-Agent", "PTV-TRMNL/" FIRMWARE_VERSION);
+        http.addHeader("Accept", "application/octet-stream");
+        http.addHeader("X-Layout", DASHBOARD_LAYOUT_TAG);
+        resumeHeaders(http, body);
+        int httpCode = http.GET();
+        long at = startBody(http, httpCode, body, cap);
+        if (at < 0) { http.end(); delete client; accountBody(body, false); return 0; }
+        geom[0] = http.hasHeader("X-Zone-X") ? http.header("X-Zone-X").toInt() : zone.x;
+        geom[1] = http.hasHeader("X-Zone-Y") ? http.header("X-Zone-Y").toInt() : zone.y;
+        geom[2] = http.hasHeader("X-Zone-Width") ? http.header("X-Zone-Width").toInt() : zone.w;
+        geom[3] = http.hasHeader("X-Zone-Height") ? http.header("X-Zone-Height").toInt() : zone.h;
+        NetReader<WiFiClient> rd(*http.getStreamPtr(), cycle);
+        body.advance(buf + at, rd.readFully(buf + at, body.want()));
+        http.end(); delete client;
+        accountRequest(rd.bytes(), t0);
+        if (body.complete()) break;
+        bool again = body.retry(rd.status(), millis()) && !cycle.expired();
+        LOG_WARN("Zone %s: BMP %s at %u/%u bytes%s", zone.id, netStatusName(rd.status()), (unsigned)body.got(), (unsigned)body.total(),
+                 again ? ", resuming" : "");
+        if (!again) { accountBody(body, false); return 0; }
+    }
+    bool ok = body.verified() && buf[0] == 'B' && buf[1] == 'M';
+    accountBody(body, ok);
+    if (!body.verified()) LOG_WARN("Zone %s: BMP fails its CRC (%u bytes, %d resumed)", zone.id, (unsigned)body.total(), body.resumes());
+    return ok ? (int)body.total() : 0;
+}
+
+// Stream only the tiles that differ from what the zone holds straight into the framebuffer.
+// Returns the number of tiles applied (0 = nothing changed), -1 on failure.
+int fetchZoneTiles(int zi, bool doFlash, const NetDeadline& cycle, bool resync) {
+    const ZoneDef& zone = ZONES[zi];
+    unsigned long t0 = millis();
+    WiFiClient* client = newClient(); if (!client) return -1;
     HTTPClient http;
-    String url = String(serverUrl) + "/api/zonedata?id=" + zone.id; url.replace("//api", "/api");
-    http.setTimeout(15000);
-    const char* hk[] = {"X-Zone-X", "X-Zone-Y", "X-Zone-Width", "X-Zone-Height"};
-    http.collectHeaders(hk, 4);
-    if (!http.begin(*client, url)) { delete client; return false; }
+    String url = String(baseUrl()) + "/api/zone/" + zone.id + "/tiles"; url.replace("//api", "/api");
+    netArm(http, cycle);
+    if (!http.begin(*client, url)) { delete client; return -1; }
     http.addHeader("User-Agent", "PTV-TRMNL/" FIRMWARE_VERSION);
-    http.addHeader("Accept", "application/octet-stream");
-    int httpCode = http.GET();
-    if (httpCode != 200) { http.end(); delete client; return false; }
-    int zX = zone.x, zY = zone.y, zW = zone.w, zH = zone.h;
-    if (http.hasHeader("X-Zone-X")) zX = http.header("X-Zone-X").toInt();
-    if (http.hasHeader("X-Zone-Y")) zY = http.header("X-Zone-Y").toInt();
-    if (http.hasHeader("X-Zone-Width")) zW = http.header("X-Zone-Width").toInt();
-    if (http.hasHeader("X-Zone-Height")) zH = http.header("X-Zone-Height").toInt();
-    int len = http.getSize();
-    if (len <= 0 || len > ZONE_BUFFER_SIZE) { http.end(); delete client; return false; }
-    WiFiClient* stream = http.getStreamPtr();
-    int read = 0; unsigned long timeout = millis() + 10000;
-    while (read < len && millis() < timeout) {
-        if (stream->available()) { int r = stream->readBytes(zoneBuffer + read, min((int)stream->available(), len - read)); read += r; }
-        yield();
+    http.addHeader("Content-Type", "application/octet-stream");
+    if (sprites.valid()) http.addHeader("X-Sprites", String((unsigned long)sprites.version()));
+    http.addHeader("X-Layout", DASHBOARD_LAYOUT_TAG);
+    int httpCode = http.POST((uint8_t*)tileHashes[zi], tileHashCount[zi] * sizeof(uint32_t));
+    if (httpCode != 200) { http.end(); delete client; return -1; }
+    TileSurface fb = screenSurface();
+    NetReader<WiFiClient> rd(*http.getStreamPtr(), cycle);
+    uint8_t chunk[256];
+    // Holding the sprite dictionary, the zone may come as a draw list ('ZD') rather than tiles ('ZT')
+    int r = (int)rd.readFully(chunk, 2);
+    if (r == 2 && chunk[0] == 'Z' && chunk[1] == 'D') {
+        DrawListDecoder dl; dl.begin(fb, sprites);
+        dl.feed(chunk, r);
+        while (!dl.done() && !dl.error()) {
+            r = rd.read(chunk, sizeof(chunk));
+            if (r <= 0) break;
+            dl.feed(chunk, r);
+        }
+        http.end(); delete client;
+        accountRequest(rd.bytes(), t0);
+        return applyDrawList(zi, dl, rd, doFlash);
+    }
+    TileStreamDecoder dec; dec.begin(fb, tileHashes[zi], tileHashCount[zi]);
+    PROFILE_LAP(decodeLap);
+    if (r > 0) PROFILE_LAP_RUN(decodeLap, dec.feed(chunk, r));
+    while (!dec.done() && !dec.error()) {
+        r = rd.read(chunk, sizeof(chunk));
+        if (r <= 0) break;
+        PROFILE_LAP_RUN(decodeLap, dec.feed(chunk, r));
     }
+    PROFILE_LAP_END(decodeLap, PROF_TILES);
     http.end(); delete client;
-    if (read != len || zoneBuffer[0] != 'B' || zoneBuffer[1] != 'M') return false;
-    if (doFlash) { bbep.fillRect(zX, zY, zW, zH, BBEP_BLACK); bbep.refresh(REFRESH_PARTIAL, true); delay(30); }
-    Serial.printf("Drawing zone at %d,%d (%dx%d)\n", zX, zY, zW, zH); bool ok = bbep.loadBMP(zoneBuffer, zX, zY, BBEP_BLACK, BBEP_WHITE) == BBEP_SUCCESS; Serial.printf("loadBMP result: %s\n", ok ? "OK" : "FAIL"); return ok;
+    accountRequest(rd.bytes(), t0);
+    if (!dec.done()) {
+        // Part of the zone may have been written; nothing it holds can be trusted now
+        if (tileHashes[zi]) memset(tileHashes[zi], 0, tileHashCount[zi] * sizeof(uint32_t));
+        LOG_WARN("Zone %s: tile stream %s after %u bytes", zone.id, dec.error() ? "malformed" : netStatusName(rd.status()), (unsigned)rd.bytes());
+        return -1;
+    }
+    LOG_DEBUG("Zone %s: %d/%d tiles, %lu bytes", zone.id, dec.applied(), dec.tiles(), (unsigned long)dec.bytes());
+    // A delta landed on a tile we don't hold; those hashes are now 0 so the server resends them whole
+    if (dec.mismatches() > 0 && !resync) {
+        LOG_WARN("Zone %s: %d tiles out of sync, resyncing", zone.id, dec.mismatches());
+        int again = fetchZoneTiles(zi, doFlash, cycle, true);
+        return again < 0 ? again : dec.applied() + again;
+    }
+    // Anti-ghosting flash by inverting the changed area and back: unlike a black fill
+    // it is reversible, so the framebuffer still matches the tile hashes afterwards
+    int x, y, w, h;
+    if (doFlash && dec.dirtyRect(x, y, w, h)) { PROFILE_SCOPE(PROF_FLASH); panelInvert<Panel>(fb.fb, x, y, w, h); panel.refresh(REFRESH_PARTIAL); panelInvert<Panel>(fb.fb, x, y, w, h); }
+    return dec.applied();
 }
 
-void initDisplay() {
-    bbep.initIO(EPD_DC_PIN, EPD_RST_PIN, EPD_BUSY_PIN, EPD_CS_PIN, EPD_MOSI_PIN, EPD_SCK_PIN, 8000000);
-    bbep.setPanelType(EP75_800x480); bbep.setRotation(0); bbep.allocBuffer(false);
-    pinMode(PIN_INTERRUPT, INPUT_PULLUP);
+// Finish a zone that arrived as a draw list. Returns the ops applied, -1 on failure.
+int applyDrawList(int zi, DrawListDecoder& dl, NetReader<WiFiClient>& rd, bool doFlash) {
+    const ZoneDef& zone = ZONES[zi];
+    if (!dl.done()) {
+        if (tileHashes[zi]) memset(tileHashes[zi], 0, tileHashCount[zi] * sizeof(uint32_t));
+        LOG_WARN("Zone %s: draw list %s after %u bytes", zone.id,
+                 dl.staleDict() ? "for other sprites" : dl.error() ? "malformed" : netStatusName(rd.status()), (unsigned)rd.bytes());
+        return -1;
+    }
+    LOG_DEBUG("Zone %s: draw list, %d ops (%d sprites), %lu bytes", zone.id, dl.applied(), dl.sprites(), (unsigned long)dl.bytes());
+    // The list redraws the whole zone, so the tile hashes are whatever the framebuffer now holds
+    TileSurface fb = screenSurface();
+    if (tileHashes[zi]) tileHashRegion(fb, dl.x(), dl.y(), dl.w(), dl.h(), tileHashes[zi], tileHashCount[zi]);
+    int x, y, w, h;
+    if (doFlash && dl.dirtyRect(x, y, w, h)) { PROFILE_SCOPE(PROF_FLASH); panelInvert<Panel>(fb.fb, x, y, w, h); panel.refresh(REFRESH_PARTIAL); panelInvert<Panel>(fb.fb, x, y, w, h); }
+    return dl.applied();
 }
 
-void showWelcomeScreen() {
-    bbep.fillScreen(BBEP_WHITE); bbep.setFont(FONT_8x8); bbep.setTextColor(BBEP_BLACK, BBEP_WHITE);
-    bbep.setCursor(200, 100); bbep.printf("PTV-TRMNL v%s", FIRMWARE_VERSION);
-    bbep.setCursor(200, 140); bbep.print("Connect to WiFi: PTV-TRMNL-Setup");
-    bbep.setCursor(200, 160); bbep.print("Open: 192.168.4.1");
-    bbep.setCursor(200, 420); bbep.print("(c) 2026 Angus Bergman");
-    bbep.refresh(REFRESH_FULL, true); lastFullRefresh = millis();
+// Map the timetable partition and check the image in it (CRC over the whole image)
+void mapTimetable() {
+    if (ttMap) { spi_flash_munmap(ttMap); ttMap = 0; }
+    timetable.open(nullptr, 0);
+    if (!ttPart) ttPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)TT_PARTITION_SUBTYPE, "timetable");
+    if (!ttPart) { LOG_INFO("Timetable: no partition"); return; }
+    const void* p = nullptr;
+    if (esp_partition_mmap(ttPart, 0, ttPart->size, SPI_FLASH_MMAP_DATA, &p, &ttMap) != ESP_OK) { ttMap = 0; LOG_WARN("Timetable: mmap failed"); return; }
+    if (timetable.open((const uint8_t*)p, ttPart->size))
+        LOG_INFO("Timetable: %d stops, %d days from day %lu, %lu bytes", timetable.stopCount(), timetable.dayCount(),
+                 (unsigned long)timetable.firstDay(), (unsigned long)timetable.size());
+    else LOG_INFO("Timetable: partition holds no valid image");
 }
 
-void doFullRefresh() { bbep.refresh(REFRESH_FULL, true); }
-void loadSettings() { preferences.begin("ptv-trmnl", true); String url = preferences.getString("serverUrl", ""); url.toCharArray(serverUrl, sizeof(serverUrl)); preferences.end(); }
-void saveSettings() { preferences.begin("ptv-trmnl", false); preferences.putString("serverUrl", serverUrl); preferences.end(); }
-void saveParamCallback() { strncpy(serverUrl, customServerUrl.getValue(), sizeof(serverUrl) - 1); saveSettings(); }
-void connectWiFi() {
-    WiFiManager wm; wm.setConfigPortalTimeout(180);
-    customServerUrl.setValue(serverUrl, 120); wm.addParameter(&customServerUrl); wm.setSaveParamsCallback(saveParamCallback);
-    if (wm.autoConnect("PTV-TRMNL-Setup")) { wifiConnected = true; } else { wifiConnected = false; }
+// Pull a newer image from the server straight into a data partition. The server
+// answers 304 while our CRC (its ETag) is current; 404 if it has none. release()
+// drops the mapping of the old image before the erase. A body cut short is resumed
+// from the bytes already in flash. True if the partition was rewritten.
+bool pullPartitionImage(const esp_partition_t* part, const char* path, const char* what, bool haveImage, uint32_t crc, size_t minLen, void (*release)()) {
+    String url = String(baseUrl()) + path; url.replace("//api", "/api");
+    // Its own budget: a daily download may take longer than a poll cycle
+    NetDeadline budget(NET_CONNECT_MS + NET_TTFB_MS + TT_DOWNLOAD_MS);
+    char etag[16]; snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)crc);
+    NetResume body;
+    bool erased = false;
+    esp_err_t err = ESP_OK;
+    for (;;) {
+        unsigned long t0 = millis();
+        WiFiClient* client = newClient(); if (!client) return erased;
+        HTTPClient http;
+        netArm(http, budget);
+        const char* hk[] = {"Content-Range", "ETag", "X-Body-CRC"};
+        http.collectHeaders(hk, 3);
+        if (!http.begin(*client, url)) { delete client; return erased; }
+        http.addHeader("User-Agent", "PTV-TRMNL/" FIRMWARE_VERSION);
+        if (haveImage && !erased) http.addHeader("If-None-Match", etag);
+        resumeHeaders(http, body);
+        int httpCode = http.GET();
+        long at = startBody(http, httpCode, body, part->size);
+        if (at < 0 || body.total() < minLen) {
+            if (erased) LOG_WARN("%s: resume refused (HTTP %d) at %u/%u bytes", what, httpCode, (unsigned)body.got(), (unsigned)body.total());
+            else if (httpCode != 304) LOG_INFO("%s: HTTP %d, %d bytes; keeping current", what, httpCode, http.getSize());
+            http.end(); delete client; accountRequest(0, t0); accountBody(body, false);
+            return erased;
+        }
+        if (at == 0) {
+            // Unmap first so the flash cache can't serve pages from the old image
+            if (!erased) release();
+            erased = true;
+            err = esp_partition_erase_range(part, 0, (body.total() + 4095) & ~(size_t)4095);
+        }
+        NetReader<WiFiClient> rd(*http.getStreamPtr(), budget, TT_DOWNLOAD_MS);
+        uint8_t chunk[512];
+        while (err == ESP_OK && !body.complete()) {
+            int r = rd.read(chunk, body.want() < sizeof(chunk) ? body.want() : sizeof(chunk));
+            if (r <= 0) break;
+            err = esp_partition_write(part, body.got(), chunk, r);
+            body.advance(chunk, r);
+        }
+        http.end(); delete client;
+        accountRequest(rd.bytes(), t0);
+        if (body.complete() || err != ESP_OK) break;
+        bool again = body.retry(rd.status(), millis()) && !budget.expired();
+        LOG_WARN("%s: download %s at %u/%u bytes%s", what, netStatusName(rd.status()), (unsigned)body.got(), (unsigned)body.total(),
+                 again ? ", resuming" : "");
+        if (!again) break;
+    }
+    accountBody(body, err == ESP_OK && body.verified());
+    if (err != ESP_OK) LOG_WARN("%s: flash write failed at %u/%u bytes (%d)", what, (unsigned)body.got(), (unsigned)body.total(), (int)err);
+    else if (body.complete() && !body.verified()) LOG_WARN("%s: download fails its CRC (%u bytes)", what, (unsigned)body.total());
+    return true;
 }
+
+void updateTimetable() {
+    if (!ttPart) return;
+    auto release = []() { if (ttMap) { spi_flash_munmap(ttMap); ttMap = 0; } timetable.open(nullptr, 0); };
+    if (pullPartitionImage(ttPart, "/api/timetable.bin", "Timetable", timetable.valid(), timetable.crc(), sizeof(TtHeader), release))
+        mapTimetable();    // the CRC check decides whether the new image took
+}
+
+// Map the sprites partition; without a valid dictionary zones just come as tiles
+void mapSprites() {
+    if (spriteMap) { spi_flash_munmap(spriteMap); spriteMap = 0; }
+    sprites.open(nullptr, 0);
+    if (!spritePart) spritePart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)SPRITE_PARTITION_SUBTYPE, "sprites");
+    if (!spritePart) { LOG_INFO("Sprites: no partition"); return; }
+    const void* p = nullptr;
+    if (esp_partition_mmap(spritePart, 0, spritePart->size, SPI_FLASH_MMAP_DATA, &p, &spriteMap) != ESP_OK) { spriteMap = 0; LOG_WARN("Sprites: mmap failed"); return; }
+    if (sprites.open((const uint8_t*)p, spritePart->size))
+        LOG_INFO("Sprites: version %lu, %d sprites, %lu bytes", (unsigned long)sprites.version(), sprites.count(), (unsigned long)sprites.size());
+    else LOG_INFO("Sprites: partition holds no valid dictionary");
+}
+
+void updateSprites() {
+    if (!spritePart) return;
+    auto release = []() { if (spriteMap) { spi_flash_munmap(spriteMap); spriteMap = 0; } sprites.open(nullptr, 0); };
+    if (pullPartitionImage(spritePart, "/api/sprites.bin", "Sprites", sprites.valid(), sprites.crc(), sizeof(SpriteDictHeader), release))
+        mapSprites();
+}
+
+// Delta OTA: the patch reads the running app partition and writes the other one
+struct OtaFlash {
+    const esp_partition_t* running;
+    esp_ota_handle_t handle;
+    bool readOld(uint32_t off, uint8_t* buf, size_t n) { return esp_partition_read(running, off, buf, n) == ESP_OK; }
+    bool writeNew(const uint8_t* buf, size_t n) { return esp_ota_write(handle, buf, n) == ESP_OK; }
+};
+
+// Arduino core: leave a freshly updated image pending verification until otaConfirm()
+bool verifyRollbackLater() { return true; }
+
+// A new image counts its boots until it has drawn from the server once. If it
+// keeps crashing or hanging before that, boot the previous one again.
+void otaBootCheck() {
+    preferences.begin("ota", false);
+    uint8_t tries = preferences.getUChar("tries", 0);
+    if (tries > OTA_MAX_BOOT_TRIES) {
+        // Remembered so the daily check doesn't flash the same release straight back
+        String rejected = preferences.getString("pending");
+        preferences.putUChar("tries", 0);
+        preferences.putString("rejected", rejected);
+        preferences.end();
+        LOG_ERROR("OTA: v%s (%s) failed %d boots, rolling back", FIRMWARE_VERSION, rejected.c_str(), tries);
+        logDrain(Serial);
+        // The bootloader's rollback if it was built with it, else point otadata at the other slot
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+        const esp_partition_t* prev = esp_ota_get_next_update_partition(nullptr);
+        if (prev && esp_ota_set_boot_partition(prev) == ESP_OK) esp_restart();
+        LOG_ERROR("OTA: no image to roll back to");
+        return;
+    }
+    if (tries) preferences.putUChar("tries", tries + 1);
+    preferences.end();
+}
+
+void otaConfirm() {
+    preferences.begin("ota", false);
+    uint8_t tries = preferences.getUChar("tries", 0);
+    if (tries) { preferences.putUChar("tries", 0); LOG_INFO("OTA: v%s confirmed after %d boots", FIRMWARE_VERSION, tries); }
+    preferences.end();
+    if (tries) esp_ota_mark_app_valid_cancel_rollback();
+}
+
+// A release by the first bytes of its image hash, as the "ota" namespace keeps it
+String otaRelease(const uint8_t* sha) {
+    char hex[17];
+    for (int i = 0; i < 8; i++) snprintf(hex + 2 * i, 3, "%02x", sha[i]);
+    return String(hex);
+}
+
+// OTA_SIGNING_KEY as bytes; false if it isn't 64 hex digits
+bool otaSigningKey(uint8_t key[ED25519_KEY_SIZE]) {
+    const char* hex = OTA_SIGNING_KEY;
+    if (strlen(hex) != 2 * ED25519_KEY_SIZE) return false;
+    for (int i = 0; i < 2 * ED25519_KEY_SIZE; i++) {
+        char c = hex[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (v < 0) return false;
+        key[i / 2] = (uint8_t)(i & 1 ? key[i / 2] << 4 | v : v);
+    }
+    return true;
+}
+
+// Once a day: a patch from this version to the server's current one, applied
+// straight into the inactive slot. 204/404 = nothing newer for this version.
+// Always from the configured server over TLS, never through a LAN relay:
+// any host on the LAN can announce one. The patch header must carry the
+// release key's signature; the patcher checks it before writing anything.
+void updateFirmware() {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* next = esp_ota_get_next_update_partition(nullptr);
+    if (!running || !next) return;
+    const char* server = core.server();
+    if (strncmp(server, "https://", 8) != 0) { LOG_WARN("OTA: %s is not https, not updating", server); return; }
+    uint8_t key[ED25519_KEY_SIZE];
+    if (!otaSigningKey(key)) { LOG_WARN("OTA: no signing key built in, not updating"); return; }
+    unsigned long t0 = millis();
+    WiFiClientSecure* client = new WiFiClientSecure(); if (!client) return;
+    client->setInsecure();
+    HTTPClient http;
+    String url = String(server) + "/api/firmware/delta?from=" FIRMWARE_VERSION; url.replace("//api", "/api");
+    NetDeadline budget(NET_CONNECT_MS + NET_TTFB_MS + OTA_DOWNLOAD_MS);
+    netArm(http, budget);
+    if (!http.begin(*client, url)) { delete client; return; }
+    http.addHeader("User-Agent", "PTV-TRMNL/" FIRMWARE_VERSION);
+    int httpCode = http.GET();
+    if (httpCode != 200) {
+        if (httpCode != 204 && httpCode != 404) LOG_INFO("OTA: HTTP %d", httpCode);
+        http.end(); delete client; accountRequest(0, t0); return;
+    }
+    NetReader<WiFiClient> rd(*http.getStreamPtr(), budget, OTA_DOWNLOAD_MS);
+    // The server keeps offering a release this device rolled back until it has a newer one
+    OtaDeltaHeader head;
+    size_t got = rd.readFully((uint8_t*)&head, sizeof(head));
+    String release = got == sizeof(head) ? otaRelease(head.newSha) : String();
+    preferences.begin("ota", true);
+    bool rejected = release.length() && preferences.getString("rejected") == release;
+    preferences.end();
+    if (rejected) {
+        http.end(); delete client;
+        accountRequest(rd.bytes(), t0);
+        LOG_INFO("OTA: %s was rolled back here, not applying it again", release.c_str());
+        return;
+    }
+    OtaFlash flash = { running, 0 };
+    OtaDeltaPatcher<OtaFlash>* patch = nullptr;
+    // Erases as it goes rather than the whole slot up front
+    esp_err_t err = esp_ota_begin(next, OTA_WITH_SEQUENTIAL_WRITES, &flash.handle);
+    if (err == ESP_OK) patch = new OtaDeltaPatcher<OtaFlash>(flash, key);
+    OtaDeltaStatus st = OTA_DELTA_FLASH_ERROR;
+    if (patch) {
+        uint8_t chunk[512]; int r;
+        patch->feed((const uint8_t*)&head, got);
+        while (patch->status() == OTA_DELTA_RUNNING && (r = rd.read(chunk, sizeof(chunk))) > 0) patch->feed(chunk, r);
+        st = patch->status();
+    }
+    http.end(); delete client;
+    accountRequest(rd.bytes(), t0);
+    uint32_t newSize = patch ? patch->header().newSize : 0;
+    delete patch;
+    if (st != OTA_DELTA_DONE) {
+        if (err == ESP_OK) esp_ota_abort(flash.handle);
+        LOG_WARN("OTA: patch %s after %u bytes (%d)", st == OTA_DELTA_RUNNING ? netStatusName(rd.status()) : otaDeltaStatusName(st),
+                 (unsigned)rd.bytes(), (int)err);
+        return;
+    }
+    // esp_ota_end() checks the image itself; our hash already matched the release
+    if ((err = esp_ota_end(flash.handle)) != ESP_OK || (err = esp_ota_set_boot_partition(next)) != ESP_OK) {
+        LOG_WARN("OTA: image rejected (%d)", (int)err);
+        return;
+    }
+    preferences.begin("ota", false); preferences.putUChar("tries", 1); preferences.putString("pending", release); preferences.end();
+    LOG_INFO("OTA: %u byte patch -> %u byte image in %s, restarting", (unsigned)rd.bytes(), (unsigned)newSize, next->label);
+    logDrain(Serial);
+    esp_restart();
+}
+
+// Server or WiFi unreachable: scheduled departures from the offline timetable,
+// drawn into the trains and trams zones and redrawn once a minute.
+// FONT_8x8 only: larger fonts render rotated on this panel (see README, Known Issues)
+static_assert(LAYOUT_FONTS[DASH_FIELDS[DASH_TRAINS_DEP].font].cell == LAYOUT_CELL_8x8
+              && LAYOUT_FONTS[DASH_FIELDS[DASH_TRAMS_DEP].font].cell == LAYOUT_CELL_8x8, "offline rows are drawn in FONT_8x8");
+static_assert(DASH_FIELDS[DASH_TRAINS_DEP].repeat >= TT_OFFLINE_DEPARTURES
+              && DASH_FIELDS[DASH_TRAMS_DEP].repeat >= TT_OFFLINE_DEPARTURES, "layout has too few departure rows");
+void showOfflineTimetable() {
+    uint64_t nowMs = epochMs();
+    if (!timetable.valid() || !nowMs || !core.drawn()) return;
+    uint32_t local = (uint32_t)(nowMs / 1000) + NTP_OFFSET_SECONDS;
+    if (offlineShown && local / 60 == offlineMinute) return;
+    offlineMinute = local / 60;
+    uint32_t day = local / 86400, sec = local % 86400;
+    static const struct { uint8_t zone, title, rows; uint32_t modes; } views[] = {
+        {DASH_TRAINS, DASH_TRAINS_TITLE, DASH_TRAINS_DEP, TT_MODE_BIT(TT_RAIL) | TT_MODE_BIT(TT_METRO)},
+        {DASH_TRAMS, DASH_TRAMS_TITLE, DASH_TRAMS_DEP, TT_MODE_BIT(TT_TRAM) | TT_MODE_BIT(TT_BUS)},
+    };
+    for (const auto& v : views) {
+        int zi = v.zone;
+        const LayoutField& title = DASH_FIELDS[v.title];
+        const LayoutField& rows = DASH_FIELDS[v.rows];
+        layoutFill(bbep.getBuffer(), DASH_PITCH, DASH_LAYOUT[zi].span, DASH_LAYOUT[zi].h, true);
+        bbep.setTextColor(BBEP_BLACK, BBEP_WHITE);
+        bbep.setFont(FONT_8x8); bbep.setCursor(title.tx, title.ty); bbep.print("SCHEDULED - OFFLINE");
+        TtDeparture dep[TT_OFFLINE_DEPARTURES];
+        int n = timetable.next(-1, day, sec, v.modes, dep, TT_OFFLINE_DEPARTURES);
+        for (int i = 0; i < n; i++) {
+            bbep.setCursor(rows.tx, layoutRowY(rows, i));
+            bbep.printf("%3ld min  %-5.5s %-28.28s", (long)(dep[i].time - (int32_t)sec) / 60, dep[i].route, dep[i].headsign);
+        }
+        if (n == 0) { bbep.setCursor(rows.tx, rows.ty); bbep.print("No scheduled services"); }
+        // The zone no longer holds what the server last sent
+        if (tileHashes[zi]) memset(tileHashes[zi], 0, tileHashCount[zi] * sizeof(uint32_t));
+        offlineZone[zi] = true;
+    }
+    panel.refresh(REFRESH_PARTIAL); partialCount++;
+    if (!offlineShown) LOG_INFO("Offline: showing scheduled departures");
+    offlineShown = true;
+}
+
+void onFullRefreshDone(int mode, uint32_t elapsedMs, void* ctx) { LOG_DEBUG("Full refresh: %lums", (unsigned long)elapsedMs); }
+void doFullRefresh() { panel.refresh(REFRESH_FULL, onFullRefreshDone); }
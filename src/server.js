@@ -30,9 +30,13 @@ import { readFileSync } from 'fs';
 import nodemailer from 'nodemailer';
 import safeguards from './utils/deployment-safeguards.js';
 import { decodeConfigToken, encodeConfigToken, generateWebhookUrl } from './utils/config-token.js';
-import { renderDashboard, renderTestPattern } from "./services/image-renderer.js";
+import { renderDashboard, renderTestPattern, cropBMP } from "./services/image-renderer.js";
 import { renderZones, clearCache as clearZoneCache, ZONES } from "./services/zone-renderer.js";
-import { getChangedZones as getChangedZonesV12, renderSingleZone as renderSingleZoneV12, getZoneDefinition as getZoneDefV12, ZONES as ZONES_V12, clearCache as clearZoneCacheV12 } from "./services/zone-renderer-v12.js";
+import { getChangedZones as getChangedZonesV12, createChangeTracker as createZoneTrackerV12, renderSingleZone as renderSingleZoneV12, renderSingleZoneSprites as renderSingleZoneSpritesV12, getZoneDefinition as getZoneDefV12, ZONES as ZONES_V12, clearCache as clearZoneCacheV12 } from "./services/zone-renderer-v12.js";
+import { tileGrid, parseDeviceHashes, encodeTileStream } from "./services/zone-tiles.js";
+import { getSprites, encodeDrawList, crc32 } from "./services/zone-sprites.js";
+import { checkDeviceLayout } from "./services/dashboard-layout.js";
+import { PAGE_IDS, renderPage, createPageTracker } from "./services/pages.js";
 
 // Setup error handlers early (before any async operations)
 safeguards.setupErrorHandlers();
@@ -2207,10 +2211,14 @@ app.get('/api/image', async (req, res) => {
       weather: data.weather,
       coffee: data.coffee
     };
-    const bmp = renderDashboard(dashData, prefs);
+    let bmp = renderDashboard(dashData, prefs);
+    // ?x=&y=&w=&h= sends just that rectangle (BYOS partial refresh of one zone)
+    if (req.query.w !== undefined) {
+      const [x, y, w, h] = ['x', 'y', 'w', 'h'].map(k => Number(req.query[k] ?? 0));
+      try { bmp = cropBMP(bmp, x, y, w, h); } catch (e) { return res.status(400).json({ error: e.message }); }
+    }
     res.setHeader('Content-Type', 'image/bmp');
-    res.setHeader('Content-Length', bmp.length);
-    res.send(bmp);
+    sendResumable(req, res, bmp);
   } catch (error) {
     res.status(500).json({ error: error.message });
   }
@@ -2226,21 +2234,56 @@ app.get('/api/image/test', async (req, res) => {
   }
 });
 
-// Zone-based partial refresh endpoint
+// Zone-based partial refresh endpoint: the same queries as the serverless route (api/zones.js),
+// so a self-hosted server or an edge relay answers the firmware the same way:
+// force=true clears the zone cache, at=<epoch s> renders as of a prefetch's apply-at time,
+// plain=1 is the comma-separated changed ids, batch=N six zones at a time.
+// plain=1 lists V12 ids (as /api/zones/changed), the ones /api/zone/:id serves;
+// the JSON and batches are still the V11 zones.
 app.get('/api/zones', async (req, res) => {
   try {
     const forceAll = req.query.force === 'true';
+    const applyAt = parseApplyAt(req.query);
+    if (req.query.plain === '1') {
+      res.set('Cache-Control', 'no-cache');
+      if (applyAt) res.set('X-Apply-At', String(applyAt.getTime() / 1000));
+      res.type('text/plain');
+      return res.send(getChangedZonesV12(buildV12ZoneData(applyAt || undefined), forceAll).join(','));
+    }
+    if (forceAll) clearZoneCache();
+    const asOf = applyAt || new Date();
     const data = await getData();
+    // The cached countdowns were taken when the data was fetched: move them on to asOf
+    const ahead = (asOf.getTime() - lastUpdate) / 60000;
+    const asOfDepartures = list => (list || []).map(d => ({ ...d, minutes: Math.max(0, Math.round(d.minutes - ahead)) }));
     const dashData = {
-      current_time: new Date().toLocaleTimeString('en-AU', { hour: '2-digit', minute: '2-digit', hour12: false, timeZone: 'Australia/Melbourne' }),
-      trains: data.trains || [],
-      trams: data.trams || [],
+      current_time: asOf.toLocaleTimeString('en-AU', { hour: '2-digit', minute: '2-digit', hour12: false, timeZone: 'Australia/Melbourne' }),
+      trains: applyAt ? asOfDepartures(data.trains) : data.trains || [],
+      trams: applyAt ? asOfDepartures(data.trams) : data.trams || [],
       weather: data.weather,
       coffee: data.coffee
     };
     const result = renderZones(dashData, forceAll);
-    const changed = result.zones.filter(z => z.changed).length;
-    res.setHeader('X-Zones-Changed', changed.toString());
+    const changedIds = result.zones.map(z => z.id);
+    res.set('Cache-Control', 'no-cache');
+    if (applyAt) res.set('X-Apply-At', String(applyAt.getTime() / 1000));
+
+    // Batches, for the ESP32's memory
+    if (req.query.batch !== undefined) {
+      const batchIndex = parseInt(req.query.batch, 10) || 0;
+      const BATCH_SIZE = 6;
+      const start = batchIndex * BATCH_SIZE;
+      const end = start + BATCH_SIZE;
+      return res.json({
+        timestamp: result.timestamp,
+        zones: result.zones.slice(start, end),
+        batch: batchIndex,
+        hasMore: end < result.zones.length,
+        total: result.zones.length
+      });
+    }
+
+    res.setHeader('X-Zones-Changed', changedIds.length.toString());
     res.json(result);
   } catch (error) {
     res.status(500).json({ error: error.message });
@@ -4140,6 +4183,12 @@ app.get('/api/refresh-zones', (req, res) => {
   try {
     const { lastRefreshTimes } = req.query;
     const parsedTimes = lastRefreshTimes ? JSON.parse(lastRefreshTimes) : {};
+    // Times may be on the device's clock (millis()); `now` is that clock as it sent the request
+    const deviceNow = Number(req.query.now);
+    if (deviceNow > 0) {
+      const skew = Date.now() - deviceNow;
+      for (const [key, t] of Object.entries(parsedTimes)) if (t) parsedTimes[key] = t + skew;
+    }
 
     const partialRefresh = preferences.getPartialRefreshSettings();
     if (!partialRefresh || !partialRefresh.enabled) {
@@ -6936,25 +6985,67 @@ safeguards.setupGracefulShutdown(server, async () => {
 
 
 // V12 ZONE ENDPOINTS - Memory-efficient for ESP32
+// now: render as of this instant (a device's apply-at time when it prefetches)
+function buildV12ZoneData(now = new Date()) {
+  const prefs = preferences.get();
+  return {
+    location: prefs?.addresses?.home?.split(',')[0] || 'HOME',
+    current_time: now.toLocaleTimeString('en-AU', { hour: '2-digit', minute: '2-digit', hour12: false, timeZone: 'Australia/Melbourne' }),
+    day: now.toLocaleDateString('en-AU', { weekday: 'long', timeZone: 'Australia/Melbourne' }),
+    date: now.toLocaleDateString('en-AU', { day: 'numeric', month: 'long', timeZone: 'Australia/Melbourne' }),
+    temp: cachedJourney?.weather?.temp || '--',
+    condition: cachedJourney?.weather?.condition || 'N/A',
+    status_type: cachedJourney?.hasDisruption ? 'disruption' : 'normal',
+    arrive_by: cachedJourney?.arriveBy || '--:--',
+    total_minutes: cachedJourney?.totalMinutes || '--',
+    journey_legs: cachedJourney?.legs || [],
+    destination: prefs?.addresses?.work?.split(',')[0] || 'WORK'
+  };
+}
+
+// The button pages (departures board, alerts): V12 zone data plus the live departures and alerts
+function buildPageData() {
+  return {
+    ...buildV12ZoneData(),
+    trains: cachedData?.trains || [],
+    trams: cachedData?.trams || [],
+    news: cachedData?.news || null,
+    mode: cachedData?.meta?.mode || 'live',
+    generatedAt: cachedData?.meta?.generatedAt
+  };
+}
+
+// ?at=<epoch seconds>: devices prefetch the next minute's zones and commit them on the boundary.
+// Only the near future is honoured; anything else renders as of now.
+function parseApplyAt(query) {
+  const at = parseInt(query.at, 10);
+  if (!at) return null;
+  const delta = at * 1000 - Date.now();
+  return delta > -60000 && delta < 300000 ? new Date(at * 1000) : null;
+}
+
+// Bodies devices download whole (zone BMPs, pages, partition images) survive a dropped connection:
+// X-Body-CRC is the CRC-32 of the whole body, and Range with If-Range naming the current ETag gets
+// only the rest of it (firmware/include/net_resume.hpp). A body that changed goes out whole.
+function sendResumable(req, res, body) {
+  const crc = crc32(body).toString(16).padStart(8, '0');
+  if (!res.get('ETag')) res.set('ETag', `"${crc}"`);
+  res.set({ 'Accept-Ranges': 'bytes', 'X-Body-CRC': crc });
+  const range = /^bytes=(\d+)-$/.exec(req.get('Range') || '');
+  const ifRange = req.get('If-Range');
+  if (!range || (ifRange && ifRange !== res.get('ETag'))) return res.send(body);
+  const first = Number(range[1]);
+  if (first >= body.length) return res.status(416).set('Content-Range', `bytes */${body.length}`).end();
+  res.status(206).set('Content-Range', `bytes ${first}-${body.length - 1}/${body.length}`);
+  res.send(body.subarray(first));
+}
+
 app.get('/api/zones/changed', async (req, res) => {
   try {
     const forceAll = req.query.force === 'true';
-    const prefs = preferences.get();
-    const now = new Date();
-    const data = {
-      location: prefs?.addresses?.home?.split(',')[0] || 'HOME',
-      current_time: now.toLocaleTimeString('en-AU', { hour: '2-digit', minute: '2-digit', hour12: false, timeZone: 'Australia/Melbourne' }),
-      day: now.toLocaleDateString('en-AU', { weekday: 'long', timeZone: 'Australia/Melbourne' }),
-      date: now.toLocaleDateString('en-AU', { day: 'numeric', month: 'long', timeZone: 'Australia/Melbourne' }),
-      temp: cachedJourney?.weather?.temp || '--',
-      condition: cachedJourney?.weather?.condition || 'N/A',
-      status_type: cachedJourney?.hasDisruption ? 'disruption' : 'normal',
-      arrive_by: cachedJourney?.arriveBy || '--:--',
-      total_minutes: cachedJourney?.totalMinutes || '--',
-      journey_legs: cachedJourney?.legs || [],
-      destination: prefs?.addresses?.work?.split(',')[0] || 'WORK'
-    };
-    res.json({ timestamp: new Date().toISOString(), changed: getChangedZonesV12(data, forceAll) });
+    const applyAt = parseApplyAt(req.query);
+    if (applyAt) res.set('X-Apply-At', String(applyAt.getTime() / 1000));
+    res.json({ timestamp: (applyAt || new Date()).toISOString(), changed: getChangedZonesV12(buildV12ZoneData(applyAt || undefined), forceAll) });
   } catch (e) { res.status(500).json({ error: e.message }); }
 });
 
@@ -6962,24 +7053,162 @@ app.get('/api/zone/:id', async (req, res) => {
   try {
     const { id } = req.params;
     const prefs = preferences.get();
-    const now = new Date();
-    const data = {
-      location: prefs?.addresses?.home?.split(',')[0] || 'HOME',
-      current_time: now.toLocaleTimeString('en-AU', { hour: '2-digit', minute: '2-digit', hour12: false, timeZone: 'Australia/Melbourne' }),
-      day: now.toLocaleDateString('en-AU', { weekday: 'long', timeZone: 'Australia/Melbourne' }),
-      date: now.toLocaleDateString('en-AU', { day: 'numeric', month: 'long', timeZone: 'Australia/Melbourne' }),
-      temp: cachedJourney?.weather?.temp || '--',
-      condition: cachedJourney?.weather?.condition || 'N/A',
-      status_type: cachedJourney?.hasDisruption ? 'disruption' : 'normal',
-      arrive_by: cachedJourney?.arriveBy || '--:--',
-      total_minutes: cachedJourney?.totalMinutes || '--',
-      journey_legs: cachedJourney?.legs || [],
-      destination: prefs?.addresses?.work?.split(',')[0] || 'WORK'
-    };
+    const applyAt = parseApplyAt(req.query);
+    const data = buildV12ZoneData(applyAt || undefined);
     const bmp = renderSingleZoneV12(id, data, prefs);
     if (!bmp) return res.status(404).json({ error: 'Zone not found' });
+    checkDeviceLayout(req.get('X-Layout'));
     const zoneDef = getZoneDefV12(id, data);
     res.set({ 'Content-Type': 'application/octet-stream', 'X-Zone-X': zoneDef.x, 'X-Zone-Y': zoneDef.y, 'X-Zone-Width': zoneDef.w, 'X-Zone-Height': zoneDef.h });
-    res.send(bmp);
+    if (applyAt) res.set('X-Apply-At', String(applyAt.getTime() / 1000));
+    sendResumable(req, res, bmp);
+  } catch (e) { res.status(500).json({ error: e.message }); }
+});
+
+// Tile delta transport: the device sends the tile hashes it holds (uint32 LE each, POST body)
+// and gets back only the tiles that differ. GET, or a body that doesn't match the grid, sends everything.
+// A device holding our sprite dictionary says so in X-Sprites; when something changed it gets
+// whichever of the tile stream and a draw list ('ZD', see zone-sprites.js) is smaller.
+async function sendZoneTiles(req, res) {
+  try {
+    const { id } = req.params;
+    const prefs = preferences.get();
+    const applyAt = parseApplyAt(req.query);
+    const data = buildV12ZoneData(applyAt || undefined);
+    const rendered = renderSingleZoneSpritesV12(id, data, prefs);
+    if (!rendered) return res.status(404).json({ error: 'Zone not found' });
+    const { bmp, sprites } = rendered;
+    checkDeviceLayout(req.get('X-Layout'));
+    const zoneDef = getZoneDefV12(id, data);
+    const { count } = tileGrid(zoneDef.w, zoneDef.h);
+    const held = parseDeviceHashes(req.body, count);
+    const { stream, stats } = encodeTileStream(zoneDef, bmp, held);
+    res.set({
+      'Content-Type': 'application/octet-stream',
+      'X-Zone-X': zoneDef.x, 'X-Zone-Y': zoneDef.y, 'X-Zone-Width': zoneDef.w, 'X-Zone-Height': zoneDef.h,
+      'X-Tiles': `${stats.tiles - stats.unchanged}/${stats.tiles}`
+    });
+    if (applyAt) res.set('X-Apply-At', String(applyAt.getTime() / 1000));
+    const deviceSprites = parseInt(req.get('X-Sprites'), 10);
+    if (deviceSprites > 0 && stats.unchanged < stats.tiles) {
+      const drawn = encodeDrawList(zoneDef, bmp, sprites, deviceSprites);
+      if (drawn && drawn.list.length < stream.length) {
+        res.set('X-Draw-Ops', `${drawn.stats.ops}/${drawn.stats.sprites}`);
+        return res.send(drawn.list);
+      }
+    }
+    res.send(stream);
+  } catch (e) { res.status(500).json({ error: e.message }); }
+}
+
+app.get('/api/zone/:id/tiles', sendZoneTiles);
+app.post('/api/zone/:id/tiles', express.raw({ type: 'application/octet-stream', limit: '16kb' }), sendZoneTiles);
+
+// A whole button page, packed as the device keeps it (services/pages.js). The CRC of
+// the frame is the ETag: a device holding the page as it is gets 304.
+app.get('/api/page/:id', async (req, res) => {
+  try {
+    await getData().catch(() => null);   // warm the departures; a page of what we have beats none
+    const page = renderPage(req.params.id, buildPageData());
+    if (!page) return res.status(404).json({ error: 'Page not found' });
+    checkDeviceLayout(req.get('X-Layout'));
+    const etag = `"${page.crc.toString(16).padStart(8, '0')}"`;
+    res.set({ 'ETag': etag, 'Cache-Control': 'no-cache' });
+    if (req.get('If-None-Match') === etag) return res.status(304).end();
+    sendResumable(req, res.type('application/octet-stream'), page.page);
   } catch (e) { res.status(500).json({ error: e.message }); }
 });
+
+// Zone push channel (SSE) - devices hold one connection and fetch only on change events
+const ZONE_STREAM_CHECK_MS = 10000;
+const ZONE_STREAM_HEARTBEAT_MS = 15000;
+const ZONE_STREAM_HISTORY = 32;
+const zoneStream = { clients: new Set(), version: 0, history: [], tracker: createZoneTrackerV12(), pages: createPageTracker(), timer: null };
+
+function writeZoneEvent(res, version, zones) {
+  res.write(`id: ${version}\nevent: zones\ndata: ${zones.join(',')}\n\n`);
+}
+
+function publishZoneChanges() {
+  try {
+    // Button pages go in the same list; devices refetch them in the background
+    const changed = [...zoneStream.tracker.changed(buildV12ZoneData()), ...zoneStream.pages.changed(buildPageData())];
+    if (changed.length === 0) return;
+    const version = ++zoneStream.version;
+    zoneStream.history.push({ version, zones: changed });
+    if (zoneStream.history.length > ZONE_STREAM_HISTORY) zoneStream.history.shift();
+    for (const res of zoneStream.clients) writeZoneEvent(res, version, changed);
+  } catch (e) { console.warn('Zone stream publish failed:', e.message); }
+}
+
+app.get('/api/zones/stream', (req, res) => {
+  res.set({ 'Content-Type': 'text/event-stream', 'Cache-Control': 'no-cache', 'Connection': 'keep-alive', 'X-Accel-Buffering': 'no' });
+  res.flushHeaders();
+
+  if (!zoneStream.timer) {
+    zoneStream.tracker.changed(buildV12ZoneData());   // baseline, devices do a full draw on boot
+    zoneStream.pages.changed(buildPageData());         // ...and fetch every page
+    zoneStream.timer = setInterval(publishZoneChanges, ZONE_STREAM_CHECK_MS);
+  }
+
+  // Replay what a reconnecting device missed; resync everything if it fell out of history
+  const lastId = parseInt(req.get('Last-Event-ID') || req.query.v, 10) || 0;
+  const current = zoneStream.version;
+  if (lastId === 0 || lastId === current) {
+    res.write(`id: ${current}\nevent: hello\ndata:\n\n`);
+  } else {
+    const missed = zoneStream.history.filter(h => h.version > lastId);
+    const complete = lastId < current && missed.length > 0 && missed[0].version === lastId + 1;
+    const zones = complete ? [...new Set(missed.flatMap(h => h.zones))] : [...getChangedZonesV12(buildV12ZoneData(), true), ...PAGE_IDS];
+    writeZoneEvent(res, current, zones);
+  }
+
+  zoneStream.clients.add(res);
+  const heartbeat = setInterval(() => res.write(': hb\n\n'), ZONE_STREAM_HEARTBEAT_MS);
+  req.on('close', () => {
+    clearInterval(heartbeat);
+    zoneStream.clients.delete(res);
+    if (zoneStream.clients.size === 0 && zoneStream.timer) { clearInterval(zoneStream.timer); zoneStream.timer = null; }
+  });
+});
+
+// Offline timetable image for the firmware's flash partition (firmware/host/tools/gtfs-compile).
+// The header carries a CRC-32 of the body at offset 8; that is the ETag the device sends back.
+app.get('/api/timetable.bin', async (req, res) => {
+  try {
+    const image = await fs.readFile(path.resolve('data/timetable.bin'));
+    if (image.length < 60 || image.readUInt32LE(0) !== 0x31425454) return res.status(500).json({ error: 'invalid timetable image' });
+    const etag = `"${image.readUInt32LE(8).toString(16).padStart(8, '0')}"`;
+    res.set({ 'ETag': etag, 'Cache-Control': 'no-cache' });
+    if (req.get('If-None-Match') === etag) return res.status(304).end();
+    sendResumable(req, res.type('application/octet-stream'), image);
+  } catch (e) {
+    res.status(404).json({ error: 'no timetable image' });
+  }
+});
+
+// Sprite dictionary for the firmware's "sprites" partition, built from firmware/sprites/sprites.txt.
+// Its CRC is the ETag, as for the timetable; the device reports the version it holds in X-Sprites.
+app.get('/api/sprites.bin', (req, res) => {
+  const sprites = getSprites();
+  if (!sprites) return res.status(404).json({ error: 'no sprite dictionary' });
+  const etag = `"${sprites.crc.toString(16).padStart(8, '0')}"`;
+  res.set({ 'ETag': etag, 'Cache-Control': 'no-cache', 'X-Sprites': String(sprites.version) });
+  if (req.get('If-None-Match') === etag) return res.status(304).end();
+  sendResumable(req, res.type('application/octet-stream'), sprites.image);
+});
+
+// Delta OTA: data/firmware/<version>.delta patches that release to the current one
+// (firmware/host/tools/ota-delta). 204 when there is nothing newer for it.
+app.get('/api/firmware/delta', async (req, res) => {
+  const from = String(req.query.from || '');
+  if (!/^[0-9A-Za-z._-]{1,32}$/.test(from)) return res.status(400).json({ error: 'bad version' });
+  try {
+    const patch = await fs.readFile(path.resolve('data/firmware', `${from}.delta`));
+    if (patch.length < 80 || patch.readUInt32LE(0) !== 0x544C4454) return res.status(500).json({ error: 'invalid patch' });
+    res.set({ 'Cache-Control': 'no-cache' });
+    res.type('application/octet-stream').send(patch);
+  } catch (e) {
+    res.status(204).end();
+  }
+});
@@ -0,0 +1,141 @@
+/**
+ * Dashboard Layout
+ *
+ * Zone and field rectangles come from firmware/layout/dashboard.layout,
+ * the same file the firmware build compiles into constexpr tables
+ * (firmware/include/dashboard_layout.hpp, via firmware/host/tools/layout_compile.hpp).
+ * Nothing here repeats a coordinate, so the server renders exactly the
+ * rectangles the device blits into.
+ *
+ * Devices send the CRC of the file they were built with in X-Layout;
+ * checkDeviceLayout() warns once per differing value.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+import { readFileSync } from 'fs';
+import { crc32 } from './zone-sprites.js';
+
+const SOURCE = new URL('../../firmware/layout/dashboard.layout', import.meta.url);
+const CELLS = { '6x8': [6, 8], '8x8': [8, 8], '12x16': [12, 16] };
+const IDENT = /^[a-z][a-z0-9_]*$/;
+
+let loaded;
+const warnedTags = new Set();
+
+function words(line) {
+  return [...line.matchAll(/"([^"]*)"|(\S+)/g)].map(m => m[1] ?? m[2]);
+}
+
+function ints(w, from, n) {
+  const out = w.slice(from, from + n).map(s => (/^\d+$/.test(s) ? parseInt(s, 10) : NaN));
+  return out.length === n && out.every(v => v >= 0 && v <= 4096) ? out : null;
+}
+
+/** dashboard.layout; the format is described at the top of that file. */
+export function parseLayout(text) {
+  const clean = text.replace(/\r/g, '');
+  const layout = { version: 0, crc: crc32(Buffer.from(clean, 'utf8')), fonts: new Map(), screens: new Map() };
+  let screen = null, zone = null;
+  clean.split('\n').forEach((line, i) => {
+    const fail = why => { throw new Error(`dashboard.layout:${i + 1}: ${why}`); };
+    const w = words(line);
+    if (!w.length || w[0][0] === '#') return;
+    const [kw] = w;
+    if (kw === 'version') {
+      layout.version = ints(w, 1, 1)?.[0];
+      if (!layout.version) fail('bad version');
+    } else if (kw === 'font') {
+      const cell = CELLS[w[2]];
+      if (w.length !== 4 || !IDENT.test(w[1]) || !cell) fail('expected "font NAME CWxCH \\"CSS font\\""');
+      if (layout.fonts.has(w[1])) fail(`duplicate font ${w[1]}`);
+      layout.fonts.set(w[1], { name: w[1], cellW: cell[0], cellH: cell[1], css: w[3] });
+    } else if (kw === 'screen') {
+      const v = ints(w, 2, 2);
+      if (w.length !== 4 || !IDENT.test(w[1]) || !v || !v[0] || !v[1]) fail('expected "screen NAME W H"');
+      if (layout.screens.has(w[1])) fail(`duplicate screen ${w[1]}`);
+      screen = { name: w[1], w: v[0], h: v[1], zones: new Map() };
+      layout.screens.set(screen.name, screen);
+      zone = null;
+    } else if (kw === 'zone') {
+      if (!screen) fail('zone before any screen');
+      const v = ints(w, 2, 5);
+      if (!IDENT.test(w[1] || '') || !v) fail('expected "zone ID X Y W H PRIORITY"');
+      const [x, y, zw, zh, priority] = v;
+      zone = { id: w[1], x, y, w: zw, h: zh, priority, fillBlack: false, border: 0, fields: new Map() };
+      for (const o of w.slice(7)) {
+        let m;
+        if (o === 'fill=black' || o === 'fill=white') zone.fillBlack = o === 'fill=black';
+        else if ((m = /^border=(\d+)$/.exec(o)) && +m[1] < 16) zone.border = +m[1];
+        else fail(`unknown zone option ${o}`);
+      }
+      if (!zw || !zh || x + zw > screen.w || y + zh > screen.h) fail(`zone ${zone.id} is not inside the screen`);
+      if (priority > 255) fail('priority out of range');
+      if (screen.zones.has(zone.id)) fail(`duplicate zone ${zone.id}`);
+      screen.zones.set(zone.id, zone);
+    } else if (kw === 'field' || kw === 'icon') {
+      if (!zone) fail(`${kw} before any zone`);
+      const icon = kw === 'icon';
+      const v = ints(w, 2, 4);
+      if (!IDENT.test(w[1] || '') || !v || (!icon && w.length < 7)) fail(icon ? 'expected "icon ID X Y W H"' : 'expected "field ID X Y W H FONT"');
+      const [fx, fy, fw, fh] = v;
+      const f = { id: w[1], icon, font: null, align: 'left', inkWhite: false, fill: null, padX: 0, padY: 0, repeat: 1, step: 0 };
+      if (!icon) {
+        f.font = layout.fonts.get(w[6]);
+        if (!f.font) fail(`unknown font ${w[6]}`);
+      }
+      for (const o of w.slice(icon ? 6 : 7)) {
+        let m;
+        if ((m = /^align=(left|center|right)$/.exec(o))) f.align = m[1];
+        else if ((m = /^ink=(black|white)$/.exec(o))) f.inkWhite = m[1] === 'white';
+        else if ((m = /^fill=(black|white)$/.exec(o))) f.fill = m[1];
+        else if ((m = /^pad=(\d+),(\d+)$/.exec(o))) { f.padX = +m[1]; f.padY = +m[2]; }
+        else if ((m = /^repeat=(\d+)$/.exec(o)) && +m[1] >= 1 && +m[1] <= 32) f.repeat = +m[1];
+        else if ((m = /^step=(\d+)$/.exec(o)) && +m[1] > 0 && +m[1] < 256) f.step = +m[1];
+        else fail(`unknown ${kw} option ${o}`);
+      }
+      if ((f.repeat > 1) !== (f.step > 0)) fail('repeat and step go together');
+      if (!fw || !fh || fx + fw > zone.w || fy + (f.repeat - 1) * f.step + fh > zone.h) fail(`${kw} ${zone.id}.${f.id} is not inside its zone`);
+      if (2 * f.padX >= fw || f.padY >= fh) fail(`${kw} ${zone.id}.${f.id}: padding leaves no room`);
+      if (zone.fields.has(f.id)) fail(`duplicate field ${zone.id}.${f.id}`);
+      // Absolute, as in the generated tables; tx/ty is where text starts
+      Object.assign(f, { x: zone.x + fx, y: zone.y + fy, w: fw, h: fh, tx: zone.x + fx + f.padX, ty: zone.y + fy + f.padY });
+      zone.fields.set(f.id, f);
+    } else {
+      fail('unknown line');
+    }
+  });
+  if (!layout.version) throw new Error('dashboard.layout: no version line');
+  if (!layout.screens.size) throw new Error('dashboard.layout: no screens');
+  layout.tag = layout.crc.toString(16).padStart(8, '0');
+  return layout;
+}
+
+/** The parsed layout, or null if dashboard.layout is missing or broken. */
+export function getLayout() {
+  if (loaded !== undefined) return loaded;
+  try {
+    loaded = parseLayout(readFileSync(SOURCE, 'utf8'));
+  } catch (e) {
+    console.warn('Dashboard layout unavailable:', e.message);
+    loaded = null;
+  }
+  return loaded;
+}
+
+/** A zone of a screen ('dash': the zone protocol), or null. */
+export function getLayoutZone(id, screen = 'dash') {
+  return getLayout()?.screens.get(screen)?.zones.get(id) || null;
+}
+
+/** Warn (once per value) when a device was built from a different dashboard.layout. */
+export function checkDeviceLayout(tag) {
+  const layout = getLayout();
+  if (!tag || !layout || tag === layout.tag || warnedTags.has(tag)) return true;
+  warnedTags.add(tag);
+  console.warn(`Device built with dashboard.layout ${tag}, server has ${layout.tag}: zone geometry may differ`);
+  return false;
+}
+
+export default { parseLayout, getLayout, getLayoutZone, checkDeviceLayout };
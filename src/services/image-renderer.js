@@ -14,13 +14,12 @@ const WIDTH = 800;
 const HEIGHT = 480;
 
 /**
- * Create a 1-bit BMP file from pixel data
- * @param {Uint8Array} pixels - 1-bit packed pixel data (0 = black, 1 = white)
- * @returns {Buffer} - Complete BMP file
+ * Allocate a top-down 1-bit BMP and write its 62-byte header
+ * @returns {{buffer: Buffer, rowSize: number}} - pixel rows start at offset 62
  */
-function createBMP(pixels) {
-  const rowSize = Math.ceil(WIDTH / 32) * 4;
-  const pixelDataSize = rowSize * HEIGHT;
+function allocBMP(width, height) {
+  const rowSize = Math.ceil(width / 32) * 4;
+  const pixelDataSize = rowSize * height;
   const fileSize = 62 + pixelDataSize;
   const buffer = Buffer.alloc(fileSize);
   let offset = 0;
@@ -30,8 +29,8 @@ function createBMP(pixels) {
   buffer.writeUInt16LE(0, offset); offset += 2;
   buffer.writeUInt32LE(62, offset); offset += 4;
   buffer.writeUInt32LE(40, offset); offset += 4;
-  buffer.writeInt32LE(WIDTH, offset); offset += 4;
-  buffer.writeInt32LE(-HEIGHT, offset); offset += 4;
+  buffer.writeInt32LE(width, offset); offset += 4;
+  buffer.writeInt32LE(-height, offset); offset += 4;
   buffer.writeUInt16LE(1, offset); offset += 2;
   buffer.writeUInt16LE(1, offset); offset += 2;
   buffer.writeUInt32LE(0, offset); offset += 4;
@@ -42,6 +41,17 @@ function createBMP(pixels) {
   buffer.writeUInt32LE(0, offset); offset += 4;
   buffer.writeUInt32LE(0x00000000, offset); offset += 4;
   buffer.writeUInt32LE(0x00FFFFFF, offset); offset += 4;
+  return { buffer, rowSize };
+}
+
+/**
+ * Create a 1-bit BMP file from pixel data
+ * @param {Uint8Array} pixels - 1-bit packed pixel data (0 = black, 1 = white)
+ * @returns {Buffer} - Complete BMP file
+ */
+function createBMP(pixels) {
+  const { buffer, rowSize } = allocBMP(WIDTH, HEIGHT);
+  let offset = 62;
   for (let y = 0; y < HEIGHT; y++) {
     for (let x = 0; x < WIDTH; x += 8) {
       let b = 0;
@@ -56,6 +66,26 @@ function createBMP(pixels) {
   return buffer;
 }
 
+/**
+ * Cut a rectangle out of a full-screen BMP from createBMP(), for a device
+ * redrawing one refresh zone. x and w must be multiples of 8 so rows copy
+ * byte for byte (the device snaps its zones to that).
+ * @returns {Buffer} - 1-bit BMP of w x h
+ */
+export function cropBMP(bmp, x, y, w, h) {
+  if (![x, y, w, h].every(Number.isInteger) || x % 8 || w % 8 || x < 0 || y < 0 || w <= 0 || h <= 0 ||
+      x + w > WIDTH || y + h > HEIGHT) {
+    throw new RangeError(`Bad crop ${x},${y} ${w}x${h}`);
+  }
+  const srcRow = Math.ceil(WIDTH / 32) * 4;
+  const { buffer, rowSize } = allocBMP(w, h);
+  for (let r = 0; r < h; r++) {
+    const src = 62 + (y + r) * srcRow + x / 8;
+    bmp.copy(buffer, 62 + r * rowSize, src, src + w / 8);
+  }
+  return buffer;
+}
+
 function canvasTo1Bit(canvas) {
   const ctx = canvas.getContext('2d');
   const imageData = ctx.getImageData(0, 0, WIDTH, HEIGHT);
@@ -107,4 +137,4 @@ export function renderDashboard(data, prefs = {}) {
   return createBMP(canvasTo1Bit(canvas));
 }
 
-export default { renderDashboard, renderTestPattern };
+export default { renderDashboard, renderTestPattern, cropBMP };
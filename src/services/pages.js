@@ -0,0 +1,128 @@
+/**
+ * Button Pages
+ *
+ * The firmware's button cycles the panel from its journey dashboard to
+ * whole-screen pages rendered here: the departures and alerts screens of
+ * firmware/layout/dashboard.layout. The device holds each page packed in
+ * RAM (firmware/include/page_cache.hpp) and refetches one only when the
+ * zone push stream names it, so a press never waits on this server.
+ *
+ * Page (little-endian), stored by the device as it arrives:
+ *   header  'P' 'G' version:u8 0 | w:u16 h:u16 | crc:u32
+ *   body    the frame's rows end to end (w/8 bytes, bit 7 leftmost,
+ *           1 = white), PackBits as in TIFF
+ * crc is the CRC-32 of the unpacked frame and doubles as the ETag.
+ * packFrame() is pagePack() in page_cache.hpp; both give the same bytes.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+import { crc32 } from './zone-sprites.js';
+import { renderLayoutScreen } from './zone-renderer-v12.js';
+
+export const PAGE_IDS = ['departures', 'alerts'];
+export const PAGE_VERSION = 1;
+const HEADER_SIZE = 12;
+const HINT = 'Press the button for the next page';
+const TZ = 'Australia/Melbourne';
+
+const rendered = new Map();
+
+/** PackBits: n = 0..127 copies n + 1 literal bytes, n = 129..255 repeats the next byte 257 - n times. */
+export function packFrame(frame) {
+  const out = [];
+  let i = 0;
+  while (i < frame.length) {
+    let run = 1;
+    while (i + run < frame.length && run < 128 && frame[i + run] === frame[i]) run++;
+    if (run >= 2) {
+      out.push(257 - run, frame[i]);
+      i += run;
+      continue;
+    }
+    // Literals up to the next run of three; a pair costs the same either way
+    const start = i;
+    while (i < frame.length && i - start < 128 && !(i + 2 < frame.length && frame[i] === frame[i + 1] && frame[i] === frame[i + 2])) i++;
+    out.push(i - start - 1);
+    for (let k = start; k < i; k++) out.push(frame[k]);
+  }
+  return Buffer.from(out);
+}
+
+function clock(ms) {
+  return new Date(ms).toLocaleTimeString('en-AU', { hour: '2-digit', minute: '2-digit', hour12: false, timeZone: TZ });
+}
+
+// Departure times as clock times rather than minutes to go, so the page only changes with the departures
+function departures(data) {
+  const at = Date.parse(data.generatedAt) || Date.now();
+  return [
+    ...(data.trains || []).map(t => ({ ...t, mode: 'TRAIN' })),
+    ...(data.trams || []).map(t => ({ ...t, mode: 'TRAM' }))
+  ].sort((a, b) => a.minutes - b.minutes).map(d => ({ when: clock(at + d.minutes * 60000), mode: d.mode, dest: d.destination || '' }));
+}
+
+function alerts(data) {
+  const list = [];
+  if (data.news) list.push(String(data.news).replace(/^\W+/, ''));
+  if (data.status_type === 'disruption') list.push('Disruption on your journey: allow extra time');
+  if (data.mode === 'fallback') list.push('Live departures unavailable: showing scheduled times');
+  return list.length ? list : ['No current alerts'];
+}
+
+/** What goes in each field of a page's zone; see dashValues() in zone-renderer-v12.js. */
+export function pageValues(id, zoneId, data) {
+  if (zoneId === 'footer') return { hint: HINT };
+  if (id === 'departures') {
+    if (zoneId === 'header') return { title: 'DEPARTURES' };
+    const deps = departures(data);
+    return { heading: 'NEXT DEPARTURES', when: deps.map(d => d.when), mode: deps.map(d => d.mode), dest: deps.map(d => d.dest) };
+  }
+  if (id === 'alerts') {
+    if (zoneId === 'header') return { title: 'SERVICE ALERTS' };
+    return { alert: alerts(data) };
+  }
+  return {};
+}
+
+function pageKey(id, data) {
+  return JSON.stringify(['header', 'board', 'list'].map(z => pageValues(id, z, data)));
+}
+
+/** A page as the device stores it, and its CRC (the ETag); null for an unknown page or no layout. */
+export function renderPage(id, data) {
+  if (!PAGE_IDS.includes(id)) return null;
+  const key = pageKey(id, data);
+  const hit = rendered.get(id);
+  if (hit?.key === key) return hit;
+  const screen = renderLayoutScreen(id, zoneId => pageValues(id, zoneId, data));
+  if (!screen) return null;
+  const crc = crc32(screen.frame);
+  const header = Buffer.alloc(HEADER_SIZE);
+  header.write('PG', 0, 'latin1');
+  header.writeUInt8(PAGE_VERSION, 2);
+  header.writeUInt16LE(screen.w, 4);
+  header.writeUInt16LE(screen.h, 6);
+  header.writeUInt32LE(crc, 8);
+  const page = { key, crc, page: Buffer.concat([header, packFrame(screen.frame)]) };
+  rendered.set(id, page);
+  return page;
+}
+
+/** Pages whose content changed since the last call, for the push stream; the first call names them all. */
+export function createPageTracker() {
+  const state = {};
+  return {
+    changed(data, forceAll = false) {
+      return PAGE_IDS.filter(id => {
+        const key = pageKey(id, data);
+        if (!forceAll && key === state[id]) return false;
+        state[id] = key;
+        return true;
+      });
+    }
+  };
+}
+
+export default { PAGE_IDS, packFrame, pageValues, renderPage, createPageTracker };
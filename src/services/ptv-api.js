@@ -12,7 +12,8 @@ function signUrl(path) {
   return `${API_BASE}${fullPath}&signature=${signature}`;
 }
 
-export async function getDepartures(stopId, routeType) {
+// asOf: countdowns are computed relative to this instant (a future apply-at time for prefetch)
+export async function getDepartures(stopId, routeType, asOf = new Date()) {
   const url = signUrl(`/v3/departures/route_type/${routeType}/stop/${stopId}?max_results=3`);
   if (!url) {
     // Mock data when no API keys
@@ -31,8 +32,7 @@ export async function getDepartures(stopId, routeType) {
     return (data.departures || []).slice(0, 3).map(d => {
       const scheduled = new Date(d.scheduled_departure_utc);
       const estimated = d.estimated_departure_utc ? new Date(d.estimated_departure_utc) : scheduled;
-      const now = new Date();
-      const minutes = Math.round((estimated - now) / 60000);
+      const minutes = Math.round((estimated - asOf) / 60000);
       return {
         minutes: Math.max(0, minutes),
         destination: d.direction?.direction_name || 'City',
@@ -1,4 +1,6 @@
 import { createCanvas } from '@napi-rs/canvas';
+import { drawSprite } from './zone-sprites.js';
+import { getLayout, getLayoutZone } from './dashboard-layout.js';
 
 export const ZONES = {
   'header.location': { id: 'header.location', x: 16, y: 8, w: 260, h: 20 },
@@ -17,17 +19,38 @@ export const ZONES = {
   'leg3.time': { id: 'leg3.time', x: 700, y: 244, w: 84, h: 52 },
   'leg4.time': { id: 'leg4.time', x: 700, y: 298, w: 84, h: 52 },
   'leg5.time': { id: 'leg5.time', x: 700, y: 352, w: 84, h: 52 },
-  'leg6.time': { id: 'leg6.time', x: 700, y: 406, w: 84, h: 52 },
-  'footer': { id: 'footer', x: 0, y: 452, w: 800, h: 28 }
+  'leg6.time': { id: 'leg6.time', x: 700, y: 406, w: 84, h: 52 }
 };
 
+// The zone protocol's zones (time, weather, trains, trams, coffee, footer) are
+// not listed above: their geometry and fields come from dashboard.layout.
+function dashZoneIds() {
+  return [...(getLayout()?.screens.get('dash')?.zones.keys() || [])];
+}
+
 let previousData = {};
 let cachedBMPs = {};
 
+// 1 bpp rows of rowSize bytes: bit 7 leftmost, 1 = white, padding 0
+function canvasRows(canvas, rowSize) {
+  const w = canvas.width, h = canvas.height;
+  const img = canvas.getContext('2d').getImageData(0, 0, w, h);
+  const rows = Buffer.alloc(rowSize * h);
+  for (let y = 0; y < h; y++) {
+    for (let x = 0; x < w; x += 8) {
+      let byte = 0;
+      for (let b = 0; b < 8 && x + b < w; b++) {
+        const i = (y * w + x + b) * 4;
+        if (0.299*img.data[i] + 0.587*img.data[i+1] + 0.114*img.data[i+2] > 128) byte |= (0x80 >> b);
+      }
+      rows[y * rowSize + (x >> 3)] = byte;
+    }
+  }
+  return rows;
+}
+
 function canvasToBMP(canvas) {
-  const ctx = canvas.getContext('2d');
   const w = canvas.width, h = canvas.height;
-  const img = ctx.getImageData(0, 0, w, h);
   const rowSize = Math.ceil(w / 32) * 4;
   const dataSize = rowSize * h;
   const buf = Buffer.alloc(62 + dataSize);
@@ -45,18 +68,7 @@ function canvasToBMP(canvas) {
   buf.writeUInt32LE(2, 46);
   buf.writeUInt32LE(0x00000000, 54);
   buf.writeUInt32LE(0x00FFFFFF, 58);
-  let off = 62;
-  for (let y = 0; y < h; y++) {
-    for (let x = 0; x < w; x += 8) {
-      let byte = 0;
-      for (let b = 0; b < 8 && x + b < w; b++) {
-        const i = (y * w + x + b) * 4;
-        if (0.299*img.data[i] + 0.587*img.data[i+1] + 0.114*img.data[i+2] > 128) byte |= (0x80 >> b);
-      }
-      buf.writeUInt8(byte, off++);
-    }
-    for (let p = 0; p < rowSize - Math.ceil(w/8); p++) buf.writeUInt8(0, off++);
-  }
+  canvasRows(canvas, rowSize).copy(buf, 62);
   return buf;
 }
 
@@ -69,40 +81,132 @@ function getLegZone(idx, total, part) {
     : { id: `leg${idx}.info`, x: 16, y, w: 684, h };
 }
 
+// Pictograms from firmware/sprites/sprites.txt; the device holds the same set in flash
+const LEG_SPRITES = { train: 'train', vline: 'train', tram: 'tram', bus: 'bus', walk: 'walk', coffee: 'coffee', wait: 'wait' };
+const WEATHER_SPRITES = [[/storm|thunder/, 'storm'], [/rain|shower|drizzle/, 'rain'], [/fog|mist|haze/, 'fog'], [/partly/, 'partly'], [/cloud|overcast/, 'cloud'], [/sun|clear|fine/, 'sun']];
+
+function weatherSprite(condition) {
+  const c = String(condition || '').toLowerCase();
+  return WEATHER_SPRITES.find(([re]) => re.test(c))?.[1] || null;
+}
+
+const TRAIN_LEGS = new Set(['train', 'vline']);
+const TRAM_LEGS = new Set(['tram', 'bus']);
+
+function legText(leg) {
+  return `${String(leg.minutes ?? '--').padStart(3)} min  ${leg.title || leg.to || leg.location || ''}`;
+}
+
+// What goes in each field of a layout zone: text, a list of rows for a repeated field, or a sprite name for an icon
+function dashValues(id, data) {
+  const legs = data.journey_legs || [];
+  const coffee = legs.find(l => l.type === 'coffee');
+  switch (id) {
+    case 'time': return { clock: data.current_time || '--:--' };
+    case 'weather': return { temp: `${data.temp || '--'}°`, condition: data.condition || '', icon: weatherSprite(data.condition) };
+    case 'trains': return { title: 'TRAINS', dep: legs.filter(l => TRAIN_LEGS.has(l.type)).map(legText) };
+    case 'trams': return { title: 'TRAMS & BUSES', dep: legs.filter(l => TRAM_LEGS.has(l.type)).map(legText) };
+    case 'coffee': return coffee
+      ? { icon: 'coffee', decision: coffee.title || 'COFFEE STOP', detail: coffee.subtitle || `${coffee.minutes ?? '--'} min` }
+      : { icon: null, decision: 'NO COFFEE STOP', detail: '' };
+    case 'footer': return { destination: (data.destination || 'WORK').toUpperCase(), arrive: `ARRIVE ${data.arrive_by || '--:--'}` };
+    default: return {};
+  }
+}
+
+// Draw a layout zone from its field values: background, border, then each field clipped to its rectangle
+function renderLayoutZone(z, values, ctx, sprite) {
+  ctx.fillStyle = z.fillBlack ? '#000' : '#FFF'; ctx.fillRect(0, 0, z.w, z.h);
+  ctx.strokeStyle = '#000'; ctx.lineWidth = 1;
+  for (let i = 0; i < z.border; i++) ctx.strokeRect(i + 0.5, i + 0.5, z.w - 2 * i - 1, z.h - 2 * i - 1);
+  for (const f of z.fields.values()) {
+    const value = values[f.id];
+    const x = f.x - z.x, y = f.y - z.y;
+    if (f.icon) { sprite(value, x, y); continue; }
+    const rows = (Array.isArray(value) ? value : [value ?? '']).slice(0, f.repeat);
+    rows.forEach((text, i) => {
+      const ry = y + i * f.step;
+      ctx.save();
+      ctx.beginPath(); ctx.rect(x, ry, f.w, f.h); ctx.clip();
+      if (f.fill) { ctx.fillStyle = f.fill === 'black' ? '#000' : '#FFF'; ctx.fillRect(x, ry, f.w, f.h); }
+      ctx.fillStyle = f.inkWhite ? '#FFF' : '#000';
+      ctx.font = f.font.css; ctx.textBaseline = 'top'; ctx.textAlign = f.align;
+      const tx = f.align === 'left' ? f.tx - z.x : f.align === 'right' ? x + f.w - (f.tx - f.x) : x + f.w / 2;
+      ctx.fillText(String(text), tx, f.ty - z.y + i * f.step);
+      ctx.restore();
+    });
+  }
+}
+
 function render(id, data, prefs) {
-  const z = id.startsWith('leg') ? getLegZone(+id[3], data.journey_legs?.length || 3, id.split('.')[1]) : ZONES[id];
+  const layoutZone = getLayoutZone(id);
+  const z = layoutZone || (id.startsWith('leg') ? getLegZone(+id[3], data.journey_legs?.length || 3, id.split('.')[1]) : ZONES[id]);
   if (!z) return null;
   const c = createCanvas(z.w, z.h), ctx = c.getContext('2d');
+  const sprites = [];
+  const sprite = (name, x, y) => { const p = name && drawSprite(ctx, name, x, y); if (p) sprites.push(p); };
+  if (layoutZone) { renderLayoutZone(layoutZone, dashValues(id, data), ctx, sprite); return { bmp: canvasToBMP(c), sprites }; }
   ctx.fillStyle = '#FFF'; ctx.fillRect(0, 0, z.w, z.h);
   ctx.fillStyle = '#000'; ctx.font = 'bold 14px sans-serif';
-  if (id === 'status' || id === 'footer') { ctx.fillStyle = '#000'; ctx.fillRect(0, 0, z.w, z.h); ctx.fillStyle = '#FFF'; }
+  if (id === 'status') { ctx.fillStyle = '#000'; ctx.fillRect(0, 0, z.w, z.h); ctx.fillStyle = '#FFF'; }
   if (id === 'header.location') ctx.fillText((data.location || 'HOME').toUpperCase(), 0, 14);
   else if (id === 'header.time') { ctx.font = 'bold 48px sans-serif'; ctx.fillText(data.current_time || '--:--', 0, 50); }
   else if (id === 'header.dayDate') { ctx.fillText(data.day || '', 0, 16); ctx.font = '14px sans-serif'; ctx.fillText(data.date || '', 0, 36); }
-  else if (id === 'header.weather') { ctx.strokeRect(0, 0, z.w, z.h); ctx.font = 'bold 28px sans-serif'; ctx.fillText((data.temp||'--')+'°', 10, 30); ctx.font = '11px sans-serif'; ctx.fillText(data.condition||'', 10, 48); }
+  else if (id === 'header.weather') { ctx.strokeRect(0, 0, z.w, z.h); ctx.font = 'bold 28px sans-serif'; ctx.fillText((data.temp||'--')+'°', 10, 30); ctx.font = '11px sans-serif'; ctx.fillText(data.condition||'', 10, 48); sprite(weatherSprite(data.condition), z.w - 34, 10); }
   else if (id === 'status') ctx.fillText(`${data.status_type==='disruption'?'⚠ DISRUPTION':'LEAVE NOW'} → Arrive ${data.arrive_by||'--:--'}`, 16, 18);
-  else if (id === 'footer') ctx.fillText((data.destination||'WORK').toUpperCase(), 16, 18);
-  else if (id.endsWith('.info')) { const leg = data.journey_legs?.[+id[3]-1]; if (leg) { ctx.strokeRect(0, 0, z.w, z.h-2); ctx.fillText(leg.title||'', 40, 20); ctx.font = '11px sans-serif'; ctx.fillText(leg.subtitle||'', 40, 36); } }
+  else if (id.endsWith('.info')) { const leg = data.journey_legs?.[+id[3]-1]; if (leg) { ctx.strokeRect(0, 0, z.w, z.h-2); sprite(LEG_SPRITES[leg.type], 8, Math.floor((z.h - 26) / 2)); ctx.fillText(leg.title||'', 40, 20); ctx.font = '11px sans-serif'; ctx.fillText(leg.subtitle||'', 40, 36); } }
   else if (id.endsWith('.time')) { const leg = data.journey_legs?.[+id[3]-1]; if (leg) { ctx.fillRect(4, 4, z.w-8, z.h-10); ctx.fillStyle = '#FFF'; ctx.font = 'bold 22px sans-serif'; ctx.textAlign = 'center'; ctx.fillText(leg.minutes?.toString()||'--', z.w/2, 28); ctx.font = '9px sans-serif'; ctx.fillText(leg.type==='walk'?'MIN WALK':'MIN', z.w/2, 42); } }
-  return canvasToBMP(c);
+  return { bmp: canvasToBMP(c), sprites };
 }
 
-export function getChangedZones(data, forceAll = false) {
+function changedSince(state, data, forceAll) {
   const legs = data.journey_legs || [];
-  const active = ['header.location','header.time','header.dayDate','header.weather','status','footer'];
+  const dash = dashZoneIds();
+  const active = ['header.location','header.time','header.dayDate','header.weather','status', ...dash];
   for (let i = 1; i <= Math.min(legs.length, 6); i++) { active.push(`leg${i}.info`); active.push(`leg${i}.time`); }
   if (forceAll) return active;
   return active.filter(id => {
-    const hash = JSON.stringify(id.endsWith('.time') ? {m: data.journey_legs?.[+id[3]-1]?.minutes} : {id});
-    if (hash !== previousData[id]) { previousData[id] = hash; return true; }
+    const hash = JSON.stringify(dash.includes(id) ? dashValues(id, data) : id.endsWith('.time') ? {m: data.journey_legs?.[+id[3]-1]?.minutes} : {id});
+    if (hash !== state[id]) { state[id] = hash; return true; }
     return false;
   });
 }
 
-export function renderSingleZone(id, data, prefs = {}) { return render(id, data, prefs); }
+export function getChangedZones(data, forceAll = false) { return changedSince(previousData, data, forceAll); }
+
+// Independent change state, so a background publisher doesn't consume the polling endpoint's diffs
+export function createChangeTracker() {
+  const state = {};
+  return { changed: (data, forceAll = false) => changedSince(state, data, forceAll) };
+}
+
+export function renderSingleZone(id, data, prefs = {}) { return render(id, data, prefs)?.bmp || null; }
+// BMP plus where sprites were drawn, for zone-sprites.js encodeDrawList()
+export function renderSingleZoneSprites(id, data, prefs = {}) { return render(id, data, prefs); }
 export function getZoneDefinition(id, data) {
   if (id.startsWith('leg') && data) { const m = id.match(/^leg(\d+)\.(info|time)$/); if (m) return getLegZone(+m[1], data.journey_legs?.length||3, m[2]); }
+  const z = getLayoutZone(id);
+  if (z) return { id: z.id, x: z.x, y: z.y, w: z.w, h: z.h };
   return ZONES[id] || null;
 }
+/**
+ * A whole layout screen as one 1 bpp frame (rows of w/8 bytes, 1 = white), each
+ * zone drawn at its place from valuesFor(zoneId). The button pages (pages.js).
+ */
+export function renderLayoutScreen(name, valuesFor) {
+  const screen = getLayout()?.screens.get(name);
+  if (!screen) return null;
+  const c = createCanvas(screen.w, screen.h), ctx = c.getContext('2d');
+  ctx.fillStyle = '#FFF'; ctx.fillRect(0, 0, screen.w, screen.h);
+  for (const z of screen.zones.values()) {
+    ctx.save();
+    ctx.translate(z.x, z.y);
+    ctx.beginPath(); ctx.rect(0, 0, z.w, z.h); ctx.clip();
+    renderLayoutZone(z, valuesFor(z.id), ctx, (name, x, y) => name && drawSprite(ctx, name, x, y));
+    ctx.restore();
+  }
+  return { w: screen.w, h: screen.h, frame: canvasRows(c, Math.ceil(screen.w / 8)) };
+}
+
 export function clearCache() { previousData = {}; cachedBMPs = {}; }
-export default { ZONES, getChangedZones, renderSingleZone, getZoneDefinition, clearCache };
+export default { ZONES, getChangedZones, createChangeTracker, renderSingleZone, renderSingleZoneSprites, getZoneDefinition, renderLayoutScreen, clearCache };
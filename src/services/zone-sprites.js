@@ -0,0 +1,292 @@
+/**
+ * Zone Sprites and Draw Lists
+ *
+ * The pictograms drawn into zones come from firmware/sprites/sprites.txt.
+ * The device keeps the same set compiled into a flash partition
+ * (/api/sprites.bin), so a zone made mostly of pictograms, rules and fills
+ * can be sent as a short draw list instead of tiles: fill the background,
+ * put sprite #7 at (110,10), then raw bits for whatever is left (text).
+ *
+ * Dictionary image (little-endian), see firmware/include/sprite_dict.hpp:
+ *   header  magic "SPR1" | format:u16 headerSize:u16 | crc:u32 totalSize:u32 version:u32 | count:u16 0:u16
+ *   entry   id:u16 w:u8 h:u8 offset:u32              sorted by id
+ *   bitmaps rows of (w+7)/8 bytes, bit 7 leftmost, 1 = white
+ *
+ * Draw list:
+ *   header  'Z' 'D' version:u8 0 | x:i16 y:i16 w:u16 h:u16 | dictVersion:u32 | ops:u16
+ *   op      0 FILL   x:u16 y:u16 w:u16 h:u16 white:u8
+ *           1 SPRITE id:u16 x:u16 y:u16
+ *           2 BITS   x:u16 y:u16 w:u16 h:u16, then h rows of (w+7)/8 bytes
+ * The encoder is the one in firmware/host/tools/sprite_pack.hpp; both give
+ * the same bytes for the same zone.
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+import { readFileSync } from 'fs';
+
+export const SPRITE_DICT_MAGIC = 0x31525053;
+export const SPRITE_DICT_FORMAT = 1;
+export const DRAW_LIST_VERSION = 1;
+export const DRAW_OP = { FILL: 0, SPRITE: 1, BITS: 2 };
+const HEADER_SIZE = 24;
+const ENTRY_SIZE = 8;
+const RUN_MIN = 32;        // a rule this long is sent as a fill
+const GROUP_GAP = 16;      // clean columns that split a band of residual bits
+
+const SOURCE = new URL('../../firmware/sprites/sprites.txt', import.meta.url);
+
+let loaded;
+
+const CRC_TABLE = (() => {
+  const t = new Uint32Array(256);
+  for (let i = 0; i < 256; i++) {
+    let c = i;
+    for (let k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+    t[i] = c >>> 0;
+  }
+  return t;
+})();
+
+/** CRC-32 (IEEE), as ttCrc32() on the device. */
+export function crc32(buf) {
+  let c = 0xffffffff;
+  for (let i = 0; i < buf.length; i++) c = CRC_TABLE[(c ^ buf[i]) & 0xff] ^ (c >>> 8);
+  return (c ^ 0xffffffff) >>> 0;
+}
+
+/** sprites.txt: "version N", then "sprite ID NAME WxH" and H rows of '#' (black) / '.' (white). */
+export function parseSprites(text) {
+  const lines = text.split(/\r?\n/);
+  let version = 0;
+  const sprites = [];
+  for (let i = 0; i < lines.length; i++) {
+    const line = lines[i];
+    if (!line || line[0] === '#') continue;
+    const words = line.trim().split(/\s+/);
+    if (words[0] === 'version') {
+      version = parseInt(words[1], 10);
+      if (!(version > 0)) throw new Error(`sprites.txt:${i + 1}: bad version`);
+    } else if (words[0] === 'sprite') {
+      const id = parseInt(words[1], 10), name = words[2];
+      const m = /^(\d+)x(\d+)$/.exec(words[3] || '');
+      if (!(id > 0 && id < 65536) || !name || !m) throw new Error(`sprites.txt:${i + 1}: expected "sprite ID NAME WxH"`);
+      const w = +m[1], h = +m[2];
+      if (sprites.some(s => s.id === id || s.name === name)) throw new Error(`sprites.txt:${i + 1}: duplicate sprite ${name}`);
+      const px = new Uint8Array(w * h);
+      for (let r = 0; r < h; r++) {
+        const row = lines[++i];
+        if (row === undefined || row.length !== w || /[^#.]/.test(row)) throw new Error(`sprites.txt:${i + 1}: sprite ${name} row`);
+        for (let c = 0; c < w; c++) px[r * w + c] = row[c] === '.' ? 1 : 0;
+      }
+      sprites.push({ id, name, w, h, px });
+    } else {
+      throw new Error(`sprites.txt:${i + 1}: unknown line`);
+    }
+  }
+  if (!version) throw new Error('sprites.txt: no version line');
+  return { version, sprites: sprites.sort((a, b) => a.id - b.id) };
+}
+
+function packRow(px, stride, x, y, w, out) {
+  for (let i = 0; i < w; i += 8) {
+    let v = 0;
+    for (let k = 0; k < 8 && i + k < w; k++) if (px[y * stride + x + i + k]) v |= 0x80 >> k;
+    out.push(v);
+  }
+}
+
+/** The dictionary image the device flashes. */
+export function buildDictionary({ version, sprites }) {
+  const bits = [];
+  const entries = Buffer.alloc(sprites.length * ENTRY_SIZE);
+  let off = HEADER_SIZE + entries.length;
+  sprites.forEach((s, i) => {
+    entries.writeUInt16LE(s.id, i * ENTRY_SIZE);
+    entries.writeUInt8(s.w, i * ENTRY_SIZE + 2);
+    entries.writeUInt8(s.h, i * ENTRY_SIZE + 3);
+    entries.writeUInt32LE(off, i * ENTRY_SIZE + 4);
+    const before = bits.length;
+    for (let y = 0; y < s.h; y++) packRow(s.px, s.w, 0, y, s.w, bits);
+    off += bits.length - before;
+  });
+  const body = Buffer.concat([entries, Buffer.from(bits)]);
+  const header = Buffer.alloc(HEADER_SIZE);
+  header.writeUInt32LE(SPRITE_DICT_MAGIC, 0);
+  header.writeUInt16LE(SPRITE_DICT_FORMAT, 4);
+  header.writeUInt16LE(HEADER_SIZE, 6);
+  header.writeUInt32LE(crc32(body), 8);
+  header.writeUInt32LE(HEADER_SIZE + body.length, 12);
+  header.writeUInt32LE(version, 16);
+  header.writeUInt16LE(sprites.length, 20);
+  return Buffer.concat([header, body]);
+}
+
+/** Parsed sprites and their dictionary image, or null if sprites.txt is missing or broken. */
+export function getSprites() {
+  if (loaded !== undefined) return loaded;
+  try {
+    const parsed = parseSprites(readFileSync(SOURCE, 'utf8'));
+    const image = buildDictionary(parsed);
+    loaded = { ...parsed, image, crc: image.readUInt32LE(8), byName: new Map(parsed.sprites.map(s => [s.name, s])), byId: new Map(parsed.sprites.map(s => [s.id, s])) };
+  } catch (e) {
+    console.warn('Sprites unavailable:', e.message);
+    loaded = null;
+  }
+  return loaded;
+}
+
+/**
+ * Draw a sprite into a canvas context, 1:1 and unscaled.
+ * @returns {{id:number,x:number,y:number}|null} the placement, for encodeDrawList()
+ */
+export function drawSprite(ctx, name, x, y) {
+  const s = getSprites()?.byName.get(name);
+  if (!s) return null;
+  const img = ctx.createImageData(s.w, s.h);
+  for (let i = 0; i < s.px.length; i++) {
+    const v = s.px[i] ? 255 : 0;
+    img.data[i * 4] = img.data[i * 4 + 1] = img.data[i * 4 + 2] = v;
+    img.data[i * 4 + 3] = 255;
+  }
+  ctx.putImageData(img, x, y);
+  return { id: s.id, x, y };
+}
+
+/** A 1-bit zone BMP as one byte per pixel, 1 = white. */
+export function bmpToPixels(bmp) {
+  if (bmp[0] !== 0x42 || bmp[1] !== 0x4d || bmp.readUInt16LE(28) !== 1) throw new Error('Not a 1-bit BMP');
+  const dataOffset = bmp.readUInt32LE(10);
+  const w = bmp.readInt32LE(18), rawH = bmp.readInt32LE(22);
+  const h = Math.abs(rawH), topDown = rawH < 0;
+  const stride = Math.ceil(w / 32) * 4;
+  const flip = (bmp.readUInt32LE(54) & 0xffffff) !== 0;
+  const px = new Uint8Array(w * h);
+  for (let y = 0; y < h; y++) {
+    const row = dataOffset + (topDown ? y : h - 1 - y) * stride;
+    for (let x = 0; x < w; x++) px[y * w + x] = ((bmp[row + (x >> 3)] >> (7 - (x & 7))) & 1) ^ (flip ? 1 : 0);
+  }
+  return { w, h, px };
+}
+
+function spriteMatches(s, img, x, y) {
+  for (let r = 0; r < s.h; r++)
+    for (let c = 0; c < s.w; c++)
+      if (s.px[r * s.w + c] !== img.px[(y + r) * img.w + x + c]) return false;
+  return true;
+}
+
+/**
+ * Encode a rendered zone as a draw list for a device holding dictionary
+ * `deviceVersion`. Placements that don't match the pixels are dropped, so
+ * the list always reproduces the BMP exactly.
+ * @returns {{list:Buffer, stats:Object}|null} null when the device's dictionary differs from ours
+ */
+export function encodeDrawList(zone, bmp, placements, deviceVersion) {
+  const dict = getSprites();
+  if (!dict || dict.version !== deviceVersion) return null;
+  const img = bmpToPixels(bmp);
+  const { w, h } = img;
+  const out = [];
+  const stats = { ops: 0, fills: 0, sprites: 0, bits: 0, bitsBytes: 0, bytes: 0 };
+  const u16 = v => out.push(v & 0xff, (v >> 8) & 0xff);
+
+  let whites = 0;
+  for (const p of img.px) whites += p;
+  const bg = whites * 2 >= img.px.length ? 1 : 0;
+  const canvas = new Uint8Array(img.px.length).fill(bg);
+  out.push(DRAW_OP.FILL); u16(0); u16(0); u16(w); u16(h); out.push(bg);
+  stats.ops++; stats.fills++;
+
+  for (const p of placements || []) {
+    const s = dict.byId.get(p?.id);
+    if (!s || p.x < 0 || p.y < 0 || p.x + s.w > w || p.y + s.h > h || !spriteMatches(s, img, p.x, p.y)) continue;
+    for (let r = 0; r < s.h; r++)
+      for (let c = 0; c < s.w; c++) canvas[(p.y + r) * w + p.x + c] = img.px[(p.y + r) * w + p.x + c];
+    out.push(DRAW_OP.SPRITE); u16(p.id); u16(p.x); u16(p.y);
+    stats.ops++; stats.sprites++;
+  }
+
+  const differs = (x, y) => canvas[y * w + x] !== img.px[y * w + x];
+  const fill = (x, y, fw, fh, white) => {
+    out.push(DRAW_OP.FILL); u16(x); u16(y); u16(fw); u16(fh); out.push(white);
+    for (let r = y; r < y + fh; r++) canvas.fill(white, r * w + x, r * w + x + fw);
+    stats.ops++; stats.fills++;
+  };
+  const runOf = (x, y, rw, rh, c) => {
+    for (let r = y; r < y + rh; r++)
+      for (let k = x; k < x + rw; k++)
+        if (!differs(k, r) || img.px[r * w + k] !== c) return false;
+    return true;
+  };
+
+  // Rules and borders: long runs first across, then down, each grown as far as it goes
+  for (const across of [true, false]) {
+    const lines = across ? h : w, len = across ? w : h;
+    for (let l = 0; l < lines; l++) {
+      for (let i = 0; i < len;) {
+        const x = across ? i : l, y = across ? l : i;
+        if (!differs(x, y)) { i++; continue; }
+        const c = img.px[y * w + x];
+        let n = 1;
+        while (i + n < len && (across ? runOf(x + n, y, 1, 1, c) : runOf(x, y + n, 1, 1, c))) n++;
+        if (n < RUN_MIN) { i += n; continue; }
+        let depth = 1;
+        if (across) { while (y + depth < h && runOf(x, y + depth, n, 1, c)) depth++; fill(x, y, n, depth, c); }
+        else { while (x + depth < w && runOf(x + depth, y, 1, n, c)) depth++; fill(x, y, depth, n, c); }
+        i += n;
+      }
+    }
+  }
+
+  // What is left: bands of differing rows, split into column groups
+  const rowDiffers = y => { for (let x = 0; x < w; x++) if (differs(x, y)) return true; return false; };
+  const used = new Uint8Array(w);
+  for (let y = 0; y < h;) {
+    if (!rowDiffers(y)) { y++; continue; }
+    let y1 = y;
+    while (y1 < h && rowDiffers(y1)) y1++;
+    used.fill(0);
+    for (let r = y; r < y1; r++) for (let x = 0; x < w; x++) if (differs(x, r)) used[x] = 1;
+    for (let x = 0; x < w;) {
+      if (!used[x]) { x++; continue; }
+      let gx0 = x, gx1 = x, gap = 0;
+      for (x++; x < w && gap < GROUP_GAP; x++) {
+        if (used[x]) { gx1 = x; gap = 0; } else gap++;
+      }
+      x = gx1 + 1;
+      let gy0 = y1, gy1 = y;
+      for (let r = y; r < y1; r++)
+        for (let c = gx0; c <= gx1; c++)
+          if (differs(c, r)) { gy0 = Math.min(gy0, r); gy1 = Math.max(gy1, r); break; }
+      const rw = gx1 - gx0 + 1, rh = gy1 - gy0 + 1;
+      const first = img.px[gy0 * w + gx0];
+      let uniform = true;
+      for (let r = gy0; r <= gy1 && uniform; r++)
+        for (let c = gx0; c <= gx1 && uniform; c++) uniform = img.px[r * w + c] === first;
+      if (uniform) { fill(gx0, gy0, rw, rh, first); continue; }
+      out.push(DRAW_OP.BITS); u16(gx0); u16(gy0); u16(rw); u16(rh);
+      const before = out.length;
+      for (let r = gy0; r <= gy1; r++) packRow(img.px, w, gx0, r, rw, out);
+      stats.ops++; stats.bits++;
+      stats.bitsBytes += out.length - before;
+    }
+    y = y1;
+  }
+
+  const header = Buffer.alloc(18);
+  header.write('ZD', 0, 'ascii');
+  header.writeUInt8(DRAW_LIST_VERSION, 2);
+  header.writeInt16LE(zone.x, 4);
+  header.writeInt16LE(zone.y, 6);
+  header.writeUInt16LE(w, 8);
+  header.writeUInt16LE(h, 10);
+  header.writeUInt32LE(dict.version, 12);
+  header.writeUInt16LE(stats.ops, 16);
+  const list = Buffer.concat([header, Buffer.from(out)]);
+  stats.bytes = list.length;
+  return { list, stats };
+}
+
+export default { crc32, parseSprites, buildDictionary, getSprites, drawSprite, bmpToPixels, encodeDrawList };
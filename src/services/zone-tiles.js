@@ -0,0 +1,174 @@
+/**
+ * Zone Tile Delta Encoder
+ *
+ * Splits a 1-bit zone BMP into 64x16 tiles and sends only the tiles that
+ * differ from what the device reports holding. A tile the server has sent
+ * before is encoded as a sparse XOR delta against it; uniform tiles become a
+ * single fill byte. The device applies records straight into its
+ * framebuffer, so there is no upper bound on zone size.
+ *
+ * Request body: one uint32 LE hash per tile the device holds (0 = unknown).
+ *
+ * Stream (little-endian):
+ *   header  'Z' 'T' version:u8 0 | tileW:u8 tileH:u8 | x:i16 y:i16 w:u16 h:u16 | records:u16
+ *   record  index:u16 op:u8 len:u8 hash:u32 payload[len]
+ *     op 0 RAW   tile rows, 8 bytes each, bit 7 leftmost, 1 = white
+ *     op 1 XOR   runs of (skip:u8 count:u8 bytes[count]) XORed over the held tile
+ *     op 2 FILL  one byte repeated over the whole tile
+ *     op 3 SPARSE  XOR runs over an all-white tile (mostly-blank tiles with no held copy)
+ *
+ * Copyright (c) 2026 Angus Bergman
+ * Licensed under CC BY-NC 4.0
+ */
+
+export const TILE_W = 64;
+export const TILE_H = 16;
+export const TILE_ROW_BYTES = TILE_W / 8;
+export const TILE_BYTES = TILE_ROW_BYTES * TILE_H;
+export const TILE_VERSION = 1;
+export const TILE_HEADER_SIZE = 16;
+export const TILE_RECORD_HEADER = 8;
+export const TILE_OP = { RAW: 0, XOR: 1, FILL: 2, SPARSE: 3 };
+const WHITE_TILE = Buffer.alloc(TILE_BYTES, 0xff);
+
+// Tiles previously sent, by hash, so a device's held tile can be diffed against
+const TILE_CACHE_MAX = 8192;
+const tileCache = new Map();
+
+/** FNV-1a over a tile; 0 is reserved for "device holds nothing". */
+export function tileHash(tile) {
+  let h = 0x811c9dc5;
+  for (let i = 0; i < tile.length; i++) {
+    h ^= tile[i];
+    h = Math.imul(h, 0x01000193) >>> 0;
+  }
+  return h || 1;
+}
+
+export function tileGrid(w, h) {
+  const across = Math.ceil(w / TILE_W), down = Math.ceil(h / TILE_H);
+  return { across, down, count: across * down };
+}
+
+/**
+ * Cut a 1-bit BMP (as produced by the zone renderers) into tiles.
+ * Pixels beyond the zone edge are padded white.
+ */
+export function bmpToTiles(bmp) {
+  if (bmp[0] !== 0x42 || bmp[1] !== 0x4d || bmp.readUInt16LE(28) !== 1) throw new Error('Not a 1-bit BMP');
+  const dataOffset = bmp.readUInt32LE(10);
+  const w = bmp.readInt32LE(18);
+  const rawH = bmp.readInt32LE(22);
+  const h = Math.abs(rawH), topDown = rawH < 0;
+  const stride = Math.ceil(w / 32) * 4;
+  // Palette index 1 is white in our BMPs; flip if a writer chose the other order
+  const invert = bmp.readUInt32LE(54) !== 0 && bmp.readUInt32LE(58) === 0;
+  const grid = tileGrid(w, h);
+  const tiles = [];
+
+  for (let ty = 0; ty < grid.down; ty++) {
+    for (let tx = 0; tx < grid.across; tx++) {
+      const tile = Buffer.alloc(TILE_BYTES, 0xff);
+      for (let r = 0; r < TILE_H; r++) {
+        const y = ty * TILE_H + r;
+        if (y >= h) break;
+        const row = dataOffset + (topDown ? y : h - 1 - y) * stride;
+        for (let b = 0; b < TILE_ROW_BYTES; b++) {
+          const x = tx * TILE_W + b * 8;
+          if (x >= w) break;
+          let v = bmp[row + (x >> 3)];
+          if (invert) v ^= 0xff;
+          const valid = w - x >= 8 ? 0xff : (0xff << (8 - (w - x))) & 0xff;
+          tile[r * TILE_ROW_BYTES + b] = (v & valid) | (~valid & 0xff);
+        }
+      }
+      tiles.push(tile);
+    }
+  }
+  return { w, h, ...grid, tiles };
+}
+
+export function parseDeviceHashes(body, count) {
+  if (!Buffer.isBuffer(body) || body.length !== count * 4) return null;
+  const hashes = new Array(count);
+  for (let i = 0; i < count; i++) hashes[i] = body.readUInt32LE(i * 4);
+  return hashes;
+}
+
+function rememberTile(hash, tile) {
+  tileCache.delete(hash);
+  tileCache.set(hash, tile);
+  if (tileCache.size > TILE_CACHE_MAX) tileCache.delete(tileCache.keys().next().value);
+}
+
+// Sparse XOR runs; null when not smaller than a raw tile
+function xorRuns(prev, next) {
+  const out = [];
+  let i = 0;
+  while (i < TILE_BYTES) {
+    let skip = 0;
+    while (i < TILE_BYTES && prev[i] === next[i] && skip < 255) { skip++; i++; }
+    let end = i;
+    // Absorb single matching bytes inside a run; a 2-byte gap costs the same as a new run
+    while (end < TILE_BYTES && end - i < 255 &&
+           (prev[end] !== next[end] || (end + 1 < TILE_BYTES && prev[end + 1] !== next[end + 1]))) end++;
+    if (i >= TILE_BYTES) break;   // trailing matches need no run
+    out.push(skip, end - i);
+    for (let k = i; k < end; k++) out.push(prev[k] ^ next[k]);
+    i = end;
+    if (out.length >= TILE_BYTES) return null;
+  }
+  return Buffer.from(out);
+}
+
+/**
+ * Encode the tiles of `bmp` the device doesn't already hold.
+ * @param {{x:number,y:number,w:number,h:number}} zone - geometry reported to the device
+ * @param {Buffer} bmp - rendered zone
+ * @param {number[]|null} deviceHashes - from parseDeviceHashes(), or null for a full send
+ */
+export function encodeTileStream(zone, bmp, deviceHashes = null) {
+  const { w, h, tiles } = bmpToTiles(bmp);
+  const records = [];
+  const stats = { tiles: tiles.length, raw: 0, xor: 0, fill: 0, sparse: 0, unchanged: 0, bytes: 0 };
+
+  tiles.forEach((tile, index) => {
+    const hash = tileHash(tile);
+    const held = deviceHashes?.[index] || 0;
+    if (held === hash) { stats.unchanged++; rememberTile(hash, tile); return; }
+
+    let op = TILE_OP.RAW, payload = tile;
+    if (tile.every(b => b === tile[0])) {
+      op = TILE_OP.FILL; payload = Buffer.from([tile[0]]);
+    } else {
+      const xor = held && tileCache.has(held) ? xorRuns(tileCache.get(held), tile) : null;
+      const sparse = xorRuns(WHITE_TILE, tile);
+      if (xor && (!sparse || xor.length <= sparse.length)) { op = TILE_OP.XOR; payload = xor; }
+      else if (sparse) { op = TILE_OP.SPARSE; payload = sparse; }
+    }
+    const rec = Buffer.alloc(TILE_RECORD_HEADER);
+    rec.writeUInt16LE(index, 0);
+    rec.writeUInt8(op, 2);
+    rec.writeUInt8(payload.length, 3);
+    rec.writeUInt32LE(hash, 4);
+    records.push(rec, payload);
+    rememberTile(hash, tile);
+    stats[['raw', 'xor', 'fill', 'sparse'][op]]++;
+  });
+
+  const header = Buffer.alloc(TILE_HEADER_SIZE);
+  header.write('ZT', 0, 'ascii');
+  header.writeUInt8(TILE_VERSION, 2);
+  header.writeUInt8(TILE_W, 4);
+  header.writeUInt8(TILE_H, 5);
+  header.writeInt16LE(zone.x, 6);
+  header.writeInt16LE(zone.y, 8);
+  header.writeUInt16LE(w, 10);
+  header.writeUInt16LE(h, 12);
+  header.writeUInt16LE(stats.raw + stats.xor + stats.fill + stats.sparse, 14);
+  const stream = Buffer.concat([header, ...records]);
+  stats.bytes = stream.length;
+  return { stream, stats };
+}
+
+export default { TILE_W, TILE_H, tileHash, tileGrid, bmpToTiles, parseDeviceHashes, encodeTileStream };
@@ -11,8 +11,10 @@
  */
 
 #include <WiFi.h>
+#include <WiFiClientSecure.h>
 #include <HTTPClient.h>
-#include <ArduinoJson.h>
+#include <ArduinoJson.h>   // 6.x: StaticJsonDocument lives on the stack
+#include <bb_epaper.h>
 
 // Configuration - Set these during setup
 const char* ssid = "YOUR_WIFI_SSID";
@@ -24,6 +26,17 @@ const int DISPLAY_WIDTH = 800;
 const int DISPLAY_HEIGHT = 480;
 const char* DEVICE_TYPE = "trmnl-og";
 
+// TRMNL OG panel wiring (same as firmware/include/config.h)
+#define EPD_SCK_PIN  7
+#define EPD_MOSI_PIN 8
+#define EPD_CS_PIN   6
+#define EPD_RST_PIN  10
+#define EPD_DC_PIN   5
+#define EPD_BUSY_PIN 4
+#define EPD_SPI_HZ   16000000
+
+BBEPAPER bbep(EP75_800x480);
+
 // Refresh settings (loaded from server)
 unsigned long refreshInterval = 900000;  // 15 minutes default (milliseconds)
 unsigned long lastRefresh = 0;
@@ -32,23 +45,41 @@ unsigned long lastFullRefresh = 0;
 // Partial refresh settings
 bool partialRefreshEnabled = false;
 unsigned long partialRefreshInterval = 20000;  // 20 seconds
+
+const int MAX_ZONES = 4;
+const int ZONE_ID_LEN = 24;
 struct RefreshZone {
-  String id;
-  int x, y, width, height;
+  char id[ZONE_ID_LEN];
+  int x, y, width, height;         // pixels; x and width on 8-pixel (byte) boundaries
   unsigned long refreshInterval;
   unsigned long lastRefresh;
 };
-RefreshZone zones[4];  // header, transitInfo, coffeeDecision, footer
+RefreshZone zones[MAX_ZONES];  // header, transitInfo, coffeeDecision, footer
 int zoneCount = 0;
 
+// Request URLs are built in place; a lastRefreshTimes query URL-encodes to about 500 bytes
+const size_t URL_MAX = 768;
+const size_t TIMES_MAX = 224;
+
+// One BMP row: 1 bit per pixel, padded to 4 bytes
+const int BMP_ROW_MAX = ((DISPLAY_WIDTH + 31) / 32) * 4;
+const int BMP_HEADER = 62;
+
+WiFiClient plainClient;
+WiFiClientSecure tlsClient;
+
 void setup() {
   Serial.begin(115200);
   Serial.println("\n=== TRMNL BYOS for PTV-TRMNL ===");
   Serial.println("Copyright (c) 2026 Angus Bergman\n");
 
-  // Initialize display
-  // TODO: Add your e-ink display initialization here
   Serial.println("Initializing display...");
+  bbep.initIO(EPD_DC_PIN, EPD_RST_PIN, EPD_BUSY_PIN, EPD_CS_PIN, EPD_MOSI_PIN, EPD_SCK_PIN, EPD_SPI_HZ);
+  bbep.setPanelType(EP75_800x480);
+  bbep.setRotation(0);
+  bbep.allocBuffer(false);
+  bbep.fillScreen(BBEP_WHITE);
+  tlsClient.setInsecure();
 
   // Connect to WiFi
   connectWiFi();
@@ -73,7 +104,6 @@ void loop() {
     // Force full refresh periodically
     if (now - lastFullRefresh >= refreshInterval) {
       fullRefresh();
-      lastFullRefresh = now;
     }
   } else {
     // Standard full refresh mode
@@ -106,20 +136,71 @@ void connectWiFi() {
   }
 }
 
+// GET url. The body is read straight off http.getStream(): HTTP/1.0 keeps
+// the server from chunking it, so JSON and BMPs parse as they arrive.
+int beginGet(HTTPClient& http, const char* url) {
+  http.useHTTP10(true);
+  http.setTimeout(10000);
+  bool tls = strncmp(url, "https:", 6) == 0;
+  if (!(tls ? http.begin(tlsClient, url) : http.begin(plainClient, url))) return -1;
+  return http.GET();
+}
+
+// A zone coordinate is pixels or a percentage of the display ("15%")
+int resolveCoord(JsonVariantConst v, int extent) {
+  const char* s = v.as<const char*>();
+  if (!s) return v | 0;
+  float n = atof(s);
+  return strchr(s, '%') ? (int)(n * extent / 100.0f + 0.5f) : (int)n;
+}
+
+void parseZone(RefreshZone& zone, JsonObjectConst src) {
+  strlcpy(zone.id, src["id"] | "", sizeof(zone.id));
+  zone.refreshInterval = src["refreshInterval"] | partialRefreshInterval;
+  zone.lastRefresh = 0;
+
+  JsonObjectConst c = src["coordinates"];
+  int x = resolveCoord(c["x"], DISPLAY_WIDTH), y = resolveCoord(c["y"], DISPLAY_HEIGHT);
+  int right = x + resolveCoord(c["width"], DISPLAY_WIDTH), bottom = y + resolveCoord(c["height"], DISPLAY_HEIGHT);
+  // Framebuffer rows are copied a byte at a time, so widen to whole bytes
+  x = constrain(x, 0, DISPLAY_WIDTH) & ~7;
+  right = (constrain(right, 0, DISPLAY_WIDTH) + 7) & ~7;
+  y = constrain(y, 0, DISPLAY_HEIGHT);
+  bottom = constrain(bottom, 0, DISPLAY_HEIGHT);
+  zone.x = x;
+  zone.y = y;
+  zone.width = right > x ? right - x : 0;
+  zone.height = bottom > y ? bottom - y : 0;
+}
+
 void getDeviceConfig() {
   if (WiFi.status() != WL_CONNECTED) return;
 
   HTTPClient http;
-  String url = String(serverUrl) + "/api/device-config";
+  char url[URL_MAX];
+  snprintf(url, sizeof(url), "%s/api/device-config", serverUrl);
 
   Serial.println("Getting device configuration...");
-  http.begin(url);
-
-  int httpCode = http.GET();
+  int httpCode = beginGet(http, url);
   if (httpCode == 200) {
-    String payload = http.getString();
-    DynamicJsonDocument doc(4096);
-    deserializeJson(doc, payload);
+    // Keep only what the firmware uses; availableDevices alone is several KB
+    StaticJsonDocument<256> filter;
+    filter["refreshInterval"] = true;
+    filter["partialRefresh"]["enabled"] = true;
+    filter["partialRefresh"]["interval"] = true;
+    JsonObject zf = filter["partialRefresh"]["zones"].createNestedObject();  // applies to every element
+    zf["id"] = true;
+    zf["refreshInterval"] = true;
+    zf["coordinates"] = true;
+
+    StaticJsonDocument<1536> doc;
+    DeserializationError err = deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
+    if (err) {
+      Serial.print("Device config: ");
+      Serial.println(err.c_str());
+      http.end();
+      return;
+    }
 
     refreshInterval = doc["refreshInterval"] | 900000;
     Serial.print("Refresh interval: ");
@@ -127,30 +208,27 @@ void getDeviceConfig() {
     Serial.println(" seconds");
 
     // Parse partial refresh settings
-    if (doc.containsKey("partialRefresh") && !doc["partialRefresh"].isNull()) {
-      partialRefreshEnabled = doc["partialRefresh"]["enabled"];
-      partialRefreshInterval = doc["partialRefresh"]["interval"] | 20000;
+    JsonObjectConst partial = doc["partialRefresh"];
+    if (!partial.isNull()) {
+      partialRefreshEnabled = partial["enabled"] | false;
+      partialRefreshInterval = partial["interval"] | 20000;
 
       Serial.print("Partial refresh: ");
       Serial.println(partialRefreshEnabled ? "enabled" : "disabled");
 
       if (partialRefreshEnabled) {
         // Load zones
-        JsonArray zonesArray = doc["partialRefresh"]["zones"];
-        zoneCount = zonesArray.size();
-
-        for (int i = 0; i < zoneCount && i < 4; i++) {
-          JsonObject zone = zonesArray[i];
-          zones[i].id = zone["id"].as<String>();
-          zones[i].refreshInterval = zone["refreshInterval"];
-          zones[i].lastRefresh = 0;
-
-          // TODO: Parse coordinates (may be percentage-based)
-          Serial.print("Zone ");
-          Serial.print(i);
-          Serial.print(": ");
-          Serial.println(zones[i].id);
+        zoneCount = 0;
+        for (JsonObjectConst zone : partial["zones"].as<JsonArrayConst>()) {
+          if (zoneCount == MAX_ZONES) break;
+          RefreshZone& z = zones[zoneCount];
+          parseZone(z, zone);
+          if (!z.id[0] || !z.width || !z.height) continue;
+          zoneCount++;
+
+          Serial.printf("Zone %s: %d,%d %dx%d every %lus\n", z.id, z.x, z.y, z.width, z.height, z.refreshInterval / 1000);
         }
+        partialRefreshEnabled = zoneCount > 0;
       }
     }
   } else {
@@ -161,6 +239,50 @@ void getDeviceConfig() {
   http.end();
 }
 
+// Stream a 1-bit BMP of exactly w x h into the framebuffer at (x, y), one
+// row at a time: neither the file nor a second frame is ever held in RAM.
+bool drawBmp(Stream& in, int x, int y, int w, int h) {
+  uint8_t header[BMP_HEADER];
+  if (in.readBytes(header, sizeof(header)) != sizeof(header) || header[0] != 'B' || header[1] != 'M') return false;
+  uint32_t dataOffset = header[10] | header[11] << 8 | (uint32_t)header[12] << 16 | (uint32_t)header[13] << 24;
+  int32_t bw = (int32_t)(header[18] | header[19] << 8 | (uint32_t)header[20] << 16 | (uint32_t)header[21] << 24);
+  int32_t bh = (int32_t)(header[22] | header[23] << 8 | (uint32_t)header[24] << 16 | (uint32_t)header[25] << 24);
+  bool topDown = bh < 0;
+  if (topDown) bh = -bh;
+  if (header[28] != 1 || bw != w || bh != h || (w & 7) || (x & 7) || x + w > DISPLAY_WIDTH || y + h > DISPLAY_HEIGHT) {
+    Serial.printf("BMP: got %ldx%ld %dbpp for a %dx%d zone\n", (long)bw, (long)bh, header[28], w, h);
+    return false;
+  }
+  // The panel wants 1 = white; flip if palette entry 0 is the white one
+  uint8_t flip = (header[54] | header[55] | header[56]) ? 0xFF : 0x00;
+  for (uint32_t skip = sizeof(header); skip < dataOffset; skip++) {
+    if (in.readBytes(header, 1) != 1) return false;
+  }
+
+  uint8_t row[BMP_ROW_MAX];
+  int stride = ((w + 31) / 32) * 4, pitch = DISPLAY_WIDTH / 8;
+  uint8_t* fb = bbep.getBuffer();
+  for (int r = 0; r < h; r++) {
+    if (in.readBytes(row, stride) != (size_t)stride) return false;
+    uint8_t* dst = fb + (y + (topDown ? r : h - 1 - r)) * pitch + x / 8;
+    for (int i = 0; i < w / 8; i++) dst[i] = row[i] ^ flip;
+  }
+  return true;
+}
+
+// GET a BMP and draw it at (x, y); the caller refreshes the panel
+bool fetchBitmap(const char* url, int x, int y, int w, int h) {
+  HTTPClient http;
+  int httpCode = beginGet(http, url);
+  bool ok = httpCode == 200 && drawBmp(http.getStream(), x, y, w, h);
+  if (httpCode != 200) {
+    Serial.print("HTTP error: ");
+    Serial.println(httpCode);
+  }
+  http.end();
+  return ok;
+}
+
 void fullRefresh() {
   Serial.println("Performing full refresh...");
 
@@ -169,129 +291,136 @@ void fullRefresh() {
     return;
   }
 
-  HTTPClient http;
-  String url = String(serverUrl) + "/api/screen";
-
-  http.begin(url);
-  int httpCode = http.GET();
-
-  if (httpCode == 200) {
-    String payload = http.getString();
-    DynamicJsonDocument doc(8192);
-    deserializeJson(doc, payload);
-
-    // Get screen markup or image
-    String screenText = doc["merge_variables"]["screen_text"];
+  char url[URL_MAX];
+  snprintf(url, sizeof(url), "%s/api/image", serverUrl);
+  if (!fetchBitmap(url, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT)) {
+    Serial.println("Full refresh failed");
+    return;
+  }
+  bbep.refresh(REFRESH_FULL, true);
 
-    // TODO: Render to e-ink display
-    Serial.println("=== Display Content ===");
-    Serial.println(screenText);
-    Serial.println("======================");
+  // Update all zone refresh times
+  unsigned long now = millis();
+  for (int i = 0; i < zoneCount; i++) {
+    zones[i].lastRefresh = now;
+  }
+  lastFullRefresh = now;
 
-    // Update all zone refresh times
-    for (int i = 0; i < zoneCount; i++) {
-      zones[i].lastRefresh = millis();
-    }
+  Serial.println("Full refresh complete");
+}
 
-    Serial.println("Full refresh complete");
-  } else {
-    Serial.print("HTTP error: ");
-    Serial.println(httpCode);
+RefreshZone* findZone(const char* id) {
+  for (int i = 0; i < zoneCount; i++) {
+    if (strcmp(zones[i].id, id) == 0) return &zones[i];
   }
-
-  http.end();
+  return nullptr;
 }
 
 void checkAndRefreshZones() {
-  // Build query with last refresh times
-  String query = "{";
+  if (WiFi.status() != WL_CONNECTED) return;
+
+  // Nothing is due until one zone's own interval has passed; until then
+  // there's no request at all
+  unsigned long now = millis();
+  bool due = false;
   for (int i = 0; i < zoneCount; i++) {
-    if (i > 0) query += ",";
-    query += "\"" + zones[i].id + "\":" + String(zones[i].lastRefresh);
+    if (now - zones[i].lastRefresh >= zones[i].refreshInterval) due = true;
   }
-  query += ",\"fullRefresh\":" + String(lastFullRefresh) + "}";
-
-  HTTPClient http;
-  String url = String(serverUrl) + "/api/refresh-zones?lastRefreshTimes=" + urlEncode(query);
+  if (!due) return;
+
+  // Build query with last refresh times. They're on this device's clock;
+  // `now` lets the server line them up with its own.
+  char times[TIMES_MAX];
+  size_t len = snprintf(times, sizeof(times), "{");
+  for (int i = 0; i < zoneCount && len < sizeof(times); i++) {
+    len += snprintf(times + len, sizeof(times) - len, "\"%s\":%lu,", zones[i].id, zones[i].lastRefresh);
+  }
+  if (len < sizeof(times)) len += snprintf(times + len, sizeof(times) - len, "\"fullRefresh\":%lu}", lastFullRefresh);
 
-  http.begin(url);
-  int httpCode = http.GET();
+  char url[URL_MAX];
+  size_t base = snprintf(url, sizeof(url), "%s/api/refresh-zones?now=%lu&lastRefreshTimes=", serverUrl, now);
+  if (len >= sizeof(times) || base >= sizeof(url) || !urlEncode(times, url + base, sizeof(url) - base)) {
+    Serial.println("Refresh query too long");
+    return;
+  }
 
-  if (httpCode == 200) {
-    String payload = http.getString();
-    DynamicJsonDocument doc(4096);
-    deserializeJson(doc, payload);
+  HTTPClient http;
+  int httpCode = beginGet(http, url);
+  if (httpCode != 200) {
+    Serial.print("HTTP error: ");
+    Serial.println(httpCode);
+    http.end();
+    return;
+  }
 
-    bool refreshAll = doc["refreshAll"] | false;
+  StaticJsonDocument<128> filter;
+  filter["refreshAll"] = true;
+  filter["zones"][0]["id"] = true;
+  StaticJsonDocument<384> doc;
+  DeserializationError err = deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
+  http.end();
+  if (err) {
+    Serial.print("Refresh zones: ");
+    Serial.println(err.c_str());
+    return;
+  }
 
-    if (refreshAll) {
-      // Server recommends full refresh
-      fullRefresh();
-      return;
-    }
+  if (doc["refreshAll"] | false) {
+    // Server recommends full refresh
+    fullRefresh();
+    return;
+  }
 
-    // Partial refresh specified zones
-    JsonArray zonesToRefresh = doc["zones"];
-    for (JsonObject zone : zonesToRefresh) {
-      String zoneId = zone["id"];
-      Serial.print("Refreshing zone: ");
-      Serial.println(zoneId);
-
-      // TODO: Fetch zone content and update display region
-      // partialRefreshZone(zoneId, zone["coordinates"]);
-
-      // Update last refresh time
-      for (int i = 0; i < zoneCount; i++) {
-        if (zones[i].id == zoneId) {
-          zones[i].lastRefresh = millis();
-          break;
-        }
-      }
+  // Draw every zone the server lists, then one partial refresh for all of them
+  int drawn = 0;
+  for (JsonObjectConst zone : doc["zones"].as<JsonArrayConst>()) {
+    RefreshZone* z = findZone(zone["id"] | "");
+    if (!z) continue;
+    Serial.print("Refreshing zone: ");
+    Serial.println(z->id);
+
+    snprintf(url, sizeof(url), "%s/api/image?x=%d&y=%d&w=%d&h=%d", serverUrl, z->x, z->y, z->width, z->height);
+    if (fetchBitmap(url, z->x, z->y, z->width, z->height)) {
+      z->lastRefresh = now;
+      drawn++;
     }
   }
-
-  http.end();
+  if (drawn) bbep.refresh(REFRESH_PARTIAL, true);
 }
 
-String urlEncode(String str) {
-  String encoded = "";
-  char c;
-  for (int i = 0; i < str.length(); i++) {
-    c = str.charAt(i);
-    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-      encoded += c;
+// Percent-encode in into out (cap bytes with the terminator). False if it doesn't fit.
+bool urlEncode(const char* in, char* out, size_t cap) {
+  static const char hex[] = "0123456789ABCDEF";
+  size_t n = 0;
+  for (; *in; in++) {
+    char c = *in;
+    if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      if (n + 1 >= cap) return false;
+      out[n++] = c;
     } else {
-      encoded += '%';
-      encoded += String(c, HEX);
+      if (n + 3 >= cap) return false;
+      out[n++] = '%';
+      out[n++] = hex[(uint8_t)c >> 4];
+      out[n++] = hex[(uint8_t)c & 15];
     }
   }
-  return encoded;
+  out[n] = '\0';
+  return true;
 }
-
-// TODO: Implement actual e-ink display functions
-// - Initialize display
-// - Full screen refresh
-// - Partial zone refresh
-// - Draw text/graphics
-// - Handle orientation
-
 /**
  * IMPLEMENTATION NOTES:
  *
- * This is a template firmware file. You need to add your specific e-ink
- * display library and functions.
- *
- * For TRMNL OG devices with specific e-ink displays:
- * 1. Add your display library (e.g., GxEPD2, Adafruit_GFX)
- * 2. Implement display initialization
- * 3. Implement full refresh rendering
- * 4. Implement partial refresh zones
- * 5. Add text rendering functions
- * 6. Test on actual hardware
+ * Needs bb_epaper (bitbank2) and ArduinoJson 6.x from the Library Manager.
  *
- * Refer to your e-ink display's datasheet for:
- * - SPI pin connections
- * - Initialization sequences
- * - Refresh commands
- * - Partial update support
+ * - Full refresh: /api/image (800x480 1-bit BMP) streamed into the
+ *   framebuffer row by row, then a full waveform.
+ * - Partial refresh: each zone keeps its own refreshInterval from
+ *   /api/device-config. Once one is due, /api/refresh-zones says which to
+ *   redraw (or to go full). Each is fetched as /api/image?x=&y=&w=&h=,
+ *   drawn in place, and a single partial waveform covers them all.
+ * - Zone coordinates may be pixels or percentages of the display; they're
+ *   widened to 8-pixel boundaries so rows copy a byte at a time.
+ * - JSON is parsed through filter documents into fixed StaticJsonDocuments,
+ *   and URLs are built in stack buffers: a refresh cycle makes no heap
+ *   allocations of its own.
  */